@@ -0,0 +1,35 @@
+/**
+ * @file      end.h
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br
+ *
+ * @version   1.0
+ * @brief     Performance mode of the acstone programs.
+ *            Built with -DENDCODE -Dmain=acstone_main -Iperf (see the
+ *            perf rule of Makefile.archc), a program runs its main
+ *            function ACSTONE_REPEAT times, so its simulation takes long
+ *            enough to time. The programs keep what they leave in
+ *            memory between runs, so the runs after the first one of a
+ *            sort find the array already sorted.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#undef main
+
+#ifndef ACSTONE_REPEAT
+#define ACSTONE_REPEAT 10000
+#endif
+
+int main() {
+  int i, ret = 0;
+
+  for (i = 0; i < ACSTONE_REPEAT; i++)
+    ret |= acstone_main();
+  return ret;
+}
@@ -39,6 +39,13 @@ typedef struct {
   unsigned long dmask;
 } acasm_opcode;
 
+/* A slot of the mnemonic hash table: the instructions of a mnemonic, first
+   to first+count-1 in the opcode table, or first -1 if empty */
+typedef struct {
+  int first;
+  int count;
+} acasm_opcode_hash;
+
 typedef struct {
   const char *symbol;
   const char *cspec;
@@ -53,5 +60,11 @@ extern const acasm_symbol udsymbols[];
 extern const int num_symbols;
 extern const char *pseudo_instrs[];
 extern const int num_pseudo_instrs;
+extern const acasm_opcode_hash opcode_hash[];
+extern const unsigned long num_opcode_hash;
+extern const unsigned long opcode_hash_seed;
+
+extern unsigned long acasm_hash_mnemonic(const char *mnemonic, unsigned long seed);
+extern int acasm_find_opcode(const char *mnemonic, int *count);
 
 #endif
@@ -27,6 +27,7 @@ Software Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.  *
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "sysdep.h"
 #include `"opcode/'___arch_name___`.h"'
 
@@ -42,6 +43,8 @@ const char *pseudo_instrs[] = {
 ___pseudo_table___
 };
 
+___opcode_hash___
+
 
 void print_opcode_structure(FILE *stream, unsigned int indent, acasm_opcode *insn)
 {
@@ -57,8 +60,37 @@ void print_opcode_structure(FILE *stream, unsigned int indent, acasm_opcode *ins
 }
 
 
+/* FNV-1a hash of a mnemonic, from a seed. acbingen builds opcode_hash with
+   the same function */
+unsigned long acasm_hash_mnemonic(const char *mnemonic, unsigned long seed)
+{
+  unsigned long h = (2166136261UL ^ seed) & 0xffffffffUL;
+
+  while (*mnemonic != '\0') {
+    h ^= (unsigned char) *mnemonic++;
+    h = (h * 16777619UL) & 0xffffffffUL;
+  }
+  return h;
+}
 
 
+/* Returns the index in opcodes of the first instruction of mnemonic, and
+   in count (if not NULL) how many follow with it, or -1 if there is none */
+int acasm_find_opcode(const char *mnemonic, int *count)
+{
+  unsigned long mask = num_opcode_hash - 1;
+  unsigned long i = acasm_hash_mnemonic(mnemonic, opcode_hash_seed) & mask;
+
+  while (opcode_hash[i].first != -1) {
+    if (!strcmp(opcodes[opcode_hash[i].first].mnemonic, mnemonic)) {
+      if (count != NULL) *count = opcode_hash[i].count;
+      return opcode_hash[i].first;
+    }
+    i = (i + 1) & mask;
+  }
+  return -1;
+}
+
 
 const int num_opcodes = ((sizeof opcodes) / (sizeof(opcodes[0])));
 const int num_symbols = ((sizeof udsymbols) / (sizeof(udsymbols[0])));
@@ -58,6 +58,7 @@ static int Createm4File();
 #define SYMBOL_TABLE_FILE   "symbol.table"
 #define PSEUDO_TABLE_FILE   "pseudo.table"
 #define OPERAND_TABLE_FILE  "operand.table"
+#define OPCODE_HASH_FILE    "opcode.hash"
 #define RELOC_IDS_FILE      "reloc.ids"
 #define RELOC_HOWTO_FILE    "reloc.howto"
 #define RELOC_MAP_FILE      "reloc.map"
@@ -227,6 +228,13 @@ int main(int argc, char **argv)
     exit(1);
   }
 
+  strcpy(buffer, GEN_DIR);
+  strcat(buffer, OPCODE_HASH_FILE);
+  if (!CreateMnemonicHashTable(buffer)) {   /* write the mnemonic hash table */
+    fprintf(stderr, "Error creating mnemonic hash table.\n");
+    exit(1);
+  }
+
   strcpy(buffer, GEN_DIR);
   strcat(buffer, SYMBOL_TABLE_FILE);  
   if (!CreateAsmSymbolTable(buffer)) {  /* write the symbol table */
@@ -366,6 +374,7 @@ static int Createm4File()
   fprintf(output, "m4_define(`___symbol_table___', `m4_include(%s)')m4_dnl\n", SYMBOL_TABLE_FILE);
   fprintf(output, "m4_define(`___pseudo_table___', `m4_include(%s)')m4_dnl\n", PSEUDO_TABLE_FILE);
   fprintf(output, "m4_define(`___operand_table___', `m4_include(%s)')m4_dnl\n", OPERAND_TABLE_FILE);
+  fprintf(output, "m4_define(`___opcode_hash___', `m4_include(%s)')m4_dnl\n", OPCODE_HASH_FILE);
 
   
   fprintf(output, "m4_define(`___reloc_ids___', `m4_include(%s)')m4_dnl\n", RELOC_IDS_FILE);
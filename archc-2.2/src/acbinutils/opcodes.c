@@ -49,9 +49,16 @@ typedef struct _oper_list {
   unsigned int reloc_id;
   unsigned int fields_positions;
   struct _oper_list *next;
+  struct _oper_list *hash_next;  /* next in the same bucket of oper_hash */
 } oper_list;
 
 static oper_list *operand_list = NULL;
+static oper_list *operand_last = NULL;
+
+/* operands by a hash of their name and type, so that find_operand does not
+   walk the whole list for every operand of every instruction */
+#define OPER_HASH_SIZE 256
+static oper_list *oper_hash[OPER_HASH_SIZE];
 
 typedef struct _mod_list {
   int id;
@@ -65,6 +72,8 @@ static mod_list *modifier_list = NULL;
  * module function prototypes
  */
 static oper_list *find_operand(oper_list *opl);
+static unsigned int hash_operand(oper_list *opl);
+static unsigned long hash_mnemonic(const char *mnemonic, unsigned long seed);
 static void create_operand_string(ac_asm_insn *insn, char **output);
 static unsigned int encode_insn_field(unsigned int field_value, unsigned insn_size, unsigned fbit, unsigned fsize);
 static unsigned int encode_dmask_field(unsigned insn_size, unsigned fbit, unsigned fsize);
@@ -109,24 +118,26 @@ void create_operand_list()
       oper->format_id = get_format_id(asml->insn->format);
    
       oper->next = NULL;
+      oper->hash_next = NULL;
 
       oper_list *opfound = find_operand(oper);
 
       if (opfound == NULL) { /* operand not defined yet */
+        unsigned int h = hash_operand(oper);
+
         if (operand_list == NULL) {
           oper->id = 0;
           opP->oper_id = 0;
           operand_list = oper;
         }
         else {
-          oper_list *otmp = operand_list;
-          while (otmp->next != NULL) 
-            otmp = otmp->next;
-
-          oper->id = otmp->id+1; 
+          oper->id = operand_last->id+1; 
           opP->oper_id = oper->id;
-          otmp->next = oper;
+          operand_last->next = oper;
         }
+        operand_last = oper;
+        oper->hash_next = oper_hash[h];
+        oper_hash[h] = oper;
       }
       else {
         opP->oper_id = opfound->id;
@@ -300,6 +311,124 @@ int CreateOpcodeTable(const char *table_filename)
   return 1; 
 }
 
+/*
+  Mnemonic hash table generation
+
+  The assembler finds the opcodes of a mnemonic through this table, of
+  type acasm_opcode_hash, instead of searching the opcode table. Each
+  distinct mnemonic has a slot, at acasm_hash_mnemonic(mnemonic, seed)
+  modulo the size of the table (a power of two), or at the first empty one
+  after it:
+
+  . int first
+    Index in the opcode table of the first instruction of the mnemonic, -1
+    for an empty slot. The insn list is in alphabetical order, so the
+    instructions of a mnemonic follow each other
+
+  . int count
+    The number of instructions of the mnemonic
+
+  The table is at least twice the number of mnemonics, and the seed is
+  searched so that no two mnemonics share a slot: a lookup then takes a
+  single probe. When no seed is found up to MAX_HASH_GROWTH times that
+  size, the last one tried is kept, and lookups probe linearly.
+
+  The file written declares opcode_hash_seed, opcode_hash and
+  num_opcode_hash.
+*/
+#define HASH_SEEDS      64
+#define MAX_HASH_GROWTH 8
+
+int CreateMnemonicHashTable(const char *hash_filename)
+{
+  FILE *output;
+  ac_asm_insn *asml;
+  const char **mnemonics;
+  int *first, *count, *slots;
+  int num_mnemonics = 0;
+  int index = 0;
+  unsigned long size, max_size, seed = 0;
+  int i, collisions = 1;
+
+  if ((output = fopen(hash_filename, "w")) == NULL) 
+    return 0;
+
+  /* one entry for each run of instructions of the same mnemonic */
+  for (asml = ac_asm_get_asm_insn_list(); asml != NULL; asml = asml->next)
+    num_mnemonics++;
+
+  mnemonics = (const char **) malloc(sizeof(char *) * (num_mnemonics+1));
+  first = (int *) malloc(sizeof(int) * (num_mnemonics+1));
+  count = (int *) malloc(sizeof(int) * (num_mnemonics+1));
+
+  num_mnemonics = 0;
+  for (asml = ac_asm_get_asm_insn_list(); asml != NULL; asml = asml->next, index++) {
+    if (num_mnemonics && !strcmp(mnemonics[num_mnemonics-1], asml->mnemonic)) {
+      count[num_mnemonics-1]++;
+      continue;
+    }
+    mnemonics[num_mnemonics] = asml->mnemonic;
+    first[num_mnemonics] = index;
+    count[num_mnemonics] = 1;
+    num_mnemonics++;
+  }
+
+  for (size = 16; size < 2 * (unsigned long) num_mnemonics; size <<= 1) ;
+  max_size = size * MAX_HASH_GROWTH;
+  slots = (int *) malloc(sizeof(int) * max_size);
+
+  /* the smallest table, and its first seed, without collisions */
+  while (collisions) {
+    for (seed = 0; seed < HASH_SEEDS && collisions; seed++) {
+      collisions = 0;
+      for (i = 0; i < size; i++)
+        slots[i] = -1;
+      for (i = 0; i < num_mnemonics && !collisions; i++) {
+        unsigned long h = hash_mnemonic(mnemonics[i], seed) & (size-1);
+
+        if (slots[h] != -1) collisions = 1;
+        else slots[h] = i;
+      }
+    }
+    seed--;
+    if (collisions) {
+      if (size == max_size) break;
+      size <<= 1;
+    }
+  }
+
+  /* fill the table, probing linearly if it has collisions */
+  for (i = 0; i < size; i++)
+    slots[i] = -1;
+  for (i = 0; i < num_mnemonics; i++) {
+    unsigned long h = hash_mnemonic(mnemonics[i], seed) & (size-1);
+
+    while (slots[h] != -1)
+      h = (h+1) & (size-1);
+    slots[h] = i;
+  }
+
+  fprintf(output, "const unsigned long opcode_hash_seed = %lu;\n\n", seed);
+  fprintf(output, "const acasm_opcode_hash opcode_hash[] = {\n");
+  for (i = 0; i < size; i++) {
+    if (slots[i] == -1)
+      fprintf(output, "%s{-1,\t0},\n", IND1);
+    else
+      fprintf(output, "%s{%d,\t%d},\t/* %s */\n", IND1, first[slots[i]], count[slots[i]],
+              mnemonics[slots[i]]);
+  }
+  fprintf(output, "};\n\n");
+  fprintf(output, "const unsigned long num_opcode_hash = %lu;\n", size);
+
+  free(slots);
+  free(count);
+  free(first);
+  free(mnemonics);
+
+  fclose(output);
+  return 1; 
+}
+
 /*
   User defined symbol table generation
 
@@ -601,10 +730,34 @@ static unsigned int encode_dmask_field(unsigned insn_size, unsigned fbit, unsign
 }
 
 
+/* 
+  Hash of the operand type name and type, which any operand equal to
+  opl shares
+*/
+static unsigned int hash_operand(oper_list *opl)
+{
+  return (hash_mnemonic(opl->name, 0) ^ (opl->type * 16777619UL)) % OPER_HASH_SIZE;
+}
+
+/* 
+  FNV-1a hash of a mnemonic, from a seed. The same as acasm_hash_mnemonic
+  in the opcodes library, which looks the mnemonics up with it
+*/
+static unsigned long hash_mnemonic(const char *mnemonic, unsigned long seed)
+{
+  unsigned long h = (2166136261UL ^ seed) & 0xffffffffUL;
+
+  while (*mnemonic != '\0') {
+    h ^= (unsigned char) *mnemonic++;
+    h = (h * 16777619UL) & 0xffffffffUL;
+  }
+  return h;
+}
+
 /* -1 -> not found  */
 static oper_list *find_operand(oper_list *opl)
 {
-  oper_list *otmp = operand_list;
+  oper_list *otmp = oper_hash[hash_operand(opl)];
 
   while (otmp != NULL) {
     if (!strcmp(otmp->name, opl->name) &&
@@ -616,7 +769,7 @@ static oper_list *find_operand(oper_list *opl)
          otmp->format_id == opl->format_id)
       return otmp;
 
-    otmp = otmp->next;
+    otmp = otmp->hash_next;
   }
 
   return NULL;
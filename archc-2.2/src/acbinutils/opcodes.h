@@ -42,6 +42,7 @@
 extern void create_operand_list();
 extern void update_oper_list(int oper_id, unsigned int reloc_id);
 extern int CreateOpcodeTable(const char *table_filename);
+extern int CreateMnemonicHashTable(const char *hash_filename);
 extern int CreateAsmSymbolTable(const char *symtab_filename);
 extern int CreatePseudoOpsTable(const char *optable_filename);
 extern int CreateOperandTable(const char *optable_filename);
@@ -199,8 +199,21 @@ int accs_main()
     exit(EXIT_FAILURE);
   }
 
+  //Levels 4 and 5 handle control flow in the simulator, which takes
+  //instruction counts the multicore version keeps per break
+  if ((PROCESSOR_OPTIMIZATIONS > 3) && ACMulticoreFlag) {
+    PROCESSOR_OPTIMIZATIONS = 2;
+    AC_MSG("WARNING: falling down to optimization level 2 for the multicore version.\n");
+  }
+
+  //Only the multicore version keeps the resources of a core apart
+  if ((MULTICORE_CORES > 1) && !ACMulticoreFlag) {
+    MULTICORE_CORES = 1;
+    AC_MSG("WARNING: running one core, more need the multicore version.\n");
+  }
+
   //Test if the optimization required is available
-  if (PROCESSOR_OPTIMIZATIONS > ControlInstrInfoLevel) {
+  if (PROCESSOR_OPTIMIZATIONS_InfoLevel(PROCESSOR_OPTIMIZATIONS) > ControlInstrInfoLevel) {
     PROCESSOR_OPTIMIZATIONS = ControlInstrInfoLevel;
     AC_MSG("WARNING: falling down to optimization level %d due to lack of information in the model.\n", PROCESSOR_OPTIMIZATIONS);
   }
@@ -860,6 +873,9 @@ void accs_CreateCompsimHeader()
            "\n"
            );
 
+  if (MULTICORE_CORES > 1)
+    accs_EmitQuantumSync(output);
+
   fprintf( output, "typedef struct {\n");
   fprintf( output, "ac_dynlink::ac_rtld ac_dyn_loader;\n");
   fprintf( output, "} Tref;\n\n");
@@ -893,6 +909,12 @@ void accs_CreateCompsimHeader()
 	      fprintf(output, "	unsigned tmp_pc;\n");
 	      fprintf(output, "	unsigned old_pc;\n\n");
       }
+
+     if (MULTICORE_CORES > 1) {
+	      fprintf(output, "\n	//Meeting point of the cores, and when to go there next\n");
+	      fprintf(output, "	ac_quantum_sync *ac_sync;\n");
+	      fprintf(output, "	unsigned long long ac_next_sync;\n\n");
+      }
   }
 
   fprintf( output, "\n");
@@ -911,6 +933,10 @@ void accs_CreateCompsimHeader()
 
   }
 
+  if (MULTICORE_CORES > 1)
+    fprintf( output, "	    ac_sync(0),\n"
+                     "	    ac_next_sync(AC_QUANTUM),\n");
+
   fprintf( output, "	    ac_exit_status(0),\n"
 		   "	    ac_stop_flag (0), \n"
 		   "	    ac_mt_endian(0),\n"
@@ -967,6 +993,12 @@ void accs_CreateCompsimHeader()
     	fprintf(output, "	void Region%d();\n" , j, j);
       }
 
+  fprintf( output, "\n");
+  fprintf( output, "	// interpreter for the code with no case in the Regions\n");
+  fprintf( output, "	void Interpret();\n");
+  fprintf( output, "	bool ac_interp_step(unsigned ac_interp_pc, unsigned& ac_interp_next);\n");
+  fprintf( output, "	unsigned long long ac_interp_bits(unsigned ac_interp_pc, int last, int quantity, int sign);\n");
+
   fprintf( output, "\n");
 
   //Generic instruction behavior
@@ -1053,6 +1085,7 @@ void accs_CreateCompsimImpl()
   char filename[256];
   FILE *output;
   int i,j,k, next_instr, rblock;
+  int nregions, nunits, *unit_first;
   int invalid_instr_count = 0;
   int *stat_instr_used = (int *) calloc(instr_num+1, sizeof(int));
   //char *instr_mem_p;
@@ -1114,6 +1147,7 @@ void accs_CreateCompsimImpl()
               //mark the evaluated target as leader instruction (eval_result has the address)
               if (!decode_table[eval_result]) decode_table[eval_result] = (instr_decode_t *) calloc(1,sizeof(instr_decode_t));
               decode_table[eval_result]->is_leader = j;
+              decode_table[eval_result]->is_target = 1;
             }
             //mark also the next as leader
             if (!decode_table[next_instr]) decode_table[next_instr] = (instr_decode_t *) calloc(1,sizeof(instr_decode_t));
@@ -1121,6 +1155,11 @@ void accs_CreateCompsimImpl()
             //mark also the next+4 as leader   //TODO: depends on delay_slot and instr_size!
             if (!decode_table[next_instr+4]) decode_table[next_instr+4] = (instr_decode_t *) calloc(1,sizeof(instr_decode_t));
             decode_table[next_instr+4]->is_leader = j;
+            //the fall-through, after the delay slots, if it is one of them
+            {
+              int fall = next_instr + cflow->delay_slot * (next_instr - j);
+              if (fall <= next_instr + 4) decode_table[fall]->is_target = 1;
+            }
           }
         }
         //update stats
@@ -1149,8 +1188,8 @@ void accs_CreateCompsimImpl()
   AC_MSG("Application size: %u bytes, %u instructions.\n", prog_size_bytes, prog_size_instr);
 
 
-  //Load more leaders from file if file exists (for opt3 optimization)
-  if (PROCESSOR_OPTIMIZATIONS == 3) {
+  //Load more leaders from file if file exists (for opt3 optimization and up)
+  if (PROCESSOR_OPTIMIZATIONS >= 3) {
     extern char *ACCompsimProg;
     FILE *leaders;
     char filename[100];
@@ -1178,17 +1217,20 @@ void accs_CreateCompsimImpl()
 
 
   //Write in separate files, to minimize compilation overhead
-  //  select number of Regions per file with command-line option "-bs"
-  for (rblock=0; rblock <= (((prog_size_bytes-1) >> REGION_SIZE) / REGION_BLOCK_SIZE); rblock++) {
+  //  files are filled up to "-us" instructions, with at most "-bs" regions
+  nregions = ((prog_size_bytes-1) >> REGION_SIZE) + 1;
+  if (PROFILE_FILE)
+    accs_ReadProfile(nregions);
+  unit_first = (int *) malloc((nregions+1) * sizeof(int));
+  nunits = accs_PartitionRegions(nregions, unit_first);
+
+  for (rblock=0; rblock < nunits; rblock++) {
 
     // Open file
     if (rblock == 0) sprintf( filename, "%s.cpp", project_name);
     else             sprintf( filename, "%s-block%d.cpp", project_name, rblock);
 
-    if ( !(output = fopen( filename, "w"))){
-      perror("ArchC could not open output file");
-      exit(1);
-    }
+    output = accs_OpenUnit(filename);
 
 
     //!Write file header
@@ -1261,10 +1303,11 @@ void accs_CreateCompsimImpl()
 
     // @@@@@@@@@@@@@@@@@ kernel of compiled simulation @@@@@@@@@@@@@@@@@@@@@@@
 
-    for (i=rblock*REGION_BLOCK_SIZE;
-         ((i < (rblock+1)*REGION_BLOCK_SIZE) && (i <= ((prog_size_bytes-1) >> REGION_SIZE)));
-         i++) {
+    for (i=unit_first[rblock]; i < unit_first[rblock+1]; i++) {
       int end_region = (prog_size_bytes < ((i+1) << REGION_SIZE)) ? prog_size_bytes : ((i+1) << REGION_SIZE);
+
+      if (region_hot && !region_hot[i])
+        continue;
     
       // Region function start
       fprintf(output, "void %s::Region%d() {\n", project_name, i);
@@ -1308,10 +1351,9 @@ void accs_CreateCompsimImpl()
       	fprintf( output, "      old_pc = ac_pc;\n");
       if (i == EXIT_ADDRESS>>REGION_SIZE) fprintf( output, "      if (ac_pc == %d) return;\n", EXIT_ADDRESS);
       fprintf( output,
-               "      if ((ac_pc >= %d) && (ac_pc < %d)) {\n"
-               "        AC_ERROR(\"ac_pc=0x\" << hex << int(ac_pc) << \" points to an non-decoded memory location.\" << endl);\n"
-               "        stop(EXIT_FAILURE);\n"
-               "      }\n"
+               "      //no case for it here: interpret up to one\n"
+               "      if ((ac_pc >= %d) && (ac_pc < %d))\n"
+               "        Interpret();\n"
                "      return;\n"
                "    }\n"
                "  }\n"
@@ -1334,6 +1376,8 @@ void accs_CreateCompsimImpl()
               "\n"
               , REGION_SIZE);
       for (j=0; j <= ((prog_size_bytes-1) >> REGION_SIZE); j++) {
+        if (region_hot && !region_hot[j])
+          continue;
         fprintf(output,
                 "    case %d:\n"
                 "      Region%d();\n"
@@ -1344,12 +1388,23 @@ void accs_CreateCompsimImpl()
       }
       fprintf(output,
               "    default:\n"
-              "      AC_ERROR(\"ac_pc=0x\" << hex << int(ac_pc) << \" is beyond program memory.\" << std::endl);\n"
-              "      stop(EXIT_FAILURE);\n"
+              "      //code loaded out of the program, or cold, run by the interpreter\n"
+              "      Interpret();\n"
               "      break;\n"
               "    }\n"
-              "  }\n"
               );
+      if (MULTICORE_CORES > 1)
+        fprintf(output,
+                "\n"
+                "    //wait for the other cores at the end of each quantum\n"
+                "    if (ac_sync && (ac_instr_counter >= ac_next_sync)) {\n"
+                "      ac_sync->wait();\n"
+                "      ac_next_sync += AC_QUANTUM;\n"
+                "    }\n"
+                );
+      fprintf(output, "  }\n");
+      if (MULTICORE_CORES > 1)
+        fprintf(output, "  if (ac_sync) ac_sync->leave();\n");
 
       if (COUNT_SYSCALLS) {
         COUNT_SYSCALLS_EmitPrintStat(output);
@@ -1361,6 +1416,8 @@ void accs_CreateCompsimImpl()
               "\n"
               );
 
+      accs_EmitInterpreter(output);
+
 	fprintf(output, "#include <ac_sighandlers.H>\n\n");	
       	fprintf(output, "void %s::init(int ac, char **av){\n", project_name);
       	fprintf(output, "	this->ac = ac;\n");
@@ -2231,9 +2288,17 @@ fprintf( output,
 
 
     // Close file
-    fclose( output);
+    accs_CloseUnit(output, filename);
+
+  }
 
+  //Files of a bigger program built here before would be compiled in too
+  for (rblock=nunits; ; rblock++) {
+    sprintf( filename, "%s-block%d.cpp", project_name, rblock);
+    if (unlink(filename) != 0)
+      break;
   }
+  free(unit_first);
 
 
   // Free memory
@@ -2249,10 +2314,7 @@ void accs_CreateCompsimHeaderRegions()
   int i;
   FILE *output;
 
-  if ( !(output = fopen("ac_prog_regions.H", "w"))){
-    perror("ArchC could not open output file");
-    exit(1);
-  }
+  output = accs_OpenUnit("ac_prog_regions.H");
 
   print_comment( output, "ArchC Compsim header for region prototypes.");
 
@@ -2260,7 +2322,88 @@ void accs_CreateCompsimHeaderRegions()
     fprintf(output, "void Region%d();\n", i);
   }
 
-  fclose( output); 
+  accs_CloseUnit( output, "ac_prog_regions.H");
+}
+
+
+/*!Split the regions among the files of the compiled simulator: unit_first[u]
+   is the first region of file u, unit_first[nunits] is nregions. A file takes
+   regions until it holds REGION_UNIT_INSTRS decoded instructions or
+   REGION_BLOCK_SIZE regions. Returns the number of files. */
+int accs_PartitionRegions(int nregions, int *unit_first)
+{
+  int i, j, nunits = 0, unit_instrs = 0, unit_regions = 0;
+
+  unit_first[0] = 0;
+  for (i=0; i < nregions; i++) {
+    int end_region = (prog_size_bytes < ((i+1) << REGION_SIZE)) ? prog_size_bytes : ((i+1) << REGION_SIZE);
+    int region_instrs = 0;
+
+    //Regions left to the interpreter take no room in the files
+    if (region_hot && !region_hot[i])
+      continue;
+    for (j = (i << REGION_SIZE); j < end_region; j++)
+      if ((decode_table[j]) && (decode_table[j]->dec_vector))
+        region_instrs++;
+
+    if ((unit_regions > 0) &&
+        ((unit_instrs + region_instrs > REGION_UNIT_INSTRS) || (unit_regions == REGION_BLOCK_SIZE))) {
+      unit_first[++nunits] = i;
+      unit_instrs = 0;
+      unit_regions = 0;
+    }
+    unit_instrs += region_instrs;
+    unit_regions++;
+  }
+  unit_first[++nunits] = nregions;
+  return nunits;
+}
+
+
+/*!Open a generated file to be written aside; accs_CloseUnit only puts it in
+   place if it differs from the one there, so make leaves its object alone. */
+FILE *accs_OpenUnit(char *filename)
+{
+  char tmpname[264];
+  FILE *output;
+
+  sprintf( tmpname, "%s.new", filename);
+  if ( !(output = fopen( tmpname, "w+"))){
+    perror("ArchC could not open output file");
+    exit(1);
+  }
+  return output;
+}
+
+
+void accs_CloseUnit(FILE *output, char *filename)
+{
+  char tmpname[264], newbuf[4096], oldbuf[4096];
+  FILE *old;
+  size_t n;
+  int same = 0;
+
+  sprintf( tmpname, "%s.new", filename);
+  fflush( output);
+
+  if ((old = fopen( filename, "r"))) {
+    rewind( output);
+    same = 1;
+    do {
+      n = fread( newbuf, 1, sizeof(newbuf), output);
+      if ((fread( oldbuf, 1, sizeof(oldbuf), old) != n) || memcmp( newbuf, oldbuf, n))
+        same = 0;
+    } while (same && (n == sizeof(newbuf)));
+    fclose( old);
+  }
+  fclose( output);
+
+  if (same)
+    unlink( tmpname);
+  else if (rename( tmpname, filename) != 0) {
+    perror("ArchC could not write output file");
+    exit(1);
+  }
 }
 
 
@@ -3454,6 +3597,12 @@ void accs_CreateMain()
     fprintf(output, "ac_stats ac_sim_stats;\n\n");
   }
 
+  if (MULTICORE_CORES > 1) {
+    accs_CreateMainCores(output);
+    fclose( output);
+    return;
+  }
+
   fprintf(output,
           "int sc_main(int ac, char *av[])\n"
           "{\n"
@@ -3509,6 +3658,91 @@ void accs_CreateMain()
 }
 
 
+/*!Emit the sc_main of the multicore version with more than one core. Each
+   core gets a copy of the program and runs it on its own host thread. */
+void accs_CreateMainCores(FILE *output)
+{
+  extern char *project_name;
+  extern char *ACCompsimProg;
+  extern int ACStatsFlag;
+  int i;
+
+  fprintf(output,
+          "//!Runs a core to the end of its program\n"
+          "static void *ac_run_core(void *core)\n"
+          "{\n"
+          "  ((%s *) core)->start();\n"
+          "  return 0;\n"
+          "}\n"
+          "\n"
+          "int sc_main(int ac, char *av[])\n"
+          "{\n", project_name);
+
+  for (i = 1; i <= MULTICORE_CORES; i++)
+    fprintf(output, "  %s %s_proc%d;\n", project_name, project_name, i);
+  fprintf(output, "  %s *ac_cores[%d] = {", project_name, MULTICORE_CORES);
+  for (i = 1; i <= MULTICORE_CORES; i++)
+    fprintf(output, "%s&%s_proc%d", (i > 1) ? ", " : " ", project_name, i);
+  fprintf(output, " };\n");
+
+  fprintf(output,
+          "  pthread_t ac_threads[%d];\n"
+          "  ac_quantum_sync ac_sync(%d);\n"
+          "  int i;\n"
+          "\n"
+          "  for (i = 0; i < %d; i++) {\n"
+          "    ac_cores[i]->appfilename = \"%s\";\n"
+          "    ac_cores[i]->ac_heap_ptr = 0x%x;\n"
+          "    ac_cores[i]->ac_start_addr = 0x%x;\n"
+          "    ac_cores[i]->%s.load_array(mem_dump, 0x%x);\n"
+          "    ac_cores[i]->ac_sync = &ac_sync;\n"
+          "  }\n"
+          "\n"
+          "#ifdef AC_DEBUG\n"
+          "  ac_trace(\"%s.trace\");\n"
+          "#endif\n"
+          "\n"
+          "  for (i = 0; i < %d; i++)\n"
+          "    ac_cores[i]->init(ac, av);\n"
+          "\n"
+          "  for (i = 0; i < %d; i++)\n"
+          "    if (pthread_create(&ac_threads[i], 0, ac_run_core, ac_cores[i]) != 0) {\n"
+          "      AC_ERROR(\"could not start a thread for core \" << i+1 << std::endl);\n"
+          "      exit(EXIT_FAILURE);\n"
+          "    }\n"
+          "  for (i = 0; i < %d; i++)\n"
+          "    pthread_join(ac_threads[i], 0);\n"
+          "\n"
+          "  for (i = 0; i < %d; i++) {\n"
+          "    std::cerr << std::endl << \"ArchC: core \" << i+1 << std::endl;\n"
+          "    ac_cores[i]->PrintStat();\n"
+          "  }\n"
+          "  std::cerr << std::endl;\n"
+          "\n"
+          , MULTICORE_CORES, MULTICORE_CORES, MULTICORE_CORES,
+          ACCompsimProg, ac_heap_ptr, ac_start_addr,
+          (accs_FindLoadDevice())->name, ac_heap_ptr, project_name,
+          MULTICORE_CORES, MULTICORE_CORES, MULTICORE_CORES, MULTICORE_CORES);
+
+  if (ACStatsFlag)
+    fprintf(output,
+            "#ifdef AC_STATS\n"
+            "  ac_sim_stats.time = 0;\n"
+            "  ac_sim_stats.print();\n"
+            "#endif \n"
+            "\n");
+
+  fprintf(output,
+          "#ifdef AC_DEBUG\n"
+          "  ac_close_trace();\n"
+          "#endif\n"
+          "\n"
+          "  return %s_proc1.ac_exit_status;\n"
+          "};\n", project_name
+          );
+}
+
+
 /*!Create ArchC ISA Header File */
 /*!Use structures built by the parser.*/
 void accs_CreateISAHeader()
@@ -3852,6 +4086,349 @@ void accs_EmitInstrExtraBottom(FILE* output, int j, ac_dec_instr *pinstr, int in
 }
 
 
+/*! Emit the barrier the cores of the multicore version meet at every
+    AC_QUANTUM instructions, so that none of them runs far ahead */
+void accs_EmitQuantumSync(FILE* output)
+{
+  fprintf( output,
+           "#include <pthread.h>\n"
+           "\n"
+           "//Instructions a core runs between two meetings with the others\n"
+           "#ifndef AC_QUANTUM\n"
+           "#define AC_QUANTUM 100000\n"
+           "#endif\n"
+           "\n"
+           "class ac_quantum_sync {\n"
+           "  pthread_mutex_t lock;\n"
+           "  pthread_cond_t done;\n"
+           "  unsigned running, arrived, quantum;\n"
+           "\n"
+           "  //Called with lock held, once every running core arrived\n"
+           "  void release() {\n"
+           "    arrived = 0;\n"
+           "    quantum++;\n"
+           "    pthread_cond_broadcast(&done);\n"
+           "  }\n"
+           "\n"
+           "public:\n"
+           "  ac_quantum_sync(unsigned cores) : running(cores), arrived(0), quantum(0) {\n"
+           "    pthread_mutex_init(&lock, 0);\n"
+           "    pthread_cond_init(&done, 0);\n"
+           "  }\n"
+           "\n"
+           "  ~ac_quantum_sync() {\n"
+           "    pthread_cond_destroy(&done);\n"
+           "    pthread_mutex_destroy(&lock);\n"
+           "  }\n"
+           "\n"
+           "  //Waits until the other running cores end this quantum too\n"
+           "  void wait() {\n"
+           "    pthread_mutex_lock(&lock);\n"
+           "    unsigned mine = quantum;\n"
+           "    if (++arrived == running)\n"
+           "      release();\n"
+           "    else\n"
+           "      while (mine == quantum)\n"
+           "        pthread_cond_wait(&done, &lock);\n"
+           "    pthread_mutex_unlock(&lock);\n"
+           "  }\n"
+           "\n"
+           "  //A core that stopped is not waited for anymore\n"
+           "  void leave() {\n"
+           "    pthread_mutex_lock(&lock);\n"
+           "    running--;\n"
+           "    if (arrived && (arrived == running))\n"
+           "      release();\n"
+           "    pthread_mutex_unlock(&lock);\n"
+           "  }\n"
+           "};\n"
+           "\n");
+}
+
+
+/*! Emit the bitmap of the addresses that have a case in a Region function,
+    the ones the interpreter hands control back to the compiled code at */
+void accs_EmitCompiledEntries(FILE* output)
+{
+  int nbytes = (prog_size_bytes + 7) / 8;
+  unsigned char *entries = (unsigned char *) calloc(nbytes + 1, 1);
+  unsigned next_region = 0;
+  int syscalls_end = 0;
+  int j;
+
+#define AC_SYSC(NAME,LOCATION) \
+  if (syscalls_end < LOCATION + 1) syscalls_end = LOCATION + 1; \
+  if ((ACABIFlag) && (LOCATION < prog_size_bytes)) entries[LOCATION >> 3] |= 1 << (LOCATION & 7);
+#include "ac_syscall.def"
+#undef AC_SYSC
+
+  //Same rules the Region functions follow to emit the cases
+  for (j = 0; j < prog_size_bytes; j++) {
+    if ((ACABIFlag) && (j >= 60) && (j < syscalls_end))
+      continue;
+    if (!(decode_table[j]) || !(decode_table[j]->dec_vector))
+      continue;
+    if (region_hot && !region_hot[j >> REGION_SIZE])
+      continue;
+    if ((PROCESSOR_OPTIMIZATIONS < 3) || (decode_table[j]->is_leader) || (j >= next_region))
+      entries[j >> 3] |= 1 << (j & 7);
+    if (j >= next_region)
+      next_region = ((j >> REGION_SIZE) + 1) << REGION_SIZE;
+  }
+
+  fprintf( output, "//!Addresses the compiled code can be entered at, one bit each\n");
+  fprintf( output, "static const unsigned char ac_compiled_entry[%d] = {", nbytes + 1);
+  for (j = 0; j <= nbytes; j++)
+    fprintf( output, "%s0x%02x", (j % 16) ? ", " : (j ? ",\n  " : "\n  "), entries[j]);
+  fprintf( output, "\n};\n\n");
+
+  free(entries);
+}
+
+
+/*! Read the execution profile PROFILE_FILE of the interpreted simulator and
+    flag in region_hot the regions to compile: the fewest that run
+    PROFILE_COVERAGE percent of its instructions, with the ones holding the
+    system call addresses and the exit address, which the interpreter does
+    not run. The profile is a memory heatmap (its pages, with the fetches
+    of each in the second column), or lines of an address and a count,
+    of an instruction or of the first one of a block. Lines starting with
+    # are comments; the first one after the pages ends a heatmap. */
+void accs_ReadProfile(int nregions)
+{
+  double *counts = (double *) calloc(nregions, sizeof(double));
+  int *order = (int *) malloc(nregions * sizeof(int));
+  unsigned page_size = 0, address;
+  double count, total = 0, covered = 0;
+  int i, j, nhot = 0, have_data = 0, syscalls_end = 0;
+  char line[512], *p;
+  FILE *profile;
+
+  if (!(profile = fopen(PROFILE_FILE, "r"))) {
+    AC_ERROR("Could not open profile file: %s\n", PROFILE_FILE);
+    exit(EXIT_FAILURE);
+  }
+  while (fgets(line, sizeof(line), profile)) {
+    if (line[0] == '#') {
+      if (have_data)
+        break;
+      if ((p = strstr(line, "pages of ")))
+        page_size = strtoul(p + 9, 0, 10);
+      continue;
+    }
+    address = strtoul(line, &p, 0);
+    count = strtod(p, &p);
+    if (p == line)
+      continue;
+    have_data = 1;
+    //A heatmap page covering several regions gives each an even share
+    if (page_size > (1U << REGION_SIZE)) {
+      unsigned n = page_size >> REGION_SIZE;
+      for (i = 0; i < n; i++)
+        if (((address >> REGION_SIZE) + i) < nregions)
+          counts[(address >> REGION_SIZE) + i] += count / n;
+    }
+    else if ((address >> REGION_SIZE) < nregions)
+      counts[address >> REGION_SIZE] += count;
+  }
+  fclose(profile);
+
+  region_hot = (char *) calloc(nregions, 1);
+  for (i = 0; i < nregions; i++) {
+    total += counts[i];
+    order[i] = i;
+  }
+  //Hottest first (the programs have a few thousand regions at most)
+  for (i = 1; i < nregions; i++)
+    for (j = i; (j > 0) && (counts[order[j]] > counts[order[j-1]]); j--) {
+      int t = order[j];
+      order[j] = order[j-1];
+      order[j-1] = t;
+    }
+  for (i = 0; (i < nregions) && (counts[order[i]] > 0) &&
+              (covered < total * PROFILE_COVERAGE / 100); i++) {
+    region_hot[order[i]] = 1;
+    covered += counts[order[i]];
+  }
+
+#define AC_SYSC(NAME,LOCATION) \
+  if (syscalls_end < LOCATION + 1) syscalls_end = LOCATION + 1;
+#include "ac_syscall.def"
+#undef AC_SYSC
+  if (ACABIFlag)
+    for (i = 60 >> REGION_SIZE; (i <= ((syscalls_end - 1) >> REGION_SIZE)) && (i < nregions); i++)
+      region_hot[i] = 1;
+  if ((EXIT_ADDRESS >> REGION_SIZE) < nregions)
+    region_hot[EXIT_ADDRESS >> REGION_SIZE] = 1;
+
+  for (i = 0; i < nregions; i++)
+    nhot += region_hot[i];
+  AC_MSG("Profile %s: compiling %d of %d regions, running %.1f%% of its instructions.\n",
+         PROFILE_FILE, nhot, nregions, total ? 100.0 * covered / total : 0.0);
+  if (!total)
+    AC_MSG("WARNING: the profile counts no instruction of the program.\n");
+
+  free(counts);
+  free(order);
+}
+
+
+/*! Emit the code the interpreter runs for one instruction found at
+    ac_interp_pc, leaving where it goes in ac_interp_next */
+static void accs_EmitInterpInstr(FILE* output, ac_dec_instr *pinstr)
+{
+  extern ac_dec_field *common_instr_field_list;
+  ac_dec_field *pfield = FindFormat(decoder->formats, pinstr->format)->fields;
+  ac_control_flow *cflow = pinstr->cflow;
+  ac_dec_list *pdec;
+  char *args = (char *) malloc(500);
+  char *p_args = args;
+
+  for (*args = '\0'; pfield != NULL; pfield = pfield->next)
+    p_args += sprintf( p_args, "%s%s", (p_args == args) ? "" : ", ", pfield->name);
+
+  fprintf( output, "  //instr: %s\n  if (1", pinstr->name);
+  for (pdec = pinstr->dec_list; pdec != NULL; pdec = pdec->next) {
+    for (pfield = FindFormat(decoder->formats, pinstr->format)->fields;
+         (pfield != NULL) && strcmp(pfield->name, pdec->name); pfield = pfield->next);
+    if (pfield)
+      fprintf( output, " && (ac_interp_bits(ac_interp_pc, %d, %d, 0) == %#x)",
+               pfield->first_bit, pfield->size, pdec->value);
+  }
+  fprintf( output, ") {\n");
+
+  for (pfield = FindFormat(decoder->formats, pinstr->format)->fields; pfield != NULL; pfield = pfield->next)
+    fprintf( output, "    %s %s = ac_interp_bits(ac_interp_pc, %d, %d, %d);\n",
+             (pfield->sign) ? "int" : "unsigned", pfield->name,
+             pfield->first_bit, pfield->size, pfield->sign);
+
+  accs_EmitInstrExtraTop(output, 0, pinstr, 4);
+
+  //Control instructions at the levels 2, 4 and 5 do what the cases do
+  if ((PROCESSOR_OPTIMIZATIONS_SimControl()) && (cflow)) {
+    fprintf( output, "    if (%s) {\n", cflow->cond);
+    fprintf( output, "      ac_interp_next = %s;\n", cflow->target);
+    if ((cflow->action) && (cflow->action[0]))
+      fprintf( output, "      %s\n", cflow->action);
+    fprintf( output, "    }\n");
+    fprintf( output, "    else\n");
+    fprintf( output, "      ac_interp_next = ac_interp_pc + %d;\n", pinstr->size * (1 + cflow->delay_slot));
+    accs_EmitInstrExtraBottom(output, 0, pinstr, 4);
+    if (cflow->delay_slot) {
+      fprintf( output,
+               "    unsigned ac_interp_slot;\n"
+               "    if ((%s) && !ac_interp_step(ac_interp_pc + %d, ac_interp_slot)) {\n"
+               "      AC_ERROR(\"Delay slot at ac_pc=0x\" << hex << ac_interp_pc + %d << \" does not decode.\" << endl);\n"
+               "      stop(EXIT_FAILURE);\n"
+               "    }\n"
+               , cflow->delay_slot_cond, pinstr->size, pinstr->size);
+    }
+  }
+  else {
+    fprintf( output, "    ac_behavior_instruction(%d", pinstr->size * 8);
+    for (pfield = common_instr_field_list; pfield != NULL; pfield = pfield->next)
+      fprintf( output, ", %s", pfield->name);
+    fprintf( output, ");\n");
+    if (ACAnnulSigFlag)
+      fprintf( output, "    if (!ac_annul_sig) {\n");
+    fprintf( output, "    ac_behavior_%s(%d, %s);\n", pinstr->format, pinstr->size * 8, args);
+    fprintf( output, "    ac_behavior_%s(%d, %s);\n", pinstr->name, pinstr->size * 8, args);
+    if (ACAnnulSigFlag)
+      fprintf( output, "    } else\n    ac_annul_sig = 0;\n");
+    accs_EmitInstrExtraBottom(output, 0, pinstr, 4);
+    if (PROCESSOR_OPTIMIZATIONS_SimControl())
+      fprintf( output, "    ac_interp_next = ac_interp_pc + %d;\n", pinstr->size);
+    else
+      fprintf( output, "    ac_interp_next = ac_pc;\n");
+  }
+
+  fprintf( output, "    return true;\n  }\n\n");
+  free(args);
+}
+
+
+/*! Emit the interpreter the compiled code falls back to for the code it
+    has no case for: code out of the program, like the dynamic libraries,
+    and, from level 3 on, arbitrary targets of indirect jumps. It runs the
+    behaviors one instruction at a time and goes back to the compiled code
+    at the first address with a case. */
+void accs_EmitInterpreter(FILE* output)
+{
+  extern int wordsize;
+  extern int ac_tgt_endian;
+  ac_dec_instr *pinstr;
+  int wordbytes = wordsize / 8;
+
+  accs_EmitCompiledEntries(output);
+
+  fprintf( output,
+           "//!Bits of the instruction in ac_interp_pc, taken like the decoder does\n"
+           "unsigned long long %s::ac_interp_bits(unsigned ac_interp_pc, int last, int quantity, int sign) {\n"
+           "  int first = last - (quantity-1);\n"
+           "  unsigned long long value = 0;\n"
+           "  int i, k;\n"
+           "\n", project_name);
+  if (ac_tgt_endian == 1)
+    fprintf( output,
+             "  for (i = first/%d; i <= last/%d; i++) {\n"
+             "    unsigned long long word = 0;\n"
+             "    for (k = 0; k < %d; k++)\n"
+             "      word = (word << 8) | %s.read_byte(ac_interp_pc + i*%d + k);\n"
+             "    value = (value << %d) | word;\n"
+             "  }\n"
+             "  value >>= %d - (last%%%d + 1);\n"
+             , wordsize, wordsize, wordbytes, accs_FindLoadDevice()->name, wordbytes,
+             wordsize, wordsize, wordsize);
+  else
+    fprintf( output,
+             "  for (i = last/%d; i >= first/%d; i--) {\n"
+             "    unsigned long long word = 0;\n"
+             "    for (k = %d; k >= 0; k--)\n"
+             "      word = (word << 8) | %s.read_byte(ac_interp_pc + i*%d + k);\n"
+             "    value = (value << %d) | word;\n"
+             "  }\n"
+             "  value >>= first%%%d;\n"
+             , wordsize, wordsize, wordbytes - 1, accs_FindLoadDevice()->name, wordbytes,
+             wordsize, wordsize);
+  fprintf( output,
+           "  value &= ~((~0ULL) << quantity);\n"
+           "  if (sign && ((value >> (quantity-1)) & 1))\n"
+           "    value |= (~0ULL) << quantity;\n"
+           "  return value;\n"
+           "}\n"
+           "\n\n");
+
+  fprintf( output,
+           "//!Runs the instruction in ac_interp_pc, leaving where it goes in\n"
+           "//!ac_interp_next. Returns false if it does not decode.\n"
+           "bool %s::ac_interp_step(unsigned ac_interp_pc, unsigned& ac_interp_next) {\n"
+           "\n", project_name);
+  for (pinstr = decoder->instructions; pinstr != NULL; pinstr = pinstr->next)
+    accs_EmitInterpInstr(output, pinstr);
+  fprintf( output,
+           "  return false;\n"
+           "}\n"
+           "\n\n");
+
+  fprintf( output,
+           "//!Interprets from ac_pc until an address the compiled code has a case for\n"
+           "void %s::Interpret() {\n"
+           "  unsigned ac_interp_next;\n"
+           "\n"
+           "  do {\n"
+           "    if (!ac_interp_step(ac_pc, ac_interp_next)) {\n"
+           "      AC_ERROR(\"ac_pc=0x\" << hex << int(ac_pc) << \" points to an non-decoded memory location.\" << endl);\n"
+           "      stop(EXIT_FAILURE);\n"
+           "      return;\n"
+           "    }\n"
+           "    ac_pc = ac_interp_next;\n"
+           "  } while (!ac_stop_flag &&\n"
+           "           !((ac_pc < %d) && (ac_compiled_entry[ac_pc >> 3] & (1 << (ac_pc & 7)))));\n"
+           "}\n"
+           "\n\n", project_name, prog_size_bytes);
+}
+
+
 void accs_EmitMakefileExtra(FILE* output)
 {
   extern int ACP4Flag, ACOmitFPFlag, ACInlineFlag, ACCompsimFlag;
@@ -3862,13 +4439,39 @@ void accs_EmitMakefileExtra(FILE* output)
   fprintf( output, "\n");
 
   fprintf( output, "INLINE := %d\n", (ACInlineFlag?1:0));
-  fprintf( output, "ISA_AND_SYSCALL_TOGETHER := %d\n", (ACInlineFlag || PROCESSOR_OPTIMIZATIONS == 2)? 1 : 0);
-  if (PROCESSOR_OPTIMIZATIONS==2)
+  fprintf( output, "ISA_AND_SYSCALL_TOGETHER := %d\n", (ACInlineFlag || PROCESSOR_OPTIMIZATIONS_SimControl())? 1 : 0);
+  if (PROCESSOR_OPTIMIZATIONS_SimControl())
   	fprintf( output, "CFLAGS := $(CFLAGS) $(if $(filter 1,$(INLINE)),-O3 -finline-functions -fgcse) $(if $(filter 1,$(ISA_AND_SYSCALL_TOGETHER)), -DAC_INLINE) ");
   else	
   	fprintf( output, "CFLAGS := $(CFLAGS) $(if $(filter 1,$(INLINE)),-O -finline-functions -fgcse) $(if $(filter 1,$(ISA_AND_SYSCALL_TOGETHER)), -DAC_INLINE) ");
   if (ACCompsimFlag) fprintf( output, "-DAC_COMPSIM");
   fprintf( output, "\n\n");
+
+  if (MULTICORE_CORES > 1)
+    fprintf( output, "CFLAGS := $(CFLAGS) -pthread\n"
+                     "LIBS := $(LIBS) -lpthread\n\n");
+
+  //The files of the regions are looked up in the cache by a hash of the
+  //compiler, its flags and the preprocessed file, which holds every
+  //header it depends on and no path of the build. Objects get in and out
+  //of the cache by a copy to a file of their own and a rename, so builds
+  //sharing it never see half an object.
+  fprintf( output, "# Directory of the objects of the region files, shared by builds\n");
+  fprintf( output, "AC_OBJ_CACHE ?= %s\n", OBJECT_CACHE ? OBJECT_CACHE : "");
+  fprintf( output, "AC_OBJ_HASH ?= md5sum\n\n");
+  fprintf( output, "ifneq ($(AC_OBJ_CACHE),)\n");
+  fprintf( output, "$(MODULE)-block%%.o: $(MODULE)-block%%.cpp\n");
+  fprintf( output, "\t@key=`{ echo '$(CFLAGS)'; $(CC) --version; $(CC) $(CFLAGS) $(INC_DIR) -E -P $<; } | $(AC_OBJ_HASH) | cut -d' ' -f1` && \\\n");
+  fprintf( output, "\tobj=$(AC_OBJ_CACHE)/$(MODULE)-$$key.o && \\\n");
+  fprintf( output, "\tif cp $$obj $@.$$$$ 2>/dev/null; then \\\n");
+  fprintf( output, "\t  mv -f $@.$$$$ $@ && echo \"$@: from $(AC_OBJ_CACHE)\"; \\\n");
+  fprintf( output, "\telse \\\n");
+  fprintf( output, "\t  rm -f $@.$$$$; \\\n");
+  fprintf( output, "\t  echo \"$(CC) $(CFLAGS) $(INC_DIR) -c $<\" && \\\n");
+  fprintf( output, "\t  $(CC) $(CFLAGS) $(INC_DIR) -c $< && \\\n");
+  fprintf( output, "\t  { mkdir -p $(AC_OBJ_CACHE) && cp $@ $$obj.$$$$ && mv -f $$obj.$$$$ $$obj || rm -f $$obj.$$$$; }; \\\n");
+  fprintf( output, "\tfi\n");
+  fprintf( output, "endif\n\n");
 }
 
 
@@ -3876,7 +4479,7 @@ void accs_EmitParmsExtra(FILE* output)
 {
   if( PROCESSOR_OPTIMIZATIONS != 0 )
     fprintf( output, "#define  OPT%d \t //!< Indicates what optimization is used for compiled simulation.\n", PROCESSOR_OPTIMIZATIONS);
-  if( PROCESSOR_OPTIMIZATIONS == 2 )
+  if( PROCESSOR_OPTIMIZATIONS_SimControl() )
     fprintf( output, "#define  NO_NEED_PC_UPDATE \t //!< Indicates that simulator takes care of control flow\n", PROCESSOR_OPTIMIZATIONS);
 }
 
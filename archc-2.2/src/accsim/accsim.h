@@ -34,6 +34,7 @@ extern int compsim;     //!< flag compiled simulation?
 typedef struct {
   unsigned *dec_vector;
   int is_leader;
+  int is_target;    //!< Where a control instruction goes or falls through to
 } instr_decode_t;
 
 instr_decode_t **decode_table;      //!< Decoded program table
@@ -54,6 +55,9 @@ void accs_CreateMain();
 void accs_CreateCompsimHeader();
 void accs_CreateCompsimImpl();
 void accs_CreateCompsimHeaderRegions();
+int  accs_PartitionRegions(int nregions, int *unit_first);
+FILE *accs_OpenUnit(char *filename);
+void accs_CloseUnit(FILE *output, char *filename);
 
 void accs_CreateStorageHeader();
 void accs_CreateStorageImpl();
@@ -129,8 +133,13 @@ void accs_EmitInstr(FILE* output, int j);
 void accs_EmitInstrBehavior(FILE* output, int j, ac_dec_instr *pinstr, int indent);
 void accs_EmitInstrExtraTop(FILE* output, int j, ac_dec_instr *pinstr, int indent);
 void accs_EmitInstrExtraBottom(FILE* output, int j, ac_dec_instr *pinstr, int indent);
+void accs_EmitQuantumSync(FILE* output);
+void accs_CreateMainCores(FILE *output);
 void accs_EmitMakefileExtra(FILE* output);
 void accs_EmitParmsExtra(FILE* output);
+void accs_EmitCompiledEntries(FILE* output);
+void accs_EmitInterpreter(FILE* output);
+void accs_ReadProfile(int nregions);
 
 
 #endif /*_ACCS_H_*/
@@ -36,6 +36,24 @@ int PROCESSOR_OPTIMIZATIONS=0;
 /* #endif */
 int REGION_BLOCK_SIZE=300;
 
+//Decoded instructions a file is filled up to, so that a big program is
+//compiled in parallel and a change to it rebuilds only its own files
+int REGION_UNIT_INSTRS=4000;
+
+//Cores of the multicore version, each run on its own host thread
+int MULTICORE_CORES=1;
+
+//Directory of the objects of compiled files, shared by builds, NULL if none
+char *OBJECT_CACHE=0;
+
+//Execution profile of the interpreted simulator, NULL to compile every
+//region, and the percent of its instructions the compiled regions run
+char *PROFILE_FILE=0;
+int PROFILE_COVERAGE=99;
+
+//Regions compiled, one flag each, NULL if all are; the interpreter runs the others
+char *region_hot=0;
+
 #ifndef EXIT_ADDRESS
 #define EXIT_ADDRESS 0x64
 #endif
@@ -125,6 +143,43 @@ void PROCESSOR_OPTIMIZATIONS_EmitInstr_2(FILE *output, int j);
 void PROCESSOR_OPTIMIZATIONS_EmitInstr_3(FILE *output, int j);
 void PROCESSOR_OPTIMIZATIONS_EmitInstr_4(FILE *output, int j);
 void PROCESSOR_OPTIMIZATIONS_EmitInstr_5(FILE *output, int j);
+void PROCESSOR_OPTIMIZATIONS_EmitLeader(FILE *output, int j);
+void PROCESSOR_OPTIMIZATIONS_EmitControl(FILE *output, int j, ac_dec_instr *pinstr, int chain);
+
+
+//Control flow information the model must give for each level
+int PROCESSOR_OPTIMIZATIONS_InfoLevel(int level)
+{
+  if (level == 3) return 1;
+  return (level > 2) ? 2 : level;
+}
+
+
+//Levels where the simulator, not the model, updates ac_pc
+int PROCESSOR_OPTIMIZATIONS_SimControl()
+{
+  return (PROCESSOR_OPTIMIZATIONS == 2) || (PROCESSOR_OPTIMIZATIONS >= 4);
+}
+
+
+//Whether the code of the instruction in addr has a label a control
+//instruction in j can jump to: one in the same region, not taken by the
+//reserved system call addresses
+int PROCESSOR_OPTIMIZATIONS_HasLabel(unsigned addr, int j)
+{
+  int syscalls_end = 0;
+
+#define AC_SYSC(NAME,LOCATION) if (syscalls_end < LOCATION + 1) syscalls_end = LOCATION + 1;
+#include "ac_syscall.def"
+#undef AC_SYSC
+
+  if ((addr >= prog_size_bytes) || ((addr >> REGION_SIZE) != (j >> REGION_SIZE)))
+    return 0;
+  if ((ACABIFlag) && (addr >= 60) && (addr < syscalls_end))
+    return 0;
+  return (decode_table[addr]) && (decode_table[addr]->dec_vector) &&
+    (decode_table[addr]->is_target);
+}
 
 
 void PROCESSOR_OPTIMIZATIONS_EmitInstr(FILE *output, int j)
@@ -151,6 +206,21 @@ void PROCESSOR_OPTIMIZATIONS_EmitInstr(FILE *output, int j)
     PROCESSOR_OPTIMIZATIONS_EmitInstr_3(output, j);
     break;
 
+  case 4:
+    //Optimization 4:
+    //  - detect leaders: label only the leaders, so that the host compiler
+    //    sees whole basic blocks and keeps guest registers in host ones
+    //  - detect control: generate special code, no ac_pc updates in between
+    PROCESSOR_OPTIMIZATIONS_EmitInstr_4(output, j);
+    break;
+
+  case 5:
+    //Optimization 5:
+    //  - optimization 4, plus control instructions with a known target in
+    //    the same region jump straight to it instead of through the switch
+    PROCESSOR_OPTIMIZATIONS_EmitInstr_5(output, j);
+    break;
+
   default:
     AC_ERROR("Processor optimization selection not found.\n");
   }
@@ -171,80 +241,95 @@ void PROCESSOR_OPTIMIZATIONS_EmitInstr_1(FILE *output, int j)
 
 void PROCESSOR_OPTIMIZATIONS_EmitInstr_2(FILE *output, int j)
 {
-  int instr_index;
   ac_dec_instr *pinstr = GetInstrByID(decoder->instructions, decode_table[j]->dec_vector[0]);
-  ac_control_flow *cflow = pinstr->cflow;
-  int jump_instr_size = pinstr->size;
 
-  if (!cflow) {
-    fprintf( output, "    case 0x%x:\n", j);
+  fprintf( output, "    case 0x%x:\n", j);
+  if (!pinstr->cflow) {
     accs_EmitInstrExtraTop(output, j, pinstr, 6);
     accs_EmitInstrBehavior(output, j, pinstr, 6);
     accs_EmitInstrExtraBottom(output, j, pinstr, 6);
     PROCESSOR_OPTIMIZATIONS_PutBreakOrNot(output, pinstr, j);
     fprintf( output, "\n");
   }
-  else {
-    fprintf( output, "    case 0x%x:\n", j);
-    fprintf( output, "      //instr: %s, delay=%d (%s)\n", pinstr->name,
-             cflow->delay_slot, cflow->delay_slot_cond);
+  else
+    PROCESSOR_OPTIMIZATIONS_EmitControl(output, j, pinstr, 0);
+}
 
-    accs_EmitInstrExtraTop(output, j, pinstr, 6);
-    fprintf( output, "      if (%s) {\n", accs_SubstFields(cflow->cond, j));
-    fprintf( output, "        tmp_pc = %s;\n", accs_SubstFields(cflow->target, j));
-    if ((cflow->action) && (cflow->action[0]))
-      fprintf( output, "        %s\n", accs_SubstFields(cflow->action, j));
-    fprintf( output, "      }\n");
-    fprintf( output, "      else {\n");
-    fprintf( output, "        tmp_pc = %#x;\n", j + pinstr->size + (cflow->delay_slot * pinstr->size));
-    fprintf( output, "      }\n");
- 
-    if (ACMulticoreFlag == 1)
-	    fprintf( output, "      ac_instr_counter += (0x%x-old_pc)/4 + 1;\n",j);
-    	
-    accs_EmitInstrExtraBottom(output, j, pinstr, 6);
-  
-    //Check for delay slot and execute it too
-    pinstr = ((decode_table[j+jump_instr_size]) && (decode_table[j+jump_instr_size]->dec_vector)) ?
-      GetInstrByID(decoder->instructions, decode_table[j+jump_instr_size]->dec_vector[0]) :
-      0;
-
-    if (cflow->delay_slot) {
-
-      //If delay slot instruction is decoded
-      if (pinstr) {
-        char *args = accs_Fields2Str(decode_table[j+jump_instr_size]);
-        fprintf( output, "      if (%s) {\n", accs_SubstFields(cflow->delay_slot_cond, j));
-        accs_EmitInstrExtraTop(output, j+jump_instr_size, pinstr, 8);
-        accs_EmitInstrBehavior(output, j+jump_instr_size, pinstr, 8);
-
-	if (ACMulticoreFlag == 1)
-		fprintf( output, "        ac_instr_counter++;\n");
-
-        accs_EmitInstrExtraBottom(output, j+jump_instr_size, pinstr, 8);
-        fprintf( output, "      }\n");
-      }
-      else {
-        fprintf( output, "      fprintf(stderr, \"Instruction at ac_pc=%#x reached but not decoded.\\n\");\n", j+jump_instr_size);
-        fprintf( output, "      ac_stop(1);\n");
-      }
-    }
 
-    fprintf( output, "      ac_pc = tmp_pc;\n");
-    if (ACMulticoreFlag == 1)
-	    fprintf( output, "      old_pc = ac_pc;\n");
-    fprintf( output, "      break;\n");
+//Control instruction, with its delay slots, ending with ac_pc set to where
+//it goes. With chain, known targets in the region are jumped to directly.
+void PROCESSOR_OPTIMIZATIONS_EmitControl(FILE *output, int j, ac_dec_instr *pinstr, int chain)
+{
+  ac_control_flow *cflow = pinstr->cflow;
+  int jump_instr_size = pinstr->size;
+  int fall = j + pinstr->size + (cflow->delay_slot * pinstr->size);
 
-    fprintf( output, "\n");
+  fprintf( output, "      //instr: %s, delay=%d (%s)\n", pinstr->name,
+           cflow->delay_slot, cflow->delay_slot_cond);
+
+  accs_EmitInstrExtraTop(output, j, pinstr, 6);
+  fprintf( output, "      if (%s) {\n", accs_SubstFields(cflow->cond, j));
+  fprintf( output, "        tmp_pc = %s;\n", accs_SubstFields(cflow->target, j));
+  if ((cflow->action) && (cflow->action[0]))
+    fprintf( output, "        %s\n", accs_SubstFields(cflow->action, j));
+  fprintf( output, "      }\n");
+  fprintf( output, "      else {\n");
+  fprintf( output, "        tmp_pc = %#x;\n", fall);
+  fprintf( output, "      }\n");
+
+  if (ACMulticoreFlag == 1)
+    fprintf( output, "      ac_instr_counter += (0x%x-old_pc)/4 + 1;\n",j);
+
+  accs_EmitInstrExtraBottom(output, j, pinstr, 6);
+
+  //Check for delay slot and execute it too
+  pinstr = ((decode_table[j+jump_instr_size]) && (decode_table[j+jump_instr_size]->dec_vector)) ?
+    GetInstrByID(decoder->instructions, decode_table[j+jump_instr_size]->dec_vector[0]) :
+    0;
+
+  if (cflow->delay_slot) {
+
+    //If delay slot instruction is decoded
+    if (pinstr) {
+      fprintf( output, "      if (%s) {\n", accs_SubstFields(cflow->delay_slot_cond, j));
+      accs_EmitInstrExtraTop(output, j+jump_instr_size, pinstr, 8);
+      accs_EmitInstrBehavior(output, j+jump_instr_size, pinstr, 8);
+
+      if (ACMulticoreFlag == 1)
+        fprintf( output, "        ac_instr_counter++;\n");
+
+      accs_EmitInstrExtraBottom(output, j+jump_instr_size, pinstr, 8);
+      fprintf( output, "      }\n");
+    }
+    else {
+      fprintf( output, "      fprintf(stderr, \"Instruction at ac_pc=%#x reached but not decoded.\\n\");\n", j+jump_instr_size);
+      fprintf( output, "      ac_stop(1);\n");
+    }
+  }
+
+  fprintf( output, "      ac_pc = tmp_pc;\n");
+  if (ACMulticoreFlag == 1)
+    fprintf( output, "      old_pc = ac_pc;\n");
+
+  if (chain) {
+    //The compiler follows tmp_pc, a constant on each path, into the gotos
+    eval_input = accs_SubstFields(cflow->target, j);
+    if ((eval_parse() == 0) && PROCESSOR_OPTIMIZATIONS_HasLabel(eval_result, j))
+      fprintf( output, "      if (tmp_pc == %#x) goto L_%x;\n", eval_result, eval_result);
+    if (PROCESSOR_OPTIMIZATIONS_HasLabel(fall, j))
+      fprintf( output, "      if (tmp_pc == %#x) goto L_%x;\n", fall, fall);
   }
+  fprintf( output, "      break;\n");
+
+  fprintf( output, "\n");
 }
 
 
-void PROCESSOR_OPTIMIZATIONS_EmitInstr_3(FILE *output, int j)
+//Labels the instructions control can reach from the switch: the leaders and
+//the first one of each region. Level 5 also labels the ones jumped to.
+void PROCESSOR_OPTIMIZATIONS_EmitLeader(FILE *output, int j)
 {
   static unsigned NEXT_START_REGION=0;
-  ac_dec_instr *pinstr = GetInstrByID(decoder->instructions, decode_table[j]->dec_vector[0]);
-  char *args = accs_Fields2Str(decode_table[j]);
 
   //put case in leaders
   if (decode_table[j]->is_leader) {
@@ -255,11 +340,23 @@ void PROCESSOR_OPTIMIZATIONS_EmitInstr_3(FILE *output, int j)
   else if (j >= NEXT_START_REGION) {
     fprintf( output, "    // IS LEADER from START REGION\n");
     fprintf( output, "    case 0x%x:\n", j);
-    NEXT_START_REGION += (1 << REGION_SIZE);
   }
   else {
     fprintf( output, "                               // 0x%x\n", j);
   }
+  if (j >= NEXT_START_REGION)
+    NEXT_START_REGION = ((j >> REGION_SIZE) + 1) << REGION_SIZE;
+
+  if ((PROCESSOR_OPTIMIZATIONS == 5) && (decode_table[j]->is_target))
+    fprintf( output, "    L_%x:\n", j);
+}
+
+
+void PROCESSOR_OPTIMIZATIONS_EmitInstr_3(FILE *output, int j)
+{
+  ac_dec_instr *pinstr = GetInstrByID(decoder->instructions, decode_table[j]->dec_vector[0]);
+
+  PROCESSOR_OPTIMIZATIONS_EmitLeader(output, j);
 
   accs_EmitInstrExtraTop(output, j, pinstr, 6);
   accs_EmitInstrBehavior(output, j, pinstr, 6);
@@ -269,3 +366,38 @@ void PROCESSOR_OPTIMIZATIONS_EmitInstr_3(FILE *output, int j)
 }
 
 
+void PROCESSOR_OPTIMIZATIONS_EmitInstr_4(FILE *output, int j)
+{
+  ac_dec_instr *pinstr = GetInstrByID(decoder->instructions, decode_table[j]->dec_vector[0]);
+
+  PROCESSOR_OPTIMIZATIONS_EmitLeader(output, j);
+
+  //Straight-line code falls through, leaving ac_pc alone
+  if (!pinstr->cflow) {
+    accs_EmitInstrExtraTop(output, j, pinstr, 6);
+    accs_EmitInstrBehavior(output, j, pinstr, 6);
+    accs_EmitInstrExtraBottom(output, j, pinstr, 6);
+    fprintf( output, "\n");
+  }
+  else
+    PROCESSOR_OPTIMIZATIONS_EmitControl(output, j, pinstr, 0);
+}
+
+
+void PROCESSOR_OPTIMIZATIONS_EmitInstr_5(FILE *output, int j)
+{
+  ac_dec_instr *pinstr = GetInstrByID(decoder->instructions, decode_table[j]->dec_vector[0]);
+
+  PROCESSOR_OPTIMIZATIONS_EmitLeader(output, j);
+
+  if (!pinstr->cflow) {
+    accs_EmitInstrExtraTop(output, j, pinstr, 6);
+    accs_EmitInstrBehavior(output, j, pinstr, 6);
+    accs_EmitInstrExtraBottom(output, j, pinstr, 6);
+    fprintf( output, "\n");
+  }
+  else
+    PROCESSOR_OPTIMIZATIONS_EmitControl(output, j, pinstr, 1);
+}
+
+
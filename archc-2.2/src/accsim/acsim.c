@@ -125,8 +125,13 @@ struct option_map option_map[] = {
   {"--optimization"  , "-opt"        ,"Use best compiled simulator optimization or set level manually.", "r"},
 /*  {"--inline"        , "-i"          ,"Inline ISA and Syscalls (slow compilation, fast execution)", "r"},*/
   {"--block-size"    , "-bs"         ,"Set the maximum number of regions in a file.", "r"},
+  {"--unit-size"     , "-us"         ,"Set the number of instructions a file is filled up to.", "r"},
   {"--multicore"     , "-mc"	     ,"Beta version for static Compiled Simulation multicore.", "r"},
+  {"--cores"         , "-nc"         ,"Set the number of cores the multicore version runs, each on a host thread.", "r"},
   {"--annul-instr"   , "-ai"         ,"Necessary in models wich the instructions may be executed or not", "r"},
+  {"--object-cache"  , "-oc"         ,"Reuse the objects of compiled files from a directory shared by builds.", "r"},
+  {"--profile"       , "-pf"         ,"Compile only the hot regions of an interpreted run's heatmap or address counts; interpret the rest.", "r"},
+  {"--coverage"      , "-cov"        ,"Set the percent of the profiled instructions the hot regions run (99).", "r"},
 /*   {"--pentium4"      , "-p4"         ,"Use option for gcc: -march=pentium4.", "r"}, */
 /*   {"--omit-frame-p"  , "-omitfp"     ,"Use option for gcc: -fomit-frame-pointer.", "r"}, */
   0
@@ -297,14 +302,14 @@ int main( argc, argv )
               if ((argc < 2) || (argv[1][0] < '0') || (argv[1][0] > '9')) {
 /*                 extern int PROCESSOR_OPTIMIZATIONS; */
 /*                 PROCESSOR_OPTIMIZATIONS = -1; */
-                AC_ERROR("Give an optimization level: 0, 1, 2\n");
+                AC_ERROR("Give an optimization level: 0 to 5\n");
                 exit(EXIT_FAILURE);
               }
               else {
                 extern int PROCESSOR_OPTIMIZATIONS;
                 PROCESSOR_OPTIMIZATIONS = strtol(argv[1], 0, 0);
-                if ((PROCESSOR_OPTIMIZATIONS < 0) || (PROCESSOR_OPTIMIZATIONS > 2)) {
-                  AC_ERROR("Give an optimization level: 0, 1, 2\n");
+                if ((PROCESSOR_OPTIMIZATIONS < 0) || (PROCESSOR_OPTIMIZATIONS > 5)) {
+                  AC_ERROR("Give an optimization level: 0 to 5\n");
                   exit(EXIT_FAILURE);
                 }
                 ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
@@ -329,6 +334,23 @@ int main( argc, argv )
               }
               ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
               break;
+            case OPUnitSize:
+              if (argc < 2) {
+                AC_ERROR("Give a number of instructions after %s option.\n", argv[0]);
+                exit(EXIT_FAILURE);
+              }
+              else {
+                extern int REGION_UNIT_INSTRS;
+                REGION_UNIT_INSTRS = strtol(argv[1], 0, 0);
+                if (REGION_UNIT_INSTRS < 1) {
+                  AC_ERROR("Too small unit size\n");
+                  exit(EXIT_FAILURE);
+                }
+                ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+                ++argv, --argc, j++;  /* skip over a parameter */
+              }
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
             case OPCompsim:
               //This hidden option in the form "-l 2 <filename>" uses the original storage and resources classes (slower)
               if ((argc > 1) && (strcmp(argv[1], "2")==0)) {
@@ -442,10 +464,70 @@ int main( argc, argv )
 		ACMulticoreFlag = 1;
 		ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
 		break;
+            case OPCores:
+              if (argc < 2) {
+                AC_ERROR("Give a number of cores after %s option.\n", argv[0]);
+                exit(EXIT_FAILURE);
+              }
+              else {
+                extern int MULTICORE_CORES;
+                MULTICORE_CORES = strtol(argv[1], 0, 0);
+                if (MULTICORE_CORES < 1) {
+                  AC_ERROR("Too few cores\n");
+                  exit(EXIT_FAILURE);
+                }
+                ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+                ++argv, --argc, j++;  /* skip over a parameter */
+              }
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
 	    case OPAnnulSig:
 	    	ACAnnulSigFlag = 1;
 	    	ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
 	    break;
+            case OPObjectCache:
+              if (argc < 2) {
+                AC_ERROR("Give a directory after %s option.\n", argv[0]);
+                exit(EXIT_FAILURE);
+              }
+              else {
+                extern char *OBJECT_CACHE;
+                OBJECT_CACHE = argv[1];
+                ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+                ++argv, --argc, j++;  /* skip over a parameter */
+              }
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPProfile:
+              if (argc < 2) {
+                AC_ERROR("Give a profile file after %s option.\n", argv[0]);
+                exit(EXIT_FAILURE);
+              }
+              else {
+                extern char *PROFILE_FILE;
+                PROFILE_FILE = argv[1];
+                ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+                ++argv, --argc, j++;  /* skip over a parameter */
+              }
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPCoverage:
+              if (argc < 2) {
+                AC_ERROR("Give a percent after %s option.\n", argv[0]);
+                exit(EXIT_FAILURE);
+              }
+              else {
+                extern int PROFILE_COVERAGE;
+                PROFILE_COVERAGE = strtol(argv[1], 0, 0);
+                if ((PROFILE_COVERAGE < 1) || (PROFILE_COVERAGE > 100)) {
+                  AC_ERROR("Give a percent from 1 to 100\n");
+                  exit(EXIT_FAILURE);
+                }
+                ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+                ++argv, --argc, j++;  /* skip over a parameter */
+              }
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
 
             default:
               break;
@@ -2594,7 +2676,7 @@ void CreateStgImpl(ac_stg_list* stage_list, char* pipe_name) {
     
     if( pstage->id == 1 && ACVerifyFlag ){
       fprintf( output, "#include  \"ac_msgbuf.H\"\n");
-      fprintf( output, "#include  \"sys/msg.h\"\n");
+      fprintf( output, "#include  \"ac_verify_ring.H\"\n");
     }
 
 
@@ -2652,7 +2734,7 @@ void CreateStgImpl(ac_stg_list* stage_list, char* pipe_name) {
       }			
 			
       if( ACVerifyFlag ){
-        fprintf( output, "%sextern int msqid;\n", INDENT[1]);
+        fprintf( output, "%sextern ac_verify_ring ac_vring;\n", INDENT[1]);
         fprintf( output, "%sstruct log_msgbuf end_log;\n", INDENT[1]);
       }
                         
@@ -2733,7 +2815,7 @@ void CreateProcessorImpl() {
 
   if( ACVerifyFlag ){
     fprintf( output, "#include  \"ac_msgbuf.H\"\n");
-    fprintf( output, "#include  \"sys/msg.h\"\n");
+    fprintf( output, "#include  \"ac_verify_ring.H\"\n");
   }
 
   if( ACABIFlag )
@@ -2749,7 +2831,7 @@ void CreateProcessorImpl() {
   fprintf( output, "%sunsigned ins_id;\n", INDENT[1]);
 
   if( ACVerifyFlag ){
-    fprintf( output, "%sextern int msqid;\n", INDENT[1]);
+    fprintf( output, "%sextern ac_verify_ring ac_vring;\n", INDENT[1]);
     fprintf( output, "%sstruct log_msgbuf end_log;\n", INDENT[1]);
   }
   if( ACABIFlag )
@@ -2817,10 +2899,8 @@ void CreateResourceImpl() {
 
   if(ACVerifyFlag){
     fprintf( output, "#include  \"ac_msgbuf.H\"\n");
-    fprintf( output, "#include  <sys/ipc.h>\n");
+    fprintf( output, "#include  \"ac_verify_ring.H\"\n");
     fprintf( output, "#include  <unistd.h>\n");
-    fprintf( output, "#include  <sys/msg.h>\n");
-    fprintf( output, "#include  <sys/types.h>\n");
   }
 
   if( ACStatsFlag ){
@@ -3062,22 +3142,14 @@ void CreateResourceImpl() {
   if(ACVerifyFlag){
     int ndevice=0;
 
-    //Set co-verification msg queue method
+    //Set co-verification message ring method
     fprintf( output, "void ac_resources::set_queue(char* exec_name){\n\n" );
     fprintf( output, "%sstruct start_msgbuf sbuf;\n", INDENT[1] );
     fprintf( output, "%sstruct dev_msgbuf dbuf;\n", INDENT[1] );
-    fprintf( output, "%sextern key_t key;\n", INDENT[1] );
-    fprintf( output, "%sextern int msqid;\n", INDENT[1] );
+    fprintf( output, "%sextern ac_verify_ring ac_vring;\n", INDENT[1] );
 
-    fprintf( output, "%sif ((key = ftok(exec_name, 'A')) == -1) {\n", INDENT[1] );
-    fprintf( output, "%sAC_ERROR(\"Could not attach to the co-verification msg queue. Process:\" << getpid());\n", INDENT[2] );
-    fprintf( output, "%sperror(\"ftok\");\n", INDENT[2] );
-    fprintf( output, "%sexit(1);\n", INDENT[2] );
-    fprintf( output, "%s}\n", INDENT[1] );
-		
-    fprintf( output, "%sif ((msqid = msgget(key, 0644)) == -1) {\n", INDENT[1] );
-    fprintf( output, "%sAC_ERROR(\"Could not attach to the co-verification msg queue. Process:\" << getpid());\n", INDENT[2] );
-    fprintf( output, "%sperror(\"msgget\");\n", INDENT[2] );
+    fprintf( output, "%sif (!ac_vring.attach_env()) {\n", INDENT[1] );
+    fprintf( output, "%sAC_ERROR(\"Could not attach to the co-verification msg ring. Process:\" << getpid());\n", INDENT[2] );
     fprintf( output, "%sexit(1);\n", INDENT[2] );
     fprintf( output, "%s}\n", INDENT[1] );
 
@@ -3093,9 +3165,9 @@ void CreateResourceImpl() {
 
     fprintf( output, "%ssbuf.mtype = 1;\n", INDENT[1] );
     fprintf( output, "%ssbuf.ndevice =%d;\n", INDENT[1], ndevice );
+    fprintf( output, "%ssbuf.digest = 0;\n", INDENT[1] );
 
-    fprintf( output, "%sif (msgsnd(msqid, (void*)&sbuf, sizeof(sbuf), 0) == -1)\n", INDENT[1] );
-    fprintf( output, "%sperror(\"msgsnd\");\n", INDENT[2] );
+    fprintf( output, "%sac_vring.send(&sbuf, sizeof(sbuf));\n", INDENT[1] );
     fprintf( output, "\n" );
 
     fprintf( output, "%sdbuf.mtype =2;\n", INDENT[1] );
@@ -3110,11 +3182,11 @@ void CreateResourceImpl() {
 
         fprintf( output, "%sstrcpy(dbuf.name,%s.get_name());\n", INDENT[1], pstorage->name );
 
-        fprintf( output, "%sif (msgsnd(msqid, (void*)&dbuf, sizeof(dbuf), 0) == -1)\n", INDENT[1] );
-        fprintf( output, "%sperror(\"msgsnd\");\n", INDENT[2] );
+        fprintf( output, "%sac_vring.send(&dbuf, sizeof(dbuf));\n", INDENT[1] );
         fprintf( output, "\n" );
       }
     }
+    fprintf( output, "%sac_vring.flush();\n", INDENT[1] );
     fprintf( output, "}\n");   //End of set_queue
   }
 
@@ -3157,7 +3229,7 @@ void CreateARCHImpl() {
 //  fprintf( output, "#include  \"%s-arch.H\"\n", project_name);
   if( ACVerifyFlag ){
     fprintf( output, "#include  \"ac_msgbuf.H\"\n");
-    fprintf( output, "#include  \"sys/msg.h\"\n");
+    fprintf( output, "#include  \"ac_verify_ring.H\"\n");
   }
   fprintf( output, " \n");
 
@@ -3167,7 +3239,7 @@ void CreateARCHImpl() {
 
   if( ACVerifyFlag ){
 
-    fprintf( output, "extern int msqid;\n");
+    fprintf( output, "extern ac_verify_ring ac_vring;\n");
     fprintf( output, "struct log_msgbuf lbuf;\n");
     fprintf( output, "log_list::iterator itor;\n");
     fprintf( output, "log_list *plog;\n");
@@ -3233,8 +3305,7 @@ void CreateARCHImpl() {
         fprintf( output, "%slbuf.mtype = %d;\n", INDENT[5], next_type );
         fprintf( output, "%swhile( itor != plog->end()){\n\n", INDENT[5] );
         fprintf( output, "%slbuf.log = *itor;\n", INDENT[6] );
-        fprintf( output, "%sif( msgsnd(msqid, (struct log_msgbuf *)&lbuf, sizeof(lbuf), 0) == -1)\n", INDENT[6] );
-        fprintf( output, "%sperror(\"msgsnd\");\n", INDENT[7] );
+        fprintf( output, "%sac_vring.send(&lbuf, sizeof(lbuf));\n", INDENT[6] );
         fprintf( output, "%sitor = plog->erase(itor);\n", INDENT[6] );
         fprintf( output, "%s}\n", INDENT[5] );
         fprintf( output, "%s}\n\n", INDENT[4] );
@@ -3242,6 +3313,7 @@ void CreateARCHImpl() {
         next_type++;
       }
     }
+    fprintf( output, "%sac_vring.flush();\n", INDENT[4] );
     fprintf( output, "%s}\n\n", INDENT[3] );
 		
   }
@@ -3666,7 +3738,8 @@ void CreateMakefile(){
  
   fprintf( output, "LIB_SYSTEMC := %s\n",
            (strlen(SYSTEMC_PATH) > 2) ? "-lsystemc" : "");
-  fprintf( output, "LIBS := $(LIB_SYSTEMC) -lm $(EXTRA_LIBS) -larchc\n");
+  fprintf( output, "LIBS := $(LIB_SYSTEMC) -lm $(EXTRA_LIBS) -larchc%s\n",
+           (ACVerifyFlag) ? " -lrt" : "");
   fprintf( output, "CC :=  %s\n", CC_PATH);
   //fprintf( output, "OPT :=  %s\n", OPT_FLAGS);
   fprintf( output, "OPT := \n");
@@ -4547,8 +4620,8 @@ void EmitFetchInit( FILE *output, int base_indent){
   if( ACVerifyFlag ){
     fprintf( output, "%send_log.mtype = 1;\n", INDENT[base_indent+1]);
     fprintf( output, "%send_log.log.time = -1;\n", INDENT[base_indent+1]);
-    fprintf( output, "%sif(msgsnd(msqid, (struct log_msgbuf *)&end_log, sizeof(end_log), 0) == -1)\n", INDENT[base_indent+1]);
-    fprintf( output, "%sperror(\"msgsnd\");\n", INDENT[base_indent+2]);
+    fprintf( output, "%sac_vring.send(&end_log, sizeof(end_log));\n", INDENT[base_indent+1]);
+    fprintf( output, "%sac_vring.flush();\n", INDENT[base_indent+1]);
   }
   fprintf( output, "%sac_stop();\n", INDENT[base_indent+1]);
   fprintf( output, "%sreturn;\n", INDENT[base_indent+1]);
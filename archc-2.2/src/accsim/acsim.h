@@ -112,8 +112,13 @@ enum _ac_cmd_options {
   OPOptimization,
 /*  OPInline, */
   OPRegionBlockSize,
+  OPUnitSize,
   OPMulticore, 
+  OPCores,
   OPAnnulSig,
+  OPObjectCache,
+  OPProfile,
+  OPCoverage,
 /*   OPP4, */
 /*   OPOmitFP, */
   ACNumberOfOptions
@@ -28,6 +28,7 @@
 
 // ArchC includes
 #include "ac_module.H"
+#include "ac_stats_snapshot.H"
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -44,12 +45,21 @@ unsigned ac_module::running_mods = 0;
 /// List of all modules.
 std::list<ac_module*> ac_module::mods_list;
 
+/// Largest local time before a module waits for the kernel.
+sc_time ac_module::global_quantum = SC_ZERO_TIME;
+
+/// Whether the modules run on host threads of their own.
+bool ac_module::on_host_threads = false;
+
 /// Standard constructor.
 ac_module::ac_module() : sc_module(sc_gen_unique_name("ac_module")),
 			 mod_id(next_mod_id++),
 			 ac_exit_status(0),
 			 instr_in_batch(0),
-			 instr_batch_size(500) {
+			 instr_batch_size(500),
+			 instr_batch_min(500),
+			 instr_batch_max(500),
+			 local_time(SC_ZERO_TIME) {
   this_mod = mods_list.insert(mods_list.end(), this);
   return;
 }
@@ -59,7 +69,10 @@ ac_module::ac_module(sc_module_name nm) : sc_module(nm),
 			 mod_id(next_mod_id++),
 			 ac_exit_status(0),
 			 instr_in_batch(0),
-			 instr_batch_size(500) {
+			 instr_batch_size(500),
+			 instr_batch_min(500),
+			 instr_batch_max(500),
+			 local_time(SC_ZERO_TIME) {
   this_mod = mods_list.insert(mods_list.end(), this);
   return;
 }
@@ -90,20 +103,71 @@ void ac_module::PrintAllStats()
 
 /// Public method that registers module as a running module.
 void ac_module::set_running() {
-  running_mods++;
+  __sync_add_and_fetch(&running_mods, 1);
 }
 
 /// Public method that unregisters module (ie, it's no longer running).
 void ac_module::set_stopped() {
-  if (--running_mods == 0) {
-    dup2(2, 1); //any output to stdout is redirected for stderr (ex. SystemC stop message)
-    sc_stop();
-  }
+  //Cores of a multi-core simulation stop from their own host threads,
+  //where the kernel cannot be stopped
+  if (__sync_sub_and_fetch(&running_mods, 1) == 0 && !on_host_threads)
+    stop_kernel();
+}
+
+/// Public method that ends the simulation once no module runs.
+void ac_module::stop_kernel() {
+  ac_stats_interval_stop();
+  dup2(2, 1); //any output to stdout is redirected for stderr (ex. SystemC stop message)
+  sc_stop();
 }
 
 /// Public method that sets the size of the uninterrupted instruction batch
 void ac_module::set_instr_batch_size(unsigned int size)
 {
-  instr_batch_size = size;
+  instr_batch_size = instr_batch_min = instr_batch_max = size;
+}
+
+/// Public method that lets the batch size adapt between min and max
+void ac_module::set_instr_batch_range(unsigned int min, unsigned int max)
+{
+  instr_batch_min = min;
+  instr_batch_max = max;
+  if (instr_batch_size < min)
+    instr_batch_size = min;
+  else if (instr_batch_size > max)
+    instr_batch_size = max;
+}
+
+/// Public method that adapts the batch size at the end of a batch.
+/// Quiet batches double it, so a lone processor soon yields rarely. Any
+/// port traffic halves it, and other running modules keep it from growing,
+/// so they are served a few batches after they become active.
+void ac_module::adapt_instr_batch(bool busy)
+{
+  if (busy) {
+    instr_batch_size >>= 1;
+    if (instr_batch_size < instr_batch_min)
+      instr_batch_size = instr_batch_min;
+  }
+  else if (running_mods <= 1) {
+    instr_batch_size <<= 1;
+    if (instr_batch_size > instr_batch_max)
+      instr_batch_size = instr_batch_max;
+  }
 }
 
+/// Public method that sets the global quantum.
+void ac_module::set_global_quantum(const sc_time& quantum)
+{
+  global_quantum = quantum;
+}
+
+/// Public method that waits for the local time, so that the kernel catches
+/// up with the module. Timing errors stay below the global quantum.
+void ac_module::sync_local_time()
+{
+  if (local_time == SC_ZERO_TIME)
+    return;
+  wait(local_time);
+  local_time = SC_ZERO_TIME;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file      ac_quantum.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Implementation of the multi-core quantum barrier.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+//////////////////////////////////////////////////////////////////////////////
+
+// ArchC includes
+#include "ac_quantum.H"
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Constructor for n cores.
+ac_quantum_barrier::ac_quantum_barrier(unsigned n) : members(n),
+                                                      waiting(0),
+                                                      generation(0),
+                                                      boundary(NULL),
+                                                      boundary_arg(NULL) {
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&released, NULL);
+}
+
+/// Destructor.
+ac_quantum_barrier::~ac_quantum_barrier()
+{
+  pthread_cond_destroy(&released);
+  pthread_mutex_destroy(&lock);
+}
+
+/// Wakes the waiters up and starts a new quantum. Called with lock held.
+void ac_quantum_barrier::release()
+{
+  if (boundary)
+    boundary(boundary_arg);
+  waiting = 0;
+  generation++;
+  pthread_cond_broadcast(&released);
+}
+
+/// Blocks until every member has reached the end of the quantum.
+void ac_quantum_barrier::sync()
+{
+  unsigned long long gen;
+
+  pthread_mutex_lock(&lock);
+  gen = generation;
+  if (++waiting >= members)
+    release();
+  else
+    while (gen == generation)
+      pthread_cond_wait(&released, &lock);
+  pthread_mutex_unlock(&lock);
+}
+
+/// Removes a stopped core, so the others do not wait for it.
+void ac_quantum_barrier::leave()
+{
+  pthread_mutex_lock(&lock);
+  members--;
+  if (waiting && waiting >= members)
+    release();
+  pthread_mutex_unlock(&lock);
+}
+
+/// Adds a core back, so the others wait for it again.
+void ac_quantum_barrier::join()
+{
+  pthread_mutex_lock(&lock);
+  members++;
+  pthread_mutex_unlock(&lock);
+}
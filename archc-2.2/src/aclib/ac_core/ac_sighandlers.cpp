@@ -18,7 +18,10 @@
 
 #include "ac_sighandlers.H"
 #include <stdlib.h>
+#include <string.h>
 #include "ac_module.H"
+#include "ac_stats_snapshot.H"
+#include "ac_guard.H"
 
 void sigint_handler(int signal)
 {
@@ -32,10 +35,55 @@ void sigsegv_handler(int signal)
   ac_module::PrintAllStats();
   exit(EXIT_FAILURE);
 }
+void sigsegv_guard_handler(int signal, siginfo_t* info, void* context)
+{
+  const char* what;
+  uint32_t address;
+
+  if (!ac_guard_find(info->si_addr, &what, &address))
+    sigsegv_handler(signal);
+  //The decode cache is indexed by the address fetched
+  if (ac_guard_pc)
+    fprintf(stderr, "ArchC: Address out of bounds in %s (address=0x%x, pc=0x%x).\n",
+            what, address, *ac_guard_pc);
+  else
+    fprintf(stderr, "ArchC: Address out of bounds in %s (address=0x%x).\n", what, address);
+  ac_module::PrintAllStats();
+  exit(EXIT_FAILURE);
+}
+
+void ac_guard_signals()
+{
+  struct sigaction action;
+
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = sigsegv_guard_handler;
+  action.sa_flags = SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGSEGV, &action, NULL);
+  sigaction(SIGBUS, &action, NULL);
+}
+
 void sigusr1_handler(int signal)
 {
+  //Where the behavior loop polls, the statistics are printed between two
+  //instructions instead of wherever the signal fell.
+  if (ac_stats_dump_polled) {
+    ac_stats_dump_pending = 1;
+    return;
+  }
   fprintf(stderr, "ArchC: Received signal %d. Printing statistics\n", signal);
   ac_module::PrintAllStats();
+  ac_stats_dump_run();
+  fprintf(stderr, "ArchC: -------------------- Continuing Simulation ------------------\n");
+}
+
+void ac_stats_dump()
+{
+  ac_stats_dump_pending = 0;
+  fprintf(stderr, "ArchC: Received signal %d. Printing statistics\n", SIGUSR1);
+  ac_module::PrintAllStats();
+  ac_stats_dump_run();
   fprintf(stderr, "ArchC: -------------------- Continuing Simulation ------------------\n");
 }
 
@@ -0,0 +1,208 @@
+/**
+ * @file      ac_threads.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Guest threads of a multi-core simulation on host threads.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Standard includes
+#include <stdio.h>
+#include <stdlib.h>
+
+// ArchC includes
+#include "ac_threads.H"
+
+//////////////////////////////////////////////////////////////////////////////
+
+ac_threads* ac_threads::current = 0;
+
+/// Constructor, for cores meeting at barrier.
+ac_threads::ac_threads(ac_quantum_barrier* b) : barrier(b),
+                                                running(0),
+                                                finished(false),
+                                                exit_status(0) {
+  pthread_mutex_init(&mutex, NULL);
+  current = this;
+}
+
+/// Destructor.
+ac_threads::~ac_threads()
+{
+  for (unsigned i = 0; i < cores.size(); i++) {
+    pthread_cond_destroy(&cores[i]->wake);
+    delete cores[i];
+  }
+  pthread_mutex_destroy(&mutex);
+  if (current == this)
+    current = 0;
+}
+
+ac_threads::core* ac_threads::find(const void* arch)
+{
+  for (unsigned i = 0; i < cores.size(); i++)
+    if (cores[i]->arch == arch)
+      return cores[i];
+  return 0;
+}
+
+/// Adds the core of arch; the first one runs the program.
+void ac_threads::add_core(const void* arch, int* stop_flag)
+{
+  core* c = new core;
+
+  c->arch = arch;
+  c->stop_flag = stop_flag;
+  c->state = cores.empty() ? kRunning : kIdle;
+  c->address = 0;
+  c->started = false;
+  pthread_cond_init(&c->wake, NULL);
+  lock();
+  running += c->state == kRunning;
+  cores.push_back(c);
+  unlock();
+}
+
+/// Thread id of the one running on arch.
+int ac_threads::tid(const void* arch)
+{
+  for (unsigned i = 0; i < cores.size(); i++)
+    if (cores[i]->arch == arch)
+      return i;
+  return -1;
+}
+
+/// Starts a thread from s on a core without one. Called with the lock held.
+int ac_threads::clone(const start& s)
+{
+  int id = -1;
+
+  for (unsigned i = 1; i < cores.size() && id == -1 && !finished; i++)
+    if (cores[i]->state == kIdle) {
+      core* c = cores[i];
+
+      c->next = s;
+      c->started = true;
+      c->state = kRunning;
+      running++;
+      //The new thread counts from now on, before its host thread wakes up
+      barrier->join();
+      pthread_cond_signal(&c->wake);
+      id = i;
+    }
+  return id;
+}
+
+/// Blocks the thread of arch until woken at address. Called with the lock held.
+ac_threads::wait_result ac_threads::wait(const void* arch, unsigned address)
+{
+  core* c = find(arch);
+
+  if (finished)
+    return kFinished;
+  if (running <= 1)
+    return kDeadlock;
+  c->state = kWaiting;
+  c->address = address;
+  running--;
+  barrier->leave();
+  while (c->state == kWaiting && !finished)
+    pthread_cond_wait(&c->wake, &mutex);
+  return finished ? kFinished : kWoken;
+}
+
+/// Wakes up to n threads waiting at address. Called with the lock held.
+int ac_threads::wake(unsigned address, int n)
+{
+  int woken = 0;
+
+  for (unsigned i = 0; i < cores.size() && woken < n; i++)
+    if (cores[i]->state == kWaiting && cores[i]->address == address) {
+      cores[i]->state = kRunning;
+      running++;
+      barrier->join();
+      pthread_cond_signal(&cores[i]->wake);
+      woken++;
+    }
+  return woken;
+}
+
+/// Blocks c until it is given a thread. Called with the lock held.
+bool ac_threads::idle(core* c, start& s)
+{
+  while (!c->started && !finished)
+    pthread_cond_wait(&c->wake, &mutex);
+  if (finished)
+    return false;
+  c->started = false;
+  s = c->next;
+  return true;
+}
+
+/// Ends the thread of arch and waits for another.
+bool ac_threads::exit_thread(const void* arch, start& s)
+{
+  core* c = find(arch);
+  bool given;
+
+  lock();
+  //finish() already took the core out of the barrier
+  if (!finished) {
+    c->state = kIdle;
+    running--;
+    barrier->leave();
+    if (!running) {
+      fprintf(stderr, "ArchC: Every thread of the program waits on a futex.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  given = idle(c, s);
+  unlock();
+  return given;
+}
+
+/// Blocks arch, a core without a thread yet, until it is given one.
+bool ac_threads::wait_start(const void* arch, start& s)
+{
+  bool given;
+
+  lock();
+  given = idle(find(arch), s);
+  unlock();
+  return given;
+}
+
+/// Ends the program: the other cores stop at their next instruction,
+/// and those that wait wake up and stop.
+void ac_threads::finish(const void* arch, int status)
+{
+  lock();
+  if (!finished) {
+    finished = true;
+    exit_status = status;
+    for (unsigned i = 0; i < cores.size(); i++) {
+      core* c = cores[i];
+
+      if (c->arch == arch)
+        continue;
+      __atomic_store_n(c->stop_flag, 1, __ATOMIC_RELAXED);
+      if (c->state == kRunning)
+        barrier->leave();
+      pthread_cond_signal(&c->wake);
+    }
+  }
+  unlock();
+}
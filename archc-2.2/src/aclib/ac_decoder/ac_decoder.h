@@ -111,6 +111,7 @@ void ShowDecInstr(ac_dec_instr *i);
 void ShowDecoder(ac_decoder *d, unsigned level);
 ac_decoder_full *CreateDecoder(ac_dec_format *formats, ac_dec_instr *instructions);
 
+ac_dec_field *FindDecField(ac_dec_field *fields, int id);
 ac_dec_format *FindFormat(ac_dec_format *formats, char *name);
 ac_dec_instr *GetInstrByID(ac_dec_instr *instr, int id);
 unsigned *Decode(ac_decoder_full *decoder, unsigned char *buffer, int quant);
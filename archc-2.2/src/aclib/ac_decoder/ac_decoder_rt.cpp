@@ -337,11 +337,17 @@ ac_decoder_full *ac_decoder_full::CreateDecoder(ac_dec_format *formats, ac_dec_i
   full -> instructions = instructions;
   full -> nFields = nFields;
   full -> prog_source = source;
+  full -> result = new unsigned[nFields];
   
   return full;
 }
 
 unsigned* ac_decoder_full::Decode(unsigned char *buffer, int quant)
+{
+  return Decode(buffer, quant, result);
+}
+
+unsigned* ac_decoder_full::Decode(unsigned char *buffer, int quant, unsigned *fields)
 {
   ac_decoder_full *decoder = this;
   ac_decoder *d = decoder -> decoder;
@@ -349,17 +355,11 @@ unsigned* ac_decoder_full::Decode(unsigned char *buffer, int quant)
   long long field_value;
   ac_dec_instr *instruction = NULL;
   //char byte;
-  static unsigned *fields = 0;
 
   ac_decoder *chosenPath[64]; // usar uma constante = MAX_DECODER_DEPTH
   int chosenPathPos = 0;
   chosenPath[chosenPathPos] = d;
 
- //!Allocate the first time only
-  if (!fields) {
-    fields = new unsigned[decoder -> nFields];
-  }
-
   while (d) {
     if (!field) {
       field = decoder->fields->FindDecField(d -> check -> id);
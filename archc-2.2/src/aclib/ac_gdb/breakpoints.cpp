@@ -16,9 +16,9 @@
  * @date      Mon, 19 Jun 2006 15:33:19 -0300
  *
  * @brief     Breakpoint support
- *            This class implements breakpoint support, actually it's 
- *            just a vector that keeps crescent order of elements and 
- *            have exits() method. It should be replaced for STL in future.
+ *            This class implements breakpoint support: a hash table of
+ *            the addresses, at most half full, probed linearly, so that
+ *            exists() can be called for every simulated instruction.
  *
  * @attention Copyright (C) 2002-2006 --- The ArchC Team
  *
@@ -28,8 +28,6 @@
  * \li Coding style (basically emacs style)
  * \li Commenting style. This code use doxygen (http://www.doxygen.org)
  *     to be documented.
- *
- * \todo  This class should be replaced for standard STL element.
  */
 
 #include "breakpoints.H"
@@ -40,14 +38,21 @@
  * \param quant how many breakpoints to support
  */
 Breakpoints::Breakpoints(int quant) {
+  unsigned int size = 2;
+
   quantMax = quant;
-  if ( ( bp = (unsigned int *) calloc( quantMax,
+  /* At most half full, so that probes stay short */
+  while ( size < 2 * (unsigned int) quantMax )
+    size <<= 1;
+  mask = size - 1;
+  if ( ( bp = (unsigned int *) calloc( size,
 				       sizeof( unsigned int ) ) ) == NULL )
     {
       perror( "Couldn't allocate breakpoint array." );
       quantMax = 0;
     }
-  memset( bp, 255, sizeof(unsigned int)* quantMax );
+  else
+    memset( bp, 255, sizeof(unsigned int) * size );
   this->quant = 0; /* no breakpoints at start up */
 }
 
@@ -69,21 +74,20 @@ Breakpoints::~Breakpoints() {
  * \param 0 on success, -1 otherwise
  */
 int Breakpoints::add(unsigned int address) {
-  int i, tmp;
+  unsigned int i;
 
-  if ( ( ! bp ) || ( quant >= quantMax ) )
+  if ( ( ! bp ) || ( address == EMPTY ) )
     return -1;
 
-  for ( i = 0; i < quant; i++ )
-    /* Insert in order */
-    if ( address < bp[i] )
-      {
-	tmp     = address;
-	address = bp[i];
-	bp[i]   = tmp;
-      }
+  for ( i = slot( address ); bp[ i ] != EMPTY; i = ( i + 1 ) & mask )
+    if ( bp[ i ] == address )
+      return 0;
+
+  if ( quant >= quantMax )
+    return -1;
 
-  bp[ quant ++ ] = address;
+  bp[ i ] = address;
+  quant ++;
   return 0;
 }
 
@@ -96,23 +100,31 @@ int Breakpoints::add(unsigned int address) {
  * \param 0 on success, -1 otherwise
  */
 int Breakpoints::remove(unsigned int address) {
-  int i;
+  unsigned int i, j, home;
 
-  if ( ( ! bp ) || ( quant >= quantMax ) )
+  if ( ( ! bp ) || ( quant == 0 ) )
     return -1;
 
-  for ( i = 0; i < quant; i ++ )
-    if ( bp[ i ] == address )
-      {
-	/* Copy remaining breakpoints: [ a | b | c ] => [ a | c ] */
-	for ( ; i < ( quant - 1 ); i ++ )
-	  bp[ i ] = bp[ i + 1 ];
+  for ( i = slot( address ); bp[ i ] != address; i = ( i + 1 ) & mask )
+    if ( bp[ i ] == EMPTY )
+      return -1;
 
-	quant --;
-	return 0;
-      }
+  /* Move back the entries that probed past the freed slot:
+   * [ a | x | b ] => [ a | b | . ] if b's home is at or before x
+   */
+  for ( j = ( i + 1 ) & mask; bp[ j ] != EMPTY; j = ( j + 1 ) & mask )
+    {
+      home = slot( bp[ j ] );
+      if ( ( ( j - home ) & mask ) >= ( ( j - i ) & mask ) )
+	{
+	  bp[ i ] = bp[ j ];
+	  i = j;
+	}
+    }
+  bp[ i ] = EMPTY;
 
-  return -1;
+  quant --;
+  return 0;
 }
 
 /**
@@ -123,20 +135,14 @@ int Breakpoints::remove(unsigned int address) {
  * \return 1 if there is a breakpoint, 0 otherwise
  */
 int Breakpoints::exists(unsigned int address) {
-  int i;
+  unsigned int i;
 
-  if ( ( ! bp ) || ( quant >= quantMax ) )
+  if ( ( ! bp ) || ( quant == 0 ) )
     return 0;
 
-  for ( i = 0; i < quant; i ++ )
-    if ( address == bp[ i ] )
+  for ( i = slot( address ); bp[ i ] != EMPTY; i = ( i + 1 ) & mask )
+    if ( bp[ i ] == address )
       return 1;
-    else
-      /* bp is crescent order, so if current element is greater than desired
-       * address, there's no address in list
-       */
-      if (  bp[ i ] > address )
-	return 0;
 
   return 0;
 }
@@ -22,9 +22,12 @@
 
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
+#include <string>
 #include "ac_utils.H"
 
 
@@ -39,6 +42,9 @@ namespace ac_dynlink {
     initiated = false;
     glibc = false;
     word_size = 0;
+    lazy_allowed = false;
+    lazy_base = 0;
+    lazy_size = 0;
   }
   
   ac_rtld::~ac_rtld() {
@@ -85,7 +91,7 @@ namespace ac_dynlink {
        relocations.*/
     p = root;
     while (p != NULL) {
-      p->apply_relocations(mem, word_size);
+      p->apply_relocations(mem, word_size, lazy_base);
       p = p->get_next();
     }
 
@@ -98,6 +104,183 @@ namespace ac_dynlink {
     }
   }
 
+  /* Relocated images. With AC_RTLD_CACHE naming a directory, the bytes
+     link() changes are saved there, under a hash of the memory it starts
+     from: the program and every library, as loaded. A later run loading
+     the same objects at the same addresses writes them back and skips
+     symbol resolution and relocation entirely. */
+
+  static const char image_magic[8] = {'A', 'C', 'R', 'T', 'L', 'D', '1', '\n'};
+
+  /* FNV-1a, over the image and what else changes the way it links */
+  static uint64_t image_key(unsigned char *mem, Elf32_Addr image_end,
+                            unsigned char word_size, bool relmap, bool lazy) {
+    uint64_t key = 14695981039346656037ULL;
+    unsigned char head[3] = {word_size, relmap, lazy};
+
+    for (unsigned i = 0; i < sizeof(head); i++)
+      key = (key ^ head[i]) * 1099511628211ULL;
+    for (Elf32_Addr i = 0; i < image_end; i++)
+      key = (key ^ mem[i]) * 1099511628211ULL;
+    return key;
+  }
+
+  /* Writes the runs of changed bytes back, once the whole file is known
+     to be sound; mem is left alone otherwise. */
+  static bool load_image(const char *path, uint64_t key, unsigned char *mem,
+                         Elf32_Addr image_end) {
+    FILE *f = fopen(path, "rb");
+    unsigned char *buf, *p, *end;
+    long size;
+    bool ok = false;
+
+    if (f == NULL)
+      return false;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < (long)(sizeof(image_magic) + 16)) {
+      fclose(f);
+      return false;
+    }
+    buf = (unsigned char *) malloc(size);
+    if (fread(buf, 1, size, f) == (size_t)size &&
+        !memcmp(buf, image_magic, sizeof(image_magic)) &&
+        !memcmp(buf + 8, &key, 8) && !memcmp(buf + 16, &image_end, 4)) {
+      uint32_t runs, addr, len;
+
+      memcpy(&runs, buf + 20, 4);
+      p = buf + 24;
+      end = buf + size;
+      ok = true;
+      for (uint32_t i = 0; ok && i < runs; i++) {
+        if (end - p < 8) {
+          ok = false;
+          break;
+        }
+        memcpy(&addr, p, 4);
+        memcpy(&len, p + 4, 4);
+        p += 8;
+        if ((uint32_t)(end - p) < len || addr > image_end || len > image_end - addr)
+          ok = false;
+        p += ok ? len : 0;
+      }
+      ok = ok && p == end;
+      for (p = buf + 24; ok && p < end; ) {
+        memcpy(&addr, p, 4);
+        memcpy(&len, p + 4, 4);
+        memcpy(mem + addr, p + 8, len);
+        p += 8 + len;
+      }
+    }
+    free(buf);
+    fclose(f);
+    return ok;
+  }
+
+  /* Saves the bytes that differ between before and mem, in runs; short
+     stretches of equal bytes are kept inside a run. */
+  static void save_image(const char *path, uint64_t key, unsigned char *before,
+                         unsigned char *mem, Elf32_Addr image_end) {
+    char suffix[24];
+    std::string tmp;
+    FILE *f;
+    uint32_t runs = 0;
+    Elf32_Addr i = 0;
+
+    /* Written aside and renamed, so that concurrent runs never read a
+       partial file */
+    snprintf(suffix, sizeof(suffix), ".%d", (int) getpid());
+    tmp = std::string(path) + suffix;
+    if ((f = fopen(tmp.c_str(), "wb")) == NULL)
+      return;
+    fwrite(image_magic, 1, sizeof(image_magic), f);
+    fwrite(&key, 8, 1, f);
+    fwrite(&image_end, 4, 1, f);
+    fwrite(&runs, 4, 1, f);
+    while (i < image_end) {
+      uint32_t start, len, same = 0;
+
+      if (before[i] == mem[i]) {
+        i++;
+        continue;
+      }
+      start = i;
+      for (; i < image_end && same < 16; i++)
+        same = (before[i] == mem[i]) ? same + 1 : 0;
+      len = i - start - same;
+      fwrite(&start, 4, 1, f);
+      fwrite(&len, 4, 1, f);
+      fwrite(mem + start, 1, len, f);
+      runs++;
+    }
+    fseek(f, sizeof(image_magic) + 12, SEEK_SET);
+    fwrite(&runs, 4, 1, f);
+    if (fclose(f) == 0)
+      rename(tmp.c_str(), path);
+    else
+      unlink(tmp.c_str());
+  }
+
+  /* link(), or the saved outcome of a previous one from the same image */
+  void ac_rtld::link_cached(unsigned char *mem, Elf32_Addr image_end) {
+    const char *dir = getenv(ENV_AC_RTLD_CACHE);
+    unsigned char *before;
+    uint64_t key;
+    char name[32];
+    std::string path;
+
+    if (dir == NULL || *dir == '\0') {
+      link(mem);
+      return;
+    }
+
+    key = image_key(mem, image_end, word_size, rtld_config.is_config_loaded(),
+                    lazy_size != 0);
+    snprintf(name, sizeof(name), "/%016llx.img", (unsigned long long) key);
+    path = std::string(dir) + name;
+    if (load_image(path.c_str(), key, mem, image_end))
+      return;
+
+    before = (unsigned char *) malloc(image_end);
+    memcpy(before, mem, image_end);
+    link(mem);
+    save_image(path.c_str(), key, before, mem, image_end);
+    free(before);
+  }
+
+  void ac_rtld::allow_lazy() {
+    lazy_allowed = true;
+  }
+
+  /* First call through a lazy jump slot: binds it and answers where
+     the call goes */
+  unsigned ac_rtld::resolve_lazy(unsigned addr) {
+    lazy_slot &slot = lazy_slots[(addr - lazy_base) / 4];
+
+    return slot.node->bind_lazy(slot.reloc, word_size);
+  }
+
+  /* Numbers the lazy jump slots of every object and reserves the words
+     they point to, right after the last library */
+  static void reserve_lazy_slots(link_node *p, memmap& mem_map, std::vector<lazy_slot>& slots,
+                                 Elf32_Addr& base, Elf32_Word& size) {
+    for (; p != NULL; p = p->get_next()) {
+      std::vector<unsigned int> relocs;
+
+      p->collect_lazy_relocs(slots.size(), relocs);
+      for (unsigned i = 0; i < relocs.size(); i++) {
+        lazy_slot slot = {p, relocs[i]};
+        slots.push_back(slot);
+      }
+    }
+    if (slots.empty())
+      return;
+    size = slots.size() * 4;
+    base = mem_map.suggest_free_region(size);
+    mem_map.add_region(base, size);
+  }
+
   unsigned *ac_rtld::get_init_array() {
     if (root != NULL)
       return root->get_start_vector();
@@ -164,12 +347,19 @@ namespace ac_dynlink {
     root->link_node_setup(dynaddr, mem, 0, ET_EXEC, NULL, NULL, match_endian);
     
     load_libraries(mem, mem_size);
+
+    if (lazy_allowed && getenv(ENV_AC_RTLD_LAZY) != NULL)
+      reserve_lazy_slots(root, mem_map, lazy_slots, lazy_base, lazy_size);
     
     ac_heap_ptr = mem_map.suggest_free_region(0);
 
     mem_map.set_brk_addr(ac_heap_ptr);
     
-    link(mem);
+    link_cached(mem, ac_heap_ptr);
+
+    /* The symbols now hold the addresses of the objects as loaded */
+    for (link_node *p = root; p != NULL; p = p->get_next())
+      p->add_functions();
 
     initvec = root->get_start_vector();
     initvecn = root->get_start_vector_n();
@@ -123,9 +123,15 @@ namespace ac_dynlink {
     return symbol;
   }
 
+  /* Hash table words are in target byte order */
+  Elf32_Word dynamic_symbol_table::read_word(const Elf32_Word *word) {
+    return convert_endian(4, *word, match_endian);
+  }
+
   /* Public methods */
 
   dynamic_symbol_table::dynamic_symbol_table() {
+    gnu = false;
     versym = NULL;
     verneed = NULL;
     verdefs = NULL;
@@ -152,18 +158,55 @@ namespace ac_dynlink {
     return hash;
   }
 
-  void dynamic_symbol_table::setup_hash(unsigned char *mem, Elf32_Addr hash_addr,
+  /* GNU hashing function (DT_GNU_HASH), the one of Bernstein */
+  unsigned int dynamic_symbol_table::gnu_hash (const unsigned char *name) {
+    unsigned int hash = 5381;
+
+    while (*name != '\0')
+      hash = hash * 33 + *name++;
+    return hash;
+  }
+
+  void dynamic_symbol_table::setup_hash(unsigned char *mem, Elf32_Addr hash_addr, Elf32_Addr gnu_hash_addr,
 					Elf32_Addr symtab_addr, Elf32_Addr strtab_addr, Elf32_Addr verdef_addr,
 					Elf32_Addr verneed_addr, Elf32_Addr versym_addr, bool match_endian) {
-    Elf_Symndx *hash = reinterpret_cast<Elf_Symndx *> (mem + hash_addr);
-    
     this->match_endian = match_endian;
 
-    nbuckets =  *hash++;
-    nchain = *hash++;
-    buckets = static_cast<Elf_Symndx *>(hash);
-    hash += nbuckets;
-    chain = static_cast<Elf_Symndx *>(hash);
+    if (gnu_hash_addr != 0) {
+      /* nbuckets, symoffset, bloom size and shift, the Bloom filter, the
+         buckets, then one hash per symbol from symoffset on, with the
+         low bit set on the last one of each chain */
+      Elf32_Word *hash = reinterpret_cast<Elf32_Word *> (mem + gnu_hash_addr);
+
+      gnu = true;
+      nbuckets = read_word(hash++);
+      gnu_symoffset = read_word(hash++);
+      gnu_bloom_size = read_word(hash++);
+      gnu_bloom_shift = read_word(hash++);
+      gnu_bloom = hash;
+      hash += gnu_bloom_size;
+      buckets = static_cast<Elf_Symndx *>(hash);
+      hash += nbuckets;
+      chain = static_cast<Elf_Symndx *>(hash);
+
+      /* The table has no symbol count: it ends with the last chain */
+      nchain = gnu_symoffset;
+      for (unsigned int i = 0; i < nbuckets; i++)
+        if (read_word(&buckets[i]) >= nchain)
+          nchain = read_word(&buckets[i]) + 1;
+      if (nchain > gnu_symoffset)
+        while (!(read_word(&chain[nchain - 1 - gnu_symoffset]) & 1))
+          nchain++;
+    } else if (hash_addr != 0) {
+      Elf_Symndx *hash = reinterpret_cast<Elf_Symndx *> (mem + hash_addr);
+
+      nbuckets = read_word(hash++);
+      nchain = read_word(hash++);
+      buckets = static_cast<Elf_Symndx *>(hash);
+      hash += nbuckets;
+      chain = static_cast<Elf_Symndx *>(hash);
+    } else
+      nbuckets = nchain = 0;
     
     symtab = reinterpret_cast<Elf32_Sym *> (mem + symtab_addr);
     strtab = static_cast<unsigned char *> (mem + strtab_addr);
@@ -176,7 +219,10 @@ namespace ac_dynlink {
       versym = reinterpret_cast<Elf_Verndx *> (mem + versym_addr);
   }
   
-  Elf32_Sym *dynamic_symbol_table::lookup_symbol(unsigned int hash, unsigned char *name,
+  /* hash and gnuhash are the ELF and GNU hashes of name; only the one
+     of the table of this object is used */
+  Elf32_Sym *dynamic_symbol_table::lookup_symbol(unsigned int hash, unsigned int gnuhash,
+                                                 unsigned char *name,
 						 char *vername, Elf32_Word verhash) {
     Elf_Symndx symndx;
     Elf32_Sym *symbol = NULL;
@@ -184,13 +230,43 @@ namespace ac_dynlink {
     weak_match = NULL;
     last_match = NULL;
     is_unique_match = true;
-    
-    for ( symndx = buckets[hash % nbuckets];
-	  symndx != STN_UNDEF;
-	  symndx = chain[symndx] ) {
-      symbol = check_symbol(symndx, name, vername, verhash);
-      if (symbol != NULL)
-	return symbol;
+
+    if (nbuckets == 0)
+      return NULL;
+
+    if (gnu) {
+      /* Two bits of the Bloom filter reject most names not defined here
+         without touching the buckets */
+      Elf32_Word word = read_word(&gnu_bloom[(gnuhash / 32) % gnu_bloom_size]);
+      Elf32_Word mask = (1U << (gnuhash % 32)) |
+        (1U << ((gnuhash >> gnu_bloom_shift) % 32));
+
+      if ((word & mask) != mask)
+        return NULL;
+
+      symndx = read_word(&buckets[gnuhash % nbuckets]);
+      if (symndx >= gnu_symoffset) {
+        for (;; symndx++) {
+          Elf32_Word chainhash = read_word(&chain[symndx - gnu_symoffset]);
+
+          /* Names are only compared when the hashes match */
+          if ((chainhash | 1) == (gnuhash | 1)) {
+            symbol = check_symbol(symndx, name, vername, verhash);
+            if (symbol != NULL)
+              return symbol;
+          }
+          if (chainhash & 1)
+            break;
+        }
+      }
+    } else {
+      for ( symndx = read_word(&buckets[hash % nbuckets]);
+            symndx != STN_UNDEF;
+            symndx = read_word(&chain[symndx]) ) {
+        symbol = check_symbol(symndx, name, vername, verhash);
+        if (symbol != NULL)
+          return symbol;
+      }
     }
     
     if (last_match != NULL &&
@@ -52,6 +52,7 @@ namespace ac_dynlink {
     mem = NULL;
     sched_copy = NULL;
     _rtld_global_patched = false;
+    lazy_first = 0;
     this->rtld_config = rtld_config;
   }
 
@@ -195,16 +196,17 @@ namespace ac_dynlink {
     return soname; 
   }
 
-  Elf32_Sym *link_node::lookup_local_symbol(unsigned int hash, unsigned char *name,
+  Elf32_Sym *link_node::lookup_local_symbol(unsigned int hash, unsigned int gnuhash,
+                                            unsigned char *name,
 					    char *vername, Elf32_Word verhash) 
   { 
-    return dyn_table.lookup_symbol(hash, name, vername, verhash);
+    return dyn_table.lookup_symbol(hash, gnuhash, name, vername, verhash);
   }
 
   bool link_node::link_node_setup(Elf32_Addr dynaddr, unsigned char *mem,
 				  Elf32_Addr l_addr, unsigned int t, unsigned char *name,
 				  version_needed *verneed, bool match_endian) {
-    Elf32_Addr hashaddr = 0, symaddr= 0, straddr = 0, reladdr = 0,
+    Elf32_Addr hashaddr = 0, gnuhashaddr = 0, symaddr= 0, straddr = 0, reladdr = 0,
       verneed_addr = 0, verdef_addr = 0, versym_addr = 0, init_addr = 0,
       init_addr_array = 0, init_addr_arraysz = 0, fini_addr = 0,
       fini_addr_array = 0, fini_addr_arraysz = 0;
@@ -222,6 +224,7 @@ namespace ac_dynlink {
     dyn_info.load_dynamic_info(dynaddr, mem, match_endian);
     
     hashaddr = dyn_info.get_value(DT_HASH);
+    gnuhashaddr = dyn_info.get_value(DT_GNU_HASH);
     symaddr = dyn_info.get_value(DT_SYMTAB);
     straddr = dyn_info.get_value(DT_STRTAB);
     verneed_addr = dyn_info.get_value(DT_VERNEED);
@@ -241,6 +244,8 @@ namespace ac_dynlink {
     
     if (hashaddr) 
       hashaddr += l_addr;
+    if (gnuhashaddr) 
+      gnuhashaddr += l_addr;
     if (symaddr) 
       symaddr += l_addr;
     if (straddr) 
@@ -287,7 +292,7 @@ namespace ac_dynlink {
        extracting needed libraries names. */
     dyn_info.set_value(DT_STRTAB, straddr);
     
-    dyn_table.setup_hash(mem, hashaddr, symaddr, straddr, verdef_addr,
+    dyn_table.setup_hash(mem, hashaddr, gnuhashaddr, symaddr, straddr, verdef_addr,
 			 verneed_addr, versym_addr, match_endian);
     
     pltrel = dyn_info.get_value(DT_PLTREL);
@@ -441,21 +446,36 @@ namespace ac_dynlink {
   /* Finds a defined version of the symbol looking through 
      all loaded libraries. If exclude_root is true, skips
      root file symbols when looking for the symbol.
+     Answers, missing symbols included, are kept by the root node, so
+     each name is only looked up once per link.
    */
   Elf32_Sym * link_node::find_symbol(unsigned char *name, char *vername, Elf32_Word verhash, 
                                      bool exclude_root)
   {
     link_node *p = root;
-    unsigned int symhash = dyn_table.elf_hash(name);
+    unsigned int symhash, gnuhash;
     Elf32_Sym *the_symbol = NULL, *weak_sym = NULL;
     symbol_wrapper *symbol;
+    std::string key((char *)name);
+    std::map<std::string, Elf32_Sym *>::iterator cached;
+
+    key += '\n';
+    if (vername != NULL)
+      key += vername;
+    key += exclude_root ? "\n1" : "\n0";
+    cached = root->resolved.find(key);
+    if (cached != root->resolved.end())
+      return cached->second;
+
+    symhash = dyn_table.elf_hash(name);
+    gnuhash = dyn_table.gnu_hash(name);
 
     if (exclude_root == true)
       p = p->get_next();
     
     while (p != NULL)
       {
-	the_symbol = p->lookup_local_symbol(symhash, name, vername, verhash);
+	the_symbol = p->lookup_local_symbol(symhash, gnuhash, name, vername, verhash);
         if (the_symbol != NULL) {
           symbol = new symbol_wrapper(the_symbol, match_endian);
           if (ELF32_ST_BIND(symbol->read_info()) == STB_WEAK) {
@@ -483,7 +503,8 @@ namespace ac_dynlink {
 
     
     if (the_symbol == NULL && weak_sym != NULL)
-      return weak_sym;
+      the_symbol = weak_sym;
+    root->resolved[key] = the_symbol;
     return the_symbol;
   }
   
@@ -507,6 +528,9 @@ namespace ac_dynlink {
 	 i < dyn_relocs.get_size();
 	 i++) 
       {
+	if (!lazy_relocs.empty() && lazy_relocs[i])
+	  continue; /* Resolved on its first call */
+
 	info = dyn_relocs.read_info(i);
 	symndx = ELF32_R_SYM(info);
 	elf_symbol = dyn_table.get_symbol(symndx);
@@ -634,10 +658,91 @@ namespace ac_dynlink {
     }
   }
   
-  /* Walks through object's relocation entries and relocate. */
-  void link_node::apply_relocations(unsigned char *mem, unsigned char word_size)
+  /* Marks the jump slots against undefined symbols, numbering their
+     lazy binding slots from first on, in relocation order. Their
+     indices are appended to relocs. Returns the number marked. */
+  unsigned int link_node::collect_lazy_relocs(unsigned int first,
+                                              std::vector<unsigned int>& relocs)
+  {
+    unsigned int i, n = 0;
+    Elf32_Word info;
+    unsigned reloc_type;
+    symbol_wrapper *symbol;
+
+    lazy_first = first;
+    if (!has_relocations)
+      return 0;
+
+    lazy_relocs.assign(dyn_relocs.get_size(), false);
+    for (i = 0;
+	 i < dyn_relocs.get_size();
+	 i++)
+      {
+	info = dyn_relocs.read_info(i);
+        FETCH_RELOC_TYPE(info, reloc_type);
+	if (reloc_type != 3) /* R_xxxxx_JUMP_SLOT */
+	  continue;
+	symbol = new symbol_wrapper(dyn_table.get_symbol(ELF32_R_SYM(info)), match_endian);
+	if (symbol->read_section_ndx() == SHN_UNDEF &&
+	    ELF32_ST_TYPE(symbol->read_info()) <= STT_FUNC &&
+	    (ELF32_ST_BIND(symbol->read_info()) == STB_GLOBAL ||
+	     ELF32_ST_BIND(symbol->read_info()) == STB_WEAK)) {
+	  lazy_relocs[i] = true;
+	  relocs.push_back(i);
+	  n++;
+	}
+	delete symbol;
+      }
+    return n;
+  }
+
+  /* Resolves the symbol of a lazy jump slot, patches the slot with its
+     address and returns it, for the first call to go on there. */
+  Elf32_Addr link_node::bind_lazy(unsigned int reloc, unsigned char word_size)
+  {
+    Elf32_Word info = dyn_relocs.read_info(reloc), verhash = 0;
+    Elf_Symndx symndx = ELF32_R_SYM(info);
+    symbol_wrapper symbol(dyn_table.get_symbol(symndx), match_endian);
+    Elf32_Addr target;
+    char *vername = NULL;
+
+    if (symbol.read_section_ndx() == SHN_UNDEF) {
+      Elf32_Sym *def_elf_symbol;
+
+      if (dyn_table.get_verneed() != NULL) {
+        Elf32_Half verndx = dyn_table.get_verndx(symndx);
+        vername = dyn_table.get_verneed()->lookup_version(verndx & 0x7fff);
+        verhash = dyn_table.get_verneed()->get_cur_hash();
+      }
+
+      def_elf_symbol = find_symbol(dyn_table.get_name(symbol.read_name_ndx()), vername, verhash, false);
+      if (def_elf_symbol == NULL) {
+        if (ELF32_ST_BIND(symbol.read_info()) != STB_WEAK) {
+          AC_ERROR("Run-time dynamic linker: Symbol \"" <<
+                   dyn_table.get_name(symbol.read_name_ndx()) << "\" unknown.");
+          exit(EXIT_FAILURE);
+        }
+      } else {
+        symbol_wrapper def_symbol(def_elf_symbol, match_endian);
+
+        symbol.write_value(def_symbol.read_value());
+        symbol.write_size(def_symbol.read_size());
+        symbol.write_section_ndx(def_symbol.read_section_ndx());
+        symbol.write_info(def_symbol.read_info());
+      }
+    }
+
+    target = symbol.read_value() + dyn_relocs.read_addend(reloc);
+    patch_code(mem + dyn_relocs.read_offset(reloc) + load_addr, target, word_size);
+    return target;
+  }
+
+  /* Walks through object's relocation entries and relocate. Lazy jump
+     slots get the address of their lazy binding slot, from lazy_base. */
+  void link_node::apply_relocations(unsigned char *mem, unsigned char word_size,
+                                    Elf32_Addr lazy_base)
   {
-    unsigned int i, j, aux;
+    unsigned int i, j, aux, lazy = lazy_first;
     Elf32_Word info;
     Elf32_Addr target, location;
     Elf_Symndx symndx;
@@ -665,6 +770,11 @@ namespace ac_dynlink {
 	location = dyn_relocs.read_offset(i);
 	location += load_addr;
 
+	if (!lazy_relocs.empty() && lazy_relocs[i]) {
+	  patch_code(mem+location, lazy_base + 4 * lazy++, target_size);
+	  continue;
+	}
+
         FETCH_RELOC_TYPE(info, reloc_type);
 	
 	switch(reloc_type)
@@ -725,4 +835,25 @@ namespace ac_dynlink {
       } /* for(i=0;i<dyn_relocs.get_size();i++) */
   } /* apply_relocations() */
 
+  /* Gives the functions this object defines to ac_symbols, at the
+     addresses they were loaded at, so that profiles name them */
+  void link_node::add_functions()
+  {
+    unsigned int i;
+    symbol_wrapper *symbol;
+
+    for (i = 0;
+	 i < dyn_table.get_num_symbols();
+	 i++)
+      {
+	symbol = new symbol_wrapper(dyn_table.get_symbol(i), match_endian);
+	if (ELF32_ST_TYPE(symbol->read_info()) == STT_FUNC &&
+	    symbol->read_section_ndx() != SHN_UNDEF &&
+	    symbol->read_value() != 0)
+	  ac_symbols_add((const char *) dyn_table.get_name(symbol->read_name_ndx()),
+			 symbol->read_value(), symbol->read_size());
+	delete symbol;
+      }
+  } /* add_functions() */
+
 }
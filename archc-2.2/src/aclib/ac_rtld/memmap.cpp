@@ -26,127 +26,106 @@
 #include <unistd.h>
 
 #include "memmap.H"
+#include "ac_checkpoint.H"
 
 //#define DEBUG_MEMORY
 
 namespace ac_dynlink {
 
   /*
-     memmap_node class methods
-   */
-  /* 
-     Default constructor
+     memmap class methods
    */
-  memmap_node::memmap_node(memmap_node * _next, memmap_status _status, Elf32_Addr _addr):
-    next(_next),
-    status(_status),
-    addr(_addr) {
-  }
-    
-  memmap_node* memmap_node::get_next() {
-    return next;
-  }
-    
-  Elf32_Addr memmap_node::get_addr() {
-    return addr;
-  }
-    
-  memmap_status memmap_node::get_status() {
-    return status;
-  }
+  /* Address right after the region, the end of memory for the last one */
+  Elf32_Addr memmap::region_end(region_map::iterator region) {
+    region_map::iterator next = region;
 
-  void memmap_node::set_status(memmap_status value) {
-    status = value;
+    if (++next != regions.end())
+      return next->first;
+    return region->first < memsize ? memsize : region->first;
   }
 
-  void memmap_node::set_next(memmap_node *next) {
-    this->next = next;
-  }
-   
-  /*
-     memmap class methods
-   */
-  void memmap::delete_node(memmap_node *node) {
-    memmap_node *aux = list, *prior = NULL;
-    
-    while (aux != NULL && aux != node){
-      prior = aux;
-      aux = aux->get_next();
-    }
-    if (node == list) {
-      aux = list->get_next();
-      delete list;
-      list = aux;
-    } else {
-      memmap_node *aux2 = aux->get_next();
-      delete aux;
-      prior->set_next(aux2);
+  /* Adds to or removes from the size index the free regions starting
+     between first and last, both included */
+  void memmap::index_regions(Elf32_Addr first, Elf32_Addr last, bool insert) {
+    region_map::iterator aux = regions.lower_bound(first);
+    region_map::iterator stop = regions.upper_bound(last);
+
+    for (; aux != stop; ++aux) {
+      if (aux->second != MS_FREE)
+        continue;
+      std::pair<Elf32_Addr, Elf32_Addr> extent(region_end(aux) - aux->first,
+                                               aux->first);
+      if (insert)
+        free_extents.insert(extent);
+      else
+        free_extents.erase(extent);
     }
   }
 
-  void memmap::fix_consistency() {
-    memmap_node *aux = list->get_next(), *prior=list;
-    
-    /* fixes misplaced nodes */
-    while (aux != NULL) {
-      if (aux->get_addr() <= prior->get_addr() &&
-	  !(aux->get_status() == MS_FREE &&
-	    prior->get_status() == MS_FREE)) {
-	if (prior == list) {
-	  list = aux;
-          delete prior;
-        } else
-          delete_node(prior);
-      }
-      prior = aux;
-      aux = aux->get_next();
-    }
-    
-    /* merges contigous free block regions */
-    aux = list->get_next();
-    prior = list;
-    while (aux != NULL) {
-      if (aux->get_status() == MS_FREE &&
-	  prior->get_status() == MS_FREE) {
-	aux = aux->get_next();
-	delete_node(prior->get_next());
-      } else {
-	prior = aux;
-	aux = aux->get_next();
-      }
-    }    
-  }
+  /* Gives [start, end) a status, as a region of its own. What follows end
+     keeps the status it had; free neighbours are merged */
+  void memmap::set_range(Elf32_Addr start, Elf32_Addr end, memmap_status status) {
+    region_map::iterator aux;
+    Elf32_Addr first;
+    memmap_status after;
 
-  void memmap::free_memmap() {
-    memmap_node *aux = list;
-    if (list == NULL)
+    if (end <= start)
       return;
-    list = list->get_next();
-    delete aux;
-    free_memmap();
+
+    /* The regions whose extent may change: from the one before the region
+       holding start, to the one holding end */
+    aux = regions.upper_bound(start);
+    --aux;
+    if (aux != regions.begin())
+      --aux;
+    first = aux->first;
+    aux = regions.upper_bound(end);
+    --aux;
+    after = aux->second;
+
+    index_regions(first, end, false);
+    regions.erase(regions.upper_bound(start), regions.upper_bound(end));
+    regions[start] = status;
+    regions[end] = after;
+
+    if (status == MS_FREE) {
+      aux = regions.find(start);
+      if (aux != regions.begin()) {
+        --aux;
+        if (aux->second == MS_FREE)
+          regions.erase(start);
+      }
+      if (after == MS_FREE)
+        regions.erase(end);
+    }
+    index_regions(first, end, true);
   }
 
   /* 
      Default constructor
    */
   memmap::memmap() {
-      list = new memmap_node(NULL, MS_FREE, 0);
       pagesize = sysconf(_SC_PAGE_SIZE);
       brkaddr = 0;
       newbrkaddr = 0;
       memsize = 0;
       warning_display = true;
+      regions[0] = MS_FREE;
+      index_regions(0, 0, true);
     }
 
   /* 
      Default destructor
    */
   memmap::~memmap() {
-    free_memmap();
   }
 
   void memmap::set_memsize(Elf32_Addr memsize) {
+    Elf32_Addr last = regions.rbegin()->first;
+
+    index_regions(last, last, false);
     this->memsize = memsize;
+    index_regions(last, last, true);
   }
 
 
@@ -155,20 +134,11 @@ namespace ac_dynlink {
     newbrkaddr = addr;
   }
 
-  memmap_node *memmap::find_region (Elf32_Addr addr) {
-    memmap_node *aux = list;
-    
-    while (aux != NULL) {
-      if (aux->get_addr() == addr)
-	break;
-      aux = aux->get_next();
-    }
-    return aux;
+  bool memmap::find_region (Elf32_Addr addr) {
+    return regions.find(addr) != regions.end();
   }
 
-  memmap_node *memmap::add_region (Elf32_Addr start_addr, Elf32_Word size) {
-    memmap_node *aux = list, *prior = NULL;
-
+  void memmap::add_region (Elf32_Addr start_addr, Elf32_Word size) {
     if (start_addr + ((unsigned)size) > memsize) {
       fprintf(stderr, "ArchC memory manager error: not enough memory in target.\n");
       fprintf(stderr, "  add_region failed: Start address = 0x%X ; Size = 0x%X",
@@ -176,28 +146,15 @@ namespace ac_dynlink {
       fprintf(stderr, " ; Total Mem Size = 0x%X\n", memsize);
       exit(EXIT_FAILURE);
     }
-    
-    while (aux != NULL && aux->get_addr() < start_addr) {
-      prior = aux;
-      aux = aux->get_next();
-    }
-    
-    if (prior == NULL) {
-      prior = aux;
-      aux = aux->get_next();
-    }
-    
-    prior->set_next(new memmap_node(new memmap_node(aux, MS_FREE, start_addr+size), MS_USED, start_addr));
-    fix_consistency();
-    
-    return find_region(start_addr);
+
+    set_range(start_addr, start_addr + size, MS_USED);
   }
 
 #define ALIGN_ADDR(align) ((align) - ((align) % pagesize) + pagesize)
 
   bool memmap::verify_region_availability(Elf32_Addr addr, Elf32_Word size, Elf32_Addr *next_addr)
   {
-    memmap_node *aux = list;
+    region_map::iterator aux, next;
 
     if (addr <= ALIGN_ADDR(newbrkaddr)) {
       if (next_addr != NULL)
@@ -206,22 +163,19 @@ namespace ac_dynlink {
     }
 
     /* Finds the highest region address which is also lower or equal addr*/
-    while (aux->get_next() != NULL) {
-      if (aux->get_next()->get_addr() > addr)
-        break;
-      aux = aux->get_next();
-    }
+    next = regions.upper_bound(addr);
+    aux = next;
+    --aux;
     if (next_addr != NULL)
       *next_addr = 0;
-    if (aux->get_status() == MS_USED) {
-      if (next_addr != NULL && aux->get_next() != NULL)
-        *next_addr = aux->get_next()->get_addr();
+    if (aux->second == MS_USED) {
+      if (next_addr != NULL && next != regions.end())
+        *next_addr = next->first;
       return false; //  this region is occupied
-    } else if (aux->get_next() != NULL &&
-               aux->get_next()->get_status() == MS_USED) {
-      if (addr + ((unsigned)size) > aux->get_next()->get_addr()) {
-        if (next_addr != NULL && aux->get_next()->get_next() != NULL)
-          *next_addr = aux->get_next()->get_next()->get_addr();
+    } else if (next != regions.end() && next->second == MS_USED) {
+      if (addr + ((unsigned)size) > next->first) {
+        if (next_addr != NULL && ++next != regions.end())
+          *next_addr = next->first;
         return false; // not enough space
       }
     }
@@ -231,41 +185,49 @@ namespace ac_dynlink {
   }
   
   Elf32_Addr memmap::suggest_free_region (Elf32_Word size) {
-    memmap_node *aux = list;
-
-    while (aux->get_next() != NULL)
-      aux = aux->get_next();
+    Elf32_Addr last = regions.rbegin()->first;
 
-    if ((aux->get_addr() % pagesize) == 0)
-      return aux->get_addr();
+    if ((last % pagesize) == 0)
+      return last;
     else {
-      return ALIGN_ADDR(aux->get_addr());
+      return ALIGN_ADDR(last);
     }
   }
 
+  /* Best fit among the free regions. The ones the program break or the
+     stack grow into get the mapping in their middle, far from both */
   Elf32_Addr memmap::suggest_mmap_region(Elf32_Word size) {
-    /* Better suggest region far from stack and far from program break */
-    Elf32_Addr addr = ((memsize - newbrkaddr) >> 1) + newbrkaddr;
-    Elf32_Addr nextaddr;
-    bool loop = false;
-    addr = ALIGN_ADDR(addr);
-
-    /* Verify availability */
-    while (!verify_region_availability(addr, size, &nextaddr)) {
-      if (nextaddr != 0 && nextaddr + ((unsigned)size) < memsize)
-        addr = ALIGN_ADDR(nextaddr);
-      else if (!loop) {
-        loop = true;
-        addr = ALIGN_ADDR(brkaddr);
-      } else {
-        if (warning_display) {
-          fprintf(stderr, "ArchC memory manager warning: target ran out of memory - mmap call failed.\n");
-          warning_display = false;
-        }
-        return (Elf32_Addr)-1;
-      }
+    Elf32_Addr lowest = ALIGN_ADDR(ALIGN_ADDR(newbrkaddr));
+    extent_set::iterator aux;
+
+    aux = free_extents.lower_bound(std::make_pair((Elf32_Addr)size, (Elf32_Addr)0));
+    for (; aux != free_extents.end(); ++aux) {
+      Elf32_Addr start = aux->second, end = aux->second + aux->first, addr;
+
+      if (start < lowest)
+        start = lowest;
+      else if (start % pagesize != 0)
+        start = ALIGN_ADDR(start);
+      if (end > memsize)
+        end = memsize;
+      if (start >= end || end - start < (unsigned)size)
+        continue;
+
+      if (aux->second <= newbrkaddr || end == memsize) {
+        addr = start + ((end - start - size) >> 1);
+        addr -= addr % pagesize;
+      } else
+        addr = start;
+
+      if (verify_region_availability(addr, size, NULL))
+        return addr;
     }
-    return addr;
+
+    if (warning_display) {
+      fprintf(stderr, "ArchC memory manager warning: target ran out of memory - mmap call failed.\n");
+      warning_display = false;
+    }
+    return (Elf32_Addr)-1;
   }
 
   Elf32_Addr memmap::mmap_anon(Elf32_Addr addr, Elf32_Word size) {
@@ -296,30 +258,70 @@ namespace ac_dynlink {
     return addr;
   }
 
+  /* Frees the pages of [addr, addr + size), which must start inside a
+     used region; parts of a mapping may be unmapped */
   bool memmap::munmap(Elf32_Addr addr, Elf32_Word size) {
-    memmap_node* aux;
-    if (addr == 0)
+    region_map::iterator aux;
+    Elf32_Addr end = addr + size;
+
+    if (addr == 0 || size == 0)
       return false;
     if (addr % pagesize != 0)
       return false;
-    aux = find_region (addr);
-    if (aux == NULL)
+    aux = regions.upper_bound(addr);
+    --aux;
+    if (aux->second != MS_USED)
       return false;
-    if (aux->get_next() != NULL) {
-      if (aux->get_next()->get_addr() - aux->get_addr() <= size)
-        {
-          aux->set_status(MS_FREE);
-          fix_consistency();
-        }
-    }
+    if (end % pagesize != 0)
+      end = ALIGN_ADDR(end);
+    if (end < addr)
+      end = memsize;
+    set_range(addr, end, MS_FREE);
 #ifdef DEBUG_MEMORY
     fprintf(stderr, "munmap region accepted: addr: %X size: %X brk: %X memsize: %X\n", addr, size, newbrkaddr, memsize);
 #endif
     return true;
   }
 
+  /* The limits, then the address and status of each region */
+  void memmap::save(ac_checkpoint_out& out) {
+    uint32_t count = regions.size();
+
+    out.put(memsize);
+    out.put(brkaddr);
+    out.put(newbrkaddr);
+    out.put(count);
+    for (region_map::iterator aux = regions.begin(); aux != regions.end(); ++aux) {
+      uint32_t status = aux->second;
+      out.put(aux->first);
+      out.put(status);
+    }
+  }
+
+  void memmap::restore(ac_checkpoint_in& in) {
+    uint32_t count;
+
+    regions.clear();
+    free_extents.clear();
+    in.get(memsize);
+    in.get(brkaddr);
+    in.get(newbrkaddr);
+    in.get(count);
+    while (count-- && in.ok()) {
+      Elf32_Addr addr;
+      uint32_t status;
+
+      in.get(addr);
+      in.get(status);
+      regions[addr] = (status == MS_USED ? MS_USED : MS_FREE);
+    }
+    if (regions.empty() || regions.begin()->first != 0)
+      regions[0] = MS_FREE;
+    index_regions(0, regions.rbegin()->first, true);
+  }
+
   Elf32_Addr memmap::brk(Elf32_Addr addr) {
-    memmap_node *aux = list;
+    region_map::iterator aux;
 
     if (addr <= brkaddr)
       return newbrkaddr;
@@ -338,14 +340,12 @@ namespace ac_dynlink {
     }
 
     /* Finds the lowest used region address which is also higher or equal newbrkaddr*/
-    while (aux != NULL) {
-      if (aux->get_addr() >= newbrkaddr && aux->get_status() == MS_USED)
-        break;
-      aux = aux->get_next();
-    }
+    aux = regions.lower_bound(newbrkaddr);
+    while (aux != regions.end() && aux->second != MS_USED)
+      ++aux;
 
-    if (aux != NULL) { 
-      if (addr >= aux->get_addr())
+    if (aux != regions.end()) { 
+      if (addr >= aux->first)
         return newbrkaddr;
     }
 
@@ -0,0 +1,186 @@
+/**
+ * @file      ac_histogram_stats.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   2.0beta2
+ *
+ * @brief     Defines the members of a class for ArchC distribution
+ *            statistics.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Standard includes
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// SystemC includes
+
+// ArchC includes
+#include "ac_histogram_stats.H"
+#include "ac_stats_out.H"
+
+//////////////////////////////////////////////////////////////////////////////
+
+// using statements
+using std::endl;
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructors
+
+ac_histogram_stats::ac_histogram_stats(const char* nm, long long low,
+    long long width, unsigned buckets) :
+  ac_stats_base(),
+  name_(nm),
+  log2_(false),
+  low_(low),
+  width_(width > 0 ? width : 1),
+  buckets_(buckets + 2)
+{
+  allocate();
+}
+
+ac_histogram_stats::ac_histogram_stats(const char* nm) :
+  ac_stats_base(),
+  name_(nm),
+  log2_(true),
+  low_(0),
+  width_(1),
+  buckets_(64)
+{
+  allocate();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Methods
+
+void ac_histogram_stats::allocate()
+{
+  const unsigned per_line = AC_STATS_LINE / sizeof(long long);
+  void* p;
+
+  stride_ = (buckets_ + 2 + per_line - 1) / per_line * per_line;
+  if (posix_memalign(&p, AC_STATS_LINE,
+        (size_t) stride_ * AC_STATS_SHARDS * sizeof(long long))) {
+    fprintf(stderr, "ArchC: Could not allocate the histogram %s.\n",
+        name_.c_str());
+    exit(EXIT_FAILURE);
+  }
+  shards_ = (long long*) p;
+  memset(shards_, 0, (size_t) stride_ * AC_STATS_SHARDS * sizeof(long long));
+}
+
+long long ac_histogram_stats::bucket_low(unsigned b) const
+{
+  if (log2_)
+    return b == 0 ? 0 : 1LL << (b - 1);
+  return low_ + (long long) (b == 0 ? 0 : b - 1) * width_;
+}
+
+long long ac_histogram_stats::bucket(unsigned b) const
+{
+  long long sum = 0;
+
+  for (int s = 0; s < AC_STATS_SHARDS; s++)
+    sum += __atomic_load_n(&shards_[s * stride_ + b], __ATOMIC_RELAXED);
+  return sum;
+}
+
+long long ac_histogram_stats::count() const
+{
+  return bucket(buckets_);
+}
+
+long long ac_histogram_stats::sum() const
+{
+  return bucket(buckets_ + 1);
+}
+
+void ac_histogram_stats::merge(const ac_histogram_stats& other)
+{
+  long long* s = shard();
+
+  if (other.log2_ != log2_ || other.buckets_ != buckets_ ||
+      other.low_ != low_ || other.width_ != width_) {
+    fprintf(stderr, "ArchC: The histogram %s cannot be merged into %s, "
+        "whose buckets differ.\n", other.name_.c_str(), name_.c_str());
+    return;
+  }
+  for (unsigned b = 0; b < buckets_ + 2; b++)
+    s[b] += other.bucket(b);
+}
+
+void ac_histogram_stats::print_stats(ostream& os)
+{
+  long long n = count();
+
+  os << "[ArchC 2.1] Printing DISTRIBUTION statistics " << name_ << ":"
+    << endl;
+  os << "     count : " << n << endl;
+  os << "     sum : " << sum() << endl;
+  if (n)
+    os << "     mean : " << (double) sum() / n << endl;
+
+  for (unsigned b = 0; b < buckets_; b++) {
+    long long in = bucket(b);
+
+    if (!in)
+      continue;
+    if (!log2_ && b == 0)
+      os << "     < " << low_;
+    else if (log2_ && b == 0)
+      os << "     <= 0";
+    else if (b == buckets_ - 1)
+      os << "     >= " << bucket_low(b);
+    else
+      os << "     [" << bucket_low(b) << ", "
+        << (log2_ ? bucket_low(b) * 2 : bucket_low(b) + width_) << ")";
+    os << " : " << in << endl;
+  }
+}
+
+void ac_histogram_stats::add_stats_out(const string& section)
+{
+  string name = section + "." + name_;
+  long long n = count();
+  unsigned last = buckets_;
+
+  ac_stats_out_add(name, "count", n);
+  ac_stats_out_add(name, "sum", sum());
+  ac_stats_out_add(name, "mean", n ? (double) sum() / n : 0);
+  // The powers of two stop at the last one used
+  if (log2_)
+    while (last > 1 && !bucket(last - 1))
+      last--;
+  for (unsigned b = 0; b < last; b++) {
+    char bucket_name[32];
+
+    if (!log2_ && b == 0)
+      snprintf(bucket_name, sizeof(bucket_name), "bucket.below");
+    else
+      snprintf(bucket_name, sizeof(bucket_name), "bucket.%lld", bucket_low(b));
+    ac_stats_out_add(name, bucket_name, bucket(b));
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Destructors
+
+ac_histogram_stats::~ac_histogram_stats()
+{
+  free(shards_);
+}
+
+//////////////////////////////////////////////////////////////////////////////
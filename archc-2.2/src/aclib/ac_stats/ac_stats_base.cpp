@@ -21,11 +21,14 @@
 //////////////////////////////////////////////////////////////////////////////
 
 // Standard includes
+#include <cstdio>
 
 // SystemC includes
 
 // ArchC includes
 #include "ac_stats_base.H"
+#include "ac_basic_stats.H"
+#include "ac_stats_snapshot.H"
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -42,6 +45,9 @@
 /// ac_stats_base default constructor
 ac_stats_base::ac_stats_base()
 {
+  //The first instance adds them all to the dumps of SIGUSR1.
+  if (list_of_stats_.empty())
+    ac_stats_dump_add(dump_all_stats, 0);
   list_of_stats_.push_back(this);
 }
 
@@ -51,6 +57,9 @@ ac_stats_base::ac_stats_base()
 
 list<ac_stats_base*> ac_stats_base::list_of_stats_;
 
+thread_local int ac_stats_thread_shard = -1;
+static int ac_stats_shards_given = 0;
+
 //////////////////////////////////////////////////////////////////////////////
 
 // Methods
@@ -63,6 +72,32 @@ void ac_stats_base::print_all_stats(ostream& os)
   }
 }
 
+void ac_stats_base::dump_all_stats(void*)
+{
+  print_all_stats(std::cerr);
+}
+
+void ac_stats_base::add_all_stats_out()
+{
+  list<ac_stats_base*>::iterator it;
+  for (it = list_of_stats_.begin(); it != list_of_stats_.end(); it++) {
+    (*it)->add_stats_out("stats");
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int ac_stats_new_shard()
+{
+  int shard = __sync_fetch_and_add(&ac_stats_shards_given, 1);
+
+  if (shard == AC_STATS_SHARDS)
+    fprintf(stderr, "ArchC: More than %d threads update statistics; "
+        "those past them share shards, and their counts may race.\n",
+        AC_STATS_SHARDS);
+  return shard % AC_STATS_SHARDS;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 // Destructors
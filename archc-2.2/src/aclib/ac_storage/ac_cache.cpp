@@ -18,9 +18,61 @@
  *
  */
 
+#include <string.h>
 #include "ac_cache.H"
 #include "ac_resources.H"
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+//!Index of the valid line among the n lines of a set whose tag is key, or -1.
+//!Tags are compared several ways at a time when the host has vector units.
+static inline int ac_cache_match(const unsigned* tags, const bool* valid, unsigned n, unsigned key)
+{
+  unsigned e = 0;
+  unsigned bits;
+
+#if defined(__AVX2__)
+  const __m256i key8 = _mm256_set1_epi32(key);
+
+  for (; e + 8 <= n; e += 8) {
+    __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(tags + e)), key8);
+    for (bits = _mm256_movemask_ps(_mm256_castsi256_ps(eq)); bits; bits &= bits - 1)
+      if (valid[e + __builtin_ctz(bits)])
+        return e + __builtin_ctz(bits);
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i key4 = _mm_set1_epi32(key);
+
+  for (; e + 4 <= n; e += 4) {
+    __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(tags + e)), key4);
+    for (bits = _mm_movemask_ps(_mm_castsi128_ps(eq)); bits; bits &= bits - 1)
+      if (valid[e + __builtin_ctz(bits)])
+        return e + __builtin_ctz(bits);
+  }
+#elif defined(__ARM_NEON)
+  const uint32x4_t key4 = vdupq_n_u32(key);
+
+  for (; e + 4 <= n; e += 4) {
+    uint16x4_t eq = vmovn_u32(vceqq_u32(vld1q_u32(tags + e), key4));
+    unsigned long long lanes = vget_lane_u64(vreinterpret_u64_u16(eq), 0);
+
+    for (bits = 0; bits < 4; bits++)
+      if (((lanes >> (16 * bits)) & 1) && valid[e + bits])
+        return e + bits;
+  }
+#endif
+
+  for (; e < n; e++)
+    if (tags[e] == key && valid[e])
+      return e;
+  return -1;
+}
+
 //!Private method for the generation of trace files to be utilized with DineroIV
   void ac_cache::tracing(unsigned address, unsigned type)
   {
@@ -53,39 +105,27 @@
       this->address_tag = address/tag_field;
 //      cout << "ADDRESS TAG: " << address_tag << endl;
       //!Point to the 1st element of the set in question
-      slot_tag = (unsigned *)(this->tag + (this->set * this->set_size));
-      slot_valid = (bool *)(this->valid + (this->set * this->set_size));
-      hit = -1;                           // reset the hit event
-      unsigned *test_tag;                 // tag to compare
-      bool *test_valid;                   // bit_valid to compare
-
-      //Scan the set searching for the tag desired
-      for(this->element = 0; this->element < this->set_size ; this->element++)
-      {
-        test_tag = (unsigned *)(slot_tag + element);
-        test_valid = (bool *)(slot_valid + element);
-
-      	if((*test_tag == address_tag)&&(*test_valid))
-      	{
-      	  hit = element;   //It has found the reference in the set. Gets the line number.
-//      	  cout << "Hit at TAG: " << *test_tag << endl;
-      	}
-      }
+      slot_tag = set_tag(this->set);
+      slot_valid = set_valid(this->set);
+
+      //Scan the set searching for the tag desired. Gets the line number on a hit.
+      hit = ac_cache_match(slot_tag, slot_valid, this->set_size, address_tag);
+      this->element = (hit != -1) ? hit : this->set_size;
       //Points to the correct mapped cache line
       if(hit!=-1) //Whether had got a hit.
       {
          slot_data = (char *)(this->Data + (hit + this->set * this->set_size) *this->block_size * AC_WORDSIZE/8);
-         slot_tag = (unsigned *)(this->tag + (hit + this->set * this->set_size));
-         slot_valid = (bool *)(this->valid + (hit + this->set * this->set_size));
-         slot_dirty = (bool *)(this->dirty + (hit + this->set * this->set_size));
+         slot_tag = set_tag(this->set) + hit;
+         slot_valid = set_valid(this->set) + hit;
+         slot_dirty = set_dirty(this->set) + hit;
       }
       else    //The data was not found in the set
       {
       	 this->element = get_chosen(set);  //chooses the element to be replaced
          slot_data = (char *)(this->Data + (this->element + set * this->set_size) *this->block_size * AC_WORDSIZE/8);
-         slot_tag = (unsigned *)(this->tag + (this->element + set * this->set_size));
-         slot_valid = (bool *)(this->valid + (this->element + set * this->set_size));
-         slot_dirty = (bool *)(this->dirty + (this->element + set * this->set_size));
+         slot_tag = set_tag(set) + this->element;
+         slot_valid = set_valid(set) + this->element;
+         slot_dirty = set_dirty(set) + this->element;
       }
   }
 
@@ -102,8 +142,9 @@
   	   	         if((isWriteBack())&&(isWriteAllocate())&&(this->next_level != NULL)&&(*slot_valid==true)&&(*slot_dirty==true))
   	   	         {
 //  	   	                cout << "writingback" << endl;
-                        this->writingBack();
-                        break;
+                        if(this->writingBack())   //buffered write-backs are not acknowledged
+                            break;
+                        replace_status++;
   	   	         }
   	   	         else
   	   	         {
@@ -125,6 +166,7 @@
                         if(this->next_level != NULL)
                         {
 //                            cout << "address em replaceWrite: " << hex << base_address << endl;
+                            this->wb_drain(base_address);
                             this->next_level->request_block(this, base_address, block_size*AC_WORDSIZE/8);
                             break;
                         }
@@ -169,6 +211,7 @@
 
                  if(this->next_level != NULL)
                  {
+                        this->wb_drain(requested_address);
                  	    if(write_size == W_WORD)
                  	    {
                             this->next_level->request_write(this, requested_address, *(ac_word*)datum_ref);
@@ -200,9 +243,10 @@
   	   	         if((isWriteBack())&&(this->next_level != NULL)&&(*slot_valid==true)&&(*slot_dirty==true))
   	   	         {
 //  	   	         	    cout << "address before WB: " << address << endl;
-                         this->writingBack();
+                         if(this->writingBack())   //buffered write-backs are not acknowledged
+                             break;
 //  	   	         	    cout << "address after WB: " << address << endl;
-                         break;
+                         replace_status++;
                  }
   	   	         else
   	   	         {
@@ -220,6 +264,7 @@
                  {
 //                       cout << "address_base em replaceRead: " << hex << base_address << "address: " << address << endl;
 //                       cout << "requested address: " << requested_address << endl;
+                       this->wb_drain(base_address);
                        this->next_level->request_block(this, base_address, block_size*AC_WORDSIZE/8);
                        break;
                  }
@@ -229,8 +274,9 @@
   	   }
   }
 
-//!Private method utilized to store back to the lower level the modified data cache
-  void ac_cache::writingBack()
+//!Private method utilized to store back to the lower level the modified data cache.
+//!Returns whether an acknowledge comes for it: buffered write-backs get none.
+  bool ac_cache::writingBack()
   {
               //rebuilding the reference to be stored back in the lower level
               unsigned index_shift  = ((AC_WORDSIZE/8) * this->block_size);
@@ -238,10 +284,62 @@
               unsigned base_address = (*slot_tag)*tag_shift + set*index_shift;
 //              cout << "tag_shift: " << tag_shift << "index_shift: " << index_shift << endl;
 //              cout << "buffer enviado: " << (int)slot_data << endl;
-              this->next_level->request_write_block(this, base_address, this->slot_data, this->block_size*AC_WORDSIZE/8);
-//              cout << "data sent: " << hex << *(unsigned *)(slot_data)  << " Address: " << base_address << endl;
               *slot_dirty = false;
+              writebacks++;
+              if(!wb_lines)
+              {
+                   writeback_writes++;
+                   this->next_level->request_write_block(this, base_address, this->slot_data, index_shift);
+//              cout << "data sent: " << hex << *(unsigned *)(slot_data)  << " Address: " << base_address << endl;
+                   return true;
+              }
+
+              //Merged with the buffered lines when adjacent to them, on either side
+              if((wb_bytes) && (base_address == wb_address + wb_bytes))
+              {
+                   memcpy(wb_buffer + wb_bytes, this->slot_data, index_shift);
+              }
+              else if((wb_bytes) && (base_address + index_shift == wb_address))
+              {
+                   memmove(wb_buffer + index_shift, wb_buffer, wb_bytes);
+                   memcpy(wb_buffer, this->slot_data, index_shift);
+                   wb_address = base_address;
+              }
+              else
+              {
+                   this->flush_writebacks();
+                   memcpy(wb_buffer, this->slot_data, index_shift);
+                   wb_address = base_address;
+              }
+              wb_bytes += index_shift;
+              if(wb_bytes == wb_lines*index_shift)
+                   this->flush_writebacks();
+              return false;
+  }
+
+  void ac_cache::set_writeback_coalescing(unsigned n)
+  {
+      this->flush_writebacks();
+      delete[] wb_buffer;
+      wb_lines = (n > 1) ? n : 0;
+      wb_buffer = wb_lines ? new char[wb_lines*block_size*AC_WORDSIZE/8] : NULL;
+  }
+
+  void ac_cache::flush_writebacks()
+  {
+      if(!wb_bytes)
+          return;
+      writeback_writes++;
+      this->next_level->request_write_block(this, wb_address, wb_buffer, wb_bytes);
+      wb_bytes = 0;
+  }
 
+  //!Requests to the next level for a buffered line must find it written.
+  //!Write-through caches buffer nothing, their writes need no drain.
+  void ac_cache::wb_drain(unsigned address)
+  {
+      if((wb_bytes) && (address - wb_address < wb_bytes))
+          this->flush_writebacks();
   }
 
 
@@ -278,18 +376,19 @@
   }
 
 
-//!Read a word from the address passed as parameter
-  ac_word ac_cache::read( unsigned address ) /*const*/
+//!Looks up a read of address, starting its miss. Returns whether it hit.
+  bool ac_cache::read_lookup( unsigned address )
   {
       read_access_type = true;
-      ac_word data_out;                    //hold the requested Data
+      bool data_hit;
       this->ac_cache::addressing(address); //slicing the address field
+      data_hit = (hit != -1);
 #ifdef  AC_TRACE                           //! Trace files generating
       this->ac_cache::tracing(address, 0); //access trace file registering a read operation
 #endif
       //Read hit
       if(hit != -1){
-//         data_out = ac_storage::read(slot_data + offset - Data);
+         this->demand_hit();
       }
       //Read Miss
       else if (this->next_level != NULL)
@@ -297,72 +396,54 @@
 #ifdef AC_STATS
          ac_resources::ac_sim_stats.add_miss(name);
 #endif
-         this->stall();    //Stalls the processor, while the data is being provided
-//         replace_status = 0;
-         requested_address = address;
-         this->replaceBlockRead(requested_address); // imitando o write, original address
+         if(num_mshrs)
+         {
+            this->mshr_miss(address, 0, 0);
+         }
+         else
+         {
+            this->stall();    //Stalls the processor, while the data is being provided
+//            replace_status = 0;
+            requested_address = address;
+            this->replaceBlockRead(requested_address);
+         }
       }
+      return data_hit;
+  }
+
+//!Read a word from the address passed as parameter
+  ac_word ac_cache::read( unsigned address ) /*const*/
+  {
+      ac_word data_out;                    //hold the requested Data
+      bool data_hit = this->read_lookup(address);
       data_out = ac_storage::read(slot_data + offset - Data);
       //Updates the tracking for replacement policies
       this->update(set, element);
+      this->prefetch(address, data_hit);
       return (data_out);
   }
 
   //!Reading a byte
   unsigned char ac_cache::read_byte( unsigned address )
   {
-      read_access_type = true;
       unsigned char data_out;                    //hold the requested Data
-      this->ac_cache::addressing(address); //slicing the address field
-#ifdef  AC_TRACE                           //! Trace files generating
-      this->ac_cache::tracing(address, 0); //access trace file registering a read operation
-#endif
-      //Read hit
-      if(hit != -1){
-      }
-      //Read Miss
-      else if (this->next_level != NULL)
-      {
-#ifdef AC_STATS
-         ac_resources::ac_sim_stats.add_miss(name);
-#endif
-         this->stall();    //Stalls the processor, while the data is being provided
-//         replace_status = 0;
-         requested_address = address;
-         this->replaceBlockRead(requested_address);
-      }
+      bool data_hit = this->read_lookup(address);
       data_out = ac_storage::read_byte(slot_data + offset - Data);
       //Updates the tracking for replacement policies
       this->update(set, element);
+      this->prefetch(address, data_hit);
       return (data_out);
   }
 
   //!Reading half word
   ac_Hword ac_cache::read_half( unsigned address )
   {
-      read_access_type = true;
       ac_Hword data_out;                    //hold the requested Data
-      this->ac_cache::addressing(address); //slicing the address field
-#ifdef  AC_TRACE                           //! Trace files generating
-      this->ac_cache::tracing(address, 0); //access trace file registering a read operation
-#endif
-      //Read hit
-      if(hit != -1){
-      }
-      //Read Miss
-      else if (this->next_level != NULL)
-      {
-#ifdef AC_STATS
-         ac_resources::ac_sim_stats.add_miss(name);
-#endif
-         this->stall();    //Stalls the processor, while the data is being provided
-//         replace_status = 0;
-         requested_address = address;
-         this->replaceBlockRead(requested_address);
-      }
+      bool data_hit = this->read_lookup(address);
       data_out = ac_storage::read_half(slot_data + offset - Data);
       //Updates the tracking for replacement policies
       this->update(set, element);
+      this->prefetch(address, data_hit);
       return (data_out);
   }
 
@@ -371,12 +452,15 @@
   void ac_cache::write( unsigned address, ac_word datum )
   {
       read_access_type = false;
+      bool data_hit;
       this->ac_cache::addressing(address);        //slicing the address field
+      data_hit = (hit != -1);
 #ifdef  AC_TRACE                                  //! Trace files generating
       this->ac_cache::tracing(address, 1);        //access trace file registering a write operation
 #endif
       //Write hit
       if(hit != -1){
+         this->demand_hit();
         //DIRTY SUJO
          if(isWriteBack())
          {
@@ -384,7 +468,12 @@
          }
          else if(isWriteThrough())
          {
-            if(this->next_level != NULL)
+            if((this->next_level != NULL)&&(num_mshrs))
+            {
+                //Posted: the acknowledge is not waited for
+                this->next_level->request_write(this, address, datum);
+            }
+            else if(this->next_level != NULL)
             {
                 //WAIT
                 this->stall();
@@ -409,7 +498,11 @@
 #ifdef AC_STATS
          ac_resources::ac_sim_stats.add_miss(name);
 #endif
-         if(this->next_level != NULL)
+         if((this->next_level != NULL)&&(num_mshrs))
+         {
+            this->mshr_miss(address, W_WORD, datum);
+         }
+         else if(this->next_level != NULL)
          {
             //WAIT
             if(!isWriteAround()) //Only if the data must be locally writen
@@ -432,6 +525,7 @@
          }
       }
       this->update(set, element);
+      this->prefetch(address, data_hit);
   }
 
 
@@ -439,12 +533,15 @@
   void ac_cache::write_byte( unsigned address, unsigned char datum )
   {
       read_access_type = false;
+      bool data_hit;
       this->ac_cache::addressing(address);        //slicing the address field
+      data_hit = (hit != -1);
 #ifdef  AC_TRACE                                  //! Trace files generating
       this->ac_cache::tracing(address, 1);        //access trace file registering a write operation
 #endif
       //Write hit
       if(hit != -1){
+         this->demand_hit();
         //DIRTY SUJO
          if(isWriteBack())
          {
@@ -452,7 +549,12 @@
          }
          else if(isWriteThrough())
          {
-            if(this->next_level != NULL)
+            if((this->next_level != NULL)&&(num_mshrs))
+            {
+                //Posted: the acknowledge is not waited for
+                this->next_level->request_write_byte(this, address, datum);
+            }
+            else if(this->next_level != NULL)
             {
                 //WAIT
                 this->stall();
@@ -473,7 +575,11 @@
 #ifdef AC_STATS
          ac_resources::ac_sim_stats.add_miss(name);
 #endif
-         if(this->next_level != NULL)
+         if((this->next_level != NULL)&&(num_mshrs))
+         {
+            this->mshr_miss(address, W_BYTE, datum);
+         }
+         else if(this->next_level != NULL)
          {
             //WAIT
             if(!isWriteAround()) //Only if the data must be locally writen
@@ -494,6 +600,7 @@
          }
       }
       this->update(set, element);
+      this->prefetch(address, data_hit);
   }
 
 
@@ -501,12 +608,15 @@
   void ac_cache::write_half( unsigned address, unsigned short datum )
   {
       read_access_type = false;
+      bool data_hit;
       this->ac_cache::addressing(address);        //slicing the address field
+      data_hit = (hit != -1);
 #ifdef  AC_TRACE                                  //! Trace files generating
       this->ac_cache::tracing(address, 1);        //access trace file registering a write operation
 #endif
       //Write hit
       if(hit != -1){
+         this->demand_hit();
         //DIRTY SUJO
          if(isWriteBack())
          {
@@ -514,7 +624,12 @@
          }
          else if(isWriteThrough())
          {
-            if(this->next_level != NULL)
+            if((this->next_level != NULL)&&(num_mshrs))
+            {
+                //Posted: the acknowledge is not waited for
+                this->next_level->request_write_half(this, address, datum);
+            }
+            else if(this->next_level != NULL)
             {
                 //WAIT
                 this->stall();
@@ -537,7 +652,11 @@
 #ifdef AC_STATS
          ac_resources::ac_sim_stats.add_miss(name);
 #endif
-         if(this->next_level != NULL)
+         if((this->next_level != NULL)&&(num_mshrs))
+         {
+            this->mshr_miss(address, W_HALF, datum);
+         }
+         else if(this->next_level != NULL)
          {
             //WAIT
             if(!isWriteAround()) //Only if the data must be locally writen
@@ -558,11 +677,13 @@
          }
       }
       this->update(set, element);
+      this->prefetch(address, data_hit);
   }
 
   //!
   //!Constructor. Where 'n' is the Name, 'bs' is Block Size in number of words, 'nb' is the Number of Blocks,
-  //!'ss' is the Set Size in blocks per set and 'st' is the Strategy used for replacement (LRU or RANDOM)
+  //!'ss' is the Set Size in blocks per set and 'st' is the Strategy used for replacement (LRU, PLRU, BITPLRU,
+  //!SRRIP, BRRIP or RANDOM)
   //!'wp' is the write policiy
   //!
   ac_cache::ac_cache( char *n, unsigned bs, unsigned nb, unsigned ss, unsigned st, unsigned char wp) :
@@ -572,28 +693,74 @@
     set_size (ss),
     num_sets (nb/ss),
     strategy (st),
-    write_policy (wp)
+    write_policy (wp),
+    mshr (NULL),
+    num_mshrs (0),
+    mshr_head (0),
+    mshr_used (0),
+    mshr_wait (-1),
+    full_pending (false),
+    primary_misses (0),
+    merged_misses (0),
+    full_stalls (0),
+    hits_under_miss (0),
+    prefetcher (NULL),
+    access_pc (0),
+    prefetches_issued (0),
+    prefetches_useful (0),
+    prefetches_late (0),
+    wb_buffer (NULL),
+    wb_lines (0),
+    wb_address (0),
+    wb_bytes (0),
+    forwarding_block (false),
+    writebacks (0),
+    writeback_writes (0)
   {
-    request_block_event = false;
     request_write_block_event = false;
     request_write_event = false;
+    replace_status = 0;
 //  	SC_METHOD(process_request);
 //    sensitive << *bhv_pc;
 
    	next_level = NULL;
    	previous_level = NULL;
-    tag = new unsigned[this->num_blocks];
-    valid = new bool[this->num_blocks];
-    dirty = new bool[this->num_blocks];
+    //LRU ranks are kept as unsigned shorts
+    if (this->set_size > 65536) {
+      fprintf(stderr, "ArchC ERROR: cache %s: sets of more than 65536 lines are not supported.\n", n);
+      exit(EXIT_FAILURE);
+    }
+    if (this->strategy == PLRU && (this->set_size & (this->set_size - 1))) {
+      fprintf(stderr, "ArchC ERROR: cache %s: tree pseudo-LRU needs a power-of-two set size.\n", n);
+      exit(EXIT_FAILURE);
+    }
+    rng = 2463534242U;
+
+    //Each set record starts on a host cache line
+    set_stride = (this->set_size * (sizeof(unsigned) + 2 * sizeof(bool) + sizeof(unsigned short)) + 63) & ~63U;
+    if (posix_memalign((void**)&sets, 64, (size_t)set_stride * this->num_sets)) {
+      fprintf(stderr, "ArchC ERROR: cache %s: out of memory.\n", n);
+      exit(EXIT_FAILURE);
+    }
     chosen = new unsigned[this->num_sets];
-//    cout << "Chosen reference" << chosen << endl;
-    tracker = new unsigned[this->num_blocks];
-
-
-//    cout << "Valid reference" << valid << endl;
-    *valid = false;
-
-    *dirty = false;
+    prefetched = new bool[this->num_blocks];
+    for (unsigned b = 0; b < this->num_blocks; b++)
+      prefetched[b] = false;
+
+    for (unsigned s = 0; s < this->num_sets; s++) {
+      for (unsigned e = 0; e < this->set_size; e++) {
+        set_tag(s)[e] = 0;
+        set_valid(s)[e] = false;
+        set_dirty(s)[e] = false;
+        if (this->strategy == LRU)
+          set_repl(s)[e] = e;
+        else if (this->strategy == SRRIP || this->strategy == BRRIP)
+          set_repl(s)[e] = RRIP_MAX;
+        else
+          set_repl(s)[e] = 0;
+      }
+      chosen[s] = 0;
+    }
 //    request_buffer = new char[block_size*(AC_WORDSIZE/8)];
     datum_ref = new char[4];
 #ifdef AC_TRACE
@@ -612,16 +779,14 @@
 //      fprintf(stderr, "Antes de detonar next 0x%x \n", next_level);
 //      next_level = NULL;
 //      fprintf(stderr, "Depois de detonar next 0x%x \n", next_level);
-//      fprintf(stderr, "Antes de detonar tag 0x%x \n", tag);
-      delete[] tag;
-//      fprintf(stderr, "Antes de detonar Valid 0x%x \n", valid);
-      delete[] valid;
-//      fprintf(stderr, "Antes de detonar dirty 0x%x \n", dirty);
-      delete[] dirty;
+      free(sets);
 //      fprintf(stderr, "Antes de detonar chosen 0x%x \n", chosen);
       delete[] chosen;
-//      fprintf(stderr, "Antes de detonar tracker 0x%x \n", tracker);
-      delete[] tracker;
+      delete[] prefetched;
+      for (unsigned m = 0; m < num_mshrs; m++)
+        delete[] mshr[m].written;
+      delete[] mshr;
+      delete[] wb_buffer;
 #ifdef AC_TRACE
 //      closing the trace file generated
       ac_cache::trace.close();
@@ -643,28 +808,48 @@
   }
 
   unsigned ac_cache::get_chosen(unsigned s){
-      unsigned maximum = 0;    //initiates the maximum
-      long double norm;
+      unsigned short* repl = set_repl(s);
+      unsigned t, node;
       switch(this->strategy)
       {
           case LRU:      //!Least-recently used (LRU)
-            for (unsigned t = 0 ; t < (unsigned)this->set_size ; t = t + sizeof(unsigned)) //searches for the maximum age
+            for (t = 0 ; t < (unsigned)this->set_size ; t++) //searches for the oldest line
             {
-               if( *(tracker + s*this->set_size + t) > maximum )
+               if( repl[t] == this->set_size - 1 )
                {
-               	   maximum = *(tracker + s*this->set_size + t);
                	   *(chosen + s) = t;                  //select the entry to be replaced
+               	   break;
                }
-               if(*(chosen + s) > this->set_size)
-                   *(chosen + s) = 0;
             }
             break;
 
+          case PLRU:     //!Follows the tree bits, which point away from recent accesses
+            for (node = 0; node < this->set_size - 1; node = 2 * node + 1 + repl[node])
+              ;
+            *(chosen + s) = node - (this->set_size - 1);
+            break;
+
+          case BITPLRU:  //!First line not used since the bits were last cleared
+            for (t = 0 ; t < (unsigned)this->set_size - 1 && repl[t] ; t++)
+              ;
+            *(chosen + s) = t;
+            break;
+
+          case SRRIP:    //!First line predicted to be re-referenced in the distant future
+          case BRRIP:
+            for (;;) {
+              for (t = 0 ; t < (unsigned)this->set_size && repl[t] != RRIP_MAX ; t++)
+                ;
+              if (t < (unsigned)this->set_size)
+                break;
+              for (t = 0 ; t < (unsigned)this->set_size ; t++)
+                repl[t]++;
+            }
+            *(chosen + s) = t;
+            break;
+
           case RANDOM:   //!Spreads allocation uniformly
-            srand((int)(chosen + s));
-            norm = rand();
-            norm = norm * (this->set_size - 1);
-            *(chosen + s) = (unsigned)((set_size-1)*(rand()/(double)RAND_MAX));
+            *(chosen + s) = next_random() % set_size;
             break;
 
           default:
@@ -681,11 +866,53 @@
   //!Method that implements the policies of replacement, based on the last access
   void ac_cache::update(unsigned s, unsigned e)
   {
-      for (unsigned t = 0 ; t < (unsigned)this->set_size ; t++)
+      unsigned short* repl = set_repl(s);
+      unsigned short last;
+      unsigned t, node;
+
+      switch(this->strategy)
       {
-          *(tracker + s*this->set_size + t) += 1; //incremets all Tracker's entries inside the set
+          case LRU:
+            //Lines used more recently than e age by one, keeping the ranks a permutation
+            last = repl[e];
+            for (t = 0 ; t < (unsigned)this->set_size ; t++)
+            {
+                if (repl[t] < last)
+                    repl[t]++;
+            }
+            repl[e] = 0;     //registering the last access
+            break;
+
+          case PLRU:
+            //Every node on the path to e points to its other child
+            for (node = e + this->set_size - 1; node; node = (node - 1) / 2)
+                repl[(node - 1) / 2] = (node & 1);
+            break;
+
+          case BITPLRU:
+            repl[e] = 1;
+            for (t = 0 ; t < (unsigned)this->set_size && repl[t] ; t++)
+              ;
+            if (t == (unsigned)this->set_size)   //all lines used: start a new period
+            {
+                for (t = 0 ; t < (unsigned)this->set_size ; t++)
+                    repl[t] = 0;
+                repl[e] = 1;
+            }
+            break;
+
+          case SRRIP:
+          case BRRIP:
+            //Hits are predicted to come back soon. Filled lines are predicted to
+            //come back late, and BRRIP inserts most of them at the distant end.
+            if (hit != -1)
+                repl[e] = 0;
+            else if (this->strategy == SRRIP || (next_random() & 31) == 0)
+                repl[e] = RRIP_MAX - 1;
+            else
+                repl[e] = RRIP_MAX;
+            break;
       }
-      *(tracker + s*this->set_size + e) = 0;     //registering the last access
   }
 
   unsigned ac_cache::get_codeSize(){
@@ -709,6 +936,249 @@
   }
 
 
+/*
+################################################################################
+##############           NON-BLOCKING MISSES             #######################
+################################################################################
+*/
+  void ac_cache::set_mshrs(unsigned n)
+  {
+      if (mshr_used || full_pending) {
+        fprintf(stderr, "ArchC ERROR: cache %s: MSHRs changed with misses outstanding.\n", this->get_name());
+        exit(EXIT_FAILURE);
+      }
+      for (unsigned m = 0; m < num_mshrs; m++)
+        delete[] mshr[m].written;
+      delete[] mshr;
+
+      mshr = n ? new mshr_entry[n] : NULL;
+      for (unsigned m = 0; m < n; m++)
+        mshr[m].written = new bool[block_size*AC_WORDSIZE/8];
+      num_mshrs = n;
+      mshr_head = 0;
+  }
+
+  //!MSHR of the outstanding miss of block, or -1
+  int ac_cache::mshr_find(unsigned block)
+  {
+      for (unsigned i = 0; i < mshr_used; i++) {
+        unsigned m = (mshr_head + i) % num_mshrs;
+        if (mshr[m].block == block)
+          return m;
+      }
+      return -1;
+  }
+
+  //!Takes a line of the current set for block and requests the block from
+  //!the next level. Returns its MSHR, or -1 if all are in use or every
+  //!line of the set is waiting for a fill.
+  int ac_cache::mshr_issue(unsigned block)
+  {
+      unsigned e, i, j, m;
+
+      if (mshr_used == num_mshrs)
+        return -1;
+
+      //Lines waiting for a fill are not replaced: try the chosen one, then the next ones
+      for (e = element, i = 0; i < set_size; i++, e = (e + 1) % set_size) {
+        for (j = 0; j < mshr_used; j++) {
+          m = (mshr_head + j) % num_mshrs;
+          if (mshr[m].set == set && mshr[m].element == e)
+            break;
+        }
+        if (j == mshr_used)
+          break;
+      }
+      if (i == set_size)
+        return -1;
+
+      element = e;
+      slot_data = (char *)(this->Data + (element + set * this->set_size) *this->block_size * AC_WORDSIZE/8);
+      slot_tag = set_tag(set) + element;
+      slot_valid = set_valid(set) + element;
+      slot_dirty = set_dirty(set) + element;
+
+      //The victim is written back at once, without waiting for the acknowledge
+      if ((isWriteBack()) && (*slot_valid == true) && (*slot_dirty == true))
+        this->writingBack();
+      *slot_tag = address_tag;
+      *slot_valid = false;
+      *slot_dirty = false;
+
+      m = (mshr_head + mshr_used++) % num_mshrs;
+      mshr[m].block = block;
+      mshr[m].set = set;
+      mshr[m].element = element;
+      mshr[m].prefetch = false;
+      prefetched[element + set * this->set_size] = false;
+      for (i = 0; i < block_size*AC_WORDSIZE/8; i++)
+        mshr[m].written[i] = false;
+
+      this->wb_drain(block);
+      this->next_level->request_block(this, block, block_size*AC_WORDSIZE/8);
+      return m;
+  }
+
+  //!Marks the bytes of the current access as written in the line MSHR m fills
+  void ac_cache::mshr_written(int m, int size)
+  {
+      for (int b = 0; b < size; b++)
+        mshr[m].written[offset + b] = true;
+  }
+
+  //!Miss of a non-blocking cache. A read stalls the processor until its
+  //!block arrives, a write is done on the line being filled and goes on.
+  void ac_cache::mshr_miss(unsigned address, int size, ac_word datum)
+  {
+      unsigned block = address - address % (block_size*AC_WORDSIZE/8);
+      int m = mshr_find(block);
+
+      //Writes that do not allocate only go to the next level
+      if ((size) && (m == -1) && (!isWriteAllocate())) {
+        this->wb_drain(address);
+        if (size == W_WORD)
+          this->next_level->request_write(this, address, datum);
+        else if (size == W_HALF)
+          this->next_level->request_write_half(this, address, (unsigned short)datum);
+        else
+          this->next_level->request_write_byte(this, address, (unsigned char)datum);
+        return;
+      }
+
+      if (m != -1) {
+        //Secondary miss: the block is on its way already
+        merged_misses++;
+        if (mshr[m].prefetch) {
+          mshr[m].prefetch = false;
+          prefetches_late++;
+        }
+        element = mshr[m].element;
+        slot_data = (char *)(this->Data + (element + set * this->set_size) *this->block_size * AC_WORDSIZE/8);
+        slot_tag = set_tag(set) + element;
+        slot_valid = set_valid(set) + element;
+        slot_dirty = set_dirty(set) + element;
+      }
+      else if ((m = mshr_issue(block)) != -1) {
+        primary_misses++;
+      }
+      else {
+        //No MSHR (or no line) free: wait for a fill, then issue the access again
+        full_stalls++;
+        full_pending = true;
+        full_address = address;
+        full_size = size;
+        full_datum = datum;
+        this->stall();
+        return;
+      }
+
+      if (!size) {
+        mshr_wait = m;
+        this->stall();    //Stalls the processor, while the data is being provided
+        return;
+      }
+
+      //WRITE LOCAL, kept over the fill
+      if (size == W_WORD)
+        this->ac_storage::write(slot_data + offset - Data, datum);
+      else if (size == W_HALF)
+        this->ac_storage::write_half(slot_data + offset - Data, (unsigned short)datum);
+      else
+        this->ac_storage::write_byte(slot_data + offset - Data, (unsigned char)datum);
+      mshr_written(m, size);
+
+      if (isWriteBack())
+        *(slot_dirty) = true;
+      else if (size == W_WORD)
+        this->next_level->request_write(this, address, datum);
+      else if (size == W_HALF)
+        this->next_level->request_write_half(this, address, (unsigned short)datum);
+      else
+        this->next_level->request_write_byte(this, address, (unsigned char)datum);
+  }
+
+  //!Fills the line of the oldest outstanding miss with block
+  void ac_cache::mshr_fill(char* block)
+  {
+      int m = mshr_head;
+      char* line = (char *)(this->Data + (mshr[m].element + mshr[m].set * this->set_size) *this->block_size * AC_WORDSIZE/8);
+
+      for (unsigned b = 0; b < block_size*AC_WORDSIZE/8; b++)
+        if (!mshr[m].written[b])
+          line[b] = block[b];
+      set_valid(mshr[m].set)[mshr[m].element] = true;
+      prefetched[mshr[m].element + mshr[m].set * this->set_size] = mshr[m].prefetch;
+
+      mshr_head = (mshr_head + 1) % num_mshrs;
+      mshr_used--;
+
+      if (mshr_wait == m) {
+        mshr_wait = -1;
+        this->ready();
+      }
+      else if (full_pending) {
+        full_pending = false;
+        this->ready();
+        if (full_size == W_WORD)
+          this->write(full_address, full_datum);
+        else if (full_size == W_HALF)
+          this->write_half(full_address, (unsigned short)full_datum);
+        else if (full_size == W_BYTE)
+          this->write_byte(full_address, (unsigned char)full_datum);
+        else
+          this->read(full_address);
+      }
+  }
+
+  //!Hit statistics. Prefetched lines count as useful at their first hit.
+  void ac_cache::demand_hit()
+  {
+      unsigned line = element + set * this->set_size;
+
+      if (mshr_used)
+        hits_under_miss++;
+      if (prefetched[line]) {
+        prefetched[line] = false;
+        prefetches_useful++;
+      }
+  }
+
+/*
+################################################################################
+##############                PREFETCHING                #######################
+################################################################################
+*/
+  void ac_cache::set_prefetcher(ac_prefetcher* p)
+  {
+      prefetcher = p;
+      if (p)
+        p->set_block_bytes(block_size*AC_WORDSIZE/8);
+  }
+
+  //!Gives the access to the prefetcher and requests the blocks it asks for
+  //!that are neither present nor requested already
+  void ac_cache::prefetch(unsigned address, bool was_hit)
+  {
+      unsigned blocks[8];
+      unsigned n, i;
+      int m;
+
+      if (!prefetcher || !num_mshrs || this->next_level == NULL)
+        return;
+
+      n = prefetcher->access(access_pc, address, was_hit, blocks, 8);
+      //One MSHR is always left to demand misses
+      for (i = 0; i < n && mshr_used + 1 < num_mshrs; i++) {
+        this->ac_cache::addressing(blocks[i]);
+        if (hit != -1 || mshr_find(blocks[i]) != -1)
+          continue;
+        if ((m = mshr_issue(blocks[i])) != -1) {
+          mshr[m].prefetch = true;
+          prefetches_issued++;
+        }
+      }
+  }
+
 /*
 ################################################################################
 ##############                 INTERFACE                 #######################
@@ -719,14 +1189,25 @@
   {
 //  	   cout << "requesting from" << this->get_name() << endl;
   	   // cout << "size in bytes: " << dec << size << endl;
+       unsigned line_bytes = block_size*AC_WORDSIZE/8;
+       char* request_buffer = new char[size_bytes];
+       unsigned done, chunk;
+       bool data_hit;
+
        client_global = client;
-       request_buffer = new char[size_bytes*(AC_WORDSIZE/8)];
-       for (unsigned offset_word = 0; offset_word < size_bytes; offset_word+=AC_WORDSIZE/8)
+       //One access for each line of this cache the block covers, not one per word,
+       //so a miss requests its block from the next level once
+       for (done = 0; done < size_bytes; done += chunk)
        {
-          *(ac_word *)(request_buffer + offset_word) = this->read(address + offset_word);
-           //cout << "bloco requisitado" << *(ac_word *)(request_buffer + offset_word) << endl;
+          chunk = line_bytes - (address + done) % line_bytes;
+          if (chunk > size_bytes - done)
+             chunk = size_bytes - done;
+          data_hit = this->read_lookup(address + done);
+          memcpy(request_buffer + done, slot_data + offset, chunk);
+          this->update(set, element);
+          this->prefetch(address + done, data_hit);
        }
-       request_block_event = true;
+       request_buffers.push_back(request_buffer);
        //client->response_block(request_buffer);
 
    }
@@ -735,8 +1216,10 @@
        if (request_write_block_event) {
           request_write_block_event = false;
           client_global->response_write_block();
-       }else if (request_block_event) {
-          request_block_event = false;
+       }else if (!request_buffers.empty()) {
+          //One block per call, in the order they were requested
+          char* request_buffer = request_buffers.front();
+          request_buffers.pop_front();
           client_global->response_block(request_buffer);
        }else if (request_write_event) {
           request_write_event = false;
@@ -777,11 +1260,50 @@
 
   void ac_cache::request_write_block(ac_cache_if* client, unsigned address, char* datum, unsigned size_bytes)
   {
+       unsigned line_bytes = block_size*AC_WORDSIZE/8;
+       unsigned done, chunk;
+
   	   client_global = client;
-  	   for (unsigned offset_word = 0; offset_word < size_bytes; offset_word+=AC_WORDSIZE/8)
-  	   {
-           write(address + offset_word/**AC_WORDSIZE/8*/, *(ac_word*)(datum + offset_word/**AC_WORDSIZE/8*/));
+       for (done = 0; done < size_bytes; done += chunk)
+       {
+          chunk = line_bytes - (address + done) % line_bytes;
+          if (chunk > size_bytes - done)
+             chunk = size_bytes - done;
+          read_access_type = false;
+          this->ac_cache::addressing(address + done);
+          //A whole line that hits is written at once, and written through as one block
+          if ((chunk == line_bytes) && (hit != -1) && ((isWriteBack()) || (isWriteThrough())))
+          {
+#ifdef  AC_TRACE
+             this->ac_cache::tracing(address + done, 1);
+#endif
+             this->demand_hit();
+             memcpy(slot_data, datum + done, chunk);
+             if (isWriteBack())
+             {
+                *(slot_dirty) = true;
+             }
+             else if ((this->next_level != NULL) && (num_mshrs))
+             {
+                //Posted: the acknowledge is not waited for
+                this->next_level->request_write_block(this, address + done, slot_data, chunk);
+             }
+             else if (this->next_level != NULL)
+             {
+                this->stall();
+                forwarding_block = true;
+                this->next_level->request_write_block(this, address + done, slot_data, chunk);
+             }
+             this->update(set, element);
+             this->prefetch(address + done, true);
+             continue;
+          }
+          //Partial lines and misses take the path of the processor writes
+          for (unsigned offset_word = 0; offset_word < chunk; offset_word+=AC_WORDSIZE/8)
+          {
+             write(address + done + offset_word, *(ac_word*)(datum + done + offset_word));
 //           cout << "Data stored: " << read(address + offset_word) << endl;
+          }
        }
 
        request_write_block_event = true;
@@ -790,6 +1312,13 @@
 
   void ac_cache::response_block(char* block)
   {
+       if(num_mshrs)
+       {
+            this->mshr_fill(block);
+            delete[] block;
+            return;
+       }
+       prefetched[(slot_data - Data) / (block_size*AC_WORDSIZE/8)] = false;
        *(slot_tag) = address_tag;
 //       cout << "address tag: " << address_tag << endl;
        *(slot_valid) = true;
@@ -824,11 +1353,21 @@
 
   void ac_cache::response_write()
   {
+       if(num_mshrs)      //posted writes
+            return;
        this->ready();
   }
 
   void ac_cache::response_write_block()
   {
+       if(forwarding_block)      //a block written through
+       {
+            forwarding_block = false;
+            this->ready();
+            return;
+       }
+       if((num_mshrs) || (wb_lines))      //posted write backs
+            return;
   	replace_status++;
        if(read_access_type)
             this->replaceBlockRead(requested_address);
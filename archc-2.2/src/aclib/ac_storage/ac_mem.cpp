@@ -67,7 +67,6 @@
   ac_mem::ac_mem( char *n, unsigned s) :
     ac_storage(n, s)
   {
-    request_block_event = false;
     request_write_block_event = false;
     request_write_event = false;
    	next_level = NULL;
@@ -120,22 +119,22 @@
   {
 //  	    cout << "requesting from" << this->get_name() << endl;
 //  	    cout << "size in bytes: " << size_bytes << endl;
+       char* request_buffer = new char[size_bytes];
+
        client_global = client;
-       request_buffer = new char[size_bytes*(AC_WORDSIZE/8)];
 //       cout << "request block em MEM no address: " << address << endl;
-       for (unsigned offset_word = 0; offset_word < size_bytes; offset_word+=AC_WORDSIZE/8)
-       {
-          *(ac_word *)(request_buffer + offset_word) = this->read(address + offset_word);
-//           cout << " bloco requisitado" << *(ac_word *)(request_buffer + offset_word) << " from: " << (address + offset_word) << endl;
-       }
-       request_block_event = true;
+       //The whole block in one copy, as a burst
+       this->ac_storage::read_block((uint8_t*) request_buffer, address, size_bytes);
+       request_buffers.push_back(request_buffer);
        //client->response_block(request_buffer);
 
    }
 
   void ac_mem::process_request() {
-       if (request_block_event) {
-          request_block_event = false;
+       if (!request_buffers.empty()) {
+          //One block per call, in the order they were requested
+          char* request_buffer = request_buffers.front();
+          request_buffers.pop_front();
           client_global->response_block(request_buffer);
        }else if (request_write_block_event) {
           request_write_block_event = false;
@@ -183,14 +182,9 @@
   {
 
   	   client_global = client;
-  	   for (unsigned offset_word = 0; offset_word < size_bytes; offset_word+=AC_WORDSIZE/8)
-//  	   for (unsigned offset_word = 0; offset_word < size; offset_word++)
-  	   {
-           write(address + offset_word/**AC_WORDSIZE/8*/, *(ac_word*)(datum + offset_word/**AC_WORDSIZE/8*/));
-//           cout << "buffer recebido em " << (int)datum << endl;
-//           cout << " mem escrita Block: " << read(address + offset_word) << endl;
-//           cout << "Data stored: " << hex << read(address + offset_word) << " Address: " << (address + offset_word) << endl;
-       }
+       //The whole block in one copy, as a burst
+       this->ac_storage::write_block((const uint8_t*) datum, address, size_bytes);
+//       cout << "Data stored: " << hex << read(address) << " Address: " << address << endl;
 //       cout << "Guardei o bloco no proximo nivel" << endl;
        request_write_block_event = true;
        //client->response_write_block();
@@ -0,0 +1,137 @@
+/**
+ * @file      ac_shared_code.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Code pages of a storage shared by the memory ports of the
+ *            cores of a multi-core simulation, on host threads.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Standard includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ArchC includes
+#include "ac_shared_code.H"
+
+//////////////////////////////////////////////////////////////////////////////
+
+ac_shared_code* ac_shared_code::tables = 0;
+
+ac_shared_code::ac_shared_code(const void* stg) : storage(stg),
+                                                  ports(0),
+                                                  users(0),
+                                                  holders(0),
+                                                  page_count(0),
+                                                  page_bits(0) {
+  memset(written, 0, sizeof(written));
+  memset(pending, 0, sizeof(pending));
+  next = tables;
+  tables = this;
+}
+
+ac_shared_code::~ac_shared_code()
+{
+  ac_shared_code** t;
+
+  for (t = &tables; *t != this; t = &(*t)->next)
+    ;
+  *t = next;
+  for (unsigned i = 0; i < kMaxPorts; i++)
+    delete[] written[i];
+  delete[] holders;
+}
+
+/// The table of storage, made by the first port to join.
+ac_shared_code* ac_shared_code::join(const void* storage, unsigned& port)
+{
+  ac_shared_code* t;
+
+  for (t = tables; t && t->storage != storage; t = t->next)
+    ;
+  if (!t)
+    t = new ac_shared_code(storage);
+  if (t->ports == kMaxPorts) {
+    fprintf(stderr, "ArchC: At most %d memory ports can share a storage.\n", kMaxPorts);
+    exit(EXIT_FAILURE);
+  }
+  port = t->ports++;
+  t->users++;
+  return t;
+}
+
+/// Port leaves; the last one deletes the table.
+void ac_shared_code::leave(unsigned port)
+{
+  delete[] written[port];
+  written[port] = 0;
+  if (!--users)
+    delete this;
+}
+
+/// Port decodes code from count pages of 2^bits bytes. The ports of the
+/// cores of a platform watch pages of the same size.
+void ac_shared_code::watch(unsigned port, uint32_t count, unsigned bits)
+{
+  if (!holders) {
+    page_count = count;
+    page_bits = bits;
+    holders = new uint64_t[count];
+    memset(holders, 0, count * sizeof(uint64_t));
+  }
+  else if (bits != page_bits || count != page_count) {
+    fprintf(stderr, "ArchC: Memory ports sharing a storage watch code pages of different sizes.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (!written[port]) {
+    written[port] = new uint8_t[count];
+    memset(written[port], 0, count);
+  }
+}
+
+/// Flags page for the ports in others that still hold code of it. The
+/// writes to the page so far are seen by a port once it sees the flag.
+void ac_shared_code::post(uint32_t page, uint64_t others)
+{
+  //Only the ports whose bit this write cleared are flagged
+  others &= __atomic_fetch_and(&holders[page], ~others, __ATOMIC_RELAXED);
+  for (unsigned i = 0; others; i++, others >>= 1)
+    if ((others & 1) && written[i]) {
+      __atomic_store_n(&written[i][page], 1, __ATOMIC_RELAXED);
+      __atomic_store_n(&pending[i], 1, __ATOMIC_RELEASE);
+    }
+}
+
+/// Port wrote every page.
+void ac_shared_code::wrote_all(unsigned port)
+{
+  for (uint32_t page = 0; page < page_count; page++)
+    wrote(port, page << page_bits, 1);
+}
+
+/// The first page from page on flagged for port, unflagged.
+uint32_t ac_shared_code::take(unsigned port, uint32_t page)
+{
+  uint8_t* w = written[port];
+
+  for (; w && page < page_count; page++)
+    if (__atomic_load_n(&w[page], __ATOMIC_RELAXED)) {
+      __atomic_store_n(&w[page], 0, __ATOMIC_RELAXED);
+      return page;
+    }
+  return page_count;
+}
@@ -16,18 +16,67 @@
  *
  */
 
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "ac_storage.H"
+#include "ac_guard.H"
+#include "ac_host_place.H"
+
+//Huge pages are only transparent ones: map_file() and clear() swap in
+//pages of the host size
+static bool storage_hugepages() {
+  const char* hugepages = getenv(ENV_AC_STORAGE_HUGEPAGES);
+
+  if (hugepages && *hugepages)
+    return *hugepages != '0';
+  return ac_host_hugepages() != AC_HOST_PAGES_SMALL;
+}
 
 // constructor
-ac_storage::ac_storage(string nm, uint32_t sz) :
+ac_storage::ac_storage(string nm, uint32_t sz, bool guard) :
   name(nm),
-  size(sz) {
-  data.ptr8 = new unsigned char[sz];
+  size(sz),
+  mapped(false),
+  guarded(false) {
+  void* p = MAP_FAILED;
+
+  //The memory ports of guarded simulators check no bounds, so there is no
+  //falling back to a storage of size bytes
+  if (guard) {
+    p = ac_guard_reserve(1, sz, name.c_str());
+    if (!p) {
+      fprintf(stderr, "ArchC: Could not reserve the address space of %s for --guard-memory.\n", name.c_str());
+      exit(EXIT_FAILURE);
+    }
+    guarded = true;
+  }
+
+  //Reserves no swap: untouched pages cost nothing, and read as zeros
+  if (p == MAP_FAILED && sz >= AC_STORAGE_MAP_THRESHOLD)
+    p = mmap(NULL, sz, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+  if (p != MAP_FAILED) {
+    mapped = true;
+    data.ptr8 = (uint8_t*) p;
+    ac_host_advise(p, sz, storage_hugepages());
+  }
+  else
+    data.ptr8 = new unsigned char[sz]();
 }
 
 // destructor
 ac_storage::~ac_storage() {
-  delete[] data.ptr8;
+  if (guarded)
+    ac_guard_release(data.ptr8, 1);
+  else if (mapped)
+    munmap(data.ptr8, size);
+  else
+    delete[] data.ptr8;
 }
 
 // getters and setters
@@ -43,6 +92,62 @@ uint32_t ac_storage::get_size() const {
   return size;
 }
 
+uint8_t* ac_storage::get_data() {
+  return data.ptr8;
+}
+
+uint64_t ac_storage::get_direct_span() {
+  return guarded ? ac_guard_span(1) : size;
+}
+
+//Only mapped storages can take file pages, at page-aligned addresses
+uint32_t ac_storage::map_file(int fd, uint32_t offset, uint32_t address, uint32_t n) {
+  long page = sysconf(_SC_PAGESIZE);
+  uint32_t len;
+
+  if (!mapped || page <= 0 || (address % page) || (offset % page) ||
+      (uint64_t) address + n > size)
+    return 0;
+
+  len = n - n % page;
+  if (!len)
+    return 0;
+
+  if (mmap(data.ptr8 + address, len, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_FIXED, fd, offset) == MAP_FAILED) {
+    //Put back zero pages in case the old ones were already dropped
+    mmap(data.ptr8 + address, len, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+    return 0;
+  }
+  return len;
+}
+
+//Whole pages of mapped storages go back to the host as fresh zero pages
+void ac_storage::clear(uint32_t address, uint32_t n) {
+  long page = sysconf(_SC_PAGESIZE);
+  uint32_t first, last;
+
+  if ((uint64_t) address + n > size)
+    n = address < size ? size - address : 0;
+  if (!mapped || page <= 0 || n < page) {
+    memset(data.ptr8 + address, 0, n);
+    return;
+  }
+
+  first = address + (page - address % page) % page;
+  last = (address + n) - (address + n) % page;
+  if (first < last &&
+      mmap(data.ptr8 + first, last - first, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0) != MAP_FAILED) {
+    ac_host_advise(data.ptr8 + first, last - first, storage_hugepages());
+    memset(data.ptr8 + address, 0, first - address);
+    memset(data.ptr8 + last, 0, address + n - last);
+  }
+  else
+    memset(data.ptr8 + address, 0, n);
+}
+
 void ac_storage::read(ac_ptr buf, uint32_t address,
 		      int wordsize) {
   switch (wordsize) {
@@ -70,26 +175,12 @@ void ac_storage::read(ac_ptr buf, uint32_t address,
 void ac_storage::read(ac_ptr buf, uint32_t address,
 		      int wordsize, int n_words) {
   switch (wordsize) {
-  case 8: { // unsigned char
-    for (int i = 0; i < n_words; i++)
-      (buf.ptr8)[i] = (data.ptr8)[address + i];
+  case 8:
+  case 16:
+  case 32:
+  case 64: // words start at the aligned address below address
+    read_block(buf.ptr8, address & ~(wordsize / 8 - 1), n_words * (wordsize / 8));
     break;
-  }      
-  case 16: { // unsigned short
-    for (int i = 0; i < n_words; i++)
-      (buf.ptr16)[i] = (data.ptr16)[address / 2 + i];
-    break;
-  }
-  case 32: { // unsigned int
-    for (int i = 0; i < n_words; i++)
-      (buf.ptr32)[i] = (data.ptr32)[address / 4 + i];
-    break;
-  }
-  case 64: { // unsigned long long
-    for (int i = 0; i < n_words; i++)
-      (buf.ptr64)[i] = (data.ptr64)[address / 8 + i];
-    break;
-  }
   default: // weird size
     break;
   }
@@ -122,31 +213,25 @@ void ac_storage::write(ac_ptr buf, uint32_t address,
 void ac_storage::write(ac_ptr buf, uint32_t address,
 		       int wordsize, int n_words) {
   switch (wordsize) {
-  case 8: { // unsigned char
-    for (int i = 0; i < n_words; i++)
-      (data.ptr8)[address + i] = (buf.ptr8)[i];
-    break;
-  }
-  case 16: { // unsigned short
-    for (int i = 0; i < n_words; i++)
-      (data.ptr16)[address / 2 + i] = (buf.ptr16)[i];
-    break;
-  }
-  case 32: { // unsigned int
-    for (int i = 0; i < n_words; i++)
-      (data.ptr32)[address / 4 + i] = (buf.ptr32)[i];
-    break;
-  }
-  case 64: { // unsigned long long
-    for (int i = 0; i < n_words; i++)
-      (data.ptr64)[address / 8 + i] = (buf.ptr64)[i];
+  case 8:
+  case 16:
+  case 32:
+  case 64: // words start at the aligned address below address
+    write_block(buf.ptr8, address & ~(wordsize / 8 - 1), n_words * (wordsize / 8));
     break;
-  }
   default: // weird size
     break;
   }
 }
 
+void ac_storage::read_block(uint8_t* buf, uint32_t address, uint32_t size) {
+  memcpy(buf, data.ptr8 + address, size);
+}
+
+void ac_storage::write_block(const uint8_t* buf, uint32_t address, uint32_t size) {
+  memcpy(data.ptr8 + address, buf, size);
+}
+
 /** 
  * Locks the device.
  * 
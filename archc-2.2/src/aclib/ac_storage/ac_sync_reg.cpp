@@ -0,0 +1,36 @@
+/**
+ * @file      ac_sync_reg.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Cycle update of the synchronous registers without the
+ *            SystemC kernel (AC_SYNC_REG_DIRTY).
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <algorithm>
+
+#include "ac_sync_reg.H"
+
+thread_local std::vector<ac_sync_reg_base*> ac_sync_reg_dirty;
+
+ac_sync_reg_base::~ac_sync_reg_base() {
+  if (dirty)
+    ac_sync_reg_dirty.erase(std::remove(ac_sync_reg_dirty.begin(), ac_sync_reg_dirty.end(), this),
+                            ac_sync_reg_dirty.end());
+}
+
+void ac_sync_reg_update() {
+  //A register is only listed once a cycle, and commits list none
+  for (size_t i = 0; i < ac_sync_reg_dirty.size(); i++)
+    ac_sync_reg_dirty[i]->commit();
+  ac_sync_reg_dirty.clear();
+}
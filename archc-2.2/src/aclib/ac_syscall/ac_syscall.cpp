@@ -16,6 +16,26 @@
  *
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ac_checkpoint.H"
+#include "ac_stats_out.H"
+#include "ac_syscall_output.H"
+#include "ac_syscall_profile.H"
+#include "ac_syscall_replay.H"
+#include "ac_syscall_vfs.H"
+#include "ac_utils.H"
+
 #define NEWLIB_O_RDONLY          0x0000
 #define NEWLIB_O_WRONLY          0x0001
 #define NEWLIB_O_RDWR            0x0002
@@ -62,3 +82,342 @@ void correct_flags( int* val )
 
   *val = flags;
 }
+
+//!A host descriptor opened for the application.
+struct ac_syscall_file {
+  std::string pathname;
+  int flags;
+};
+
+static std::map<int, ac_syscall_file> ac_syscall_files;
+
+void ac_syscall_opened( int fd, const char* pathname, int flags )
+{
+  //Files in memory are saved by their own checkpoint section
+  if (ac_vfs_owns(fd))
+    return;
+  ac_syscall_files[fd].pathname = pathname;
+  ac_syscall_files[fd].flags = flags;
+}
+
+void ac_syscall_closed( int fd )
+{
+  ac_syscall_files.erase(fd);
+}
+
+void ac_syscall_duped( int fd, int newfd )
+{
+  std::map<int, ac_syscall_file>::iterator i = ac_syscall_files.find(fd);
+
+  if (i != ac_syscall_files.end() && !ac_vfs_owns(newfd))
+    ac_syscall_files[newfd] = i->second;
+}
+
+//!Saves the open files with their offsets, and reopens them on restore.
+//!Files the application created must still exist when restoring.
+static class ac_syscall_files_section : public ac_checkpoint_section {
+public:
+  ac_syscall_files_section() : ac_checkpoint_section("syscall.files") {}
+
+  void save(ac_checkpoint_out& out) {
+    std::map<int, ac_syscall_file>::iterator i;
+    uint32_t count = ac_syscall_files.size();
+
+    out.put(count);
+    for (i = ac_syscall_files.begin(); i != ac_syscall_files.end(); i++) {
+      int32_t fd = i->first;
+      int32_t flags = i->second.flags;
+      int64_t offset = lseek(fd, 0, SEEK_CUR);
+      uint32_t len = i->second.pathname.size();
+
+      out.put(fd);
+      out.put(flags);
+      out.put(offset);
+      out.put(len);
+      out.put(i->second.pathname.data(), len);
+    }
+  }
+
+  void restore(ac_checkpoint_in& in) {
+    std::map<int, ac_syscall_file>::iterator i;
+    uint32_t count;
+
+    for (i = ac_syscall_files.begin(); i != ac_syscall_files.end(); i++)
+      ::close(i->first);
+    ac_syscall_files.clear();
+
+    in.get(count);
+    while (count-- && in.ok()) {
+      int32_t fd, flags;
+      int64_t offset;
+      uint32_t len;
+      std::string pathname;
+      int ret;
+
+      in.get(fd);
+      in.get(flags);
+      in.get(offset);
+      in.get(len);
+      pathname.resize(len);
+      if (len)
+        in.get(&pathname[0], len);
+      if (!in.ok())
+        break;
+      //A replay takes what the files returned from its log
+      if (ac_syscall_replaying())
+        continue;
+
+      //The file is already as the application left it, do not recreate it
+      ret = ::open(pathname.c_str(), flags & ~(O_CREAT | O_EXCL | O_TRUNC));
+      if (ret == -1) {
+        AC_WARN("Could not reopen '" << pathname << "' as file descriptor " << fd << " from checkpoint.");
+        continue;
+      }
+      if (ret != fd) {
+        dup2(ret, fd);
+        ::close(ret);
+      }
+      lseek(fd, offset, SEEK_SET);
+      ac_syscall_opened(fd, pathname.c_str(), flags);
+    }
+  }
+} ac_syscall_files_checkpoint;
+
+//!Standard output and error of the application, in the order written.
+static class ac_syscall_output_buffer {
+  std::vector<char> data;
+  std::vector<std::pair<int, size_t> > runs; //!< Descriptor and size of each run of writes to it
+  size_t limit;                 //!< 0 if writes are not buffered
+  long long max_age;            //!< Nanoseconds the oldest byte may wait, 0 if any
+  long long oldest;             //!< When it was buffered
+  bool discard;
+  bool configured;
+
+  static long long now() {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+  }
+
+  void configure() {
+    const char* size = getenv(ENV_AC_SYSCALL_BUFFER);
+    const char* ms = getenv(ENV_AC_SYSCALL_FLUSH_MS);
+    const char* drop = getenv(ENV_AC_SYSCALL_DISCARD);
+    char* end;
+
+    configured = true;
+    limit = 0;
+    if (size && *size) {
+      limit = strtoul(size, &end, 10);
+      if (*end == 'k' || *end == 'K')
+        limit <<= 10;
+      else if (*end == 'm' || *end == 'M')
+        limit <<= 20;
+    }
+    max_age = ms && *ms ? strtoll(ms, NULL, 10) * 1000000LL : 0;
+    discard = drop && *drop && *drop != '0';
+    data.reserve(limit);
+  }
+
+  static void write_all(int fd, const char* buf, size_t count) {
+    while (count) {
+      ssize_t n = ::write(fd, buf, count);
+
+      if (n == -1 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return;
+      buf += n;
+      count -= n;
+    }
+  }
+
+public:
+  ac_syscall_output_buffer() : limit(0), max_age(0), oldest(0), discard(false), configured(false) {}
+  ~ac_syscall_output_buffer() { flush(); }
+
+  ssize_t write(int fd, const void* buf, size_t count) {
+    if (!configured)
+      configure();
+    if (fd != STDOUT_FILENO && fd != STDERR_FILENO)
+      return ac_vfs_write(fd, buf, count);
+    if (discard)
+      return count;
+    if (!limit)
+      return ::write(fd, buf, count);
+
+    if (data.size() + count > limit)
+      flush();
+    if (count >= limit) {
+      write_all(fd, (const char*) buf, count);
+      return count;
+    }
+    if (data.empty() && max_age)
+      oldest = now();
+    data.insert(data.end(), (const char*) buf, (const char*) buf + count);
+    if (!runs.empty() && runs.back().first == fd)
+      runs.back().second += count;
+    else
+      runs.push_back(std::make_pair(fd, count));
+    if (max_age && now() - oldest >= max_age)
+      flush();
+    return count;
+  }
+
+  void flush() {
+    size_t start = 0;
+
+    for (size_t i = 0; i < runs.size(); i++) {
+      write_all(runs[i].first, &data[start], runs[i].second);
+      start += runs[i].second;
+    }
+    data.clear();
+    runs.clear();
+  }
+} ac_syscall_output_buffer;
+
+ssize_t ac_syscall_output( int fd, const void* buf, size_t count )
+{
+  return ac_syscall_output_buffer.write(fd, buf, count);
+}
+
+void ac_syscall_flush()
+{
+  ac_syscall_output_buffer.flush();
+}
+
+//!Calls, bytes and host nanoseconds of each system call profiled.
+struct ac_syscall_profile_entry {
+  unsigned long long calls;
+  long long bytes;
+  long long ns;
+};
+
+static class ac_syscall_profile {
+  typedef std::pair<std::string, int> key; //!< Name, and number or -1
+
+  std::map<key, ac_syscall_profile_entry> entries;
+  key current;
+  long long start;
+  long long bytes;
+  int depth;                    //!< Calls made while one is being timed count in it
+  int enabled;                  //!< -1 until the environment is read
+
+  static long long now() {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+  }
+
+  static bool slower(const std::pair<key, ac_syscall_profile_entry>& a,
+                     const std::pair<key, ac_syscall_profile_entry>& b) {
+    return a.second.ns > b.second.ns;
+  }
+
+public:
+  ac_syscall_profile() : start(0), bytes(0), depth(0), enabled(-1) {}
+
+  bool on() {
+    if (enabled < 0) {
+      const char* env = getenv(ENV_AC_SYSCALL_PROFILE);
+      enabled = env && *env && *env != '0';
+    }
+    return enabled;
+  }
+
+  void begin(const char* name, int code) {
+    if (depth++)
+      return;
+    current = key(name, code);
+    bytes = 0;
+    start = now();
+  }
+
+  void number(int code) {
+    if (depth == 1)
+      current.second = code;
+  }
+
+  void add_bytes(long long n) {
+    if (depth)
+      bytes += n;
+  }
+
+  void end() {
+    if (!depth || --depth)
+      return;
+    ac_syscall_profile_entry& e = entries[current];
+    e.calls++;
+    e.bytes += bytes;
+    e.ns += now() - start;
+  }
+
+  void print(double real_seconds) {
+    std::vector<std::pair<key, ac_syscall_profile_entry> > sorted(entries.begin(), entries.end());
+    ac_syscall_profile_entry total = {0, 0, 0};
+    char name[64];
+
+    if (!on())
+      return;
+    std::stable_sort(sorted.begin(), sorted.end(), slower);
+    fprintf(stderr, "ArchC: System calls\n");
+    for (size_t i = 0; i < sorted.size(); i++) {
+      const ac_syscall_profile_entry& e = sorted[i].second;
+
+      if (sorted[i].first.second < 0)
+        snprintf(name, sizeof(name), "%s", sorted[i].first.first.c_str());
+      else
+        snprintf(name, sizeof(name), "%s %d", sorted[i].first.first.c_str(), sorted[i].first.second);
+      fprintf(stderr, "    %-24s %10llu calls, %12lld bytes, %10.3f ms\n", name, e.calls, e.bytes, e.ns / 1e6);
+      total.calls += e.calls;
+      total.bytes += e.bytes;
+      total.ns += e.ns;
+      if (ac_stats_out_enabled()) {
+        ac_stats_out_add("syscalls", std::string(name) + ".calls", e.calls);
+        ac_stats_out_add("syscalls", std::string(name) + ".bytes", e.bytes);
+        ac_stats_out_add("syscalls", std::string(name) + ".seconds", e.ns / 1e9);
+      }
+    }
+    fprintf(stderr, "    %-24s %10llu calls, %12lld bytes, %10.3f ms", "Total:", total.calls, total.bytes, total.ns / 1e6);
+    if (real_seconds > 0)
+      fprintf(stderr, " (%.2f %% of the real time)", total.ns / 1e7 / real_seconds);
+    fprintf(stderr, "\n");
+    if (ac_stats_out_enabled()) {
+      ac_stats_out_add("syscalls", "calls", total.calls);
+      ac_stats_out_add("syscalls", "bytes", total.bytes);
+      ac_stats_out_add("syscalls", "seconds", total.ns / 1e9);
+    }
+  }
+} ac_syscall_profile;
+
+bool ac_syscall_profile_enabled()
+{
+  return ac_syscall_profile.on();
+}
+
+void ac_syscall_profile_begin( const char* name, int code )
+{
+  ac_syscall_profile.begin(name, code);
+}
+
+void ac_syscall_profile_code( int code )
+{
+  ac_syscall_profile.number(code);
+}
+
+void ac_syscall_profile_bytes( long long bytes )
+{
+  ac_syscall_profile.add_bytes(bytes);
+}
+
+void ac_syscall_profile_end()
+{
+  ac_syscall_profile.end();
+}
+
+void ac_syscall_profile_print( double real_seconds )
+{
+  ac_syscall_profile.print(real_seconds);
+}
@@ -0,0 +1,257 @@
+/**
+ * @file      ac_syscall_replay.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Record and replay of the system calls of the application.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "ac_checkpoint.H"
+#include "ac_syscall_replay.H"
+#include "ac_utils.H"
+
+//!Each log starts with the magic, the version and the number of calls
+//!made before it, then holds one record per call: the kind, the result
+//!as a zigzag varint, errno if it is -1, the size of the data and the
+//!data, all sizes as varints.
+static const char ac_replay_magic[4] = {'A', 'C', 'S', 'R'};
+static const uint32_t ac_replay_version = 1;
+
+static class ac_syscall_log {
+  FILE* out;                    //!< Log being recorded
+  pid_t owner;                  //!< Process recording it
+  std::vector<unsigned char> in; //!< Log being replayed
+  size_t pos;                   //!< Of the next record in it
+  uint64_t base;                //!< Calls made before the log started
+  uint64_t calls;               //!< Calls made so far
+  const char* name;
+  bool configured;
+
+  void configure() {
+    const char* record = getenv(ENV_AC_SYSCALL_RECORD);
+    const char* replay = getenv(ENV_AC_SYSCALL_REPLAY);
+
+    configured = true;
+    if (record && *record && replay && *replay) {
+      AC_ERROR("Only one of " ENV_AC_SYSCALL_RECORD " and " ENV_AC_SYSCALL_REPLAY " can be set.");
+      exit(EXIT_FAILURE);
+    }
+    if (record && *record) {
+      name = record;
+      if (!(out = fopen(record, "wb"))) {
+        AC_ERROR("Could not create the system call log '" << record << "'.");
+        exit(EXIT_FAILURE);
+      }
+      owner = getpid();
+      base = calls;
+      fwrite(ac_replay_magic, 1, sizeof(ac_replay_magic), out);
+      fwrite(&ac_replay_version, sizeof(ac_replay_version), 1, out);
+      fwrite(&base, sizeof(base), 1, out);
+    }
+    else if (replay && *replay)
+      load(replay);
+  }
+
+  void load(const char* file) {
+    FILE* f = fopen(file, "rb");
+    unsigned char buf[65536];
+    size_t n;
+    uint32_t version;
+
+    name = file;
+    if (!f) {
+      AC_ERROR("Could not open the system call log '" << file << "'.");
+      exit(EXIT_FAILURE);
+    }
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+      in.insert(in.end(), buf, buf + n);
+    fclose(f);
+
+    if (in.size() < sizeof(ac_replay_magic) + sizeof(version) + sizeof(base) ||
+        memcmp(&in[0], ac_replay_magic, sizeof(ac_replay_magic))) {
+      AC_ERROR("'" << file << "' is not a system call log.");
+      exit(EXIT_FAILURE);
+    }
+    memcpy(&version, &in[sizeof(ac_replay_magic)], sizeof(version));
+    if (version != ac_replay_version) {
+      AC_ERROR("System call log '" << file << "' has version " << version << ", not " << ac_replay_version << ".");
+      exit(EXIT_FAILURE);
+    }
+    memcpy(&base, &in[sizeof(ac_replay_magic) + sizeof(version)], sizeof(base));
+    skip();
+  }
+
+  //!Moves to the record of the call numbered calls.
+  void skip() {
+    uint64_t n;
+
+    pos = sizeof(ac_replay_magic) + sizeof(ac_replay_version) + sizeof(base);
+    if (calls < base) {
+      AC_ERROR("System call log '" << name << "' starts after call " << calls << ".");
+      exit(EXIT_FAILURE);
+    }
+    for (n = base; n < calls; n++) {
+      long long ret;
+      int err;
+      size_t size;
+
+      if (!next(ret, err, size)) {
+        AC_ERROR("System call log '" << name << "' ends before call " << calls << ".");
+        exit(EXIT_FAILURE);
+      }
+      pos += size;
+    }
+  }
+
+  void put_varint(uint64_t v) {
+    unsigned char buf[10];
+    int n = 0;
+
+    while (v >= 0x80) {
+      buf[n++] = (v & 0x7f) | 0x80;
+      v >>= 7;
+    }
+    buf[n++] = v;
+    fwrite(buf, 1, n, out);
+  }
+
+  bool get_varint(uint64_t& v) {
+    int shift;
+
+    v = 0;
+    for (shift = 0; pos < in.size() && shift < 64; shift += 7) {
+      unsigned char b = in[pos++];
+
+      v |= (uint64_t) (b & 0x7f) << shift;
+      if (!(b & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  //!Reads the header of the next record, leaving pos at its data.
+  bool next(long long& ret, int& err, size_t& size, int* kind = 0) {
+    uint64_t v, e = 0, s;
+
+    if (pos >= in.size())
+      return false;
+    if (kind)
+      *kind = in[pos];
+    pos++;
+    if (!get_varint(v))
+      return false;
+    ret = (long long) (v >> 1) ^ -(long long) (v & 1);
+    if (ret == -1 && !get_varint(e))
+      return false;
+    if (!get_varint(s) || s > in.size() - pos)
+      return false;
+    err = e;
+    size = s;
+    return true;
+  }
+
+public:
+  ac_syscall_log() : out(0), owner(0), pos(0), base(0), calls(0), name(""), configured(false) {}
+
+  ~ac_syscall_log() {
+    if (out)
+      fclose(out);
+  }
+
+  bool recording() {
+    if (!configured)
+      configure();
+    return out && owner == getpid();
+  }
+
+  bool replaying() {
+    if (!configured)
+      configure();
+    return !in.empty();
+  }
+
+  void record(int kind, long long ret, const void* data, size_t size) {
+    int err = errno;
+
+    calls++;
+    putc(kind, out);
+    put_varint(((uint64_t) ret << 1) ^ (uint64_t) (ret >> 63));
+    if (ret == -1)
+      put_varint(err);
+    put_varint(size);
+    if (size)
+      fwrite(data, 1, size, out);
+    errno = err;
+  }
+
+  long long replay(int kind, void* data, size_t size) {
+    long long ret;
+    int err, logged;
+    size_t n;
+
+    if (!next(ret, err, n, &logged)) {
+      AC_ERROR("System call log '" << name << "' ended at call " << calls << ".");
+      exit(EXIT_FAILURE);
+    }
+    if (logged != kind || n > size) {
+      AC_ERROR("System call " << calls << " does not match the log '" << name << "'.");
+      exit(EXIT_FAILURE);
+    }
+    if (n)
+      memcpy(data, &in[pos], n);
+    pos += n;
+    calls++;
+    if (ret == -1)
+      errno = err;
+    return ret;
+  }
+
+  void save(ac_checkpoint_out& out) {
+    out.put(calls);
+  }
+
+  void restore(ac_checkpoint_in& in) {
+    in.get(calls);
+    //A log is started once the calls made before it are known
+    if (configured && replaying())
+      skip();
+  }
+} ac_syscall_log;
+
+static class ac_syscall_replay_section : public ac_checkpoint_section {
+public:
+  ac_syscall_replay_section() : ac_checkpoint_section("syscall.replay") {}
+
+  void save(ac_checkpoint_out& out) { ac_syscall_log.save(out); }
+  void restore(ac_checkpoint_in& in) { ac_syscall_log.restore(in); }
+} ac_syscall_replay_checkpoint;
+
+bool ac_syscall_recording() { return ac_syscall_log.recording(); }
+bool ac_syscall_replaying() { return ac_syscall_log.replaying(); }
+
+void ac_syscall_record(int kind, long long ret, const void* data, size_t size)
+{
+  ac_syscall_log.record(kind, ret, data, size);
+}
+
+long long ac_syscall_replay(int kind, void* data, size_t size)
+{
+  return ac_syscall_log.replay(kind, data, size);
+}
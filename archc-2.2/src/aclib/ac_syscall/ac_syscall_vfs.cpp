@@ -0,0 +1,427 @@
+/**
+ * @file      ac_syscall_vfs.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Files of the application kept in memory.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "ac_checkpoint.H"
+#include "ac_stats_out.H"
+#include "ac_syscall_vfs.H"
+#include "ac_utils.H"
+
+//!A file in memory.
+struct ac_vfs_file {
+  std::string data;
+  bool written;                 //!< Since it was preloaded, or ever
+};
+
+//!An open file description, shared by the descriptors duplicated from it.
+struct ac_vfs_description {
+  std::string path;
+  off_t offset;
+  int flags;                    //!< Access mode and O_APPEND
+};
+
+static class ac_vfs {
+  typedef std::shared_ptr<ac_vfs_description> description;
+
+  std::map<std::string, ac_vfs_file> files;  //!< By absolute path
+  std::map<int, description> fds;
+  bool capture, hash, configured;
+
+  //!The contents of the host file path, false if it could not be read.
+  static bool read_file(const char* path, std::string& data) {
+    int fd = ::open(path, O_RDONLY);
+    char buf[65536];
+    ssize_t n;
+
+    if (fd == -1)
+      return false;
+    data.clear();
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0)
+      data.append(buf, n);
+    ::close(fd);
+    return n == 0;
+  }
+
+  //!Absolute path of path, whose directory must exist.
+  static std::string absolute(const char* path) {
+    char resolved[PATH_MAX];
+    std::string dir(path), name;
+    size_t slash;
+
+    if (realpath(path, resolved))
+      return resolved;
+    slash = dir.rfind('/');
+    if (slash == std::string::npos) {
+      name = dir;
+      dir = ".";
+    }
+    else {
+      name = dir.substr(slash + 1);
+      dir = slash ? dir.substr(0, slash) : "/";
+    }
+    if (!realpath(dir.c_str(), resolved))
+      return path;
+    return std::string(resolved) + (strcmp(resolved, "/") ? "/" : "") + name;
+  }
+
+  void configure() {
+    const char* preload = getenv(ENV_AC_SYSCALL_PRELOAD);
+    const char* env;
+    std::string list(preload ? preload : ""), path;
+    size_t start = 0, end;
+
+    configured = true;
+    env = getenv(ENV_AC_SYSCALL_CAPTURE);
+    capture = env && *env && *env != '0';
+    env = getenv(ENV_AC_SYSCALL_HASH);
+    hash = env && *env && *env != '0';
+
+    while (start < list.size()) {
+      end = list.find(':', start);
+      if (end == std::string::npos)
+        end = list.size();
+      path = list.substr(start, end - start);
+      start = end + 1;
+      if (path.empty())
+        continue;
+
+      ac_vfs_file& f = files[absolute(path.c_str())];
+      f.written = false;
+      if (!read_file(path.c_str(), f.data)) {
+        AC_WARN("Could not preload '" << path << "'.");
+        files.erase(absolute(path.c_str()));
+      }
+    }
+  }
+
+  //!A host descriptor for a file in memory, or -1.
+  static int reserve() {
+    return ::open("/dev/null", O_RDONLY);
+  }
+
+  ac_vfs_description* find(int fd) {
+    std::map<int, description>::iterator i = fds.find(fd);
+
+    return i == fds.end() ? 0 : i->second.get();
+  }
+
+public:
+  ac_vfs() : capture(false), hash(false), configured(false) {}
+
+  bool owns(int fd) { return !fds.empty() && fds.count(fd); }
+
+  int open(const char* path, int flags, int mode) {
+    std::map<std::string, ac_vfs_file>::iterator f;
+    std::string key;
+    int fd;
+
+    if (!configured)
+      configure();
+    if (files.empty() && !capture)
+      return ::open(path, flags, mode);
+
+    key = absolute(path);
+    f = files.find(key);
+    if (f == files.end()) {
+      if (!capture || !(flags & O_CREAT))
+        return ::open(path, flags, mode);
+      f = files.insert(std::make_pair(key, ac_vfs_file())).first;
+      f->second.written = true;
+      //A file of the host opened to be extended starts as it is there
+      if (!(flags & O_TRUNC) && !read_file(path, f->second.data))
+        f->second.data.clear();
+    }
+    else if ((flags & O_CREAT) && (flags & O_EXCL)) {
+      errno = EEXIST;
+      return -1;
+    }
+    if ((flags & O_TRUNC) && (flags & O_ACCMODE) != O_RDONLY) {
+      f->second.data.clear();
+      f->second.written = true;
+    }
+
+    if ((fd = reserve()) == -1)
+      return -1;
+    description d(new ac_vfs_description);
+    d->path = key;
+    d->offset = 0;
+    d->flags = flags & (O_ACCMODE | O_APPEND);
+    fds[fd] = d;
+    return fd;
+  }
+
+  int close(int fd) {
+    if (!owns(fd))
+      return ::close(fd);
+    fds.erase(fd);
+    return ::close(fd);
+  }
+
+  ssize_t pread(int fd, void* buf, size_t count, off_t offset) {
+    ac_vfs_description* d = find(fd);
+
+    if (!d)
+      return ::pread(fd, buf, count, offset);
+    if ((d->flags & O_ACCMODE) == O_WRONLY) {
+      errno = EBADF;
+      return -1;
+    }
+    const std::string& data = files[d->path].data;
+    if (offset < 0 || (size_t) offset >= data.size())
+      return 0;
+    if (count > data.size() - offset)
+      count = data.size() - offset;
+    memcpy(buf, data.data() + offset, count);
+    return count;
+  }
+
+  ssize_t read(int fd, void* buf, size_t count) {
+    ac_vfs_description* d = find(fd);
+    ssize_t n;
+
+    if (!d)
+      return ::read(fd, buf, count);
+    if ((n = pread(fd, buf, count, d->offset)) > 0)
+      d->offset += n;
+    return n;
+  }
+
+  ssize_t write(int fd, const void* buf, size_t count) {
+    ac_vfs_description* d = find(fd);
+
+    if (!d)
+      return ::write(fd, buf, count);
+    if ((d->flags & O_ACCMODE) == O_RDONLY) {
+      errno = EBADF;
+      return -1;
+    }
+    ac_vfs_file& f = files[d->path];
+    if (d->flags & O_APPEND)
+      d->offset = f.data.size();
+    if ((size_t) d->offset + count > f.data.size())
+      f.data.resize(d->offset + count);
+    f.data.replace(d->offset, count, (const char*) buf, count);
+    f.written = true;
+    d->offset += count;
+    return count;
+  }
+
+  off_t lseek(int fd, off_t offset, int whence) {
+    ac_vfs_description* d = find(fd);
+    off_t base;
+
+    if (!d)
+      return ::lseek(fd, offset, whence);
+    switch (whence) {
+    case SEEK_SET: base = 0; break;
+    case SEEK_CUR: base = d->offset; break;
+    case SEEK_END: base = files[d->path].data.size(); break;
+    default: errno = EINVAL; return -1;
+    }
+    if (base + offset < 0) {
+      errno = EINVAL;
+      return -1;
+    }
+    return d->offset = base + offset;
+  }
+
+  int fstat(int fd, struct stat* st) {
+    ac_vfs_description* d = find(fd);
+    std::map<std::string, ac_vfs_file>::iterator f;
+
+    if (!d)
+      return ::fstat(fd, st);
+    f = files.find(d->path);
+    memset(st, 0, sizeof(*st));
+    st->st_ino = std::distance(files.begin(), f) + 1;
+    st->st_mode = S_IFREG | 0644;
+    st->st_nlink = 1;
+    st->st_size = f->second.data.size();
+    st->st_blksize = 4096;
+    st->st_blocks = (st->st_size + 511) / 512;
+    return 0;
+  }
+
+  int dup(int fd) {
+    int ret = ::dup(fd);
+
+    if (ret != -1 && owns(fd))
+      fds[ret] = fds[fd];
+    return ret;
+  }
+
+  int dup2(int fd, int newfd) {
+    description d = owns(fd) ? fds[fd] : description();
+    int ret = ::dup2(fd, newfd);
+
+    if (ret != -1 && fd != newfd) {
+      fds.erase(newfd);
+      if (d)
+        fds[newfd] = d;
+    }
+    return ret;
+  }
+
+  static uint64_t fnv1a(const std::string& data) {
+    uint64_t h = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < data.size(); i++) {
+      h ^= (unsigned char) data[i];
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  void print() {
+    std::map<std::string, ac_vfs_file>::iterator f;
+    bool any = false;
+
+    for (f = files.begin(); f != files.end(); f++) {
+      if (!f->second.written)
+        continue;
+      if (hash) {
+        if (!any)
+          fprintf(stderr, "ArchC: Files written in memory\n");
+        fprintf(stderr, "    %s: %lu bytes, hash %016llx\n", f->first.c_str(),
+                (unsigned long) f->second.data.size(), (unsigned long long) fnv1a(f->second.data));
+      }
+      any = true;
+      if (ac_stats_out_enabled())
+        ac_stats_out_add("files", f->first + ".bytes", f->second.data.size());
+    }
+  }
+
+  //!The files written, then the descriptors.
+  void save(ac_checkpoint_out& out) {
+    std::map<std::string, ac_vfs_file>::iterator f;
+    std::map<int, description>::iterator i;
+    uint32_t count = 0, len;
+    uint64_t size;
+
+    for (f = files.begin(); f != files.end(); f++)
+      count += f->second.written;
+    out.put(count);
+    for (f = files.begin(); f != files.end(); f++)
+      if (f->second.written) {
+        len = f->first.size();
+        size = f->second.data.size();
+        out.put(len);
+        out.put(f->first.data(), len);
+        out.put(size);
+        out.put(f->second.data.data(), size);
+      }
+
+    count = fds.size();
+    out.put(count);
+    for (i = fds.begin(); i != fds.end(); i++) {
+      int32_t fd = i->first, flags = i->second->flags;
+      int64_t offset = i->second->offset;
+
+      len = i->second->path.size();
+      out.put(fd);
+      out.put(flags);
+      out.put(offset);
+      out.put(len);
+      out.put(i->second->path.data(), len);
+    }
+  }
+
+  //!Descriptors duplicated from one another come back apart.
+  void restore(ac_checkpoint_in& in) {
+    std::map<int, description>::iterator i;
+    uint32_t count, len;
+    uint64_t size;
+    std::string path;
+
+    if (!configured)
+      configure();
+    for (i = fds.begin(); i != fds.end(); i++)
+      ::close(i->first);
+    fds.clear();
+
+    in.get(count);
+    while (count-- && in.ok()) {
+      in.get(len);
+      path.resize(len);
+      if (len)
+        in.get(&path[0], len);
+      in.get(size);
+      ac_vfs_file& f = files[path];
+      f.data.resize(size);
+      if (size)
+        in.get(&f.data[0], size);
+      f.written = true;
+    }
+
+    in.get(count);
+    while (count-- && in.ok()) {
+      int32_t fd, flags;
+      int64_t offset;
+      int held;
+
+      in.get(fd);
+      in.get(flags);
+      in.get(offset);
+      in.get(len);
+      path.resize(len);
+      if (len)
+        in.get(&path[0], len);
+      if (!in.ok() || !files.count(path) || (held = reserve()) == -1)
+        continue;
+      if (held != fd) {
+        ::dup2(held, fd);
+        ::close(held);
+      }
+      description d(new ac_vfs_description);
+      d->path = path;
+      d->offset = offset;
+      d->flags = flags;
+      fds[fd] = d;
+    }
+  }
+} ac_vfs;
+
+static class ac_vfs_section : public ac_checkpoint_section {
+public:
+  ac_vfs_section() : ac_checkpoint_section("syscall.vfs") {}
+
+  void save(ac_checkpoint_out& out) { ac_vfs.save(out); }
+  void restore(ac_checkpoint_in& in) { ac_vfs.restore(in); }
+} ac_vfs_checkpoint;
+
+bool ac_vfs_owns(int fd) { return ac_vfs.owns(fd); }
+int ac_vfs_open(const char* path, int flags, int mode) { return ac_vfs.open(path, flags, mode); }
+int ac_vfs_close(int fd) { return ac_vfs.close(fd); }
+ssize_t ac_vfs_read(int fd, void* buf, size_t count) { return ac_vfs.read(fd, buf, count); }
+ssize_t ac_vfs_pread(int fd, void* buf, size_t count, off_t offset) { return ac_vfs.pread(fd, buf, count, offset); }
+ssize_t ac_vfs_write(int fd, const void* buf, size_t count) { return ac_vfs.write(fd, buf, count); }
+off_t ac_vfs_lseek(int fd, off_t offset, int whence) { return ac_vfs.lseek(fd, offset, whence); }
+int ac_vfs_fstat(int fd, struct stat* st) { return ac_vfs.fstat(fd, st); }
+int ac_vfs_dup(int fd) { return ac_vfs.dup(fd); }
+int ac_vfs_dup2(int fd, int newfd) { return ac_vfs.dup2(fd, newfd); }
+void ac_vfs_print() { ac_vfs.print(); }
@@ -0,0 +1,75 @@
+/**
+ * @file      thread.c
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ * @date      Mon, 19 Jun 2006 15:33:20 -0300
+ *
+ * @brief     Threads on the cores of a multi-core simulator (--threads=N)
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ * @note      Only threads sharing the memory (CLONE_VM) are made, and
+ *            futex() knows FUTEX_WAIT, without a timeout, and FUTEX_WAKE.
+ *            Newlib itself is not thread safe: lock around malloc and
+ *            stdio in the program.
+ */
+
+#include <ac_syscall_wrapper.h>
+#include <ac_syscall_codes.h>
+
+#include <stdarg.h>
+
+#define CLONE_PARENT_SETTID  0x00100000
+#define CLONE_SETTLS         0x00080000
+#define CLONE_CHILD_CLEARTID 0x00200000
+#define CLONE_CHILD_SETTID   0x01000000
+
+/* Where every thread starts: its end with the value of fn is an exit of
+   the thread alone, which clears and wakes ctid */
+static void
+ac_thread_start(int (*fn)(void *), void *arg, int *ctid)
+{
+  ac_syscall_wrapper(__NR_exit, fn(arg), ctid);
+  for (;;)
+    ;
+}
+
+int
+clone(int (*fn)(void *), void *child_stack, int flags, void *arg, ...)
+{
+  int *ptid = 0, *ctid = 0;
+  va_list ap;
+  int res;
+
+  va_start(ap, arg);
+  if (flags & (CLONE_PARENT_SETTID | CLONE_SETTLS | CLONE_CHILD_SETTID | CLONE_CHILD_CLEARTID)) {
+    ptid = va_arg(ap, int *);
+    va_arg(ap, void *);            /* tls: there is no thread pointer */
+    ctid = va_arg(ap, int *);
+  }
+  va_end(ap);
+
+  res = ac_syscall_wrapper(__NR_clone, flags, child_stack, ptid, ctid,
+                           ac_thread_start, fn, arg);
+  if (res == -1)
+    errno = ac_syscall_geterrno();
+  return res;
+}
+
+int
+futex(int *uaddr, int op, int val, ...)
+{
+  int res = ac_syscall_wrapper(__NR_futex, uaddr, op, val);
+
+  if (res == -1)
+    errno = ac_syscall_geterrno();
+  return res;
+}
+
+_syscall0(int,gettid)
@@ -0,0 +1,94 @@
+/**
+ * @file      ac_tlm2_intr_port.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   2.2
+ *
+ * @brief     ArchC TLM-2.0 interrupt (target) socket implementation.
+ *
+ * @attention Copyright (C) 2002-2005 --- The ArchC Team
+ *
+ */
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Standard includes
+#include <string.h>
+
+// SystemC includes
+
+// ArchC includes
+#include "ac_tlm2_intr_port.H"
+
+//////////////////////////////////////////////////////////////////////////////
+
+// using statements
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Forward class declarations, needed to compile
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructors
+
+/**
+ * Default constructor.
+ *
+ * @param nm Port name.
+ * @param hnd Interrupt handler for this port.
+ *
+ */
+ac_tlm2_intr_port::ac_tlm2_intr_port(char const* nm, ac_intr_handler& hnd) :
+  tlm_utils::simple_target_socket<ac_tlm2_intr_port>(nm),
+  ac_intr_queue(hnd),
+  name(nm),
+  transactions(0) {
+  register_b_transport(this, &ac_tlm2_intr_port::b_transport);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Methods
+
+/**
+ * Blocking transport callback. The value handed to the handler is the
+ * first 32-bit word of the data, as the legacy port takes it.
+ *
+ * @param trans Generic payload sent by the initiator.
+ * @param delay Timing annotation, left untouched.
+ *
+ */
+void ac_tlm2_intr_port::b_transport(tlm::tlm_generic_payload& trans,
+                                    sc_time& delay) {
+  uint32_t value = 0;
+  uint32_t length = trans.get_data_length();
+
+  transactions++;
+
+  if (trans.get_command() != tlm::TLM_WRITE_COMMAND) {
+    trans.set_response_status(tlm::TLM_COMMAND_ERROR_RESPONSE);
+    return;
+  }
+
+  memcpy(&value, trans.get_data_ptr(), (length < 4) ? length : 4);
+  trans.set_response_status(tlm::TLM_OK_RESPONSE);
+  receive(value);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Destructors
+
+/**
+ * Default (virtual) destructor.
+ * @return Nothing.
+ */
+ac_tlm2_intr_port::~ac_tlm2_intr_port() {}
+
+//////////////////////////////////////////////////////////////////////////////
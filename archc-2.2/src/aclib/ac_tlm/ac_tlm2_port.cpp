@@ -0,0 +1,282 @@
+/**
+ * @file      ac_tlm2_port.cpp
+ * @author    The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   2.2
+ *
+ * @brief     ArchC TLM-2.0 initiator socket class implementation.
+ *
+ * @attention Copyright (C) 2002-2005 --- The ArchC Team
+ *
+ */
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Standard includes
+#include <string.h>
+
+// SystemC includes
+
+// ArchC includes
+#include "ac_tlm2_port.H"
+
+//////////////////////////////////////////////////////////////////////////////
+
+// using statements
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Forward class declarations, needed to compile
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructors
+
+/**
+ * Default constructor.
+ *
+ * @param size Size or address range of the element to be attached.
+ *
+ */
+ac_tlm2_port::ac_tlm2_port(char const* nm, uint32_t sz) :
+  tlm_utils::simple_initiator_socket<ac_tlm2_port>(nm),
+  dmi_epoch(0), byte_enables(true), name(nm), size(sz), transactions(0),
+  delays(SC_ZERO_TIME), streaming(false) {
+  register_invalidate_direct_mem_ptr(this, &ac_tlm2_port::invalidate_direct_mem_ptr);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Methods
+
+/**
+ * Sends one blocking transaction through the socket.
+ *
+ * @param cmd TLM_READ_COMMAND or TLM_WRITE_COMMAND.
+ * @param data Bytes read or written, as they are laid out in the target.
+ * @param address Address of the first byte.
+ * @param length Number of bytes.
+ * @param width Streaming width; length unless the target is a FIFO.
+ * @param enables Byte enables, or 0 if every byte is enabled.
+ * @param enables_length Number of byte enables.
+ *
+ * @return true if the target answered TLM_OK_RESPONSE.
+ *
+ */
+bool ac_tlm2_port::transport(tlm::tlm_command cmd, uint8_t* data,
+                             uint32_t address, uint32_t length, uint32_t width,
+                             uint8_t* enables, uint32_t enables_length) {
+  sc_time delay = SC_ZERO_TIME;
+
+  trans.set_command(cmd);
+  trans.set_address(address);
+  trans.set_data_ptr(data);
+  trans.set_data_length(length);
+  trans.set_streaming_width(width);
+  trans.set_byte_enable_ptr(enables);
+  trans.set_byte_enable_length(enables_length);
+  trans.set_dmi_allowed(false);
+  trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+  (*this)->b_transport(trans, delay);
+  delays += delay;
+  return trans.is_response_ok();
+}
+
+/**
+ * Reads a single word.
+ *
+ * @param buf Buffer into which the word will be copied.
+ * @param address Address from where the word will be read.
+ * @param wordsize Word size in bits.
+ *
+ */
+void ac_tlm2_port::read(ac_ptr buf, uint32_t address, int wordsize) {
+  transactions++;
+  transport(tlm::TLM_READ_COMMAND, buf.ptr8, address, wordsize / 8,
+            wordsize / 8);
+}
+
+/**
+ * Reads multiple words in a single transaction.
+ *
+ * @param buf Buffer into which the words will be copied.
+ * @param address Address from where the words will be read.
+ * @param wordsize Word size in bits.
+ * @param n_words Number of words to be read.
+ *
+ */
+void ac_tlm2_port::read(ac_ptr buf, uint32_t address,
+                        int wordsize, int n_words) {
+  uint32_t length = n_words * (wordsize / 8);
+
+  transactions++;
+  transport(tlm::TLM_READ_COMMAND, buf.ptr8, address, length,
+            streaming ? wordsize / 8 : length);
+}
+
+/**
+ * Writes a single word.
+ *
+ * @param buf Buffer from which the word will be copied.
+ * @param address Address to where the word will be written.
+ * @param wordsize Word size in bits.
+ *
+ */
+void ac_tlm2_port::write(ac_ptr buf, uint32_t address, int wordsize) {
+  uint32_t bytes = wordsize / 8;
+  uint32_t offset = address & 3;
+
+  transactions++;
+
+  if (bytes < 4 && byte_enables && offset + bytes <= 4) {
+    uint8_t word[4] = {0, 0, 0, 0};
+    uint8_t enables[4] = {tlm::TLM_BYTE_DISABLED, tlm::TLM_BYTE_DISABLED,
+                          tlm::TLM_BYTE_DISABLED, tlm::TLM_BYTE_DISABLED};
+
+    memcpy(word + offset, buf.ptr8, bytes);
+    memset(enables + offset, tlm::TLM_BYTE_ENABLED, bytes);
+    if (transport(tlm::TLM_WRITE_COMMAND, word, address - offset, 4, 4,
+                  enables, 4) ||
+        trans.get_response_status() != tlm::TLM_BYTE_ENABLE_ERROR_RESPONSE)
+      return;
+    byte_enables = false;
+  }
+
+  transport(tlm::TLM_WRITE_COMMAND, buf.ptr8, address, bytes, bytes);
+}
+
+/**
+ * Writes multiple words in a single transaction.
+ *
+ * @param buf Buffer from which the words will be copied.
+ * @param address Address to where the words will be written.
+ * @param wordsize Word size in bits.
+ * @param n_words Number of words to be written.
+ *
+ */
+void ac_tlm2_port::write(ac_ptr buf, uint32_t address,
+                         int wordsize, int n_words) {
+  uint32_t length = n_words * (wordsize / 8);
+
+  transactions++;
+  transport(tlm::TLM_WRITE_COMMAND, buf.ptr8, address, length,
+            streaming ? wordsize / 8 : length);
+}
+
+/**
+ * Reads a block of bytes in a single transaction.
+ *
+ * @param buf Buffer into which the bytes will be copied.
+ * @param address Address from where the bytes will be read.
+ * @param size Number of bytes to be read.
+ *
+ */
+void ac_tlm2_port::read_block(uint8_t* buf, uint32_t address, uint32_t size) {
+  transactions++;
+  if (size)
+    transport(tlm::TLM_READ_COMMAND, buf, address, size, size);
+}
+
+/**
+ * Writes a block of bytes in a single transaction.
+ *
+ * @param buf Buffer from which the bytes will be copied.
+ * @param address Address to where the bytes will be written.
+ * @param size Number of bytes to be written.
+ *
+ */
+void ac_tlm2_port::write_block(const uint8_t* buf, uint32_t address, uint32_t size) {
+  transactions++;
+  if (size)
+    transport(tlm::TLM_WRITE_COMMAND, const_cast<uint8_t*>(buf), address,
+              size, size);
+}
+
+/**
+ * Asks the target for a DMI pointer to the region holding address.
+ *
+ * @param address Address about to be accessed.
+ * @param start Set to the first address of the region answered for.
+ * @param end Set to the last address of that region.
+ * @param writable Set to false if the target allows only reads.
+ *
+ * @return Host address of the byte at start, or 0 if refused.
+ *
+ */
+uint8_t* ac_tlm2_port::get_direct(uint32_t address, uint32_t& start,
+                                  uint32_t& end, bool& writable) {
+  tlm::tlm_dmi dmi;
+  bool granted;
+
+  trans.set_command(tlm::TLM_READ_COMMAND);
+  trans.set_address(address);
+  trans.set_data_ptr(0);
+  trans.set_data_length(0);
+  trans.set_byte_enable_ptr(0);
+  trans.set_dmi_allowed(false);
+
+  granted = (*this)->get_direct_mem_ptr(trans, dmi);
+
+  // A refusal still tells the range it holds for
+  start = (uint32_t) dmi.get_start_address();
+  end = (dmi.get_end_address() > 0xFFFFFFFFULL) ?
+    0xFFFFFFFFU : (uint32_t) dmi.get_end_address();
+  if (!granted || !dmi.get_dmi_ptr() || !dmi.is_read_allowed())
+    return 0;
+
+  writable = dmi.is_write_allowed();
+  direct_read_latency = dmi.get_read_latency();
+  direct_write_latency = dmi.get_write_latency();
+  return dmi.get_dmi_ptr();
+}
+
+const unsigned* ac_tlm2_port::get_direct_epoch() {
+  return &dmi_epoch;
+}
+
+/**
+ * Drops every grant of the port.
+ *
+ */
+void ac_tlm2_port::invalidate_direct_mem_ptr(sc_dt::uint64 start,
+                                             sc_dt::uint64 end) {
+  dmi_epoch++;
+}
+
+string ac_tlm2_port::get_name() const {
+  return name;
+}
+
+uint32_t ac_tlm2_port::get_size() const {
+  return size;
+}
+
+/**
+ * Locks the device.
+ *
+ */
+void ac_tlm2_port::lock() {}
+
+/**
+ * Unlocks the device.
+ *
+ */
+void ac_tlm2_port::unlock() {}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Destructors
+
+/**
+ * Default (virtual) destructor.
+ * @return Nothing.
+ */
+ac_tlm2_port::~ac_tlm2_port() {}
+
+//////////////////////////////////////////////////////////////////////////////
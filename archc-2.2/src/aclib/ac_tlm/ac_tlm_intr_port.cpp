@@ -47,8 +47,9 @@
  *
  */
 ac_tlm_intr_port::ac_tlm_intr_port(char const* nm, ac_intr_handler& hnd) :
-  handler(hnd),
-  name(nm) { bind(*this); }
+  ac_intr_queue(hnd),
+  name(nm),
+  transactions(0) { bind(*this); }
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -65,12 +66,14 @@ ac_tlm_intr_port::ac_tlm_intr_port(char const* nm, ac_intr_handler& hnd) :
 ac_tlm_rsp ac_tlm_intr_port::transport(const ac_tlm_req& req) {
   ac_tlm_rsp rsp;
 
+  transactions++;
+
   rsp.req_type = req.type;
   rsp.data = req.data;
 
   if (req.type == WRITE) {
     rsp.status = SUCCESS;
-    handler.handle(req.data);
+    receive(req.data);
   }
   else {
     rsp.status = ERROR;
@@ -21,6 +21,7 @@
 //////////////////////////////////////////////////////////////////////////////
 
 // Standard includes
+#include <string.h>
 
 // SystemC includes
 
@@ -45,12 +46,57 @@
  * @param size Size or address range of the element to be attached.
  * 
  */
-ac_tlm_port::ac_tlm_port(char const* nm, uint32_t sz) : name(nm), size(sz) {}
+ac_tlm_port::ac_tlm_port(char const* nm, uint32_t sz) : dmi(0), bursts(0), dmi_checked(false),
+                                                       dmi_epoch(0), name(nm), size(sz),
+                                                       transactions(0), delays(SC_ZERO_TIME) {}
 
 //////////////////////////////////////////////////////////////////////////////
 
 // Methods
 
+/** 
+ * Looks up the optional interfaces of the target. It is only known once
+ * the port is bound.
+ * 
+ */
+void ac_tlm_port::check_target() {
+  dmi = dynamic_cast<ac_tlm_dmi_if*>((*this).operator->());
+  bursts = dynamic_cast<ac_tlm_burst_if*>((*this).operator->());
+  dmi_checked = true;
+}
+
+/** 
+ * Moves a block in one burst, if the target can.
+ * 
+ * @param type READ or WRITE.
+ * @param data Bytes read or written, in read_block() order.
+ * @param address Address of the first byte.
+ * @param size Number of bytes.
+ * 
+ * @return true if the target moved the whole block.
+ * 
+ */
+bool ac_tlm_port::burst(ac_tlm_req_type type, uint8_t* data,
+                        uint32_t address, uint32_t size) {
+  ac_tlm_burst_req req;
+
+  if (!dmi_checked)
+    check_target();
+  if (!bursts || !size)
+    return false;
+
+  req.type = type;
+  req.dev_id = dev_id_;
+  req.addr = address;
+  req.length = size;
+  req.data = data;
+  req.delay = SC_ZERO_TIME;
+  if (bursts->burst(req) != SUCCESS)
+    return false;
+  delays += req.delay;
+  return true;
+}
+
 /** 
  * Reads a single word.
  * 
@@ -63,11 +109,13 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address, int wordsize) {
   ac_tlm_req req;
   ac_tlm_rsp rsp;
 
+  transactions++;
+
   req.type = READ;
   req.addr = address;
   req.data = 0ULL;
 
-  rsp = (*this)->transport(req);
+  rsp = send(req);
 
   if (rsp.status == SUCCESS) {
     switch (wordsize) {
@@ -103,6 +151,11 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
   ac_tlm_req req;
   ac_tlm_rsp rsp;
 
+  transactions++;
+
+  if (burst(READ, buf.ptr8, address, n_words * (wordsize / 8)))
+    return;
+
   req.type = READ;
 
   switch (wordsize) {
@@ -111,7 +164,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
       req.addr = address + i;
       req.data = 0ULL;
       
-      rsp = (*this)->transport(req);
+      rsp = send(req);
       
       if (rsp.status == SUCCESS) {
 	for (int j = 0; (i < n_words) && (j < 4); i++, j++) { 
@@ -126,7 +179,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
       req.addr = address + (i * sizeof(uint16_t));
       req.data = 0ULL;
       
-      rsp = (*this)->transport(req);
+      rsp = send(req);
       
       if (rsp.status == SUCCESS) {
 	for (int j = 0; (i < n_words) && (j < 2); i++, j++) { 
@@ -141,7 +194,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
       req.addr = address + (i * sizeof(uint32_t));
       req.data = 0ULL;
       
-      rsp = (*this)->transport(req);
+      rsp = send(req);
       
       if (rsp.status == SUCCESS) {
 	for (int j = 0; (i < n_words) && (j < 1); i++, j++) { 
@@ -156,7 +209,7 @@ void ac_tlm_port::read(ac_ptr buf, uint32_t address,
       req.addr = address + (i * sizeof(uint64_t));
       req.data = 0ULL;
       
-      rsp = (*this)->transport(req);
+      rsp = send(req);
       
       if (rsp.status == SUCCESS) {
 	(buf.ptr64)[i] = rsp.data;
@@ -180,6 +233,8 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address, int wordsize) {
   ac_tlm_req req;
   ac_tlm_rsp rsp;
 
+  transactions++;
+
 //   req.type = WRITE;
 //   req.addr = address;
 
@@ -191,34 +246,34 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address, int wordsize) {
   case 8:
     req.type = READ;
     req.addr = address;
-    rsp = (*this)->transport(req);
+    rsp = send(req);
 
     req.type = WRITE;
     req.data = rsp.data;
     ((uint8_t*)&(req.data))[0] = *(buf.ptr8);
-    rsp = (*this)->transport(req);
+    rsp = send(req);
     break;
   case 16:
     req.type = READ;
     req.addr = address;
-    rsp = (*this)->transport(req);
+    rsp = send(req);
 
     req.type = WRITE;
     req.data = rsp.data;
     ((uint16_t*)&(req.data))[0] =
       *(buf.ptr16);
-    rsp = (*this)->transport(req);
+    rsp = send(req);
     break;
   case 32:
  //   req.type = READ;
     req.addr = address;
- //   rsp = (*this)->transport(req);
+ //   rsp = send(req);
 
     req.type = WRITE;
     req.data = rsp.data;
     ((uint32_t*)&(req.data))[0] =
       *(buf.ptr32);
-    rsp = (*this)->transport(req);
+    rsp = send(req);
     break;
 
 // This is not a 64-bit operation!
@@ -226,7 +281,7 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address, int wordsize) {
     req.type = WRITE;
     req.addr = address;
     req.data = *(buf.ptr64);
-    rsp = (*this)->transport(req);
+    rsp = send(req);
     break;
   default:
     break;
@@ -247,13 +302,18 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
   ac_tlm_req req;
   ac_tlm_rsp rsp;
 
+  transactions++;
+
+  if (burst(WRITE, buf.ptr8, address, n_words * (wordsize / 8)))
+    return;
+
   switch (wordsize) {
   case 8:
     for (int i = 0; i < n_words; i++) {
       req.type = READ;
       req.addr = address + i;
       req.data = 0ULL;
-      rsp = (*this)->transport(req);
+      rsp = send(req);
 
       req.type = WRITE;
       req.data = rsp.data;
@@ -262,7 +322,7 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
 	((uint8_t*)&req.data)[j] = (buf.ptr8)[i];
       }
       i--;
-      (*this)->transport(req);
+      send(req);
     }
     break;
   case 16:
@@ -270,7 +330,7 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
       req.type = READ;
       req.addr = address + (i * sizeof(uint16_t));
       req.data = 0ULL;
-      rsp = (*this)->transport(req);
+      rsp = send(req);
 
       req.type = WRITE;
       req.data = rsp.data;
@@ -279,7 +339,7 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
 	((uint16_t*)&req.data)[j] = (buf.ptr16)[i];
       }
       i--;
-      (*this)->transport(req);
+      send(req);
     }
     break;
   case 32:
@@ -287,7 +347,7 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
 //      req.type = READ;
       req.addr = address + (i * sizeof(uint32_t));
       req.data = 0ULL;
-//      rsp = (*this)->transport(req);
+//      rsp = send(req);
 
       req.type = WRITE;
 //      req.data = rsp.data;
@@ -297,14 +357,14 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
 //        ((uint32_t*)&req.data)[j] = (buf.ptr32)[i];
 //      }
 //      i--;
-      (*this)->transport(req);
+      send(req);
     }
     break;
   case 64:
     for (int i = 0; i < n_words; i++) {
       req.addr = address + (i * sizeof(uint64_t));
       req.data = (buf.ptr64)[i];
-      (*this)->transport(req);
+      send(req);
     }
     break;
   default:
@@ -312,6 +372,133 @@ void ac_tlm_port::write(ac_ptr buf, uint32_t address,
   }
 }
 
+/** 
+ * Reads a block of bytes, in a single burst if the target implements
+ * ac_tlm_burst_if, one transaction per aligned 32-bit word otherwise.
+ * 
+ * @param buf Buffer into which the bytes will be copied.
+ * @param address Address from where the bytes will be read.
+ * @param size Number of bytes to be read.
+ * 
+ */
+void ac_tlm_port::read_block(uint8_t* buf, uint32_t address, uint32_t size) {
+  ac_tlm_req req;
+  ac_tlm_rsp rsp;
+  uint32_t done = 0;
+
+  transactions++;
+
+  if (burst(READ, buf, address, size))
+    return;
+
+  req.type = READ;
+
+  while (done < size) {
+    uint32_t offset = (address + done) & 3;
+    uint32_t n = (size - done < 4 - offset) ? size - done : 4 - offset;
+
+    req.addr = (address + done) - offset;
+    req.data = 0ULL;
+
+    rsp = send(req);
+
+    if (rsp.status == SUCCESS)
+      memcpy(buf + done, (uint8_t*)&rsp.data + offset, n);
+    done += n;
+  }
+}
+
+/** 
+ * Writes a block of bytes, in a single burst if the target implements
+ * ac_tlm_burst_if, one transaction per aligned 32-bit word otherwise.
+ * Only the words the block covers partially are read first.
+ * 
+ * @param buf Buffer from which the bytes will be copied.
+ * @param address Address to where the bytes will be written.
+ * @param size Number of bytes to be written.
+ * 
+ */
+void ac_tlm_port::write_block(const uint8_t* buf, uint32_t address, uint32_t size) {
+  ac_tlm_req req;
+  ac_tlm_rsp rsp;
+  uint32_t done = 0;
+
+  transactions++;
+
+  if (burst(WRITE, const_cast<uint8_t*>(buf), address, size))
+    return;
+
+  while (done < size) {
+    uint32_t offset = (address + done) & 3;
+    uint32_t n = (size - done < 4 - offset) ? size - done : 4 - offset;
+
+    req.addr = (address + done) - offset;
+    req.data = 0ULL;
+
+    if (n < 4) {
+      req.type = READ;
+      rsp = send(req);
+      req.data = rsp.data;
+    }
+
+    req.type = WRITE;
+    memcpy((uint8_t*)&req.data + offset, buf + done, n);
+    send(req);
+    done += n;
+  }
+}
+
+/** 
+ * Asks the target for direct access to the region holding address.
+ * 
+ * @param address Address about to be accessed.
+ * @param start Set to the first address of the region answered for.
+ * @param end Set to the last address of that region.
+ * @param writable Set to false if the target allows only reads.
+ * 
+ * @return Host address of the byte at start, or 0 if refused.
+ * 
+ */
+uint8_t* ac_tlm_port::get_direct(uint32_t address, uint32_t& start,
+                                 uint32_t& end, bool& writable) {
+  ac_tlm_dmi_grant grant;
+
+  if (!dmi_checked)
+    check_target();
+
+  start = 0;
+  end = 0xFFFFFFFFU;
+  if (!dmi)
+    return 0;
+
+  grant.host = 0;
+  grant.start = 0;
+  grant.end = 0xFFFFFFFFU;
+  grant.access = DMI_READ_WRITE;
+  dmi->get_direct(address, grant, this);
+  start = grant.start;
+  end = grant.end;
+  if (!grant.host || !(grant.access & DMI_READ))
+    return 0;
+
+  writable = (grant.access & DMI_WRITE) != 0;
+  direct_read_latency = grant.read_latency;
+  direct_write_latency = grant.write_latency;
+  return grant.host;
+}
+
+const unsigned* ac_tlm_port::get_direct_epoch() {
+  return &dmi_epoch;
+}
+
+/** 
+ * Drops every grant of the port.
+ * 
+ */
+void ac_tlm_port::invalidate_direct(uint32_t start, uint32_t end) {
+  dmi_epoch++;
+}
+
 string ac_tlm_port::get_name() const {
   return name;
 }
@@ -329,7 +516,7 @@ void ac_tlm_port::lock()
   ac_tlm_req req;
   req.type = LOCK;
   req.dev_id = dev_id_;
-  (*this)->transport(req);
+  send(req);
 }
 
 /** 
@@ -341,7 +528,7 @@ void ac_tlm_port::unlock()
   ac_tlm_req req;
   req.type = UNLOCK;
   req.dev_id = dev_id_;
-  (*this)->transport(req);
+  send(req);
 }
 
 //////////////////////////////////////////////////////////////////////////////
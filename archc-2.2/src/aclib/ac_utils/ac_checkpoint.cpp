@@ -0,0 +1,332 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_checkpoint.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Simulation checkpoint files.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ac_checkpoint.H"
+
+static const char ac_checkpoint_magic[8] = {'A','C','C','K','P','T','0','1'};
+
+//! Marks the end of the pages of a storage.
+static const uint32_t ac_checkpoint_last_page = 0xFFFFFFFFU;
+
+ac_checkpoint_section* ac_checkpoint_section::sections = NULL;
+
+/// PackBits encoding: a control byte n < 128 is followed by n + 1 literal
+/// bytes, n > 128 by one byte repeated 257 - n times. Only runs of three
+/// or more bytes are encoded as such, which bounds the output to one
+/// control byte per 128 input bytes over the input size.
+static size_t ac_checkpoint_pack(const uint8_t* in, size_t size, uint8_t* out)
+{
+  size_t i = 0, o = 0;
+
+  while (i < size) {
+    size_t run = 1;
+
+    while (i + run < size && run < 128 && in[i + run] == in[i])
+      run++;
+
+    if (run > 2) {
+      out[o++] = (uint8_t) (257 - run);
+      out[o++] = in[i];
+      i += run;
+    }
+    else {
+      size_t lit = 1;
+
+      while (i + lit < size && lit < 128 &&
+             !(i + lit + 2 < size && in[i + lit] == in[i + lit + 1] &&
+               in[i + lit] == in[i + lit + 2]))
+        lit++;
+      out[o++] = (uint8_t) (lit - 1);
+      memcpy(out + o, in + i, lit);
+      o += lit;
+      i += lit;
+    }
+  }
+  return o;
+}
+
+static bool ac_checkpoint_unpack(const uint8_t* in, size_t size, uint8_t* out, size_t out_size)
+{
+  size_t i = 0, o = 0;
+
+  while (i < size) {
+    uint8_t n = in[i++];
+
+    if (n < 128) {
+      if (i + n + 1 > size || o + n + 1 > out_size)
+        return false;
+      memcpy(out + o, in + i, n + 1);
+      i += n + 1;
+      o += n + 1;
+    }
+    else if (n > 128) {
+      if (i >= size || o + 257 - n > out_size)
+        return false;
+      memset(out + o, in[i++], 257 - n);
+      o += 257 - n;
+    }
+  }
+  return o == out_size;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+ac_checkpoint_out::ac_checkpoint_out(const char* path) : section_start(-1),
+                                                          failed(false)
+{
+  if (!(file = fopen(path, "wb")))
+    failed = true;
+  else
+    put(ac_checkpoint_magic, sizeof(ac_checkpoint_magic));
+}
+
+ac_checkpoint_out::~ac_checkpoint_out()
+{
+  close();
+}
+
+void ac_checkpoint_out::end_section()
+{
+  uint64_t size;
+  long end;
+
+  if (!file || section_start < 0)
+    return;
+
+  //The size field is written last, once the section is complete
+  end = ftell(file);
+  size = end - section_start - sizeof(size);
+  fseek(file, section_start, SEEK_SET);
+  put(size);
+  fseek(file, end, SEEK_SET);
+  section_start = -1;
+}
+
+void ac_checkpoint_out::begin(const char* name)
+{
+  uint16_t len = strlen(name);
+  uint64_t size = 0;
+
+  if (!file)
+    return;
+
+  end_section();
+  put(len);
+  put(name, len);
+  section_start = ftell(file);
+  put(size);
+}
+
+void ac_checkpoint_out::put(const void* data, size_t size)
+{
+  if (file && fwrite(data, 1, size, file) != size)
+    failed = true;
+}
+
+void ac_checkpoint_out::put_storage(ac_inout_if& stg, uint32_t size)
+{
+  uint8_t page[AC_CHECKPOINT_PAGE_SIZE];
+  uint8_t packed[AC_CHECKPOINT_PAGE_SIZE + AC_CHECKPOINT_PAGE_SIZE / 128 + 1];
+  uint32_t page_size = AC_CHECKPOINT_PAGE_SIZE;
+
+  put(size);
+  put(page_size);
+
+  for (uint32_t addr = 0; addr < size; addr += page_size) {
+    uint32_t n = (size - addr < page_size) ? size - addr : page_size;
+    uint32_t index = addr / page_size;
+    uint32_t packed_size;
+    uint32_t i;
+
+    stg.read(page, addr, 8, n);
+    for (i = 0; i < n && !page[i]; i++)
+      ;
+    if (i == n)
+      continue;
+
+    packed_size = ac_checkpoint_pack(page, n, packed);
+    put(index);
+    put(packed_size);
+    put(packed, packed_size);
+  }
+
+  put(ac_checkpoint_last_page);
+}
+
+bool ac_checkpoint_out::close()
+{
+  if (file) {
+    end_section();
+    if (fclose(file) != 0)
+      failed = true;
+    file = NULL;
+  }
+  return !failed;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+ac_checkpoint_in::ac_checkpoint_in(const char* path) : data(NULL), file_size(0),
+                                                        pos(0), section_end(0),
+                                                        failed(false)
+{
+  char magic[sizeof(ac_checkpoint_magic)];
+  FILE* file;
+  long len;
+
+  if (!(file = fopen(path, "rb"))) {
+    failed = true;
+    return;
+  }
+
+  if (fseek(file, 0, SEEK_END) || (len = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) ||
+      !(data = (unsigned char*) malloc(len ? len : 1)) ||
+      fread(data, 1, len, file) != (size_t) len)
+    failed = true;
+  else
+    file_size = section_end = len;
+  fclose(file);
+
+  get(magic, sizeof(magic));
+  if (memcmp(magic, ac_checkpoint_magic, sizeof(magic)))
+    failed = true;
+  section_end = pos;
+}
+
+ac_checkpoint_in::~ac_checkpoint_in()
+{
+  free(data);
+}
+
+const char* ac_checkpoint_in::next(char* name, size_t name_size)
+{
+  uint16_t len;
+  uint64_t section_size;
+
+  if (failed || section_end >= file_size)
+    return NULL;                // end of file
+
+  pos = section_end;
+  section_end = file_size;
+  get(len);
+  if (len >= name_size) {
+    failed = true;
+    return NULL;
+  }
+  get(name, len);
+  name[len] = '\0';
+  get(section_size);
+  if (failed || section_size > file_size - pos) {
+    failed = true;
+    return NULL;
+  }
+  section_end = pos + section_size;
+  return name;
+}
+
+void ac_checkpoint_in::get(void* buf, size_t n)
+{
+  //Reads never go past the end of the current section
+  if (failed || n > section_end - pos) {
+    failed = true;
+    memset(buf, 0, n);
+    return;
+  }
+  memcpy(buf, data + pos, n);
+  pos += n;
+}
+
+void ac_checkpoint_in::get_storage(ac_inout_if& stg, uint32_t size)
+{
+  uint8_t page[AC_CHECKPOINT_PAGE_SIZE];
+  uint8_t packed[AC_CHECKPOINT_PAGE_SIZE + AC_CHECKPOINT_PAGE_SIZE / 128 + 1];
+  uint32_t saved_size, page_size, index, packed_size;
+
+  get(saved_size);
+  get(page_size);
+  if (saved_size != size || page_size != AC_CHECKPOINT_PAGE_SIZE) {
+    failed = true;
+    return;
+  }
+
+  //Pages left out of the file are all zeros
+  memset(page, 0, sizeof(page));
+  for (uint32_t addr = 0; addr < size; addr += page_size)
+    stg.write(page, addr, 8, (size - addr < page_size) ? size - addr : page_size);
+
+  for (get(index); ok() && index != ac_checkpoint_last_page; get(index)) {
+    uint32_t addr = index * page_size;
+    uint32_t n;
+
+    get(packed_size);
+    if (addr >= size || packed_size > sizeof(packed)) {
+      failed = true;
+      return;
+    }
+    n = (size - addr < page_size) ? size - addr : page_size;
+    get(packed, packed_size);
+    if (!ok() || !ac_checkpoint_unpack(packed, packed_size, page, n)) {
+      failed = true;
+      return;
+    }
+    stg.write(page, addr, 8, n);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+ac_checkpoint_section::ac_checkpoint_section(const char* nm) : name(nm),
+                                                               next(sections)
+{
+  sections = this;
+}
+
+ac_checkpoint_section::~ac_checkpoint_section()
+{
+  ac_checkpoint_section** p;
+
+  for (p = &sections; *p; p = &(*p)->next)
+    if (*p == this) {
+      *p = next;
+      break;
+    }
+}
+
+void ac_checkpoint_section::save_all(ac_checkpoint_out& out)
+{
+  for (ac_checkpoint_section* s = sections; s; s = s->next) {
+    out.begin(s->name);
+    s->save(out);
+  }
+}
+
+bool ac_checkpoint_section::restore(const char* name, ac_checkpoint_in& in)
+{
+  for (ac_checkpoint_section* s = sections; s; s = s->next)
+    if (!strcmp(s->name, name)) {
+      s->restore(in);
+      return true;
+    }
+  return false;
+}
@@ -0,0 +1,125 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_dec_snapshot.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Decode cache snapshot files.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ac_dec_snapshot.H"
+
+static const char ac_dec_snapshot_magic[8] = {'A','C','D','C','S','N','P','1'};
+
+unsigned long long ac_dec_snapshot_hash(const void* data, size_t size,
+                                        unsigned long long seed)
+{
+  const unsigned char* p = (const unsigned char*) data;
+  unsigned long long h = seed ? seed : 14695981039346656037ULL;
+
+  while (size--) {
+    h ^= *p++;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+char* ac_dec_snapshot_path(const char* project, unsigned long long key)
+{
+  const char* dir = getenv(ENV_AC_DEC_SNAPSHOT_DIR);
+  char* path;
+
+  if (!dir || !*dir)
+    dir = ".";
+
+  path = (char*) malloc(strlen(dir) + strlen(project) + 32);
+  sprintf(path, "%s/%s-%016llx.acdc", dir, project, key);
+  return path;
+}
+
+const unsigned* ac_dec_snapshot_map(const char* path,
+                                    const ac_dec_snapshot_header& hdr)
+{
+  struct stat st;
+  size_t size = sizeof(hdr) + ac_dec_snapshot_records(hdr) * hdr.nfields * sizeof(unsigned);
+  ac_dec_snapshot_header* file_hdr;
+  void* map;
+  int fd;
+
+  if ((fd = open(path, O_RDONLY)) == -1)
+    return NULL;
+
+  if (fstat(fd, &st) == -1 || (size_t) st.st_size != size) {
+    close(fd);
+    return NULL;
+  }
+
+  //Shared read-only, so concurrent runs use the same pages
+  map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return NULL;
+
+  file_hdr = (ac_dec_snapshot_header*) map;
+  if (memcmp(file_hdr->magic, ac_dec_snapshot_magic, sizeof(file_hdr->magic)) ||
+      file_hdr->key != hdr.key || file_hdr->text_start != hdr.text_start ||
+      file_hdr->text_end != hdr.text_end || file_hdr->step != hdr.step ||
+      file_hdr->nfields != hdr.nfields) {
+    munmap(map, size);
+    return NULL;
+  }
+
+  return (const unsigned*) (file_hdr + 1);
+}
+
+bool ac_dec_snapshot_save(const char* path, const ac_dec_snapshot_header& hdr,
+                          const unsigned* records)
+{
+  ac_dec_snapshot_header file_hdr = hdr;
+  size_t count = ac_dec_snapshot_records(hdr) * hdr.nfields;
+  char* tmp;
+  FILE* out;
+  bool ok;
+
+  memcpy(file_hdr.magic, ac_dec_snapshot_magic, sizeof(file_hdr.magic));
+
+  //Written aside and renamed, so readers never map a partial file
+  tmp = (char*) malloc(strlen(path) + 32);
+  sprintf(tmp, "%s.%d.tmp", path, (int) getpid());
+
+  if (!(out = fopen(tmp, "wb"))) {
+    free(tmp);
+    return false;
+  }
+
+  ok = fwrite(&file_hdr, sizeof(file_hdr), 1, out) == 1 &&
+       fwrite(records, sizeof(unsigned), count, out) == count;
+  ok = (fclose(out) == 0) && ok;
+  ok = ok && (rename(tmp, path) == 0);
+  if (!ok)
+    unlink(tmp);
+
+  free(tmp);
+  return ok;
+}
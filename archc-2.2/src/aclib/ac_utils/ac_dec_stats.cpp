@@ -0,0 +1,83 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_dec_stats.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Counters of the decode cache and of the block cache.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <stdio.h>
+
+#include "ac_dec_stats.H"
+#include "ac_stats_out.H"
+
+namespace {
+
+double ratio(unsigned long long x, unsigned long long y) {
+  return y ? (double) x / y : 0;
+}
+
+}
+
+void ac_dec_stats_print(const ac_dec_stats& s, unsigned long long instructions,
+                        unsigned long long slot_bytes, unsigned object_size, bool blocks) {
+  unsigned long long filled = s.decodes + s.predecoded + s.mapped;
+  unsigned long long resident = slot_bytes + s.objects * object_size;
+  unsigned long long run = s.first_ticks ? ac_host_ticks() - s.first_ticks : 0;
+  //Time since the first decode that was not spent decoding.
+  unsigned long long executing = run > s.decode_ticks ? run - s.decode_ticks : 0;
+
+  fprintf(stderr, "ArchC: Decode cache statistics\n");
+  fprintf(stderr, "    Decodes: %llu (%.4f %% of the instructions)\n", s.decodes,
+          100 * ratio(s.decodes, instructions));
+  fprintf(stderr, "    Entries filled: %llu (%llu on misses, %llu pre-decoded, %llu from a snapshot)\n",
+          filled, s.decodes, s.predecoded, s.mapped);
+  fprintf(stderr, "    Entries invalidated: %llu, by %llu code writes\n", s.invalidated, s.code_writes);
+  fprintf(stderr, "    Bytes resident: %llu (%llu in slots", resident, slot_bytes);
+  if (s.pages)
+    fprintf(stderr, " of %llu pages", s.pages);
+  fprintf(stderr, ", %llu in %llu instructions)\n", s.objects * object_size, s.objects);
+  fprintf(stderr, "    Decode time: %.2f %% of the simulation, %.4f of the execution time\n",
+          100 * ratio(s.decode_ticks, run), ratio(s.decode_ticks, executing));
+  if (blocks) {
+    fprintf(stderr, "    Block cache hits: %llu of %llu lookups (%.2f %%), %llu chained\n",
+            s.block_hits, s.block_lookups, 100 * ratio(s.block_hits, s.block_lookups), s.block_chains);
+    fprintf(stderr, "    Blocks kept: %llu, all dropped %llu times\n", s.blocks, s.block_flushes);
+  }
+
+  if (!ac_stats_out_enabled())
+    return;
+  ac_stats_out_add("archc.dec_cache", "decodes", s.decodes);
+  ac_stats_out_add("archc.dec_cache", "miss_rate", ratio(s.decodes, instructions));
+  ac_stats_out_add("archc.dec_cache", "entries_filled", filled);
+  ac_stats_out_add("archc.dec_cache", "predecoded", s.predecoded);
+  ac_stats_out_add("archc.dec_cache", "snapshot_entries", s.mapped);
+  ac_stats_out_add("archc.dec_cache", "invalidated", s.invalidated);
+  ac_stats_out_add("archc.dec_cache", "code_writes", s.code_writes);
+  ac_stats_out_add("archc.dec_cache", "bytes_resident", resident);
+  ac_stats_out_add("archc.dec_cache", "slot_bytes", slot_bytes);
+  ac_stats_out_add("archc.dec_cache", "pages", s.pages);
+  ac_stats_out_add("archc.dec_cache", "decode_share", ratio(s.decode_ticks, run));
+  ac_stats_out_add("archc.dec_cache", "decode_execute_ratio", ratio(s.decode_ticks, executing));
+  if (blocks) {
+    ac_stats_out_add("archc.block_cache", "lookups", s.block_lookups);
+    ac_stats_out_add("archc.block_cache", "hits", s.block_hits);
+    ac_stats_out_add("archc.block_cache", "hit_rate", ratio(s.block_hits, s.block_lookups));
+    ac_stats_out_add("archc.block_cache", "chained", s.block_chains);
+    ac_stats_out_add("archc.block_cache", "blocks", s.blocks);
+    ac_stats_out_add("archc.block_cache", "flushes", s.block_flushes);
+  }
+}
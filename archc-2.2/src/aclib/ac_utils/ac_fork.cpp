@@ -0,0 +1,181 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_fork.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Forked experiments from one simulation state.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ac_fork.H"
+#include "ac_host_place.H"
+#include "ac_stats_out.H"
+#include "ac_syscall_output.H"
+
+int ac_fork_experiments(unsigned count, unsigned jobs, unsigned& failed)
+{
+  unsigned next = 0, running = 0;
+  int status;
+  pid_t pid;
+
+  failed = 0;
+  if (!jobs)
+    jobs = 1;
+
+  //Buffered output would otherwise be written once by every child
+  fflush(NULL);
+  ac_syscall_flush();
+
+  while (next < count || running) {
+    if (next < count && running < jobs) {
+      if ((pid = fork()) == 0) {
+        ac_host_pin_job(next, "experiment");
+        return next;
+      }
+      if (pid == -1) {
+        perror("fork");
+        failed++;
+      }
+      else
+        running++;
+      next++;
+      continue;
+    }
+
+    if (wait(&status) == -1)
+      break;
+    running--;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      failed++;
+  }
+  return -1;
+}
+
+//! Children of ac_fork_job() not waited for yet
+static unsigned jobs_running = 0;
+
+//! Children of ac_fork_job() forked, each pinned after the parent's CPU
+static unsigned jobs_forked = 0;
+
+int ac_fork_job(unsigned jobs, unsigned& failed)
+{
+  int status;
+  pid_t pid;
+
+  if (!jobs)
+    jobs = 1;
+  for (; jobs_running >= jobs; jobs_running--) {
+    if (wait(&status) == -1) {
+      jobs_running = 0;
+      break;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      failed++;
+  }
+
+  fflush(NULL);
+  ac_syscall_flush();
+  jobs_forked++;
+  if ((pid = fork()) == 0) {
+    jobs_running = 0;
+    ac_host_pin_job(jobs_forked, "job");
+    return 0;
+  }
+  if (pid == -1) {
+    perror("fork");
+    failed++;
+    return -1;
+  }
+  jobs_running++;
+  return pid;
+}
+
+void ac_fork_wait_jobs(unsigned& failed)
+{
+  int status;
+
+  for (; jobs_running; jobs_running--) {
+    if (wait(&status) == -1) {
+      jobs_running = 0;
+      break;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      failed++;
+  }
+}
+
+void ac_fork_private_files(int first_fd)
+{
+  char link[64], path[4096];
+  struct stat st;
+  int max_fd = (int) sysconf(_SC_OPEN_MAX);
+  int fd, copy, flags;
+  ssize_t len;
+  off_t offset;
+
+  for (fd = first_fd; fd < max_fd; fd++) {
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+      continue;
+
+    sprintf(link, "/proc/self/fd/%d", fd);
+    if ((len = readlink(link, path, sizeof(path) - 1)) <= 0)
+      continue;
+    path[len] = '\0';
+
+    flags = fcntl(fd, F_GETFL) & ~(O_CREAT | O_EXCL | O_TRUNC);
+    offset = lseek(fd, 0, SEEK_CUR);
+    if ((copy = open(path, flags)) == -1)
+      continue;
+    if (lseek(copy, offset, SEEK_SET) == offset)
+      dup2(copy, fd);
+    close(copy);
+  }
+}
+
+bool ac_fork_redirect(const char* name)
+{
+  char* path = (char*) malloc(strlen(name) + 8);
+  int out, err;
+
+  sprintf(path, "%s.out", name);
+  out = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  sprintf(path, "%s.err", name);
+  err = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  free(path);
+
+  if (out == -1 || err == -1) {
+    if (out != -1)
+      close(out);
+    if (err != -1)
+      close(err);
+    return false;
+  }
+
+  dup2(out, 1);
+  dup2(err, 2);
+  close(out);
+  close(err);
+  ac_stats_out_rename(name);
+  return true;
+}
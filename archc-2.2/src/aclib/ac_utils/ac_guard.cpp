@@ -0,0 +1,105 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_guard.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Guarded regions (--guard-memory).
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ac_guard.H"
+
+const unsigned* ac_guard_pc = 0;
+
+namespace {
+
+//! Regions reserved, looked up by the SIGSEGV handler. A slot is in use
+//! while its base is not 0.
+struct region {
+  const char* volatile base;
+  uint64_t span;
+  uint32_t unit;
+  char what[32];
+};
+
+const int kRegions = 16;
+region regions[kRegions];
+
+uint64_t page_size() {
+  long page = sysconf(_SC_PAGESIZE);
+
+  return page > 0 ? page : 4096;
+}
+
+} // namespace
+
+uint64_t ac_guard_span(uint32_t unit) {
+  uint64_t page = page_size();
+
+  return (AC_GUARD_ADDRESSES * unit + page) / page * page;
+}
+
+void* ac_guard_reserve(uint32_t unit, uint64_t usable, const char* what) {
+  uint64_t span = ac_guard_span(unit);
+  void* p;
+
+  //The address space is only reserved; the usable part is backed by zero
+  //pages as it is touched
+  p = mmap(NULL, span, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED)
+    return 0;
+  if (usable > span)
+    usable = span;
+  if (usable && mprotect(p, usable, PROT_READ | PROT_WRITE)) {
+    munmap(p, span);
+    return 0;
+  }
+  for (int i = 0; i < kRegions; i++)
+    if (!regions[i].base) {
+      regions[i].span = span;
+      regions[i].unit = unit;
+      snprintf(regions[i].what, sizeof(regions[i].what), "%s", what);
+      __atomic_store_n(&regions[i].base, (const char*) p, __ATOMIC_RELEASE);
+      return p;
+    }
+  fprintf(stderr, "ArchC: Too many guarded regions; faults in %s will not be reported.\n", what);
+  return p;
+}
+
+void ac_guard_release(void* base, uint32_t unit) {
+  for (int i = 0; i < kRegions; i++)
+    if (regions[i].base == base)
+      __atomic_store_n(&regions[i].base, (const char*) 0, __ATOMIC_RELEASE);
+  munmap(base, ac_guard_span(unit));
+}
+
+bool ac_guard_find(const void* addr, const char** what, uint32_t* address) {
+  const char* a = (const char*) addr;
+
+  for (int i = 0; i < kRegions; i++) {
+    const char* base = __atomic_load_n(&regions[i].base, __ATOMIC_ACQUIRE);
+
+    if (base && a >= base && (uint64_t) (a - base) < regions[i].span) {
+      *what = regions[i].what;
+      *address = (uint32_t) ((uint64_t) (a - base) / regions[i].unit);
+      return true;
+    }
+  }
+  return false;
+}
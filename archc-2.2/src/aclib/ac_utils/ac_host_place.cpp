@@ -0,0 +1,297 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_host_place.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Placement of the simulator on the host (AC_HOST_CPUS,
+ *            AC_HOST_NUMA and AC_HOST_HUGEPAGES).
+ *            The NUMA policies are set with the system calls themselves,
+ *            so that simulators need no libnuma.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <map>
+#include <vector>
+
+#include "ac_host_place.H"
+
+namespace {
+
+//! Memory policies of <numaif.h>.
+const int kPreferred = 1;
+const int kBind = 2;
+
+//! Nodes a policy can name.
+const int kNodes = 1024;
+
+const int kNoNode = -1;
+const int kLocalNode = -2;
+
+pthread_once_t once = PTHREAD_ONCE_INIT;
+std::vector<int> cpus;
+int numa = kNoNode;             //!< Node of AC_HOST_NUMA, or kLocalNode
+ac_host_pages pages = AC_HOST_PAGES_SMALL;
+
+unsigned next_cpu = 0;          //!< Of cpus, for the next thread pinned
+int home = kNoNode;             //!< Node the memory goes to
+
+//! Tables of ac_host_alloc() that were mapped, with the bytes of each.
+pthread_mutex_t mappings_lock = PTHREAD_MUTEX_INITIALIZER;
+std::map<void*, size_t> mappings;
+
+// A list as in "0-3,8", or false.
+bool parse_cpus(const char* s, std::vector<int>& list) {
+  while (*s) {
+    char* end;
+    long first = strtol(s, &end, 10), last = first;
+
+    if (end == s || first < 0 || first >= CPU_SETSIZE)
+      return false;
+    s = end;
+    if (*s == '-') {
+      last = strtol(s + 1, &end, 10);
+      if (end == s + 1 || last < first || last >= CPU_SETSIZE)
+        return false;
+      s = end;
+    }
+    for (long c = first; c <= last; c++)
+      list.push_back(c);
+    if (*s == ',')
+      s++;
+    else if (*s)
+      return false;
+  }
+  return !list.empty();
+}
+
+void read_options() {
+  const char* s = getenv(ENV_AC_HOST_CPUS);
+
+  if (s && *s && !parse_cpus(s, cpus)) {
+    fprintf(stderr, "ArchC: Bad %s \"%s\", no thread is pinned.\n", ENV_AC_HOST_CPUS, s);
+    cpus.clear();
+  }
+
+  s = getenv(ENV_AC_HOST_NUMA);
+  if (s && *s) {
+    char* end;
+    long node = strtol(s, &end, 10);
+
+    if (!strcmp(s, "local"))
+      numa = kLocalNode;
+    else if (end != s && !*end && node >= 0 && node < kNodes)
+      numa = node;
+    else
+      fprintf(stderr, "ArchC: Bad %s \"%s\", the memory is not bound.\n", ENV_AC_HOST_NUMA, s);
+  }
+  if (numa >= 0)
+    home = numa;
+
+  s = getenv(ENV_AC_HOST_HUGEPAGES);
+  if (s && *s && strcmp(s, "0"))
+    pages = strcmp(s, "explicit") ? AC_HOST_PAGES_THP : AC_HOST_PAGES_EXPLICIT;
+}
+
+// The node the calling thread runs on, or kNoNode.
+int current_node() {
+#ifdef SYS_getcpu
+  unsigned cpu, node;
+
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+    return node;
+#endif
+  return kNoNode;
+}
+
+// The node memory goes to: that of AC_HOST_NUMA, or for "local" that of
+// the first thread pinned, or of the first one to ask.
+int memory_node() {
+  if (numa == kNoNode)
+    return kNoNode;
+  if (home == kNoNode)
+    __sync_bool_compare_and_swap(&home, kNoNode, current_node());
+  return home;
+}
+
+// Sets the policy of the calling thread, or of [p, p + n) if p is not 0.
+void set_policy(void* p, size_t n) {
+  unsigned long mask[kNodes / (8 * sizeof(unsigned long))] = {0};
+  int node = memory_node(), mode = numa == kLocalNode ? kPreferred : kBind;
+  long r = -1;
+
+  if (node < 0)
+    return;
+  mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+#if defined(SYS_mbind) && defined(SYS_set_mempolicy)
+  // The kernel reads one bit less than maxnode
+  if (p)
+    r = syscall(SYS_mbind, p, n, mode, mask, kNodes + 1, 0);
+  else
+    r = syscall(SYS_set_mempolicy, mode, mask, kNodes + 1);
+#endif
+  if (r != 0) {
+    static bool warned = false;
+
+    if (!warned)
+      fprintf(stderr, "ArchC: Could not bind memory to NUMA node %d.\n", node);
+    warned = true;
+  }
+}
+
+void pin(unsigned slot, const char* what, int& cpu) {
+  cpu_set_t set;
+
+  cpu = cpus[slot % cpus.size()];
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    fprintf(stderr, "ArchC: Could not pin the %s to CPU %d.\n", what, cpu);
+    cpu = -1;
+    return;
+  }
+  // The first thread pinned gives "local" its node
+  if (numa == kLocalNode && home == kNoNode)
+    __sync_bool_compare_and_swap(&home, kNoNode, current_node());
+}
+
+// Bytes of the huge pages mapped explicitly.
+size_t huge_page_size() {
+  FILE* f = fopen("/proc/meminfo", "r");
+  char line[128];
+  size_t kb = 2048;
+
+  if (!f)
+    return kb << 10;
+  while (fgets(line, sizeof(line), f))
+    if (sscanf(line, "Hugepagesize: %zu kB", &kb) == 1)
+      break;
+  fclose(f);
+  return kb << 10;
+}
+
+} // namespace
+
+int ac_host_pin(const char* what) {
+  int cpu = -1;
+
+  pthread_once(&once, read_options);
+  if (!cpus.empty())
+    pin(__sync_fetch_and_add(&next_cpu, 1), what, cpu);
+  if (numa != kNoNode)
+    set_policy(0, 0);
+  return cpu;
+}
+
+int ac_host_pin_job(unsigned job, const char* what) {
+  int cpu = -1;
+
+  pthread_once(&once, read_options);
+  if (!cpus.empty()) {
+    next_cpu = job + 1;
+    pin(job, what, cpu);
+  }
+  if (numa != kNoNode)
+    set_policy(0, 0);
+  return cpu;
+}
+
+ac_host_pages ac_host_hugepages() {
+  pthread_once(&once, read_options);
+  return pages;
+}
+
+void ac_host_advise(void* p, size_t n, bool hugepages) {
+  pthread_once(&once, read_options);
+#ifdef MADV_HUGEPAGE
+  if (hugepages)
+    madvise(p, n, MADV_HUGEPAGE);
+#endif
+  if (numa != kNoNode)
+    set_policy(p, n);
+}
+
+void* ac_host_alloc(size_t n) {
+  void* p = MAP_FAILED;
+  size_t len = n;
+
+  pthread_once(&once, read_options);
+  if (n < AC_HOST_MAP_THRESHOLD || (pages == AC_HOST_PAGES_SMALL && numa == kNoNode))
+    return calloc(n, 1);
+
+#ifdef MAP_HUGETLB
+  //Reserved at once, so that running out of huge pages is no SIGBUS later
+  if (pages == AC_HOST_PAGES_EXPLICIT) {
+    size_t huge = huge_page_size();
+
+    len = (n + huge - 1) / huge * huge;
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p == MAP_FAILED) {
+      static bool warned = false;
+
+      if (!warned)
+        fprintf(stderr, "ArchC: No huge pages reserved for a table of %zu bytes, "
+                "using transparent ones (see /proc/sys/vm/nr_hugepages).\n", n);
+      warned = true;
+      len = n;
+    }
+    else if (numa != kNoNode)
+      set_policy(p, len);
+  }
+#endif
+  if (p == MAP_FAILED) {
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED)
+      return calloc(n, 1);
+    ac_host_advise(p, len, pages != AC_HOST_PAGES_SMALL);
+  }
+
+  pthread_mutex_lock(&mappings_lock);
+  mappings[p] = len;
+  pthread_mutex_unlock(&mappings_lock);
+  return p;
+}
+
+void ac_host_release(void* p) {
+  std::map<void*, size_t>::iterator m;
+  size_t len = 0;
+
+  if (!p)
+    return;
+  pthread_mutex_lock(&mappings_lock);
+  if ((m = mappings.find(p)) != mappings.end()) {
+    len = m->second;
+    mappings.erase(m);
+  }
+  pthread_mutex_unlock(&mappings_lock);
+  if (len)
+    munmap(p, len);
+  else
+    free(p);
+}
@@ -0,0 +1,157 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_host_profile.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Host time of the simulator by phase (--host-profile).
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include "ac_host_profile.H"
+#include "ac_stats_out.H"
+
+thread_local ac_host_profile_state ac_host_profile_thread;
+
+namespace {
+
+const char* const phase_names[AC_PHASE_COUNT] = {
+  "other", "fetch", "decode", "behavior", "analysis", "dinero", "power", "syscall", "wait"
+};
+
+//! The first thread to switch, which runs the simulation, and when it did.
+ac_host_profile_state* simulation_thread = 0;
+unsigned long long start_ticks;
+long long start_ns;
+
+long long now_ns() {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+#ifdef __linux__
+int open_counter(unsigned long long config, int group) {
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.read_format = PERF_FORMAT_GROUP;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+//! Opens the cycles and instructions of the thread as one group, so a
+//! single read gives both.
+void open_counters(ac_host_profile_state& s) {
+  const char* env = getenv(ENV_AC_HOST_PROFILE_PERF);
+
+  if (!env || !*env || *env == '0')
+    return;
+#ifdef __linux__
+  s.perf_fd = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1);
+  if (s.perf_fd >= 0 && open_counter(PERF_COUNT_HW_INSTRUCTIONS, s.perf_fd) >= 0) {
+    s.counting = true;
+    return;
+  }
+  if (s.perf_fd >= 0)
+    close(s.perf_fd);
+#endif
+  fprintf(stderr, "ArchC: %s is set, but the perf_event counters could not be opened; "
+          "only the host time is profiled.\n", ENV_AC_HOST_PROFILE_PERF);
+}
+
+} // namespace
+
+void ac_host_profile_start(ac_host_profile_state& s) {
+  if (!simulation_thread) {
+    simulation_thread = &s;
+    start_ticks = ac_host_ticks();
+    start_ns = now_ns();
+  }
+  open_counters(s);
+  if (s.counting)
+    ac_host_profile_count(s, s.phase);
+}
+
+void ac_host_profile_count(ac_host_profile_state& s, unsigned phase) {
+  unsigned long long values[3]; // number of counters, cycles, instructions
+
+  if (read(s.perf_fd, values, sizeof(values)) != (ssize_t) sizeof(values))
+    return;
+  s.cycles[phase] += values[1] - s.last_cycles;
+  s.instructions[phase] += values[2] - s.last_instructions;
+  s.last_cycles = values[1];
+  s.last_instructions = values[2];
+}
+
+void ac_host_profile_print(double real_seconds) {
+  ac_host_profile_state* s = simulation_thread;
+  unsigned long long total = 0;
+  double ns_per_tick;
+
+  if (!s || s != &ac_host_profile_thread)
+    return;
+  //Closes the phase being timed, and calibrates the ticks over the run.
+  ac_host_phase_switch(s->phase);
+  if (s->since > start_ticks)
+    ns_per_tick = (double) (now_ns() - start_ns) / (s->since - start_ticks);
+  else
+    ns_per_tick = 1;
+  for (unsigned p = 0; p < AC_PHASE_COUNT; p++)
+    total += s->ticks[p];
+
+  fprintf(stderr, "ArchC: Host time by phase\n");
+  for (unsigned p = 0; p < AC_PHASE_COUNT; p++) {
+    double seconds = s->ticks[p] * ns_per_tick / 1e9;
+    std::string name = phase_names[p];
+
+    fprintf(stderr, "    %-12s %10.3f s %6.2f %% %14llu entries", phase_names[p], seconds,
+            total ? 100.0 * s->ticks[p] / total : 0, s->entries[p]);
+    if (s->counting)
+      fprintf(stderr, ", %14llu cycles, IPC %.2f", s->cycles[p],
+              s->cycles[p] ? (double) s->instructions[p] / s->cycles[p] : 0);
+    fprintf(stderr, "\n");
+    if (ac_stats_out_enabled()) {
+      ac_stats_out_add("host_profile", name + ".seconds", seconds);
+      ac_stats_out_add("host_profile", name + ".entries", s->entries[p]);
+      if (s->counting) {
+        ac_stats_out_add("host_profile", name + ".cycles", s->cycles[p]);
+        ac_stats_out_add("host_profile", name + ".instructions", s->instructions[p]);
+      }
+    }
+  }
+  fprintf(stderr, "    %-12s %10.3f s", "Total:", total * ns_per_tick / 1e9);
+  if (real_seconds > 0)
+    fprintf(stderr, " (%.2f %% of the real time)", total * ns_per_tick / 1e7 / real_seconds);
+  fprintf(stderr, "\n");
+  if (ac_stats_out_enabled())
+    ac_stats_out_add("host_profile", "seconds", total * ns_per_tick / 1e9);
+}
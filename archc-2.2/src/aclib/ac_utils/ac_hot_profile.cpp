@@ -0,0 +1,102 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_hot_profile.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Hot code of an earlier run, for the JIT to translate first.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "ac_hot_profile.H"
+
+namespace {
+
+struct range {
+  unsigned start, end;
+  double count;
+};
+
+bool hotter(const range& x, const range& y) {
+  return x.count > y.count;
+}
+
+bool loaded = false;
+std::vector<std::pair<unsigned, unsigned> > hot; //!< Ranges, sorted and disjoint
+
+void load()
+{
+  const char* path = getenv(ENV_AC_HOT_PROFILE);
+  const char* coverage = getenv(ENV_AC_HOT_PROFILE_COVERAGE);
+  double percent = coverage && *coverage ? strtod(coverage, NULL) : 90, total = 0, covered = 0;
+  std::vector<range> ranges;
+  char line[512], *p, *q;
+  FILE* f;
+
+  loaded = true;
+  if (!path || !*path)
+    return;
+  if (!(f = fopen(path, "r"))) {
+    fprintf(stderr, "ArchC: Could not open hot profile %s.\n", path);
+    return;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    range r;
+
+    if (line[0] == '#')
+      continue;
+    r.start = strtoul(line, &p, 0);
+    r.count = strtod(p, &q);
+    if (p == line || q == p)
+      continue;
+    r.end = strtoul(q, &p, 0);
+    if (p == q || r.end < r.start)
+      r.end = r.start;
+    total += r.count;
+    ranges.push_back(r);
+  }
+  fclose(f);
+
+  std::stable_sort(ranges.begin(), ranges.end(), hotter);
+  for (size_t i = 0; i < ranges.size() && ranges[i].count > 0 && covered < total * percent / 100; i++) {
+    hot.push_back(std::make_pair(ranges[i].start, ranges[i].end));
+    covered += ranges[i].count;
+  }
+  //Nested loops overlap: merge them
+  std::sort(hot.begin(), hot.end());
+  size_t n = 0;
+  for (size_t i = 0; i < hot.size(); i++)
+    if (n && hot[i].first <= hot[n - 1].second)
+      hot[n - 1].second = std::max(hot[n - 1].second, hot[i].second);
+    else
+      hot[n++] = hot[i];
+  hot.resize(n);
+}
+
+} // namespace
+
+bool ac_hot_profile_has(unsigned address)
+{
+  if (!loaded)
+    load();
+  std::vector<std::pair<unsigned, unsigned> >::const_iterator it =
+    std::upper_bound(hot.begin(), hot.end(), std::make_pair(address, ~0U));
+  return it != hot.begin() && address <= (--it)->second;
+}
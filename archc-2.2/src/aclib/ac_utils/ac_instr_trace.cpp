@@ -0,0 +1,286 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_instr_trace.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Binary instruction traces of windows of the run.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ac_instr_trace.H"
+#include "ac_symbols.H"
+
+ac_instr_trace ac_itrace;
+
+static const size_t kFlushSize = 1 << 20;
+
+static void ac_instr_trace_close()
+{
+  if (!ac_itrace.close())
+    fprintf(stderr, "ArchC: Could not write the whole instruction trace.\n");
+}
+
+//The first instruction wakes the trace, which then reads the environment
+ac_instr_trace::ac_instr_trace() : wake_pc(kNever), wake_count(0), tracing(false), opened(false),
+                                   windows(1), opened_at(0), traced(0), last_pc(kNever),
+                                   defined(0), fd(-1), failed(false), owner(0) {
+  start.kind = stop.kind = kNone;
+}
+
+bool ac_instr_trace::wake(uint32_t pc, unsigned long long count)
+{
+  bool now;
+
+  if (!opened) {
+    open();
+    return check(pc, count);
+  }
+  if (tracing) {
+    switch (stop.kind) {
+    case kPC:
+    case kMarker: now = pc == stop.address; break;
+    case kCount:  now = count >= opened_at + stop.count; break;
+    case kSymbol: now = returned(pc); break;
+    default:      now = false; break;
+    }
+    //The instruction that stops the trace is left out of it
+    if (now)
+      close_window();
+    return !now;
+  }
+  switch (start.kind) {
+  case kNone:  now = true; break;
+  case kCount: now = count >= start.count; break;
+  default:     now = pc == start.address; break;
+  }
+  if (now)
+    open_window(count);
+  return now;
+}
+
+bool ac_instr_trace::parse(const char* env, const char* marker, Trigger& t)
+{
+  const char* name = getenv(env);
+  char* end;
+
+  t.kind = kNone;
+  t.address = t.size = 0;
+  t.count = 0;
+  if (!name || !*name)
+    return true;
+  if (!strncmp(name, "pc:", 3)) {
+    t.kind = kPC;
+    t.address = strtoul(name + 3, &end, 0);
+    return name[3] && !*end;
+  }
+  if (!strncmp(name, "count:", 6)) {
+    t.kind = kCount;
+    t.count = strtoull(name + 6, &end, 0);
+    return name[6] && !*end;
+  }
+  if (!strncmp(name, "sym:", 4) || !strcmp(name, "marker")) {
+    const char* function = strcmp(name, "marker") ? name + 4 : marker;
+
+    t.kind = function == marker ? kMarker : kSymbol;
+    if (!(t.address = ac_symbol_address(function, &t.size))) {
+      fprintf(stderr, "ArchC: The program has no function %s for %s.\n", function, env);
+      return false;
+    }
+    return true;
+  }
+  fprintf(stderr, "ArchC: %s should be pc:ADDRESS, count:N, sym:NAME or marker.\n", env);
+  return false;
+}
+
+void ac_instr_trace::open()
+{
+  const char* path = getenv(ENV_AC_INSTR_TRACE);
+  const char* limit = getenv(ENV_AC_INSTR_TRACE_WINDOWS);
+
+  opened = true;
+  tracing = false;
+  //No trigger ever fires until the trace is set up
+  wake_pc = kNever;
+  wake_count = ~0ULL;
+  if (!path || !*path)
+    return;
+  if (!parse(ENV_AC_INSTR_TRACE_START, "ac_trace_start", start) ||
+      !parse(ENV_AC_INSTR_TRACE_STOP, "ac_trace_stop", stop)) {
+    fprintf(stderr, "ArchC: Not writing instruction trace %s.\n", path);
+    return;
+  }
+  if (stop.kind == kNone && start.kind == kSymbol)
+    stop = start;
+  windows = limit && *limit ? strtoull(limit, NULL, 10) : 1;
+
+  if ((fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+    fprintf(stderr, "ArchC: Could not create instruction trace %s.\n", path);
+    return;
+  }
+  owner = getpid();
+  buffer.reserve(kFlushSize + 512);
+  buffer.append("ACIT");
+  buffer.push_back((char) kVersion);
+  atexit(ac_instr_trace_close);
+  arm();
+}
+
+//Waits for the start trigger, or for nothing once the last window closed
+void ac_instr_trace::arm()
+{
+  tracing = false;
+  wake_pc = kNever;
+  wake_count = ~0ULL;
+  if (fd == -1)
+    return;
+  switch (start.kind) {
+  case kNone:  wake_count = 0; break;
+  case kCount: wake_count = start.count; break;
+  default:     wake_pc = start.address; break;
+  }
+}
+
+void ac_instr_trace::open_window(unsigned long long count)
+{
+  //Forked processes leave the trace to their parent
+  if (getpid() != owner) {
+    fd = -1;
+    arm();
+    return;
+  }
+  tracing = true;
+  opened_at = count;
+  traced = 0;
+  last_pc = kNever;
+  //Those fire once
+  if (start.kind == kNone || start.kind == kCount)
+    windows = 1;
+  wake_pc = kNever;
+  wake_count = ~0ULL;
+  switch (stop.kind) {
+  case kPC:
+  case kMarker: wake_pc = stop.address; break;
+  case kCount:  wake_count = count + stop.count; break;
+  case kSymbol: wake_count = 0; break;
+  default:      break;
+  }
+  put(kOpen);
+  put(count);
+}
+
+void ac_instr_trace::close_window()
+{
+  put(kClose);
+  put(traced);
+  if (windows && !--windows)
+    finish();
+  arm();
+}
+
+void ac_instr_trace::finish()
+{
+  flush();
+  if (fd >= 0 && ::close(fd) != 0)
+    failed = true;
+  fd = -1;
+}
+
+//Whether pc left the function of the stop trigger for its caller: the
+//last instruction was in it, pc is not, and pc is no function's entry,
+//as that of a call is
+bool ac_instr_trace::returned(uint32_t pc) const
+{
+  unsigned offset;
+
+  if (last_pc - stop.address >= stop.size || pc - stop.address < stop.size)
+    return false;
+  return !ac_symbol_at(pc, &offset) || offset;
+}
+
+void ac_instr_trace::record(uint32_t pc, unsigned id, unsigned size, uint32_t word, const char* name)
+{
+  std::unordered_map<uint32_t, Entry>::iterator e = entries.find(pc);
+
+  //An entry decoded again to another instruction is a new one
+  if (e != entries.end() && e->second.id == id)
+    put(kFirstEntry + e->second.number);
+  else {
+    size_t length = strlen(name);
+    Entry entry = {defined++, id};
+
+    entries[pc] = entry;
+    put(kEntry);
+    put(pc);
+    put(id);
+    buffer.push_back((char) size);
+    for (int i = 0; i < 4; i++)
+      buffer.push_back((char) (word >> 8 * i));
+    length = length < 255 ? length : 255;
+    buffer.push_back((char) length);
+    buffer.append(name, length);
+  }
+  traced++;
+  last_pc = pc;
+  if (buffer.size() >= kFlushSize)
+    flush();
+}
+
+void ac_instr_trace::put(unsigned long long value)
+{
+  do {
+    unsigned char byte = value & 0x7f;
+
+    value >>= 7;
+    buffer.push_back((char) (value ? byte | 0x80 : byte));
+  } while (value);
+}
+
+void ac_instr_trace::flush()
+{
+  size_t done = 0;
+  ssize_t n;
+
+  if (fd < 0 || getpid() != owner) {
+    buffer.clear();
+    return;
+  }
+  while (done < buffer.size()) {
+    if ((n = ::write(fd, buffer.data() + done, buffer.size() - done)) <= 0) {
+      failed = true;
+      break;
+    }
+    done += n;
+  }
+  buffer.clear();
+}
+
+bool ac_instr_trace::close()
+{
+  if (fd < 0 || getpid() != owner)
+    return !failed;
+  if (tracing) {
+    put(kClose);
+    put(traced);
+  }
+  finish();
+  arm();
+  return !failed;
+}
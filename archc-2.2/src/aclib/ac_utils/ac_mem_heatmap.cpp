@@ -0,0 +1,158 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_mem_heatmap.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Page-level memory heatmaps.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+
+#include "ac_mem_heatmap.H"
+
+static ac_mem_heatmap* ac_mem_heatmap_instance = NULL;
+
+static void ac_mem_heatmap_close_instance()
+{
+  if (ac_mem_heatmap_instance && !ac_mem_heatmap_instance->close())
+    fprintf(stderr, "ArchC: Could not write the memory heatmap.\n");
+}
+
+ac_mem_heatmap* ac_mem_heatmap::instance()
+{
+  static bool tried = false;
+  const char* path = getenv(ENV_AC_MEM_HEATMAP);
+
+  if (tried)
+    return ac_mem_heatmap_instance;
+  tried = true;
+
+  if (!path || !*path)
+    return NULL;
+
+  ac_mem_heatmap_instance = new ac_mem_heatmap(path);
+  atexit(ac_mem_heatmap_close_instance);
+  return ac_mem_heatmap_instance;
+}
+
+ac_mem_heatmap::ac_mem_heatmap(const char* file) : page_bits(12), cached(~0U), cached_page(NULL),
+                                                   touched(0), active(0), interval_start(0),
+                                                   path(file), owner(getpid())
+{
+  const char* page = getenv(ENV_AC_MEM_HEATMAP_PAGE);
+  const char* every = getenv(ENV_AC_MEM_HEATMAP_INTERVAL);
+  unsigned long size = page && *page ? strtoul(page, NULL, 0) : 4096;
+
+  while ((1UL << page_bits) < size && page_bits < 24)
+    page_bits++;
+  if ((1UL << page_bits) != size || page_bits < kLeafBits - 4) {
+    fprintf(stderr, "ArchC: %s must be a power of two between 64 and 16M. Using 4096.\n",
+            ENV_AC_MEM_HEATMAP_PAGE);
+    page_bits = 12;
+  }
+  leaves.assign(((1ULL << (32 - page_bits)) + (1U << kLeafBits) - 1) >> kLeafBits, (Page*) NULL);
+  interval = every && *every ? strtoull(every, NULL, 0) : 1000000;
+  next_sample = interval ? interval : ~0ULL;
+}
+
+ac_mem_heatmap::Page& ac_mem_heatmap::find(uint32_t page)
+{
+  Page*& leaf = leaves[page >> kLeafBits];
+
+  if (!leaf) {
+    leaf = new Page[1U << kLeafBits];
+    for (unsigned i = 0; i < (1U << kLeafBits); i++) {
+      leaf[i].count[kFetch] = leaf[i].count[kRead] = leaf[i].count[kWrite] = 0;
+      leaf[i].first = kUntouched;
+      leaf[i].last = 0;
+    }
+  }
+  cached = page;
+  cached_page = &leaf[page & ((1U << kLeafBits) - 1)];
+  return *cached_page;
+}
+
+//Closes the interval that ended at next_sample, before the first access of
+//time; intervals with no access leave no sample
+void ac_mem_heatmap::sample(unsigned long long time)
+{
+  Sample s = {next_sample, touched, active};
+
+  samples.push_back(s);
+  active = 0;
+  interval_start = time;
+  next_sample = time - time % interval + interval;
+}
+
+bool ac_mem_heatmap::close()
+{
+  FILE* f;
+  uint32_t page, start = 0, pages = 0;
+  bool in_run = false;
+  unsigned long long last_time = 0;
+
+  if (getpid() != owner)
+    return true;
+  if (!(f = fopen(path, "w")))
+    return false;
+
+  fprintf(f, "# ArchC memory heatmap: %llu pages of %u bytes touched, %llu bytes\n",
+          touched, 1U << page_bits, touched << page_bits);
+  fprintf(f, "# page address, fetches, reads, writes, first and last instruction\n");
+  for (size_t l = 0; l < leaves.size(); l++)
+    for (unsigned i = 0; leaves[l] && i < (1U << kLeafBits); i++) {
+      const Page& p = leaves[l][i];
+
+      if (p.first == kUntouched)
+        continue;
+      fprintf(f, "0x%08x %llu %llu %llu %llu %llu\n", (uint32_t) (((l << kLeafBits) + i) << page_bits),
+              p.count[kFetch], p.count[kRead], p.count[kWrite], p.first, p.last);
+      if (p.last > last_time)
+        last_time = p.last;
+    }
+
+  //Runs of touched pages show how the guest laid out text, heap and stack
+  fprintf(f, "# regions: first and last address, pages, gap to the next in bytes\n");
+  for (uint64_t n = 0; n <= ((uint64_t) leaves.size() << kLeafBits); n++) {
+    const Page* p = NULL;
+
+    page = (uint32_t) n;
+    if (n < ((uint64_t) leaves.size() << kLeafBits) && leaves[page >> kLeafBits])
+      p = &leaves[page >> kLeafBits][page & ((1U << kLeafBits) - 1)];
+    if (p && p->first != kUntouched && in_run && page == start + pages) {
+      pages++;
+      continue;
+    }
+    if ((p && p->first != kUntouched) || n == ((uint64_t) leaves.size() << kLeafBits)) {
+      if (in_run)
+        fprintf(f, "0x%08x 0x%08x %u %llu\n", start << page_bits,
+                (uint32_t) ((((uint64_t) start + pages) << page_bits) - 1), pages,
+                p ? (unsigned long long) (page - start - pages) << page_bits : 0ULL);
+      start = page;
+      pages = 1;
+      in_run = true;
+    }
+  }
+
+  //The last interval goes as far as it got
+  fprintf(f, "# resident set: instruction, pages touched so far, pages touched in the interval\n");
+  for (size_t k = 0; k < samples.size(); k++)
+    fprintf(f, "%llu %llu %llu\n", samples[k].time, samples[k].touched, samples[k].active);
+  if (interval && active)
+    fprintf(f, "%llu %llu %llu\n", last_time, touched, active);
+  return fclose(f) == 0;
+}
@@ -0,0 +1,190 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_mem_trace.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Memory-reference traces.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ac_mem_trace.H"
+
+static ac_mem_trace* ac_mem_trace_instance = NULL;
+
+static void ac_mem_trace_close_instance()
+{
+  if (ac_mem_trace_instance && !ac_mem_trace_instance->close())
+    fprintf(stderr, "ArchC: Could not write the whole memory trace.\n");
+}
+
+ac_mem_trace* ac_mem_trace::instance()
+{
+  static bool tried = false;
+  const char* path = getenv(ENV_AC_MEM_TRACE);
+
+  if (tried)
+    return ac_mem_trace_instance;
+  tried = true;
+
+  if (!path || !*path)
+    return NULL;
+
+  ac_mem_trace_instance = new ac_mem_trace;
+  if (!ac_mem_trace_instance->open(path)) {
+    fprintf(stderr, "ArchC: Could not create memory trace %s.\n", path);
+    delete ac_mem_trace_instance;
+    ac_mem_trace_instance = NULL;
+  }
+  else
+    atexit(ac_mem_trace_close_instance);
+  return ac_mem_trace_instance;
+}
+
+ac_mem_trace::ac_mem_trace() : blocks(NULL), fill(0), head(0), tail(0),
+                               done(false), failed(false), out(NULL),
+                               compressor(0), owner(0) {}
+
+bool ac_mem_trace::open(const char* path)
+{
+  static const char* const compressors[][2] = {
+    {".gz", "gzip"}, {".zst", "zstd"}, {".lz4", "lz4"}
+  };
+  size_t len = strlen(path);
+  const char* program = NULL;
+  int fd, p[2];
+
+  for (unsigned i = 0; i < sizeof(compressors) / sizeof(compressors[0]); i++) {
+    size_t n = strlen(compressors[i][0]);
+    if (len > n && !strcmp(path + len - n, compressors[i][0]))
+      program = compressors[i][1];
+  }
+
+  if ((fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1)
+    return false;
+
+  if (!program)
+    out = fdopen(fd, "wb");
+  else {
+    //The compressor reads the records from a pipe and writes the file
+    if (pipe(p) == -1) {
+      ::close(fd);
+      return false;
+    }
+    if ((compressor = fork()) == 0) {
+      dup2(p[0], 0);
+      dup2(fd, 1);
+      ::close(p[0]);
+      ::close(p[1]);
+      ::close(fd);
+      execlp(program, program, "-1", "-c", (char*) NULL);
+      _exit(127);
+    }
+    ::close(p[0]);
+    ::close(fd);
+    if (compressor == -1) {
+      compressor = 0;
+      ::close(p[1]);
+      return false;
+    }
+    out = fdopen(p[1], "wb");
+  }
+  if (!out)
+    return false;
+
+  //Blocks go straight to the file, so a fork leaves nothing buffered
+  setvbuf(out, NULL, _IONBF, 0);
+  owner = getpid();
+  blocks = new uint8_t[kBlocks][kBlockSize];
+  if (pthread_create(&writer, NULL, write_blocks, this) != 0) {
+    delete[] blocks;
+    blocks = NULL;
+    fclose(out);
+    out = NULL;
+    return false;
+  }
+  return true;
+}
+
+//Hands the full block to the writer, waiting for room in the ring
+void ac_mem_trace::publish()
+{
+  unsigned long h = head.load(std::memory_order_relaxed);
+
+  //After close, or in a forked child, the records are dropped
+  if (!out || getpid() != owner) {
+    fill = 0;
+    return;
+  }
+  while (h - tail.load(std::memory_order_acquire) == kBlocks - 1)
+    sched_yield();
+  head.store(h + 1, std::memory_order_release);
+  fill = 0;
+}
+
+void* ac_mem_trace::write_blocks(void* self)
+{
+  ac_mem_trace* t = (ac_mem_trace*) self;
+  unsigned long next = 0;
+
+  for (;;) {
+    if (next != t->head.load(std::memory_order_acquire)) {
+      if (fwrite(t->blocks[next % kBlocks], kBlockSize, 1, t->out) != 1)
+        t->failed = true;
+      t->tail.store(++next, std::memory_order_release);
+    }
+    else if (t->done.load(std::memory_order_acquire))
+      break;
+    else
+      usleep(1000);
+  }
+  return NULL;
+}
+
+bool ac_mem_trace::close()
+{
+  int status;
+
+  if (!out)
+    return false;
+  if (getpid() != owner)
+    return true;
+
+  //The writer empties the ring before it exits on done
+  done.store(true, std::memory_order_release);
+  pthread_join(writer, NULL);
+
+  if (fill && fwrite(blocks[head.load() % kBlocks], fill, 1, out) != 1)
+    failed = true;
+  fill = 0;
+  if (fclose(out) != 0)
+    failed = true;
+  out = NULL;
+
+  if (compressor) {
+    if (waitpid(compressor, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status))
+      failed = true;
+    compressor = 0;
+  }
+
+  //blocks stay allocated, for references made after the trace is closed
+  return !failed;
+}
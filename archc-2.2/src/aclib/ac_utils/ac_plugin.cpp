@@ -0,0 +1,155 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_plugin.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Instrumentation plugins (--plugin=FILE[,ARGS]).
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string>
+
+#include "ac_plugin.H"
+
+unsigned ac_hooks_active = 0;
+
+namespace {
+
+const int kCallbacks = 8;
+
+//! Callbacks of one kind, called in order of registration.
+struct hook_list {
+  void (*fn[kCallbacks])();
+  void* arg[kCallbacks];
+  int count;
+};
+
+hook_list hooks[AC_HOOK_KINDS];
+
+const char* const* instr_names = 0;
+unsigned instr_count = 0;
+
+bool add(ac_hook_kind kind, void (*fn)(), void* arg) {
+  hook_list& h = hooks[kind];
+
+  if (h.count == kCallbacks) {
+    fprintf(stderr, "ArchC: Too many plugin callbacks of kind %d.\n", kind);
+    return false;
+  }
+  h.fn[h.count] = fn;
+  h.arg[h.count] = arg;
+  h.count++;
+  ac_hooks_active |= 1U << kind;
+  return true;
+}
+
+} // namespace
+
+bool ac_hook_on_retire(ac_hook_retire_fn fn, void* arg) {
+  return add(AC_HOOK_RETIRE, (void (*)()) fn, arg);
+}
+
+bool ac_hook_on_read(ac_hook_access_fn fn, void* arg) {
+  return add(AC_HOOK_READ, (void (*)()) fn, arg);
+}
+
+bool ac_hook_on_write(ac_hook_access_fn fn, void* arg) {
+  return add(AC_HOOK_WRITE, (void (*)()) fn, arg);
+}
+
+bool ac_hook_on_branch(ac_hook_branch_fn fn, void* arg) {
+  return add(AC_HOOK_BRANCH, (void (*)()) fn, arg);
+}
+
+bool ac_hook_on_syscall(ac_hook_syscall_fn fn, void* arg) {
+  return add(AC_HOOK_SYSCALL, (void (*)()) fn, arg);
+}
+
+bool ac_hook_on_block(ac_hook_block_fn fn, void* arg) {
+  return add(AC_HOOK_BLOCK, (void (*)()) fn, arg);
+}
+
+const char* ac_plugin_instr_name(unsigned id) {
+  return id < instr_count && instr_names[id] ? instr_names[id] : "?";
+}
+
+void ac_plugin_instr_names(const char* const* names, unsigned count) {
+  instr_names = names;
+  instr_count = count;
+}
+
+void ac_hook_retire(uint32_t pc, unsigned id) {
+  const hook_list& h = hooks[AC_HOOK_RETIRE];
+
+  for (int i = 0; i < h.count; i++)
+    ((ac_hook_retire_fn) h.fn[i])(h.arg[i], pc, id);
+}
+
+void ac_hook_access(ac_hook_kind kind, uint32_t address, unsigned size) {
+  const hook_list& h = hooks[kind];
+
+  for (int i = 0; i < h.count; i++)
+    ((ac_hook_access_fn) h.fn[i])(h.arg[i], address, size);
+}
+
+void ac_hook_branch(uint32_t pc, uint32_t next_pc) {
+  const hook_list& h = hooks[AC_HOOK_BRANCH];
+
+  for (int i = 0; i < h.count; i++)
+    ((ac_hook_branch_fn) h.fn[i])(h.arg[i], pc, next_pc);
+}
+
+void ac_hook_syscall(uint32_t pc, const char* name) {
+  const hook_list& h = hooks[AC_HOOK_SYSCALL];
+
+  for (int i = 0; i < h.count; i++)
+    ((ac_hook_syscall_fn) h.fn[i])(h.arg[i], pc, name);
+}
+
+void ac_hook_block(uint32_t pc, unsigned size) {
+  const hook_list& h = hooks[AC_HOOK_BLOCK];
+
+  for (int i = 0; i < h.count; i++)
+    ((ac_hook_block_fn) h.fn[i])(h.arg[i], pc, size);
+}
+
+bool ac_plugin_load(const char* spec) {
+  std::string file(spec), args;
+  std::string::size_type comma = file.find(',');
+  void* handle;
+  ac_plugin_init_fn init;
+
+  if (comma != std::string::npos) {
+    args = file.substr(comma + 1);
+    file.erase(comma);
+  }
+  //The plugins call back into the simulator, which must export its symbols (-rdynamic)
+  if (!(handle = dlopen(file.c_str(), RTLD_NOW | RTLD_LOCAL))) {
+    fprintf(stderr, "ArchC: Could not load the plugin %s: %s\n", file.c_str(), dlerror());
+    return false;
+  }
+  if (!(init = (ac_plugin_init_fn) dlsym(handle, "ac_plugin_init"))) {
+    fprintf(stderr, "ArchC: The plugin %s has no ac_plugin_init().\n", file.c_str());
+    dlclose(handle);
+    return false;
+  }
+  if (!init(args.c_str())) {
+    fprintf(stderr, "ArchC: The plugin %s did not start.\n", file.c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,211 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_stats_out.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Machine-readable statistics (--stats-out=FILE).
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "ac_stats_out.H"
+
+namespace {
+
+struct section {
+  std::string name;
+  std::vector<std::pair<std::string, double> > values;
+};
+
+std::string stats_path;
+bool stats_json = false;
+std::vector<section> stats; // in the order they were added
+
+void write_at_exit()
+{
+  if (!ac_stats_out_write())
+    fprintf(stderr, "ArchC: Could not write statistics to %s\n", stats_path.c_str());
+}
+
+bool ends_with(const std::string& s, const char* suffix)
+{
+  size_t n = strlen(suffix);
+
+  return s.size() >= n && !s.compare(s.size() - n, n, suffix);
+}
+
+void put_string(FILE* f, const std::string& s)
+{
+  fputc('"', f);
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] == '"' || s[i] == '\\')
+      fputc('\\', f);
+    fputc(s[i], f);
+  }
+  fputc('"', f);
+}
+
+// Counts print as integers, the rest with 15 significant digits.
+void put_value(FILE* f, double v)
+{
+  if (isnan(v) || isinf(v))
+    fputs(stats_json ? "null" : "", f);
+  else if (v == floor(v) && fabs(v) < 9007199254740992.0)
+    fprintf(f, "%.0f", v);
+  else
+    fprintf(f, "%.15g", v);
+}
+
+} // namespace
+
+void ac_stats_out_open(const char* path)
+{
+  if (stats_path.empty())
+    atexit(write_at_exit);
+  stats_path = path;
+  stats_json = ends_with(stats_path, ".json");
+}
+
+void ac_stats_out_rename(const char* name)
+{
+  if (!stats_path.empty())
+    stats_path = std::string(name) + (stats_json ? ".json" : ".csv");
+}
+
+bool ac_stats_out_enabled()
+{
+  return !stats_path.empty();
+}
+
+void ac_stats_out_add(const std::string& section_name, const std::string& name, double value)
+{
+  std::vector<section>::iterator s = stats.begin();
+
+  while (s != stats.end() && s->name != section_name)
+    s++;
+  if (s == stats.end()) {
+    stats.push_back(section());
+    s = stats.end() - 1;
+    s->name = section_name;
+  }
+  for (size_t i = 0; i < s->values.size(); i++) {
+    if (s->values[i].first == name) {
+      s->values[i].second = value;
+      return;
+    }
+  }
+  s->values.push_back(std::make_pair(name, value));
+}
+
+bool ac_stats_out_write()
+{
+  FILE* f;
+
+  // A parent whose jobs report for it has nothing to write.
+  if (stats_path.empty() || stats.empty())
+    return true;
+  if (!(f = fopen(stats_path.c_str(), "w")))
+    return false;
+  if (!stats_json)
+    fputs("section,name,value\n", f);
+  else
+    fputs("{", f);
+  for (size_t i = 0; i < stats.size(); i++) {
+    const section& s = stats[i];
+
+    if (stats_json) {
+      fputs(i ? ",\n  " : "\n  ", f);
+      put_string(f, s.name);
+      fputs(": {", f);
+    }
+    for (size_t j = 0; j < s.values.size(); j++) {
+      if (stats_json) {
+        fputs(j ? ",\n    " : "\n    ", f);
+        put_string(f, s.values[j].first);
+        fputs(": ", f);
+      }
+      else {
+        put_string(f, s.name);
+        fputc(',', f);
+        put_string(f, s.values[j].first);
+        fputc(',', f);
+      }
+      put_value(f, s.values[j].second);
+      if (!stats_json)
+        fputc('\n', f);
+    }
+    if (stats_json)
+      fputs("\n  }", f);
+  }
+  if (stats_json)
+    fputs("\n}\n", f);
+  return fclose(f) == 0;
+}
+
+void ac_stats_out_close()
+{
+  stats_path.clear();
+}
+
+std::string ac_stats_out_pack()
+{
+  std::string packed;
+  char value[32];
+
+  for (size_t i = 0; i < stats.size(); i++) {
+    for (size_t j = 0; j < stats[i].values.size(); j++) {
+      snprintf(value, sizeof(value), "%.17g", stats[i].values[j].second);
+      packed += stats[i].name + '\t' + stats[i].values[j].first + '\t' + value + '\n';
+    }
+  }
+  return packed;
+}
+
+void ac_stats_out_merge(const std::string& packed, const std::string& prefix, bool sum)
+{
+  size_t start = 0, end;
+
+  while ((end = packed.find('\n', start)) != std::string::npos) {
+    std::string line = packed.substr(start, end - start);
+    size_t a = line.find('\t'), b = line.find('\t', a + 1);
+
+    start = end + 1;
+    if (a == std::string::npos || b == std::string::npos)
+      continue;
+    std::string section_name = line.substr(0, a), name = line.substr(a + 1, b - a - 1);
+    double value = strtod(line.c_str() + b + 1, NULL);
+
+    ac_stats_out_add(prefix + section_name, name, value);
+    if (!sum)
+      continue;
+    for (size_t i = 0; i < stats.size(); i++) {
+      if (stats[i].name != section_name)
+        continue;
+      for (size_t j = 0; j < stats[i].values.size(); j++) {
+        if (stats[i].values[j].first == name) {
+          value += stats[i].values[j].second;
+          break;
+        }
+      }
+    }
+    ac_stats_out_add(section_name, name, value);
+  }
+}
@@ -0,0 +1,459 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_stats_snapshot.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Statistics of a run still going on (SIGUSR1,
+ *            --stats-interval=SECONDS, --stats-listen=ADDRESS).
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ac_stats_snapshot.H"
+
+volatile sig_atomic_t ac_stats_dump_pending = 0;
+bool ac_stats_dump_polled = false;
+
+namespace {
+
+std::vector<std::pair<void (*)(void*), void*> > dumps;
+
+//! A counter watched, of one of the three types.
+struct watched {
+  std::string section, name;
+  const void* counter;
+  enum kind { kSigned, kUnsigned, kDouble, kSum } type;
+  unsigned count, stride;       //!< Shards of a sum
+};
+
+std::vector<watched> counters;
+pthread_mutex_t counters_lock = PTHREAD_MUTEX_INITIALIZER;
+
+pthread_t writer;
+pthread_cond_t stop_cond = PTHREAD_COND_INITIALIZER;
+bool running = false, stopping = false;
+double interval;
+FILE* out;
+struct timespec start;
+
+double elapsed(const struct timespec& since = start) {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (t.tv_sec - since.tv_sec) + (t.tv_nsec - since.tv_nsec) / 1e9;
+}
+
+void watch(const std::string& section, const std::string& name, const void* counter, watched::kind type,
+           unsigned count = 1, unsigned stride = 0) {
+  watched w;
+
+  w.section = section;
+  w.name = name;
+  w.counter = counter;
+  w.type = type;
+  w.count = count;
+  w.stride = stride;
+  pthread_mutex_lock(&counters_lock);
+  counters.push_back(w);
+  pthread_mutex_unlock(&counters_lock);
+}
+
+//! Loads the counter once, without ordering against the simulation, as
+//! text in text. The counters are aligned 64-bit words, which are not torn
+//! on the hosts ArchC runs on. Returns the value.
+double load(const watched& w, char* text, size_t size) {
+  switch (w.type) {
+  case watched::kSigned: {
+    long long value = __atomic_load_n((const long long*) w.counter, __ATOMIC_RELAXED);
+
+    snprintf(text, size, "%lld", value);
+    return value;
+  }
+  case watched::kUnsigned: {
+    unsigned long long value = __atomic_load_n((const unsigned long long*) w.counter, __ATOMIC_RELAXED);
+
+    snprintf(text, size, "%llu", value);
+    return value;
+  }
+  case watched::kDouble: {
+    unsigned long long bits = __atomic_load_n((const unsigned long long*) w.counter, __ATOMIC_RELAXED);
+    double value;
+
+    memcpy(&value, &bits, sizeof(value));
+    snprintf(text, size, "%.17g", value);
+    return value;
+  }
+  case watched::kSum: {
+    long long sum = 0;
+
+    for (unsigned s = 0; s < w.count; s++)
+      sum += __atomic_load_n((const long long*) ((const char*) w.counter + s * w.stride), __ATOMIC_RELAXED);
+    snprintf(text, size, "%lld", sum);
+    return sum;
+  }
+  }
+  return 0;
+}
+
+void write_snapshot() {
+  double now = elapsed();
+  char value[32];
+
+  pthread_mutex_lock(&counters_lock);
+  for (size_t i = 0; i < counters.size(); i++) {
+    const watched& w = counters[i];
+
+    load(w, value, sizeof(value));
+    fprintf(out, "%.3f,\"%s\",\"%s\",%s\n", now, w.section.c_str(), w.name.c_str(), value);
+  }
+  pthread_mutex_unlock(&counters_lock);
+  fflush(out);
+}
+
+void* write_snapshots(void*) {
+  struct timespec next;
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  pthread_mutex_lock(&counters_lock);
+  while (!stopping) {
+    long long ns = next.tv_nsec + (long long) (interval * 1e9);
+
+    next.tv_sec += ns / 1000000000LL;
+    next.tv_nsec = ns % 1000000000LL;
+    if (pthread_cond_timedwait(&stop_cond, &counters_lock, &next) == ETIMEDOUT && !stopping) {
+      pthread_mutex_unlock(&counters_lock);
+      write_snapshot();
+      pthread_mutex_lock(&counters_lock);
+    }
+  }
+  pthread_mutex_unlock(&counters_lock);
+  return NULL;
+}
+
+// The server of --stats-listen. It answers each connection in turn, so
+// the speed is that between two requests of any client.
+int listen_fd = -1;
+pthread_t server;
+bool listening = false;
+std::string listen_path;        //!< Of a Unix socket, removed at the end
+pid_t listen_owner;
+struct timespec listen_start;
+double last_request;
+double last_instructions;
+
+//! Listens on the Unix socket at where, or on [HOST]:PORT if where has a
+//! colon, as the simulator server does. Returns the socket, or -1.
+int open_listen_socket(const char* where) {
+  const char* colon = strrchr(where, ':');
+  int fd = -1, on = 1;
+
+  if (!colon) {
+    struct sockaddr_un addr;
+
+    if (strlen(where) >= sizeof(addr.sun_path)) {
+      fprintf(stderr, "ArchC: Socket path too long: %s\n", where);
+      return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, where);
+    unlink(where);
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) != -1 && bind(fd, (struct sockaddr*) &addr, sizeof(addr)) == -1) {
+      close(fd);
+      fd = -1;
+    }
+    listen_path = where;
+  }
+  else {
+    std::string host(where, colon - where);
+    struct addrinfo hints, *list, *a;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(host.empty() ? NULL : host.c_str(), colon + 1, &hints, &list)) {
+      fprintf(stderr, "ArchC: Could not resolve %s\n", where);
+      return -1;
+    }
+    for (a = list; a && fd == -1; a = a->ai_next) {
+      if ((fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol)) == -1)
+        continue;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+      if (bind(fd, a->ai_addr, a->ai_addrlen) == -1) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    freeaddrinfo(list);
+  }
+  if (fd == -1 || listen(fd, 16) == -1) {
+    fprintf(stderr, "ArchC: Could not listen on %s: %s\n", where, strerror(errno));
+    if (fd != -1)
+      close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+//! Resident memory of the host process, in bytes.
+double resident_bytes() {
+  FILE* f = fopen("/proc/self/statm", "r");
+  unsigned long size, resident = 0;
+
+  if (f) {
+    if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+      resident = 0;
+    fclose(f);
+  }
+  return (double) resident * sysconf(_SC_PAGESIZE);
+}
+
+//! Label values escaped as the text format wants them.
+std::string escaped(const std::string& text) {
+  std::string e;
+
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '\\' || text[i] == '"' || text[i] == '\n')
+      e += '\\';
+    e += text[i] == '\n' ? 'n' : text[i];
+  }
+  return e;
+}
+
+//! The counters watched, as archc_stat{section,name} samples, numbered by
+//! a core label where several share a section and name, as the cores of
+//! a multi-core simulation do. The speed comes from the instructions of
+//! the archc section, those of every core.
+std::string exposition() {
+  std::map<std::string, unsigned> shared, seen;
+  double now = elapsed(listen_start), instructions = 0;
+  std::string text;
+  char value[32], line[64];
+
+  text = "# HELP archc_stat Counters of the simulation, by section and name as in --stats-out.\n"
+         "# TYPE archc_stat untyped\n";
+  pthread_mutex_lock(&counters_lock);
+  for (size_t i = 0; i < counters.size(); i++)
+    shared[counters[i].section + '\0' + counters[i].name]++;
+  for (size_t i = 0; i < counters.size(); i++) {
+    const watched& w = counters[i];
+    std::string key = w.section + '\0' + w.name;
+    double v = load(w, value, sizeof(value));
+
+    if (w.section == "archc" && w.name == "instructions")
+      instructions += v;
+    text += "archc_stat{section=\"" + escaped(w.section) + "\",name=\"" + escaped(w.name) + "\"";
+    if (shared[key] > 1)
+      text += ",core=\"" + std::to_string(seen[key]++) + "\"";
+    text += std::string("} ") + value + "\n";
+  }
+  pthread_mutex_unlock(&counters_lock);
+
+  snprintf(line, sizeof(line), "archc_mips %.6g\n",
+           now > last_request ? (instructions - last_instructions) / (now - last_request) / 1e6 : 0);
+  text += "# HELP archc_mips Millions of instructions simulated per second since the last request.\n"
+          "# TYPE archc_mips gauge\n";
+  text += line;
+  last_request = now;
+  last_instructions = instructions;
+  snprintf(line, sizeof(line), "archc_uptime_seconds %.3f\n", now);
+  text += "# HELP archc_uptime_seconds Seconds since the server started.\n"
+          "# TYPE archc_uptime_seconds gauge\n";
+  text += line;
+  snprintf(line, sizeof(line), "archc_host_rss_bytes %.0f\n", resident_bytes());
+  text += "# HELP archc_host_rss_bytes Resident memory of the simulator process.\n"
+          "# TYPE archc_host_rss_bytes gauge\n";
+  text += line;
+  return text;
+}
+
+void write_all(int fd, const std::string& text) {
+  size_t done = 0;
+  ssize_t n;
+
+  while (done < text.size() && ((n = write(fd, text.data() + done, text.size() - done)) > 0 || errno == EINTR))
+    if (n > 0)
+      done += n;
+}
+
+//! Answers whatever each connection asks with the counters: the request
+//! is read up to its blank line, or for a second, and not looked at.
+void* serve(void*) {
+  struct timeval timeout = {1, 0};
+  std::string request, body, header;
+  char buffer[1024];
+  ssize_t n;
+  int conn;
+
+  while ((conn = accept(listen_fd, NULL, NULL)) != -1 || errno == EINTR || errno == ECONNABORTED) {
+    if (conn == -1)
+      continue;
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    request.clear();
+    while (request.size() < 8192 && request.find("\r\n\r\n") == std::string::npos &&
+           request.find("\n\n") == std::string::npos && (n = read(conn, buffer, sizeof(buffer))) > 0)
+      request.append(buffer, n);
+    body = exposition();
+    header = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+             std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    write_all(conn, header + body);
+    close(conn);
+  }
+  return NULL;
+}
+
+//! Stops the server. A forked process only drops its copy of the socket,
+//! which is still its parent's.
+void stop_listening() {
+  if (!listening)
+    return;
+  listening = false;
+  if (getpid() != listen_owner) {
+    close(listen_fd);
+    return;
+  }
+  shutdown(listen_fd, SHUT_RDWR);
+  pthread_join(server, NULL);
+  close(listen_fd);
+  if (!listen_path.empty())
+    unlink(listen_path.c_str());
+}
+
+void stop_at_exit() {
+  ac_stats_interval_stop();
+}
+
+} // namespace
+
+void ac_stats_dump_add(void (*dump)(void*), void* arg) {
+  dumps.push_back(std::make_pair(dump, arg));
+}
+
+void ac_stats_dump_remove(void* arg) {
+  for (size_t i = dumps.size(); i-- > 0; )
+    if (dumps[i].second == arg)
+      dumps.erase(dumps.begin() + i);
+}
+
+void ac_stats_dump_run() {
+  for (size_t i = 0; i < dumps.size(); i++)
+    dumps[i].first(dumps[i].second);
+}
+
+void ac_stats_watch(const std::string& section, const std::string& name, const long long* counter) {
+  watch(section, name, counter, watched::kSigned);
+}
+
+void ac_stats_watch(const std::string& section, const std::string& name, const unsigned long long* counter) {
+  watch(section, name, counter, watched::kUnsigned);
+}
+
+void ac_stats_watch(const std::string& section, const std::string& name, const double* counter) {
+  watch(section, name, counter, watched::kDouble);
+}
+
+void ac_stats_unwatch(const void* begin, const void* end) {
+  pthread_mutex_lock(&counters_lock);
+  for (size_t i = counters.size(); i-- > 0; )
+    if ((const char*) counters[i].counter >= (const char*) begin && (const char*) counters[i].counter < (const char*) end)
+      counters.erase(counters.begin() + i);
+  pthread_mutex_unlock(&counters_lock);
+}
+
+void ac_stats_watch_sum(const std::string& section, const std::string& name, const long long* first,
+                        unsigned count, unsigned stride) {
+  watch(section, name, first, watched::kSum, count, stride);
+}
+
+bool ac_stats_interval_start(double seconds) {
+  const char* path = getenv(ENV_AC_STATS_SNAPSHOTS);
+  pthread_condattr_t attr;
+
+  if (running || seconds <= 0)
+    return false;
+  out = stderr;
+  if (path && *path && !(out = fopen(path, "w"))) {
+    fprintf(stderr, "ArchC: Could not create the statistics snapshots %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  interval = seconds;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  // The deadlines are on the monotonic clock too.
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&stop_cond, &attr);
+  pthread_condattr_destroy(&attr);
+  if (pthread_create(&writer, NULL, write_snapshots, NULL) != 0) {
+    fprintf(stderr, "ArchC: Could not start the statistics snapshots.\n");
+    if (out != stderr)
+      fclose(out);
+    return false;
+  }
+  running = true;
+  atexit(stop_at_exit);
+  return true;
+}
+
+void ac_stats_interval_stop() {
+  stop_listening();
+  if (!running)
+    return;
+  pthread_mutex_lock(&counters_lock);
+  stopping = true;
+  pthread_cond_signal(&stop_cond);
+  pthread_mutex_unlock(&counters_lock);
+  pthread_join(writer, NULL);
+  running = false;
+  write_snapshot();
+  if (out != stderr)
+    fclose(out);
+}
+
+bool ac_stats_listen_start(const char* address) {
+  if (listening || (listen_fd = open_listen_socket(address)) == -1)
+    return false;
+  clock_gettime(CLOCK_MONOTONIC, &listen_start);
+  last_request = last_instructions = 0;
+  if (pthread_create(&server, NULL, serve, NULL) != 0) {
+    fprintf(stderr, "ArchC: Could not start the statistics server.\n");
+    close(listen_fd);
+    return false;
+  }
+  listening = true;
+  listen_owner = getpid();
+  atexit(stop_at_exit);
+  return true;
+}
+
+bool ac_stats_listening() {
+  return listening;
+}
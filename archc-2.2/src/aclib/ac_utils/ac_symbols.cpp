@@ -0,0 +1,314 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_symbols.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Functions of the application, from the ELF symbol table.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+//Fix for Cygwin users, that do not have elf.h
+#if defined(__CYGWIN__) || defined(__APPLE__)
+#include "elf32-tiny.h"
+#else
+#include <elf.h>
+#endif /* __CYGWIN__ */
+
+#include "ac_symbols.H"
+
+unsigned int convert_endian(unsigned int size, unsigned int num, bool match_endian);
+
+namespace {
+
+struct symbol {
+  unsigned address, size;
+  unsigned name; // in names
+};
+
+std::vector<symbol> symbols; // by address
+std::vector<char> names;
+
+// Recent lookups of each thread: the symbol found at address, -1 for
+// none, while the symbols are those of generation. Profilers look up the
+// same few addresses over and over, and the slot of one is a compare
+// away instead of a binary search.
+const unsigned cache_slots = 1024;
+
+struct cached {
+  unsigned address;
+  int index;
+  unsigned generation;
+};
+
+thread_local cached cache[cache_slots];
+unsigned generation = 1; // 0 is that of the empty slots
+
+bool read_at(int fd, unsigned offset, void* buffer, unsigned size) {
+  return pread(fd, buffer, size, offset) == (ssize_t) size;
+}
+
+bool operator<(const symbol& a, const symbol& b) {
+  return a.address < b.address;
+}
+
+// Index of the last function starting at or before address, if it
+// reaches it, or -1; those of no size reach up to the next one.
+int find(unsigned address) {
+  cached& c = cache[(address >> 2) % cache_slots];
+  symbol key = {address, 0, 0};
+  std::vector<symbol>::const_iterator s;
+
+  if (c.generation == generation && c.address == address)
+    return c.index;
+  s = std::upper_bound(symbols.begin(), symbols.end(), key);
+  c.generation = generation;
+  c.address = address;
+  if (s == symbols.begin() || (s[-1].size && address - s[-1].address >= s[-1].size))
+    c.index = -1;
+  else
+    c.index = s - symbols.begin() - 1;
+  return c.index;
+}
+
+struct native {
+  const char* name;
+  const char* group;
+  unsigned cost;  // by default, roughly what the newlib and libgcc code of a call takes
+};
+
+const native natives[AC_NATIVE_FUNCTIONS] = {
+  {"", "", 0},
+  {"memcpy", "libc", 8}, {"memset", "libc", 8}, {"memcmp", "libc", 8}, {"strlen", "libc", 8},
+  {"__adddf3", "float", 80}, {"__subdf3", "float", 85}, {"__muldf3", "float", 110},
+  {"__divdf3", "float", 250}, {"__negdf2", "float", 5},
+  {"__addsf3", "float", 55}, {"__subsf3", "float", 60}, {"__mulsf3", "float", 65},
+  {"__divsf3", "float", 120}, {"__negsf2", "float", 4},
+  {"__eqdf2", "float", 25}, {"__nedf2", "float", 25}, {"__gedf2", "float", 30}, {"__gtdf2", "float", 30},
+  {"__ledf2", "float", 30}, {"__ltdf2", "float", 30}, {"__unorddf2", "float", 15},
+  {"__eqsf2", "float", 20}, {"__nesf2", "float", 20}, {"__gesf2", "float", 25}, {"__gtsf2", "float", 25},
+  {"__lesf2", "float", 25}, {"__ltsf2", "float", 25}, {"__unordsf2", "float", 12},
+  {"__floatsidf", "float", 30}, {"__floatunsidf", "float", 30},
+  {"__floatsisf", "float", 35}, {"__floatunsisf", "float", 35},
+  {"__fixdfsi", "float", 25}, {"__fixunsdfsi", "float", 30},
+  {"__fixsfsi", "float", 20}, {"__fixunssfsi", "float", 25},
+  {"__extendsfdf2", "float", 30}, {"__truncdfsf2", "float", 45},
+  {"sqrt", "libm", 1000}, {"sqrtf", "libm", 400}, {"fabs", "libm", 4},
+  {"floor", "libm", 40}, {"ceil", "libm", 40},
+  {"sin", "libm-host", 1500}, {"cos", "libm-host", 1500}, {"tan", "libm-host", 2000},
+  {"atan", "libm-host", 1800}, {"exp", "libm-host", 1500}, {"log", "libm-host", 1500},
+  {"pow", "libm-host", 4000},
+};
+
+// Whether group is in the comma-separated list.
+bool listed(const char* list, const char* group) {
+  size_t n = strlen(group);
+
+  for (const char* p = list; (p = strstr(p, group)); p += n)
+    if ((p == list || p[-1] == ',') && (!p[n] || p[n] == ','))
+      return true;
+  return false;
+}
+
+// Sets the costs of AC_NATIVE_COST over the defaults.
+void read_costs() {
+  const char* env = getenv(ENV_AC_NATIVE_COST);
+  std::string list = env ? env : "";
+  size_t start = 0;
+
+  for (int f = AC_NATIVE_NONE; f < AC_NATIVE_FUNCTIONS; f++)
+    ac_native_costs[f] = natives[f].cost;
+  ac_native_round_cost = 4;
+  while (start < list.size()) {
+    size_t end = list.find(',', start);
+    std::string entry = list.substr(start, end == std::string::npos ? end : end - start);
+    size_t equal = entry.find('=');
+    std::string name = entry.substr(0, equal);
+    const char* value = equal == std::string::npos ? "" : entry.c_str() + equal + 1;
+    char* stop;
+    unsigned long cost = strtoul(value, &stop, 10);
+    int f;
+
+    for (f = AC_NATIVE_NONE + 1; f < AC_NATIVE_FUNCTIONS && name != natives[f].name; f++)
+      ;
+    if (!*value || *stop || (f == AC_NATIVE_FUNCTIONS && name != "round"))
+      fprintf(stderr, "ArchC: Ignoring %s entry '%s'.\n", ENV_AC_NATIVE_COST, entry.c_str());
+    else if (f < AC_NATIVE_FUNCTIONS)
+      ac_native_costs[f] = cost;
+    else
+      ac_native_round_cost = cost;
+    start = end == std::string::npos ? list.size() : end + 1;
+  }
+}
+
+// Finds the entries of the functions run natively, in the groups asked for.
+void find_natives() {
+  const char* env = getenv(ENV_AC_NATIVE_LIBC);
+  std::string groups;
+  unsigned high = 0;
+
+  memset(ac_native_entries, 0, sizeof(ac_native_entries));
+  memset(ac_native_table, 0, sizeof(ac_native_table));
+  ac_native_low = ac_native_span = 0;
+  if (!env || !*env || !strcmp(env, "0"))
+    return;
+  groups = strcmp(env, "1") ? env : "libc";
+  if (!symbols.empty())
+    read_costs();
+  for (std::vector<symbol>::const_iterator s = symbols.begin(); s != symbols.end(); ++s)
+    for (int f = AC_NATIVE_NONE + 1; f < AC_NATIVE_FUNCTIONS; f++)
+      if (!ac_native_entries[f] && !strcmp(&names[s->name], natives[f].name) &&
+          listed(groups.c_str(), natives[f].group)) {
+        unsigned i = (s->address >> 2) % AC_NATIVE_SLOTS;
+
+        while (ac_native_table[i].address && ac_native_table[i].address != s->address)
+          i = (i + 1) % AC_NATIVE_SLOTS;
+        if (ac_native_table[i].address)
+          continue;
+        ac_native_table[i].address = s->address;
+        ac_native_table[i].function = (ac_native_function) f;
+        ac_native_entries[f] = s->address;
+        if (!ac_native_low || s->address < ac_native_low)
+          ac_native_low = s->address;
+        if (s->address >= high)
+          high = s->address + 1;
+      }
+  if (high)
+    ac_native_span = high - ac_native_low;
+}
+
+} // namespace
+
+unsigned ac_native_entries[AC_NATIVE_FUNCTIONS];
+unsigned ac_native_low, ac_native_span;
+unsigned ac_native_costs[AC_NATIVE_FUNCTIONS];
+unsigned ac_native_round_cost;
+ac_native_slot ac_native_table[AC_NATIVE_SLOTS];
+
+void ac_symbols_read(int fd, bool match_endian) {
+  Elf32_Ehdr ehdr;
+  Elf32_Shdr symtab, strtab;
+  unsigned shoff, shsize, shnum, i;
+
+  symbols.clear();
+  names.clear();
+  generation++;
+  find_natives();
+  if (!read_at(fd, 0, &ehdr, sizeof(ehdr)))
+    return;
+  shoff = convert_endian(4, ehdr.e_shoff, match_endian);
+  shsize = convert_endian(2, ehdr.e_shentsize, match_endian);
+  shnum = convert_endian(2, ehdr.e_shnum, match_endian);
+  for (i = 0; i < shnum; i++) {
+    if (!read_at(fd, shoff + shsize * i, &symtab, sizeof(symtab)))
+      return;
+    if (convert_endian(4, symtab.sh_type, match_endian) == SHT_SYMTAB)
+      break;
+  }
+  if (i == shnum ||
+      !read_at(fd, shoff + shsize * convert_endian(4, symtab.sh_link, match_endian), &strtab, sizeof(strtab)))
+    return;
+
+  std::vector<Elf32_Sym> table(convert_endian(4, symtab.sh_size, match_endian) / sizeof(Elf32_Sym));
+  names.resize(convert_endian(4, strtab.sh_size, match_endian) + 1);
+  if (table.empty() ||
+      !read_at(fd, convert_endian(4, symtab.sh_offset, match_endian), &table[0], table.size() * sizeof(Elf32_Sym)) ||
+      !read_at(fd, convert_endian(4, strtab.sh_offset, match_endian), &names[0], names.size() - 1)) {
+    names.clear();
+    return;
+  }
+  names.back() = 0;
+  for (i = 0; i < table.size(); i++) {
+    const Elf32_Sym& s = table[i];
+    symbol f = {convert_endian(4, s.st_value, match_endian), convert_endian(4, s.st_size, match_endian),
+                convert_endian(4, s.st_name, match_endian)};
+
+    if (ELF32_ST_TYPE(s.st_info) == STT_FUNC && f.address && f.name < names.size())
+      symbols.push_back(f);
+  }
+  std::sort(symbols.begin(), symbols.end());
+  generation++;
+  find_natives();
+}
+
+void ac_symbols_add(const char* name, unsigned address, unsigned size) {
+  symbol f = {address, size, (unsigned) names.size()};
+  std::vector<symbol>::iterator s = std::upper_bound(symbols.begin(), symbols.end(), f);
+
+  // The executable may have given it in its own table.
+  for (std::vector<symbol>::iterator same = s; same != symbols.begin() && same[-1].address == address; --same)
+    if (!strcmp(&names[same[-1].name], name))
+      return;
+  names.insert(names.end(), name, name + strlen(name) + 1);
+  symbols.insert(s, f);
+  generation++;
+}
+
+const char* ac_symbol_at(unsigned address, unsigned* offset, unsigned* size) {
+  int index = find(address);
+  std::vector<symbol>::const_iterator s;
+
+  if (index < 0)
+    return 0;
+  s = symbols.begin() + index;
+  if (offset)
+    *offset = address - s->address;
+  if (size) {
+    std::vector<symbol>::const_iterator next = s + 1;
+
+    *size = s->size ? s->size : next != symbols.end() ? next->address - s->address : 1;
+  }
+  return &names[s->name];
+}
+
+unsigned ac_symbol_address(const char* name, unsigned* size) {
+  for (std::vector<symbol>::const_iterator s = symbols.begin(); s != symbols.end(); ++s)
+    if (!strcmp(&names[s->name], name)) {
+      std::vector<symbol>::const_iterator next = s;
+
+      while (next != symbols.end() && next->address == s->address)
+        ++next;
+      if (size)
+        *size = s->size ? s->size : next != symbols.end() ? next->address - s->address : 1;
+      return s->address;
+    }
+  return 0;
+}
+
+const char* ac_native_name(ac_native_function f) {
+  return natives[f].name;
+}
+
+std::string ac_symbol_name(unsigned address) {
+  unsigned offset;
+  const char* name = ac_symbol_at(address, &offset);
+  char buffer[32];
+
+  if (!name) {
+    snprintf(buffer, sizeof(buffer), "%#x", address);
+    return buffer;
+  }
+  if (!offset)
+    return name;
+  snprintf(buffer, sizeof(buffer), "+%#x", offset);
+  return name + std::string(buffer);
+}
@@ -0,0 +1,127 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+
+/**
+ * @file      ac_trace_view.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Prints an instruction trace of ac_instr_trace as text: a
+ *            line for each instruction with its count, address, word and
+ *            name, and one for each window opening and closing.
+ *
+ *            ac_trace_view FILE
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "ac_instr_trace.H"
+
+namespace {
+
+struct entry {
+  uint32_t address, word;
+  unsigned id, size;
+  std::string name;
+};
+
+FILE* in;
+
+bool get(unsigned long long& value) {
+  int c, shift = 0;
+
+  value = 0;
+  do {
+    if ((c = getc(in)) == EOF || shift > 63)
+      return false;
+    value |= (unsigned long long) (c & 0x7f) << shift;
+    shift += 7;
+  } while (c & 0x80);
+  return true;
+}
+
+bool get_entry(entry& e) {
+  unsigned long long address, id;
+  unsigned char bytes[6];
+  char name[256];
+
+  if (!get(address) || !get(id) || fread(bytes, 6, 1, in) != 1 ||
+      (bytes[5] && fread(name, bytes[5], 1, in) != 1))
+    return false;
+  e.address = address;
+  e.id = id;
+  e.size = bytes[0];
+  e.word = bytes[1] | bytes[2] << 8 | bytes[3] << 16 | (uint32_t) bytes[4] << 24;
+  e.name.assign(name, bytes[5]);
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::vector<entry> entries;
+  unsigned long long code, count = 0, value;
+  char magic[5];
+  bool truncated = false;
+
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s FILE\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (!(in = fopen(argv[1], "rb"))) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+  if (fread(magic, 5, 1, in) != 1 || memcmp(magic, "ACIT", 4) || magic[4] != ac_instr_trace::kVersion) {
+    fprintf(stderr, "%s: Not an instruction trace of version %u.\n", argv[1], ac_instr_trace::kVersion);
+    return EXIT_FAILURE;
+  }
+  while (get(code)) {
+    const entry* e;
+
+    if (code == ac_instr_trace::kOpen || code == ac_instr_trace::kClose) {
+      if ((truncated = !get(value)))
+        break;
+      if (code == ac_instr_trace::kOpen) {
+        count = value;
+        printf("# window at instruction %llu\n", value);
+      }
+      else
+        printf("# %llu instructions\n", value);
+      continue;
+    }
+    if (code == ac_instr_trace::kEntry) {
+      entries.push_back(entry());
+      if ((truncated = !get_entry(entries.back())))
+        break;
+      e = &entries.back();
+    }
+    else if (code - ac_instr_trace::kFirstEntry < entries.size())
+      e = &entries[code - ac_instr_trace::kFirstEntry];
+    else {
+      fprintf(stderr, "%s: Entry %llu is not defined.\n", argv[1], code - ac_instr_trace::kFirstEntry);
+      return EXIT_FAILURE;
+    }
+    printf("%12llu %08x %08x %s\n", count++, e->address, e->word, e->name.c_str());
+  }
+  if (truncated || ferror(in)) {
+    fprintf(stderr, "%s: Truncated trace.\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
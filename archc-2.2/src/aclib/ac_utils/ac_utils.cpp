@@ -67,6 +67,7 @@ void ac_init_opt( int ac, char* av[]){
       cerr << "  --help                  Display this help message\n";
       cerr << "  --version               Display ArchC version and options used when built\n";
       cerr << "  --load=<prog_path>      Load target application\n";
+      cerr << "  --stats-out=<file>      Also write the statistics to file, as JSON if it ends in .json, else as CSV\n";
 #ifdef USE_GDB
 //      cerr << "  --gdb[=<port>]          Enable GDB support\n";
 #endif /* USE_GDB */
@@ -47,10 +47,10 @@ extern AC_GDB *gdbstub;
 #endif /* USE_GDB */
 
 #ifdef AC_VERIFY
+#include "ac_verify_ring.H"
 
-//Declaring co-verification message queue
-key_t key;
-int msqid;
+//Declaring co-verification message ring
+ac_verify_ring ac_vring;
 
 
 #endif
@@ -520,6 +520,9 @@ int ac_load_elf(char* filename, char* data_mem, unsigned int data_mem_size)
 //Functions used to calculate the instr/s of the simulation
 
 #include <sys/times.h>
+#include "ac_syscall_profile.H"
+#include "ac_host_profile.H"
+#include "ac_syscall_vfs.H"
 
 struct tms ac_run_times;
 clock_t ac_run_start_time;
@@ -552,6 +555,9 @@ void PrintStat()
   else {
     fprintf(stderr, "    Simulation speed: (too fast to be precise)\n");
   }
+  ac_syscall_profile_print(ac_run_real / 100.0);
+  ac_host_profile_print(ac_run_real / 100.0);
+  ac_vfs_print();
 }
 
 
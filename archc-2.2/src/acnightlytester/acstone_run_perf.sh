@@ -0,0 +1,44 @@
+# acstone_run_perf.sh
+# Runs the acstone programs built for the performance mode (make -f
+# Makefile.archc perf, see acstone/perf/end.h) under the simulator, without
+# gdb, timing each one. Writes the statistics the simulator prints, which
+# include the count of each instruction when it was built with --stats, to
+# NAME.ARCH.perf.stats and the wall time of the run, in seconds, to
+# NAME.ARCH.perf.time. collect_stats.py --perf derives the cost of each
+# instruction class from them. Must run in the directory of the programs.
+#
+# The ArchC Team
+#
+
+# Commented out variables are defined by the caller script (nightlytester.sh)
+#SIMULATOR=BLABLA
+
+if test ! $# -eq 1 || test "$1" == "--help"
+then
+    echo "This program times the simulator running each acstone program" 1>&2
+    echo "Use: $0 ARCH" 1>&2
+    exit 1
+fi
+
+ARCH=$1
+
+if ! ls *.${ARCH}.perf > /dev/null 2>&1; then
+  echo "No acstone program built for the performance mode (*.${ARCH}.perf)" 1>&2
+  exit 1
+fi
+
+for BINARY in `ls *.${ARCH}.perf`
+do
+  NAME=${BINARY/.${ARCH}.perf/}
+  echo "timing test ${NAME}"
+  START=`date +%s%N`
+  ${SIMULATOR} --load=${BINARY} > /dev/null 2> ${NAME}.${ARCH}.perf.stats
+  RETCODE=$?
+  END=`date +%s%N`
+  if [ $RETCODE -ne 0 ]; then
+    echo "${NAME} failed under the simulator" 1>&2
+    rm -f ${NAME}.${ARCH}.perf.time
+  else
+    awk -v start=$START -v end=$END 'BEGIN { printf "%.6f\n", (end - start) / 1e9 }' > ${NAME}.${ARCH}.perf.time
+  fi
+done
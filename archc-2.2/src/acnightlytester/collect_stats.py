@@ -12,11 +12,127 @@ import string
 import re
 import sys
 import getopt
+import time
+
+# Performance mode: collect_stats.py ARCH --perf [--history=FILE] [--rev=REV]
+# [--threshold=PERCENT]. Reads the NAME.ARCH.perf.stats and NAME.ARCH.perf.time
+# files of acstone_run_perf.sh and writes to total.ARCH.perf.stats the cost,
+# in ns of host time, of each simulated instruction of each acstone class
+# (const, cast, add...) and an estimate of each instruction's own cost. The
+# run of 000.main, which only repeats an empty main, is subtracted from the
+# others as startup and loop overhead. With --history, the class costs are
+# appended to a CSV file as rev,date,arch,kind,name,ns, and compared with the
+# last revision there, marking those more than PERCENT (10) slower.
+
+def read_counts(filename):
+	counts = dict()
+	instrucao = None
+	for line in open(filename, 'r').readlines():
+		tmp = cabecalho.match(line)
+		if tmp is not None:
+			instrucao = tmp.group('inst')
+			counts[instrucao] = 0
+			continue
+		tmp = count.match(line)
+		if tmp is not None and instrucao is not None:
+			counts[instrucao] = counts[instrucao] + int(tmp.group('num'))
+	return counts
+
+# Non-negative least squares by projected Gauss-Seidel on the normal
+# equations: the cost x[i] of each instruction, so that the time of each
+# test is the sum of its counts times the costs.
+def instruction_costs(rows, times, names):
+	x = dict([(i, 0.0) for i in names])
+	ata = dict()
+	atb = dict()
+	for i in names:
+		atb[i] = sum([r.get(i, 0) * t for r, t in zip(rows, times)])
+		for j in names:
+			ata[(i, j)] = sum([r.get(i, 0) * r.get(j, 0) for r in rows])
+	for sweep in range(200):
+		for i in names:
+			if ata[(i, i)] == 0:
+				continue
+			rest = sum([ata[(i, j)] * x[j] for j in names if j != i])
+			x[i] = max(0.0, (atb[i] - rest) / ata[(i, i)])
+	return x
+
+def perf(arch, history, rev, threshold):
+	timePattern = re.compile(r'(?P<name>\d{3}\.\w+)\.' + re.escape(arch) + r'\.perf\.time$')
+	tests = dict()
+	for filename in os.listdir(stats):
+		tmp = timePattern.match(filename)
+		if tmp is None:
+			continue
+		name = tmp.group('name')
+		seconds = float(open(stats + '/' + filename, 'r').read())
+		tests[name] = (seconds, read_counts(stats + '/' + name + '.' + arch + '.perf.stats'))
+	if not tests:
+		sys.stderr.write('No acstone timing for ' + arch + '\n')
+		sys.exit(1)
+	base_seconds, base_counts = tests.pop('000.main', (0.0, dict()))
+	classes = dict()
+	rows = []
+	times = []
+	for name in sorted(tests.keys()):
+		seconds, counts = tests[name]
+		row = dict([(i, counts[i] - base_counts.get(i, 0)) for i in counts.keys()])
+		rows.append(row)
+		times.append(max(0.0, seconds - base_seconds))
+		c = classes.setdefault(name.split('.')[1], [0.0, 0])
+		c[0] = c[0] + times[-1]
+		c[1] = c[1] + sum([n for n in row.values() if n > 0])
+	names = sorted(set([i for r in rows for i in r.keys() if r[i] > 0]))
+	costs = instruction_costs(rows, times, names)
+
+	previous = dict()
+	date = time.strftime('%Y-%m-%d')
+	if history and os.path.exists(history):
+		last = None
+		for line in open(history, 'r').readlines():
+			fields = line.strip().split(',')
+			if len(fields) != 6 or fields[2] != arch or fields[3] != 'class' or fields[0] == rev:
+				continue
+			if fields[0] != last:
+				last = fields[0]
+				previous = dict()
+			previous[fields[4]] = float(fields[5])
+
+	filehandle = open(stats + '/' + 'total.' + arch + '.perf.stats', 'w')
+	filehandle.write('class : ns per instruction (instructions, seconds)\n')
+	log = []
+	for key in sorted(classes.keys()):
+		seconds, n = classes[key]
+		ns = n and seconds * 1e9 / n or 0.0
+		line = key + ' : %.3f (%d, %.3f)' % (ns, n, seconds)
+		if key in previous and previous[key] > 0:
+			change = (ns - previous[key]) * 100 / previous[key]
+			line = line + '  %+.1f%%' % change
+			if change > threshold:
+				line = line + '  SLOWER'
+		filehandle.write(line + '\n')
+		log.append('%s,%s,%s,class,%s,%.3f\n' % (rev, date, arch, key, ns))
+	filehandle.write('instruction : estimated ns\n')
+	for key in sorted(names, key=lambda i: -costs[i]):
+		filehandle.write(key + ' : %.3f\n' % (costs[key] * 1e9))
+		log.append('%s,%s,%s,instruction,%s,%.3f\n' % (rev, date, arch, key, costs[key] * 1e9))
+	filehandle.close()
+	if history:
+		out = open(history, 'a')
+		out.writelines(log)
+		out.close()
+
 #especifique o caminho para os arquivos stats abaixo
 stats = os.getcwd()
-filePattern = fnmatch.translate ('*.'+sys.argv[1]+'.stats' )
 cabecalho = re.compile('\[ArchC 2.1] Printing statistics from instruction (?P<inst>\w*):')
 count = re.compile(' *COUNT : (?P<num>\d*)')
+if len(sys.argv) > 2:
+	opts, args = getopt.getopt(sys.argv[2:], '', ['perf', 'history=', 'rev=', 'threshold='])
+	opts = dict(opts)
+	if '--perf' in opts:
+		perf(sys.argv[1], opts.get('--history'), opts.get('--rev', 'unknown'), float(opts.get('--threshold', 10)))
+		sys.exit(0)
+filePattern = fnmatch.translate ('*.'+sys.argv[1]+'.stats' )
 total = dict()
 coverage = 0
 for filename in os.listdir (stats):
@@ -331,6 +331,33 @@ run_tests_acsim_acstone() {
   ./acstone_run_all.sh $MODELNAME
 
   echo -ne "<tr><td>${MODELNAME} (acstone)</td><td>${MODELREV}</td><td><a href=\"${HTMLPREFIX}-${MODELNAME}-acstone.htm\">Here</a></td></tr>\n" >> $HTMLLOG
+
+  if [ "$RUN_ACSTONE_PERF" != "no" ]; then
+    run_tests_acsim_acstone_perf
+  fi
+}
+
+#
+# This function times the acstone programs of the performance mode, repeated
+# many times each, and derives the cost of each instruction class. Called by
+# run_tests_acsim_acstone, which sets MODELNAME, MODELREV and SIMULATOR.
+#
+run_tests_acsim_acstone_perf() {
+  HTMLPERF=${LOGROOT}/${HTMLPREFIX}-${MODELNAME}-acstone-perf.htm
+
+  cd ${TESTROOT}/acstone
+  cp ${ACSTONE_PERF_DIR}/*.${MODELNAME}.perf . 2> /dev/null
+  initialize_html $HTMLPERF "Acstone for ${MODELNAME} cost per instruction class (host ns per simulated instruction)"
+  if ./acstone_run_perf.sh $MODELNAME > /dev/null &&
+      python collect_stats.py $MODELNAME --perf --history=${ACSTONE_PERF_HISTORY} --rev=${MODELREV} \
+        --threshold=${ACSTONE_PERF_THRESHOLD}; then
+    format_html_output total.${MODELNAME}.perf.stats $HTMLPERF
+    finalize_html $HTMLPERF ""
+    echo -ne "<tr><td>${MODELNAME} (acstone performance)</td><td>${MODELREV}</td><td><a href=\"${HTMLPREFIX}-${MODELNAME}-acstone-perf.htm\">Here</a></td></tr>\n" >> $HTMLLOG
+  else
+    finalize_html $HTMLPERF "<p>No acstone program for the performance mode in ${ACSTONE_PERF_DIR}.</p>"
+    echo -ne "<tr><td>${MODELNAME} (acstone performance)</td><td>${MODELREV}</td><td><b><font color=\"crimson\">Failed</font></b></td></tr>\n" >> $HTMLLOG
+  fi
 }
 
 #
@@ -789,6 +816,7 @@ if [ "$RUN_ACSTONE" != "no" ]; then
   [ $? -ne 0 ] && do_abort
   cp ${SCRIPTROOT}/acstone_run_all.sh ${TESTROOT}/acstone &&
     cp ${SCRIPTROOT}/acstone_run_teste.sh ${TESTROOT}/acstone &&
+    cp ${SCRIPTROOT}/acstone_run_perf.sh ${TESTROOT}/acstone &&
     cp ${SCRIPTROOT}/collect_stats.py ${TESTROOT}/acstone
   [ $? -ne 0 ] && do_abort	
   chmod u+x ${TESTROOT}/acstone/*.sh
@@ -26,6 +26,7 @@
 #include "acsim.h"
 #include "stdlib.h"
 #include "string.h"
+#include <sys/stat.h>
 
 
 //#define DEBUG_STORAGE
@@ -37,6 +38,35 @@
 int  ACABIFlag=0;                               //!<Indicates whether an ABI was provided or not
 int  ACDebugFlag=0;                             //!<Indicates whether debugger option is turned on or not
 int  ACDecCacheFlag=1;                          //!<Indicates whether the simulator will cache decoded instructions or not
+int  ACSparseDecCacheFlag=0;                    //!<Indicates whether the decoded instructions cache is allocated page by page
+int  ACThreadedDispatchFlag=0;                  //!<Indicates whether instructions are dispatched through threaded code
+int  ACBlockCacheFlag=0;                        //!<Indicates whether straight-line blocks of decoded instructions are cached and chained
+int  ACFormatStructsFlag=0;                     //!<Indicates whether decoded operands are stored as per-format structs in the decode cache
+int  ACTableDecoderFlag=0;                      //!<Indicates whether instructions are decoded by generated lookup tables
+int  ACPreDecodeFlag=0;                         //!<Indicates whether the program text is decoded by a thread pool before simulation
+int  ACDecSnapshotFlag=0;                       //!<Indicates whether pre-decoded text is saved to and mapped from snapshot files
+int  ACDecInvalidateFlag=0;                     //!<Indicates whether writes to code pages invalidate their decode cache entries
+int  ACJITFlag=0;                               //!<Indicates whether hot cached blocks are translated to host code
+int  ACMultiCoreFlag=0;                         //!<Indicates whether main can run several cores on host threads
+int  ACStandaloneFlag=0;                        //!<Indicates whether main drives behavior() directly, without the SystemC scheduler
+int  ACAdaptiveBatchFlag=0;                     //!<Indicates whether the number of instructions between wait() calls adapts to port traffic
+int  ACCheckpointFlag=0;                        //!<Indicates whether the simulator can save and restore checkpoints
+int  ACBatchFlag=0;                             //!<Indicates whether main can run a list of jobs in forked processes
+int  ACServerFlag=0;                            //!<Indicates whether main can serve jobs over a socket
+int  ACHostEndianMemFlag=0;                     //!<Indicates whether plain memories keep target words in host byte order
+int  ACMemTraceFlag=0;                          //!<Indicates whether memory references can be written to a trace file
+int  ACMemHeatmapFlag=0;                        //!<Indicates whether the accesses to each page can be counted for a heatmap
+int  ACTemporalDecouplingFlag=0;                //!<Indicates whether the module runs ahead of SystemC time up to a global quantum
+int  ACTLM2Flag=0;                              //!<Indicates whether TLM ports are TLM-2.0 sockets instead of ac_tlm protocol ports
+int  ACHostProfileFlag=0;                       //!<Indicates whether the host time of the simulator is split by phase
+int  ACGuardMemoryFlag=0;                       //!<Indicates whether memories and the decode cache span the address space, with guard pages instead of bounds checks
+int  ACRegLocalsFlag=0;                         //!<Indicates whether the behavior loop keeps its program counters in host locals
+int  ACFusedBehaviorFlag=0;                     //!<Indicates whether each instruction runs its three behaviors through one inlined handler
+int  ACSyncRegDirtyFlag=0;                      //!<Indicates whether synchronous registers are committed from a dirty list instead of by the SystemC kernel
+int  ACPluginsFlag=0;                           //!<Indicates whether instrumentation plugins can be loaded with --plugin
+int  ACInstrTraceFlag=0;                        //!<Indicates whether windows of the executed instructions can be written to a binary trace
+int  ACMPIFlag=0;                               //!<Indicates whether the cores of a multi-core main are partitioned across MPI ranks
+int  ACIntrDeferFlag=0;                         //!<Indicates whether interrupts wait for an instruction boundary of the behavior loop
 int  ACDelayFlag=0;                             //!<Indicates whether delay option is turned on or not
 int  ACDDecoderFlag=0;                          //!<Indicates whether decoder structures are dumped or not
 //int  ACQuietFlag=0;                             //!<Indicates whether storage update logs are displayed during simulation or not
@@ -90,6 +120,34 @@ struct option_map option_map[] = {
   {"--version"       , "-vrs"        ,"Display ACSIM version.", 0},
   {"--gdb-integration", "-gdb"       ,"Enable support for debbuging programs running on the simulator.", 0},
   {"--no-wait"       , "-nw"        ,"Disable wait() at execution thread.", 0},
+  {"--sparse-dec-cache", "-sdc"      ,"Allocate the decoded instructions cache on demand, one page at a time.", 0},
+  {"--threaded-dispatch", "-td"      ,"Dispatch instruction behaviors with threaded code (GCC/Clang labels as values).", 0},
+  {"--block-cache"   , "-bc"         ,"Cache and chain blocks of decoded instructions up to the next branch or jump.", 0},
+  {"--format-structs", "-fs"         ,"Keep decoded operands in per-format structs inside the decode cache.", 0},
+  {"--table-decoder" , "-tdec"       ,"Decode instructions with lookup tables generated for the ISA.", 0},
+  {"--pre-decode"    , "-pd"         ,"Fill the decode cache for the program text with host threads before simulation.", 0},
+  {"--dec-cache-snapshot", "-dcs"    ,"Save pre-decoded text to a snapshot file and map it in later runs of the same binary (implies -pd).", 0},
+  {"--dec-cache-invalidate", "-dci"  ,"Invalidate decode cache pages written by stores or loaders (self-modifying code).", 0},
+  {"--jit"           , "-jit"        ,"Translate hot cached blocks to x86-64 host code calling the behaviors (implies -bc).", 0},
+  {"--multicore"     , "-mc"         ,"Emit a main that runs --cores=N cores on host threads, synchronized every --quantum=Q instructions, or --threads=N threads of one program.", 0},
+  {"--standalone"    , "-sa"         ,"Emit a plain main() that runs behavior() directly, without sc_start() or wait() (implies -nw).", 0},
+  {"--adaptive-batch", "-ab"         ,"Grow the instruction batch between wait() calls while no TLM traffic or interrupts arrive, shrink it when they do.", 0},
+  {"--checkpoint"    , "-ckpt"       ,"Save the simulation state after --checkpoint-at=N instructions to --checkpoint=FILE and resume from --restore=FILE.", 0},
+  {"--batch"         , "-bat"        ,"Emit a main that runs the jobs listed in --batch=FILE in forked processes, --jobs=N at a time.", 0},
+  {"--server"        , "-srv"        ,"Emit a main that serves jobs sent to the socket of --serve=PATH or --serve=[HOST]:PORT, each in a process forked from the loaded model (implies -bat).", 0},
+  {"--host-endian-mem", "-hem"       ,"Keep the words of plain memories in host byte order, swapping once at load instead of on every access.", 0},
+  {"--mem-trace"     , "-mtr"        ,"Write instruction fetches and memory accesses to the file named by AC_MEM_TRACE, in the DineroIV binary format.", 0},
+  {"--mem-heatmap"   , "-mhm"        ,"Count the fetches, reads and writes of each guest page and the pages touched over time, written at exit to the file named by AC_MEM_HEATMAP.", 0},
+  {"--temporal-decoupling", "-tdc"   ,"Let the module run ahead of SystemC time, adding instruction and TLM delays to a local time and calling wait() once it reaches a global quantum.", 0},
+  {"--tlm2"          , "-tlm2"       ,"Make TLM ports and interrupt ports TLM-2.0 sockets carrying the generic payload, instead of ac_tlm protocol ports.", 0},
+  {"--host-profile"  , "-hp"         ,"Split the host time among fetch, decode, behaviors, system calls, wait() and the phases the model marks, printed with the statistics.", 0},
+  {"--guard-memory"  , "-gm"         ,"Reserve the whole 32-bit address space for memories and the decode cache, so out of bounds fetches and accesses trap instead of being checked.", 0},
+  {"--reg-locals"    , "-rl"         ,"Keep the program counters of the behavior loop in host locals, stored back only before decoding, gdb stops, translated blocks and wait().", 0},
+  {"--fused-behaviors", "-fbh"       ,"Run the generic, format and instruction behaviors of each instruction through one inlined handler, which extracts the operands once.", 0},
+  {"--sync-reg-dirty", "-srd"        ,"Commit the ac_sync_reg registers written in a cycle from a list at the end of ac_update_regs(), instead of through SystemC update requests.", 0},
+  {"--plugins"       , "-plg"        ,"Let the simulator load instrumentation plugins with --plugin=FILE[,ARGS], called on instruction retire, memory accesses, branches, system calls and block entry.", 0},
+  {"--instr-trace"   , "-itr"        ,"Write the instructions run between the AC_INSTR_TRACE_START and AC_INSTR_TRACE_STOP triggers to the file named by AC_INSTR_TRACE, in a binary format ac_trace_view prints.", 0},
+  {"--mpi"           , "-mpi"        ,"Partition the --cores=N of a multi-core main across the ranks of mpirun, meeting every quantum, with the memory window of --mpi-shared=ADDR:SIZE copied between them (implies -mc).", 0},
   0
 };
 
@@ -168,6 +226,145 @@ void print_comment( FILE* output, char* description ){
 }
 
 
+/**********************************************************/
+/*!Generated files are written next to their target and only
+   replace it when their content changed, so that make does not
+   rebuild the model for nothing. The manifest keeps hash, size
+   and modification time of every file as acsim left it: a file
+   nobody touched since is compared by hash alone.*/
+/**********************************************************/
+typedef struct {
+  char *name;
+  unsigned hash;
+  long size;
+  long mtime;
+} manifest_entry;
+
+static manifest_entry *manifest = NULL;
+static int manifest_len = -1;
+
+/*!FNV-1a hash and size of a file. Returns 0 if it can not be read. */
+static int hash_file( char* filename, unsigned *hash, long *size ){
+  FILE *file = fopen( filename, "r");
+  int c;
+
+  if( !file )
+    return 0;
+  *hash = 2166136261U;
+  *size = 0;
+  while( (c = getc( file)) != EOF ){
+    *hash = (*hash ^ (unsigned char) c) * 16777619U;
+    (*size)++;
+  }
+  fclose( file);
+  return 1;
+}
+
+/*!Whether two files have the same content. */
+static int same_files( char* name1, char* name2 ){
+  FILE *file1 = fopen( name1, "r");
+  FILE *file2 = fopen( name2, "r");
+  int c1 = 0, c2 = 0;
+
+  if( file1 && file2 )
+    do {
+      c1 = getc( file1);
+      c2 = getc( file2);
+    } while( (c1 == c2) && (c1 != EOF) );
+  if( file1 ) fclose( file1);
+  if( file2 ) fclose( file2);
+  return file1 && file2 && (c1 == c2);
+}
+
+static manifest_entry *find_manifest_entry( char* filename ){
+  char name[256];
+  unsigned hash;
+  long size, mtime;
+  FILE *file;
+  int i;
+
+  if( manifest_len < 0 ){
+    manifest_len = 0;
+    if( (file = fopen( ACSIM_MANIFEST, "r")) ){
+      while( fscanf( file, "%x %ld %ld %255s", &hash, &size, &mtime, name) == 4 ){
+        manifest = realloc( manifest, (manifest_len + 1) * sizeof(manifest_entry));
+        manifest[manifest_len].name = strdup( name);
+        manifest[manifest_len].hash = hash;
+        manifest[manifest_len].size = size;
+        manifest[manifest_len].mtime = mtime;
+        manifest_len++;
+      }
+      fclose( file);
+    }
+  }
+
+  for( i = 0; i < manifest_len; i++ )
+    if( !strcmp( manifest[i].name, filename) )
+      return &manifest[i];
+  return NULL;
+}
+
+/*!Opens a generated file for writing. It is only put in place by
+   close_output().
+  \param filename The name of the file to generate.*/
+FILE *open_output( char* filename ){
+  char tmpname[512];
+
+  snprintf( tmpname, sizeof(tmpname), "%s.tmp", filename);
+  return fopen( tmpname, "w");
+}
+
+/*!Closes a file opened by open_output() and replaces the one in
+   place with it unless both have the same content.
+  \param output The output file pointer.
+  \param filename The name of the file to generate.*/
+void close_output( FILE* output, char* filename ){
+  char tmpname[512];
+  manifest_entry *entry;
+  struct stat st;
+  unsigned hash = 0;
+  long size = 0;
+  int unchanged;
+  FILE *file;
+  int i;
+
+  fclose( output);
+  snprintf( tmpname, sizeof(tmpname), "%s.tmp", filename);
+  hash_file( tmpname, &hash, &size);
+
+  entry = find_manifest_entry( filename);
+  if( stat( filename, &st) != 0 )
+    unchanged = 0;
+  else if( entry && (entry->size == (long) st.st_size) && (entry->mtime == (long) st.st_mtime) )
+    unchanged = (entry->hash == hash) && (entry->size == size);
+  else
+    unchanged = same_files( tmpname, filename);
+
+  if( unchanged )
+    remove( tmpname);
+  else if( rename( tmpname, filename) != 0 ){
+    perror("ArchC could not write output file");
+    exit(1);
+  }
+
+  if( !entry ){
+    manifest = realloc( manifest, (manifest_len + 1) * sizeof(manifest_entry));
+    entry = &manifest[manifest_len++];
+    entry->name = strdup( filename);
+  }
+  entry->hash = hash;
+  entry->size = size;
+  entry->mtime = (stat( filename, &st) == 0) ? (long) st.st_mtime : 0;
+
+  if( (file = fopen( ACSIM_MANIFEST, "w")) ){
+    for( i = 0; i < manifest_len; i++ )
+      fprintf( file, "%08x %ld %ld %s\n", manifest[i].hash, manifest[i].size,
+               manifest[i].mtime, manifest[i].name);
+    fclose( file);
+  }
+}
+
+
 //////////////////////////////////////////
 /*!Main routine of  ArchC pre-processor.*/
 //////////////////////////////////////////
@@ -182,8 +379,10 @@ int main(int argc, char** argv) {
   extern ac_stg_list *stage_list;
   extern ac_pipe_list *pipe_list;
   ac_pipe_list *ppipe;
+  ac_dec_format *pformat;
   extern int HaveFormattedRegs;
-  extern int HaveTLMIntrPorts;
+  extern int HaveTLMPorts, HaveTLMIntrPorts;
+  extern int HaveMultiCycleIns, HaveMemHier;
   extern ac_decoder_full *decoder;
 
   //Uncomment the line bellow if you want to debug the parser.
@@ -282,6 +481,122 @@ int main(int argc, char** argv) {
               ACWaitFlag = 0;
               ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
               break;
+            case OPSparseDecCache:
+              ACSparseDecCacheFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPThreadedDispatch:
+              ACThreadedDispatchFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPBlockCache:
+              ACBlockCacheFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPFormatStructs:
+              ACFormatStructsFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPTableDecoder:
+              ACTableDecoderFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPPreDecode:
+              ACPreDecodeFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPDecSnapshot:
+              ACDecSnapshotFlag = 1;
+              ACPreDecodeFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPDecInvalidate:
+              ACDecInvalidateFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPJIT:
+              ACJITFlag = 1;
+              ACBlockCacheFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPMultiCore:
+              ACMultiCoreFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPMPI:
+              ACMPIFlag = 1;
+              ACMultiCoreFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPStandalone:
+              ACStandaloneFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPAdaptiveBatch:
+              ACAdaptiveBatchFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPCheckpoint:
+              ACCheckpointFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPBatch:
+              ACBatchFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPServer:
+              ACServerFlag = 1;
+              ACBatchFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPHostEndianMem:
+              ACHostEndianMemFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPMemTrace:
+              ACMemTraceFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPMemHeatmap:
+              ACMemHeatmapFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPTemporalDecoupling:
+              ACTemporalDecouplingFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPTLM2:
+              ACTLM2Flag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPHostProfile:
+              ACHostProfileFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPGuardMemory:
+              ACGuardMemoryFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPRegLocals:
+              ACRegLocalsFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPFusedBehavior:
+              ACFusedBehaviorFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPSyncRegDirty:
+              ACSyncRegDirtyFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPPlugins:
+              ACPluginsFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
+            case OPInstrTrace:
+              ACInstrTraceFlag = 1;
+              ACOptions_p += sprintf( ACOptions_p, "%s ", argv[0]);
+              break;
 
             default:
               break;
@@ -345,6 +660,182 @@ int main(int argc, char** argv) {
       fetchsize = wordsize;
     }
 
+    //The sparse decode cache is only emitted for the non-pipelined processor module.
+    if( ACSparseDecCacheFlag && (!ACDecCacheFlag || stage_list || pipe_list) ){
+      AC_MSG("Warning: --sparse-dec-cache needs the decode cache and a non-pipelined model. Option ignored.\n");
+      ACSparseDecCacheFlag = 0;
+    }
+
+    //Threaded dispatch replaces the switch emitted by EmitInstrExec, which is
+    //only used as is by non-pipelined models.
+    if( ACThreadedDispatchFlag && (stage_list || pipe_list) ){
+      AC_MSG("Warning: --threaded-dispatch needs a non-pipelined model. Option ignored.\n");
+      ACThreadedDispatchFlag = 0;
+    }
+
+    //Blocks are replayed from the decode cache without the update method, which adds
+    //the latency of multicycle instructions. Anything else that must see every cycle
+    //(memory hierarchy, delayed assignments, update logs) also disables them.
+    if( ACBlockCacheFlag && (!ACDecCacheFlag || stage_list || pipe_list || HaveMultiCycleIns || HaveMemHier ||
+                             ACDelayFlag || ACVerboseFlag || ACVerifyFlag || ACVerifyTimedFlag) ){
+      AC_MSG("Warning: --block-cache needs the decode cache and a single-cycle model without memory hierarchy, delays or update logs. Option ignored.\n");
+      ACBlockCacheFlag = 0;
+    }
+
+    //Translated blocks call one function per instruction, without the tracing,
+    //statistics and breakpoint checks of the interpreter.
+    if( ACJITFlag && (!ACBlockCacheFlag || ACDebugFlag || ACStatsFlag || ACGDBIntegrationFlag) ){
+      AC_MSG("Warning: --jit needs the block cache and no debug, statistics or gdb support. Option ignored.\n");
+      ACJITFlag = 0;
+    }
+
+    //Nothing but the behavior loop runs without the scheduler, so every module clocked
+    //or notified by SystemC (pipelines, TLM ports, delays, verification) needs sc_start().
+    if( ACStandaloneFlag && (stage_list || pipe_list || HaveMemHier || HaveTLMPorts ||
+                             HaveTLMIntrPorts || ACDelayFlag || ACVerboseFlag || ACVerifyFlag || ACVerifyTimedFlag ||
+                             ACGDBIntegrationFlag) ){
+      AC_MSG("Warning: --standalone needs a non-pipelined model with plain memories and no delays, update logs or gdb support. Option ignored.\n");
+      ACStandaloneFlag = 0;
+    }
+    if( ACStandaloneFlag )
+      ACWaitFlag = 0;
+
+    //Cores leave the SystemC scheduler and meet at quantum boundaries instead of
+    //wait(), so every module they talk to must be plain memory owned by the cores,
+    //and no SystemC thread may wait on them, as co-verification does.
+    if( ACMultiCoreFlag && (stage_list || pipe_list || HaveMemHier || HaveTLMPorts ||
+                            HaveTLMIntrPorts || !ACWaitFlag || ACDebugFlag || ACGDBIntegrationFlag ||
+                            ACVerboseFlag || ACVerifyFlag || ACVerifyTimedFlag) ){
+      AC_MSG("Warning: --multicore needs a non-pipelined model with plain memories, wait() enabled and no debug, update logs or gdb support. Option ignored.\n");
+      ACMultiCoreFlag = 0;
+      ACMPIFlag = 0;
+    }
+
+    //The batch size only matters where the behavior loop calls wait(). Cores of a
+    //multi-core run must all use the same quantum.
+    if( ACAdaptiveBatchFlag && (stage_list || pipe_list || !ACWaitFlag || ACMultiCoreFlag) ){
+      AC_MSG("Warning: --adaptive-batch needs a non-pipelined model with wait() enabled and no --multicore. Option ignored.\n");
+      ACAdaptiveBatchFlag = 0;
+    }
+
+    //Local time replaces the wait() at the end of each batch. Cores of a
+    //multi-core run synchronize with their own barrier instead.
+    if( ACTemporalDecouplingFlag && (stage_list || pipe_list || !ACWaitFlag || ACMultiCoreFlag) ){
+      AC_MSG("Warning: --temporal-decoupling needs a non-pipelined model with wait() enabled and no --multicore. Option ignored.\n");
+      ACTemporalDecouplingFlag = 0;
+    }
+
+    //Interrupt ports queue what they receive and the behavior loop runs the
+    //handlers between two instructions. Pipelined models have no such single
+    //point, so their ports still call the handlers at once.
+    ACIntrDeferFlag = HaveTLMIntrPorts && !stage_list && !pipe_list;
+
+    //A checkpoint holds the module registers and plain memories. State kept in
+    //stages, caches, TLM peers or in more than one core is not written.
+    if( ACCheckpointFlag && (stage_list || pipe_list || HaveMemHier || HaveTLMPorts ||
+                             HaveTLMIntrPorts || HaveFormattedRegs || ACMultiCoreFlag) ){
+      AC_MSG("Warning: --checkpoint needs a single-core, non-pipelined model with plain memories and registers. Option ignored.\n");
+      ACCheckpointFlag = 0;
+    }
+
+    //Jobs are forked from a process holding a single processor module, and
+    //the gdb stub would listen on the same port in every job.
+    if( ACBatchFlag && (ACMultiCoreFlag || ACGDBIntegrationFlag) ){
+      AC_MSG("Warning: --batch needs a single-core simulator without gdb support. Option ignored.\n");
+      ACBatchFlag = 0;
+      ACServerFlag = 0;
+    }
+
+    //Delayed writes and cache models move raw words of the storage around.
+    if( ACHostEndianMemFlag && (ACDelayFlag || HaveMemHier) ){
+      AC_MSG("Warning: --host-endian-mem needs plain memories without --delay. Option ignored.\n");
+      ACHostEndianMemFlag = 0;
+    }
+
+    //The trace has a single writer, and translated blocks skip the fetch hook.
+    if( ACMemTraceFlag && (ACMultiCoreFlag || HaveMemHier || ACJITFlag) ){
+      AC_MSG("Warning: --mem-trace needs a single-core simulator with plain memories and no --jit. Option ignored.\n");
+      ACMemTraceFlag = 0;
+    }
+
+    //Likewise for the heatmap, which has a single counting thread.
+    if( ACMemHeatmapFlag && (ACMultiCoreFlag || HaveMemHier || ACJITFlag) ){
+      AC_MSG("Warning: --mem-heatmap needs a single-core simulator with plain memories and no --jit. Option ignored.\n");
+      ACMemHeatmapFlag = 0;
+    }
+
+    //Likewise for the instruction trace, whose words are fetched from a plain memory.
+    if( ACInstrTraceFlag && (ACMultiCoreFlag || HaveMemHier || ACJITFlag) ){
+      AC_MSG("Warning: --instr-trace needs a single-core simulator with plain memories and no --jit. Option ignored.\n");
+      ACInstrTraceFlag = 0;
+    }
+
+    //The phases are switched in the behavior loop of non-pipelined models.
+    if( ACHostProfileFlag && (stage_list || pipe_list) ){
+      AC_MSG("Warning: --host-profile needs a non-pipelined model. Option ignored.\n");
+      ACHostProfileFlag = 0;
+    }
+
+    //Only plain storages and the flat decode cache of the behavior loop are reserved.
+    if( ACGuardMemoryFlag && (stage_list || pipe_list || HaveMemHier || HaveTLMPorts ||
+                              ACSparseDecCacheFlag) ){
+      AC_MSG("Warning: --guard-memory needs a non-pipelined model with plain memories and no --sparse-dec-cache. Option ignored.\n");
+      ACGuardMemoryFlag = 0;
+    }
+
+    //Pipelined models pass the program counter through signals.
+    if( ACRegLocalsFlag && (stage_list || pipe_list) ){
+      AC_MSG("Warning: --reg-locals needs a non-pipelined model. Option ignored.\n");
+      ACRegLocalsFlag = 0;
+    }
+
+    //Stage behaviors take the stage, so they cannot be fused.
+    if( ACFusedBehaviorFlag && (stage_list || pipe_list) ){
+      AC_MSG("Warning: --fused-behaviors needs a non-pipelined model. Option ignored.\n");
+      ACFusedBehaviorFlag = 0;
+    }
+
+    //Only the cycle updates of pipelined models and the update of multicycle
+    //ones, after each instruction, commit them.
+    if( ACSyncRegDirtyFlag && !stage_list && !pipe_list && !HaveMultiCycleIns ){
+      AC_MSG("Warning: --sync-reg-dirty needs a pipelined or multicycle model. Option ignored.\n");
+      ACSyncRegDirtyFlag = 0;
+    }
+
+    //The hooks are called from the behavior loop of non-pipelined models.
+    if( ACPluginsFlag && (stage_list || pipe_list) ){
+      AC_MSG("Warning: --plugins needs a non-pipelined model. Option ignored.\n");
+      ACPluginsFlag = 0;
+    }
+
+    //Pipelined models pass ac_instr objects between stages.
+    if( ACFormatStructsFlag && (!ACDecCacheFlag || stage_list || pipe_list) ){
+      AC_MSG("Warning: --format-structs needs the decode cache and a non-pipelined model. Option ignored.\n");
+      ACFormatStructsFlag = 0;
+    }
+
+    //The generated tables extract fields from a single fetched word.
+    if( ACTableDecoderFlag ){
+      for( pformat = format_ins_list; pformat != NULL && pformat->size == wordsize; pformat = pformat->next);
+      if( pformat != NULL || wordsize > 32 || fetchsize != wordsize ){
+        AC_MSG("Warning: --table-decoder needs all formats to be one word long, with words of at most 32 bits. Option ignored.\n");
+        ACTableDecoderFlag = 0;
+      }
+    }
+
+    //Pre-decoding reads the program straight from memory, bypassing any cache hierarchy.
+    if( ACPreDecodeFlag && (!ACDecCacheFlag || stage_list || pipe_list || HaveMemHier) ){
+      AC_MSG("Warning: --pre-decode needs the decode cache and a non-pipelined model without memory hierarchy. Option ignored.\n");
+      ACPreDecodeFlag = 0;
+      ACDecSnapshotFlag = 0;
+    }
+
+    //Writes are tracked on the instruction memory port, which a cache hierarchy bypasses.
+    if( ACDecInvalidateFlag && (!ACDecCacheFlag || stage_list || pipe_list || HaveMemHier) ){
+      AC_MSG("Warning: --dec-cache-invalidate needs the decode cache and a non-pipelined model without memory hierarchy. Option ignored.\n");
+      ACDecInvalidateFlag = 0;
+    }
+
     //Testing host endianess.
     a.i = 255;
     b.c[0] = 0;
@@ -455,6 +946,9 @@ int main(int argc, char** argv) {
       /* Create the template for the main.cpp  file */
       CreateMainTmpl();
 
+      /* Create the header the Makefile precompiles */
+      CreatePchHeader();
+
       /* Create the Makefile */
       CreateMakefile();
 		
@@ -496,7 +990,7 @@ int main(int argc, char** argv) {
 
     sprintf(filename, "%s_arch.H", project_name);
 
-    if ( !(output = fopen( filename, "w"))){
+    if ( !(output = open_output( filename))){
       perror("ArchC could not open output file");
       exit(1);
     }
@@ -513,10 +1007,10 @@ int main(int argc, char** argv) {
     fprintf( output, "#include  \"ac_reg.H\"\n");
 
     if (HaveTLMPorts)
-      fprintf(output, "#include  \"ac_tlm_port.H\"\n");
+      fprintf(output, "#include  \"%s.H\"\n", TLM_PORT_CLASS);
 
     if (HaveTLMIntrPorts)
-      fprintf(output, "#include  \"ac_tlm_intr_port.H\"\n");
+      fprintf(output, "#include  \"%s.H\"\n", TLM_INTR_PORT_CLASS);
 
     if( HaveFormattedRegs )
       fprintf( output, "#include  \"%s_fmt_regs.H\"\n", project_name);
@@ -529,7 +1023,7 @@ int main(int argc, char** argv) {
 
     //Declaring Architecture Resources class.
     COMMENT(INDENT[0],"ArchC class for model-specific architectural resources.\n");
-    fprintf( output, "class %s_arch : public ac_arch_dec_if<%s_parms::ac_word, %s_parms::ac_Hword> {\n", project_name, project_name, project_name);
+    fprintf( output, "class %s_arch : public ac_arch_dec_if<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms> {\n", project_name, project_name, project_name, project_name);
     fprintf( output, "public:\n");
     fprintf( output, " \n");
 
@@ -607,7 +1101,7 @@ int main(int argc, char** argv) {
 
 	if( !HaveMemHier ) { //It is a generic cache. Just emit a base container object.
 	  fprintf( output, "%sac_storage %s_stg;\n", INDENT[1], pstorage->name);
-	  fprintf(output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword> %s;\n", INDENT[1], project_name, project_name, pstorage->name);
+	  fprintf(output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms> %s;\n", INDENT[1], project_name, project_name, project_name, pstorage->name);
 	}
 	else{
 	  //It is an ac_cache object.
@@ -620,7 +1114,7 @@ int main(int argc, char** argv) {
 
 	if( !HaveMemHier ) { //It is a generic mem. Just emit a base container object.
 	  fprintf( output, "%sac_storage %s_stg;\n", INDENT[1], pstorage->name);
-	  fprintf(output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword> %s;\n", INDENT[1], project_name, project_name, pstorage->name);
+	  fprintf(output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms> %s;\n", INDENT[1], project_name, project_name, project_name, pstorage->name);
 	}
 	else{
 	  //It is an ac_mem object.
@@ -630,13 +1124,13 @@ int main(int argc, char** argv) {
 	break;
 
       case TLM_PORT:
-	fprintf(output, "%sac_tlm_port %s_port;\n", INDENT[1], pstorage->name);
-	fprintf(output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword> %s;\n", INDENT[1], project_name, project_name, pstorage->name);
+	fprintf(output, "%s%s %s_port;\n", INDENT[1], TLM_PORT_CLASS, pstorage->name);
+	fprintf(output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms> %s;\n", INDENT[1], project_name, project_name, project_name, pstorage->name);
 	break;
 
       default:
 	fprintf( output, "%sac_storage %s_stg;\n", INDENT[1], pstorage->name);
-	fprintf(output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword> %s;\n", INDENT[1], project_name, project_name, pstorage->name);
+	fprintf(output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms> %s;\n", INDENT[1], project_name, project_name, project_name, pstorage->name);
 	break;
       }
     }
@@ -645,8 +1139,14 @@ int main(int argc, char** argv) {
     fprintf( output, "\n");
 
     //ac_resources constructor declaration
-    COMMENT(INDENT[1],"Constructor.");
-    fprintf( output, "%sexplicit %s_arch();\n", INDENT[1], project_name);
+    if( ACMultiCoreFlag ){
+      COMMENT(INDENT[1],"Constructor. With shared, the memories are those of shared, and none is allocated.");
+      fprintf( output, "%sexplicit %s_arch(%s_arch* shared = 0);\n", INDENT[1], project_name, project_name);
+    }
+    else{
+      COMMENT(INDENT[1],"Constructor.");
+      fprintf( output, "%sexplicit %s_arch();\n", INDENT[1], project_name);
+    }
 	
     fprintf( output, "\n");
 
@@ -684,7 +1184,7 @@ int main(int argc, char** argv) {
     }
 
     if(ACVerifyFlag){
-      COMMENT(INDENT[1],"Set co-verification msg queue.");
+      COMMENT(INDENT[1],"Set co-verification message ring.");
       fprintf( output, "%svoid set_queue(char *exec_name);\n", INDENT[1]);
     }
 
@@ -706,7 +1206,7 @@ int main(int argc, char** argv) {
     fprintf( output, "};\n\n"); //End of ac_resources class
 
     fprintf( output, "#endif  //_%s_ARCH_H\n", upper_project_name);
-    fclose( output);
+    close_output( output, filename);
 
   }
 
@@ -732,7 +1232,7 @@ int main(int argc, char** argv) {
 
     sprintf(filename, "%s_arch_ref.H", project_name);
 
-    if ( !(output = fopen( filename, "w"))){
+    if ( !(output = open_output( filename))){
       perror("ArchC could not open output file");
       exit(1);
     }
@@ -748,7 +1248,7 @@ int main(int argc, char** argv) {
     fprintf( output, "#include  \"ac_regbank.H\"\n");
 
     if (HaveTLMIntrPorts)
-      fprintf(output, "#include  \"ac_tlm_intr_port.H\"\n");
+      fprintf(output, "#include  \"%s.H\"\n", TLM_INTR_PORT_CLASS);
 
     fprintf(output, "\n");
 
@@ -757,7 +1257,7 @@ int main(int argc, char** argv) {
 
     //Declaring Architecture Resource references class.
     COMMENT(INDENT[0],"ArchC class for model-specific architectural resources.");
-    fprintf( output, "class %s_arch_ref : public ac_arch_ref<%s_parms::ac_word, %s_parms::ac_Hword> {\n", project_name, project_name, project_name);
+    fprintf( output, "class %s_arch_ref : public ac_arch_ref<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms> {\n", project_name, project_name, project_name, project_name);
     fprintf( output, "public:\n");
     fprintf( output, " \n");
 
@@ -834,7 +1334,7 @@ int main(int argc, char** argv) {
       case DCACHE:
 
 	if( !HaveMemHier ) { //It is a generic cache. Just emit a base container object.
-	  fprintf( output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword>& %s;\n", INDENT[1], project_name, project_name, pstorage->name);
+	  fprintf( output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms>& %s;\n", INDENT[1], project_name, project_name, project_name, pstorage->name);
 	}
 	else{
 	  //It is an ac_cache object.
@@ -846,7 +1346,7 @@ int main(int argc, char** argv) {
       case MEM:
 
 	if( !HaveMemHier ) { //It is a generic mem. Just emit a base container object.
-	  fprintf( output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword>& %s;\n", INDENT[1], project_name, project_name, pstorage->name);
+	  fprintf( output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms>& %s;\n", INDENT[1], project_name, project_name, project_name, pstorage->name);
 	}
 	else{
 	  //It is an ac_mem object.
@@ -856,7 +1356,7 @@ int main(int argc, char** argv) {
 	break;
 
       default:
-	fprintf( output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword>& %s;\n", INDENT[1], project_name, project_name, pstorage->name);
+	fprintf( output, "%sac_memport<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms>& %s;\n", INDENT[1], project_name, project_name, project_name, pstorage->name);
 	break;
       }
     }
@@ -872,7 +1372,7 @@ int main(int argc, char** argv) {
     fprintf( output, "};\n\n"); //End of _arch_ref class
 
     fprintf( output, "#endif  //_%s_ARCH_REF_H\n", upper_project_name);
-    fclose( output);
+    close_output( output, filename);
 
   }
 
@@ -898,7 +1398,7 @@ int main(int argc, char** argv) {
 
     sprintf(filename, "%s_arch_ref.cpp", project_name);
 
-    if ( !(output = fopen( filename, "w"))){
+    if ( !(output = open_output( filename))){
       perror("ArchC could not open output file");
       exit(1);
     }
@@ -911,8 +1411,8 @@ int main(int argc, char** argv) {
     //Declaring Architecture Resource references class.
     COMMENT(INDENT[0],"/Default constructor.");
     fprintf(output,
-	    "%s_arch_ref::%s_arch_ref(%s_arch& arch) : ac_arch_ref<%s_parms::ac_word, %s_parms::ac_Hword>(arch),\n",
-	    project_name, project_name, project_name, project_name, project_name);
+	    "%s_arch_ref::%s_arch_ref(%s_arch& arch) : ac_arch_ref<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms>(arch),\n",
+	    project_name, project_name, project_name, project_name, project_name, project_name);
 
     /* Declaring ac_pc reference */
     fprintf(output, "%sac_pc(arch.ac_pc),\n", INDENT[1]);
@@ -926,7 +1426,7 @@ int main(int argc, char** argv) {
       }
     }
     fprintf(output, " {}\n\n");
-    fclose( output);
+    close_output( output, filename);
 
   }
 
@@ -956,7 +1456,7 @@ int main(int argc, char** argv) {
     FILE *output;
 
     sprintf(filename, "%s_parms.H", project_name);
-    if ( !(output = fopen(filename, "w"))){
+    if ( !(output = open_output( filename))){
       perror("ArchC could not open output file");
       exit(1);
     }
@@ -990,6 +1490,79 @@ int main(int argc, char** argv) {
     if( HaveCycleRange )
       fprintf( output, "#define  AC_CYCLE_RANGE \t //!< Indicates that cycle range for instructions were declared.\n\n");
 
+    if( ACSparseDecCacheFlag )
+      fprintf( output, "#define  AC_SPARSE_DEC_CACHE \t //!< Indicates that the decode cache is allocated page by page.\n\n");
+
+    if( ACBlockCacheFlag )
+      fprintf( output, "#define  AC_BLOCK_CACHE \t //!< Indicates that blocks of decoded instructions are cached and chained.\n\n");
+
+    if( ACFormatStructsFlag )
+      fprintf( output, "#define  AC_FORMAT_STRUCTS \t //!< Indicates that decoded operands are kept in per-format structs.\n\n");
+
+    if( ACTableDecoderFlag )
+      fprintf( output, "#define  AC_TABLE_DECODER \t //!< Indicates that instructions are decoded by generated lookup tables.\n\n");
+
+    if( ACPreDecodeFlag )
+      fprintf( output, "#define  AC_PRE_DECODE \t //!< Indicates that the program text is decoded before simulation.\n\n");
+
+    if( ACDecSnapshotFlag )
+      fprintf( output, "#define  AC_DEC_SNAPSHOT \t //!< Indicates that pre-decoded text is kept in snapshot files.\n\n");
+
+    if( ACDecInvalidateFlag )
+      fprintf( output, "#define  AC_DEC_INVALIDATE \t //!< Indicates that writes to code pages invalidate the decode cache.\n\n");
+
+    //The translator emits x86-64 code, other hosts keep interpreting the blocks.
+    if( ACJITFlag ){
+      fprintf( output, "#if defined(__GNUC__) && defined(__x86_64__)\n");
+      fprintf( output, "#define  AC_JIT \t //!< Indicates that hot blocks are translated to host code.\n");
+      fprintf( output, "#endif\n\n");
+    }
+
+    if( ACStandaloneFlag )
+      fprintf( output, "#define  AC_STANDALONE \t //!< Indicates that main() runs behavior() without the SystemC scheduler.\n\n");
+
+    if( ACMultiCoreFlag )
+      fprintf( output, "#define  AC_MULTICORE \t //!< Indicates that cores may run on host threads, synchronized by quanta.\n\n");
+
+    if( ACAdaptiveBatchFlag )
+      fprintf( output, "#define  AC_ADAPTIVE_BATCH \t //!< Indicates that the instruction batch size adapts to port traffic.\n\n");
+
+    if( ACCheckpointFlag )
+      fprintf( output, "#define  AC_CHECKPOINT \t //!< Indicates that the simulation state can be saved to and restored from files.\n\n");
+
+    if( ACBatchFlag )
+      fprintf( output, "#define  AC_BATCH \t //!< Indicates that main can run a list of jobs in forked processes.\n\n");
+
+    if( ACServerFlag )
+      fprintf( output, "#define  AC_SERVER \t //!< Indicates that main can serve jobs over a socket.\n\n");
+
+    if( ACHostEndianMemFlag )
+      fprintf( output, "#define  AC_HOST_ENDIAN_MEM \t //!< Indicates that plain memories keep target words in host byte order.\n\n");
+
+    if( ACMemTraceFlag )
+      fprintf( output, "#define  AC_MEM_TRACE \t //!< Indicates that memory references can be written to a trace file.\n\n");
+
+    if( ACMemHeatmapFlag )
+      fprintf( output, "#define  AC_MEM_HEATMAP \t //!< Indicates that the accesses to each page can be counted for a heatmap.\n\n");
+
+    if( ACHostProfileFlag )
+      fprintf( output, "#define  AC_HOST_PROFILE \t //!< Indicates that the host time is split by phase.\n\n");
+
+    if( ACGuardMemoryFlag )
+      fprintf( output, "#define  AC_GUARD_MEMORY \t //!< Indicates that plain memories span the address space and check no bounds.\n\n");
+
+    if( ACPluginsFlag )
+      fprintf( output, "#define  AC_PLUGINS \t //!< Indicates that instrumentation plugins can be loaded.\n\n");
+
+    //Labels as values are a GNU extension, other compilers fall back to the switch.
+    if( ACThreadedDispatchFlag ){
+      fprintf( output, "#if defined(__GNUC__)\n");
+      fprintf( output, "#define  AC_THREADED_DISPATCH \t //!< Indicates that instructions are dispatched through threaded code.\n");
+      fprintf( output, "#endif\n\n");
+    }
+
+    fprintf( output, "#include  \"ac_isa_parms.H\"\n\n");
+
     /* parms namespace definition */
     fprintf(output, "namespace %s_parms {\n\n", project_name);
 
@@ -1005,6 +1578,34 @@ int main(int argc, char** argv) {
     fprintf( output, "static const unsigned int AC_RAMSIZE = %uU; \t //!< Architecture RAM size in bytes (storage %s).\n", load_device->size, load_device->name);
     fprintf( output, "static const unsigned int AC_RAM_END = %uU; \t //!< Architecture end of RAM (storage %s).\n", load_device->size, load_device->name);
 
+    if( ACBlockCacheFlag )
+      fprintf( output, "static const unsigned int AC_BLOCK_MAX_SIZE = 64; \t //!< Maximum number of instructions in a cached block.\n");
+    if( ACPreDecodeFlag ){
+      fprintf( output, "static const unsigned int AC_PRE_DECODE_STEP = %d; \t //!< Distance in bytes between pre-decoded addresses.\n", 1 << GetInstrSizeShift());
+      fprintf( output, "static const unsigned int AC_PRE_DECODE_MAX_THREADS = 16; \t //!< Maximum number of host threads used to pre-decode.\n");
+    }
+    if( ACDecInvalidateFlag )
+      fprintf( output, "static const unsigned int AC_CODE_PAGE_BITS = 12; \t //!< log2 of the size in bytes of the pages watched for code writes.\n");
+    if( ACAdaptiveBatchFlag ){
+      fprintf( output, "static const unsigned int AC_INSTR_BATCH_MIN = 100; \t //!< Smallest batch of instructions between wait() calls.\n");
+      fprintf( output, "static const unsigned int AC_INSTR_BATCH_MAX = 100000; \t //!< Largest batch of instructions between wait() calls.\n");
+    }
+    if( ACTemporalDecouplingFlag ){
+      fprintf( output, "static const unsigned int AC_INSTR_TIME_PS = 1000; \t //!< Local time taken by each instruction, in picoseconds.\n");
+      fprintf( output, "static const unsigned int AC_TIME_QUANTUM_NS = 10000; \t //!< Local time a module may run ahead of SystemC, in nanoseconds.\n");
+    }
+    if( ACJITFlag ){
+      fprintf( output, "static const unsigned int AC_JIT_THRESHOLD = 64; \t //!< Executions of a block before it is translated.\n");
+      fprintf( output, "static const unsigned int AC_JIT_CODE_SIZE = 16U << 20; \t //!< Size in bytes of the translated code buffer.\n");
+    }
+
+    if( ACSparseDecCacheFlag ){
+      fprintf( output, "static const unsigned int AC_DEC_CACHE_PAGE_BITS = 12; \t //!< log2 of the decode cache page size in bytes.\n");
+      fprintf( output, "static const unsigned int AC_DEC_CACHE_SLOT_SHIFT = %d; \t //!< log2 of the address distance between decode cache slots.\n", GetInstrSizeShift());
+      fprintf( output, "static const unsigned int AC_DEC_CACHE_PAGE_SLOTS = 1U << (AC_DEC_CACHE_PAGE_BITS - AC_DEC_CACHE_SLOT_SHIFT); \t //!< Decode cache slots per page.\n");
+      fprintf( output, "static const unsigned int AC_DEC_CACHE_PAGE_MASK = (1U << AC_DEC_CACHE_PAGE_BITS) - 1; \t //!< Offset mask inside a decode cache page.\n");
+    }
+
     if (ACGDBIntegrationFlag)
     fprintf( output, "static const unsigned int GDB_PORT_NUM = 5000; \t //!< GDB port number.\n", load_device->size, load_device->name);
 
@@ -1083,6 +1684,9 @@ int main(int argc, char** argv) {
       break;
     }
 
+    fprintf( output, "\n\n");
+    COMMENT(INDENT[0],"ISA parameters the aclib templates are instantiated with, fixed for this model.");
+    fprintf( output, "typedef  ac_isa_parms<%d, %d> ac_fixed_parms; \t //!< Host endian match and largest instruction size in bits.\n", ac_match_endian, largest_format_size);
 
     fprintf( output, "\n\n");
 
@@ -1138,7 +1742,7 @@ int main(int argc, char** argv) {
     fprintf( output, "\n\n");
     fprintf( output, "#endif  //_%s_PARMS_H\n", upper_project_name);
 
-    fclose(output);
+    close_output( output, filename);
   }
 
 
@@ -1158,6 +1762,7 @@ int main(int argc, char** argv) {
     ac_dec_format *pformat;
     ac_dec_instr *pinstr;
     ac_dec_field *pfield, *pf;
+    const char *bhv_inline;
 
     char filename[256];
     char description[] = "Instruction Set Architecture header file.";
@@ -1167,7 +1772,7 @@ int main(int argc, char** argv) {
 
     sprintf( filename, "%s_isa.H", project_name);
 
-    if ( !(output = fopen( filename, "w"))){
+    if ( !(output = open_output( filename))){
       perror("ArchC could not open output file");
       exit(1);
     }
@@ -1210,6 +1815,11 @@ int main(int argc, char** argv) {
     fprintf(output, "%sstatic const ac_instr_info instr_table[AC_DEC_INSTR_NUMBER + 1];\n\n", INDENT[1]);
 
     fprintf( output, "%sac_decoder_full* decoder;\n\n", INDENT[1]);
+    if( ACTableDecoderFlag ){
+      COMMENT(INDENT[1], "Decodes one instruction word through the generated lookup tables, into fields.");
+      fprintf( output, "%sstatic unsigned* decode_table(ac_word word, unsigned* fields);\n", INDENT[1]);
+      fprintf( output, "%sunsigned table_fields[AC_DEC_FIELD_NUMBER];\n\n", INDENT[1]);
+    }
     if (ACABIFlag)
       fprintf( output, "%s%s_syscall syscall;\n", INDENT[1], project_name );
 
@@ -1252,8 +1862,11 @@ int main(int argc, char** argv) {
      fprintf(output, "\n");
     }
     /* Instruction Behavior Method declarations */
+    /* Fused handlers inline the behaviors, all defined in the ISA file included by the processor module. */
+    bhv_inline = ACFusedBehaviorFlag ? "inline __attribute__((always_inline)) " : "";
+
     /* instruction */
-    fprintf(output, "%svoid _behavior_instruction(", INDENT[1]);
+    fprintf(output, "%s%svoid _behavior_instruction(", INDENT[1], bhv_inline);
     /* common_instr_field_list has the list of fields for the generic instruction. */
     for( pfield = common_instr_field_list; pfield != NULL; pfield = pfield->next){
       if( pfield->sign )
@@ -1271,8 +1884,8 @@ int main(int argc, char** argv) {
 
     /* types/formats */
     for (pformat = format_ins_list; pformat!= NULL; pformat=pformat->next) {
-      fprintf(output, "%svoid _behavior_%s_%s(",
-	      INDENT[1], project_name, pformat->name);
+      fprintf(output, "%s%svoid _behavior_%s_%s(",
+	      INDENT[1], bhv_inline, project_name, pformat->name);
       for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next) {
 	if (pfield -> sign)
 	  fprintf(output, "int %s", pfield->name);
@@ -1290,8 +1903,8 @@ int main(int argc, char** argv) {
       for (pformat = format_ins_list;
 	   (pformat != NULL) && strcmp(pinstr->format, pformat->name);
 	   pformat = pformat->next);
-      fprintf(output, "%svoid behavior_%s(",
-	      INDENT[1], pinstr->name);
+      fprintf(output, "%s%svoid behavior_%s(",
+	      INDENT[1], bhv_inline, pinstr->name);
       for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next) {
 	if (pfield -> sign)
 	  fprintf(output, "int %s", pfield->name);
@@ -1304,6 +1917,53 @@ int main(int argc, char** argv) {
     }
     fprintf(output, "\n");
 
+    /* Fused handlers: generic, format and instruction behaviors on the same operands.
+       The loop clears ac_annul_sig after every instruction, so it is only
+       tested after the behaviors that may set it. */
+    if( ACFusedBehaviorFlag ){
+      for (pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next) {
+        for (pformat = format_ins_list;
+             (pformat != NULL) && strcmp(pinstr->format, pformat->name);
+             pformat = pformat->next);
+        fprintf(output, "%sinline __attribute__((always_inline)) void _fused_%s(", INDENT[1], pinstr->name);
+        for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next) {
+          if (pfield -> sign)
+            fprintf(output, "int %s", pfield->name);
+          else
+            fprintf(output, "unsigned int %s", pfield->name);
+          if (pfield->next != NULL)
+            fprintf(output, ", ");
+        }
+        fprintf(output, ") {\n");
+        fprintf(output, "%s_behavior_instruction(", INDENT[2]);
+        for( pfield = common_instr_field_list; pfield != NULL; pfield = pfield->next){
+          for( pf = pformat->fields; pf != NULL && strcmp(pf->name, pfield->name); pf = pf->next);
+          fprintf(output, "%s", pf ? pf->name : "0");
+          if (pfield->next != NULL)
+            fprintf(output, ", ");
+        }
+        fprintf(output, ");\n");
+        fprintf(output, "%sif (ac_annul_sig) return;\n", INDENT[2]);
+        fprintf(output, "%s_behavior_%s_%s(", INDENT[2], project_name, pformat->name);
+        for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next) {
+          fprintf(output, "%s", pfield->name);
+          if (pfield->next != NULL)
+            fprintf(output, ", ");
+        }
+        fprintf(output, ");\n");
+        fprintf(output, "%sif (ac_annul_sig) return;\n", INDENT[2]);
+        fprintf(output, "%sbehavior_%s(", INDENT[2], pinstr->name);
+        for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next) {
+          fprintf(output, "%s", pfield->name);
+          if (pfield->next != NULL)
+            fprintf(output, ", ");
+        }
+        fprintf(output, ");\n");
+        fprintf(output, "%s}\n", INDENT[1]);
+      }
+      fprintf(output, "\n");
+    }
+
     /* Closing class declaration. */
     fprintf(output,"};\n");
     /* Closing namespace declaration. */
@@ -1311,11 +1971,11 @@ int main(int argc, char** argv) {
 
     /* END OF FILE */
     fprintf( output, "\n\n#endif //_%s_ISA_H\n\n", upper_project_name);
-    fclose( output);
+    close_output( output, filename);
 
     /* opens behavior macros file */
     sprintf( filename, "%s_bhv_macros.H", project_name);
-    if ( !(output = fopen( filename, "w"))){
+    if ( !(output = open_output( filename))){
       perror("ArchC could not open output file");
       exit(1);
     }
@@ -1324,7 +1984,7 @@ int main(int argc, char** argv) {
     fprintf( output, "#define _%s_BHV_MACROS_H\n\n", upper_project_name);
 
     /* ac_memory TYPEDEF */
-    fprintf(output, "typedef ac_memport<%s_parms::ac_word, %s_parms::ac_Hword> ac_memory;\n\n", project_name, project_name);
+    fprintf(output, "typedef ac_memport<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms> ac_memory;\n\n", project_name, project_name, project_name);
 
     /* ac_behavior main macro */
     fprintf( output, "#define ac_behavior(instr) AC_BEHAVIOR_##instr ()\n\n");
@@ -1383,7 +2043,7 @@ int main(int argc, char** argv) {
 
     /* END OF FILE */
     fprintf( output, "\n\n#endif //_%s_BHV_MACROS_H\n\n", upper_project_name);
-    fclose( output);
+    close_output( output, filename);
 
   }
 
@@ -1412,7 +2072,7 @@ int main(int argc, char** argv) {
 	sprintf( stage_filename, "%s.H", pstage->name);
       }
 
-      if ( !(output = fopen( stage_filename, "w"))){
+      if ( !(output = open_output( stage_filename))){
 	perror("ArchC could not open output file");
 	exit(1);
       }
@@ -1430,8 +2090,10 @@ int main(int argc, char** argv) {
       fprintf( output, "#include \"archc.H\"\n");
       fprintf( output, "#include \"%s_isa.H\"\n\n", project_name);
 
-      if( pstage->id == 1 && ACDecCacheFlag )
+      if( pstage->id == 1 && ACDecCacheFlag ){
+	fprintf( output, "#include \"ac_host_place.H\"\n\n");
 	fprintf( output, "extern unsigned dec_cache_size;\n\n");
+      }
 
       //Declaring stage namespace.
       if( pipe_name ){
@@ -1455,6 +2117,10 @@ int main(int argc, char** argv) {
 	fprintf( output, "%ssc_out<bool> bhv_start;\n", INDENT[1]);
       }
 
+      //regout copies the instruction, so one slot per stage is enough.
+      if( pstage->id != 1 || !ACDecCacheFlag )
+	fprintf( output, "%sac_instr instr_slot; \t //!< Instruction in this stage, reused every cycle.\n", INDENT[1]);
+
       fprintf( output, "%ssc_out<bool> bhv_done;\n", INDENT[1]);
       fprintf( output, "%s%s_parms::%s_isa ISA;\n", INDENT[1], project_name, project_name);
 
@@ -1497,7 +2163,7 @@ int main(int argc, char** argv) {
 
       if(pstage->id==1 && ACDecCacheFlag){
 	fprintf( output, "%svoid init_dec_cache() {\n", INDENT[1]);  //end constructor
-	fprintf( output, "%sDEC_CACHE = (cache_item*)calloc(sizeof(cache_item),dec_cache_size);\n", INDENT[2]);  //end constructor
+	fprintf( output, "%sDEC_CACHE = (cache_item*)ac_host_alloc((size_t) sizeof(cache_item) * dec_cache_size);\n", INDENT[2]);  //end constructor
 	fprintf( output, "%s}\n", INDENT[1]);  //end init_dec_cache
       }
 
@@ -1508,7 +2174,7 @@ int main(int argc, char** argv) {
       fprintf( output, "}\n");
 
       fprintf( output, "#endif \n");
-      fclose(output);
+      close_output( output, stage_filename);
       free(stage_filename);
     }
   }
@@ -1521,12 +2187,13 @@ int main(int argc, char** argv) {
     extern char *project_name;
     extern char *upper_project_name;
     extern int stage_num;
-    extern int HaveMultiCycleIns;
+    extern int HaveMultiCycleIns, HaveMemHier;
     extern int HaveTLMIntrPorts;
     extern ac_sto_list *tlm_intr_port_list;
+    extern ac_sto_list *storage_list;
     ac_stg_list *pstage;
     ac_pipe_list *ppipe;
-    ac_sto_list *pport;
+    ac_sto_list *pport, *pstorage;
     int i;
     char filename[256];
     char description[] = "Architecture Module header file.";
@@ -1536,7 +2203,7 @@ int main(int argc, char** argv) {
 
     sprintf( filename, "%s.H", project_name);
 
-    if ( !(output = fopen( filename, "w"))){
+    if ( !(output = open_output( filename))){
       perror("ArchC could not open output file");
       exit(1);
     }
@@ -1558,7 +2225,7 @@ int main(int argc, char** argv) {
       fprintf( output, "#include \"%s_syscall.H\"\n", project_name);
 
     if (HaveTLMIntrPorts) {
-      fprintf(output, "#include \"ac_tlm_intr_port.H\"\n");
+      fprintf(output, "#include \"%s.H\"\n", TLM_INTR_PORT_CLASS);
       fprintf(output, "#include \"%s_intr_handlers.H\"\n", project_name);
     }
 
@@ -1567,6 +2234,24 @@ int main(int argc, char** argv) {
       fprintf( output, "#include \"ac_gdb.H\"\n");
     }
 
+    if(ACBlockCacheFlag)
+      fprintf( output, "#include <map>\n");
+
+    if(ACMultiCoreFlag)
+      fprintf( output, "#include \"ac_quantum.H\"\n");
+
+    if(ACCheckpointFlag)
+      fprintf( output, "#include \"ac_checkpoint.H\"\n");
+
+    if(ACGuardMemoryFlag)
+      fprintf( output, "#include \"ac_guard.H\"\n");
+
+    if(ACDecCacheFlag)
+      fprintf( output, "#include \"ac_host_place.H\"\n");
+
+    if(HaveDecStats())
+      fprintf( output, "#include \"ac_dec_stats.H\"\n");
+
     fprintf(output, "\n\n");
 
     fprintf(output, "class %s: public ac_module, public %s_arch", project_name, project_name);
@@ -1574,18 +2259,95 @@ int main(int argc, char** argv) {
     if (ACGDBIntegrationFlag)
       fprintf(output, ", public AC_GDB_Interface<%s_parms::ac_word>", project_name);
 
+    if (ACDecInvalidateFlag)
+      fprintf(output, ", public ac_code_listener");
+
     fprintf(output, " {\n");
 
     fprintf(output, "private:\n");
-    fprintf(output, "%stypedef cache_item<%s_parms::AC_DEC_FIELD_NUMBER> cache_item_t;\n", INDENT[1], project_name);
+    if(ACFormatStructsFlag)
+      EmitFormatStructs(output, 1);
+    else
+      fprintf(output, "%stypedef cache_item<%s_parms::AC_DEC_FIELD_NUMBER> cache_item_t;\n", INDENT[1], project_name);
     fprintf(output, "%stypedef ac_instr<%s_parms::AC_DEC_FIELD_NUMBER> ac_instr_t;\n", INDENT[1], project_name);
 
+    if(ACBlockCacheFlag){
+      fprintf(output, "\n");
+      COMMENT(INDENT[1], "Decoded instructions executed in sequence, recorded the first time they run.");
+      fprintf(output, "%sstruct ac_block_t {\n", INDENT[1]);
+      fprintf(output, "%sunsigned size; \t //!< Number of instructions in the block.\n", INDENT[2]);
+      fprintf(output, "%sunsigned pc[%s_parms::AC_BLOCK_MAX_SIZE]; \t //!< Address of each instruction.\n", INDENT[2], project_name);
+      fprintf(output, "%scache_item_t* instr[%s_parms::AC_BLOCK_MAX_SIZE]; \t //!< Decode cache entry of each instruction.\n", INDENT[2], project_name);
+      fprintf(output, "%sac_block_t* succ; \t //!< Last block that ran after this one.\n", INDENT[2]);
+      if(ACJITFlag){
+        fprintf(output, "#ifdef AC_JIT\n");
+        fprintf(output, "%sunsigned hits; \t //!< Executions before translation.\n", INDENT[2]);
+        fprintf(output, "%svoid (*code)(%s*); \t //!< Translated code, or NULL.\n", INDENT[2], project_name);
+        fprintf(output, "#endif\n");
+      }
+      fprintf(output, "%s};\n\n", INDENT[1]);
+      fprintf(output, "%sstd::map<unsigned, ac_block_t*> ac_blocks; \t //!< Closed blocks, by start address.\n", INDENT[1]);
+      fprintf(output, "%sac_block_t* ac_block_last; \t //!< Last closed block executed, used for chaining.\n", INDENT[1]);
+      fprintf(output, "%sac_block_t* ac_block_rec; \t //!< Block being recorded.\n", INDENT[1]);
+      fprintf(output, "%sunsigned ac_block_delay; \t //!< Instructions left before the recorded block is closed.\n", INDENT[1]);
+      if(ACDecInvalidateFlag)
+        fprintf(output, "%sbool ac_block_flush; \t //!< Blocks must be dropped, a code page was written.\n", INDENT[1]);
+      fprintf(output, "\n");
+      fprintf(output, "%sac_block_t* ac_block_find(unsigned pc);\n", INDENT[1]);
+      fprintf(output, "%svoid ac_block_record(unsigned pc, cache_item_t* item, unsigned ins_id);\n", INDENT[1]);
+      fprintf(output, "%svoid ac_block_close();\n", INDENT[1]);
+    }
+
+    if(ACJITFlag)
+      EmitJITDecl(output);
+
+    if(ACAdaptiveBatchFlag){
+      fprintf(output, "\n");
+      fprintf(output, "%sunsigned ac_batch_transactions; \t //!< Port transactions seen at the end of the last batch.\n\n", INDENT[1]);
+      COMMENT(INDENT[1], "Tells whether any TLM or interrupt port was used during the batch just finished.");
+      fprintf(output, "%sbool ac_batch_busy() {\n", INDENT[1]);
+      fprintf(output, "%sunsigned n = 0", INDENT[2]);
+      for (pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next)
+        if (pstorage->type == TLM_PORT)
+          fprintf(output, " + %s_port.transactions", pstorage->name);
+      for (pport = tlm_intr_port_list; pport != NULL; pport = pport->next)
+        fprintf(output, " + %s.transactions", pport->name);
+      fprintf(output, ";\n");
+      fprintf(output, "%sbool busy = (n != ac_batch_transactions);\n", INDENT[2]);
+      fprintf(output, "%sac_batch_transactions = n;\n", INDENT[2]);
+      fprintf(output, "%sreturn busy;\n", INDENT[2]);
+      fprintf(output, "%s}\n", INDENT[1]);
+    }
+
+    if(ACIntrDeferFlag){
+      fprintf(output, "\n");
+      fprintf(output, "%sbool ac_intr_pending; \t //!< Some interrupt port holds interrupts not taken yet.\n\n", INDENT[1]);
+      COMMENT(INDENT[1], "Runs the handlers of the interrupts the ports hold.");
+      fprintf(output, "%svoid ac_intr_deliver() {\n", INDENT[1]);
+      fprintf(output, "%sac_intr_pending = false;\n", INDENT[2]);
+      for (pport = tlm_intr_port_list; pport != NULL; pport = pport->next)
+        fprintf(output, "%s%s.deliver();\n", INDENT[2], pport->name);
+      fprintf(output, "%s}\n", INDENT[1]);
+    }
+
+    if(ACTemporalDecouplingFlag){
+      fprintf(output, "\n");
+      COMMENT(INDENT[1], "Takes the delays the TLM targets answered with since the last call.");
+      fprintf(output, "%ssc_time ac_port_delays() {\n", INDENT[1]);
+      fprintf(output, "%ssc_time delays = SC_ZERO_TIME;\n", INDENT[2]);
+      for (pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next)
+        if (pstorage->type == TLM_PORT) {
+          fprintf(output, "%sdelays += %s_port.delays;\n", INDENT[2], pstorage->name);
+          fprintf(output, "%s%s_port.delays = SC_ZERO_TIME;\n", INDENT[2], pstorage->name);
+        }
+      fprintf(output, "%sreturn delays;\n", INDENT[2]);
+      fprintf(output, "%s}\n", INDENT[1]);
+    }
+
     fprintf( output, "public:\n\n");
 
     fprintf( output, "%sunsigned bhv_pc;\n", INDENT[1]);
 
-    if( HaveMultiCycleIns)
-      fprintf( output, "%ssc_signal<unsigned> bhv_cycle;\n", INDENT[1]);
 
     fprintf( output, " \n");
 
@@ -1604,18 +2366,39 @@ int main(int argc, char** argv) {
     if (HaveTLMIntrPorts) {
       for (pport = tlm_intr_port_list; pport != NULL; pport = pport->next) {
 	fprintf(output, "%s%s_%s_handler %s_hnd;\n", INDENT[1], project_name, pport->name, pport->name);
-	fprintf(output, "%sac_tlm_intr_port %s;\n\n", INDENT[1], pport->name);
+	fprintf(output, "%s%s %s;\n\n", INDENT[1], TLM_INTR_PORT_CLASS, pport->name);
       }
     }
 
-    if(ACDecCacheFlag){
+    if(ACSparseDecCacheFlag){
+      fprintf( output, "%scache_item_t** DEC_CACHE;\n", INDENT[1]);
+      fprintf( output, "%sunsigned dec_cache_pages;\n\n", INDENT[1]);
+    }
+    else if(ACDecCacheFlag){
       fprintf( output, "%scache_item_t* DEC_CACHE;\n\n", INDENT[1]);
     }
+    if(HaveDecStats())
+      fprintf( output, "%sac_dec_stats dec_stats; \t //!< Use of the decode cache and of the block cache.\n\n", INDENT[1]);
 
     fprintf( output, "%sunsigned id;\n\n", INDENT[1]);
     fprintf( output, "%sbool start_up;\n", INDENT[1]);
     fprintf( output, "%sunsigned* instr_dec;\n", INDENT[1]);
-    fprintf( output, "%sac_instr_t* instr_vec;\n\n", INDENT[1]);
+    fprintf( output, "%sac_instr_t* instr_vec;\n", INDENT[1]);
+    if( !ACDecCacheFlag )
+      fprintf( output, "%sac_instr_t instr_slot; \t //!< Decoded instruction, reused when there is no decode cache.\n", INDENT[1]);
+    fprintf( output, "\n");
+
+    if (ACMultiCoreFlag)
+      fprintf( output, "%sac_quantum_barrier* ac_quantum; \t //!< Barrier met at the end of each batch when running on a host thread.\n\n", INDENT[1]);
+
+    if (ACCheckpointFlag) {
+      fprintf( output, "%sunsigned long long ac_checkpoint_at; \t //!< Instruction count at which a checkpoint is saved.\n", INDENT[1]);
+      fprintf( output, "%sconst char* ac_checkpoint_file; \t //!< File the checkpoint is saved to.\n\n", INDENT[1]);
+      COMMENT(INDENT[1], "Checkpoint methods. Restoring needs the application loaded by --load.");
+      fprintf( output, "%sbool save_checkpoint(const char* path);\n", INDENT[1]);
+      fprintf( output, "%sbool restore_checkpoint(const char* path);\n", INDENT[1]);
+      fprintf( output, "%svoid ac_checkpoint_now();\n\n", INDENT[1]);
+    }
 
     if (ACGDBIntegrationFlag)
       fprintf(output, "%sAC_GDB<%s_parms::ac_word>* gdbstub;\n\n", INDENT[1], project_name);
@@ -1635,7 +2418,10 @@ int main(int argc, char** argv) {
 
     //!Declaring ARCH Constructor.
     COMMENT(INDENT[1], "Constructor.");
-    fprintf( output, "%s%s( sc_module_name name_ ): ac_module(name_), %s_arch(), ISA(*this)", INDENT[1], project_name, project_name);
+    if (ACMultiCoreFlag)
+      fprintf( output, "%s%s( sc_module_name name_, %s_arch* shared = 0 ): ac_module(name_), %s_arch(shared), ISA(*this)", INDENT[1], project_name, project_name, project_name);
+    else
+      fprintf( output, "%s%s( sc_module_name name_ ): ac_module(name_), %s_arch(), ISA(*this)", INDENT[1], project_name, project_name);
     /*if (ACABIFlag)
       fprintf(output, ", syscall(*this)");*/
 
@@ -1662,17 +2448,129 @@ int main(int argc, char** argv) {
     fprintf( output, "%sstart_up=1;\n", INDENT[2]);
     fprintf( output, "%sid = %d;\n\n", INDENT[2], 1);
 
-    if (ACGDBIntegrationFlag)
-      fprintf(output, "%sgdbstub = new AC_GDB<%s_parms::ac_word>(this, %s_parms::GDB_PORT_NUM);\n\n", INDENT[2], project_name, project_name);
+    if(ACPreDecodeFlag || ACDecInvalidateFlag || HaveDecStats())
+      fprintf( output, "%sDEC_CACHE = 0;\n\n", INDENT[2]);
+
+    if(ACDecSnapshotFlag)
+      fprintf( output, "%sdec_snapshot = 0;\n\n", INDENT[2]);
+
+    if(ACMultiCoreFlag)
+      fprintf( output, "%sac_quantum = 0;\n\n", INDENT[2]);
+
+    if(ACCheckpointFlag){
+      fprintf( output, "%sac_checkpoint_at = (unsigned long long) -1;\n", INDENT[2]);
+      fprintf( output, "%sac_checkpoint_file = 0;\n\n", INDENT[2]);
+    }
+
+    if(ACTemporalDecouplingFlag)
+      fprintf( output, "%sset_global_quantum(sc_time(%s_parms::AC_TIME_QUANTUM_NS, SC_NS));\n\n", INDENT[2], project_name);
+
+    if(ACIntrDeferFlag){
+      fprintf( output, "%sac_intr_pending = false;\n", INDENT[2]);
+      for (pport = tlm_intr_port_list; pport != NULL; pport = pport->next)
+        fprintf( output, "%s%s.defer(&ac_intr_pending);\n", INDENT[2], pport->name);
+      fprintf( output, "\n");
+    }
+
+    //The ABI behavior loop sends jumps into lazy binding slots to the resolver
+    if(ACABIFlag && !stage_list && !pipe_list)
+      fprintf( output, "%sac_dyn_loader.allow_lazy();\n\n", INDENT[2]);
+
+    if(ACAdaptiveBatchFlag){
+      fprintf( output, "%sac_batch_transactions = 0;\n", INDENT[2]);
+      fprintf( output, "%sset_instr_batch_range(%s_parms::AC_INSTR_BATCH_MIN, %s_parms::AC_INSTR_BATCH_MAX);\n\n", INDENT[2], project_name, project_name);
+    }
+
+    if(ACBlockCacheFlag){
+      fprintf( output, "%sac_block_last = 0;\n", INDENT[2]);
+      fprintf( output, "%sac_block_rec = 0;\n", INDENT[2]);
+      fprintf( output, "%sac_block_delay = 0;\n", INDENT[2]);
+      if(ACDecInvalidateFlag)
+        fprintf( output, "%sac_block_flush = 0;\n", INDENT[2]);
+      fprintf( output, "\n");
+    }
+
+    if(ACJITFlag){
+      fprintf( output, "#ifdef AC_JIT\n");
+      fprintf( output, "%sac_jit_buf = 0;\n", INDENT[2]);
+      fprintf( output, "%sac_jit_used = 0;\n", INDENT[2]);
+      fprintf( output, "#endif\n\n");
+    }
+
+    if(ACDecInvalidateFlag)
+      fprintf( output, "%sIM->watch_code(this, %s_parms::AC_CODE_PAGE_BITS);\n\n", INDENT[2], project_name);
+
+    if (ACGDBIntegrationFlag) {
+      fprintf(output, "%sgdbstub = new AC_GDB<%s_parms::ac_word>(this, %s_parms::GDB_PORT_NUM);\n", INDENT[2], project_name, project_name);
+      //Watchpoints are checked in every memory port.
+      for (pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next)
+        if (pstorage->type != REG && pstorage->type != REGBANK &&
+            (!HaveMemHier || pstorage->type == TLM_PORT))
+          fprintf(output, "%s%s.watch_data(gdbstub);\n", INDENT[2], pstorage->name);
+      fprintf(output, "\n");
+    }
 
     fprintf( output, "%s}\n", INDENT[1]);  //end constructor
 
-    if(ACDecCacheFlag){
+    if(ACSparseDecCacheFlag){
+      //Only the page directory is allocated up front. Pages come in on their first fetch.
+      fprintf( output, "%svoid init_dec_cache() {\n", INDENT[1]);
+      fprintf( output, "%sdec_cache_pages = (dec_cache_size >> %s_parms::AC_DEC_CACHE_PAGE_BITS) + 1;\n", INDENT[2], project_name);
+      fprintf( output, "%sDEC_CACHE = (cache_item_t**) calloc(sizeof(cache_item_t*),dec_cache_pages);\n", INDENT[2]);
+      fprintf( output, "%s}\n\n", INDENT[1]);  //end init_dec_cache
+
+      COMMENT(INDENT[1], "Returns the decode cache slot for an address, allocating its page on the first fetch.");
+      fprintf( output, "%sinline cache_item_t* dec_cache_slot(unsigned addr) {\n", INDENT[1]);
+      fprintf( output, "%scache_item_t*& page = DEC_CACHE[addr >> %s_parms::AC_DEC_CACHE_PAGE_BITS];\n", INDENT[2], project_name);
+      fprintf( output, "%sif( !page ) {\n", INDENT[2]);
+      fprintf( output, "%spage = (cache_item_t*) calloc(sizeof(cache_item_t), %s_parms::AC_DEC_CACHE_PAGE_SLOTS);\n", INDENT[3], project_name);
+      if(HaveDecStats())
+        fprintf( output, "%sdec_stats.pages++;\n", INDENT[3]);
+      fprintf( output, "%s}\n", INDENT[2]);
+      fprintf( output, "%sreturn page + ((addr & %s_parms::AC_DEC_CACHE_PAGE_MASK) >> %s_parms::AC_DEC_CACHE_SLOT_SHIFT);\n", INDENT[2], project_name, project_name);
+      fprintf( output, "%s}\n", INDENT[1]);
+    }
+    else if(ACDecCacheFlag && ACGuardMemoryFlag){
+      //Every fetch address has a slot; those past dec_cache_size trap.
+      fprintf( output, "%svoid init_dec_cache() {\n", INDENT[1]);
+      fprintf( output, "%sDEC_CACHE = (cache_item_t*) ac_guard_reserve(sizeof(cache_item_t), (uint64_t) dec_cache_size * sizeof(cache_item_t), \"decode cache\");\n", INDENT[2]);
+      fprintf( output, "%sif( !DEC_CACHE ) {\n", INDENT[2]);
+      fprintf( output, "%scerr << \"ArchC: Could not reserve the address space of the decode cache for --guard-memory.\" << endl;\n", INDENT[3]);
+      fprintf( output, "%sexit(EXIT_FAILURE);\n", INDENT[3]);
+      fprintf( output, "%s}\n", INDENT[2]);
+      fprintf( output, "%sac_host_advise(DEC_CACHE, (size_t) dec_cache_size * sizeof(cache_item_t), ac_host_hugepages() != AC_HOST_PAGES_SMALL);\n", INDENT[2]);
+      fprintf( output, "%s}\n", INDENT[1]);  //end init_dec_cache
+    }
+    else if(ACDecCacheFlag){
+      //Placed on the node of the simulation, in huge pages if asked for
       fprintf( output, "%svoid init_dec_cache() {\n", INDENT[1]);  //end constructor
-      fprintf( output, "%sDEC_CACHE = (cache_item_t*) calloc(sizeof(cache_item_t),dec_cache_size);\n", INDENT[2]);  //end constructor
+      fprintf( output, "%sDEC_CACHE = (cache_item_t*) ac_host_alloc((size_t) sizeof(cache_item_t) * dec_cache_size);\n", INDENT[2]);  //end constructor
       fprintf( output, "%s}\n", INDENT[1]);  //end init_dec_cache
     }
 
+    if(ACFormatStructsFlag)
+      EmitFormatFill(output, 1);
+
+    if(ACDecInvalidateFlag){
+      fprintf( output, "\n");
+      COMMENT(INDENT[1], "Invalidates the decode cache entries of a code page that was written.");
+      fprintf( output, "%svoid code_written(uint32_t page);\n", INDENT[1]);
+    }
+
+    if(ACPreDecodeFlag){
+      fprintf( output, "\n");
+      COMMENT(INDENT[1], "Decodes the program text into the decode cache, split across host threads.");
+      fprintf( output, "%svoid pre_decode();\n", INDENT[1]);
+      fprintf( output, "%svoid pre_decode_range(unsigned start, unsigned end);\n", INDENT[1]);
+      fprintf( output, "%sstatic void* pre_decode_thread(void* arg);\n", INDENT[1]);
+      if(ACDecSnapshotFlag){
+        fprintf( output, "%sconst unsigned* dec_snapshot; \t //!< Mapped snapshot records, if one matched.\n", INDENT[1]);
+        fprintf( output, "%sunsigned* dec_snapshot_out; \t //!< Records being built for a new snapshot.\n", INDENT[1]);
+        fprintf( output, "%sunsigned dec_snapshot_base; \t //!< Address of the first record.\n", INDENT[1]);
+        fprintf( output, "%sconst unsigned* dec_snapshot_end; \t //!< End of the mapped records.\n", INDENT[1]);
+      }
+    }
+
     if(ACGDBIntegrationFlag) {
       fprintf( output, "%s/***********\n", INDENT[1]);
       fprintf( output, "%s * GDB Support - user supplied methods\n", INDENT[1]);
@@ -1691,6 +2589,8 @@ int main(int argc, char** argv) {
       fprintf( output, "%s/* Memory access */\n", INDENT[1]);
       fprintf( output, "%sunsigned char mem_read( unsigned int address );\n", INDENT[1]);
       fprintf( output, "%svoid mem_write( unsigned int address, unsigned char byte );\n", INDENT[1]);
+      fprintf( output, "%svoid mem_read_block( unsigned int address, unsigned char* buf, unsigned int size );\n", INDENT[1]);
+      fprintf( output, "%svoid mem_write_block( unsigned int address, const unsigned char* buf, unsigned int size );\n", INDENT[1]);
 
       fprintf( output, "%s/* GDB stub access */\n", INDENT[1]);
       fprintf( output, "%sAC_GDB<%s_parms::ac_word>* get_gdbstub();\n", INDENT[1], project_name);
@@ -1717,7 +2617,7 @@ int main(int argc, char** argv) {
     fprintf( output,"%s};\n", INDENT[0] );
     fprintf( output, "#endif  //_%s_H\n\n", upper_project_name);
 
-    fclose( output);
+    close_output( output, filename);
   }
 
   //!Creates Formatted Registers Header File
@@ -1743,7 +2643,7 @@ void CreateRegsHeader() {
     if(( pstorage->type == REG ) && (pstorage->format != NULL )){
 
       if(flag){  //Print this just once.
-        if ( !(output = fopen( filename, "w"))){
+        if ( !(output = open_output( filename))){
           perror("ArchC could not open output file");
           exit(1);
         }
@@ -1825,7 +2725,7 @@ void CreateRegsHeader() {
 
   if(!flag){ //We had at last one formatted reg declared.
     fprintf( output, "#endif // %s_FMT_REGS_H\n", upper_project_name);
-    fclose(output);
+    close_output( output, filename);
   }
 }
 
@@ -1846,7 +2746,7 @@ void CreateStatsHeaderTmpl(void){
 
   sprintf(filename, "%s_stats.H.tmpl", project_name);
 
-  if ( !(output = fopen( filename, "w"))){
+  if ( !(output = open_output( filename))){
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -1873,6 +2773,11 @@ void CreateStatsHeaderTmpl(void){
   // Declaring processor stats collector object
   fprintf(output, "%s%s_stats stats;\n\n", INDENT[1], project_name);
 
+  // Declaring the instruction stats, one row for each instruction id
+  fprintf(output,
+      "%slong long instr_counts[%s_parms::AC_DEC_INSTR_NUMBER + 1][%s_instr_stat_ids::END_OF_STATS];\n\n",
+      INDENT[1], project_name, project_name);
+
   // Declaring instruction stats collector objects
   for (pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next) {
     fprintf(output, "%s%s_instr_stats %s_istats;\n",
@@ -1894,7 +2799,7 @@ void CreateStatsHeaderTmpl(void){
 
   //END OF FILE!
   fprintf(output, "#endif // %s_STATS_H\n", upper_project_name);
-  fclose(output);
+  close_output( output, filename);
 }
 
 //!Create the implementation file for ArchC statistics collection class.
@@ -1911,7 +2816,7 @@ void CreateStatsImplTmpl()
 
   sprintf(filename, "%s_stats.cpp.tmpl", project_name);
 
-  if ( !(output = fopen( filename, "w"))){
+  if ( !(output = open_output( filename))){
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -1932,9 +2837,10 @@ void CreateStatsImplTmpl()
   fprintf(output, "%s_all_stats::%s_all_stats() :\n", project_name,
       project_name);
   fprintf(output, "%sstats(\"%s\")\n", INDENT[1], project_name);
+  fprintf(output, "%s, instr_counts()\n", INDENT[1]);
   for (pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next) {
-    fprintf(output, "%s, %s_istats(\"%s\", stats)\n",
-	INDENT[1], pinstr->name, pinstr->name);
+    fprintf(output, "%s, %s_istats(\"%s\", stats, instr_counts[%d])\n",
+	INDENT[1], pinstr->name, pinstr->name, pinstr->id);
   }
   fprintf(output, "{\n");
 
@@ -1947,7 +2853,7 @@ void CreateStatsImplTmpl()
   fprintf(output, "}\n");
 
   //END OF FILE!
-  fclose(output);
+  close_output( output, filename);
 }
 
 /////////////////////////// Create Implementation Functions ////////////////////////////
@@ -1976,7 +2882,7 @@ void CreateStgImpl(ac_stg_list* stage_list, char* pipe_name) {
       sprintf( stage_filename, "%s.cpp", pstage->name);
     }
 
-    if ( !(output = fopen( stage_filename, "w"))){
+    if ( !(output = open_output( stage_filename))){
       perror("ArchC could not open output file");
       exit(1);
     }
@@ -1994,7 +2900,8 @@ void CreateStgImpl(ac_stg_list* stage_list, char* pipe_name) {
 
     if( pstage->id == 1 && ACVerifyFlag ){
       fprintf( output, "#include  \"ac_msgbuf.H\"\n");
-      fprintf( output, "#include  \"sys/msg.h\"\n");
+      fprintf( output, "#include  \"ac_verify_ring.H\"\n");
+      fprintf( output, "#include  \"ac_verify_digest.H\"\n");
     }
 
 
@@ -2009,7 +2916,8 @@ void CreateStgImpl(ac_stg_list* stage_list, char* pipe_name) {
       fprintf( output, "%sac_instruction *instr, *format;\n", INDENT[1]);
       fprintf( output, "%sunsigned ins_id;\n", INDENT[1]);
       fprintf( output, "%sac_instr *instr_vec;\n\n", INDENT[1]);
-      fprintf( output, "%sinstr_vec = new ac_instr(regin.read());\n\n", INDENT[1]);
+      fprintf( output, "%sinstr_slot = regin.read();\n", INDENT[1]);
+      fprintf( output, "%sinstr_vec = &instr_slot;\n\n", INDENT[1]);
       fprintf( output, "%sins_id = instr_vec->get(IDENT);\n", INDENT[1]);
 
       fprintf( output, "%sif( ins_id != 0 ) {\n", INDENT[1]);
@@ -2025,7 +2933,6 @@ void CreateStgImpl(ac_stg_list* stage_list, char* pipe_name) {
       if( pstage->id != stage_num)
         fprintf( output, "%sregout.write( *instr_vec);\n", INDENT[1]);
 
-      fprintf( output, "%sdelete instr_vec;\n", INDENT[1]);
       fprintf( output, "%sbhv_done.write(1);\n", INDENT[1]);
       fprintf( output, "}\n\n");
     }
@@ -2052,7 +2959,7 @@ void CreateStgImpl(ac_stg_list* stage_list, char* pipe_name) {
       }			
 			
       if( ACVerifyFlag ){
-        fprintf( output, "%sextern int msqid;\n", INDENT[1]);
+        fprintf( output, "%sextern ac_verify_ring ac_vring;\n", INDENT[1]);
         fprintf( output, "%sstruct log_msgbuf end_log;\n", INDENT[1]);
       }
 
@@ -2106,7 +3013,7 @@ void CreateStgImpl(ac_stg_list* stage_list, char* pipe_name) {
       fprintf( output, "}\n\n");
     }
 
-    fclose(output);
+    close_output( output, stage_filename);
     free(stage_filename);
   }
 }
@@ -2122,9 +3029,11 @@ void CreateProcessorImpl() {
   extern int stage_num;
   extern int HaveMultiCycleIns, HaveMemHier;
   extern int ACGDBIntegrationFlag;
+  extern ac_dec_instr *instr_list;
   ac_sto_list *pstorage;
   ac_stg_list *pstage;
   ac_pipe_list *ppipe;
+  ac_dec_instr *pinstr;
   int i;
 
   char* filename;
@@ -2133,7 +3042,7 @@ void CreateProcessorImpl() {
   filename = (char*) malloc(strlen(project_name)+strlen(".cpp")+1);
   sprintf( filename, "%s.cpp", project_name);
 
-  if ( !(output = fopen( filename, "w"))){
+  if ( !(output = open_output( filename))){
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -2142,15 +3051,57 @@ void CreateProcessorImpl() {
   fprintf( output, "#include  \"%s.H\"\n", project_name);
   fprintf( output, "#include  \"%s_isa.cpp\"\n\n", project_name);
 
-  if( ACVerifyFlag ){
+  if( ACHostProfileFlag )
+    fprintf( output, "#include  \"ac_host_profile.H\"\n\n");
+
+  if( ACInstrTraceFlag )
+    fprintf( output, "#include  \"ac_instr_trace.H\"\n\n");
+
+  if( ACSyncRegDirtyFlag )
+    fprintf( output, "#include  \"ac_sync_reg.H\"\n\n");
+
+  if( ACPluginsFlag ){
+    fprintf( output, "#include  \"ac_plugin.H\"\n\n");
+    COMMENT(INDENT[0], "Instructions declared with is_jump/is_branch, reported to the branch hooks, by instruction ID.");
+    fprintf( output, "static const bool ac_plugin_branches[] = { false");
+    for( pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next)
+      fprintf( output, ", %s", pinstr->cflow ? "true" : "false");
+    fprintf( output, " };\n\n");
+  }
+
+  if( !stage_list && !pipe_list ){
+    fprintf( output, "#include  \"ac_sighandlers.H\"\n");
+    fprintf( output, "#include  \"ac_stats_snapshot.H\"\n\n");
+  }
+
+  if( ACJITFlag ){
+    fprintf( output, "#ifdef AC_JIT\n");
+    fprintf( output, "#include  <sys/mman.h>\n");
+    fprintf( output, "#include  \"ac_hot_profile.H\"\n");
+    fprintf( output, "#endif\n\n");
+  }
+
+  if( ACPreDecodeFlag ){
+    fprintf( output, "#include  <pthread.h>\n");
+    fprintf( output, "#include  <unistd.h>\n");
+    if( ACDecSnapshotFlag )
+      fprintf( output, "#include  \"ac_dec_snapshot.H\"\n");
+    fprintf( output, "\n");
+  }
+
+  if( ACVerifyFlag ){
     fprintf( output, "#include  \"ac_msgbuf.H\"\n");
-    fprintf( output, "#include  \"sys/msg.h\"\n");
+    fprintf( output, "#include  \"ac_verify_ring.H\"\n");
+    fprintf( output, "#include  \"ac_verify_digest.H\"\n");
   }
 
   if( ACABIFlag )
     fprintf( output, "#include  \"%s_syscall.H\"\n\n", project_name);
 		
   fprintf( output, "void %s::behavior() {\n\n", project_name);
+  //The locals hide the members, which are only stored where other code reads them.
+  if( ACRegLocalsFlag )
+    fprintf( output, "%sunsigned decode_pc = this->decode_pc, bhv_pc = this->bhv_pc;\n", INDENT[1]);
   if( ACDebugFlag ){
     fprintf( output, "%sextern bool ac_do_trace;\n", INDENT[1]);
     fprintf( output, "%sextern ofstream trace_file;\n", INDENT[1]);
@@ -2158,15 +3109,23 @@ void CreateProcessorImpl() {
   fprintf( output, "%sunsigned ins_id;\n", INDENT[1]);
 
   if( ACVerifyFlag ){
-    fprintf( output, "%sextern int msqid;\n", INDENT[1]);
+    fprintf( output, "%sextern ac_verify_ring ac_vring;\n", INDENT[1]);
     fprintf( output, "%sstruct log_msgbuf end_log;\n", INDENT[1]);
   }
+
+  if( ACThreadedDispatchFlag )
+    EmitDispatchTable(output, 1);
 /*   if( ACABIFlag ) */
 /*     fprintf( output, "%s%s_syscall syscall;\n", INDENT[1], project_name); */
 
   if(ACDecCacheFlag)
     fprintf( output, "%scache_item_t* ins_cache;\n", INDENT[1]);
 
+  if(ACBlockCacheFlag){
+    fprintf( output, "%sac_block_t* blk;\n", INDENT[1]);
+    fprintf( output, "%sunsigned blk_pos;\n", INDENT[1]);
+  }
+
 /*   if( ac_host_endian == 0 ){ */
 /*     fprintf( output, "%schar fetch[AC_WORDSIZE/8];\n\n", INDENT[1]); */
 /*   } */
@@ -2174,6 +3133,8 @@ void CreateProcessorImpl() {
   /* Delayed program loading */
   fprintf(output, "%sif (has_delayed_load) {\n", INDENT[1]);
   fprintf(output, "%sAPP_MEM->load(delayed_load_program);\n", INDENT[2]);
+  if( ACPreDecodeFlag )
+    fprintf(output, "%spre_decode();\n", INDENT[2]);
   fprintf(output, "%sac_pc = ac_start_addr;\n", INDENT[2]);
   fprintf(output, "%shas_delayed_load = false;\n", INDENT[2]);
   fprintf(output, "%s}\n\n", INDENT[1]);
@@ -2184,15 +3145,13 @@ void CreateProcessorImpl() {
     fprintf( output, "%s}\n\n", INDENT[1]);
   }
 
-  //Emiting processor behavior method implementation.
-  if( HaveMultiCycleIns )
-    EmitMultiCycleProcessorBhv(output);
-  else{
-    if( ACABIFlag )
-      EmitProcessorBhv_ABI(output);
-    else
-      EmitProcessorBhv(output);
-  }
+  //Emiting processor behavior method implementation. Multicycle
+  //instructions run their behaviors once, like single-cycle ones, and the
+  //update method adds their whole latency to the cycle counter at once.
+  if( ACABIFlag )
+    EmitProcessorBhv_ABI(output);
+  else
+    EmitProcessorBhv(output);
 
   //!Emit update method.
   if( stage_list )
@@ -2211,10 +3170,9 @@ void CreateProcessorImpl() {
 
     if( ACVerifyFlag ){
 
-      fprintf( output, "extern int msqid;\n");
+      fprintf( output, "extern ac_verify_ring ac_vring;\n");
+      fprintf( output, "extern ac_verify_digest ac_vdigest;\n");
       fprintf( output, "struct log_msgbuf lbuf;\n");
-      fprintf( output, "log_list::iterator itor;\n");
-      fprintf( output, "log_list *plog;\n");
     }
     fprintf( output, " \n");
 
@@ -2262,7 +3220,7 @@ void CreateProcessorImpl() {
 
       int next_type = 3;
 
-      fprintf( output, "%sif( sc_simulation_time() ){\n", INDENT[3]);
+      fprintf( output, "%sif( sc_simulation_time() && !ac_vdigest.enabled ){\n", INDENT[3]);
 
       //Sending logs for every storage device. We just consider for co-verification caches, regbanks and memories
       for( pstorage = storage_list; pstorage != NULL; pstorage=pstorage->next){
@@ -2273,23 +3231,24 @@ void CreateProcessorImpl() {
             pstorage->type == CACHE ||
             pstorage->type == REGBANK ){
 
-          fprintf( output, "%splog = %s.get_changes();\n", INDENT[4],pstorage->name );
-          fprintf( output, "%sif( plog->size()){\n", INDENT[4] );
-          fprintf( output, "%sitor = plog->begin();\n", INDENT[5] );
+          //The log is cleared once sent, so it keeps its memory for the next step
+          fprintf( output, "%sif( %s.get_changes()->size()){\n", INDENT[4],pstorage->name );
           fprintf( output, "%slbuf.mtype = %d;\n", INDENT[5], next_type );
-          fprintf( output, "%swhile( itor != plog->end()){\n\n", INDENT[5] );
-          fprintf( output, "%slbuf.log = *itor;\n", INDENT[6] );
-          fprintf( output, "%sif( msgsnd(msqid, (struct log_msgbuf *)&lbuf, sizeof(lbuf), 0) == -1)\n", INDENT[6] );
-          fprintf( output, "%sperror(\"msgsnd\");\n", INDENT[7] );
-          fprintf( output, "%sitor = plog->erase(itor);\n", INDENT[6] );
+          fprintf( output, "%sfor( unsigned i = 0; i < %s.get_changes()->size(); i++){\n\n", INDENT[5],pstorage->name );
+          fprintf( output, "%slbuf.log = (*%s.get_changes())[i];\n", INDENT[6],pstorage->name );
+          fprintf( output, "%sac_vring.send(&lbuf, sizeof(lbuf));\n", INDENT[6] );
           fprintf( output, "%s}\n", INDENT[5] );
+          fprintf( output, "%s%s.get_changes()->clear();\n", INDENT[5],pstorage->name );
           fprintf( output, "%s}\n\n", INDENT[4] );
 
           next_type++;
         }
       }
-      fprintf( output, "%s}\n\n", INDENT[3] );
+      //One publish per cycle instead of one per log
+      fprintf( output, "%sac_vring.flush();\n", INDENT[4] );
+      fprintf( output, "%s}\n", INDENT[3] );
 
+      EmitVerifyDigest(output);
     }
     for( pstorage = storage_list; pstorage != NULL; pstorage=pstorage->next){
       //fprintf( output, "%s%s.change_save();\n", INDENT[3],pstorage->name );
@@ -2324,6 +3283,21 @@ void CreateProcessorImpl() {
     fprintf( output, "%s}\n\n", INDENT[0]);
   }
 
+  if( ACBlockCacheFlag )
+    EmitBlockCacheImpl(output);
+
+  if( ACPreDecodeFlag )
+    EmitPreDecodeImpl(output);
+
+  if( ACDecInvalidateFlag )
+    EmitCodeWrittenImpl(output);
+
+  if( ACJITFlag )
+    EmitJITImpl(output);
+
+  if( ACCheckpointFlag )
+    EmitCheckpointImpl(output);
+
   /* SIGNAL HANDLERS */
   fprintf(output, "#include <ac_sighandlers.H>\n\n");
 
@@ -2333,7 +3307,7 @@ void CreateProcessorImpl() {
           project_name);
   fprintf(output, "%sset_args(ac_argc, ac_argv);\n", INDENT[1]);
   fprintf(output, "#ifdef AC_VERIFY\n");
-  fprintf(output, "%sset_queue(av[0]);\n", INDENT[1]);
+  fprintf(output, "%sset_queue(ac_argv[0]);\n", INDENT[1]);
   fprintf(output, "#endif\n\n");
   fprintf(output, "%sac_pc = ac_start_addr;\n", INDENT[1]);
   fprintf(output, "%sISA._behavior_begin();\n", INDENT[1]);
@@ -2344,6 +3318,11 @@ void CreateProcessorImpl() {
   fprintf(output, "%ssignal(SIGTERM, sigint_handler);\n", INDENT[1]);
   fprintf(output, "%ssignal(SIGSEGV, sigsegv_handler);\n", INDENT[1]);
   fprintf(output, "%ssignal(SIGUSR1, sigusr1_handler);\n", INDENT[1]);
+  if( ACGuardMemoryFlag ){
+    //Faults in the guarded regions are reported with the pc
+    fprintf(output, "%sac_guard_pc = &(const unsigned&) ac_pc;\n", INDENT[1]);
+    fprintf(output, "%sac_guard_signals();\n", INDENT[1]);
+  }
   fprintf(output, "#ifdef USE_GDB\n");
   fprintf(output, "%ssignal(SIGUSR2, sigusr2_handler);\n", INDENT[1]);
   fprintf(output, "#endif\n");
@@ -2362,6 +3341,8 @@ void CreateProcessorImpl() {
   fprintf(output, "%sac_init_opt( ac, av);\n", INDENT[1]);
   fprintf(output, "%sac_init_app( ac, av);\n", INDENT[1]);
   fprintf(output, "%sAPP_MEM->load(appfilename);\n", INDENT[1]);
+  if( ACPreDecodeFlag )
+    fprintf(output, "%spre_decode();\n", INDENT[1]);
   fprintf(output, "%sset_args(ac_argc, ac_argv);\n", INDENT[1]);
   fprintf(output, "#ifdef AC_VERIFY\n");
   fprintf(output, "%sset_queue(av[0]);\n", INDENT[1]);
@@ -2376,6 +3357,11 @@ void CreateProcessorImpl() {
   fprintf(output, "%ssignal(SIGTERM, sigint_handler);\n", INDENT[1]);
   fprintf(output, "%ssignal(SIGSEGV, sigsegv_handler);\n", INDENT[1]);
   fprintf(output, "%ssignal(SIGUSR1, sigusr1_handler);\n", INDENT[1]);
+  if( ACGuardMemoryFlag ){
+    //Faults in the guarded regions are reported with the pc
+    fprintf(output, "%sac_guard_pc = &(const unsigned&) ac_pc;\n", INDENT[1]);
+    fprintf(output, "%sac_guard_signals();\n", INDENT[1]);
+  }
   fprintf(output, "#ifdef USE_GDB\n");
   fprintf(output, "%ssignal(SIGUSR2, sigusr2_handler);\n", INDENT[1]);
   fprintf(output, "#endif\n");
@@ -2395,6 +3381,10 @@ void CreateProcessorImpl() {
   fprintf(output, "%sISA._behavior_end();\n", INDENT[1]);
   fprintf(output, "%sac_stop_flag = 1;\n", INDENT[1]);
   fprintf(output, "%sac_exit_status = status;\n", INDENT[1]);
+  if (ACMultiCoreFlag) {
+    fprintf(output, "%sif( ac_quantum )\n", INDENT[1]);
+    fprintf(output, "%sac_quantum->leave();\n", INDENT[2]);
+  }
   fprintf(output, "#ifndef AC_COMPSIM\n");
   fprintf(output, "%sset_stopped();\n", INDENT[1]);
   fprintf(output, "#endif\n");
@@ -2405,6 +3395,8 @@ void CreateProcessorImpl() {
   fprintf(output, "void %s::load(char* program) {\n",
           project_name);
   fprintf(output, "%sAPP_MEM->load(program);\n", INDENT[1]);
+  if( ACPreDecodeFlag )
+    fprintf(output, "%spre_decode();\n", INDENT[1]);
   fprintf(output, "}\n\n");
 
   /* delayed_load() */
@@ -2434,6 +3426,17 @@ void CreateProcessorImpl() {
     fprintf(output, "void %s::ac_stop() {\n", project_name);
     fprintf(output, "%sstop();\n", INDENT[1]);
     fprintf(output, "}\n\n");
+
+    /* mem_read_block() and mem_write_block() */
+    fprintf(output, "// Reads a block of memory for gdb at once\n");
+    fprintf(output, "void %s::mem_read_block(unsigned int address, unsigned char* buf, unsigned int size) {\n", project_name);
+    fprintf(output, "%sIM->read_block(address, buf, size);\n", INDENT[1]);
+    fprintf(output, "}\n\n");
+
+    fprintf(output, "// Writes a block of memory for gdb at once\n");
+    fprintf(output, "void %s::mem_write_block(unsigned int address, const unsigned char* buf, unsigned int size) {\n", project_name);
+    fprintf(output, "%sIM->write_block(address, buf, size);\n", INDENT[1]);
+    fprintf(output, "}\n\n");
   }
 
   /* get_ac_pc() */
@@ -2451,7 +3454,18 @@ void CreateProcessorImpl() {
   /* PrintStat() */
   fprintf(output, "// Wrapper function to PrintStat().\n");
   fprintf(output, "void %s::PrintStat() {\n", project_name);
-  fprintf(output, "%sac_arch<%s_parms::ac_word, %s_parms::ac_Hword>::PrintStat();\n", INDENT[1], project_name, project_name);
+  fprintf(output, "%sac_arch<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms>::PrintStat();\n", INDENT[1], project_name, project_name, project_name);
+  if (HaveMultiCycleIns)
+    fprintf(output, "%sfprintf(stderr, \"    Number of cycles: %%llu\\n\", ac_cycle_counter);\n", INDENT[1]);
+  if (HaveDecStats()) {
+    //Slots of a sparse cache are those of its pages; a flat one is all reserved.
+    fprintf(output, "%sac_dec_stats_print(dec_stats, ac_instr_counter,\n", INDENT[1]);
+    if (ACSparseDecCacheFlag)
+      fprintf(output, "%sDEC_CACHE ? dec_stats.pages * %s_parms::AC_DEC_CACHE_PAGE_SLOTS * sizeof(cache_item_t) + dec_cache_pages * sizeof(cache_item_t*) : 0,\n", INDENT[3], project_name);
+    else
+      fprintf(output, "%sDEC_CACHE ? (unsigned long long) dec_cache_size * sizeof(cache_item_t) : 0,\n", INDENT[3]);
+    fprintf(output, "%s%s, %s);\n", INDENT[3], ACFormatStructsFlag ? "0" : "sizeof(ac_instr_t)", ACBlockCacheFlag ? "true" : "false");
+  }
   fprintf(output, "}\n\n");
 
   /* GDB enable method */
@@ -2465,7 +3479,7 @@ void CreateProcessorImpl() {
   }
 
   //!END OF FILE.
-  fclose(output);
+  close_output( output, filename);
   free(filename);
 }
 
@@ -2492,7 +3506,7 @@ void CreateArchImpl() {
   sprintf(filename, "%s_arch.cpp", project_name);
 
   load_device= storage_list;
-  if ( !(output = fopen( filename, "w"))){
+  if ( !(output = open_output( filename))){
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -2504,17 +3518,21 @@ void CreateArchImpl() {
 
   if(ACVerifyFlag){
     fprintf( output, "#include  \"ac_msgbuf.H\"\n");
-    fprintf( output, "#include  <sys/ipc.h>\n");
-    fprintf( output, "#include  <unistd.h>\n");
-    fprintf( output, "#include  <sys/msg.h>\n");
-    fprintf( output, "#include  <sys/types.h>\n");
+    fprintf( output, "#include  \"ac_verify_ring.H\"\n");
+    fprintf( output, "#include  \"ac_verify_digest.H\"\n");
+    fprintf( output, "\n");
+    fprintf( output, "ac_verify_ring ac_vring;\n");
+    fprintf( output, "ac_verify_digest ac_vdigest;\n");
   }
 
   fprintf(output, "\n");
 
   /* Emitting Constructor */
-  fprintf(output, "%s%s_arch::%s_arch() :\n", INDENT[0], project_name, project_name);
-  fprintf(output, "%sac_arch_dec_if<%s_parms::ac_word, %s_parms::ac_Hword>(%s_parms::AC_MAX_BUFFER),\n", INDENT[1], project_name, project_name, project_name);
+  if( ACMultiCoreFlag )
+    fprintf(output, "%s%s_arch::%s_arch(%s_arch* shared) :\n", INDENT[0], project_name, project_name, project_name);
+  else
+    fprintf(output, "%s%s_arch::%s_arch() :\n", INDENT[0], project_name, project_name);
+  fprintf(output, "%sac_arch_dec_if<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms>(%s_parms::AC_MAX_BUFFER),\n", INDENT[1], project_name, project_name, project_name, project_name);
 
   /* Constructing ac_pc */
   fprintf(output, "%sac_pc(\"ac_pc\", 0", INDENT[1]);
@@ -2556,8 +3574,7 @@ void CreateArchImpl() {
     case DCACHE:
 
       if( !pstorage->parms ) { //It is a generic cache. Just emit a base container object.
-        fprintf(output, "%s%s_stg(\"%s_stg\", %uU),\n", INDENT[1], pstorage->name, pstorage->name, pstorage->size);
-        fprintf( output, "%s%s(*this, %s_stg)", INDENT[1], pstorage->name, pstorage->name);
+        EmitStorageInit(output, pstorage);
       }
       else{
         //It is an ac_cache object.
@@ -2568,13 +3585,11 @@ void CreateArchImpl() {
     case MEM:
 
       if( !HaveMemHier ) { //It is a generic cache. Just emit a base container object.
-        fprintf(output, "%s%s_stg(\"%s_stg\", %uU),\n", INDENT[1], pstorage->name, pstorage->name, pstorage->size);
-        fprintf( output, "%s%s(*this, %s_stg)", INDENT[1], pstorage->name, pstorage->name);
+        EmitStorageInit(output, pstorage);
       }
       else{
         //It is an ac_mem object.
-        fprintf(output, "%s%s_stg(\"%s_stg\", %uU),\n", INDENT[1], pstorage->name, pstorage->name, pstorage->size);
-        fprintf( output, "%s%s(*this, %s_stg)", INDENT[1], pstorage->name, pstorage->name);
+        EmitStorageInit(output, pstorage);
       }
       break;
 
@@ -2584,8 +3599,7 @@ void CreateArchImpl() {
       break;
 
     default:
-      fprintf(output, "%s%s_stg(\"%s_stg\", %uU),\n", INDENT[1], pstorage->name, pstorage->name, pstorage->size);
-      fprintf( output, "%s%s(*this, %s_stg)", INDENT[1], pstorage->name, pstorage->name);
+      EmitStorageInit(output, pstorage);
       break;
     }
     if (pstorage->next != NULL)
@@ -2642,6 +3656,39 @@ void CreateArchImpl() {
 
   fprintf( output, "}\n\n");
 
+  /* Announcing the verified devices to acverifier */
+  if( ACVerifyFlag ){
+    int ndevice = 0;
+
+    for( pstorage = storage_list; pstorage != NULL; pstorage=pstorage->next)
+      if( pstorage->type == MEM || pstorage->type == ICACHE || pstorage->type == DCACHE ||
+          pstorage->type == CACHE || pstorage->type == REGBANK )
+        ndevice++;
+
+    fprintf( output, "void %s_arch::set_queue(char *exec_name) {\n", project_name);
+    fprintf( output, "%sstruct start_msgbuf sbuf;\n", INDENT[1]);
+    fprintf( output, "%sstruct dev_msgbuf dbuf;\n\n", INDENT[1]);
+    fprintf( output, "%sif( !ac_vring.attach_env() ){\n", INDENT[1]);
+    fprintf( output, "%sAC_ERROR(exec_name << \": co-verification ring not found. Is it running under acverifier?\");\n", INDENT[2]);
+    fprintf( output, "%sexit(EXIT_FAILURE);\n", INDENT[2]);
+    fprintf( output, "%s}\n\n", INDENT[1]);
+    fprintf( output, "%ssbuf.mtype = 1;\n", INDENT[1]);
+    fprintf( output, "%ssbuf.ndevice = %d;\n", INDENT[1], ndevice);
+    fprintf( output, "%ssbuf.digest = 1;\n", INDENT[1]);
+    fprintf( output, "%sac_vdigest.init(%d);\n", INDENT[1], ndevice);
+    fprintf( output, "%sac_vring.send(&sbuf, sizeof(sbuf));\n\n", INDENT[1]);
+    fprintf( output, "%sdbuf.mtype = 2;\n", INDENT[1]);
+    for( pstorage = storage_list; pstorage != NULL; pstorage=pstorage->next)
+      if( pstorage->type == MEM || pstorage->type == ICACHE || pstorage->type == DCACHE ||
+          pstorage->type == CACHE || pstorage->type == REGBANK ){
+        fprintf( output, "%sstrcpy(dbuf.name, \"%s\");\n", INDENT[1], pstorage->name);
+        fprintf( output, "%sac_vring.send(&dbuf, sizeof(dbuf));\n", INDENT[1]);
+      }
+    fprintf( output, "%sac_vring.flush();\n", INDENT[1]);
+    fprintf( output, "}\n\n");
+  }
+
+  close_output( output, filename);
 }
 
 /*!Create the template for the .cpp file where the user has
@@ -2649,12 +3696,14 @@ void CreateArchImpl() {
 void CreateMainTmpl() {
 
   extern char *project_name;
+  extern ac_dec_instr *instr_list;
+  ac_dec_instr *pinstr;
   char filename[] = "main.cpp.tmpl";
   char description[256];
   FILE  *output;
 
   sprintf( description, "This is the main file for the %s ArchC model", project_name);
-  if ( !(output = fopen( filename, "w"))){
+  if ( !(output = open_output( filename))){
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -2669,13 +3718,210 @@ void CreateMainTmpl() {
 
   fprintf( output, "#include  <iostream>\n");
   fprintf( output, "#include  <systemc.h>\n");
+  fprintf( output, "#include  <string.h>\n");
   fprintf( output, "#include  \"ac_stats_base.H\"\n");
+  fprintf( output, "#include  \"ac_stats_out.H\"\n");
+  fprintf( output, "#include  \"ac_stats_snapshot.H\"\n");
+  fprintf( output, "#include  \"ac_host_place.H\"\n");
+  if (ACPluginsFlag)
+    fprintf( output, "#include  \"ac_plugin.H\"\n");
+  fprintf( output, "#include  <stdlib.h>\n");
   fprintf( output, "#include  \"%s.H\"\n\n", project_name);
 
+  if (ACPluginsFlag) {
+    COMMENT(INDENT[0], "Instruction names by ID, for the plugins.");
+    fprintf( output, "static const char* const ac_plugin_names[] = { 0");
+    for( pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next)
+      fprintf( output, ", \"%s\"", pinstr->name);
+    fprintf( output, " };\n\n");
+  }
+  fprintf( output, "#ifdef POWER_SIM\n");
+  fprintf( output, "#include  <stdlib.h>\n");
+  fprintf( output, "#endif\n\n");
+
+  if (ACMultiCoreFlag)
+    EmitMultiCoreMain(output);
+
+  if (ACBatchFlag)
+    EmitBatchMain(output);
+
+  if (ACServerFlag)
+    EmitServerMain(output);
+
+  if (ACCheckpointFlag) {
+    fprintf( output, "#include  <stdlib.h>\n");
+    fprintf( output, "#include  <string.h>\n");
+  }
+
   fprintf( output, "\n\n");
-  fprintf( output, "int sc_main(int ac, char *av[])\n");
+  if (ACStandaloneFlag)
+    fprintf( output, "int main(int ac, char *av[])\n");
+  else
+    fprintf( output, "int sc_main(int ac, char *av[])\n");
   fprintf( output, "{\n\n");
 
+  if (ACPluginsFlag) {
+    COMMENT(INDENT[1], "The statistics file, interval and server and the plugins come before every other option.");
+    fprintf( output, "%sac_plugin_instr_names(ac_plugin_names, sizeof(ac_plugin_names) / sizeof(ac_plugin_names[0]));\n", INDENT[1]);
+    fprintf( output, "%swhile( ac > 1 && (!strncmp(av[1], \"--stats-out=\", 12) || !strncmp(av[1], \"--stats-interval=\", 17) ||\n", INDENT[1]);
+    fprintf( output, "%s!strncmp(av[1], \"--stats-listen=\", 15) || !strncmp(av[1], \"--plugin=\", 9)) ) {\n", INDENT[3]);
+    fprintf( output, "%sif( !strncmp(av[1], \"--plugin=\", 9) ) {\n", INDENT[2]);
+    fprintf( output, "%sif( !ac_plugin_load(av[1] + 9) )\n", INDENT[3]);
+    fprintf( output, "%sexit(EXIT_FAILURE);\n", INDENT[4]);
+    fprintf( output, "%s}\n", INDENT[2]);
+    fprintf( output, "%selse if( !strncmp(av[1], \"--stats-out=\", 12) )\n", INDENT[2]);
+  }
+  else {
+    COMMENT(INDENT[1], "The statistics file, interval and server come before every other option.");
+    fprintf( output, "%swhile( ac > 1 && (!strncmp(av[1], \"--stats-out=\", 12) || !strncmp(av[1], \"--stats-interval=\", 17) ||\n", INDENT[1]);
+    fprintf( output, "%s!strncmp(av[1], \"--stats-listen=\", 15)) ) {\n", INDENT[3]);
+    fprintf( output, "%sif( !strncmp(av[1], \"--stats-out=\", 12) )\n", INDENT[2]);
+  }
+  fprintf( output, "%sac_stats_out_open(av[1] + 12);\n", INDENT[3]);
+  fprintf( output, "%selse if( !strncmp(av[1], \"--stats-listen=\", 15) ) {\n", INDENT[2]);
+  fprintf( output, "%sif( !ac_stats_listen_start(av[1] + 15) )\n", INDENT[3]);
+  fprintf( output, "%scerr << \"ArchC: No statistics server, \" << av[1] << \" was ignored.\" << endl;\n", INDENT[4]);
+  fprintf( output, "%s}\n", INDENT[2]);
+  fprintf( output, "%selse if( !ac_stats_interval_start(strtod(av[1] + 17, NULL)) )\n", INDENT[2]);
+  fprintf( output, "%scerr << \"ArchC: No statistics snapshots, \" << av[1] << \" was ignored.\" << endl;\n", INDENT[3]);
+  fprintf( output, "%sav[1] = av[0];\n", INDENT[2]);
+  fprintf( output, "%sac--;\n", INDENT[2]);
+  fprintf( output, "%sav++;\n", INDENT[2]);
+  fprintf( output, "%s}\n\n", INDENT[1]);
+
+  /* Simulators built with the power model (POWER_SIM) read these in power_stats */
+  fprintf( output, "#ifdef POWER_SIM\n");
+  COMMENT(INDENT[1], "Power model options come before the ones read by init().");
+  fprintf( output, "%swhile( ac > 1 && !strncmp(av[1], \"--power-\", 8) ) {\n", INDENT[1]);
+  fprintf( output, "%sif( !strncmp(av[1], \"--power-table=\", 14) )\n", INDENT[2]);
+  fprintf( output, "%ssetenv(\"AC_POWER_TABLE\", av[1] + 14, 1);\n", INDENT[3]);
+  fprintf( output, "%selse if( !strncmp(av[1], \"--power-profile=\", 16) )\n", INDENT[2]);
+  fprintf( output, "%ssetenv(\"AC_POWER_PROFILE\", av[1] + 16, 1);\n", INDENT[3]);
+  fprintf( output, "%selse if( !strncmp(av[1], \"--power-window=\", 15) )\n", INDENT[2]);
+  fprintf( output, "%ssetenv(\"AC_POWER_WINDOW\", av[1] + 15, 1);\n", INDENT[3]);
+  fprintf( output, "%selse if( !strncmp(av[1], \"--power-window-report=\", 22) )\n", INDENT[2]);
+  fprintf( output, "%ssetenv(\"AC_POWER_WINDOW_REPORT\", av[1] + 22, 1);\n", INDENT[3]);
+  fprintf( output, "%selse if( !strncmp(av[1], \"--power-window-format=\", 22) )\n", INDENT[2]);
+  fprintf( output, "%ssetenv(\"AC_POWER_WINDOW_FORMAT\", av[1] + 22, 1);\n", INDENT[3]);
+  fprintf( output, "%selse if( !strncmp(av[1], \"--power-governor=\", 17) )\n", INDENT[2]);
+  fprintf( output, "%ssetenv(\"AC_POWER_GOVERNOR\", av[1] + 17, 1);\n", INDENT[3]);
+  fprintf( output, "%selse if( !strncmp(av[1], \"--power-switch-cost=\", 20) )\n", INDENT[2]);
+  fprintf( output, "%ssetenv(\"AC_POWER_SWITCH_COST\", av[1] + 20, 1);\n", INDENT[3]);
+  fprintf( output, "%selse if( !strncmp(av[1], \"--power-functions=\", 18) )\n", INDENT[2]);
+  fprintf( output, "%ssetenv(\"AC_POWER_FUNCTIONS\", av[1] + 18, 1);\n", INDENT[3]);
+  fprintf( output, "%selse if( !strncmp(av[1], \"--power-compare=\", 16) )\n", INDENT[2]);
+  fprintf( output, "%ssetenv(\"AC_POWER_COMPARE\", av[1] + 16, 1);\n", INDENT[3]);
+  fprintf( output, "%selse\n", INDENT[2]);
+  fprintf( output, "%sbreak;\n", INDENT[3]);
+  fprintf( output, "%sav[1] = av[0];\n", INDENT[2]);
+  fprintf( output, "%sac--;\n", INDENT[2]);
+  fprintf( output, "%sav++;\n", INDENT[2]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "#endif\n\n");
+
+  COMMENT(INDENT[1], "Host placement options, and the simulation thread pinned before any memory is allocated.");
+  fprintf( output, "%swhile( ac > 1 && !strncmp(av[1], \"--host-\", 7) ) {\n", INDENT[1]);
+  fprintf( output, "%sif( !strncmp(av[1], \"--host-cpus=\", 12) )\n", INDENT[2]);
+  fprintf( output, "%ssetenv(\"AC_HOST_CPUS\", av[1] + 12, 1);\n", INDENT[3]);
+  fprintf( output, "%selse if( !strncmp(av[1], \"--host-numa=\", 12) )\n", INDENT[2]);
+  fprintf( output, "%ssetenv(\"AC_HOST_NUMA\", av[1] + 12, 1);\n", INDENT[3]);
+  fprintf( output, "%selse if( !strncmp(av[1], \"--host-hugepages=\", 17) )\n", INDENT[2]);
+  fprintf( output, "%ssetenv(\"AC_HOST_HUGEPAGES\", av[1] + 17, 1);\n", INDENT[3]);
+  fprintf( output, "%selse\n", INDENT[2]);
+  fprintf( output, "%sbreak;\n", INDENT[3]);
+  fprintf( output, "%sav[1] = av[0];\n", INDENT[2]);
+  fprintf( output, "%sac--;\n", INDENT[2]);
+  fprintf( output, "%sav++;\n", INDENT[2]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%sac_host_pin(\"simulation thread\");\n\n", INDENT[1]);
+
+  if (ACMultiCoreFlag) {
+    fprintf( output, "%sint cores = 1;\n", INDENT[1]);
+    fprintf( output, "%sint quantum = 0;\n", INDENT[1]);
+    fprintf( output, "%sint threads = 0;\n\n", INDENT[1]);
+
+    if (ACMPIFlag) {
+      COMMENT(INDENT[1], "Every rank runs its share of the cores; MPI takes its own options out first.");
+      fprintf( output, "%sac_mpi mpi(&ac, &av);\n", INDENT[1]);
+      fprintf( output, "%smpi_ranks = &mpi;\n\n", INDENT[1]);
+    }
+
+    COMMENT(INDENT[1], "Multi-core options come before the ones read by init().");
+    fprintf( output, "%swhile( ac > 1 && (!strncmp(av[1], \"--cores=\", 8) || !strncmp(av[1], \"--quantum=\", 10) ||\n", INDENT[1]);
+    if (ACMPIFlag)
+      fprintf( output, "%s!strncmp(av[1], \"--mpi-shared=\", 13) ||\n", INDENT[3]);
+    fprintf( output, "%s!strncmp(av[1], \"--threads=\", 10)) ) {\n", INDENT[3]);
+    if (ACMPIFlag) {
+      fprintf( output, "%sif( av[1][2] == 'm' ) {\n", INDENT[2]);
+      fprintf( output, "%schar* size;\n", INDENT[3]);
+      fprintf( output, "%smpi_shared_address = strtoul(av[1] + 13, &size, 0);\n", INDENT[3]);
+      fprintf( output, "%smpi_shared_size = *size == ':' ? strtoul(size + 1, NULL, 0) : 0;\n", INDENT[3]);
+      fprintf( output, "%s}\n", INDENT[2]);
+      fprintf( output, "%selse if( av[1][2] == 'c' )\n", INDENT[2]);
+    }
+    else
+      fprintf( output, "%sif( av[1][2] == 'c' )\n", INDENT[2]);
+    fprintf( output, "%scores = atoi(av[1] + 8);\n", INDENT[3]);
+    COMMENT(INDENT[2], "A core for each thread the program may run at once.");
+    fprintf( output, "%selse if( av[1][2] == 't' ) {\n", INDENT[2]);
+    fprintf( output, "%scores = atoi(av[1] + 10);\n", INDENT[3]);
+    fprintf( output, "%sthreads = 1;\n", INDENT[3]);
+    fprintf( output, "%s}\n", INDENT[2]);
+    fprintf( output, "%selse\n", INDENT[2]);
+    fprintf( output, "%squantum = atoi(av[1] + 10);\n", INDENT[3]);
+    fprintf( output, "%sav[1] = av[0];\n", INDENT[2]);
+    fprintf( output, "%sac--;\n", INDENT[2]);
+    fprintf( output, "%sav++;\n", INDENT[2]);
+    fprintf( output, "%s}\n\n", INDENT[1]);
+
+    fprintf( output, "%sif( cores > 1 || threads%s )\n", INDENT[1], ACMPIFlag ? " || mpi.size() > 1" : "");
+    fprintf( output, "%sreturn run_cores(cores, quantum, threads, ac, av);\n\n", INDENT[2]);
+  }
+
+  if (ACBatchFlag) {
+    fprintf( output, "%sconst char* batch_file = 0;\n", INDENT[1]);
+    if (ACServerFlag)
+      fprintf( output, "%sconst char* serve = 0;\n", INDENT[1]);
+    fprintf( output, "%sint jobs = 0;\n\n", INDENT[1]);
+
+    COMMENT(INDENT[1], "Batch options come before the ones read by init().");
+    fprintf( output, "%swhile( ac > 1 && (!strncmp(av[1], \"--batch=\", 8) || !strncmp(av[1], \"--jobs=\", 7)%s) ) {\n", INDENT[1],
+             ACServerFlag ? " || !strncmp(av[1], \"--serve=\", 8)" : "");
+    fprintf( output, "%sif( av[1][2] == 'b' )\n", INDENT[2]);
+    fprintf( output, "%sbatch_file = av[1] + 8;\n", INDENT[3]);
+    if (ACServerFlag) {
+      fprintf( output, "%selse if( av[1][2] == 's' )\n", INDENT[2]);
+      fprintf( output, "%sserve = av[1] + 8;\n", INDENT[3]);
+    }
+    fprintf( output, "%selse\n", INDENT[2]);
+    fprintf( output, "%sjobs = atoi(av[1] + 7);\n", INDENT[3]);
+    fprintf( output, "%sav[1] = av[0];\n", INDENT[2]);
+    fprintf( output, "%sac--;\n", INDENT[2]);
+    fprintf( output, "%sav++;\n", INDENT[2]);
+    fprintf( output, "%s}\n\n", INDENT[1]);
+  }
+
+  if (ACCheckpointFlag) {
+    fprintf( output, "%sconst char* checkpoint_file = \"%s.ckpt\";\n", INDENT[1], project_name);
+    fprintf( output, "%sconst char* restore_file = 0;\n", INDENT[1]);
+    fprintf( output, "%sunsigned long long checkpoint_at = (unsigned long long) -1;\n\n", INDENT[1]);
+
+    COMMENT(INDENT[1], "Checkpoint options come before the ones read by init().");
+    fprintf( output, "%swhile( ac > 1 && (!strncmp(av[1], \"--checkpoint\", 12) || !strncmp(av[1], \"--restore=\", 10)) ) {\n", INDENT[1]);
+    fprintf( output, "%sif( !strncmp(av[1], \"--checkpoint=\", 13) )\n", INDENT[2]);
+    fprintf( output, "%scheckpoint_file = av[1] + 13;\n", INDENT[3]);
+    fprintf( output, "%selse if( !strncmp(av[1], \"--checkpoint-at=\", 16) )\n", INDENT[2]);
+    fprintf( output, "%scheckpoint_at = strtoull(av[1] + 16, NULL, 10);\n", INDENT[3]);
+    fprintf( output, "%selse if( !strncmp(av[1], \"--restore=\", 10) )\n", INDENT[2]);
+    fprintf( output, "%srestore_file = av[1] + 10;\n", INDENT[3]);
+    fprintf( output, "%selse\n", INDENT[2]);
+    fprintf( output, "%sbreak;\n", INDENT[3]);
+    fprintf( output, "%sav[1] = av[0];\n", INDENT[2]);
+    fprintf( output, "%sac--;\n", INDENT[2]);
+    fprintf( output, "%sav++;\n", INDENT[2]);
+    fprintf( output, "%s}\n\n", INDENT[1]);
+  }
+
   COMMENT(INDENT[1],"%sISA simulator", INDENT[1]);
   fprintf( output, "%s%s %s_proc1(\"%s\");\n\n", INDENT[1], project_name, project_name, project_name);
 
@@ -2683,19 +3929,46 @@ void CreateMainTmpl() {
   fprintf( output, "%sac_trace(\"%s_proc1.trace\");\n", INDENT[1], project_name);
   fprintf( output, "#endif \n\n");
 
+  if (ACBatchFlag) {
+    COMMENT(INDENT[1], "Every job runs in a copy of this process, processor memory included.");
+    fprintf( output, "%sif( batch_file )\n", INDENT[1]);
+    fprintf( output, "%sreturn run_batch(%s_proc1, batch_file, jobs, av[0]) ? EXIT_FAILURE : 0;\n\n", INDENT[2], project_name);
+  }
+
+  if (ACServerFlag) {
+    fprintf( output, "%sif( serve )\n", INDENT[1]);
+    fprintf( output, "%sreturn run_server(%s_proc1, serve, jobs, av[0]) ? EXIT_FAILURE : 0;\n\n", INDENT[2], project_name);
+  }
+
   if (ACGDBIntegrationFlag == 1)
     fprintf(output, "%s%s_proc1.enable_gdb();\n", INDENT[1], project_name);
 
   fprintf(output, "%s%s_proc1.init(ac, av);\n", INDENT[1], project_name);
   fprintf(output, "%scerr << endl;\n\n", INDENT[1]);
 
-  fprintf(output, "%ssc_start();\n\n", INDENT[1]);
+  if (ACCheckpointFlag) {
+    fprintf(output, "%sif( restore_file && !%s_proc1.restore_checkpoint(restore_file) ) {\n", INDENT[1], project_name);
+    fprintf(output, "%scerr << \"ArchC: Could not restore checkpoint \" << restore_file << endl;\n", INDENT[2]);
+    fprintf(output, "%sreturn EXIT_FAILURE;\n", INDENT[2]);
+    fprintf(output, "%s}\n", INDENT[1]);
+    fprintf(output, "%s%s_proc1.ac_checkpoint_at = checkpoint_at;\n", INDENT[1], project_name);
+    fprintf(output, "%s%s_proc1.ac_checkpoint_file = checkpoint_file;\n\n", INDENT[1], project_name);
+  }
+
+  if (ACStandaloneFlag) {
+    COMMENT(INDENT[1], "No wait() is ever issued, so the behavior thread runs to the end on its own.");
+    fprintf(output, "%s%s_proc1.behavior();\n\n", INDENT[1], project_name);
+  }
+  else
+    fprintf(output, "%ssc_start();\n\n", INDENT[1]);
 
   fprintf(output, "%s%s_proc1.PrintStat();\n", INDENT[1], project_name);
   fprintf(output, "%scerr << endl;\n\n", INDENT[1]);
 
   fprintf( output, "#ifdef AC_STATS\n");
   fprintf( output, "%sac_stats_base::print_all_stats(std::cerr);\n", INDENT[1], project_name);
+  fprintf( output, "%sif( ac_stats_out_enabled() )\n", INDENT[1]);
+  fprintf( output, "%sac_stats_base::add_all_stats_out();\n", INDENT[2]);
   fprintf( output, "#endif \n\n");
 
   fprintf( output, "#ifdef AC_DEBUG\n");
@@ -2705,6 +3978,497 @@ void CreateMainTmpl() {
   fprintf( output, "%sreturn %s_proc1.ac_exit_status;\n", INDENT[1], project_name);
 
   fprintf( output, "}\n");
+
+  close_output( output, filename);
+}
+
+
+/*!Emit the multi-core driver used by the main file template.
+  Every core gets its own processor module that shares the memories of
+  the first one and runs behavior() on a host thread. With threads, only
+  the first core runs the program, and the others wait for threads it
+  clones. */
+void EmitMultiCoreMain(FILE *output) {
+
+  extern ac_sto_list *storage_list;
+  extern char *project_name;
+  ac_sto_list *pstorage;
+
+  fprintf( output, "#include  <pthread.h>\n");
+  fprintf( output, "#include  <stdio.h>\n");
+  fprintf( output, "#include  <stdlib.h>\n");
+  fprintf( output, "#include  <string.h>\n");
+  fprintf( output, "#include  \"ac_quantum.H\"\n");
+  fprintf( output, "#include  \"ac_host_place.H\"\n");
+  if (ACABIFlag)
+    fprintf( output, "#include  \"ac_threads.H\"\n");
+  if (ACMPIFlag)
+    fprintf( output, "#include  \"ac_mpi.H\"\n");
+  fprintf( output, "\n");
+
+  if (ACMPIFlag) {
+    fprintf( output, "static ac_mpi* mpi_ranks; \t //!< The ranks the cores are partitioned across.\n");
+    fprintf( output, "static uint32_t mpi_shared_address, mpi_shared_size; \t //!< Memory window of --mpi-shared.\n\n");
+  }
+
+  COMMENT(INDENT[0], "Host thread body for one core.");
+  fprintf( output, "static void* run_core(void* proc)\n");
+  fprintf( output, "{\n");
+  fprintf( output, "%sac_host_pin(\"core thread\");\n", INDENT[1]);
+  fprintf( output, "%s((%s*) proc)->behavior();\n", INDENT[1], project_name);
+  fprintf( output, "%sreturn NULL;\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+
+  if (ACABIFlag) {
+    COMMENT(INDENT[0], "Host thread body for a core that waits for a thread of the program.");
+    fprintf( output, "static void* run_thread_core(void* proc)\n");
+    fprintf( output, "{\n");
+    fprintf( output, "%sac_host_pin(\"core thread\");\n", INDENT[1]);
+    fprintf( output, "%sif( ((%s*) proc)->ISA.syscall.wait_thread() )\n", INDENT[1], project_name);
+    fprintf( output, "%s((%s*) proc)->behavior();\n", INDENT[2], project_name);
+    fprintf( output, "%sreturn NULL;\n", INDENT[1]);
+    fprintf( output, "}\n\n");
+  }
+
+  COMMENT(INDENT[0], "Runs cores processors on host threads, meeting every quantum instructions.");
+  COMMENT(INDENT[0], "If threaded, they run the threads of the program of the first one.");
+  fprintf( output, "static int run_cores(int cores, int quantum, int threaded, int ac, char *av[])\n");
+  fprintf( output, "{\n");
+  fprintf( output, "%s%s** procs = new %s*[cores];\n", INDENT[1], project_name, project_name);
+  fprintf( output, "%spthread_t* threads = new pthread_t[cores];\n", INDENT[1]);
+  COMMENT(INDENT[1], "If threaded, cores count at the barrier only while they run a thread.");
+  fprintf( output, "%sac_quantum_barrier barrier(threaded ? 1 : cores);\n", INDENT[1]);
+  if (ACABIFlag) {
+    fprintf( output, "%sac_threads* program = threaded ? new ac_threads(&barrier) : 0;\n", INDENT[1]);
+    fprintf( output, "%sint status;\n", INDENT[1]);
+  }
+  else {
+    fprintf( output, "%sif( threaded ) {\n", INDENT[1]);
+    fprintf( output, "%sfprintf(stderr, \"ArchC: --threads needs a model with an ABI.\\n\");\n", INDENT[2]);
+    fprintf( output, "%sreturn EXIT_FAILURE;\n", INDENT[2]);
+    fprintf( output, "%s}\n", INDENT[1]);
+  }
+  fprintf( output, "%schar name[32];\n", INDENT[1]);
+  fprintf( output, "%sint first = 0;\n", INDENT[1]);
+  fprintf( output, "%sint i;\n\n", INDENT[1]);
+
+  if (ACMPIFlag) {
+    COMMENT(INDENT[1], "The cores are numbered across the ranks, and the threads of a program cannot leave its rank.");
+    fprintf( output, "%sif( mpi_ranks->size() > 1 && (threaded || cores < mpi_ranks->size()) ) {\n", INDENT[1]);
+    fprintf( output, "%sfprintf(stderr, \"ArchC: --mpi needs --cores=N, at least one per rank, and no --threads.\\n\");\n", INDENT[2]);
+    fprintf( output, "%sreturn EXIT_FAILURE;\n", INDENT[2]);
+    fprintf( output, "%s}\n", INDENT[1]);
+    fprintf( output, "%sfirst = mpi_ranks->first_core(cores);\n", INDENT[1]);
+    fprintf( output, "%scores = mpi_ranks->local_cores(cores);\n\n", INDENT[1]);
+  }
+
+  fprintf( output, "%sfor( i = 0; i < cores; i++ ) {\n", INDENT[1]);
+  //ac_init_app() rewrites the argument vector, so each core parses its own copy.
+  fprintf( output, "%schar** args = new char*[ac + 1];\n", INDENT[2]);
+  fprintf( output, "%smemcpy(args, av, (ac + 1) * sizeof(char*));\n\n", INDENT[2]);
+
+  fprintf( output, "%ssprintf(name, \"%s_proc%%d\", first + i + 1);\n", INDENT[2], project_name);
+  COMMENT(INDENT[2], "Every core works on the memories of the first one.");
+  fprintf( output, "%sprocs[i] = new %s(name, i ? procs[0] : 0);\n\n", INDENT[2], project_name);
+
+  fprintf( output, "%sif( quantum > 0 )\n", INDENT[2]);
+  fprintf( output, "%sprocs[i]->set_instr_batch_size(quantum);\n", INDENT[3]);
+  fprintf( output, "%sprocs[i]->ac_quantum = &barrier;\n", INDENT[2]);
+  fprintf( output, "%sprocs[i]->init(ac, args);\n", INDENT[2]);
+  if (ACABIFlag) {
+    fprintf( output, "%sif( program )\n", INDENT[2]);
+    fprintf( output, "%sprogram->add_core((ac_arch<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms>*) procs[i], &procs[i]->ac_stop_flag);\n",
+             INDENT[3], project_name, project_name, project_name);
+  }
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%scerr << endl;\n\n", INDENT[1]);
+
+  if (ACMPIFlag) {
+    for( pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next )
+      if( pstorage->type != REG && pstorage->type != REGBANK && pstorage->type != TLM_PORT )
+        break;
+    COMMENT(INDENT[1], "The ranks meet where the cores of each meet, and copy the window of the first memory between them.");
+    fprintf( output, "%sif( mpi_shared_size ) {\n", INDENT[1]);
+    if (pstorage) {
+      fprintf( output, "%sif( (uint64_t) mpi_shared_address + mpi_shared_size > procs[0]->%s_stg.get_size() ) {\n", INDENT[2], pstorage->name);
+      fprintf( output, "%sfprintf(stderr, \"ArchC: --mpi-shared is not within %s.\\n\");\n", INDENT[3], pstorage->name);
+      fprintf( output, "%sreturn EXIT_FAILURE;\n", INDENT[3]);
+      fprintf( output, "%s}\n", INDENT[2]);
+      fprintf( output, "%smpi_ranks->share(procs[0]->%s_stg.get_data() + mpi_shared_address, mpi_shared_size);\n", INDENT[2], pstorage->name);
+    }
+    else {
+      fprintf( output, "%sfprintf(stderr, \"ArchC: --mpi-shared needs a memory.\\n\");\n", INDENT[2]);
+      fprintf( output, "%sreturn EXIT_FAILURE;\n", INDENT[2]);
+    }
+    fprintf( output, "%s}\n", INDENT[1]);
+    fprintf( output, "%sbarrier.set_boundary(ac_mpi::boundary, mpi_ranks);\n\n", INDENT[1]);
+  }
+
+  COMMENT(INDENT[1], "The last core to stop leaves the kernel to this thread, which runs SystemC.");
+  fprintf( output, "%sac_module::on_host_threads = true;\n", INDENT[1]);
+  fprintf( output, "%sfor( i = 0; i < cores; i++ )\n", INDENT[1]);
+  if (ACABIFlag)
+    fprintf( output, "%spthread_create(&threads[i], NULL, program && i ? run_thread_core : run_core, procs[i]);\n", INDENT[2]);
+  else
+    fprintf( output, "%spthread_create(&threads[i], NULL, run_core, procs[i]);\n", INDENT[2]);
+  fprintf( output, "%sfor( i = 0; i < cores; i++ )\n", INDENT[1]);
+  fprintf( output, "%spthread_join(threads[i], NULL);\n", INDENT[2]);
+  fprintf( output, "%sac_module::stop_kernel();\n\n", INDENT[1]);
+  if (ACMPIFlag) {
+    COMMENT(INDENT[1], "The other ranks still meet this one until their cores stop too.");
+    fprintf( output, "%smpi_ranks->finish();\n\n", INDENT[1]);
+  }
+
+  fprintf( output, "%sfor( i = 0; i < cores; i++ ) {\n", INDENT[1]);
+  fprintf( output, "%sprocs[i]->PrintStat();\n", INDENT[2]);
+  fprintf( output, "%scerr << endl;\n", INDENT[2]);
+  fprintf( output, "%s}\n\n", INDENT[1]);
+
+  fprintf( output, "#ifdef AC_STATS\n");
+  fprintf( output, "%sac_stats_base::print_all_stats(std::cerr);\n", INDENT[1]);
+  fprintf( output, "%sif( ac_stats_out_enabled() )\n", INDENT[1]);
+  fprintf( output, "%sac_stats_base::add_all_stats_out();\n", INDENT[2]);
+  fprintf( output, "#endif \n\n");
+  if (ACMPIFlag)
+    fprintf( output, "%smpi_ranks->gather_stats();\n\n", INDENT[1]);
+
+  if (ACABIFlag) {
+    COMMENT(INDENT[1], "Any thread may have ended the program.");
+    fprintf( output, "%sif( program && program->done(status) )\n", INDENT[1]);
+    fprintf( output, "%sreturn status;\n", INDENT[2]);
+  }
+  fprintf( output, "%sreturn procs[0]->ac_exit_status;\n", INDENT[1]);
+  fprintf( output, "}\n");
+}
+
+
+/*!Emit the batch runner used by the main file template.
+  Jobs run in forked children of a process that has already built the
+  processor module, so each one gets the simulator, the model state, the
+  open files and the standard streams to itself. */
+void EmitBatchMain(FILE *output) {
+
+  extern char *project_name;
+
+  fprintf( output, "#include  <sys/types.h>\n");
+  fprintf( output, "#include  <sys/wait.h>\n");
+  fprintf( output, "#include  <fcntl.h>\n");
+  fprintf( output, "#include  <unistd.h>\n");
+  fprintf( output, "#include  <stdio.h>\n");
+  fprintf( output, "#include  <stdlib.h>\n");
+  fprintf( output, "#include  <string.h>\n");
+  fprintf( output, "#include  <fstream>\n");
+  fprintf( output, "#include  <sstream>\n");
+  fprintf( output, "#include  <string>\n");
+  fprintf( output, "#include  <vector>\n\n");
+
+  COMMENT(INDENT[0], "One line of a job list: NAME [VAR=VALUE...] --load=PROG [ARGS...]");
+  fprintf( output, "struct batch_job {\n");
+  fprintf( output, "%sstd::string name;\n", INDENT[1]);
+  fprintf( output, "%sstd::vector<std::string> env;\n", INDENT[1]);
+  fprintf( output, "%sstd::vector<std::string> args;\n", INDENT[1]);
+  fprintf( output, "};\n\n");
+
+  COMMENT(INDENT[0], "Parses a line of a job list. Returns false for empty lines and comments.");
+  fprintf( output, "static bool parse_job(const std::string& line, batch_job& job)\n");
+  fprintf( output, "{\n");
+  fprintf( output, "%sstd::istringstream words(line);\n", INDENT[1]);
+  fprintf( output, "%sstd::string word;\n\n", INDENT[1]);
+  fprintf( output, "%sif( !(words >> job.name) || job.name[0] == '#' )\n", INDENT[1]);
+  fprintf( output, "%sreturn false;\n", INDENT[2]);
+  fprintf( output, "%swhile( words >> word ) {\n", INDENT[1]);
+  fprintf( output, "%sif( job.args.empty() && word[0] != '-' && word.find('=') != std::string::npos )\n", INDENT[2]);
+  fprintf( output, "%sjob.env.push_back(word);\n", INDENT[3]);
+  fprintf( output, "%selse\n", INDENT[2]);
+  fprintf( output, "%sjob.args.push_back(word);\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%sreturn true;\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+
+  COMMENT(INDENT[0], "Reads the job list, skipping empty lines and comments.");
+  fprintf( output, "static bool read_batch(const char* path, std::vector<batch_job>& jobs)\n");
+  fprintf( output, "{\n");
+  fprintf( output, "%sstd::ifstream in(path);\n", INDENT[1]);
+  fprintf( output, "%sstd::string line;\n\n", INDENT[1]);
+  fprintf( output, "%sif( !in )\n", INDENT[1]);
+  fprintf( output, "%sreturn false;\n\n", INDENT[2]);
+  fprintf( output, "%swhile( std::getline(in, line) ) {\n", INDENT[1]);
+  fprintf( output, "%sbatch_job job;\n\n", INDENT[2]);
+  fprintf( output, "%sif( parse_job(line, job) )\n", INDENT[2]);
+  fprintf( output, "%sjobs.push_back(job);\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%sreturn true;\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+
+  COMMENT(INDENT[0], "Runs one job in a child process, with its output in NAME.out and NAME.err, or on connection conn if it is not -1, and its statistics file in NAME.json or NAME.csv.");
+  fprintf( output, "static int run_job(%s& proc, const batch_job& job, char* av0, int conn)\n", project_name);
+  fprintf( output, "{\n");
+  fprintf( output, "%sstd::vector<char*> av;\n", INDENT[1]);
+  fprintf( output, "%sint fd;\n", INDENT[1]);
+  fprintf( output, "%ssize_t i;\n\n", INDENT[1]);
+
+  fprintf( output, "%sif( conn != -1 ) {\n", INDENT[1]);
+  fprintf( output, "%sdup2(conn, 0);\n", INDENT[2]);
+  fprintf( output, "%sdup2(conn, 1);\n", INDENT[2]);
+  fprintf( output, "%sdup2(conn, 2);\n", INDENT[2]);
+  fprintf( output, "%sclose(conn);\n", INDENT[2]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%selse {\n", INDENT[1]);
+  fprintf( output, "%sif( (fd = open(\"/dev/null\", O_RDONLY)) != -1 ) {\n", INDENT[2]);
+  fprintf( output, "%sdup2(fd, 0);\n", INDENT[3]);
+  fprintf( output, "%sclose(fd);\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[2]);
+  fprintf( output, "%sif( !freopen((job.name + \".out\").c_str(), \"w\", stdout) ||\n", INDENT[2]);
+  fprintf( output, "%s!freopen((job.name + \".err\").c_str(), \"w\", stderr) )\n", INDENT[3]);
+  fprintf( output, "%sreturn EXIT_FAILURE;\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%sac_stats_out_rename(job.name.c_str());\n\n", INDENT[1]);
+
+  fprintf( output, "%sfor( i = 0; i < job.env.size(); i++ )\n", INDENT[1]);
+  fprintf( output, "%sputenv(strdup(job.env[i].c_str()));\n\n", INDENT[2]);
+
+  //ac_init_app() rewrites the argument vector in place.
+  fprintf( output, "%sav.push_back(av0);\n", INDENT[1]);
+  fprintf( output, "%sfor( i = 0; i < job.args.size(); i++ )\n", INDENT[1]);
+  fprintf( output, "%sav.push_back(strdup(job.args[i].c_str()));\n", INDENT[2]);
+  fprintf( output, "%sav.push_back(NULL);\n\n", INDENT[1]);
+
+  fprintf( output, "%sproc.init(av.size() - 1, &av[0]);\n", INDENT[1]);
+  fprintf( output, "%scerr << endl;\n", INDENT[1]);
+  if (ACStandaloneFlag)
+    fprintf( output, "%sproc.behavior();\n", INDENT[1]);
+  else
+    fprintf( output, "%ssc_start();\n", INDENT[1]);
+  fprintf( output, "%sproc.PrintStat();\n", INDENT[1]);
+  fprintf( output, "%scerr << endl;\n\n", INDENT[1]);
+
+  fprintf( output, "#ifdef AC_STATS\n");
+  fprintf( output, "%sac_stats_base::print_all_stats(std::cerr);\n", INDENT[1]);
+  fprintf( output, "%sif( ac_stats_out_enabled() )\n", INDENT[1]);
+  fprintf( output, "%sac_stats_base::add_all_stats_out();\n", INDENT[2]);
+  fprintf( output, "#endif \n\n");
+
+  fprintf( output, "%sfflush(stdout);\n", INDENT[1]);
+  fprintf( output, "%sreturn proc.ac_exit_status;\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+
+  COMMENT(INDENT[0], "Runs the jobs listed in path, at most max_jobs at a time. Returns the number of failed jobs.");
+  fprintf( output, "static int run_batch(%s& proc, const char* path, int max_jobs, char* av0)\n", project_name);
+  fprintf( output, "{\n");
+  fprintf( output, "%sstd::vector<batch_job> jobs;\n", INDENT[1]);
+  fprintf( output, "%sstd::vector<pid_t> pids;\n", INDENT[1]);
+  fprintf( output, "%ssize_t next = 0;\n", INDENT[1]);
+  fprintf( output, "%sint running = 0, failed = 0;\n\n", INDENT[1]);
+
+  fprintf( output, "%sif( !read_batch(path, jobs) ) {\n", INDENT[1]);
+  fprintf( output, "%scerr << \"ArchC: Could not read job list \" << path << endl;\n", INDENT[2]);
+  fprintf( output, "%sreturn 1;\n", INDENT[2]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%sif( max_jobs <= 0 )\n", INDENT[1]);
+  fprintf( output, "%smax_jobs = sysconf(_SC_NPROCESSORS_ONLN);\n", INDENT[2]);
+  fprintf( output, "%spids.resize(jobs.size(), 0);\n\n", INDENT[1]);
+
+  fprintf( output, "%swhile( next < jobs.size() || running ) {\n", INDENT[1]);
+  fprintf( output, "%sint status;\n", INDENT[2]);
+  fprintf( output, "%spid_t pid;\n", INDENT[2]);
+  fprintf( output, "%ssize_t i;\n\n", INDENT[2]);
+
+  fprintf( output, "%sif( next < jobs.size() && running < max_jobs ) {\n", INDENT[2]);
+  fprintf( output, "%sfflush(NULL);\n", INDENT[3]);
+  fprintf( output, "%sif( (pid = fork()) == 0 ) {\n", INDENT[3]);
+  fprintf( output, "%sac_host_pin_job(next, \"job\");\n", INDENT[4]);
+  fprintf( output, "%sexit(run_job(proc, jobs[next], av0, -1));\n", INDENT[4]);
+  fprintf( output, "%s}\n", INDENT[3]);
+  fprintf( output, "%sif( pid == -1 ) {\n", INDENT[3]);
+  fprintf( output, "%sperror(\"ArchC: fork\");\n", INDENT[4]);
+  fprintf( output, "%sfailed += jobs.size() - next;\n", INDENT[4]);
+  fprintf( output, "%snext = jobs.size();\n", INDENT[4]);
+  fprintf( output, "%scontinue;\n", INDENT[4]);
+  fprintf( output, "%s}\n", INDENT[3]);
+  fprintf( output, "%spids[next++] = pid;\n", INDENT[3]);
+  fprintf( output, "%srunning++;\n", INDENT[3]);
+  fprintf( output, "%scontinue;\n", INDENT[3]);
+  fprintf( output, "%s}\n\n", INDENT[2]);
+
+  fprintf( output, "%sif( (pid = wait(&status)) == -1 )\n", INDENT[2]);
+  fprintf( output, "%sbreak;\n", INDENT[3]);
+  fprintf( output, "%sfor( i = 0; i < next && pids[i] != pid; i++ )\n", INDENT[2]);
+  fprintf( output, "%s;\n", INDENT[3]);
+  fprintf( output, "%sif( i == next )\n", INDENT[2]);
+  fprintf( output, "%scontinue;\n", INDENT[3]);
+  fprintf( output, "%srunning--;\n", INDENT[2]);
+  fprintf( output, "%sif( WIFEXITED(status) )\n", INDENT[2]);
+  fprintf( output, "%scerr << \"ArchC: Job \" << jobs[i].name << \" exited with status \" << WEXITSTATUS(status) << endl;\n", INDENT[3]);
+  fprintf( output, "%selse\n", INDENT[2]);
+  fprintf( output, "%scerr << \"ArchC: Job \" << jobs[i].name << \" killed by signal \" << WTERMSIG(status) << endl;\n", INDENT[3]);
+  fprintf( output, "%sif( !WIFEXITED(status) || WEXITSTATUS(status) )\n", INDENT[2]);
+  fprintf( output, "%sfailed++;\n", INDENT[3]);
+  fprintf( output, "%s}\n\n", INDENT[1]);
+
+  fprintf( output, "%sreturn failed;\n", INDENT[1]);
+  fprintf( output, "}\n");
+}
+
+
+/*!Emit the job server used by the main file template.
+  The server listens on a socket and forks, for each connection, a session
+  from the process that has already built the processor module. The
+  session reads one job line in the --batch format and runs it in a child
+  of its own, whose standard streams are the connection, then writes the
+  exit status of the job and hangs up. Models are thus loaded once, and
+  the pages of the loaded model are shared by every job until written. */
+void EmitServerMain(FILE *output) {
+
+  extern char *project_name;
+
+  fprintf( output, "#include  <sys/socket.h>\n");
+  fprintf( output, "#include  <sys/un.h>\n");
+  fprintf( output, "#include  <netdb.h>\n");
+  fprintf( output, "#include  <errno.h>\n");
+  fprintf( output, "#include  <signal.h>\n\n");
+
+  COMMENT(INDENT[0], "Listens on the Unix socket at where, or on [HOST]:PORT if where has a colon. Returns the socket, or -1.");
+  fprintf( output, "static int open_server_socket(const char* where)\n");
+  fprintf( output, "{\n");
+  fprintf( output, "%sconst char* colon = strrchr(where, ':');\n", INDENT[1]);
+  fprintf( output, "%sint fd = -1, on = 1;\n\n", INDENT[1]);
+
+  fprintf( output, "%sif( !colon ) {\n", INDENT[1]);
+  fprintf( output, "%sstruct sockaddr_un addr;\n\n", INDENT[2]);
+  fprintf( output, "%sif( strlen(where) >= sizeof(addr.sun_path) ) {\n", INDENT[2]);
+  fprintf( output, "%scerr << \"ArchC: Socket path too long: \" << where << endl;\n", INDENT[3]);
+  fprintf( output, "%sreturn -1;\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[2]);
+  fprintf( output, "%smemset(&addr, 0, sizeof(addr));\n", INDENT[2]);
+  fprintf( output, "%saddr.sun_family = AF_UNIX;\n", INDENT[2]);
+  fprintf( output, "%sstrcpy(addr.sun_path, where);\n", INDENT[2]);
+  fprintf( output, "%sunlink(where);\n", INDENT[2]);
+  fprintf( output, "%sif( (fd = socket(AF_UNIX, SOCK_STREAM, 0)) != -1 &&\n", INDENT[2]);
+  fprintf( output, "%sbind(fd, (struct sockaddr*) &addr, sizeof(addr)) == -1 ) {\n", INDENT[3]);
+  fprintf( output, "%sclose(fd);\n", INDENT[3]);
+  fprintf( output, "%sfd = -1;\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[2]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%selse {\n", INDENT[1]);
+  fprintf( output, "%sstd::string host(where, colon - where);\n", INDENT[2]);
+  fprintf( output, "%sstruct addrinfo hints, *list, *a;\n\n", INDENT[2]);
+  fprintf( output, "%smemset(&hints, 0, sizeof(hints));\n", INDENT[2]);
+  fprintf( output, "%shints.ai_family = AF_UNSPEC;\n", INDENT[2]);
+  fprintf( output, "%shints.ai_socktype = SOCK_STREAM;\n", INDENT[2]);
+  fprintf( output, "%shints.ai_flags = AI_PASSIVE;\n", INDENT[2]);
+  fprintf( output, "%sif( getaddrinfo(host.empty() ? NULL : host.c_str(), colon + 1, &hints, &list) ) {\n", INDENT[2]);
+  fprintf( output, "%scerr << \"ArchC: Could not resolve \" << where << endl;\n", INDENT[3]);
+  fprintf( output, "%sreturn -1;\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[2]);
+  fprintf( output, "%sfor( a = list; a && fd == -1; a = a->ai_next ) {\n", INDENT[2]);
+  fprintf( output, "%sif( (fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol)) == -1 )\n", INDENT[3]);
+  fprintf( output, "%scontinue;\n", INDENT[4]);
+  fprintf( output, "%ssetsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));\n", INDENT[3]);
+  fprintf( output, "%sif( bind(fd, a->ai_addr, a->ai_addrlen) == -1 ) {\n", INDENT[3]);
+  fprintf( output, "%sclose(fd);\n", INDENT[4]);
+  fprintf( output, "%sfd = -1;\n", INDENT[4]);
+  fprintf( output, "%s}\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[2]);
+  fprintf( output, "%sfreeaddrinfo(list);\n", INDENT[2]);
+  fprintf( output, "%s}\n\n", INDENT[1]);
+
+  fprintf( output, "%sif( fd == -1 || listen(fd, 64) == -1 ) {\n", INDENT[1]);
+  fprintf( output, "%sperror(\"ArchC: listen\");\n", INDENT[2]);
+  fprintf( output, "%sif( fd != -1 )\n", INDENT[2]);
+  fprintf( output, "%sclose(fd);\n", INDENT[3]);
+  fprintf( output, "%sreturn -1;\n", INDENT[2]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%sreturn fd;\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+
+  COMMENT(INDENT[0], "Writes all of text on fd.");
+  fprintf( output, "static void write_all(int fd, const std::string& text)\n");
+  fprintf( output, "{\n");
+  fprintf( output, "%ssize_t done = 0;\n", INDENT[1]);
+  fprintf( output, "%sssize_t n;\n\n", INDENT[1]);
+  fprintf( output, "%swhile( done < text.size() && ((n = write(fd, text.data() + done, text.size() - done)) > 0 || errno == EINTR) )\n", INDENT[1]);
+  fprintf( output, "%sif( n > 0 )\n", INDENT[2]);
+  fprintf( output, "%sdone += n;\n", INDENT[3]);
+  fprintf( output, "}\n\n");
+
+  COMMENT(INDENT[0], "Serves one connection: reads a job line, runs the job and writes how it ended. Returns the exit status of the session.");
+  fprintf( output, "static int run_session(%s& proc, int conn, char* av0)\n", project_name);
+  fprintf( output, "{\n");
+  fprintf( output, "%sstd::string line;\n", INDENT[1]);
+  fprintf( output, "%sstd::ostringstream end;\n", INDENT[1]);
+  fprintf( output, "%sbatch_job job;\n", INDENT[1]);
+  fprintf( output, "%schar c;\n", INDENT[1]);
+  fprintf( output, "%sint status;\n", INDENT[1]);
+  fprintf( output, "%spid_t pid;\n\n", INDENT[1]);
+
+  //One byte at a time, so that what follows the line is left to the job
+  fprintf( output, "%swhile( read(conn, &c, 1) == 1 && c != '\\n' )\n", INDENT[1]);
+  fprintf( output, "%sline += c;\n", INDENT[2]);
+  fprintf( output, "%sif( !parse_job(line, job) ) {\n", INDENT[1]);
+  fprintf( output, "%swrite_all(conn, \"ArchC: No job\\n\");\n", INDENT[2]);
+  fprintf( output, "%sreturn EXIT_FAILURE;\n", INDENT[2]);
+  fprintf( output, "%s}\n\n", INDENT[1]);
+
+  fprintf( output, "%sif( (pid = fork()) == 0 )\n", INDENT[1]);
+  fprintf( output, "%sexit(run_job(proc, job, av0, conn));\n", INDENT[2]);
+  fprintf( output, "%sif( pid == -1 ) {\n", INDENT[1]);
+  fprintf( output, "%swrite_all(conn, \"ArchC: Could not fork the job\\n\");\n", INDENT[2]);
+  fprintf( output, "%sreturn EXIT_FAILURE;\n", INDENT[2]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%swhile( waitpid(pid, &status, 0) == -1 )\n", INDENT[1]);
+  fprintf( output, "%sif( errno != EINTR )\n", INDENT[2]);
+  fprintf( output, "%sreturn EXIT_FAILURE;\n", INDENT[3]);
+
+  fprintf( output, "%send << \"ArchC: Job \" << job.name;\n", INDENT[1]);
+  fprintf( output, "%sif( WIFEXITED(status) )\n", INDENT[1]);
+  fprintf( output, "%send << \" exited with status \" << WEXITSTATUS(status) << endl;\n", INDENT[2]);
+  fprintf( output, "%selse\n", INDENT[1]);
+  fprintf( output, "%send << \" killed by signal \" << WTERMSIG(status) << endl;\n", INDENT[2]);
+  fprintf( output, "%swrite_all(conn, end.str());\n", INDENT[1]);
+  fprintf( output, "%scerr << end.str();\n", INDENT[1]);
+  fprintf( output, "%sreturn WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+
+  COMMENT(INDENT[0], "Serves jobs on where until killed, at most max_jobs at a time. Returns 1 if it could not listen.");
+  fprintf( output, "static int run_server(%s& proc, const char* where, int max_jobs, char* av0)\n", project_name);
+  fprintf( output, "{\n");
+  fprintf( output, "%sint fd = open_server_socket(where), running = 0;\n\n", INDENT[1]);
+
+  fprintf( output, "%sif( fd == -1 )\n", INDENT[1]);
+  fprintf( output, "%sreturn 1;\n", INDENT[2]);
+  fprintf( output, "%sif( max_jobs <= 0 )\n", INDENT[1]);
+  fprintf( output, "%smax_jobs = sysconf(_SC_NPROCESSORS_ONLN);\n", INDENT[2]);
+  //A client that hangs up early must not take the server down with it
+  fprintf( output, "%ssignal(SIGPIPE, SIG_IGN);\n", INDENT[1]);
+  fprintf( output, "%scerr << \"ArchC: Serving jobs on \" << where << endl;\n\n", INDENT[1]);
+
+  fprintf( output, "%swhile( true ) {\n", INDENT[1]);
+  fprintf( output, "%sint conn;\n", INDENT[2]);
+  fprintf( output, "%spid_t pid;\n\n", INDENT[2]);
+
+  fprintf( output, "%swhile( running && waitpid(-1, NULL, running >= max_jobs ? 0 : WNOHANG) > 0 )\n", INDENT[2]);
+  fprintf( output, "%srunning--;\n", INDENT[3]);
+  fprintf( output, "%sif( (conn = accept(fd, NULL, NULL)) == -1 ) {\n", INDENT[2]);
+  fprintf( output, "%sif( errno == EINTR || errno == ECONNABORTED )\n", INDENT[3]);
+  fprintf( output, "%scontinue;\n", INDENT[4]);
+  fprintf( output, "%sperror(\"ArchC: accept\");\n", INDENT[3]);
+  fprintf( output, "%sbreak;\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[2]);
+  fprintf( output, "%sfflush(NULL);\n", INDENT[2]);
+  fprintf( output, "%sif( (pid = fork()) == 0 ) {\n", INDENT[2]);
+  fprintf( output, "%sclose(fd);\n", INDENT[3]);
+  fprintf( output, "%sexit(run_session(proc, conn, av0));\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[2]);
+  fprintf( output, "%sif( pid == -1 )\n", INDENT[2]);
+  fprintf( output, "%sperror(\"ArchC: fork\");\n", INDENT[3]);
+  fprintf( output, "%selse\n", INDENT[2]);
+  fprintf( output, "%srunning++;\n", INDENT[3]);
+  fprintf( output, "%sclose(conn);\n", INDENT[2]);
+  fprintf( output, "%s}\n\n", INDENT[1]);
+
+  fprintf( output, "%sclose(fd);\n", INDENT[1]);
+  fprintf( output, "%sreturn 1;\n", INDENT[1]);
+  fprintf( output, "}\n");
 }
 
 
@@ -2739,7 +4503,7 @@ void CreateImplTmpl(){
   int count_fields;
 
   sprintf( filename, "%s_isa.cpp.tmpl", project_name);
-  if ( !(output = fopen( filename, "w"))){
+  if ( !(output = open_output( filename))){
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -2838,13 +4602,13 @@ void CreateImplTmpl(){
   }
 
   //!END OF FILE.
-  fclose(output);
+  close_output( output, filename);
 
 
   /* ac_isa_init creation starts here */
   /* Name for ISA initialization file. */
   sprintf( initfilename, "%s_isa_init.cpp", project_name);
-  if ( !(output = fopen( initfilename, "w"))){
+  if ( !(output = open_output( initfilename))){
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -2995,21 +4759,27 @@ void CreateImplTmpl(){
   fprintf(output, "const ac_instr_info\n");
   fprintf(output, "%s_parms::%s_isa::instr_table[%s_parms::AC_DEC_INSTR_NUMBER + 1] = {\n",
           project_name, project_name, project_name);
-  fprintf(output, "%sac_instr_info(0, \"_ac_invalid_\", \"_ac_invalid_\", %d),\n", INDENT[1], wordsize / 8);
+  fprintf(output, "%sac_instr_info(0, \"_ac_invalid_\", \"_ac_invalid_\", %d, 1, 1, 1),\n", INDENT[1], wordsize / 8);
   for (pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next) {
-    fprintf(output, "%sac_instr_info(%d, \"%s\", \"%s\", %d)",
+    fprintf(output, "%sac_instr_info(%d, \"%s\", \"%s\", %d, %d, %d, %d)",
             INDENT[1],
             pinstr->id,
             pinstr->name,
             pinstr->mnemonic,
-            pinstr->size);
+            pinstr->size,
+            pinstr->cycles,
+            pinstr->min_latency,
+            pinstr->max_latency);
     if (pinstr->next)
       fprintf(output, ",\n");
   }
   fprintf(output, "\n};\n");
 
+  if( ACTableDecoderFlag )
+    EmitTableDecoder(output);
+
   //!END OF FILE.
-  fclose(output);
+  close_output( output, initfilename);
 
 }
 
@@ -3027,7 +4797,7 @@ void CreateIntrTmpl() {
 
   sprintf(filename, "%s_intr_handlers.cpp.tmpl", project_name);
 
-  if (!(output = fopen( filename, "w"))) {
+  if (!(output = open_output( filename))) {
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -3048,7 +4818,7 @@ void CreateIntrTmpl() {
   }
 
   //END OF FILE.
-  fclose(output);
+  close_output( output, filename);
 }
 
 
@@ -3065,7 +4835,7 @@ void CreateRegsImpl() {
 
   sprintf(filename, "%s_regs.cpp.tmpl", project_name);
   
-  if ( !(output = fopen( filename, "w"))){
+  if ( !(output = open_output( filename))){
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -3086,7 +4856,7 @@ void CreateRegsImpl() {
     }
   }
   //END OF FILE.
-  fclose(output);
+  close_output( output, filename);
 }
 
 
@@ -3099,7 +4869,7 @@ void CreateArchSyscallHeader()
 
   snprintf(filename, 50, "%s_syscall.H.tmpl", project_name);
 
-  if ( !(output = fopen( filename, "w"))){
+  if ( !(output = open_output( filename))){
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -3117,10 +4887,10 @@ void CreateArchSyscallHeader()
           "#include \"ac_syscall.H\"\n"
           "\n"
           "//%s system calls\n"
-          "class %s_syscall : public ac_syscall<%s_parms::ac_word, %s_parms::ac_Hword>, public %s_arch_ref\n"
+          "class %s_syscall : public ac_syscall<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms>, public %s_arch_ref\n"
           "{\n"
           "public:\n"
-          "  %s_syscall(%s_arch& ref) : ac_syscall<%s_parms::ac_word, %s_parms::ac_Hword>(ref, %s_parms::AC_RAMSIZE), %s_arch_ref(ref) {};\n"
+          "  %s_syscall(%s_arch& ref) : ac_syscall<%s_parms::ac_word, %s_parms::ac_Hword, %s_parms::ac_fixed_parms>(ref, %s_parms::AC_RAMSIZE), %s_arch_ref(ref) {};\n"
           "  virtual ~%s_syscall() {};\n\n"
           "  void get_buffer(int argn, unsigned char* buf, unsigned int size);\n"
           "  void set_buffer(int argn, unsigned char* buf, unsigned int size);\n"
@@ -3136,9 +4906,9 @@ void CreateArchSyscallHeader()
           project_name, project_name, project_name, project_name,
           project_name, project_name, project_name, project_name,
           project_name, project_name, project_name, project_name,
-          project_name);
+          project_name, project_name, project_name);
 
-  fclose( output);
+  close_output( output, filename);
 }
 
 
@@ -3159,7 +4929,7 @@ void CreateIntrHeader() {
 
   sprintf(filename, "%s_intr_handlers.H", project_name);
 
-  if (!(output = fopen( filename, "w"))) {
+  if (!(output = open_output( filename))) {
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -3189,7 +4959,7 @@ void CreateIntrHeader() {
   fprintf(output, "#endif // _%s_INTR_HANDLERS_H\n", upper_project_name);
 
   //END OF FILE
-  fclose(output);
+  close_output( output, filename);
 
 }
 
@@ -3206,7 +4976,7 @@ void CreateIntrMacrosHeader() {
 
   sprintf(filename, "%s_ih_bhv_macros.H", project_name);
 
-  if (!(output = fopen( filename, "w"))) {
+  if (!(output = open_output( filename))) {
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -3222,7 +4992,7 @@ void CreateIntrMacrosHeader() {
   fprintf(output, "#endif // _%s_IH_BHV_MACROS_H\n", upper_project_name);
 
   //END OF FILE
-  fclose(output);
+  close_output( output, filename);
 
 }
 
@@ -3244,7 +5014,7 @@ void CreateMakefile(){
   FILE *output;
   char filename[] = "Makefile.archc";
 
-  if ( !(output = fopen( filename, "w"))){
+  if ( !(output = open_output( filename))){
     perror("ArchC could not open output file");
     exit(1);
   }
@@ -3289,13 +5059,36 @@ void CreateMakefile(){
 
   fprintf( output, "LIB_SYSTEMC := %s\n",
            (strlen(SYSTEMC_PATH) > 2) ? "-lsystemc" : "");
-  fprintf( output, "LIBS := $(LIB_SYSTEMC) -lm $(EXTRA_LIBS) -larchc\n");
-  fprintf( output, "CC :=  %s\n", CC_PATH);
+  fprintf( output, "LIBS := $(LIB_SYSTEMC) -lm $(EXTRA_LIBS) -larchc%s%s%s\n",
+           (ACPreDecodeFlag || ACMultiCoreFlag || ACMemTraceFlag) ? " -lpthread" : "",
+           (ACVerifyFlag) ? " -lrt" : "",
+           (ACPluginsFlag) ? " -ldl -rdynamic" : "");
+  //MPI programs are built by its compiler wrapper, which calls the usual one.
+  if (ACMPIFlag)
+    fprintf( output, "CC :=  mpicxx\n");
+  else
+    fprintf( output, "CC :=  %s\n", CC_PATH);
   fprintf( output, "OPT :=  %s\n", OPT_FLAGS);
   fprintf( output, "DEBUG :=  %s\n", DEBUG_FLAGS);
   fprintf( output, "OTHER :=  %s\n", OTHER_FLAGS);
-  fprintf( output, "CFLAGS := $(DEBUG) $(OPT) $(OTHER) %s\n",
-           (ACGDBIntegrationFlag) ? "-DUSE_GDB" : "" );
+  fprintf( output, "CFLAGS := $(DEBUG) $(OPT) $(OTHER) %s%s\n",
+           (ACGDBIntegrationFlag) ? "-DUSE_GDB " : "",
+           (ACSyncRegDirtyFlag) ? "-DAC_SYNC_REG_DIRTY" : "" );
+
+  fprintf( output, "\n");
+
+  COMMENT_MAKE("Profile-guided and link-time optimized builds (GCC flags, see the pgo-gen, pgo-use and lto targets)");
+  COMMENT_MAKE("PGO_RUN holds the simulator arguments of the training run, e.g. PGO_RUN=\"--load=prog input\"");
+  fprintf( output, "PGO_RUN :=\n");
+  fprintf( output, "PGO_DIR := $(CURDIR)/pgo-data\n");
+  fprintf( output, "PGO_GEN_FLAGS := -fprofile-generate -fprofile-update=atomic -fprofile-dir=$(PGO_DIR)\n");
+  fprintf( output, "PGO_USE_FLAGS := -fprofile-use -fprofile-correction -Wno-missing-profile -fprofile-dir=$(PGO_DIR)\n");
+  COMMENT_MAKE("libarchc is optimized with the model only when it was built with -flto -ffat-lto-objects too");
+  fprintf( output, "LTO_FLAGS := -flto=auto\n");
+  COMMENT_MAKE("SystemC and ArchC headers precompiled for every source, and the sources as one unit (see the pch and unity targets)");
+  fprintf( output, "PCH_HEAD := $(MODULE)_pch.H\n");
+  fprintf( output, "UNITY_SRC := $(MODULE)_unity.cpp\n");
+  fprintf( output, "THIS_MAKEFILE := $(lastword $(MAKEFILE_LIST))\n");
 
   fprintf( output, "\n");
 
@@ -3338,7 +5131,7 @@ void CreateMakefile(){
   //Declaring ACHEAD variable
 
   COMMENT_MAKE("These are the header files automatically generated by ArchC");
-  fprintf( output, "ACHEAD := $(MODULE)_parms.H $(MODULE)_arch.H $(MODULE)_arch_ref.H $(MODULE)_isa.H $(MODULE)_bhv_macros.H ");
+  fprintf( output, "ACHEAD := $(MODULE)_parms.H $(MODULE)_arch.H $(MODULE)_arch_ref.H $(MODULE)_isa.H $(MODULE)_bhv_macros.H $(MODULE)_pch.H ");
 
   if(HaveFormattedRegs)
     fprintf( output, "$(MODULE)_fmt_regs.H ");
@@ -3392,9 +5185,9 @@ void CreateMakefile(){
   if(ACABIFlag)
     fprintf(output, "ac_syscall.o ");
   if(HaveTLMPorts)
-    fprintf(output, "ac_tlm_port.o ");
+    fprintf(output, "%s.o ", TLM_PORT_CLASS);
   if(HaveTLMIntrPorts)
-    fprintf(output, "ac_tlm_intr_port.o ");
+    fprintf(output, "%s.o ", TLM_INTR_PORT_CLASS);
   fprintf(output, "\n\n");
 
   //Declaring FILESHEAD variable
@@ -3404,9 +5197,9 @@ void CreateMakefile(){
   if (ACABIFlag)
     fprintf(output, "ac_syscall.H ");
   if (HaveTLMPorts)
-    fprintf(output, "ac_tlm_port.H ");
+    fprintf(output, "%s.H ", TLM_PORT_CLASS);
   if (HaveTLMIntrPorts)
-    fprintf(output, "ac_tlm_intr_port.H ");
+    fprintf(output, "%s.H ", TLM_INTR_PORT_CLASS);
   if (HaveTLMPorts || HaveTLMIntrPorts)
     fprintf(output, "ac_tlm_protocol.H ");
   if (ACStatsFlag)
@@ -3440,10 +5233,12 @@ void CreateMakefile(){
   //Declaring dependencie rules
   fprintf( output, ".SUFFIXES: .cc .cpp .o .x\n\n");
 
-  fprintf( output, "all: $(addprefix %s/, $(ACFILESHEAD))", INCLUDEDIR);
+  fprintf( output, "PREREQS := $(addprefix %s/, $(ACFILESHEAD))", INCLUDEDIR);
   if (ACABIFlag)
     fprintf( output, " $(MODULE)_syscall.H");
-  fprintf( output, " $(ACHEAD) $(ACFILES) $(EXE)\n\n");
+  fprintf( output, " $(ACHEAD) $(ACFILES)\n\n");
+
+  fprintf( output, "all: $(PREREQS) $(EXE)\n\n");
 
   fprintf( output, "$(EXE): $(OBJS) %s\n",
            (strlen(SYSTEMC_PATH) > 2) ? "$(SYSTEMC)/lib-$(TARGET_ARCH)/libsystemc.a" : "");
@@ -3481,17 +5276,94 @@ void CreateMakefile(){
   fprintf( output, ".cc.o:\n");
   fprintf( output, "\t$(CC) $(CFLAGS) $(INC_DIR) -c $<\n\n");
 
+  COMMENT_MAKE("Instrumented build, profiled by a run of $(PGO_RUN)");
+  fprintf( output, "pgo-gen:\n");
+  fprintf( output, "\t@test -n \"$(PGO_RUN)\" || { echo \"Set PGO_RUN to the simulator arguments of the training run.\"; exit 1; }\n");
+  fprintf( output, "\t$(MAKE) -f $(THIS_MAKEFILE) clean\n");
+  fprintf( output, "\trm -rf $(PGO_DIR)\n");
+  fprintf( output, "\t$(MAKE) -f $(THIS_MAKEFILE) all OPT=\"$(OPT) $(PGO_GEN_FLAGS)\"\n");
+  fprintf( output, "\t./$(EXE) $(PGO_RUN)\n\n");
+
+  COMMENT_MAKE("Rebuild with the profile left by pgo-gen, and link-time optimization");
+  fprintf( output, "pgo-use:\n");
+  fprintf( output, "\t@test -d $(PGO_DIR) || { echo \"No profile in $(PGO_DIR), run make pgo-gen first.\"; exit 1; }\n");
+  fprintf( output, "\t$(MAKE) -f $(THIS_MAKEFILE) clean\n");
+  fprintf( output, "\t$(MAKE) -f $(THIS_MAKEFILE) all OPT=\"$(OPT) $(PGO_USE_FLAGS) $(LTO_FLAGS)\"\n\n");
+
+  COMMENT_MAKE("Link-time optimized build, without a profile");
+  fprintf( output, "lto:\n");
+  fprintf( output, "\t$(MAKE) -f $(THIS_MAKEFILE) clean\n");
+  fprintf( output, "\t$(MAKE) -f $(THIS_MAKEFILE) all OPT=\"$(OPT) $(LTO_FLAGS)\"\n\n");
+
+  COMMENT_MAKE("Build with $(PCH_HEAD) precompiled and forced into every source");
+  fprintf( output, "$(PCH_HEAD).gch: $(PCH_HEAD)\n");
+  fprintf( output, "\t$(CC) $(CFLAGS) $(INC_DIR) -x c++-header -o $@ $<\n\n");
+  fprintf( output, "pch: $(PCH_HEAD).gch\n");
+  fprintf( output, "\t$(MAKE) -f $(THIS_MAKEFILE) all OTHER=\"$(OTHER) -include $(PCH_HEAD) -Winvalid-pch\"\n\n");
+
+  COMMENT_MAKE("Build all the sources as one translation unit, so that behaviors inline into the simulation loop");
+  fprintf( output, "$(UNITY_SRC): $(THIS_MAKEFILE)\n");
+  fprintf( output, "\trm -f $@\n");
+  fprintf( output, "\tfor f in $(SRCS); do echo \"#include \\\"$$f\\\"\" >> $@; done\n\n");
+  fprintf( output, "unity: $(PREREQS) $(SRCS) $(UNITY_SRC)\n");
+  fprintf( output, "\t$(CC) $(CFLAGS) $(INC_DIR) $(LIB_DIR) -o $(EXE) $(UNITY_SRC) $(LIBS) 2>&1 | c++filt\n\n");
+
+  fprintf( output, ".PHONY: pgo-gen pgo-use lto pch unity\n\n");
+
   fprintf( output, "clean:\n");
-  fprintf( output, "\trm -f $(OBJS) *~ $(EXE) core *.o \n\n");
+  fprintf( output, "\trm -f $(OBJS) *~ $(EXE) core *.o $(UNITY_SRC) $(PCH_HEAD).gch \n\n");
 
   fprintf( output, "model_clean:\n");
-  fprintf( output, "\trm -f $(ACSRCS) $(ACHEAD) $(ACINCS) $(ACFILESHEAD) $(ACFILES) *.tmpl loader.ac \n\n");
+  fprintf( output, "\trm -f $(ACSRCS) $(ACHEAD) $(ACINCS) $(ACFILESHEAD) $(ACFILES) *.tmpl loader.ac %s\n\n", ACSIM_MANIFEST);
 
   fprintf( output, "sim_clean: clean model_clean\n\n");
 
   fprintf( output, "distclean: sim_clean\n");
-  fprintf( output, "\trm -f main.cpp Makefile.archc\n\n");
+  fprintf( output, "\trm -f main.cpp Makefile.archc\n");
+  fprintf( output, "\trm -rf $(PGO_DIR)\n\n");
+
+  close_output( output, filename);
+}
+
+
+/*!Create the header of the SystemC and ArchC includes the Makefile
+   precompiles. The model headers are left out: they change with every
+   acsim run, and the precompiled header would with them. */
+void CreatePchHeader(){
+  extern char *project_name;
+  extern int HaveTLMPorts;
+  extern int HaveTLMIntrPorts;
+  FILE *output;
+  char filename[256];
+
+  sprintf( filename, "%s_pch.H", project_name);
+  if ( !(output = open_output( filename))){
+    perror("ArchC could not open output file");
+    exit(1);
+  }
+
+  print_comment( output, "ArchC headers precompiled by the Makefile.");
+
+  fprintf( output, "#ifndef _%s_PCH_H\n", project_name);
+  fprintf( output, "#define _%s_PCH_H\n\n", project_name);
+  fprintf( output, "#include  <systemc.h>\n");
+  fprintf( output, "#include  \"ac_module.H\"\n");
+  fprintf( output, "#include  \"ac_utils.H\"\n");
+  fprintf( output, "#include  \"ac_storage.H\"\n");
+  fprintf( output, "#include  \"ac_memport.H\"\n");
+  fprintf( output, "#include  \"ac_reg.H\"\n");
+  fprintf( output, "#include  \"ac_regbank.H\"\n");
+  if (ACABIFlag)
+    fprintf( output, "#include  \"ac_syscall.H\"\n");
+  if (ACGDBIntegrationFlag)
+    fprintf( output, "#include  \"ac_gdb.H\"\n");
+  if (HaveTLMPorts)
+    fprintf( output, "#include  \"%s.H\"\n", TLM_PORT_CLASS);
+  if (HaveTLMIntrPorts)
+    fprintf( output, "#include  \"%s.H\"\n", TLM_INTR_PORT_CLASS);
+  fprintf( output, "\n#endif //_%s_PCH_H\n", project_name);
 
+  close_output( output, filename);
 }
 
 
@@ -3878,6 +5750,9 @@ void EmitPipeUpdateMethod( FILE *output){
 
   fprintf( output, "%sbhv_pc = ac_pc;\n", INDENT[1]);
 
+  if( ACSyncRegDirtyFlag )
+    fprintf( output, "%sac_sync_reg_update();\n", INDENT[1]);
+
   fprintf( output, "%s}\n", INDENT[0]);
 }
 
@@ -3930,6 +5805,9 @@ void EmitMultiPipeUpdateMethod( FILE *output){
   }
 	
   fprintf( output, "%sbhv_pc = ac_pc;\n", INDENT[1]);
+
+  if( ACSyncRegDirtyFlag )
+    fprintf( output, "%sac_sync_reg_update();\n", INDENT[1]);
 	
   fprintf( output, "%s}\n", INDENT[0]);
 }
@@ -3958,15 +5836,18 @@ void EmitUpdateMethod( FILE *output){
     fprintf( output, "%sac_pc.commit_delays(  (double)ac_cycle_counter );\n", INDENT[2]);
 
     fprintf( output, "%sif(!ac_parallel_sig)\n", INDENT[2]);
-    fprintf( output, "%sac_cycle_counter+=1;\n", INDENT[3]);
+    fprintf( output, "%sac_cycle_counter+=%s;\n", INDENT[3], HaveMultiCycleIns ? "ISA.get_cycles()" : "1");
     fprintf( output, "%selse\n", INDENT[2]);
     fprintf( output, "%sac_parallel_sig = 0;\n\n", INDENT[3]);
 
   }
+  //The cycles an instruction counts down take no step of the loop each.
+  else if( HaveMultiCycleIns )
+    fprintf( output, "%sac_cycle_counter+=ISA.get_cycles();\n", INDENT[2]);
 
   fprintf( output, "%sbhv_pc = ac_pc;\n", INDENT[2]);
-  if( HaveMultiCycleIns)
-    fprintf( output, "%sbhv_cycle.write( ac_cycle );\n", INDENT[2]);
+  if( ACSyncRegDirtyFlag )
+    fprintf( output, "%sac_sync_reg_update();\n", INDENT[2]);
   fprintf( output, "%s}\n", INDENT[1]);
   /*   fprintf( output, "%selse{\n", INDENT[1]); */
   /*   fprintf( output, "%sdo_it = do_it.read()^1;\n", INDENT[2]); */
@@ -3978,7 +5859,16 @@ void EmitUpdateMethod( FILE *output){
         fprintf( output, "%s%s.process_request( );\n", INDENT[1], pstorage->name);
     }
   }
+  if (ACCheckpointFlag) {
+    fprintf(output, "%sif( ac_instr_counter >= ac_checkpoint_at )\n", INDENT[1]);
+    fprintf(output, "%sac_checkpoint_now();\n", INDENT[2]);
+  }
+  //SIGUSR1 only asks for the statistics, which are printed here.
+  fprintf(output, "%sif (ac_stats_dump_pending)\n", INDENT[1]);
+  fprintf(output, "%sac_stats_dump();\n", INDENT[2]);
   fprintf(output, "%sif (ac_stop_flag) {\n", INDENT[1]);
+  if( ACRegLocalsFlag )
+    fprintf( output, "%sthis->decode_pc = decode_pc, this->bhv_pc = bhv_pc;\n", INDENT[2]);
   fprintf( output, "%sreturn;\n", INDENT[2]);
   fprintf( output, "%s}\n", INDENT[1]);
 
@@ -3991,7 +5881,29 @@ void EmitUpdateMethod( FILE *output){
 
     fprintf( output, "%selse {\n", INDENT[2]);
     fprintf( output, "%sinstr_in_batch = 0;\n", INDENT[3]);
-    fprintf( output, "%swait(1, SC_NS);\n", INDENT[3]);
+    if( ACRegLocalsFlag )
+      fprintf( output, "%sthis->decode_pc = decode_pc, this->bhv_pc = bhv_pc;\n", INDENT[3]);
+    //The batch just run, one instruction more than its size, and the time
+    //its TLM accesses took. wait() is only called once the local time
+    //reaches the quantum.
+    if (ACTemporalDecouplingFlag)
+      fprintf( output, "%sannotate(sc_time((double) (instr_batch_size + 1) * %s_parms::AC_INSTR_TIME_PS, SC_PS) + ac_port_delays());\n", INDENT[3], project_name);
+    if (ACAdaptiveBatchFlag)
+      fprintf( output, "%sadapt_instr_batch(ac_batch_busy());\n", INDENT[3]);
+    if (ACHostProfileFlag && (ACMultiCoreFlag || !ACTemporalDecouplingFlag))
+      fprintf( output, "%sac_host_phase_scope ac_host_phased(AC_PHASE_WAIT);\n", INDENT[3]);
+    if (ACMultiCoreFlag) {
+      fprintf( output, "%sif( ac_quantum ) {\n", INDENT[3]);
+      fprintf( output, "%sac_quantum->sync();\n", INDENT[4]);
+      //Code the other cores wrote during the quantum is decoded again.
+      if (ACDecInvalidateFlag)
+        fprintf( output, "%sIM->sync_code();\n", INDENT[4]);
+      fprintf( output, "%s}\n", INDENT[3]);
+      fprintf( output, "%selse\n", INDENT[3]);
+      fprintf( output, "%swait(1, SC_NS);\n", INDENT[4]);
+    }
+    else if (!ACTemporalDecouplingFlag)
+      fprintf( output, "%swait(1, SC_NS);\n", INDENT[3]);
     fprintf( output, "%s}\n", INDENT[2]);
 
     fprintf(output, "%s}\n\n", INDENT[1]);
@@ -4003,12 +5915,18 @@ void EmitUpdateMethod( FILE *output){
 
 /**************************************/
 /*!  Emits the if statement that handles instruction decodification
-  \brief Used by EmitProcessorBhv, EmitMultCycleProcessorBhv and CreateStgImpl functions      */
+  \brief Used by EmitProcessorBhv and CreateStgImpl functions      */
 /***************************************/
 void EmitDecodification( FILE *output, int base_indent){
 
   extern int wordsize, fetchsize, HaveMemHier;
   extern char* project_name;
+  const char *decode_call;
+
+  if( ACTableDecoderFlag )
+    decode_call = "ISA.decode_table(IM->fetch(decode_pc), ISA.table_fields)";
+  else
+    decode_call = "(ISA.decoder)->Decode(reinterpret_cast<unsigned char*>(buffer), quant)";
 
   base_indent++;
   if( HaveMemHier ){
@@ -4029,11 +5947,21 @@ void EmitDecodification( FILE *output, int base_indent){
     fprintf( output, "%s}\n", INDENT[base_indent]);
   }
 
-  if( ACDecCacheFlag ){
+  if( ACSparseDecCacheFlag ){
+    fprintf( output, "%sins_cache = dec_cache_slot(decode_pc);\n", INDENT[base_indent]);
+    fprintf( output, "%sif ( !ins_cache->valid ){\n", INDENT[base_indent]);
+  }
+  else if( ACDecCacheFlag ){
     fprintf( output, "%sins_cache = (DEC_CACHE+decode_pc);\n", INDENT[base_indent]);
     fprintf( output, "%sif ( !ins_cache->valid ){\n", INDENT[base_indent]);
   }
 
+  //Fetching and looking the decode cache up counts as fetch, the rest as decode.
+  if( ACHostProfileFlag )
+    fprintf( output, "%sac_host_phase_switch(AC_PHASE_DECODE);\n", INDENT[ACDecCacheFlag ? base_indent+1 : base_indent]);
+  if( HaveDecStats() )
+    fprintf( output, "%sunsigned long long dec_start = dec_stats.decode_start();\n", INDENT[base_indent+1]);
+
   if( !HaveMemHier ){
 
     /*     if (fetchsize == wordsize) */
@@ -4050,6 +5978,9 @@ void EmitDecodification( FILE *output, int base_indent){
 
     /*   fprintf( output, "%squant = AC_FETCHSIZE/8;\n", INDENT[base_indent+1]); */
   fprintf( output, "%squant = 0;\n", INDENT[base_indent+1]);
+  //The decoder fetches from the member.
+  if( ACRegLocalsFlag && !ACTableDecoderFlag )
+    fprintf( output, "%sthis->decode_pc = decode_pc;\n", INDENT[base_indent+1]);
 
     //The Decoder uses a big endian bit stream. So if the host is little endian, convert it!
     /*   if( ac_host_endian == 0 ){ */
@@ -4058,19 +5989,61 @@ void EmitDecodification( FILE *output, int base_indent){
     /*     fprintf( output, "%s}\n", INDENT[base_indent+1]); */
     /*   } */
 
-  if( ACDecCacheFlag ){
-    fprintf( output, "%sins_cache->instr_p = new ac_instr<%s_parms::AC_DEC_FIELD_NUMBER>((ISA.decoder)->Decode(reinterpret_cast<unsigned char*>(buffer), quant));\n", INDENT[base_indent+1], project_name);
+  if( ACFormatStructsFlag ){
+    fprintf( output, "%sinstr_dec = %s;\n", INDENT[base_indent+1], decode_call);
+    fprintf( output, "%sac_dec_fill(ins_cache, instr_dec);\n", INDENT[base_indent+1]);
+    if( ACThreadedDispatchFlag ){
+      fprintf( output, "#ifdef AC_THREADED_DISPATCH\n");
+      fprintf( output, "%sins_cache->handler = ac_dispatch[ins_cache->id];\n", INDENT[base_indent+1]);
+      fprintf( output, "#endif\n");
+    }
+    if( HaveDecStats() )
+      fprintf( output, "%sdec_stats.decode_end(dec_start);\n", INDENT[base_indent+1]);
+    fprintf( output, "%sins_cache->valid = 1;\n", INDENT[base_indent+1]);
+    if( ACDecInvalidateFlag )
+      fprintf( output, "%sIM->mark_code(decode_pc);\n", INDENT[base_indent+1]);
+    fprintf( output, "%s}\n", INDENT[base_indent]);
+  }
+  else if( ACDecCacheFlag ){
+    if( ACDecInvalidateFlag ){
+      //Entries are decoded again after invalidation, so their objects are reused.
+      fprintf( output, "%sif( ins_cache->instr_p )\n", INDENT[base_indent+1]);
+      fprintf( output, "%s*(ins_cache->instr_p) = ac_instr_t(%s);\n", INDENT[base_indent+2], decode_call);
+      fprintf( output, "%selse {\n", INDENT[base_indent+1]);
+      fprintf( output, "%sins_cache->instr_p = new ac_instr<%s_parms::AC_DEC_FIELD_NUMBER>(%s);\n", INDENT[base_indent+2], project_name, decode_call);
+      if( HaveDecStats() )
+        fprintf( output, "%sdec_stats.objects++;\n", INDENT[base_indent+2]);
+      fprintf( output, "%s}\n", INDENT[base_indent+1]);
+    }
+    else {
+      fprintf( output, "%sins_cache->instr_p = new ac_instr<%s_parms::AC_DEC_FIELD_NUMBER>(%s);\n", INDENT[base_indent+1], project_name, decode_call);
+      if( HaveDecStats() )
+        fprintf( output, "%sdec_stats.objects++;\n", INDENT[base_indent+1]);
+    }
+    if( ACThreadedDispatchFlag ){
+      fprintf( output, "#ifdef AC_THREADED_DISPATCH\n");
+      fprintf( output, "%sins_cache->handler = ac_dispatch[ins_cache->instr_p->get(IDENT)];\n", INDENT[base_indent+1]);
+      fprintf( output, "#endif\n");
+    }
+    if( HaveDecStats() )
+      fprintf( output, "%sdec_stats.decode_end(dec_start);\n", INDENT[base_indent+1]);
     fprintf( output, "%sins_cache->valid = 1;\n", INDENT[base_indent+1]);
+    if( ACDecInvalidateFlag )
+      fprintf( output, "%sIM->mark_code(decode_pc);\n", INDENT[base_indent+1]);
     fprintf( output, "%s}\n", INDENT[base_indent]);
     fprintf( output, "%sinstr_vec = ins_cache->instr_p;\n", INDENT[base_indent]);
   }
   else{
-    fprintf( output, "%sinstr_dec = (ISA.decoder)->Decode(reinterpret_cast<unsigned char*>(buffer), quant);\n", INDENT[base_indent]);
-    fprintf( output, "%sinstr_vec = new ac_instr<%s_parms::AC_DEC_FIELD_NUMBER>( instr_dec);\n", INDENT[base_indent], project_name);
+    fprintf( output, "%sinstr_dec = %s;\n", INDENT[base_indent], decode_call);
+    fprintf( output, "%sinstr_slot = ac_instr<%s_parms::AC_DEC_FIELD_NUMBER>( instr_dec);\n", INDENT[base_indent], project_name);
+    fprintf( output, "%sinstr_vec = &instr_slot;\n", INDENT[base_indent]);
   }
 
   //Checking if it is a valid instruction
-  fprintf( output, "%sins_id = instr_vec->get(IDENT);\n\n", INDENT[base_indent]);
+  if( ACFormatStructsFlag )
+    fprintf( output, "%sins_id = ins_cache->id;\n\n", INDENT[base_indent]);
+  else
+    fprintf( output, "%sins_id = instr_vec->get(IDENT);\n\n", INDENT[base_indent]);
   fprintf( output, "%sif( ins_id == 0 ) {\n", INDENT[base_indent]);
   fprintf( output, "%scerr << \"ArchC Error: Unidentified instruction. \" << endl;\n", INDENT[base_indent+1]);
   fprintf( output, "%scerr << \"PC = \" << hex << decode_pc << dec << endl;\n", INDENT[base_indent+1]);
@@ -4084,7 +6057,7 @@ void EmitDecodification( FILE *output, int base_indent){
 
 /**************************************/
 /*!  Emit code for executing instructions
-  \brief Used by EmitProcessorBhv, EmitMultCycleProcessorBhv and CreateStgImpl functions      */
+  \brief Used by EmitProcessorBhv and CreateStgImpl functions      */
 /***************************************/
 void EmitInstrExec( FILE *output, int base_indent){
   extern ac_stg_list *stage_list;
@@ -4100,22 +6073,42 @@ void EmitInstrExec( FILE *output, int base_indent){
   ac_dec_instr *pinstr;
   ac_dec_field *pfield, *pf;
 
+  if( ACHostProfileFlag )
+    fprintf( output, "%sac_host_phase_switch(AC_PHASE_BEHAVIOR);\n", INDENT[base_indent]);
+
+  //Unless a breakpoint is set or gdb is stepping, only the flag is tested.
   if( ACGDBIntegrationFlag )
-    fprintf( output, "%sif (gdbstub && gdbstub->stop(decode_pc)) gdbstub->process_bp();\n\n", INDENT[base_indent]);
+    fprintf( output, "%sif (gdbstub && gdbstub->armed() && gdbstub->stop(decode_pc)) %sgdbstub->process_bp();\n\n", INDENT[base_indent],
+             ACRegLocalsFlag ? "this->decode_pc = decode_pc, " : "");
 
-  fprintf( output, "%sac_pc = decode_pc;\n\n", INDENT[base_indent]);
+  //ac_pc already holds decode_pc, unless gdb changed it or its writes are logged.
+  if( !ACRegLocalsFlag || ACGDBIntegrationFlag || ACVerboseFlag )
+    fprintf( output, "%sac_pc = decode_pc;\n\n", INDENT[base_indent]);
 
-  fprintf(output, "%sISA.cur_instr_id = ins_id;\n", INDENT[base_indent]);
-  fprintf(output, "%sif (!ac_annul_sig) ", INDENT[base_indent]);
+  if( ACMemTraceFlag )
+    fprintf( output, "%sIM->trace_fetch(decode_pc, ISA.instr_table[ins_id].ac_instr_size);\n\n", INDENT[base_indent]);
 
-  //Pipelined archs can annul an instruction through pipelining flushing.
+  if( ACMemHeatmapFlag )
+    fprintf( output, "%sIM->heat_fetch(decode_pc, ISA.instr_table[ins_id].ac_instr_size);\n\n", INDENT[base_indent]);
+
+  //Outside the trace windows, only the PC and count the next trigger waits for are compared.
+  if( ACInstrTraceFlag ){
+    fprintf( output, "%sif( ac_itrace.check(decode_pc, ac_instr_counter) )\n", INDENT[base_indent]);
+    fprintf( output, "%sac_itrace.record(decode_pc, ins_id, ISA.instr_table[ins_id].ac_instr_size, IM->fetch(decode_pc), ISA.instr_table[ins_id].ac_instr_name);\n\n", INDENT[base_indent+1]);
+  }
+
+  fprintf(output, "%sISA.cur_instr_id = ins_id;\n", INDENT[base_indent]);
+
+  //Pipelined archs can annul an instruction through pipelining flushing.
   if(stage_list || pipe_list ){
+    fprintf(output, "%sif (!ac_annul_sig) ", INDENT[base_indent]);
     fprintf( output, "ISA._behavior_instruction( (ac_stage_list) id );\n");
 /*     fprintf( output, "%s(ISA.*(%s_parms::%s_isa::instr_table[ins_id].ac_instr_type_behavior))((ac_stage_list) id);\n", INDENT[base_indent], project_name, project_name); */
 /*     fprintf( output, "%s(ISA.*(%s_parms::%s_isa::instr_table[ins_id].ac_instr_behavior))((ac_stage_list) id);\n", INDENT[base_indent], project_name, project_name); */
   }
-  else{
-    fprintf(output, "ISA._behavior_instruction(");
+  //With format structs or fused handlers each case calls the generic behavior with its own operands.
+  else if( !ACFormatStructsFlag && !ACFusedBehaviorFlag ){
+    fprintf(output, "%sif (!ac_annul_sig) ISA._behavior_instruction(", INDENT[base_indent]);
     /* common_instr_field_list has the list of fields for the generic instruction. */
     for( pfield = common_instr_field_list; pfield != NULL; pfield = pfield->next){
       fprintf(output, "instr_vec->get(%d)", pfield->id);
@@ -4128,19 +6121,57 @@ void EmitInstrExec( FILE *output, int base_indent){
     /*     fprintf( output, "%sif(!ac_annul_sig) (ISA.*(%s_parms::%s_isa::instr_table[ins_id].ac_instr_behavior))();\n", INDENT[base_indent], project_name, project_name); */
   }
 
+  /* Threaded dispatch jumps straight to the case label, skipping the switch test */
+  if( ACThreadedDispatchFlag ){
+    fprintf(output, "#ifdef AC_THREADED_DISPATCH\n");
+    if( ACDecCacheFlag )
+      fprintf(output, "%sgoto *ins_cache->handler;\n", INDENT[base_indent]);
+    else
+      fprintf(output, "%sgoto *ac_dispatch[ins_id];\n", INDENT[base_indent]);
+    fprintf(output, "#endif\n");
+  }
+
   /* Switch statement for instruction selection */
   fprintf(output, "%sswitch (ins_id) {\n", INDENT[base_indent]);
   for (pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next) {
     /* opens case statement */
     fprintf(output, "%scase %d: // Instruction %s\n", INDENT[base_indent], pinstr->id, pinstr->name);
+    if( ACThreadedDispatchFlag )
+      fprintf(output, "%sAC_DISPATCH_LABEL(%s)\n", INDENT[base_indent], pinstr->name);
     /* emits format behavior method call */
     for (pformat = format_ins_list;
          (pformat != NULL) && strcmp(pinstr->format, pformat->name);
          pformat = pformat->next);
+    /* emits the fused handler, which runs the three behaviors */
+    if( ACFusedBehaviorFlag ){
+      fprintf(output, "%sISA._fused_%s(", INDENT[base_indent + 1], pinstr->name);
+      for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next) {
+        EmitFieldOperand(output, pformat, pfield);
+        if (pfield->next != NULL)
+          fprintf(output, ", ");
+      }
+      fprintf(output, ");\n");
+      fprintf(output, "%sbreak;\n", INDENT[base_indent + 1]);
+      continue;
+    }
+    /* emits generic instruction behavior call, fields taken from this format */
+    if( ACFormatStructsFlag ){
+      fprintf(output, "%sif (!ac_annul_sig) ISA._behavior_instruction(", INDENT[base_indent + 1]);
+      for( pfield = common_instr_field_list; pfield != NULL; pfield = pfield->next){
+        for( pf = pformat->fields; pf != NULL && strcmp(pf->name, pfield->name); pf = pf->next);
+        if( pf )
+          fprintf(output, "ins_cache->op.%s.%s", pformat->name, pf->name);
+        else
+          fprintf(output, "0");
+        if (pfield->next != NULL)
+          fprintf(output, ", ");
+      }
+      fprintf(output, ");\n");
+    }
     fprintf(output, "%sif (!ac_annul_sig) ISA._behavior_%s_%s(", INDENT[base_indent + 1],
             project_name, pformat->name);
     for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next) {
-      fprintf(output, "instr_vec->get(%d)", pfield->id);
+      EmitFieldOperand(output, pformat, pfield);
       if (pfield->next != NULL)
         fprintf(output, ", ");
     }
@@ -4149,7 +6180,7 @@ void EmitInstrExec( FILE *output, int base_indent){
     fprintf(output, "%sif (!ac_annul_sig) ISA.behavior_%s(", INDENT[base_indent + 1],
             pinstr->name);
     for (pfield = pformat->fields; pfield != NULL; pfield = pfield->next) {
-      fprintf(output, "instr_vec->get(%d)", pfield->id);
+      EmitFieldOperand(output, pformat, pfield);
       if (pfield->next != NULL)
         fprintf(output, ", ");
     }
@@ -4161,7 +6192,7 @@ void EmitInstrExec( FILE *output, int base_indent){
   if( ACStatsFlag ){
     fprintf( output, "%sif((!ac_annul_sig) && (!ac_wait_sig)) {\n", INDENT[base_indent]);
     fprintf( output, "%sISA.stats[%s_stat_ids::INSTRUCTIONS]++;\n", INDENT[base_indent+1], project_name);
-    fprintf( output, "%s(*(ISA.instr_stats[ins_id]))[%s_instr_stat_ids::COUNT]++;\n", INDENT[base_indent+1], project_name);
+    fprintf( output, "%sISA.instr_counts[ins_id][%s_instr_stat_ids::COUNT]++;\n", INDENT[base_indent+1], project_name);
 
     //If cycle range for instructions were declared, include them on the statistics.
 /*    if( HaveCycleRange ){
@@ -4172,6 +6203,14 @@ void EmitInstrExec( FILE *output, int base_indent){
     fprintf( output, "%s}\n", INDENT[base_indent]);
   }
 
+  //Unregistered hooks cost a test of ac_hooks_active.
+  if( ACPluginsFlag ){
+    fprintf( output, "%sif (AC_HOOK_ON(AC_HOOK_RETIRE) && !ac_annul_sig && !ac_wait_sig)\n", INDENT[base_indent]);
+    fprintf( output, "%sac_hook_retire(decode_pc, ins_id);\n", INDENT[base_indent+1]);
+    fprintf( output, "%sif (AC_HOOK_ON(AC_HOOK_BRANCH) && ac_plugin_branches[ins_id] && !ac_annul_sig && !ac_wait_sig)\n", INDENT[base_indent]);
+    fprintf( output, "%sac_hook_branch(decode_pc, ac_pc);\n", INDENT[base_indent+1]);
+  }
+
   if( ACDebugFlag ){
     fprintf( output, "%sif( ac_do_trace != 0 ) \n", INDENT[base_indent]);
     fprintf( output, PRINT_TRACE, INDENT[base_indent+1]);
@@ -4180,15 +6219,657 @@ void EmitInstrExec( FILE *output, int base_indent){
   if( stage_list || pipe_list )
     fprintf( output, "%sregout.write( *instr_vec);\n", INDENT[base_indent]);
 
-  if(!ACDecCacheFlag){
-    fprintf( output, "%sdelete instr_vec;\n", INDENT[base_indent]);
-    //    fprintf( output, "%sfree(instr_dec);\n", INDENT[base_indent]);
-  }
   //  fprintf( output, "%s}\n", INDENT[base_indent-1]);
 
 }
 
 
+/**************************************/
+/*!  Emits the replay loop for a cached block.
+  The loop leaves the block as soon as control
+  flow diverges from the recorded addresses, the
+  processor waits or stops, or the instruction batch
+  is over. The last instruction run is accounted
+  by the code that follows, as in the normal path.
+  An else branch with the per-instruction path
+  must follow.
+  \brief Used by EmitProcessorBhv functions      */
+/***************************************/
+void EmitBlockExec( FILE *output, int base_indent){
+  extern char *project_name;
+  int threaded = ACThreadedDispatchFlag;
+
+  fprintf( output, "%sif( (blk = ac_block_find(decode_pc)) != 0 ) {\n", INDENT[base_indent]);
+  if( ACPluginsFlag ){
+    fprintf( output, "%sif (AC_HOOK_ON(AC_HOOK_BLOCK))\n", INDENT[base_indent+1]);
+    fprintf( output, "%sac_hook_block(decode_pc, blk->size);\n", INDENT[base_indent+2]);
+  }
+  if( ACHostProfileFlag )
+    fprintf( output, "%sac_host_phase_switch(AC_PHASE_BEHAVIOR);\n", INDENT[base_indent+1]);
+  if( ACJITFlag ){
+    fprintf( output, "#ifdef AC_JIT\n");
+    //Translated code calls no hooks, so it waits while some are registered.
+    if( ACPluginsFlag )
+      fprintf( output, "%sif( !(ac_hooks_active & AC_HOOKS_EXEC) && (blk->code || (++blk->hits == %s_parms::AC_JIT_THRESHOLD && ac_jit_translate(blk))) )\n", INDENT[base_indent+1], project_name);
+    else
+      fprintf( output, "%sif( blk->code || (++blk->hits == %s_parms::AC_JIT_THRESHOLD && ac_jit_translate(blk)) )\n", INDENT[base_indent+1], project_name);
+    if( ACRegLocalsFlag )
+      fprintf( output, "%sthis->decode_pc = decode_pc, blk->code(this);\n", INDENT[base_indent+2]);
+    else
+      fprintf( output, "%sblk->code(this);\n", INDENT[base_indent+2]);
+    fprintf( output, "%selse\n", INDENT[base_indent+1]);
+    fprintf( output, "#endif\n");
+  }
+  fprintf( output, "%sfor( blk_pos = 0; ; ) {\n", INDENT[base_indent+1]);
+  fprintf( output, "%sins_cache = blk->instr[blk_pos];\n", INDENT[base_indent+2]);
+  if( ACFormatStructsFlag )
+    fprintf( output, "%sins_id = ins_cache->id;\n", INDENT[base_indent+2]);
+  else {
+    fprintf( output, "%sinstr_vec = ins_cache->instr_p;\n", INDENT[base_indent+2]);
+    fprintf( output, "%sins_id = instr_vec->get(IDENT);\n", INDENT[base_indent+2]);
+  }
+
+  //Dispatch labels belong to the per-instruction copy, so this one uses the switch.
+  ACThreadedDispatchFlag = 0;
+  EmitInstrExec(output, base_indent+2);
+  ACThreadedDispatchFlag = threaded;
+
+  fprintf( output, "%sif( ++blk_pos == blk->size || ac_wait_sig || ac_stop_flag ||", INDENT[base_indent+2]);
+  if( ACDecInvalidateFlag )
+    fprintf( output, " ac_block_flush ||");
+  if( ACIntrDeferFlag )
+    fprintf( output, " ac_intr_pending ||");
+  fprintf( output, "\n");
+  if( ACWaitFlag )
+    fprintf( output, "%sac_pc != blk->pc[blk_pos] || instr_in_batch >= instr_batch_size )\n", INDENT[base_indent+3]);
+  else
+    fprintf( output, "%sac_pc != blk->pc[blk_pos] )\n", INDENT[base_indent+3]);
+  fprintf( output, "%sbreak;\n", INDENT[base_indent+3]);
+  fprintf( output, "%sif( !ac_annul_sig ) ac_instr_counter+=1;\n", INDENT[base_indent+2]);
+  fprintf( output, "%sac_annul_sig = 0;\n", INDENT[base_indent+2]);
+  if( ACWaitFlag )
+    fprintf( output, "%sinstr_in_batch++;\n", INDENT[base_indent+2]);
+  fprintf( output, "%sdecode_pc = ac_pc;\n", INDENT[base_indent+2]);
+  fprintf( output, "%s}\n", INDENT[base_indent+1]);
+  fprintf( output, "%s}\n", INDENT[base_indent]);
+}
+
+/**************************************/
+/*!  Emits the block cache methods: lookup with
+  chaining, recording and closing of blocks.
+  A block is closed after an instruction declared with
+  is_jump/is_branch and its delay slots, or when full.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitBlockCacheImpl( FILE *output){
+  extern ac_dec_instr *instr_list;
+  extern char *project_name;
+  ac_dec_instr *pinstr;
+
+  COMMENT(INDENT[0], "Instructions that end a block, counting their delay slots, by instruction ID.");
+  fprintf( output, "static const unsigned ac_block_ends[] = { 0");
+  for( pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next)
+    fprintf( output, ", %d", pinstr->cflow ? pinstr->cflow->delay_slot + 1 : 0);
+  fprintf( output, " };\n\n");
+
+  COMMENT(INDENT[0], "Returns the closed block starting at pc, if any. Closes the block being recorded.");
+  fprintf( output, "%s::ac_block_t* %s::ac_block_find(unsigned pc) {\n", project_name, project_name);
+  fprintf( output, "%sac_block_t* blk;\n\n", INDENT[1]);
+  if( ACDecInvalidateFlag ){
+    //Blocks may hold entries of a written page, so all of them are dropped.
+    fprintf( output, "%sif( ac_block_flush ) {\n", INDENT[1]);
+    fprintf( output, "%sfor( std::map<unsigned, ac_block_t*>::iterator it = ac_blocks.begin(); it != ac_blocks.end(); ++it )\n", INDENT[2]);
+    fprintf( output, "%sdelete it->second;\n", INDENT[3]);
+    fprintf( output, "%sac_blocks.clear();\n", INDENT[2]);
+    fprintf( output, "%sdelete ac_block_rec;\n", INDENT[2]);
+    fprintf( output, "%sac_block_rec = 0;\n", INDENT[2]);
+    fprintf( output, "%sac_block_last = 0;\n", INDENT[2]);
+    fprintf( output, "%sac_block_delay = 0;\n", INDENT[2]);
+    fprintf( output, "%sac_block_flush = 0;\n", INDENT[2]);
+    if( HaveDecStats() )
+      fprintf( output, "%sdec_stats.block_flushes++;\n", INDENT[2]);
+    if( ACJITFlag ){
+      fprintf( output, "#ifdef AC_JIT\n");
+      fprintf( output, "%sac_jit_used = 0;\n", INDENT[2]);
+      fprintf( output, "#endif\n");
+    }
+    fprintf( output, "%s}\n\n", INDENT[1]);
+  }
+  if( HaveDecStats() ){
+    fprintf( output, "%sdec_stats.block_lookups++;\n", INDENT[1]);
+    fprintf( output, "%sif( ac_block_last && ac_block_last->succ && ac_block_last->succ->pc[0] == pc ) {\n", INDENT[1]);
+    fprintf( output, "%sdec_stats.block_hits++;\n", INDENT[2]);
+    fprintf( output, "%sdec_stats.block_chains++;\n", INDENT[2]);
+    fprintf( output, "%sreturn ac_block_last = ac_block_last->succ;\n", INDENT[2]);
+    fprintf( output, "%s}\n\n", INDENT[1]);
+  }
+  else {
+    fprintf( output, "%sif( ac_block_last && ac_block_last->succ && ac_block_last->succ->pc[0] == pc )\n", INDENT[1]);
+    fprintf( output, "%sreturn ac_block_last = ac_block_last->succ;\n\n", INDENT[2]);
+  }
+  fprintf( output, "%sstd::map<unsigned, ac_block_t*>::iterator it = ac_blocks.find(pc);\n", INDENT[1]);
+  fprintf( output, "%sblk = (it == ac_blocks.end()) ? 0 : it->second;\n", INDENT[1]);
+  fprintf( output, "%sif( blk ) {\n", INDENT[1]);
+  if( HaveDecStats() )
+    fprintf( output, "%sdec_stats.block_hits++;\n", INDENT[2]);
+  fprintf( output, "%sif( ac_block_rec )\n", INDENT[2]);
+  fprintf( output, "%sac_block_close();\n", INDENT[3]);
+  fprintf( output, "%sif( ac_block_last )\n", INDENT[2]);
+  fprintf( output, "%sac_block_last->succ = blk;\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%sreturn ac_block_last = blk;\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+
+  COMMENT(INDENT[0], "Appends an instruction that ran through the per-instruction path to the block being recorded.");
+  fprintf( output, "void %s::ac_block_record(unsigned pc, cache_item_t* item, unsigned ins_id) {\n", project_name);
+  fprintf( output, "%sif( !ac_block_rec ) {\n", INDENT[1]);
+  fprintf( output, "%sac_block_rec = new ac_block_t;\n", INDENT[2]);
+  fprintf( output, "%sac_block_rec->size = 0;\n", INDENT[2]);
+  fprintf( output, "%sac_block_rec->succ = 0;\n", INDENT[2]);
+  if( ACJITFlag ){
+    fprintf( output, "#ifdef AC_JIT\n");
+    fprintf( output, "%sac_block_rec->hits = 0;\n", INDENT[2]);
+    fprintf( output, "%sac_block_rec->code = 0;\n", INDENT[2]);
+    fprintf( output, "#endif\n");
+  }
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%sac_block_rec->pc[ac_block_rec->size] = pc;\n", INDENT[1]);
+  fprintf( output, "%sac_block_rec->instr[ac_block_rec->size++] = item;\n\n", INDENT[1]);
+  fprintf( output, "%sif( !ac_block_delay )\n", INDENT[1]);
+  fprintf( output, "%sac_block_delay = ac_block_ends[ins_id];\n", INDENT[2]);
+  fprintf( output, "%sif( (ac_block_delay && --ac_block_delay == 0) || ac_block_rec->size == %s_parms::AC_BLOCK_MAX_SIZE )\n", INDENT[1], project_name);
+  fprintf( output, "%sac_block_close();\n", INDENT[2]);
+  fprintf( output, "}\n\n");
+
+  COMMENT(INDENT[0], "Makes the block being recorded available for execution.");
+  fprintf( output, "void %s::ac_block_close() {\n", project_name);
+  fprintf( output, "%sac_block_t*& slot = ac_blocks[ac_block_rec->pc[0]];\n\n", INDENT[1]);
+  if( ACJITFlag ){
+    //Blocks in the hot code of an earlier run skip the warm-up count.
+    fprintf( output, "#ifdef AC_JIT\n");
+    fprintf( output, "%sif( !slot && ac_hot_profile_has(ac_block_rec->pc[0]) )\n", INDENT[1]);
+    fprintf( output, "%sac_block_rec->hits = %s_parms::AC_JIT_THRESHOLD - 1;\n", INDENT[2], project_name);
+    fprintf( output, "#endif\n");
+  }
+  fprintf( output, "%sif( slot )\n", INDENT[1]);
+  fprintf( output, "%sdelete ac_block_rec;\n", INDENT[2]);
+  fprintf( output, "%selse {\n", INDENT[1]);
+  fprintf( output, "%sslot = ac_block_rec;\n", INDENT[2]);
+  if( HaveDecStats() )
+    fprintf( output, "%sdec_stats.blocks++;\n", INDENT[2]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%sac_block_rec = 0;\n", INDENT[1]);
+  fprintf( output, "%sac_block_delay = 0;\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+}
+
+/**************************************/
+/*!  Emits one struct per instruction format holding its
+  decoded fields, each in the smallest type that fits,
+  and the decode cache entry that keeps them in a union.
+  \brief Used by CreateProcessorHeader function      */
+/***************************************/
+void EmitFormatStructs( FILE *output, int base_indent){
+  extern ac_dec_format *format_ins_list;
+  ac_dec_format *pformat;
+  ac_dec_field *pfield;
+  const char *type;
+
+  for( pformat = format_ins_list; pformat != NULL; pformat = pformat->next){
+    fprintf( output, "%sstruct ac_fmt_%s {\n", INDENT[base_indent], pformat->name);
+    for( pfield = pformat->fields; pfield != NULL; pfield = pfield->next){
+      if( pfield->size <= 8 )
+        type = pfield->sign ? "signed char" : "unsigned char";
+      else if( pfield->size <= 16 )
+        type = pfield->sign ? "short" : "unsigned short";
+      else
+        type = pfield->sign ? "int" : "unsigned int";
+      fprintf( output, "%s%s %s;\n", INDENT[base_indent+1], type, pfield->name);
+    }
+    fprintf( output, "%s};\n", INDENT[base_indent]);
+  }
+  fprintf( output, "\n");
+
+  COMMENT(INDENT[base_indent], "Decode cache entry with the operands of the instruction stored inline.");
+  fprintf( output, "%sstruct cache_item_t {\n", INDENT[base_indent]);
+  fprintf( output, "%sbool valid;\n", INDENT[base_indent+1]);
+  fprintf( output, "%sunsigned short id; \t //!< Instruction ID, 0 if unidentified.\n", INDENT[base_indent+1]);
+  if( ACThreadedDispatchFlag )
+    fprintf( output, "%svoid* handler; \t //!< Dispatch label, used by threaded-code simulators.\n", INDENT[base_indent+1]);
+  fprintf( output, "%sunion {\n", INDENT[base_indent+1]);
+  for( pformat = format_ins_list; pformat != NULL; pformat = pformat->next)
+    fprintf( output, "%sac_fmt_%s %s;\n", INDENT[base_indent+2], pformat->name, pformat->name);
+  fprintf( output, "%s} op;\n", INDENT[base_indent+1]);
+  fprintf( output, "%s};\n", INDENT[base_indent]);
+}
+
+/**************************************/
+/*!  Emits the method that copies the fields returned
+  by the decoder into a decode cache entry, using the
+  format of the decoded instruction.
+  \brief Used by CreateProcessorHeader function      */
+/***************************************/
+void EmitFormatFill( FILE *output, int base_indent){
+  extern ac_dec_instr *instr_list;
+  extern ac_dec_format *format_ins_list;
+  ac_dec_format *pformat;
+  ac_dec_instr *pinstr;
+  ac_dec_field *pfield;
+
+  fprintf( output, "\n");
+  COMMENT(INDENT[base_indent], "Fills a decode cache entry from the decoder output.");
+  fprintf( output, "%sinline void ac_dec_fill(cache_item_t* item, unsigned* fields) {\n", INDENT[base_indent]);
+  fprintf( output, "%sitem->id = fields ? fields[IDENT] : 0;\n", INDENT[base_indent+1]);
+  fprintf( output, "%sswitch( item->id ) {\n", INDENT[base_indent+1]);
+  for( pformat = format_ins_list; pformat != NULL; pformat = pformat->next){
+    for( pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next)
+      if( !strcmp(pinstr->format, pformat->name) )
+        fprintf( output, "%scase %d: // Instruction %s\n", INDENT[base_indent+1], pinstr->id, pinstr->name);
+    for( pfield = pformat->fields; pfield != NULL; pfield = pfield->next)
+      fprintf( output, "%sitem->op.%s.%s = fields[%d];\n", INDENT[base_indent+2], pformat->name, pfield->name, pfield->id);
+    fprintf( output, "%sbreak;\n", INDENT[base_indent+2]);
+  }
+  fprintf( output, "%s}\n", INDENT[base_indent+1]);
+  fprintf( output, "%s}\n", INDENT[base_indent]);
+}
+
+/**************************************/
+/*!  Emits the expression of a decoded field used as
+  a behavior method argument.
+  \brief Used by EmitInstrExec function      */
+/***************************************/
+void EmitFieldOperand( FILE *output, ac_dec_format *pformat, ac_dec_field *pfield){
+
+  if( ACFormatStructsFlag )
+    fprintf( output, "ins_cache->op.%s.%s", pformat->name, pfield->name);
+  else
+    fprintf( output, "instr_vec->get(%d)", pfield->id);
+}
+
+/**************************************/
+/*!  Emits the expression that extracts a field from
+  an instruction word, with the same bit numbering
+  used by GetBits for the target endianness.
+  \brief Used by EmitTableDecoder functions      */
+/***************************************/
+void EmitFieldExtract( FILE *output, ac_dec_field *pfield){
+  extern int wordsize;
+  int shift;
+
+  if( ac_tgt_endian )
+    shift = wordsize - 1 - pfield->first_bit;
+  else
+    shift = pfield->first_bit - (pfield->size - 1);
+
+  if( pfield->sign )
+    fprintf( output, "(unsigned)(((int)(word << %d)) >> %d)", 32 - pfield->size - shift, 32 - pfield->size);
+  else if( pfield->size < 32 )
+    fprintf( output, "((word >> %d) & 0x%xU)", shift, (1U << pfield->size) - 1);
+  else
+    fprintf( output, "((unsigned)word)");
+}
+
+/**************************************/
+/*!  Emits one level of the decode tables.
+  The field checked by most candidates is switched
+  on. Candidates that do not check it go to every
+  case and to the default. When no check is left
+  the first declared candidate is taken.
+  \brief Used by EmitTableDecoder function      */
+/***************************************/
+void EmitDecodeNode( FILE *output, ac_dec_instr **cands, int n, char *used, int base_indent){
+  extern ac_decoder_full *decoder;
+  ac_dec_instr **sub;
+  ac_dec_list *pdeclist, *pcheck;
+  ac_dec_field *pfield;
+  int i, j, k, nsub, best, best_count, count;
+  int indent = (base_indent > 6) ? 6 : base_indent;
+
+  if( n == 0 )
+    return;
+
+  /* Picks the unused field checked by most candidates */
+  best = 0;
+  best_count = 0;
+  for( i = 0; i < n; i++ )
+    for( pdeclist = cands[i]->dec_list; pdeclist != NULL; pdeclist = pdeclist->next ){
+      if( used[pdeclist->id] )
+        continue;
+      count = 0;
+      for( j = 0; j < n; j++ )
+        for( pcheck = cands[j]->dec_list; pcheck != NULL; pcheck = pcheck->next )
+          if( pcheck->id == pdeclist->id ){
+            count++;
+            break;
+          }
+      if( count > best_count ){
+        best = pdeclist->id;
+        best_count = count;
+      }
+    }
+
+  if( best == 0 ){
+    fprintf( output, "%sid = %d; // %s\n", INDENT[indent], cands[0]->id, cands[0]->name);
+    return;
+  }
+
+  pfield = FindDecField(decoder->fields, best);
+  used[best] = 1;
+  sub = (ac_dec_instr**) malloc(sizeof(ac_dec_instr*) * n);
+
+  fprintf( output, "%sswitch( ", INDENT[indent]);
+  EmitFieldExtract(output, pfield);
+  fprintf( output, " ) { // %s\n", pfield->name);
+
+  for( i = 0; i < n; i++ ){
+    for( pcheck = cands[i]->dec_list; pcheck != NULL && pcheck->id != best; pcheck = pcheck->next);
+    if( pcheck == NULL )
+      continue;
+
+    /* Skips values already emitted by an earlier candidate */
+    for( k = 0; k < i; k++ ){
+      for( pdeclist = cands[k]->dec_list; pdeclist != NULL && pdeclist->id != best; pdeclist = pdeclist->next);
+      if( pdeclist != NULL && pdeclist->value == pcheck->value )
+        break;
+    }
+    if( k < i )
+      continue;
+
+    nsub = 0;
+    for( j = 0; j < n; j++ ){
+      for( pdeclist = cands[j]->dec_list; pdeclist != NULL && pdeclist->id != best; pdeclist = pdeclist->next);
+      if( pdeclist == NULL || pdeclist->value == pcheck->value )
+        sub[nsub++] = cands[j];
+    }
+    fprintf( output, "%scase %d:\n", INDENT[indent], pcheck->value);
+    EmitDecodeNode(output, sub, nsub, used, base_indent + 1);
+    fprintf( output, "%sbreak;\n", INDENT[(indent > 5) ? 6 : indent + 1]);
+  }
+
+  nsub = 0;
+  for( j = 0; j < n; j++ ){
+    for( pdeclist = cands[j]->dec_list; pdeclist != NULL && pdeclist->id != best; pdeclist = pdeclist->next);
+    if( pdeclist == NULL )
+      sub[nsub++] = cands[j];
+  }
+  if( nsub ){
+    fprintf( output, "%sdefault:\n", INDENT[indent]);
+    EmitDecodeNode(output, sub, nsub, used, base_indent + 1);
+    fprintf( output, "%sbreak;\n", INDENT[(indent > 5) ? 6 : indent + 1]);
+  }
+  fprintf( output, "%s}\n", INDENT[indent]);
+
+  free(sub);
+  used[best] = 0;
+}
+
+/**************************************/
+/*!  Emits the table-driven decoder. Opcode fields are
+  resolved by nested switches on constant shifts and
+  masks, then the operands of the format found are
+  extracted. Returns the same field vector as
+  ac_decoder_full::Decode, written to a buffer
+  supplied by the caller.
+  \brief Used by CreateImplTmpl function      */
+/***************************************/
+void EmitTableDecoder( FILE *output){
+  extern ac_dec_instr *instr_list;
+  extern ac_dec_format *format_ins_list;
+  extern ac_decoder_full *decoder;
+  extern char *project_name;
+  extern int instr_num;
+  ac_dec_instr **cands, *pinstr;
+  ac_dec_format *pformat;
+  ac_dec_field *pfield;
+  char *used;
+  int n;
+
+  cands = (ac_dec_instr**) malloc(sizeof(ac_dec_instr*) * instr_num);
+  used = (char*) calloc(decoder->nFields + 1, 1);
+  n = 0;
+  for( pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next)
+    cands[n++] = pinstr;
+
+  fprintf( output, "\n");
+  COMMENT(INDENT[0], "Table-driven decoder.");
+  fprintf( output, "unsigned* %s_parms::%s_isa::decode_table(ac_word word, unsigned* fields) {\n", project_name, project_name);
+  fprintf( output, "%sunsigned id = 0;\n\n", INDENT[1]);
+
+  EmitDecodeNode(output, cands, n, used, 1);
+
+  fprintf( output, "\n%sswitch( id ) {\n", INDENT[1]);
+  for( pformat = format_ins_list; pformat != NULL; pformat = pformat->next){
+    for( pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next)
+      if( !strcmp(pinstr->format, pformat->name) )
+        fprintf( output, "%scase %d:\n", INDENT[1], pinstr->id);
+    for( pfield = pformat->fields; pfield != NULL; pfield = pfield->next){
+      fprintf( output, "%sfields[%d] = ", INDENT[2], pfield->id);
+      EmitFieldExtract(output, pfield);
+      fprintf( output, ";\n");
+    }
+    fprintf( output, "%sbreak;\n", INDENT[2]);
+  }
+  fprintf( output, "%sdefault:\n", INDENT[1]);
+  fprintf( output, "%sreturn NULL;\n", INDENT[2]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%sfields[0] = id;\n", INDENT[1]);
+  fprintf( output, "%sreturn fields;\n", INDENT[1]);
+  fprintf( output, "}\n");
+
+  free(used);
+  free(cands);
+}
+
+/**************************************/
+/*!  Emits the pre-decode methods. The executable range
+  recorded by the loader is split in chunks, one per
+  host thread. Each thread reads the program through
+  its own buffer and decodes into its own field vector,
+  so the processor decode state is never touched.
+  With snapshots, records of a matching file are used
+  instead of decoding, or new ones are saved.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitPreDecodeImpl( FILE *output){
+  extern char *project_name;
+
+  COMMENT(INDENT[0], "Range handed to one pre-decode thread.");
+  fprintf( output, "struct ac_pre_decode_arg {\n");
+  fprintf( output, "%s%s* proc;\n", INDENT[1], project_name);
+  fprintf( output, "%sunsigned start, end;\n", INDENT[1]);
+  fprintf( output, "};\n\n");
+
+  fprintf( output, "void* %s::pre_decode_thread(void* arg) {\n", project_name);
+  fprintf( output, "%sac_pre_decode_arg* range = (ac_pre_decode_arg*) arg;\n\n", INDENT[1]);
+  fprintf( output, "%sac_host_pin(\"pre-decode thread\");\n", INDENT[1]);
+  fprintf( output, "%srange->proc->pre_decode_range(range->start, range->end);\n", INDENT[1]);
+  fprintf( output, "%sreturn 0;\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+
+  COMMENT(INDENT[0], "Decodes [start, end) into the decode cache. Unidentified words are left for the simulation loop.");
+  fprintf( output, "void %s::pre_decode_range(unsigned start, unsigned end) {\n", project_name);
+  fprintf( output, "%sunsigned fields[%s_parms::AC_DEC_FIELD_NUMBER];\n", INDENT[1], project_name);
+  if( !ACTableDecoderFlag ){
+    fprintf( output, "%sconst int words = (%s_parms::AC_MAX_BUFFER + sizeof(%s_parms::ac_word) - 1) / sizeof(%s_parms::ac_word);\n",
+             INDENT[1], project_name, project_name, project_name);
+    fprintf( output, "%s%s_parms::ac_word word_buf[words];\n", INDENT[1], project_name);
+  }
+  fprintf( output, "%sunsigned* dec;\n", INDENT[1]);
+  fprintf( output, "%scache_item_t* item;\n", INDENT[1]);
+  if( HaveDecStats() )
+    fprintf( output, "%sunsigned long long decoded = 0, mapped = 0;\n", INDENT[1]);
+  fprintf( output, "\n");
+  fprintf( output, "%sfor( unsigned addr = start; addr < end; addr += %s_parms::AC_PRE_DECODE_STEP ) {\n", INDENT[1], project_name);
+  if( ACDecSnapshotFlag ){
+    fprintf( output, "%sunsigned rec = (addr - dec_snapshot_base) / %s_parms::AC_PRE_DECODE_STEP * %s_parms::AC_DEC_FIELD_NUMBER;\n\n",
+             INDENT[2], project_name, project_name);
+    fprintf( output, "%sif( dec_snapshot )\n", INDENT[2]);
+    fprintf( output, "%sdec = dec_snapshot[rec] ? const_cast<unsigned*>(dec_snapshot + rec) : 0;\n", INDENT[3]);
+    fprintf( output, "%selse {\n", INDENT[2]);
+  }
+  else
+    fprintf( output, "%s{\n", INDENT[2]);
+  if( ACTableDecoderFlag )
+    fprintf( output, "%sdec = ISA.decode_table(IM->fetch(addr), fields);\n", INDENT[3]);
+  else {
+    //A full buffer keeps GetBits from expanding it through the processor state.
+    fprintf( output, "%sfor( int i = 0; i < words; i++ )\n", INDENT[3]);
+    fprintf( output, "%sword_buf[i] = IM->fetch(addr + i * sizeof(%s_parms::ac_word));\n", INDENT[4], project_name);
+    fprintf( output, "%sdec = (ISA.decoder)->Decode(reinterpret_cast<unsigned char*>(word_buf), words, fields);\n", INDENT[3]);
+  }
+  if( ACDecSnapshotFlag ){
+    fprintf( output, "%sif( dec )\n", INDENT[3]);
+    fprintf( output, "%smemcpy(dec_snapshot_out + rec, dec, sizeof(fields));\n", INDENT[4]);
+  }
+  fprintf( output, "%s}\n", INDENT[2]);
+  fprintf( output, "%sif( !dec )\n", INDENT[2]);
+  fprintf( output, "%scontinue;\n", INDENT[3]);
+  if( ACSparseDecCacheFlag )
+    fprintf( output, "%sitem = dec_cache_slot(addr);\n", INDENT[2]);
+  else
+    fprintf( output, "%sitem = DEC_CACHE + addr;\n", INDENT[2]);
+  if( ACFormatStructsFlag )
+    fprintf( output, "%sac_dec_fill(item, dec);\n", INDENT[2]);
+  else if( ACDecSnapshotFlag ){
+    //Records have the layout of ac_instr, so mapped ones are used in place.
+    fprintf( output, "%sif( dec_snapshot )\n", INDENT[2]);
+    fprintf( output, "%sitem->instr_p = reinterpret_cast<ac_instr<%s_parms::AC_DEC_FIELD_NUMBER>*>(dec);\n", INDENT[3], project_name);
+    fprintf( output, "%selse\n", INDENT[2]);
+    fprintf( output, "%sitem->instr_p = new ac_instr<%s_parms::AC_DEC_FIELD_NUMBER>(dec);\n", INDENT[3], project_name);
+  }
+  else
+    fprintf( output, "%sitem->instr_p = new ac_instr<%s_parms::AC_DEC_FIELD_NUMBER>(dec);\n", INDENT[2], project_name);
+  fprintf( output, "%sitem->valid = 1;\n", INDENT[2]);
+  if( ACDecInvalidateFlag )
+    fprintf( output, "%sIM->mark_code(addr);\n", INDENT[2]);
+  if( HaveDecStats() && ACDecSnapshotFlag )
+    fprintf( output, "%s(dec_snapshot ? mapped : decoded)++;\n", INDENT[2]);
+  else if( HaveDecStats() )
+    fprintf( output, "%sdecoded++;\n", INDENT[2]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  if( HaveDecStats() ){
+    //Ranges are decoded by several threads at once.
+    fprintf( output, "%s__sync_fetch_and_add(&dec_stats.predecoded, decoded);\n", INDENT[1]);
+    fprintf( output, "%s__sync_fetch_and_add(&dec_stats.mapped, mapped);\n", INDENT[1]);
+    if( !ACFormatStructsFlag )
+      fprintf( output, "%s__sync_fetch_and_add(&dec_stats.objects, decoded);\n", INDENT[1]);
+  }
+  fprintf( output, "}\n\n");
+
+  COMMENT(INDENT[0], "Decodes the executable range recorded by the loader before simulation starts.");
+  fprintf( output, "void %s::pre_decode() {\n", project_name);
+  fprintf( output, "%spthread_t threads[%s_parms::AC_PRE_DECODE_MAX_THREADS];\n", INDENT[1], project_name);
+  fprintf( output, "%sac_pre_decode_arg ranges[%s_parms::AC_PRE_DECODE_MAX_THREADS];\n", INDENT[1], project_name);
+  fprintf( output, "%sbool started[%s_parms::AC_PRE_DECODE_MAX_THREADS];\n", INDENT[1], project_name);
+  fprintf( output, "%sunsigned start = ac_text_start;\n", INDENT[1]);
+  fprintf( output, "%sunsigned end = ac_text_end;\n", INDENT[1]);
+  fprintf( output, "%sunsigned chunk;\n", INDENT[1]);
+  fprintf( output, "%slong nthreads;\n", INDENT[1]);
+  if( ACDecSnapshotFlag ){
+    fprintf( output, "%sac_dec_snapshot_header hdr;\n", INDENT[1]);
+    fprintf( output, "%schar* snapshot_path;\n", INDENT[1]);
+    fprintf( output, "%sextern const char *project_name, *archc_version, *archc_options;\n", INDENT[1]);
+  }
+  fprintf( output, "\n");
+
+  fprintf( output, "%sif( end > dec_cache_size )\n", INDENT[1]);
+  fprintf( output, "%send = dec_cache_size;\n", INDENT[2]);
+  if( !ACTableDecoderFlag ){
+    fprintf( output, "%sif( end > APP_MEM->get_size() - %s_parms::AC_MAX_BUFFER )\n", INDENT[1], project_name);
+    fprintf( output, "%send = APP_MEM->get_size() - %s_parms::AC_MAX_BUFFER;\n", INDENT[2], project_name);
+  }
+  fprintf( output, "%sif( start >= end )\n", INDENT[1]);
+  fprintf( output, "%sreturn;\n\n", INDENT[2]);
+
+  if( ACDecSnapshotFlag ){
+    //The key covers the simulator build and the text being decoded.
+    fprintf( output, "%shdr.text_start = start;\n", INDENT[1]);
+    fprintf( output, "%shdr.text_end = end;\n", INDENT[1]);
+    fprintf( output, "%shdr.step = %s_parms::AC_PRE_DECODE_STEP;\n", INDENT[1], project_name);
+    fprintf( output, "%shdr.nfields = %s_parms::AC_DEC_FIELD_NUMBER;\n", INDENT[1], project_name);
+    fprintf( output, "%shdr.key = ac_dec_snapshot_hash(project_name, strlen(project_name), 0);\n", INDENT[1]);
+    fprintf( output, "%shdr.key = ac_dec_snapshot_hash(archc_version, strlen(archc_version), hdr.key);\n", INDENT[1]);
+    fprintf( output, "%shdr.key = ac_dec_snapshot_hash(archc_options, strlen(archc_options), hdr.key);\n", INDENT[1]);
+    fprintf( output, "%sfor( unsigned addr = start; addr < end; addr += sizeof(%s_parms::ac_word) ) {\n", INDENT[1], project_name);
+    fprintf( output, "%s%s_parms::ac_word w = IM->fetch(addr);\n", INDENT[2], project_name);
+    fprintf( output, "%shdr.key = ac_dec_snapshot_hash(&w, sizeof(w), hdr.key);\n", INDENT[2]);
+    fprintf( output, "%s}\n\n", INDENT[1]);
+    fprintf( output, "%ssnapshot_path = ac_dec_snapshot_path(project_name, hdr.key);\n", INDENT[1]);
+    fprintf( output, "%sdec_snapshot_base = start;\n", INDENT[1]);
+    fprintf( output, "%sdec_snapshot_out = 0;\n", INDENT[1]);
+    fprintf( output, "%sif( (dec_snapshot = ac_dec_snapshot_map(snapshot_path, hdr)) != 0 ) {\n", INDENT[1]);
+    fprintf( output, "%sdec_snapshot_end = dec_snapshot + ac_dec_snapshot_records(hdr) * %s_parms::AC_DEC_FIELD_NUMBER;\n", INDENT[2], project_name);
+    fprintf( output, "%sAC_SAY(\"Using decode cache snapshot \" << snapshot_path);\n", INDENT[2]);
+    fprintf( output, "%s}\n", INDENT[1]);
+    fprintf( output, "%selse\n", INDENT[1]);
+    fprintf( output, "%sdec_snapshot_out = (unsigned*) calloc(ac_dec_snapshot_records(hdr) * %s_parms::AC_DEC_FIELD_NUMBER, sizeof(unsigned));\n\n",
+             INDENT[2], project_name);
+  }
+
+  fprintf( output, "%sif( !DEC_CACHE )\n", INDENT[1]);
+  fprintf( output, "%sinit_dec_cache();\n", INDENT[2]);
+  if( ACSparseDecCacheFlag ){
+    //Pages are allocated here so threads only read the page directory.
+    fprintf( output, "%sfor( unsigned addr = start; addr < end; addr += 1 << %s_parms::AC_DEC_CACHE_PAGE_BITS )\n", INDENT[1], project_name);
+    fprintf( output, "%sdec_cache_slot(addr);\n", INDENT[2]);
+    fprintf( output, "%sdec_cache_slot(end - 1);\n", INDENT[1]);
+  }
+  fprintf( output, "\n");
+
+  fprintf( output, "%snthreads = sysconf(_SC_NPROCESSORS_ONLN);\n", INDENT[1]);
+  fprintf( output, "%sif( nthreads < 1 )\n", INDENT[1]);
+  fprintf( output, "%snthreads = 1;\n", INDENT[2]);
+  fprintf( output, "%sif( nthreads > (long) %s_parms::AC_PRE_DECODE_MAX_THREADS )\n", INDENT[1], project_name);
+  fprintf( output, "%snthreads = %s_parms::AC_PRE_DECODE_MAX_THREADS;\n", INDENT[2], project_name);
+  fprintf( output, "%schunk = ((end - start) / nthreads / %s_parms::AC_PRE_DECODE_STEP + 1) * %s_parms::AC_PRE_DECODE_STEP;\n\n",
+           INDENT[1], project_name, project_name);
+
+  fprintf( output, "%sfor( long i = 0; i < nthreads; i++ ) {\n", INDENT[1]);
+  fprintf( output, "%sranges[i].proc = this;\n", INDENT[2]);
+  fprintf( output, "%sranges[i].start = (start + i * chunk < end) ? start + i * chunk : end;\n", INDENT[2]);
+  fprintf( output, "%sranges[i].end = (ranges[i].start + chunk < end) ? ranges[i].start + chunk : end;\n", INDENT[2]);
+  fprintf( output, "%sstarted[i] = (pthread_create(&threads[i], NULL, pre_decode_thread, &ranges[i]) == 0);\n", INDENT[2]);
+  fprintf( output, "%sif( !started[i] )\n", INDENT[2]);
+  fprintf( output, "%spre_decode_range(ranges[i].start, ranges[i].end);\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%sfor( long i = 0; i < nthreads; i++ )\n", INDENT[1]);
+  fprintf( output, "%sif( started[i] )\n", INDENT[2]);
+  fprintf( output, "%spthread_join(threads[i], NULL);\n", INDENT[3]);
+
+  if( ACDecSnapshotFlag ){
+    fprintf( output, "\n%sif( dec_snapshot_out ) {\n", INDENT[1]);
+    fprintf( output, "%sif( !ac_dec_snapshot_save(snapshot_path, hdr, dec_snapshot_out) )\n", INDENT[2]);
+    fprintf( output, "%sAC_WARN(\"could not write decode cache snapshot \" << snapshot_path);\n", INDENT[3]);
+    fprintf( output, "%sfree(dec_snapshot_out);\n", INDENT[2]);
+    fprintf( output, "%sdec_snapshot_out = 0;\n", INDENT[2]);
+    fprintf( output, "%s}\n", INDENT[1]);
+    fprintf( output, "%sfree(snapshot_path);\n", INDENT[1]);
+  }
+  fprintf( output, "}\n\n");
+}
+
+/**************************************/
+/*!  Emits the label table used by threaded dispatch.
+  Entry N holds the address of the case label of
+  the instruction with ID N. Entry 0 is never used,
+  since unidentified instructions stop the simulator.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitDispatchTable( FILE *output, int base_indent){
+  extern ac_dec_instr *instr_list;
+  ac_dec_instr *pinstr;
+
+  fprintf( output, "#ifdef AC_THREADED_DISPATCH\n");
+  fprintf( output, "#define AC_DISPATCH_LABEL(name) ac_dispatch_##name:\n");
+  fprintf( output, "%sstatic void* const ac_dispatch[] = { 0", INDENT[base_indent]);
+  for( pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next)
+    fprintf( output, ",\n%s&&ac_dispatch_%s", INDENT[base_indent+1], pinstr->name);
+  fprintf( output, " };\n");
+  fprintf( output, "#else\n");
+  fprintf( output, "#define AC_DISPATCH_LABEL(name)\n");
+  fprintf( output, "#endif\n\n");
+}
+
 /**************************************/
 /*!  Emits the if statement executed before
   fetches are performed.
@@ -4196,50 +6877,463 @@ void EmitInstrExec( FILE *output, int base_indent){
 /***************************************/
 void EmitFetchInit( FILE *output, int base_indent){
   extern int HaveMultiCycleIns;
+  extern char *project_name;
 
   fprintf(output, "%sbhv_pc = ac_pc;\n", INDENT[base_indent]);
 
-  if (!ACDecCacheFlag){
-    fprintf( output, "%sif( bhv_pc >= APP_MEM->get_size()){\n", INDENT[base_indent]);
-  }
-  else
-    fprintf( output, "%sif( bhv_pc >= dec_cache_size){\n", INDENT[base_indent]);
+  //Fetches out of bounds trap in the guarded memory or decode cache.
+  if (ACGuardMemoryFlag)
+    fprintf( output, "%s{\n", INDENT[base_indent]);
+  else {
+    if (!ACDecCacheFlag){
+      fprintf( output, "%sif( bhv_pc >= APP_MEM->get_size()){\n", INDENT[base_indent]);
+    }
+    else
+      fprintf( output, "%sif( bhv_pc >= dec_cache_size){\n", INDENT[base_indent]);
 
-  fprintf( output, "%scerr << \"ArchC: Address out of bounds (pc=0x\" << hex << bhv_pc << \").\" << endl;\n", INDENT[base_indent+1]);
+    fprintf( output, "%scerr << \"ArchC: Address out of bounds (pc=0x\" << hex << bhv_pc << \").\" << endl;\n", INDENT[base_indent+1]);
 	//  fprintf( output, "%scout = cerr;\n", INDENT[base_indent+1]);
 
-  if( ACVerifyFlag ){
-    fprintf( output, "%send_log.mtype = 1;\n", INDENT[base_indent+1]);
-    fprintf( output, "%send_log.log.time = -1;\n", INDENT[base_indent+1]);
-    fprintf( output, "%sif(msgsnd(msqid, (struct log_msgbuf *)&end_log, sizeof(end_log), 0) == -1)\n", INDENT[base_indent+1]);
-    fprintf( output, "%sperror(\"msgsnd\");\n", INDENT[base_indent+2]);
-  }
+    if( ACVerifyFlag ){
+      fprintf( output, "%send_log.mtype = 1;\n", INDENT[base_indent+1]);
+      fprintf( output, "%send_log.log.time = -1;\n", INDENT[base_indent+1]);
+      fprintf( output, "%sac_vring.send(&end_log, sizeof(end_log));\n", INDENT[base_indent+1]);
+      fprintf( output, "%sac_vring.flush();\n", INDENT[base_indent+1]);
+    }
 /*   fprintf( output, "%sac_stop();\n", INDENT[base_indent+1]); */
-  fprintf( output, "%sstop();\n", INDENT[base_indent+1]);
-  fprintf( output, "%sreturn;\n", INDENT[base_indent+1]);
-  fprintf( output, "%s}\n", INDENT[base_indent]);
+    fprintf( output, "%sstop();\n", INDENT[base_indent+1]);
+    fprintf( output, "%sreturn;\n", INDENT[base_indent+1]);
+    fprintf( output, "%s}\n", INDENT[base_indent]);
 
-  fprintf( output, "%selse {\n", INDENT[base_indent]);
+    fprintf( output, "%selse {\n", INDENT[base_indent]);
+  }
 
   fprintf( output, "%sif( start_up ){\n", INDENT[base_indent+1]);
   fprintf( output, "%sdecode_pc = ac_pc;\n", INDENT[base_indent+2]);
   if(ACABIFlag)
     fprintf( output, "%sISA.syscall.set_prog_args(argc, argv);\n", INDENT[3]);
   fprintf( output, "%sstart_up=0;\n", INDENT[base_indent+2]);
-  if( ACDecCacheFlag )
+  if( ACPreDecodeFlag ){
+    //The cache may already hold the pre-decoded text.
+    fprintf( output, "%sif( !DEC_CACHE )\n", INDENT[base_indent+2]);
+    fprintf( output, "%sinit_dec_cache();\n", INDENT[base_indent+3]);
+    if( ACThreadedDispatchFlag ){
+      //Dispatch labels are only visible here, so pre-decoded entries get them now.
+      fprintf( output, "#ifdef AC_THREADED_DISPATCH\n");
+      fprintf( output, "%sfor( unsigned addr = ac_text_start; addr < ac_text_end && addr < dec_cache_size; addr += %s_parms::AC_PRE_DECODE_STEP ) {\n", INDENT[base_indent+2], project_name);
+      if( ACSparseDecCacheFlag )
+        fprintf( output, "%sins_cache = dec_cache_slot(addr);\n", INDENT[base_indent+3]);
+      else
+        fprintf( output, "%sins_cache = DEC_CACHE + addr;\n", INDENT[base_indent+3]);
+      fprintf( output, "%sif( ins_cache->valid )\n", INDENT[base_indent+3]);
+      if( ACFormatStructsFlag )
+        fprintf( output, "%sins_cache->handler = ac_dispatch[ins_cache->id];\n", INDENT[base_indent+4]);
+      else
+        fprintf( output, "%sins_cache->handler = ac_dispatch[ins_cache->instr_p->get(IDENT)];\n", INDENT[base_indent+4]);
+      fprintf( output, "%s}\n", INDENT[base_indent+2]);
+      fprintf( output, "#endif\n");
+    }
+  }
+  else if( ACDecCacheFlag )
     fprintf( output, "%sinit_dec_cache();\n", INDENT[base_indent+2]);
   fprintf( output, "%s}\n", INDENT[base_indent+1]);
 
   fprintf( output, "%selse{ \n", INDENT[base_indent+1]);
-  if(HaveMultiCycleIns && !ACDecCacheFlag ){
-    //fprintf( output, "%sfree(instr_dec);\n", INDENT[base_indent+2]);
-    fprintf( output, "%sdelete(instr_vec);\n", INDENT[base_indent+2]);
-  }
   fprintf( output, "%sdecode_pc = bhv_pc;\n", INDENT[base_indent+2]);
   fprintf( output, "%s}\n \n", INDENT[base_indent+1]);
 
 }
 
+/**************************************/
+/*!  Emits the handler for writes to watched code
+  pages. Entries of the page are only marked
+  invalid, so the instruction running the store
+  finishes with its own decoded fields and the entry
+  is decoded again on its next fetch.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitCodeWrittenImpl( FILE *output){
+  extern char *project_name;
+
+  fprintf( output, "void %s::code_written(uint32_t page) {\n", project_name);
+  fprintf( output, "%sunsigned start = page << %s_parms::AC_CODE_PAGE_BITS;\n", INDENT[1], project_name);
+  fprintf( output, "%sunsigned end = start + (1U << %s_parms::AC_CODE_PAGE_BITS);\n", INDENT[1], project_name);
+  fprintf( output, "%scache_item_t* item;\n\n", INDENT[1]);
+  fprintf( output, "%sif( !DEC_CACHE )\n", INDENT[1]);
+  fprintf( output, "%sreturn;\n", INDENT[2]);
+  fprintf( output, "%sif( end > dec_cache_size )\n", INDENT[1]);
+  fprintf( output, "%send = dec_cache_size;\n\n", INDENT[2]);
+  if( ACSparseDecCacheFlag ){
+    fprintf( output, "%sfor( unsigned addr = start; addr < end; addr += 1U << %s_parms::AC_DEC_CACHE_SLOT_SHIFT ) {\n", INDENT[1], project_name);
+    fprintf( output, "%sif( !DEC_CACHE[addr >> %s_parms::AC_DEC_CACHE_PAGE_BITS] )\n", INDENT[2], project_name);
+    fprintf( output, "%scontinue;\n", INDENT[3]);
+    fprintf( output, "%sitem = dec_cache_slot(addr);\n", INDENT[2]);
+  }
+  else {
+    fprintf( output, "%sfor( unsigned addr = start; addr < end; addr++ ) {\n", INDENT[1]);
+    fprintf( output, "%sitem = DEC_CACHE + addr;\n", INDENT[2]);
+  }
+  if( HaveDecStats() ){
+    fprintf( output, "%sif( item->valid )\n", INDENT[2]);
+    fprintf( output, "%sdec_stats.invalidated++;\n", INDENT[3]);
+  }
+  fprintf( output, "%sitem->valid = 0;\n", INDENT[2]);
+  if( ACDecSnapshotFlag && !ACFormatStructsFlag ){
+    //Entries mapped from a snapshot are read-only and get new objects.
+    fprintf( output, "%sif( dec_snapshot && (const unsigned*) item->instr_p >= dec_snapshot &&\n", INDENT[2]);
+    fprintf( output, "%s(const unsigned*) item->instr_p < dec_snapshot_end )\n", INDENT[3]);
+    fprintf( output, "%sitem->instr_p = 0;\n", INDENT[3]);
+  }
+  fprintf( output, "%s}\n", INDENT[1]);
+  if( HaveDecStats() )
+    fprintf( output, "%sdec_stats.code_writes++;\n", INDENT[1]);
+  if( ACBlockCacheFlag )
+    fprintf( output, "%sac_block_flush = 1;\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+}
+
+/**************************************/
+/*!  Emits the translator members declared in the
+  processor class: the code buffer and one entry
+  point per instruction, called by translated code.
+  \brief Used by CreateProcessorHeader function      */
+/***************************************/
+void EmitJITDecl( FILE *output){
+  extern ac_dec_instr *instr_list;
+  extern char *project_name;
+  ac_dec_instr *pinstr;
+
+  fprintf(output, "\n#ifdef AC_JIT\n");
+  fprintf(output, "%sunsigned char* ac_jit_buf; \t //!< Translated code, mapped on the first translation.\n", INDENT[1]);
+  fprintf(output, "%sunsigned ac_jit_used; \t //!< Bytes of ac_jit_buf in use.\n\n", INDENT[1]);
+  fprintf(output, "%sbool ac_jit_translate(ac_block_t* blk);\n", INDENT[1]);
+  fprintf(output, "%sbool ac_jit_next(unsigned next_pc, bool last);\n", INDENT[1]);
+  for( pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next)
+    fprintf(output, "%sstatic bool ac_jit_%s(%s* p, cache_item_t* ins_cache, unsigned next_pc, bool last);\n",
+            INDENT[1], pinstr->name, project_name);
+  fprintf(output, "#endif\n");
+}
+
+/**************************************/
+/*!  Emits the block translator. Translated code is a
+  straight sequence of calls to per-instruction entry
+  points, which run the behaviors with the operands of
+  the cached entry and take the same exits as the
+  block replay loop of EmitBlockExec. Behaviors are
+  plain C++ methods, so they are called, not inlined.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+/**************************************/
+/*!Emit the digest mode of ac_verify.
+  Writes only mark their pages dirty. At each digest point the dirty
+  pages of memories and plain caches and every register bank are hashed
+  and sent, followed by a control log closing the digest. Caches kept
+  in ac_cache objects have no plain storage and are left out.
+  \brief Used by CreateProcessorImpl function      */
+/***************************************/
+void EmitVerifyDigest( FILE *output){
+  extern ac_sto_list *storage_list;
+  ac_sto_list *pstorage;
+  int dev, next_type;
+
+  fprintf( output, "%selse if( sc_simulation_time() ){\n", INDENT[3]);
+
+  for( pstorage = storage_list, dev = 0; pstorage != NULL; pstorage=pstorage->next){
+    if( pstorage->type != MEM && pstorage->type != ICACHE && pstorage->type != DCACHE &&
+        pstorage->type != CACHE && pstorage->type != REGBANK )
+      continue;
+    if( pstorage->type != REGBANK && (pstorage->type == MEM || !pstorage->parms) ){
+      fprintf( output, "%sfor( unsigned i = 0; i < %s.get_changes()->size(); i++)\n", INDENT[4], pstorage->name );
+      fprintf( output, "%sac_vdigest.touch(%d, (*%s.get_changes())[i].addr);\n", INDENT[5], dev, pstorage->name );
+    }
+    fprintf( output, "%s%s.get_changes()->clear();\n", INDENT[4], pstorage->name );
+    dev++;
+  }
+
+  fprintf( output, "\n%sif( ac_vdigest.due(ac_instr_counter) ){\n", INDENT[4]);
+  for( pstorage = storage_list, dev = 0, next_type = 3; pstorage != NULL; pstorage=pstorage->next){
+    if( pstorage->type != MEM && pstorage->type != ICACHE && pstorage->type != DCACHE &&
+        pstorage->type != CACHE && pstorage->type != REGBANK )
+      continue;
+    if( pstorage->type == REGBANK ){
+      fprintf( output, "%slbuf.mtype = %d;\n", INDENT[5], next_type );
+      fprintf( output, "%slbuf.log = ac_vlog(0, ac_verify_digest::regbank_hash(%s, %u), ac_vdigest.next);\n",
+               INDENT[5], pstorage->name, pstorage->size );
+      fprintf( output, "%sac_vring.send(&lbuf, sizeof(lbuf));\n", INDENT[5] );
+    }
+    else if( pstorage->type == MEM || !pstorage->parms ){
+      fprintf( output, "%s{\n", INDENT[5] );
+      fprintf( output, "%sstd::vector<uint32_t> &pages = ac_vdigest.pages(%d);\n", INDENT[6], dev );
+      fprintf( output, "%slbuf.mtype = %d;\n", INDENT[6], next_type );
+      fprintf( output, "%sfor( unsigned i = 0; i < pages.size(); i++){\n", INDENT[6] );
+      fprintf( output, "%slbuf.log = ac_vlog(pages[i], ac_verify_digest::page_hash(%s_stg, pages[i], %uU), ac_vdigest.next);\n",
+               INDENT[7], pstorage->name, pstorage->size );
+      fprintf( output, "%sac_vring.send(&lbuf, sizeof(lbuf));\n", INDENT[7] );
+      fprintf( output, "%s}\n", INDENT[6] );
+      fprintf( output, "%s}\n", INDENT[5] );
+    }
+    dev++;
+    next_type++;
+  }
+  fprintf( output, "%slbuf.mtype = 1;\n", INDENT[5] );
+  fprintf( output, "%slbuf.log = ac_vlog(0, 0, ac_vdigest.next);\n", INDENT[5] );
+  fprintf( output, "%sac_vring.send(&lbuf, sizeof(lbuf));\n", INDENT[5] );
+  fprintf( output, "%sac_vring.flush();\n\n", INDENT[5] );
+
+  //After the last digest asked for, nothing else is compared
+  fprintf( output, "%sif( !ac_vdigest.advance() ){\n", INDENT[5] );
+  fprintf( output, "%slbuf.log.time = -1;\n", INDENT[6] );
+  fprintf( output, "%sac_vring.send(&lbuf, sizeof(lbuf));\n", INDENT[6] );
+  fprintf( output, "%sac_vring.flush();\n", INDENT[6] );
+  fprintf( output, "%sstop();\n", INDENT[6] );
+  fprintf( output, "%s}\n", INDENT[5] );
+  fprintf( output, "%s}\n", INDENT[4] );
+  fprintf( output, "%s}\n\n", INDENT[3] );
+}
+
+/*!Emit the checkpoint save and restore methods.
+  The arch section holds the control variables and every register, each
+  plain storage gets a section of its own, then comes the memory map of
+  the program and the sections registered by the libraries and the model
+  follow. */
+void EmitCheckpointImpl( FILE *output){
+  extern ac_sto_list *storage_list;
+  extern char *project_name;
+  ac_sto_list *pstorage;
+
+  COMMENT(INDENT[0], "Saves the simulation state to path. Returns false if the file could not be written.");
+  fprintf( output, "bool %s::save_checkpoint(const char* path) {\n", project_name);
+  fprintf( output, "%sac_checkpoint_out out(path);\n\n", INDENT[1]);
+
+  fprintf( output, "%sout.begin(\"%s.arch\");\n", INDENT[1], project_name);
+  fprintf( output, "%sout.put(ac_instr_counter);\n", INDENT[1]);
+  fprintf( output, "%sout.put(ac_cycle_counter);\n", INDENT[1]);
+  fprintf( output, "%sout.put(ac_heap_ptr);\n", INDENT[1]);
+  fprintf( output, "%sout.put(ac_start_addr);\n", INDENT[1]);
+  fprintf( output, "%sout.put(ac_pc);\n", INDENT[1]);
+  for( pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next ) {
+    if( pstorage->type == REG || pstorage->type == REGBANK )
+      fprintf( output, "%sout.put(%s);\n", INDENT[1], pstorage->name);
+  }
+  fprintf( output, "\n");
+
+  for( pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next ) {
+    if( pstorage->type != REG && pstorage->type != REGBANK && pstorage->type != TLM_PORT ) {
+      fprintf( output, "%sout.begin(\"%s.%s\");\n", INDENT[1], project_name, pstorage->name);
+      fprintf( output, "%sout.put_storage(%s_stg, %s_stg.get_size());\n", INDENT[1], pstorage->name, pstorage->name);
+    }
+  }
+  fprintf( output, "%sout.begin(\"%s.memmap\");\n", INDENT[1], project_name);
+  fprintf( output, "%sac_dyn_loader.mem_map.save(out);\n", INDENT[1]);
+  fprintf( output, "\n");
+
+  fprintf( output, "%sac_checkpoint_section::save_all(out);\n", INDENT[1]);
+  fprintf( output, "%sreturn out.close();\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+
+  COMMENT(INDENT[0], "Restores the simulation state saved to path. Returns false if the file is missing or malformed.");
+  fprintf( output, "bool %s::restore_checkpoint(const char* path) {\n", project_name);
+  fprintf( output, "%sac_checkpoint_in in(path);\n", INDENT[1]);
+  fprintf( output, "%schar name[256];\n\n", INDENT[1]);
+
+  fprintf( output, "%swhile( in.next(name, sizeof(name)) ) {\n", INDENT[1]);
+  fprintf( output, "%sif( !strcmp(name, \"%s.arch\") ) {\n", INDENT[2], project_name);
+  fprintf( output, "%sin.get(ac_instr_counter);\n", INDENT[3]);
+  fprintf( output, "%sin.get(ac_cycle_counter);\n", INDENT[3]);
+  fprintf( output, "%sin.get(ac_heap_ptr);\n", INDENT[3]);
+  fprintf( output, "%sin.get(ac_start_addr);\n", INDENT[3]);
+  fprintf( output, "%sin.get(ac_pc);\n", INDENT[3]);
+  for( pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next ) {
+    if( pstorage->type == REG || pstorage->type == REGBANK )
+      fprintf( output, "%sin.get(%s);\n", INDENT[3], pstorage->name);
+  }
+  fprintf( output, "%s}\n", INDENT[2]);
+
+  for( pstorage = storage_list; pstorage != NULL; pstorage = pstorage->next ) {
+    if( pstorage->type != REG && pstorage->type != REGBANK && pstorage->type != TLM_PORT ) {
+      fprintf( output, "%selse if( !strcmp(name, \"%s.%s\") )\n", INDENT[2], project_name, pstorage->name);
+      fprintf( output, "%sin.get_storage(%s_stg, %s_stg.get_size());\n", INDENT[3], pstorage->name, pstorage->name);
+    }
+  }
+
+  fprintf( output, "%selse if( !strcmp(name, \"%s.memmap\") )\n", INDENT[2], project_name);
+  fprintf( output, "%sac_dyn_loader.mem_map.restore(in);\n", INDENT[3]);
+  fprintf( output, "%selse if( !ac_checkpoint_section::restore(name, in) )\n", INDENT[2]);
+  fprintf( output, "%sAC_WARN(\"Checkpoint section '\" << name << \"' ignored.\");\n", INDENT[3]);
+  fprintf( output, "%s}\n\n", INDENT[1]);
+
+  //Decoded instructions need no flush: the checkpoint is of the program given to --load
+  fprintf( output, "%sif( !in.ok() )\n", INDENT[1]);
+  fprintf( output, "%sreturn false;\n\n", INDENT[2]);
+  fprintf( output, "%sbhv_pc = ac_pc;\n", INDENT[1]);
+  fprintf( output, "%scerr << \"ArchC: Restored checkpoint \" << path << \" at \" << ac_instr_counter << \" instructions.\" << endl;\n", INDENT[1]);
+  fprintf( output, "%sreturn true;\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+
+  COMMENT(INDENT[0], "Saves the checkpoint requested by ac_checkpoint_at and stops the simulation.");
+  fprintf( output, "void %s::ac_checkpoint_now() {\n", project_name);
+  fprintf( output, "%sac_checkpoint_at = (unsigned long long) -1;\n", INDENT[1]);
+  fprintf( output, "%sif( save_checkpoint(ac_checkpoint_file) )\n", INDENT[1]);
+  fprintf( output, "%scerr << \"ArchC: Checkpoint saved to \" << ac_checkpoint_file << \" at \" << ac_instr_counter << \" instructions.\" << endl;\n", INDENT[2]);
+  fprintf( output, "%selse\n", INDENT[1]);
+  fprintf( output, "%sAC_ERROR(\"Could not save checkpoint '\" << ac_checkpoint_file << \"'.\");\n", INDENT[2]);
+  fprintf( output, "%sstop();\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+}
+
+void EmitJITImpl( FILE *output){
+  extern ac_dec_instr *instr_list;
+  extern ac_dec_format *format_ins_list;
+  extern ac_dec_field *common_instr_field_list;
+  extern char *project_name;
+  ac_dec_instr *pinstr;
+  ac_dec_format *pformat;
+  ac_dec_field *pfield, *pf;
+
+  fprintf( output, "#ifdef AC_JIT\n");
+
+  COMMENT(INDENT[0], "Accounts an instruction run by translated code. Returns whether the block goes on.");
+  fprintf( output, "bool %s::ac_jit_next(unsigned next_pc, bool last) {\n", project_name);
+  fprintf( output, "%sif( last || ac_wait_sig || ac_stop_flag || ac_pc != next_pc", INDENT[1]);
+  if( ACDecInvalidateFlag )
+    fprintf( output, " || ac_block_flush");
+  if( ACIntrDeferFlag )
+    fprintf( output, " || ac_intr_pending");
+  if( ACWaitFlag )
+    fprintf( output, " || instr_in_batch >= instr_batch_size");
+  fprintf( output, " )\n");
+  fprintf( output, "%sreturn false;\n", INDENT[2]);
+  fprintf( output, "%sif( !ac_annul_sig ) ac_instr_counter+=1;\n", INDENT[1]);
+  fprintf( output, "%sac_annul_sig = 0;\n", INDENT[1]);
+  if( ACWaitFlag )
+    fprintf( output, "%sinstr_in_batch++;\n", INDENT[1]);
+  fprintf( output, "%sdecode_pc = ac_pc;\n", INDENT[1]);
+  fprintf( output, "%sreturn true;\n", INDENT[1]);
+  fprintf( output, "}\n\n");
+
+  for( pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next){
+    for( pformat = format_ins_list; pformat != NULL && strcmp(pinstr->format, pformat->name); pformat = pformat->next);
+
+    fprintf( output, "bool %s::ac_jit_%s(%s* p, cache_item_t* ins_cache, unsigned next_pc, bool last) {\n",
+             project_name, pinstr->name, project_name);
+    if( !ACFormatStructsFlag )
+      fprintf( output, "%sac_instr_t* instr_vec = ins_cache->instr_p;\n\n", INDENT[1]);
+    fprintf( output, "%sp->ac_pc = p->decode_pc;\n", INDENT[1]);
+    fprintf( output, "%sp->ISA.cur_instr_id = %d;\n", INDENT[1], pinstr->id);
+
+    if( ACFusedBehaviorFlag ){
+      fprintf( output, "%sp->ISA._fused_%s(", INDENT[1], pinstr->name);
+      for( pfield = pformat->fields; pfield != NULL; pfield = pfield->next){
+        EmitFieldOperand(output, pformat, pfield);
+        if( pfield->next != NULL )
+          fprintf( output, ", ");
+      }
+      fprintf( output, ");\n");
+      fprintf( output, "%sreturn p->ac_jit_next(next_pc, last);\n", INDENT[1]);
+      fprintf( output, "}\n\n");
+      continue;
+    }
+
+    fprintf( output, "%sif (!p->ac_annul_sig) p->ISA._behavior_instruction(", INDENT[1]);
+    for( pfield = common_instr_field_list; pfield != NULL; pfield = pfield->next){
+      if( ACFormatStructsFlag ){
+        for( pf = pformat->fields; pf != NULL && strcmp(pf->name, pfield->name); pf = pf->next);
+        if( pf )
+          EmitFieldOperand(output, pformat, pf);
+        else
+          fprintf( output, "0");
+      }
+      else
+        fprintf( output, "instr_vec->get(%d)", pfield->id);
+      if( pfield->next != NULL )
+        fprintf( output, ", ");
+    }
+    fprintf( output, ");\n");
+
+    fprintf( output, "%sif (!p->ac_annul_sig) p->ISA._behavior_%s_%s(", INDENT[1], project_name, pformat->name);
+    for( pfield = pformat->fields; pfield != NULL; pfield = pfield->next){
+      EmitFieldOperand(output, pformat, pfield);
+      if( pfield->next != NULL )
+        fprintf( output, ", ");
+    }
+    fprintf( output, ");\n");
+
+    fprintf( output, "%sif (!p->ac_annul_sig) p->ISA.behavior_%s(", INDENT[1], pinstr->name);
+    for( pfield = pformat->fields; pfield != NULL; pfield = pfield->next){
+      EmitFieldOperand(output, pformat, pfield);
+      if( pfield->next != NULL )
+        fprintf( output, ", ");
+    }
+    fprintf( output, ");\n");
+    fprintf( output, "%sreturn p->ac_jit_next(next_pc, last);\n", INDENT[1]);
+    fprintf( output, "}\n\n");
+  }
+
+  COMMENT(INDENT[0], "Translates a block into calls to the entry points of its instructions. Returns false if the buffer is full.");
+  fprintf( output, "bool %s::ac_jit_translate(ac_block_t* blk) {\n", project_name);
+  fprintf( output, "%sstatic bool (* const entry[])(%s*, cache_item_t*, unsigned, bool) = { 0", INDENT[1], project_name);
+  for( pinstr = instr_list; pinstr != NULL; pinstr = pinstr->next)
+    fprintf( output, ",\n%s&%s::ac_jit_%s", INDENT[2], project_name, pinstr->name);
+  fprintf( output, " };\n");
+  fprintf( output, "%sunsigned char* exits[%s_parms::AC_BLOCK_MAX_SIZE];\n", INDENT[1], project_name);
+  fprintf( output, "%sunsigned char *code, *c;\n", INDENT[1]);
+  fprintf( output, "%sunsigned nexits = 0;\n\n", INDENT[1]);
+
+  fprintf( output, "%sif( !ac_jit_buf && !ac_jit_used ) {\n", INDENT[1]);
+  fprintf( output, "%svoid* buf = mmap(NULL, %s_parms::AC_JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);\n",
+           INDENT[2], project_name);
+  fprintf( output, "%sif( buf == MAP_FAILED ) {\n", INDENT[2]);
+  fprintf( output, "%sAC_WARN(\"could not map translated code buffer, blocks will be interpreted\");\n", INDENT[3]);
+  fprintf( output, "%sac_jit_used = %s_parms::AC_JIT_CODE_SIZE;\n", INDENT[3], project_name);
+  fprintf( output, "%s}\n", INDENT[2]);
+  fprintf( output, "%selse\n", INDENT[2]);
+  fprintf( output, "%sac_jit_buf = (unsigned char*) buf;\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  //Each instruction takes at most 43 bytes, plus 6 for the prologue and epilogue.
+  fprintf( output, "%sif( !ac_jit_buf || ac_jit_used + blk->size * 43 + 6 > %s_parms::AC_JIT_CODE_SIZE )\n", INDENT[1], project_name);
+  fprintf( output, "%sreturn false;\n\n", INDENT[2]);
+
+  fprintf( output, "%scode = c = ac_jit_buf + ac_jit_used;\n", INDENT[1]);
+  fprintf( output, "%s*c++ = 0x53;                      // push %%rbx\n", INDENT[1]);
+  fprintf( output, "%s*c++ = 0x48; *c++ = 0x89; *c++ = 0xfb;    // mov %%rdi, %%rbx\n", INDENT[1]);
+  fprintf( output, "%sfor( unsigned i = 0; i < blk->size; i++ ) {\n", INDENT[1]);
+  fprintf( output, "%scache_item_t* item = blk->instr[i];\n", INDENT[2]);
+  if( ACFormatStructsFlag )
+    fprintf( output, "%sbool (*fn)(%s*, cache_item_t*, unsigned, bool) = entry[item->id];\n", INDENT[2], project_name);
+  else
+    fprintf( output, "%sbool (*fn)(%s*, cache_item_t*, unsigned, bool) = entry[item->instr_p->get(IDENT)];\n", INDENT[2], project_name);
+  fprintf( output, "%sunsigned last = (i + 1 == blk->size);\n", INDENT[2]);
+  fprintf( output, "%sunsigned next = last ? 0 : blk->pc[i + 1];\n\n", INDENT[2]);
+  fprintf( output, "%s*c++ = 0x48; *c++ = 0x89; *c++ = 0xdf;  // mov %%rbx, %%rdi\n", INDENT[2]);
+  fprintf( output, "%s*c++ = 0x48; *c++ = 0xbe;               // movabs $item, %%rsi\n", INDENT[2]);
+  fprintf( output, "%smemcpy(c, &item, 8); c += 8;\n", INDENT[2]);
+  fprintf( output, "%s*c++ = 0xba;                            // mov $next, %%edx\n", INDENT[2]);
+  fprintf( output, "%smemcpy(c, &next, 4); c += 4;\n", INDENT[2]);
+  fprintf( output, "%s*c++ = 0xb9;                            // mov $last, %%ecx\n", INDENT[2]);
+  fprintf( output, "%smemcpy(c, &last, 4); c += 4;\n", INDENT[2]);
+  fprintf( output, "%s*c++ = 0x48; *c++ = 0xb8;               // movabs $fn, %%rax\n", INDENT[2]);
+  fprintf( output, "%smemcpy(c, &fn, 8); c += 8;\n", INDENT[2]);
+  fprintf( output, "%s*c++ = 0xff; *c++ = 0xd0;               // call *%%rax\n", INDENT[2]);
+  fprintf( output, "%sif( !last ) {\n", INDENT[2]);
+  fprintf( output, "%s*c++ = 0x84; *c++ = 0xc0;             // test %%al, %%al\n", INDENT[3]);
+  fprintf( output, "%s*c++ = 0x0f; *c++ = 0x84;             // je exit\n", INDENT[3]);
+  fprintf( output, "%sexits[nexits++] = c; c += 4;\n", INDENT[3]);
+  fprintf( output, "%s}\n", INDENT[2]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%sfor( unsigned i = 0; i < nexits; i++ ) {\n", INDENT[1]);
+  fprintf( output, "%sint rel = c - (exits[i] + 4);\n", INDENT[2]);
+  fprintf( output, "%smemcpy(exits[i], &rel, 4);\n", INDENT[2]);
+  fprintf( output, "%s}\n", INDENT[1]);
+  fprintf( output, "%s*c++ = 0x5b;                      // pop %%rbx\n", INDENT[1]);
+  fprintf( output, "%s*c++ = 0xc3;                      // ret\n\n", INDENT[1]);
+
+  fprintf( output, "%sac_jit_used += c - code;\n", INDENT[1]);
+  fprintf( output, "%sblk->code = (void (*)(%s*)) code;\n", INDENT[1], project_name);
+  fprintf( output, "%sreturn true;\n", INDENT[1]);
+  fprintf( output, "}\n");
+  fprintf( output, "#endif\n\n");
+}
+
 /**************************************/
 /*!  Emits the body of a processor implementation for
   a processor without pipeline and with single cycle instruction.
@@ -4249,9 +7343,27 @@ void EmitProcessorBhv( FILE *output){
 
   fprintf(output, "%sfor (;;) {\n\n", INDENT[1]);
 
+  //Interrupts taken here reach the handler between two instructions or, with
+  //block caching, two blocks.
+  if( ACIntrDeferFlag )
+    fprintf(output, "%sif( ac_intr_pending ) ac_intr_deliver();\n\n", INDENT[2]);
+
+  if( ACHostProfileFlag )
+    fprintf(output, "%sac_host_phase_switch(AC_PHASE_FETCH);\n", INDENT[2]);
+
   EmitFetchInit(output, 1);
-  EmitDecodification(output, 2);
-  EmitInstrExec(output, 2);
+  if( ACBlockCacheFlag ){
+    EmitBlockExec(output, 2);
+    fprintf(output, "%selse {\n", INDENT[2]);
+    EmitDecodification(output, 2);
+    EmitInstrExec(output, 3);
+    fprintf(output, "%sif( !ac_wait_sig ) ac_block_record(decode_pc, ins_cache, ins_id);\n", INDENT[3]);
+    fprintf(output, "%s}\n", INDENT[2]);
+  }
+  else{
+    EmitDecodification(output, 2);
+    EmitInstrExec(output, 2);
+  }
 
   fprintf( output, "%sif ((!ac_wait_sig) && (!ac_annul_sig)) ac_instr_counter+=1;\n", INDENT[2]);
   fprintf( output, "%sac_annul_sig = 0;\n", INDENT[2]);
@@ -4274,11 +7386,26 @@ void EmitProcessorBhv( FILE *output){
   \brief Used by CreateProcessorImpl function      */
 /***************************************/
 void EmitProcessorBhv_ABI( FILE *output){
+  extern int HaveMultiCycleIns;
 
   fprintf(output, "%sfor (;;) {\n\n", INDENT[1]);
 
+  //Interrupts taken here reach the handler between two instructions or, with
+  //block caching, two blocks.
+  if( ACIntrDeferFlag )
+    fprintf(output, "%sif( ac_intr_pending ) ac_intr_deliver();\n\n", INDENT[2]);
+
+  if( ACHostProfileFlag )
+    fprintf(output, "%sac_host_phase_switch(AC_PHASE_FETCH);\n", INDENT[2]);
+
   EmitFetchInit(output, 1);
 
+  //Calls handled here decode no instruction. EmitInstrExec sets the id of
+  //those that do, so the update method counts one cycle, that of the
+  //invalid entry, for the others.
+  if( HaveMultiCycleIns )
+    fprintf( output, "%sISA.cur_instr_id = 0;\n", INDENT[2]);
+
   //Emiting system calls handler.
   COMMENT(INDENT[2],"Handling System calls.")
     fprintf( output, "%sswitch( decode_pc ){\n\n", INDENT[2]);
@@ -4289,8 +7416,29 @@ void EmitProcessorBhv_ABI( FILE *output){
 
   fprintf( output, "%sdefault:\n\n", INDENT[2]);
 
-  EmitDecodification(output, 2);
-  EmitInstrExec(output, 3);
+  //C library functions run on the host with AC_NATIVE_LIBC, at the entries
+  //found in the symbols of the program.
+  fprintf( output, "%sif( ac_native_at(decode_pc) && ISA.syscall.native_call(decode_pc) )\n", INDENT[3]);
+  fprintf( output, "%sbreak;\n\n", INDENT[4]);
+
+  //First call through a lazily bound jump slot.
+  fprintf( output, "%sif( ac_dyn_loader.is_lazy_slot(decode_pc) ) {\n", INDENT[3]);
+  fprintf( output, "%sISA.syscall.ac_rtld_resolve(decode_pc);\n", INDENT[4]);
+  fprintf( output, "%sbreak;\n", INDENT[4]);
+  fprintf( output, "%s}\n\n", INDENT[3]);
+
+  if( ACBlockCacheFlag ){
+    EmitBlockExec(output, 3);
+    fprintf(output, "%selse {\n", INDENT[3]);
+    EmitDecodification(output, 3);
+    EmitInstrExec(output, 4);
+    fprintf(output, "%sif( !ac_wait_sig ) ac_block_record(decode_pc, ins_cache, ins_id);\n", INDENT[4]);
+    fprintf(output, "%s}\n", INDENT[3]);
+  }
+  else{
+    EmitDecodification(output, 2);
+    EmitInstrExec(output, 3);
+  }
 
   //Closing default case.
   fprintf( output, "%sbreak;\n", INDENT[3]);
@@ -4315,58 +7463,6 @@ void EmitProcessorBhv_ABI( FILE *output){
 }
 
 
-/**************************************/
-/*!  Emits the body of a processor implementation for
-  a multicycle processor
-  \brief Used by CreateProcessorImpl function      */
-/***************************************/
-void EmitMultiCycleProcessorBhv( FILE *output){
-
-
-  fprintf( output, "%sif( ac_cycle == 1 ){\n\n", INDENT[1]);
-
-  EmitFetchInit(output, 2);
-  EmitDecodification(output, 3);
-
-  //Multicycle execution demands a different control. Do not use EmitInstrExec.
-  fprintf( output, "%sac_pc = decode_pc;\n", INDENT[3]);
-  fprintf( output, "%sac_cycle = 1;\n", INDENT[3]);
-  fprintf( output, "%sinstr = (ac_instruction *)ISA.instr_table[ins_id][1];\n", INDENT[3]);
-  fprintf( output, "%sformat = (ac_instruction *)ISA.instr_table[ins_id][2];\n", INDENT[3]);
-  fprintf( output, "%sformat->set_fields( *instr_vec  );\n", INDENT[3]);
-  fprintf( output, "%sinstr->set_fields( *instr_vec  );\n", INDENT[3]);
-
-  if( ACDebugFlag ){
-    fprintf( output, "%sif( ac_do_trace != 0 ) \n", INDENT[3]);
-    fprintf( output, PRINT_TRACE, INDENT[4]);
-  }
-
-  if( ACStatsFlag ){
-    fprintf( output, "%sac_sim_stats.instr_executed++;;\n", INDENT[3]);
-    fprintf( output, "%sac_sim_stats.instr_table[ins_id].count++;\n", INDENT[3]);
-    fprintf( output, "%sac_sim_stats.ac_min_cycle_count += instr->get_min_latency();\n", INDENT[3]);
-    fprintf( output, "%sac_sim_stats.ac_max_cycle_count += instr->get_max_latency();\n", INDENT[3]);
-  }
-
-  fprintf( output, "%sISA.instruction.set_cycles( instr->get_cycles());\n", INDENT[3]);
-  fprintf( output, "%sISA.instruction.set_size( instr->get_size());\n", INDENT[3]);
-
-  fprintf( output, "%s}\n", INDENT[2]);
-  fprintf( output, "%sac_instr_counter+= 1;\n", INDENT[2]);
-
-  fprintf( output, "%s}\n", INDENT[1]);
-
-  fprintf( output, "%sISA.instruction.behavior( (ac_stage_list)0, ac_cycle );\n", INDENT[1]);
-  fprintf( output, "%sformat->behavior((ac_stage_list)0, ac_cycle );\n", INDENT[1]);
-  fprintf( output, "%sinstr->behavior((ac_stage_list)0, ac_cycle );\n", INDENT[1]);
-
-  fprintf( output, "%sif( ac_cycle > instr->get_cycles())\n", INDENT[1]);
-  fprintf( output, "%sac_cycle=1;\n\n", INDENT[2]);
-
-  fprintf( output, "%sbhv_done.write(1);\n", INDENT[1]);
-  fprintf( output, "}\n\n");
-}
-
 /**************************************/
 /*!  Emits the define that implements the ABI control
   for pipelined architectures
@@ -4390,7 +7486,7 @@ void EmitPipeABIDefine( FILE *output){
     fprintf( output, "%strace_file << hex << decode_pc << dec << endl; \\\n", INDENT[5]);
   }
 
-  fprintf( output, "%sISA.syscall.NAME(); \\\n", INDENT[4]);
+  fprintf( output, "%s{ ac_syscall_profile_scope ac_syscall_profiled(#NAME); ISA.syscall.NAME(); } \\\n", INDENT[4]);
   fprintf( output, "%sac_instr_counter++; \\\n", INDENT[4]);
   fprintf( output, "%sflushes_left = 7; \\\n", INDENT[4]);
   fprintf( output, "%s} \\\n", INDENT[3]);
@@ -4423,7 +7519,16 @@ void EmitABIDefine( FILE *output){
     fprintf( output, "%strace_file << hex << decode_pc << dec << endl; \\\n", INDENT[5]);
   }
 
-  fprintf( output, "%sISA.syscall.NAME(); \\\n", INDENT[4]);
+  if( ACRegLocalsFlag )
+    fprintf( output, "%sthis->decode_pc = decode_pc; \\\n", INDENT[4]);
+
+  if( ACPluginsFlag )
+    fprintf( output, "%sif (AC_HOOK_ON(AC_HOOK_SYSCALL)) ac_hook_syscall(decode_pc, #NAME); \\\n", INDENT[4]);
+
+  if( ACHostProfileFlag )
+    fprintf( output, "%s{ ac_host_phase_scope ac_host_phased(AC_PHASE_SYSCALL); ac_syscall_profile_scope ac_syscall_profiled(#NAME); ISA.syscall.NAME(); } \\\n", INDENT[4]);
+  else
+    fprintf( output, "%s{ ac_syscall_profile_scope ac_syscall_profiled(#NAME); ISA.syscall.NAME(); } \\\n", INDENT[4]);
   fprintf( output, "%sbreak;  \\\n", INDENT[3]);
 }
 
@@ -4440,6 +7545,25 @@ void EmitABIAddrList( FILE *output, int base_indent){
   fprintf( output, "#undef AC_SYSC\n\n");
 }
 
+/**************************************/
+/*!  Emits the initializers of a plain storage and of
+  the port bound to it. The cores of a multi-core
+  simulation after the first bind their ports to the
+  storages of the first and allocate no storage.
+  \brief Used by CreateArchImpl function      */
+/***************************************/
+void EmitStorageInit( FILE *output, ac_sto_list* pstorage){
+
+  if( ACMultiCoreFlag ){
+    fprintf(output, "%s%s_stg(\"%s_stg\", shared ? 0U : %uU%s),\n", INDENT[1], pstorage->name, pstorage->name, pstorage->size, ACGuardMemoryFlag ? ", !shared" : "");
+    fprintf( output, "%s%s(*this, shared ? shared->%s_stg : %s_stg)", INDENT[1], pstorage->name, pstorage->name, pstorage->name);
+  }
+  else{
+    fprintf(output, "%s%s_stg(\"%s_stg\", %uU%s),\n", INDENT[1], pstorage->name, pstorage->name, pstorage->size, ACGuardMemoryFlag ? ", true" : "");
+    fprintf( output, "%s%s(*this, %s_stg)", INDENT[1], pstorage->name, pstorage->name);
+  }
+}
+
 /**************************************/
 /*!  Emits a ac_cache instantiation.
   \brief Used by CreateResourcesImpl function      */
@@ -4534,8 +7658,9 @@ void EmitCacheDeclaration( FILE *output, ac_sto_list* pstorage, int base_indent)
     case 4: /* The fourth  parameter may be the write policy or the replacement strategy.
                If it is a direct-mapped cache, then we don't have a replacement strategy,
                so this parameter must be the write policy, which is "wt" (write-through) or
-               "wb" (write-back). Otherwise, it must be a replacement strategy, which is "lru"
-               or "random", and the fifth parameter will be the write policy. */
+               "wb" (write-back). Otherwise, it must be a replacement strategy, which is "lru",
+               "plru", "bitplru", "srrip", "brrip" or "random", and the fifth parameter will be
+               the write policy. */
 
       if( is_dm ){ //This value is set when the first parameter is being processed.
         /* So this is a write-policy */
@@ -4561,9 +7686,21 @@ void EmitCacheDeclaration( FILE *output, ac_sto_list* pstorage, int base_indent)
         else if( !strcmp( pparms->str, "random") || !strcmp( pparms->str, "RANDOM") ) {
           sprintf( parm5, "RANDOM");  //Including parameter
         }
+        else if( !strcmp( pparms->str, "plru") || !strcmp( pparms->str, "PLRU") ) {
+          sprintf( parm5, "PLRU");  //Including parameter
+        }
+        else if( !strcmp( pparms->str, "bitplru") || !strcmp( pparms->str, "BITPLRU") ) {
+          sprintf( parm5, "BITPLRU");  //Including parameter
+        }
+        else if( !strcmp( pparms->str, "srrip") || !strcmp( pparms->str, "SRRIP") ) {
+          sprintf( parm5, "SRRIP");  //Including parameter
+        }
+        else if( !strcmp( pparms->str, "brrip") || !strcmp( pparms->str, "BRRIP") ) {
+          sprintf( parm5, "BRRIP");  //Including parameter
+        }
         else{
           AC_ERROR("Invalid parameter in cache declaration: %s\n", pstorage->name);
-          printf("For non-direct-mapped caches, the fourth parameter must be a valid replacement strategy: \"lru\" or \"random\".\n");
+          printf("For non-direct-mapped caches, the fourth parameter must be a valid replacement strategy: \"lru\", \"plru\", \"bitplru\", \"srrip\", \"brrip\" or \"random\".\n");
           exit(1);
         }
       }
@@ -4746,3 +7883,41 @@ void ReadConfFile(){
   free(conf_filename_local);
   free(conf_filename_global);
 }
+
+//!Returns log2 of the instruction size in bytes when every format has the same size
+/*!Used to index one decode cache slot per instruction instead of per byte.
+   Variable-width ISAs get 0, keeping byte granularity. */
+int GetInstrSizeShift(){
+
+  extern ac_dec_format *format_ins_list;
+  ac_dec_format *pformat;
+  int size, shift;
+
+  if( !format_ins_list )
+    return 0;
+
+  size = format_ins_list->size;
+  for( pformat = format_ins_list->next; pformat != NULL; pformat = pformat->next)
+    if( pformat->size != size )
+      return 0;
+
+  size /= 8;
+  for( shift = 0; (1 << (shift+1)) <= size; shift++);
+
+  //Only power of two instruction sizes can be turned into a shift
+  if( (1 << shift) != size )
+    return 0;
+
+  return shift;
+}
+
+//!Tells whether the processor class counts the use of its decode cache
+/*!The stages of pipelined models keep decode caches of their own, which
+   are not counted. */
+int HaveDecStats(){
+
+  extern ac_stg_list *stage_list;
+  extern ac_pipe_list *pipe_list;
+
+  return ACDecCacheFlag && !stage_list && !pipe_list;
+}
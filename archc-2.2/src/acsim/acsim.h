@@ -44,6 +44,7 @@
 static const char *INDENT[]={"","  ","    ","      ","        ","          ","            ","              "};
 
 #define CONF_MAX_LINE 256   //!<Maximal number of characters per line in archc.conf
+#define ACSIM_MANIFEST ".acsim_manifest"  //!<Hashes of the files acsim generated last
 
 
 #define WRITE_THROUGH   0x01    //!<Cache will use the write-through policy.
@@ -84,6 +85,11 @@ char *OTHER_FLAGS;    //!<Miscellaneous flags to be passed to the compiler
 #define AC_MSG( str, ...) fprintf(stdout, "ArchC: " str, ##__VA_ARGS__);
 //#define AC_MSG( str ) printf("ArchC: ");printf str;
 
+//! Library classes emitted for TLM ports and interrupt ports; they also
+//! name their headers and objects.
+#define TLM_PORT_CLASS       (ACTLM2Flag ? "ac_tlm2_port" : "ac_tlm_port")
+#define TLM_INTR_PORT_CLASS  (ACTLM2Flag ? "ac_tlm2_intr_port" : "ac_tlm_intr_port")
+
 //! Enumeration type for command line options
 enum _ac_cmd_options {
   OPABI,
@@ -97,6 +103,34 @@ enum _ac_cmd_options {
   OPVersion,
   OPGDBIntegration,
   OPWait,
+  OPSparseDecCache,
+  OPThreadedDispatch,
+  OPBlockCache,
+  OPFormatStructs,
+  OPTableDecoder,
+  OPPreDecode,
+  OPDecSnapshot,
+  OPDecInvalidate,
+  OPJIT,
+  OPMultiCore,
+  OPStandalone,
+  OPAdaptiveBatch,
+  OPCheckpoint,
+  OPBatch,
+  OPServer,
+  OPHostEndianMem,
+  OPMemTrace,
+  OPMemHeatmap,
+  OPTemporalDecoupling,
+  OPTLM2,
+  OPHostProfile,
+  OPGuardMemory,
+  OPRegLocals,
+  OPFusedBehavior,
+  OPSyncRegDirty,
+  OPPlugins,
+  OPInstrTrace,
+  OPMPI,
   ACNumberOfOptions
 };
 
@@ -109,6 +143,8 @@ typedef enum  _ac_cmd_options_ ac_cmd_options;
 ///////////////////////////////////////
 
 void print_comment( FILE* output, char* description);
+FILE *open_output( char* filename);
+void close_output( FILE* output, char* filename);
 
 /** @defgroup createfunc Create Functions
  * @ingroup acsim
@@ -136,6 +172,7 @@ void CreateArchSyscallHeader(void);               //!< Creates the header file f
 void CreateIntrHeader(void);                      //!< Creates the header file for interrupt handlers.
 void CreateIntrMacrosHeader(void);                //!< Creates the header file for interrupt handler macros.
 void CreateMakefile(void);                        //!< Creates a Makefile for teh ArchC nodel.
+void CreatePchHeader(void);                       //!< Creates the header of the library includes the Makefile precompiles.
 void CreateStgImpl(ac_stg_list* stage_list, char* pipe_name); //!< Creates the .cpp file for pipeline stages.
 void CreateRegsImpl(void);                        //!< Creates the .cpp template file for formatted registers.
 void CreateImplTmpl(void);                        //!< Creates the .cpp template file for behavior description.
@@ -155,7 +192,7 @@ void EmitDecStruct( FILE* output);                //!< Emit decoder structure in
 void EmitPipeUpdateMethod( FILE *output);         //!< Emit reg update method for pipelined architectures.
 void EmitMultiPipeUpdateMethod( FILE *output);    //!< Emit reg update method for multi-pipelined architectures.
 void EmitUpdateMethod( FILE *output);             //!< Emit reg update method for non-pipelined architectures.
-void EmitMultiCycleProcessorBhv(FILE *output);    //!< Emit processor behavior for a multicycle processor.
+void EmitStatsWatch( FILE *output);               //!< Emit the statistics dumps and snapshots of init().
 void EmitProcessorBhv( FILE *output);             //!< Emit processor behavior for a single-cycle processor.
 void EmitProcessorBhv_ABI( FILE *output);         //!< Emit processor behavior for a single-cycle processor with ABI provided.
 void EmitABIAddrList( FILE *output, int base_indent);           //!< Emit the calls for macros containing the list o address used for system calls
@@ -164,6 +201,25 @@ void EmitPipeABIDefine( FILE *output);            //!< Emit the define that impl
 void EmitInstrExec(FILE *output, int base_indent);              //!< Emit code for executing an instruction behavior
 void EmitDecodification(FILE *output, int base_indent);         //!< Emit for instruction decodification
 void EmitFetchInit(FILE *output, int base_indent);              //!< Emit code used for initializing fetchs
+void EmitDispatchTable(FILE *output, int base_indent);          //!< Emit the label table used by threaded dispatch
+void EmitBlockExec(FILE *output, int base_indent);              //!< Emit the replay loop for cached blocks of instructions
+void EmitBlockCacheImpl(FILE *output);                          //!< Emit block cache lookup and recording methods
+void EmitFormatStructs(FILE *output, int base_indent);          //!< Emit per-format operand structs and the decode cache entry
+void EmitFormatFill(FILE *output, int base_indent);             //!< Emit the method that fills a decode cache entry
+void EmitFieldOperand(FILE *output, ac_dec_format *pformat, ac_dec_field *pfield);  //!< Emit a decoded field as a behavior argument
+void EmitFieldExtract(FILE *output, ac_dec_field *pfield);      //!< Emit the extraction of a field from an instruction word
+void EmitDecodeNode(FILE *output, ac_dec_instr **cands, int n, char *used, int base_indent);  //!< Emit one level of the decode tables
+void EmitTableDecoder(FILE *output);                            //!< Emit the table-driven decoder
+void EmitPreDecodeImpl(FILE *output);                           //!< Emit the methods that pre-decode the program text
+void EmitCodeWrittenImpl(FILE *output);                         //!< Emit the decode cache invalidation for written code pages
+void EmitJITDecl(FILE *output);                                 //!< Emit the block translator declarations
+void EmitJITImpl(FILE *output);                                 //!< Emit the block translator and per-instruction entry points
+void EmitVerifyDigest(FILE *output);                            //!< Emit the digest mode of the co-verification method
+void EmitCheckpointImpl(FILE *output);                          //!< Emit the checkpoint save and restore methods
+void EmitMultiCoreMain(FILE *output);                           //!< Emit the multi-core driver of the main file template
+void EmitBatchMain(FILE *output);                               //!< Emit the batch job runner of the main file template
+void EmitServerMain(FILE *output);                              //!< Emit the job server of the main file template
+void EmitStorageInit(FILE *output, ac_sto_list* pstorage);     //!< Emit the initializers of a plain storage and its port
 void EmitCacheDeclaration(FILE *output, ac_sto_list* pstorage, int base_indent);       //!< Emit code for ac_cache object declaration
 //@}
 
@@ -173,6 +229,8 @@ void EmitCacheDeclaration(FILE *output, ac_sto_list* pstorage, int base_indent);
  * @{
  */
 void ReadConfFile(void);                          //!< Read archc.conf contents.
+int GetInstrSizeShift(void);                      //!< Returns log2 of the instruction size in bytes for fixed-width ISAs, or 0.
+int HaveDecStats(void);                           //!< Tells whether the processor class counts the use of its decode cache.
 //@}
 
 
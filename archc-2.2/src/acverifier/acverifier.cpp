@@ -16,7 +16,8 @@
  *            This file contains functions to control the ArchC 
  *            co-verification engine. This engine will supervise
  *            simulation of two ArchC models monitoring updates to the
- *            storage devices. This is accomplished through IPC messages
+ *            storage devices. This is accomplished through messages
+ *            sent over a shared-memory ring per model
  *
  * @attention Copyright (C) 2002-2006 --- The ArchC Team
  *
@@ -24,15 +25,21 @@
 
 #include <stdlib.h>
 #include <errno.h>
+#include <signal.h>
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/msg.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <string.h>
+#include <math.h>
 #include <iostream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <tr1/unordered_map>
 
 #include "ac_msgbuf.H"
+#include "ac_verify_ring.H"
+#include "ac_verify_digest.H"
 
 #define REFERENCE_MODEL 0
 #define DUV_MODEL 1
@@ -47,18 +54,74 @@ char ACVersion[] = "0.9-beta";
 //This is the maximal number of unmatched logs accepted before aborting co-verification
 static const unsigned int AC_MAX_UNMATCHED = 20;
 
-//These variables will be used to control and access message queues
+//These variables will be used to control and access the message rings
 //and child processes
-key_t ref_key, duv_key;
-int ref_msqid, duv_msqid;
+char ring_name[64];
+ac_verify_shm *ring_shm;
+ac_verify_ring ref_ring, duv_ring;
 pid_t ref_pid, duv_pid;
-struct msqid_ds ref_info, duv_info;
+
+//Arguments each model is run with
+char **ref_args, **duv_args;
+int ref_status, duv_status;
+bool ref_reaped, duv_reaped;
 
 //Device list for both models
 struct dev_list *ref_devlist = NULL, *duv_devlist = NULL;
 struct start_msgbuf ref_sbuf, duv_sbuf;
+
+struct dev_loglist{
+	long type;
+	char name[256];
+	unsigned unmatched[2];  //Logs of each model still waiting for a match
+	struct dev_loglist *next;
+};
+
 struct dev_loglist *loglist = NULL;
 
+//Logs waiting for their match, keyed on the device, the address and the
+//value. Digests are also keyed on their instruction count, which both models
+//share, while the time of an update depends on the timing of each model.
+struct log_key {
+	long type;
+	unsigned addr;
+	unsigned long long value;
+	double time;
+};
+
+struct log_key_hash {
+	size_t operator()( const log_key &k ) const {
+		unsigned long long h = k.value * 1099511628211ULL;
+
+		h ^= ((unsigned long long) k.addr << 8) ^ (unsigned long long) k.type;
+		h ^= (unsigned long long) k.time * 0x9e3779b97f4a7c15ULL;
+		return (size_t) (h ^ (h >> 29));
+	}
+};
+
+inline bool operator== ( const log_key &k1, const log_key &k2 ){
+	return k1.type == k2.type && k1.addr == k2.addr && k1.value == k2.value && k1.time == k2.time;
+}
+
+struct pending_log {
+	int model;
+	long type;
+	ac_vlog log;
+};
+
+typedef std::tr1::unordered_multimap<log_key, pending_log, log_key_hash> log_table;
+
+//Every key holds logs of a single model: a log of the other one matches them
+log_table pending;
+
+//Digest mode (--digest=N). Digest points are instruction counts.
+unsigned long long digest_interval = 0;       //0 compares every update
+double digest_done[2];                        //Last point each model closed
+std::map<double, unsigned> digest_unmatched;  //Unmatched digests per point
+double diverged_at;                           //First point that mismatched, -1 if none
+std::vector<pending_log> divergence;          //Its unmatched digests
+bool ref_ckpt = 0, duv_ckpt = 0;              //Models were built with --checkpoint
+
 
 
 
@@ -99,13 +162,17 @@ inline void ddprintf(const char *format, ...) {}
 
 //Function Prototypes
 void CheckOptions(int model);
-void ListInit(struct dev_list** model_devlist, int msqid, start_msgbuf *sbuf );
+void ListInit(struct dev_list** model_devlist, ac_verify_ring& ring, start_msgbuf *sbuf );
 void CheckListConsistency(void);
-void AddLog( long type, change_log log, int device );
+void AddLog( long type, ac_vlog log, int device );
 void MatchLogs( void);
+void MatchDigests( void);
 
 //void DoIt(void);
+bool RunModels(const char *digest, char **ref_extra, char **duv_extra);
 void DoItOntheFly(void);
+int DrainRing(ac_verify_ring& ring, pid_t pid, int side, bool *finished);
+void VerifyDigests(void);
 void FinishIt(void);
 void ChangeDump( struct dev_loglist *pllist );
 
@@ -114,7 +181,7 @@ static void DisplayHelp (){
   printf ("==================================================\n");
   printf (" This is ArchC Verifier for ArchC version %s\n", ACVersion);
   printf ("==================================================\n\n");
-  printf ("Usage: ac_verifier REF_model DUV_model APP [--ref_args=arguments] [--duv_args=arguments]\n\n");
+  printf ("Usage: ac_verifier REF_model DUV_model APP [--digest=N] [--ref_args=arguments] [--duv_args=arguments]\n\n");
   printf ("    Where:\n\n");
   printf ("    --> \"REF_model\" and \"DUV_model\" stand for the path to the executable files\n");
   printf ("         of each model respectively.\n\n");
@@ -124,6 +191,10 @@ static void DisplayHelp (){
 	printf ("         It must be specified both for the reference and duv models.\n");         
 	printf ("         You may specify different arguments for the two models. Like different names for\n");         
 	printf ("         output files that you want to compare after the simulation, for example.\n");         
+	printf ("    --> \"--digest=N\" compares hashes of the written memory pages and of the register\n");
+	printf ("         banks every N instructions instead of every update. When they differ, the\n");
+	printf ("         models are run again on narrower windows, from a checkpoint if both were\n");
+	printf ("         built with --checkpoint, until the first mismatching instruction is found.\n");
   printf ("\n\n");
 }
 
@@ -136,16 +207,8 @@ void ABORT(){
 
 	cerr << "Aborting co-verification ..." << endl;
 
-	//Deleting message queues
-	if (msgctl(ref_msqid, IPC_RMID, NULL) == -1) {
-		perror("msgctl");
-		cerr << "Could not delete Ref model msg queue."<<endl;
-	}
-
-	if (msgctl(duv_msqid, IPC_RMID, NULL) == -1) {
-		perror("msgctl");
-		cerr << "Could not delete Ref model msg queue."<<endl;
-	}
+	//Deleting message rings
+	ac_verify_ring::destroy(ring_shm, ring_name);
 
 	if (kill(ref_pid, 15)== -1) {
 		perror("kill");
@@ -164,23 +227,16 @@ void ABORT(){
 /////////////////////////////////////////////
 // This is the main function.
 // It will handle command-line arguments and
-// create message queues.
+// create message rings.
 /////////////////////////////////////////////
 int main(int argc, char *argv[])
 {
 		char *ref_argv[argc], *duv_argv[argc];
-		char *ref_version_arg[2];
-		char *duv_version_arg[2];
+		char *ref_version_arg[3];
+		char *duv_version_arg[3];
 		int j,i, nargs; 
-		int ref_status, duv_status;
 		++argv, --argc;  /* skip over program name */
 
-
-		ref_version_arg[0] =  "--version";
-		ref_version_arg[1] = " 2>refout.tmp";
-		duv_version_arg[0] =  "--version";
-		duv_version_arg[1] = " 2>refout.tmp";
-
 		//The user asked for help ...
 		if( !argv[0] || !strcmp(argv[0], "--help") || !strcmp(argv[0], "-h")){
 			DisplayHelp();
@@ -206,28 +262,15 @@ int main(int argc, char *argv[])
 
 
 
-		//Creating message queues.
-    if ((ref_key = ftok(argv[0], 'A')) == -1) {
-        perror("ftok");
-        exit(1);
-    }
-		dprintf("Reference model queue key: %d\n",ref_key);
-
-    if ((duv_key = ftok(argv[1], 'A')) == -1) {
-        perror("ftok");
-        exit(1);
-    }
-		dprintf("DUV model queue key: %d\n",duv_key);
-
-    if ((ref_msqid = msgget(ref_key, 0666 | IPC_CREAT)) == -1) {
-        perror("msgget");
-        exit(1);
-    }
-    
-    if ((duv_msqid = msgget(duv_key, 0666 | IPC_CREAT)) == -1) {
-        perror("msgget");
+		//Creating message rings, one for each model, in a single segment.
+		snprintf(ring_name, sizeof(ring_name), "/acverifier.%d", (int) getpid());
+    if ((ring_shm = ac_verify_ring::create(ring_name)) == NULL) {
+        perror("shm_open");
         exit(1);
     }
+		ref_ring.attach(ring_shm, REFERENCE_MODEL);
+		duv_ring.attach(ring_shm, DUV_MODEL);
+		dprintf("Message rings in %s\n", ring_name);
 
 
 		/* Preparing arguments to be passed for both models */
@@ -248,16 +291,25 @@ int main(int argc, char *argv[])
 
 		nargs=argc-3; //Number of remaining arguments to be processed
 
-		if ( !nargs ){
+		ref_argv[2] = NULL;
+		duv_argv[2] = NULL;
+		if ( !nargs )
 				dprintf("Running app has no args\n");
-				ref_argv[2] = NULL;
-				duv_argv[2] = NULL;
-		}				
 			
 		argv+=3;
 		i=0;
 		while( i <nargs ){ //This means that we have arguments to pass to the running app
 			
+			if( !strncmp( argv[i], "--digest=", 9) ){
+				digest_interval = strtoull(argv[i] + 9, NULL, 10);
+				if( !digest_interval ){
+					AC_ERROR("Invalid argument! --digest needs a number of instructions.");
+					exit(1);
+				}
+				i++;
+				continue;
+			}
+
 			if( !strncmp( argv[i], "--ref_args=", 11) ){
 				
 				//Storing Reference model running app args
@@ -268,7 +320,7 @@ int main(int argc, char *argv[])
 				j=3;
 				dprintf("Storing  arg %s\n", ref_argv[2]);
 
-				while( (i<nargs) && (strncmp( argv[i], "--duv_args=", 11) )){
+				while( (i<nargs) && (strncmp( argv[i], "--duv_args=", 11) ) && (strncmp( argv[i], "--digest=", 9) )){
 					
 					ref_argv[j] = (char*)malloc(strlen(argv[i])+1);
 					strcpy(ref_argv[j], argv[i]);					
@@ -290,7 +342,7 @@ int main(int argc, char *argv[])
 				j=3;
 				dprintf("Storing  arg %s\n", duv_argv[2]);
 				
-				while( (i<nargs) && (strncmp( argv[i], "--ref_args=", 11) )){
+				while( (i<nargs) && (strncmp( argv[i], "--ref_args=", 11) ) && (strncmp( argv[i], "--digest=", 9) )){
 					duv_argv[j] = (char*)malloc(strlen(argv[i])+1);
 					strcpy(duv_argv[j], argv[i]);					
 					dprintf("Storing  arg %s\n", duv_argv[j]);
@@ -300,16 +352,36 @@ int main(int argc, char *argv[])
 				dprintf("DUV running application will receive %d arguments\n", j-2);
 				duv_argv[j] = NULL;
 			}
+
+			if( i < nargs && strncmp( argv[i], "--ref_args=", 11) && strncmp( argv[i], "--duv_args=", 11) &&
+					strncmp( argv[i], "--digest=", 9) ){
+				AC_ERROR("Invalid argument: " << argv[i]);
+				cerr << "   Try running ac_verifier --help for more information." <<endl;
+				exit(1);
+			}
 		}		
+		ref_args = ref_argv;
+		duv_args = duv_argv;
 
 		//Checking if both models were generated with the -v version.
 		//Running  models with --version option.
+		ref_version_arg[0] = ref_argv[0];
+		ref_version_arg[1] = (char*) "--version";
+		ref_version_arg[2] = NULL;
+		duv_version_arg[0] = duv_argv[0];
+		duv_version_arg[1] = (char*) "--version";
+		duv_version_arg[2] = NULL;
+
 		if( !(ref_pid = fork()) ){
+			freopen("refout.tmp", "w", stdout);
 			execv(ref_argv[0], ref_version_arg);
+			_exit(1);
 		}
 		else{
 			if( !(duv_pid = fork()) ){
+				freopen("duvout.tmp", "w", stdout);
 				execv(duv_argv[0], duv_version_arg);
+				_exit(1);
 			}
 			else{
 				//Waiting for the ref model to terminate
@@ -327,65 +399,131 @@ int main(int argc, char *argv[])
 
 		//Now everything was checked. Let's start the co-verification process
 		//
+		if( !digest_interval ){
+			RunModels(NULL, NULL, NULL);
 
-		/* Creating process for both models */
-		if( !(ref_pid = fork()) ){
-			execv(ref_argv[0], ref_argv);
+			//Finalizing co-verification process
+			FinishIt();
 		}
-		else{
-			if( !(duv_pid = fork()) ){
-				execv(duv_argv[0], duv_argv);
-			}
-			else{
+		else
+			VerifyDigests();
 
-				//Initializing both device lists
-				dprintf("REFERENCE MODEL QUEUE (%d) INITIALIZATION:\n\n",ref_msqid);
-				ListInit(&ref_devlist, ref_msqid, (struct start_msgbuf*)&ref_sbuf);
-				dprintf("DUV MODEL QUEUE (%d) INITIALIZATION:\n\n",duv_msqid);
-				ListInit(&duv_devlist, duv_msqid, (struct start_msgbuf*)&duv_sbuf);
+		//Run the co-verification....
+    printf("Co-verification finished.\n");
 
-				//Device list of both models (ref and duv) must have the same devices (number and names)
-				CheckListConsistency();
+		//Deleting message rings
+		ac_verify_ring::destroy(ring_shm, ring_name);
 
-				DoItOntheFly();
+    return 0;
+}
 
-				waitpid(ref_pid,&ref_status,0);
 
-				//TODO:Padronizar saida de erro
-				if(!WIFEXITED(ref_status)){
-					cerr << "Reference model returned with error"  <<endl;
-					if(WIFSIGNALED(ref_status))
-						cerr << "Signal : " << WTERMSIG(ref_status)<<endl;
-				}
+///////////////////////////////////////////
+// Runs both models once, comparing their logs.
+// digest is the AC_VERIFY_DIGEST value, NULL
+// for every update. The extra arguments come
+// before the ones of the model. Returns false
+// if a model did not exit normally.
+///////////////////////////////////////////
+static char **ModelArgv( char **model_argv, char **extra ){
+
+	int n = 0, m = 0, i;
+	char **v;
+
+	while( model_argv[n] ) n++;
+	while( extra && extra[m] ) m++;
+	v = (char **) malloc( sizeof(char*) * (n + m + 1) );
+	v[0] = model_argv[0];
+	for( i = 0; i < m; i++ )
+		v[i+1] = extra[i];
+	for( i = 1; i <= n; i++ )
+		v[i+m] = model_argv[i];
+	return v;
+}
 
-				waitpid(duv_pid,&duv_status,0);
+static void StartModel( int model, char **model_argv, char **extra, const char *digest ){
 
-				if(!WIFEXITED(duv_status)){
-					cerr << "DUV  model returned with error" << endl;
-					if(WIFSIGNALED(duv_status))
-						cerr << "Signal : " << WTERMSIG(duv_status)<<endl;
-				}
-			}
-		}
+	char ring_env[96];
 
-		//Finalizing co-verification process
-		FinishIt();
+	snprintf(ring_env, sizeof(ring_env), "%s:%d", ring_name, model);
+	setenv(AC_VERIFY_RING_ENV, ring_env, 1);
+	if( digest )
+		setenv(AC_VERIFY_DIGEST_ENV, digest, 1);
+	execv(model_argv[0], ModelArgv(model_argv, extra));
+	perror("execv");
+	_exit(1);
+}
 
-		//Run the co-verification....
-    printf("Co-verification finished.\n");
+bool RunModels( const char *digest, char **ref_extra, char **duv_extra ){
 
-		//Deleting message queues
-    if (msgctl(ref_msqid, IPC_RMID, NULL) == -1) {
-        perror("msgctl");
-        exit(1);
-    }
+	struct dev_list *pdl;
+	struct dev_loglist *pll;
+	bool ok = true;
+
+	//Forgetting the previous run
+	while( (pdl = ref_devlist) ){ ref_devlist = pdl->next; delete pdl; }
+	while( (pdl = duv_devlist) ){ duv_devlist = pdl->next; delete pdl; }
+	while( (pll = loglist) ){ loglist = pll->next; delete pll; }
+	pending.clear();
+	digest_unmatched.clear();
+	digest_done[0] = digest_done[1] = -1;
+	diverged_at = -1;
+	ref_reaped = duv_reaped = 0;
+
+	ac_verify_ring::reset(ring_shm);
+	ref_ring.attach(ring_shm, REFERENCE_MODEL);
+	duv_ring.attach(ring_shm, DUV_MODEL);
+
+	/* Creating process for both models, each told its ring */
+	if( !(ref_pid = fork()) )
+		StartModel(REFERENCE_MODEL, ref_args, ref_extra, digest);
+	if( !(duv_pid = fork()) )
+		StartModel(DUV_MODEL, duv_args, duv_extra, digest);
+
+	//Initializing both device lists
+	dprintf("REFERENCE MODEL RING INITIALIZATION:\n\n");
+	ListInit(&ref_devlist, ref_ring, (struct start_msgbuf*)&ref_sbuf);
+	dprintf("DUV MODEL RING INITIALIZATION:\n\n");
+	ListInit(&duv_devlist, duv_ring, (struct start_msgbuf*)&duv_sbuf);
+
+	//Device list of both models (ref and duv) must have the same devices (number and names)
+	CheckListConsistency();
+
+	if( digest_interval && (!ref_sbuf.digest || !duv_sbuf.digest) ){
+		AC_ERROR("--digest needs both models generated by acsim with the -v option.");
+		ABORT();
+	}
 
-    if (msgctl(duv_msqid, IPC_RMID, NULL) == -1) {
-        perror("msgctl");
-        exit(1);
-    }
+	DoItOntheFly();
 
-    return 0;
+	//Nothing after a divergence is compared
+	if( diverged_at >= 0 ){
+		kill(ref_pid, SIGKILL);
+		kill(duv_pid, SIGKILL);
+	}
+
+	if( !ref_reaped )
+		waitpid(ref_pid,&ref_status,0);
+
+	//TODO:Padronizar saida de erro
+	if(!WIFEXITED(ref_status) && diverged_at < 0){
+		cerr << "Reference model returned with error"  <<endl;
+		if(WIFSIGNALED(ref_status))
+			cerr << "Signal : " << WTERMSIG(ref_status)<<endl;
+	}
+	ok = ok && WIFEXITED(ref_status) && !WEXITSTATUS(ref_status);
+
+	if( !duv_reaped )
+		waitpid(duv_pid,&duv_status,0);
+
+	if(!WIFEXITED(duv_status) && diverged_at < 0){
+		cerr << "DUV  model returned with error" << endl;
+		if(WIFSIGNALED(duv_status))
+			cerr << "Signal : " << WTERMSIG(duv_status)<<endl;
+	}
+	ok = ok && WIFEXITED(duv_status) && !WEXITSTATUS(duv_status);
+
+	return ok || diverged_at >= 0;
 }
 
 
@@ -409,7 +547,22 @@ int main(int argc, char *argv[])
 // Type 3 ...  are types created for each device to be verified
 //////////////////////////////////////////////////////////
 
-void ListInit( struct dev_list** model_devlist, int msqid, start_msgbuf *sbuf ){
+//Waits for the next message of a ring. Models that exit before sending
+//it abort the co-verification.
+void ReceiveMsg( ac_verify_ring& ring, void *msg, unsigned size ){
+
+	while( !ring.receive(msg, size) ){
+		if( waitpid(ref_pid, NULL, WNOHANG) == ref_pid || waitpid(duv_pid, NULL, WNOHANG) == duv_pid ){
+			if( ring.receive(msg, size) )
+				return;
+			AC_ERROR("A model exited during co-verification initialization.");
+			ABORT();
+		}
+		ac_verify_ring::wait(ring_shm, 100);
+	}
+}
+
+void ListInit( struct dev_list** model_devlist, ac_verify_ring& ring, start_msgbuf *sbuf ){
 
 	struct dev_msgbuf dbuf;
 	struct dev_list *pdevlist;
@@ -417,10 +570,7 @@ void ListInit( struct dev_list** model_devlist, int msqid, start_msgbuf *sbuf ){
 
 
 	//Processing first message...
-	if (msgrcv(msqid, sbuf, sizeof(struct start_msgbuf), 0, 0) == -1) {
-		perror("msgrcv");
-		ABORT();
-	}
+	ReceiveMsg(ring, sbuf, sizeof(struct start_msgbuf));
 	
 	//First message must tell the number of devices to be supervised
 	if( sbuf->mtype != 1 ){
@@ -432,10 +582,7 @@ void ListInit( struct dev_list** model_devlist, int msqid, start_msgbuf *sbuf ){
 
 	//2nd ... (N+1) messages must tell the name of the devices to be supervised
 	for( i=0; i< sbuf->ndevice;i++){
-		if (msgrcv(msqid, &dbuf, sizeof(dbuf), 0, 0) == -1) {
-			perror("msgrcv");
-			ABORT();
-		}
+		ReceiveMsg(ring, &dbuf, sizeof(dbuf));
 
 		if( dbuf.mtype != 2 ){
 			AC_ERROR("Invalid initialization message: expecting type 2 (device), got type " << dbuf.mtype);
@@ -493,6 +640,7 @@ void CheckListConsistency( ){
 		pll = new (struct dev_loglist);
 		pll->type = next_type--;  //Device list was created in inverted order, so first type to be processed is the last sent by the models
 		strcpy(pll->name, p1->dbuf.name);
+		pll->unmatched[0] = pll->unmatched[1] = 0;
 		pll->next = loglist;
 		loglist = pll;
 		dprintf("Adding device list for %s with type %d\n",pll->name,pll->type);
@@ -504,113 +652,86 @@ void CheckListConsistency( ){
 
 
 //////////////////////////////////////
-// The main co-verification loop
+// Handles one message of a model.
 //////////////////////////////////////
-void DoItOntheFly(){
+static void TakeLog( struct log_msgbuf &lbuf, int side, bool *finished ){
+
+	//Control messages end the run or close a digest
+	if( lbuf.mtype == 1 ){
+		if( lbuf.log.time == -1 ){
+			*finished = 1;
+			digest_done[side] = HUGE_VAL;
+			dprintf("%s model has finished\n", (side == REFERENCE_MODEL) ? "Reference" : "DUV");
+		}
+		else
+			digest_done[side] = lbuf.log.time;
+		return;
+	}
+
+	//Append to the device list
+	AddLog(lbuf.mtype, lbuf.log, side );
+}
+
+//////////////////////////////////////
+// Consumes every log a model published.
+// Returns how many messages were taken.
+//////////////////////////////////////
+int DrainRing( ac_verify_ring& ring, pid_t pid, int side, bool *finished ){
 
 	struct log_msgbuf lbuf;
-	bool ref_finished=0, duv_finished=0;
-	int ref_status, duv_status;
-	int i;
+	int *status = (side == REFERENCE_MODEL) ? &ref_status : &duv_status;
+	int n = 0;
 
-	//Keep "listening" to the models and comparing update logs
-	while( !ref_finished || !duv_finished ){
+	while( !*finished && ring.receive(&lbuf, sizeof(struct log_msgbuf)) ){
+		n++;
+		TakeLog(lbuf, side, finished);
+	}
 
-		if( !ref_finished ){
-			
-			if (msgctl(ref_msqid, IPC_STAT, &ref_info) == -1) {
-        perror("msgctl");
-        ABORT();
-			}
-			
-			ddprintf("REF QUEUE INFO:\nr-w: %03o, cbytes= %1u, qnum= %1u, qbytes = %1u\n",
-							ref_info.msg_perm.mode & 0777, ref_info.msg_cbytes, ref_info.msg_qnum, ref_info.msg_qbytes);
-			
-			i = ref_info.msg_qnum;
-
-			//If there is nothing on the queue, the child may have exited. Check it
-			if( !i){
-				waitpid(ref_pid,&ref_status,WNOHANG);
-				if(WIFEXITED(ref_status)){
-					dprintf("Matching logs ... Empty queue! Reference model exited!");
-					if(WIFSIGNALED(ref_status))
-						dprintf("Signal :%d ", WTERMSIG(ref_status));
-					ref_finished = 1;
-				}
-			}
+	//If there is nothing on the ring, the child may have exited. Check it
+	if( !n && !*finished && waitpid(pid, status, WNOHANG) == pid ){
+		if( side == REFERENCE_MODEL )
+			ref_reaped = 1;
+		else
+			duv_reaped = 1;
+
+		//Logs published right before exiting
+		while( !*finished && ring.receive(&lbuf, sizeof(struct log_msgbuf)) )
+			TakeLog(lbuf, side, finished);
+		dprintf("Matching logs ... Empty ring! %s model exited!", (side == REFERENCE_MODEL) ? "Reference" : "DUV");
+		if(WIFSIGNALED(*status))
+			dprintf("Signal :%d ", WTERMSIG(*status));
+		*finished = 1;
+		digest_done[side] = HUGE_VAL;
+	}
+	return n;
+}
 
-			//Consuming ref queue msgs
-			while (i) {
+//////////////////////////////////////
+// The main co-verification loop
+//////////////////////////////////////
+void DoItOntheFly(){
 
-				//Listening to Reference model
-				if (msgrcv(ref_msqid, &lbuf, sizeof(struct log_msgbuf), 0, 0) == -1) {
-					perror("msgrcv");
-					ABORT();
-				}
-				// 		cerr << "Log received from ref: ";
-				// 		cerr << lbuf.log <<endl;
-				if( lbuf.log.time == -1 ){
-					ref_finished = 1;
-					dprintf("Reference model has finished\n");
-				}
-				else{
-					//Append to the device list
-					AddLog(lbuf.mtype, lbuf.log, 0 );
-				}
-				i--;
-			}
-		}
+	bool ref_finished=0, duv_finished=0;
+	int ref_got, duv_got;
 
-		if(!duv_finished){
+	//Keep "listening" to the models and comparing update logs
+	while( !ref_finished || !duv_finished ){
 
-			//Gathering info about ref and duv queues
-			if (msgctl(duv_msqid, IPC_STAT, &duv_info) == -1) {
-        perror("msgctl");
-        ABORT();
-			}
-		
-			ddprintf("DUV QUEUE INFO:\nr-w: %03o, cbytes= %1u, qnum= %1u, qbytes = %1u\n",
-							duv_info.msg_perm.mode & 0777, duv_info.msg_cbytes, duv_info.msg_qnum, duv_info.msg_qbytes);
-			
-			i = duv_info.msg_qnum;
-			//If there is nothing on the queue, the child may have exited. Check it
-			if( !i){
-				waitpid(duv_pid,&duv_status,WNOHANG);
-				
-				if(WIFEXITED(duv_status)){
-					dprintf("Matching logs ... Empty queue! DUV  model exited!");
-					if(WIFSIGNALED(duv_status))
-						dprintf("Signal : ", WTERMSIG(duv_status));
-					
-					duv_finished =1;
-				}
-			}
+		ref_got = duv_got = 0;
 
-			//Consuming duv queue msgs
-			while (i) {
+		if( !ref_finished )
+			ref_got = DrainRing(ref_ring, ref_pid, REFERENCE_MODEL, &ref_finished);
 
-				//Listening to DUV model
-				if (msgrcv(duv_msqid, &lbuf, sizeof(struct log_msgbuf), 0, 0) == -1) {
-					perror("msgrcv");
-					ABORT();
-				}
-				// 		cerr << "Log received from DUV: ";
-				// 		cerr << lbuf.log <<endl;
-				if( lbuf.log.time == -1 ){
-					duv_finished = 1;
-					dprintf("DUV model has finished\n");
-				}
-				else{
-					
-					//Append to the device list
-					AddLog(lbuf.mtype, lbuf.log, 1 );
-				}
-				i--;
-			}
-		}
+		if( !duv_finished )
+			duv_got = DrainRing(duv_ring, duv_pid, DUV_MODEL, &duv_finished);
 
 		MatchLogs();
-		
+		if( diverged_at >= 0 )
+			break;
+
+		//Both rings were empty: sleep until a model publishes
+		if( !ref_got && !duv_got && (!ref_finished || !duv_finished) )
+			ac_verify_ring::wait(ring_shm, 100);
 	}
 }
 
@@ -704,27 +825,44 @@ void DoItOntheFly(){
 // device = 0 indicates operation on ref log
 // device = 1 indicates operation on duv log
 //////////////////////////////////////////
-void AddLog( long type, change_log log, int device ){
+void AddLog( long type, ac_vlog log, int device ){
 
 	struct dev_loglist *pllist;
+	log_key key;
+	pending_log plog;
+	std::pair<log_table::iterator, log_table::iterator> range;
 
-
-	for( pllist = loglist; pllist; pllist=pllist->next){
-
-		if( type == pllist->type ){
-
-			if( device )
-				pllist->duv_log.push_back(log);
-			else
-				pllist->ref_log.push_back(log);
-
+	for( pllist = loglist; pllist; pllist=pllist->next)
+		if( type == pllist->type )
 			break;
-		}
-	}
 
-	if( !pllist )
+	if( !pllist ){
 		AC_ERROR("Invalid type ("<<type<<") in log message. Update ignored");
-	
+		return;
+	}
+
+	key.type = type;
+	key.addr = log.addr;
+	key.value = log.value;
+	key.time = digest_interval ? log.time : 0;
+
+	range = pending.equal_range(key);
+	if( range.first != range.second && range.first->second.model != device ){
+		//The other model already did this update
+		pending.erase(range.first);
+		pllist->unmatched[!device]--;
+		if( digest_interval )
+			digest_unmatched[log.time]--;
+	}
+	else{
+		plog.model = device;
+		plog.type = type;
+		plog.log = log;
+		pending.insert(std::make_pair(key, plog));
+		pllist->unmatched[device]++;
+		if( digest_interval )
+			digest_unmatched[log.time]++;
+	}
 }
 
 
@@ -734,50 +872,22 @@ void AddLog( long type, change_log log, int device ){
 void MatchLogs( ){
 
 	struct dev_loglist *pllist;
-  log_list::iterator refitor;
-  log_list::iterator duvitor;
-	bool flag,error=0;
+	bool error=0;
+
+	if( digest_interval ){
+		MatchDigests();
+		return;
+	}
 
 	for( pllist = loglist; pllist; pllist=pllist->next){
 
-		if( pllist->duv_log.size() &&  pllist->ref_log.size()){
+		ddprintf("Device %s -> Unmatched logs:  %d ref and %d duv\n", pllist->name, pllist->unmatched[0], pllist->unmatched[1]);
 
-			pllist->duv_log.sort();
-			pllist->ref_log.sort();
-			ddprintf("BEFORE MATCHING...\n");
-			ddprintf("Device %s -> Log size:  %d ref and %d duv\n", pllist->name, pllist->ref_log.size(), pllist->duv_log.size());
-			
-#ifdef DDEBUG
-			ChangeDump( pllist);
-#endif
-			refitor = pllist->ref_log.begin();
-			while( refitor != pllist->ref_log.end() ){
-				
-				duvitor = pllist->duv_log.begin();
-				flag = false;
-				
-				while( /*(refitor->time == duvitor->time) &&*/ (duvitor != pllist->duv_log.end())){
-					if( refitor->addr == duvitor->addr &&
-							refitor->value == duvitor->value ){
-						
-						refitor = pllist->ref_log.erase( refitor );
-						duvitor = pllist->duv_log.erase( duvitor );
-						flag = true;
-						break;
-					}
-					duvitor++;
-				}
-				//When we had a match, the iterator was incremented by the erase method
-				if(!flag)
-					refitor++;
-			}
-
-			ddprintf("AFTER MATCHING...\n");
-			ddprintf("Device %s -> Log size:  %d ref and %d duv\n", pllist->name, pllist->ref_log.size(), pllist->duv_log.size());
-			//Test if we already had too many erros (unmatched logs)
-			if( pllist->ref_log.size() >= AC_MAX_UNMATCHED || pllist->duv_log.size() >= AC_MAX_UNMATCHED )
-				error = 1;
-		}
+		//Logs are matched as they arrive. Both models having updates the other
+		//one lacks means they disagree, unless one is just behind
+		if( pllist->unmatched[0] && pllist->unmatched[1] &&
+				(pllist->unmatched[0] >= AC_MAX_UNMATCHED || pllist->unmatched[1] >= AC_MAX_UNMATCHED) )
+			error = 1;
 	}
 	if(error){
 		dprintf("Too many erros founded. Aborting ...\n");
@@ -787,6 +897,114 @@ void MatchLogs( ){
 }
 
 
+/////////////////////////////////////////
+// Find the first digest point closed by
+// both models with unmatched digests
+/////////////////////////////////////////
+void MatchDigests( ){
+
+	double done = (digest_done[0] < digest_done[1]) ? digest_done[0] : digest_done[1];
+	std::map<double, unsigned>::iterator itor;
+	log_table::iterator litor;
+
+	while( (itor = digest_unmatched.begin()) != digest_unmatched.end() && itor->first <= done ){
+		if( itor->second ){
+			diverged_at = itor->first;
+			divergence.clear();
+			for( litor = pending.begin(); litor != pending.end(); litor++ )
+				if( litor->second.log.time == diverged_at )
+					divergence.push_back(litor->second);
+			return;
+		}
+		digest_unmatched.erase(itor);
+	}
+}
+
+
+/////////////////////////////////////////
+// Digest mode. After a divergence, models
+// run again with a single digest point in
+// the middle of the window between the last
+// matching point and the first mismatching
+// one, until it holds one instruction.
+/////////////////////////////////////////
+void VerifyDigests( ){
+
+	unsigned long long a, b, mid;
+	char spec[80], at_arg[64];
+	char ref_ckpt_arg[] = "--checkpoint=acverifier.ref.ckpt";
+	char duv_ckpt_arg[] = "--checkpoint=acverifier.duv.ckpt";
+	char ref_restore_arg[] = "--restore=acverifier.ref.ckpt";
+	char duv_restore_arg[] = "--restore=acverifier.duv.ckpt";
+	char *ref_extra[3], *duv_extra[3];
+	bool use_ckpt;
+	unsigned i;
+
+	snprintf(spec, sizeof(spec), "%llu:%llu:0", digest_interval, digest_interval);
+	RunModels(spec, NULL, NULL);
+
+	if( diverged_at < 0 ){
+		AC_MSG("Digests matched at every " << digest_interval << " instructions.");
+		return;
+	}
+
+	b = (unsigned long long) diverged_at;
+	a = (b > digest_interval) ? b - digest_interval : 0;
+	AC_MSG("Digests differ at instruction " << b << ". Searching from instruction " << a << " ...");
+
+	//Later runs start from a checkpoint of both models at the last matching point
+	use_ckpt = ref_ckpt && duv_ckpt && a;
+	if( use_ckpt ){
+		snprintf(at_arg, sizeof(at_arg), "--checkpoint-at=%llu", a);
+		ref_extra[0] = duv_extra[0] = at_arg;
+		ref_extra[1] = ref_ckpt_arg;
+		duv_extra[1] = duv_ckpt_arg;
+		ref_extra[2] = duv_extra[2] = NULL;
+		if( !RunModels("0:0:0", ref_extra, duv_extra) ){
+			AC_MSG("Could not save checkpoints. Running models from the start.");
+			use_ckpt = 0;
+		}
+	}
+
+	ref_extra[0] = ref_restore_arg;
+	duv_extra[0] = duv_restore_arg;
+	ref_extra[1] = duv_extra[1] = NULL;
+
+	while( b - a > 1 ){
+		mid = a + (b - a) / 2;
+		snprintf(spec, sizeof(spec), "%llu:%llu:%llu", mid - a, mid, mid);
+
+		if( !RunModels(spec, use_ckpt ? ref_extra : NULL, use_ckpt ? duv_extra : NULL) && use_ckpt ){
+			AC_MSG("Could not restore checkpoints. Running models from the start.");
+			use_ckpt = 0;
+			continue;
+		}
+
+		if( diverged_at >= 0 )
+			b = mid;
+		else
+			a = mid;
+		dprintf("Divergence between instructions %llu and %llu\n", a, b);
+	}
+
+	unlink("acverifier.ref.ckpt");
+	unlink("acverifier.duv.ckpt");
+
+	AC_ERROR("Co-verification FAILED. First mismatching instruction: " << b);
+	for( i = 0; i < divergence.size(); i++ ){
+		struct dev_loglist *pllist;
+
+		for( pllist = loglist; pllist && pllist->type != divergence[i].type; pllist = pllist->next)
+			;
+		cerr << "   " << ((divergence[i].model == REFERENCE_MODEL) ? "Reference" : "DUV")
+				 << " model only: device " << (pllist ? pllist->name : "?")
+				 << " page 0x" << hex << divergence[i].log.addr
+				 << " digest 0x" << divergence[i].log.value << dec
+				 << " at instruction " << divergence[i].log.time << endl;
+	}
+}
+
+
 ////////////////////////////////////////////////////
 // Final Check to the reference and duv update logs
 ////////////////////////////////////////////////////
@@ -796,7 +1014,7 @@ void FinishIt(){
 
 	for( pllist = loglist; pllist; pllist=pllist->next){
 
-		if( pllist->duv_log.size() ||  pllist->ref_log.size()){
+		if( pllist->unmatched[0] ||  pllist->unmatched[1]){
 	
 			AC_ERROR("Co-verification FAILED. Reference and DUV models have inconsistent update logs for device "<< pllist->name);
 			cerr <<endl;
@@ -811,33 +1029,30 @@ void FinishIt(){
 /////////////////////////////////////////////////////////
 void ChangeDump( struct dev_loglist *pllist ) {
 
-  log_list::iterator itor;
+	std::vector<ac_vlog> logs[2];
+	std::vector<ac_vlog>::iterator itor;
+	log_table::iterator litor;
+	const char *title[2] = { "Reference Model", "DUV Model" };
 	ofstream covfile;
+
+	for( litor = pending.begin(); litor != pending.end(); litor++ )
+		if( litor->second.type == pllist->type )
+			logs[litor->second.model].push_back(litor->second.log);
     
 	covfile.open("coverif.out");
-  if(  pllist->ref_log.size() ){
-		covfile <<endl << endl;
-    covfile << "**************** ArchC Change log *****************\n";
-    covfile << "* Reference Model         Device: "<< pllist->name << endl;
-    covfile << "***************************************************\n";
-    covfile << "*        Address         Value          Time      *\n";
-    covfile << "***************************************************\n";
-      
-    for( itor = pllist->ref_log.begin(); itor != pllist->ref_log.end(); itor++)  
-      covfile << "*  " << *itor << "     *" << endl;
-      
-    covfile << "***************************************************\n";
-  }
+	for( int m = 0; m < 2; m++ ){
+		if( !logs[m].size() )
+			continue;
+		std::sort(logs[m].begin(), logs[m].end());
 
-  if(  pllist->duv_log.size() ){
 		covfile <<endl << endl;
     covfile << "**************** ArchC Change log *****************\n";
-    covfile << "* DUV Model         Device: "<< pllist->name << endl;
+    covfile << "* " << title[m] << "         Device: "<< pllist->name << endl;
     covfile << "***************************************************\n";
     covfile << "*        Address         Value          Time      *\n";
     covfile << "***************************************************\n";
       
-    for( itor = pllist->duv_log.begin(); itor != pllist->duv_log.end(); itor++)  
+    for( itor = logs[m].begin(); itor != logs[m].end(); itor++)  
       covfile << "*  " << *itor << "     *" << endl;
       
     covfile << "***************************************************\n";
@@ -855,8 +1070,8 @@ void CheckOptions( int model ) {
 
 	ifstream input;
   string read;
-	char *filename;
-	char* p;
+	const char *filename;
+	const char* p;
 
 	if(model == REFERENCE_MODEL)
 		filename = "refout.tmp";
@@ -875,6 +1090,12 @@ void CheckOptions( int model ) {
 	p = strstr( read.c_str(), "(");
 	if(p ){
 		
+		if( strstr( p, "-ckpt") || strstr( p, "--checkpoint") ){
+			if(model == REFERENCE_MODEL)
+				ref_ckpt = 1;
+			else
+				duv_ckpt = 1;
+		}
 		if( strstr( p, "-v") ||strstr( p, "-v)") )
 			return;
 	}
@@ -0,0 +1,346 @@
+#!/bin/sh
+# Simulator throughput over a subset of MiBench
+#
+#   bench.sh [-s "small large"] [-g "64k 1M"] [-r seed] [-o bench.json] [-k key]
+#            [-d dir] SIMULATOR MIBENCH_DIR
+#
+# Each program is run from its own directory with the inputs of its
+# runme scripts. For every run, the host wall time, the startup time
+# (until the simulation starts), the simulated instructions, their rate
+# and the peak resident memory are written as JSON, with whether the
+# outputs matched the output_* files shipped with MiBench. The outputs
+# are written to a temporary directory, never over the shipped ones.
+#
+# With -g, the programs whose work grows with their input run instead
+# on inputs of each size of the list (k, M and G scales), written by
+# mips_inputs, next to this script, from the seed of -r (default 1).
+# Their outputs are checked against those of the same programs built
+# for the host with $HOSTCC (cc) from the MiBench sources. The JSON also
+# holds the bytes of the inputs of each run, and the rate and memory of
+# each program by input size go, one block a program, in a table next
+# to it (bench.tsv for bench.json) that bench_scale.gp plots.
+#
+# With -d, the --stats-out CSV file of each run is kept in dir, as
+# <input>.<name>.csv.
+
+SETS="small large"
+SIZES=
+SEED=1
+STATS=
+OUT=bench.json
+KEY=1234567890abcdeffedcba09876543211234567890abcdeffedcba0987654321
+USAGE="usage: $0 [-s sets] [-g sizes] [-r seed] [-o file] [-k key] [-d dir] simulator mibench-dir"
+
+while getopts "s:g:r:o:k:d:" opt; do
+  case $opt in
+    s) SETS=$OPTARG ;;
+    g) SIZES=$OPTARG ;;
+    r) SEED=$OPTARG ;;
+    o) OUT=$OPTARG ;;
+    k) KEY=$OPTARG ;;
+    d) STATS=$OPTARG ;;
+    *) echo "$USAGE" >&2; exit 2 ;;
+  esac
+done
+shift `expr $OPTIND - 1`
+
+if [ $# -ne 2 ]; then
+  echo "$USAGE" >&2
+  exit 2
+fi
+
+SIM=`cd \`dirname $1\` && pwd`/`basename $1`
+MIBENCH=`cd $2 && pwd` || exit 1
+INPUTS=`cd \`dirname $0\` && pwd`/mips_inputs
+HOSTCC=${HOSTCC:-cc}
+case $OUT in
+  /*) ;;
+  *) OUT=`pwd`/$OUT ;;
+esac
+TABLE=${OUT%.json}.tsv
+if [ -n "$STATS" ]; then
+  mkdir -p $STATS && STATS=`cd $STATS && pwd` || exit 1
+fi
+
+TMP=`mktemp -d ${TMPDIR:-/tmp}/bench.XXXXXX` || exit 1
+trap 'rm -rf $TMP' 0 1 2 15
+RUN=$TMP/run
+NATIVE=$TMP/native
+mkdir $RUN
+
+# The runs of a set, one per line:
+#   name|directory|program and arguments|standard input|standard output
+# An output argument is written as @file. Both it and the standard
+# output are checked against the file of that name in the directory.
+runs() {
+  s=$1
+  case $s in
+    small) bits=75000; fft=4; fftn=4096; ffti=8192 ;;
+    large) bits=1125000; fft=8; fftn=32768; ffti=32768 ;;
+  esac
+  cat <<EOF
+qsort|automotive/qsort|qsort_$s input_$s.dat||output_$s.txt
+bitcount|automotive/bitcount|bitcnts $bits||output_$s.txt
+dijkstra|network/dijkstra|dijkstra_$s input.dat||output_$s.dat
+sha|security/sha|sha input_$s.asc||output_$s.txt
+CRC32|telecomm/CRC32|crc ../adpcm/data/large.pcm||output_$s.txt
+FFT|telecomm/FFT|fft $fft $fftn||output_$s.txt
+FFT.inverse|telecomm/FFT|fft $fft $ffti -i||output_$s.inv.txt
+susan.smoothing|automotive/susan|susan input_$s.pgm @output_$s.smoothing.pgm -s||
+susan.edges|automotive/susan|susan input_$s.pgm @output_$s.edges.pgm -e||
+susan.corners|automotive/susan|susan input_$s.pgm @output_$s.corners.pgm -c||
+rijndael.encode|security/rijndael|rijndael input_$s.asc @output_$s.enc e $KEY||
+rijndael.decode|security/rijndael|rijndael output_$s.enc @output_$s.dec d $KEY||
+adpcm.encode|telecomm/adpcm|bin/rawcaudio|data/$s.pcm|output_$s.adpcm
+adpcm.decode|telecomm/adpcm|bin/rawdaudio|data/$s.adpcm|output_$s.pcm
+gsm.encode|telecomm/gsm|bin/toast -fps -c data/$s.au||output_$s.encode.gsm
+gsm.decode|telecomm/gsm|bin/untoast -fps -c data/$s.au.run.gsm||output_$s.decode.run
+EOF
+}
+
+# The runs of the inputs in $GEN, as those of runs(). Their outputs are
+# checked against the files of $GEN/ref/<name>. dijkstra and bitcount
+# are left out: the one reads a fixed matrix, the other no input. The
+# rijndael decoder takes what the host encoded, as the encoder writes
+# its IV in the order of the host.
+scale_runs() {
+  cat <<EOF
+qsort.small|automotive/qsort|qsort_small $GEN/words.txt||output.txt
+qsort.large|automotive/qsort|qsort_large $GEN/vertices.txt||output.txt
+patricia|network/patricia|patricia $GEN/trace.udp||output.txt
+sha|security/sha|sha $GEN/text.asc||output.txt
+CRC32|telecomm/CRC32|crc $GEN/samples.pcm||output.txt
+susan.smoothing|automotive/susan|susan $GEN/image.pgm @output.smoothing.pgm -s||
+susan.edges|automotive/susan|susan $GEN/image.pgm @output.edges.pgm -e||
+susan.corners|automotive/susan|susan $GEN/image.pgm @output.corners.pgm -c||
+rijndael.decode|security/rijndael|rijndael $GEN/text.enc @output.dec d $KEY||
+adpcm.encode|telecomm/adpcm|bin/rawcaudio|$GEN/samples.pcm|output.adpcm
+EOF
+}
+
+# Builds the programs of scale_runs() for the host, into $NATIVE. The
+# guest is ILP32 and big-endian: sha, CRC32 and rijndael are built from
+# copies where long is int, and sha swaps its words on a little-endian
+# host. rawcaudio reads its samples in the order of the host.
+native_build() {
+  mkdir -p $NATIVE/src
+  cd $MIBENCH || exit 1
+  for f in security/sha/*.[ch] telecomm/CRC32/*.[ch] security/rijndael/*.[ch]; do
+    sed -e 's/\<long\>/int/g' -e 's/%\([0-9]*\)l\([dxXu]\)/%\1\2/g' -e 's/\<fpos_t\>/int/g' \
+        -e 's/fgetpos(\([a-z]*\), *&\([a-z]*\))/(\2 = ftell(\1))/' $f > $NATIVE/src/`basename $f`
+  done
+  endian=
+  [ "`printf '\001\000' | od -An -tu2 | tr -d ' '`" = 1 ] && endian=-DLITTLE_ENDIAN
+  $HOSTCC -O2 -w -o $NATIVE/qsort_small automotive/qsort/qsort_small.c -lm &&
+  $HOSTCC -O2 -w -o $NATIVE/qsort_large automotive/qsort/qsort_large.c -lm &&
+  $HOSTCC -O2 -w -o $NATIVE/patricia network/patricia/patricia.c network/patricia/patricia_test.c &&
+  $HOSTCC -O2 -w -o $NATIVE/susan automotive/susan/susan.c -lm &&
+  $HOSTCC -O2 -w -o $NATIVE/rawcaudio telecomm/adpcm/src/rawcaudio.c telecomm/adpcm/src/adpcm.c &&
+  $HOSTCC -O2 -w $endian -o $NATIVE/sha $NATIVE/src/sha.c $NATIVE/src/sha_driver.c &&
+  $HOSTCC -O2 -w -o $NATIVE/crc $NATIVE/src/crc_32.c &&
+  $HOSTCC -O2 -w -o $NATIVE/rijndael $NATIVE/src/aes.c $NATIVE/src/aesxam.c
+}
+
+# Writes the inputs of size $1 into $GEN, the samples in the order of
+# the host too.
+generate() {
+  GEN=$TMP/inputs.$1
+  mkdir -p $GEN/ref
+  $INPUTS -s $SEED qsort.small $1 > $GEN/words.txt &&
+  $INPUTS -s $SEED qsort.large $1 > $GEN/vertices.txt &&
+  $INPUTS -s $SEED patricia $1 > $GEN/trace.udp &&
+  $INPUTS -s $SEED text $1 > $GEN/text.asc &&
+  $INPUTS -s $SEED pcm $1 > $GEN/samples.pcm &&
+  $INPUTS -s $SEED -l pcm $1 > $GEN/samples.host.pcm &&
+  $INPUTS -s $SEED pgm $1 > $GEN/image.pgm &&
+  $NATIVE/rijndael $GEN/text.asc $GEN/text.enc e $KEY > /dev/null
+}
+
+# Splits the program and arguments $1 of a run into prog and args, the
+# outputs named with @ going into directory $2, and lists them in outs.
+expand() {
+  dest=$2
+  set -- $1
+  prog=$1
+  shift
+  args=
+  outs=
+  for a in "$@"; do
+    case $a in
+      @*) args="$args $dest/${a#@}"; outs="$outs ${a#@}" ;;
+      *) args="$args $a" ;;
+    esac
+  done
+}
+
+# Runs the native programs of $TMP/runs, from the same directories and
+# with the same arguments as the simulated ones, into $GEN/ref/<name>,
+# with their exit status (patricia always exits with 1).
+references() {
+  while IFS='|' read name dir cmd in ref; do
+    mkdir -p $GEN/ref/$name
+    cd $MIBENCH/$dir || exit 1
+    expand "$cmd" $GEN/ref/$name
+    case $in in
+      *.pcm) in=${in%.pcm}.host.pcm ;;
+      '') in=/dev/null ;;
+    esac
+    if [ -n "$ref" ]; then
+      $NATIVE/`basename $prog` $args < $in > $GEN/ref/$name/$ref 2> /dev/null
+    else
+      $NATIVE/`basename $prog` $args < $in > /dev/null 2>&1
+    fi
+    echo $? > $GEN/ref/$name/.status
+  done < $TMP/runs
+}
+
+now() {
+  date +%s%N
+}
+
+# Compares an output with the shipped one. bitcount reports the host
+# time of each counter, which is left out.
+same() {
+  case $1 in
+    bitcount)
+      sed 's/Time: *[0-9.]* sec\.;//' $2 > $TMP/a
+      sed 's/Time: *[0-9.]* sec\.;//' $3 > $TMP/b
+      cmp -s $TMP/a $TMP/b ;;
+    *)
+      cmp -s $2 $3 ;;
+  esac
+}
+
+# Runs the simulator in the background and waits for it, sampling its
+# peak resident set size, in kB, into RSS.
+simulate() {
+  "$@" &
+  pid=$!
+  RSS=0
+  while kill -0 $pid 2>/dev/null; do
+    hwm=`sed -n 's/^VmHWM: *\([0-9]*\) kB/\1/p' /proc/$pid/status 2>/dev/null`
+    [ -n "$hwm" ] && [ $hwm -gt $RSS ] && RSS=$hwm
+    sleep 0.05 2>/dev/null || sleep 1
+  done
+  wait $pid
+}
+
+# Value of a statistic of the ArchC section in a --stats-out CSV file
+archc_stat() {
+  sed -n "s/^\"archc\",\"$2\",//p" $1
+}
+
+# Simulates the runs of $TMP/runs, labelled input $1, checking their
+# outputs against those in $REF, or in $REF/<name> for the generated
+# inputs, whose bytes are then written too, and the exit status against
+# 0 or that of the native run.
+simulate_runs() {
+  while IFS='|' read name dir cmd in ref; do
+    cd $MIBENCH/$dir || exit 1
+    rm -f $RUN/*
+    expand "$cmd" $RUN
+    [ -n "$ref" ] && outs="$outs $ref"
+
+    start=`now`
+    if [ -n "$in" ]; then
+      simulate $SIM --stats-out=$RUN/stats.csv --load=./$prog $args < $in > $RUN/stdout 2> $RUN/stderr
+    else
+      simulate $SIM --stats-out=$RUN/stats.csv --load=./$prog $args < /dev/null > $RUN/stdout 2> $RUN/stderr
+    fi
+    status=$?
+    end=`now`
+    [ -n "$ref" ] && mv $RUN/stdout $RUN/$ref
+
+    bytes=
+    refs=$REF
+    expected=0
+    if [ -n "$GEN" ]; then
+      refs=$REF/$name
+      expected=`cat $refs/.status`
+      bytes=0
+      for a in $args $in; do
+        case $a in
+          $GEN/*) bytes=`expr $bytes + \`wc -c < $a\`` ;;
+        esac
+      done
+    fi
+
+    match=true
+    for o in $outs; do
+      same $name $refs/$o $RUN/$o || match=false
+    done
+    [ $status -eq $expected ] || match=false
+
+    insns=`archc_stat $RUN/stats.csv instructions`
+    sim=`archc_stat $RUN/stats.csv real_seconds`
+    [ -n "$STATS" ] && cp $RUN/stats.csv $STATS/$1.$name.csv 2> /dev/null
+    echo "$1 $name: $match" >&2
+
+    [ $FIRST -eq 1 ] || printf ',' >> $OUT
+    FIRST=0
+    awk -v name="$name" -v set="$1" -v bytes="$bytes" -v table=$TMP/table -v start=$start -v end=$end \
+        -v insns="${insns:-0}" -v sim="${sim:-0}" -v rss=$RSS -v status=$status -v ok=$match '
+      BEGIN {
+        wall = (end - start) / 1e9
+        startup = wall - sim
+        if (startup < 0)
+          startup = 0
+        ips = (sim > 0) ? insns / sim : 0
+        printf "\n    { \"name\": \"%s\", \"input\": \"%s\", ", name, set
+        if (bytes != "")
+          printf "\"input_bytes\": %d, ", bytes
+        printf "\"wall_seconds\": %.6f, \"startup_seconds\": %.6f,\n", wall, startup
+        printf "      \"simulation_seconds\": %.6f, \"instructions\": %d, \"instructions_per_second\": %.0f,\n", sim, insns, ips
+        printf "      \"peak_rss_kb\": %d, \"exit_status\": %d, \"outputs_match\": %s }", rss, status, ok
+        if (bytes != "")
+          printf "%s\t%d\t%d\t%.0f\t%d\n", name, bytes, insns, ips, rss >> table
+      }' >> $OUT
+  done < $TMP/runs
+}
+
+FIRST=1
+FAILED=0
+
+printf '{\n  "simulator": "%s",\n  "runs": [' "$SIM" > $OUT
+
+if [ -z "$SIZES" ]; then
+  REF=.
+  GEN=
+  for set in $SETS; do
+    runs $set > $TMP/runs
+    simulate_runs $set
+  done
+else
+  if ! native_build; then
+    echo "Could not build the MiBench programs for the host with $HOSTCC." >&2
+    exit 1
+  fi
+  : > $TMP/table
+  for size in $SIZES; do
+    if ! generate $size; then
+      echo "Could not write the inputs of $size with $INPUTS." >&2
+      exit 1
+    fi
+    REF=$GEN/ref
+    scale_runs > $TMP/runs
+    references
+    simulate_runs $size
+    rm -rf $GEN
+  done
+  # A block a program, by input size, for the index of gnuplot
+  sort -s -k1,1 $TMP/table | awk -F '\t' '
+    $1 != last {
+      if (last != "")
+        printf "\n\n"
+      print "name\tinput_bytes\tinstructions\tinstructions_per_second\tpeak_rss_kb"
+      last = $1
+    }
+    { print }' > $TABLE
+  echo "Table written to $TABLE" >&2
+fi
+
+printf '\n  ]\n}\n' >> $OUT
+
+grep -q '"outputs_match": false' $OUT && FAILED=1
+echo "Results written to $OUT" >&2
+exit $FAILED
@@ -0,0 +1,33 @@
+# Throughput and memory of the simulator by input size, from the table
+# of "make bench-scale":
+#
+#   gnuplot -e "data='bench_scale.tsv'" bench_scale.gp
+#
+# Each block of the table is a program. A flat rate means the simulator
+# keeps its speed as the guest's data grows; a drop marks where its
+# tables (decode cache, storage, caches of the analysis) stop fitting.
+
+if (!exists("data")) data = 'bench_scale.tsv'
+if (!exists("out")) out = 'bench_scale.png'
+
+stats data using 2 nooutput
+blocks = STATS_blocks
+
+set terminal pngcairo size 1200,500
+set output out
+set multiplot layout 1,2
+set logscale x 2
+set format x '%.0b%B'
+set xlabel 'input bytes'
+set key outside bottom center horizontal
+set grid
+
+set ylabel 'instructions per second'
+set format y '%.1s%c'
+plot for [i=0:blocks-1] data index i using 2:4 with linespoints title columnhead(1)
+
+set ylabel 'peak resident memory (kB)'
+set format y '%.0f'
+plot for [i=0:blocks-1] data index i using 2:5 with linespoints title columnhead(1)
+
+unset multiplot
@@ -49,6 +49,9 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "d4.h"
 #include "cmdd4.h"
 #include "tracein.h"
@@ -63,48 +66,93 @@
  */
 
 #define RECORD_SIZE 8
+#define CHUNK	4096	/* records decoded at a time */
 
 #if CHAR_BIT != 8
 #error "binary format code assumes 8 bit chars"
 #endif
 
+/* Decode n records at p into r */
+static void
+decode (const unsigned char *p, d4memref *r, int n)
+{
+	for (;  n > 0;  n--, p += RECORD_SIZE, r++) {
+		r->address = (p[0]<<(0*CHAR_BIT)) |
+			     (p[1]<<(1*CHAR_BIT)) |
+			     (p[2]<<(2*CHAR_BIT)) |
+			     ((d4addr)p[3]<<(3*CHAR_BIT));
+		r->size = (p[4]<<(0*CHAR_BIT)) |
+			  (p[5]<<(1*CHAR_BIT));
+		r->accesstype = p[6];
+		/* p[7] is padding */
+	}
+}
+
+
+/*
+ * Records are decoded a chunk at a time.
+ * If standard input is a regular file, it is mapped into memory
+ * and decoded in place, otherwise it is read in big blocks.
+ */
 d4memref
 tracein_binary()
 {
-	static unsigned char inbuf[RECORD_SIZE*1024];
+	static d4memref chunk[CHUNK];
+	static int nchunk = 0;
+	static int next = 0;
+	static int once = 1;
+	static const unsigned char *map = NULL;	/* all of standard input, if mapped */
+	static size_t mapsize, mapptr;
+	static unsigned char inbuf[RECORD_SIZE*CHUNK];
 	static int hiwater = 0;
-	static int inptr = 0;
 	d4memref r;
 
-	if (inptr > hiwater - RECORD_SIZE) {	/* need to fill inbuf */
-		int nread;
-		if (hiwater > inptr) {
-			memcpy (inbuf, &inbuf[inptr], hiwater-inptr);
-			inptr = hiwater - inptr;
-		}
-		else
-			inptr = 0;
-		nread = read (0, &inbuf[inptr], sizeof(inbuf) - inptr);
-		if (nread < 0)
-			die ("binary input error: %s\n", strerror (errno));
-		if (nread <= 0) {
-			r.accesstype = D4TRACE_END;
-			r.address = 0;
-			r.size = 0;
-			return r;
+	if (next < nchunk)
+		return chunk[next++];
+	if (once) {
+		struct stat st;
+		once = 0;
+		if (fstat (0, &st) == 0 && S_ISREG (st.st_mode) && st.st_size > 0 &&
+		    (off_t)(size_t)st.st_size == st.st_size) {
+			void *p = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, 0, 0);
+			if (p != MAP_FAILED) {
+				off_t pos = lseek (0, 0, SEEK_CUR);	/* start where stdin is */
+				map = p;
+				mapsize = st.st_size;
+				mapptr = pos <= 0 ? 0 : pos < st.st_size ? pos : st.st_size;
+#ifdef MADV_SEQUENTIAL
+				madvise (p, mapsize, MADV_SEQUENTIAL);
+#endif
+			}
 		}
-		hiwater = inptr + nread;
-		inptr = 0;
 	}
-	r.address = (inbuf[inptr+0]<<(0*CHAR_BIT)) |
-		    (inbuf[inptr+1]<<(1*CHAR_BIT)) |
-		    (inbuf[inptr+2]<<(2*CHAR_BIT)) |
-		    (inbuf[inptr+3]<<(3*CHAR_BIT));
-	inptr += 4;
-	r.size = (inbuf[inptr+0]<<(0*CHAR_BIT)) |
-		 (inbuf[inptr+1]<<(1*CHAR_BIT));
-	inptr += 2;
-	r.accesstype = inbuf[inptr++];
-	inptr++;	/* skip padding */
-	return r;
+	if (map != NULL) {
+		size_t n = (mapsize - mapptr) / RECORD_SIZE;
+		if (n > CHUNK)
+			n = CHUNK;
+		decode (map + mapptr, chunk, n);
+		mapptr += n * RECORD_SIZE;
+		nchunk = n;
+	}
+	else {
+		int nread, left = hiwater % RECORD_SIZE;
+		memmove (inbuf, &inbuf[hiwater - left], left);	/* a partial record */
+		hiwater = left;
+		do {
+			nread = read (0, &inbuf[hiwater], sizeof(inbuf) - hiwater);
+			if (nread < 0)
+				die ("binary input error: %s\n", strerror (errno));
+			hiwater += nread;
+		} while (nread > 0 && hiwater < RECORD_SIZE);
+		nchunk = hiwater / RECORD_SIZE;
+		decode (inbuf, chunk, nchunk);
+	}
+	next = 0;
+	if (nchunk == 0) {
+		r.accesstype = D4TRACE_END;
+		r.address = 0;
+		r.size = 0;
+		return r;
+	}
+	return chunk[next++];
 }
@@ -165,6 +165,16 @@ struct arglist args[] = {
 	  match_1arg, val_string, custom_custom,
 	  NULL, help_string },
 #endif
+	{ "-parallel", 2, &parallelname, NULL,
+	  NULL,
+	  "Simulate each line of options in F in parallel",
+	  match_1arg, val_string, NULL,
+	  NULL, help_string },
+	{ "-jobs", 2, &paralleljobs, "one per processor",
+	  NULL,
+	  "Configurations of -parallel run at once",
+	  match_1arg, val_uint, NULL,
+	  NULL, help_uint },
 	{ "size", 7, &level_size[0][0], NULL,
 	  "level_size",
 	  "Size",
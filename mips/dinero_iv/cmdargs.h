@@ -85,6 +85,8 @@ extern int maxlevel;		/* largest cache level specified */
 extern int optstringmax;	/* longest option string */
 
 extern char *customname;	/* for -custom, name of executable */
+extern char *parallelname;	/* for -parallel, file of configurations */
+extern unsigned int paralleljobs; /* for -jobs */
 extern double skipcount;	/* for -skipcount */
 extern double flushcount;	/* for -flushcount */
 extern double maxcount;		/* for -maxcount */
@@ -60,7 +60,9 @@
 #include <math.h>
 #include <ctype.h>
 #include <string.h>
+#include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include "d4.h"
 #include "cmdd4.h"
 #include "cmdargs.h"
@@ -77,6 +79,8 @@ const char **cust_argv;			/* for args to pass to custom version */
 int cust_argc = 1;			/* how many args for custom version */
 char *customname;			/* for -custom, name of executable */
 #endif
+char *parallelname;			/* for -parallel, file of configurations */
+unsigned int paralleljobs;		/* for -jobs */
 
 /* private prototypes for this file */
 extern int do1arg (const char *, const char *);
@@ -87,6 +91,7 @@ extern void do1stats (d4cache *);
 extern d4memref next_trace_item (void);
 #if !D4CUSTOM
 extern void customize_caches (void);
+extern void parallel_main (int *, char ***);
 #endif
 
 
@@ -1924,6 +1929,133 @@ clog2 (unsigned int x)
 }
 
 
+/*
+ * With -parallel F, each line of F holds more options for a separate
+ * configuration, simulated by a child process over the same trace.
+ * The trace must be a binary (-informat b) file on standard input,
+ * which each child maps into memory, so the file is read only once.
+ * At most -jobs N children (default: one per processor) run at once;
+ * their outputs are printed in order when all are done.
+ * This only returns if there is no -parallel, or in a child, with
+ * the options of its configuration added to *argcp and *argvp.
+ */
+void
+parallel_main (int *argcp, char ***argvp)
+{
+	int argc = *argcp, base = 0, nconfig = 0, running = 0, failed = 0;
+	char **argv = *argvp, **v;
+	char line[4096];
+	char **lines = NULL;
+	FILE **outs = NULL;
+	pid_t *pids = NULL;
+	int *status = NULL;
+	struct stat st;
+	FILE *f;
+	int i, c;
+
+	v = malloc ((argc+1) * sizeof(argv[0]));
+	if (v == NULL)
+		die ("no memory for -parallel\n");
+	for (i = 0;  i < argc;  i++) {
+		if (strcmp (argv[i], "-parallel") == 0 && i+1 < argc)
+			parallelname = argv[++i];
+		else if (strcmp (argv[i], "-jobs") == 0 && i+1 < argc)
+			paralleljobs = strtoul (argv[++i], NULL, 10);
+		else
+			v[base++] = argv[i];
+	}
+	if (parallelname == NULL) {
+		free (v);
+		return;
+	}
+	if (fstat (0, &st) != 0 || !S_ISREG (st.st_mode))
+		die ("-parallel needs a trace file on standard input\n");
+	if (paralleljobs == 0) {
+		long n = sysconf (_SC_NPROCESSORS_ONLN);
+		paralleljobs = n > 0 ? n : 1;
+	}
+	f = fopen (parallelname, "r");
+	if (f == NULL)
+		die ("can't open %s: %s\n", parallelname, strerror (errno));
+	while (fgets (line, sizeof(line), f) != NULL) {
+		char *p = line + strspn (line, " \t\n");
+		if (*p == 0 || *p == '#')
+			continue;
+		line[strcspn (line, "\n")] = 0;
+		lines = realloc (lines, (nconfig+1) * sizeof(lines[0]));
+		if (lines == NULL || (lines[nconfig] = strdup (p)) == NULL)
+			die ("no memory for -parallel\n");
+		nconfig++;
+	}
+	fclose (f);
+	outs = calloc (nconfig+1, sizeof(outs[0]));
+	pids = calloc (nconfig+1, sizeof(pids[0]));
+	status = calloc (nconfig+1, sizeof(status[0]));
+	if (outs == NULL || pids == NULL || status == NULL)
+		die ("no memory for -parallel\n");
+
+	fflush (stdout);
+	for (i = 0;  i < nconfig;  i++) {
+		if (running == (int)paralleljobs) {
+			int s;
+			pid_t pid = wait (&s);
+			for (c = 0;  c < i;  c++)
+				if (pids[c] == pid)
+					status[c] = s;
+			running--;
+		}
+		outs[i] = tmpfile();
+		if (outs[i] == NULL)
+			die ("can't create output of -parallel: %s\n", strerror (errno));
+		pids[i] = fork();
+		if (pids[i] < 0)
+			die ("can't fork for -parallel: %s\n", strerror (errno));
+		if (pids[i] == 0) {
+			char *p;
+			int n = base;
+			dup2 (fileno (outs[i]), 1);
+			for (p = lines[i];  *p != 0;  p++)
+				n += !isspace ((unsigned char)p[0]) &&
+				     (p == lines[i] || isspace ((unsigned char)p[-1]));
+			v = realloc (v, (n+1) * sizeof(v[0]));
+			if (v == NULL)
+				die ("no memory for -parallel\n");
+			for (n = base, p = strtok (lines[i], " \t");  p != NULL;  p = strtok (NULL, " \t"))
+				v[n++] = p;
+			v[n] = NULL;
+			*argcp = n;
+			*argvp = v;
+			return;
+		}
+		running++;
+	}
+	while (running > 0) {
+		int s;
+		pid_t pid = wait (&s);
+		if (pid < 0)
+			break;
+		for (c = 0;  c < nconfig;  c++)
+			if (pids[c] == pid)
+				status[c] = s;
+		running--;
+	}
+
+	for (i = 0;  i < nconfig;  i++) {
+		printf ("---Configuration %d: %s\n", i, lines[i]);
+		fflush (stdout);
+		rewind (outs[i]);
+		while ((c = getc (outs[i])) != EOF)
+			putchar (c);
+		if (!WIFEXITED (status[i]) || WEXITSTATUS (status[i]) != 0) {
+			printf ("---Configuration %d failed.\n", i);
+			failed = 1;
+		}
+		fclose (outs[i]);
+	}
+	exit (failed);
+}
+
+
 /*
  * Everything starts here
  */
@@ -1946,8 +2078,11 @@ main (int argc, char **argv)
 		}
 	}
 
+	parallel_main (&argc, &argv);	/* returns in each child of -parallel */
 	doargs (argc, argv);
 	verify_options();
+	if (parallelname != NULL && informat != 'b')
+		die ("-parallel needs -informat b\n");
 	initialize_caches (&ci, &cd);
 #if !D4CUSTOM
 	if (customname != NULL) {
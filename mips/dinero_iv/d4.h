@@ -156,21 +156,34 @@ typedef struct d4_stackhead_struct {
 
 	/*
 	 * Long stacks are indexed with a hash table
-	 * One hash table takes care of everything.
+	 * One hash table takes care of all caches of a context.
 	 * The hash key is based on the block address, stack number,
 	 * and cacheid.  Collisions are resolved by chaining.
+	 * The size is a power of 2: instead of taking a remainder, the
+	 * key is scrambled by a multiplication (Fibonacci hashing) and
+	 * bits of the upper half of the product are masked.
 	 */
 struct d4_stackhash_struct {
 	int size;		/* size of the hash table */
+	int nodes;		/* nodes of the hashed stacks, for automatic sizing */
 	d4stacknode **table;	/* the table itself, malloced */
 };
 
+#ifndef D4HASH_THRESH
 #define D4HASH_THRESH	8	/* stacks bigger than this size are hashed */
-#define D4HASH(ba,sn,cid)	(((unsigned long)(ba)+(sn)+(cid)) %				\
-				 ((D4_HASHSIZE>0) ? D4_HASHSIZE : d4stackhash.size))
+#endif
+#define D4HASH(ba,sn,cid,size)	((int)(((((unsigned long long)(ba)+(sn)+(cid)) *		\
+					 0x9e3779b97f4a7c15ULL) >> 32) &			\
+				       (((D4_HASHSIZE>0) ? D4_HASHSIZE : (size)) - 1)))
 #ifndef D4_HASHSIZE
 #define D4_HASHSIZE 0	/* default is automatic */
 #endif
+#if D4_HASHSIZE<0 || (D4_HASHSIZE&(D4_HASHSIZE-1)) != 0
+#error "D4_HASHSIZE must be 0 or a power of 2"
+#endif
+#ifndef D4_HASHFACTOR
+#define D4_HASHFACTOR 1	/* automatic size is at least this many buckets per node */
+#endif
 
 
 
@@ -204,6 +217,7 @@ typedef struct d4_cache_struct {
 	d4stackhead *stack;	/* the priority stacks for this cache */
 	d4pendstack *pending;	/* stack for prefetch etc. */
 	struct d4_cache_struct *link; /* linked list of all caches */
+	struct d4_context_struct *context; /* which context is this a part of */
 
 	/*
 	 * Cache parameters
@@ -291,6 +305,26 @@ typedef struct d4_cache_struct {
 
 
 
+	/*
+	 * Everything shared by a set of caches.
+	 * Caches of different contexts have nothing in common, so each
+	 * context may be used by its own thread.  Caches connected to
+	 * each other must be in the same context.
+	 * d4new and d4setup use a default context; customized programs
+	 * (D4CUSTOM) support only that one.
+	 */
+typedef struct d4_context_struct {
+	d4cache *allcaches;	/* linked list of its caches, newest first */
+	d4cache *setupcaches;	/* allcaches at the last d4setupin */
+	int nextcacheid;
+	struct d4_stackhash_struct stackhash; /* hash table for its caches */
+	d4pendstack *pendfree;	/* free list for pending mrefs */
+	int nnodes;		/* total number of stack nodes allocated */
+} d4context;
+
+
+
+
 	/*
 	 * This macro provides access to certain fields of the
 	 * d4cache structure in a way that allows the references to be
@@ -383,9 +417,18 @@ typedef struct d4_cache_struct {
  */
 
 extern const int d4custom; /* how to tell if this program was customized */
-extern struct d4_stackhash_struct d4stackhash; /* hash table for all caches */
+extern d4context d4_defaultcontext; /* of d4new and d4setup */
 extern d4stacknode d4freelist; /* free list for stack nodes of all caches */
-extern int d4nnodes;	/* total number of stack nodes allocated */
+/*
+ * Allocator of the stack heads, stack nodes and stack hash tables of
+ * d4setupin, which can be set before it to place them; the tables are
+ * zeroed, and given back with the count and size they were allocated with.
+ * They are calloc and free unless the program sets them.
+ */
+extern void *(*d4tablealloc) (size_t, size_t);
+extern void (*d4tablefree) (void *, size_t, size_t);
+#define d4stackhash	(d4_defaultcontext.stackhash)
+#define d4nnodes	(d4_defaultcontext.nnodes)
 
 
 
@@ -398,6 +441,9 @@ extern int d4nnodes;	/* total number of stack nodes allocated */
 /* top level user-callable functions */
 extern d4cache	*d4new (d4cache *);
 extern int	d4setup (void);
+extern d4context *d4newcontext (void);
+extern d4cache	*d4newin (d4context *, d4cache *);
+extern int	d4setupin (d4context *);
 #if D4CUSTOM && !defined(d4ref)
 #define		d4ref(c,m) (*(c)->ref)(c,m) /* call customized version */
 #else
@@ -454,8 +500,8 @@ extern void d4init_wback_nofetch (d4cache *);
 
 
 /* Miscellaneous functions users may or may not need */
-extern d4pendstack *d4get_mref(void);	/* allocate struct for pending mref */
-extern void d4put_mref (d4pendstack *);	/* deallocate pending mref */
+extern d4pendstack *d4get_mref(d4cache *);	/* allocate struct for pending mref */
+extern void d4put_mref (d4cache *, d4pendstack *);	/* deallocate pending mref */
 extern void d4init_prefetch_generic (d4cache *); /* helper routine for prefetch */
 
 extern d4stacknode *d4findnth (d4cache *, int stacknum, int n);
@@ -54,11 +54,21 @@
 /*
  * Global variable definitions
  */
-struct d4_stackhash_struct d4stackhash;
+d4context d4_defaultcontext = { NULL, NULL, 1 };
 d4stacknode d4freelist;
-int d4nnodes;
-d4pendstack *d4pendfree;
-d4cache *d4_allcaches;
+
+static void
+d4freetable (void *p, size_t n, size_t size)
+{
+	free (p);
+}
+void *(*d4tablealloc) (size_t, size_t) = calloc;
+void (*d4tablefree) (void *, size_t, size_t) = d4freetable;
+
+/* Stack heads and stack nodes of a cache, once numsets is known */
+#define D4STACKHEADS(c)	((c)->numsets+(((c)->flags&D4F_CCC)!=0))
+#define D4STACKNODES(c)	((c)->numsets * (1 + (c)->assoc) + \
+			 ((c)->numsets * (c)->assoc + 1) * (((c)->flags&D4F_CCC)!=0))
 
 
 /*
@@ -68,34 +78,66 @@ extern void d4_invblock (d4cache *, int stacknum, d4stacknode *);
 extern void d4_invinfcache (d4cache *, const d4memref *);
 
 
+/*
+ * Create a new context, for caches sharing nothing with those of
+ * any other context.  d4newin and d4setupin take it.
+ */
+d4context *
+d4newcontext()
+{
+	d4context *x = calloc (1, sizeof(d4context));
+
+	if (x != NULL)
+		x->nextcacheid = 1;
+	return x;
+}
+
+
 /*
  * Create a new cache
  * The new cache sits "above" the indicated larger cache in the
  * memory hierarchy, with memory at the bottom and processors at the top.
+ * It goes in the context of the larger cache, or the default one.
  */
 d4cache *
 d4new (d4cache *larger)
 {
-	static int nextcacheid = 1;
-	d4cache *c = calloc (1, sizeof(d4cache));
+	return d4newin (larger != NULL ? larger->context : NULL, larger);
+}
+
+
+/*
+ * Create a new cache in context x (NULL for the default one),
+ * which must be that of the larger cache.
+ */
+d4cache *
+d4newin (d4context *x, d4cache *larger)
+{
+	d4cache *c;
 
+	if (x == NULL)
+		x = &d4_defaultcontext;
+	if (larger != NULL && larger->context != x)
+		return NULL;
+	c = calloc (1, sizeof(d4cache));
 	if (c == NULL)
 		return NULL;
-	c->cacheid = nextcacheid++;
+	c->cacheid = x->nextcacheid++;
+	c->context = x;
 	c->downstream = larger;
 	c->ref = d4ref;	/* may get altered for custom version */
 	if (larger == NULL) {	/* simulated memory */
 		c->flags = D4F_MEM;
 		c->assoc = 1;	/* not used, but helps avoid compiler warnings */
 	}
-	c->link = d4_allcaches;
-	d4_allcaches = c;	/* d4customize depends on this LIFO order */
+	c->link = x->allcaches;
+	x->allcaches = c;	/* d4customize depends on this LIFO order */
 	return c;
 }
 
 
 /*
- * Check all caches, set up internal data structures.
+ * Check all caches of the default context, set up internal data structures.
  * Must be called exactly once, after all calls to d4new
  * and all necessary direct initialization of d4cache structures.
  * The call to d4setup must occur before any calls to d4ref.
@@ -104,12 +146,30 @@ d4new (d4cache *larger)
 int
 d4setup()
 {
-	int i, nnodes;
+	return d4setupin (&d4_defaultcontext);
+}
+
+
+/*
+ * Same as d4setup, for the caches of context x (NULL for the default one).
+ * It may be called again after more calls to d4newin, to set up
+ * only the caches created since.
+ */
+int
+d4setupin (d4context *x)
+{
+	int i, nnodes = 0;
 	int r = 0;
+	int hashsize, hashnodes, totalnodes = 0;
 	d4cache *c, *cc;
 	d4stacknode *nodes = NULL, *ptr;
+	d4stacknode **table;
 
-	for (c = d4_allcaches;  c != NULL;  c = c->link) {
+	if (x == NULL)
+		x = &d4_defaultcontext;
+	hashsize = x->stackhash.size;
+	hashnodes = x->stackhash.nodes;
+	for (c = x->allcaches;  c != x->setupcaches;  c = c->link) {
 
 		/* Check some stuff the user shouldn't muck with */
 		if (c->stack != NULL || c->pending != NULL ||
@@ -128,7 +188,7 @@ d4setup()
 		 */
 		if (d4custom) {
 			int problem = 0;
-			if (c->cacheid > d4_ncustom)
+			if (c->cacheid > d4_ncustom || x != &d4_defaultcontext)
 				problem |= 0x1;
 			else {
 				if (d4_cust_vals[c->cacheid][0] != c->flags)
@@ -197,13 +257,12 @@ d4setup()
 			/* it looks ok, now initialize */
 			c->numsets = (1<<c->lg2size) / ((1<<c->lg2blocksize) * c->assoc);
 
-			c->stack = calloc (c->numsets+((c->flags&D4F_CCC)!=0),
-					   sizeof(d4stackhead));
+			c->stack = d4tablealloc (D4STACKHEADS(c),
+						 sizeof(d4stackhead));
 			if (c->stack == NULL)
 				goto fail10;
-			nnodes = c->numsets * (1 + c->assoc) +
-				 (c->numsets * c->assoc + 1) * ((c->flags&D4F_CCC)!=0);
-			nodes = calloc (nnodes, sizeof(d4stacknode));
+			nnodes = D4STACKNODES(c);
+			nodes = d4tablealloc (nnodes, sizeof(d4stacknode));
 			if (nodes == NULL)
 				goto fail11;
 			for (i = 0;  i < nnodes;  i++)
@@ -229,10 +288,10 @@ d4setup()
 				ptr += n;
 			}
 			assert (ptr - nodes == nnodes);
-#if D4_HASHSIZE == 0
-			d4stackhash.size += c->numsets * c->assoc;
-#endif
-			d4nnodes += nnodes;
+			for (i = 0;  i < c->numsets+((c->flags&D4F_CCC)!=0);  i++)
+				if (c->stack[i].n > D4HASH_THRESH)
+					hashnodes += c->stack[i].n;
+			totalnodes += nnodes;
 		}
 
 		/* make a printable name if the user didn't pick one */
@@ -245,20 +304,44 @@ d4setup()
 		}
 	}
 #if D4_HASHSIZE > 0
-	d4stackhash.size = D4_HASHSIZE;
+	hashsize = D4_HASHSIZE;
+#else
+	if (hashsize < 1)
+		hashsize = 1;
+	while (hashsize < (double)hashnodes * D4_HASHFACTOR)
+		hashsize <<= 1;	/* never shrinks, the size must stay a power of 2 */
 #endif
-	d4stackhash.table = calloc (d4stackhash.size, sizeof(d4stacknode*));
-	if (d4stackhash.table == NULL)
-		goto fail13;
+	if (hashsize != x->stackhash.size) {
+		/* the caches set up before keep their blocks */
+		table = d4tablealloc (hashsize, sizeof(d4stacknode*));
+		if (table == NULL)
+			goto fail13;
+		for (i = 0;  i < x->stackhash.size && x->stackhash.table != NULL;  i++)
+			while ((ptr = x->stackhash.table[i]) != NULL) {
+				int buck = D4HASH (ptr->blockaddr, ptr->onstack,
+						   ptr->cachep->cacheid, hashsize);
+				x->stackhash.table[i] = ptr->bucket;
+				ptr->bucket = table[buck];
+				table[buck] = ptr;
+			}
+		if (x->stackhash.table != NULL)
+			d4tablefree (x->stackhash.table, x->stackhash.size,
+				     sizeof(d4stacknode*));
+		x->stackhash.table = table;
+		x->stackhash.size = hashsize;
+	}
+	x->stackhash.nodes = hashnodes;
+	x->nnodes += totalnodes;
+	x->setupcaches = x->allcaches;
 	return 0;
 
 	/* Try to undo stuff so (in principle) the user could try again */
 fail13: r++;
 	/* don't bother trying to deallocate c->name */
 fail12:	r++;
-	free (nodes);
+	d4tablefree (nodes, nnodes, sizeof(d4stacknode));
 fail11:	r++;
-	free (c->stack);
+	d4tablefree (c->stack, D4STACKHEADS(c), sizeof(d4stackhead));
 fail10:	r++;
 fail9:	r++;
 fail8:	r++;
@@ -270,14 +353,15 @@ fail3:	r++;
 fail2:	r++;
 fail1:	r++;
 
-	for (cc = d4_allcaches;  cc != c;  cc = cc->link) {
+	for (cc = x->allcaches;  cc != c && cc != x->setupcaches;  cc = cc->link) {
 		/* don't bother trying to deallocate c->name */
-		free (c->stack[0].top);
-		free (c->stack);
-		c->stack = NULL;
-		c->numsets = 0;
+		if (cc->stack == NULL)
+			continue;
+		d4tablefree (cc->stack[0].top, D4STACKNODES(cc), sizeof(d4stacknode));
+		d4tablefree (cc->stack, D4STACKHEADS(cc), sizeof(d4stackhead));
+		cc->stack = NULL;
+		cc->numsets = 0;
 	}
-	d4nnodes = 0;
 	return r;
 }
 
@@ -472,8 +556,8 @@ d4_find (d4cache *c, int stacknum, d4addr blockaddr)
 	d4stacknode *ptr;
 
 	if (c->stack[stacknum].n > D4HASH_THRESH) {
-		int buck = D4HASH (blockaddr, stacknum, c->cacheid);
-		for (ptr = d4stackhash.table[buck];
+		int buck = D4HASH (blockaddr, stacknum, c->cacheid, c->context->stackhash.size);
+		for (ptr = c->context->stackhash.table[buck];
 		     ptr!=NULL && (ptr->blockaddr!=blockaddr || ptr->cachep!=c || ptr->onstack != stacknum);
 		     ptr = ptr->bucket)
 			assert (ptr->valid != 0);
@@ -569,11 +653,11 @@ d4movetobot (d4cache *c, int stacknum, d4stacknode *ptr)
 void
 d4hash (d4cache *c, int stacknum, d4stacknode *s)
 {
-	int buck = D4HASH (s->blockaddr, stacknum, s->cachep->cacheid);
+	int buck = D4HASH (s->blockaddr, stacknum, s->cachep->cacheid, c->context->stackhash.size);
 
 	assert (c->stack[stacknum].n > D4HASH_THRESH);
-	s->bucket = d4stackhash.table[buck];
-	d4stackhash.table[buck] = s;
+	s->bucket = c->context->stackhash.table[buck];
+	c->context->stackhash.table[buck] = s;
 }
 
 
@@ -581,12 +665,12 @@ d4hash (d4cache *c, int stacknum, d4stacknode *s)
 void
 d4_unhash (d4cache *c, int stacknum, d4stacknode *s)
 {
-	int buck = D4HASH (s->blockaddr, stacknum, c->cacheid);
-	d4stacknode *p = d4stackhash.table[buck];
+	int buck = D4HASH (s->blockaddr, stacknum, c->cacheid, c->context->stackhash.size);
+	d4stacknode *p = c->context->stackhash.table[buck];
 
 	assert (c->stack[stacknum].n > D4HASH_THRESH);
 	if (p == s)
-		d4stackhash.table[buck] = s->bucket;
+		c->context->stackhash.table[buck] = s->bucket;
 	else {
 		while (p->bucket != s) {
 			assert (p->bucket != NULL);
@@ -597,15 +681,15 @@ d4_unhash (d4cache *c, int stacknum, d4stacknode *s)
 }
 
 
-/* Allocate a structure describing a pending memory reference */
+/* Allocate a structure describing a pending memory reference of cache c */
 d4pendstack *
-d4get_mref()
+d4get_mref (d4cache *c)
 {
 	d4pendstack *m;
 
-	m = d4pendfree;
+	m = c->context->pendfree;
 	if (m != NULL) {
-		d4pendfree = m->next;
+		c->context->pendfree = m->next;
 		return m;
 	}
 	m = malloc (sizeof(*m));	/* no need to get too fancy here */
@@ -619,10 +703,10 @@ d4get_mref()
 
 /* Deallocate the structure used to describe a pending memory reference */
 void
-d4put_mref (d4pendstack *m)
+d4put_mref (d4cache *c, d4pendstack *m)
 {
-	m->next = d4pendfree;
-	d4pendfree = m;
+	m->next = c->context->pendfree;
+	c->context->pendfree = m;
 }
 
 
@@ -658,7 +742,7 @@ d4_dopending (d4cache *c, d4pendstack *newm)
 			}
 			c->downstream->ref (c->downstream, newm->m);
 		}
-		d4put_mref(newm);
+		d4put_mref(c, newm);
 	} while ((newm = c->pending) != NULL);
 }
 
@@ -679,7 +763,7 @@ d4_wbblock (d4cache *c, d4stacknode *ptr, const int lg2sbsize)
 	dbits = ptr->valid & ptr->dirty;
 	a = ptr->blockaddr;
 	do {
-		newm = d4get_mref();
+		newm = d4get_mref(c);
 		newm->m.accesstype = D4XWRITE;
 		for (;  (dbits&b) == 0;  b<<=1)
 			a += sbsize;
@@ -730,7 +814,7 @@ d4copyback (d4cache *c, const d4memref *m, int prop)
 	if (m != NULL)
 		assert (m->accesstype == D4XCOPYB);
 	if (prop) {
-		newm = d4get_mref();
+		newm = d4get_mref(c);
 		if (m != NULL)
 			newm->m = *m;
 		else {
@@ -781,7 +865,7 @@ d4invalidate (d4cache *c, const d4memref *m, int prop)
 	if (m != NULL)
 		assert (m->accesstype == D4XINVAL);
 	if (prop) {
-		newm = d4get_mref();
+		newm = d4get_mref(c);
 		if (m != NULL)
 			newm->m = *m;
 		else {
@@ -889,11 +973,11 @@ d4customize (FILE *f)
 	 * which can be used to find the proper customized d4ref function
 	 * when the customized program is started up.
 	 */
-	if (d4_allcaches == NULL) {
+	if (d4_defaultcontext.allcaches == NULL) {
 		fprintf (stderr, "Dinero IV: d4customize called before d4new\n");
 		exit (9);
 	}
-	n = d4_allcaches->cacheid;
+	n = d4_defaultcontext.allcaches->cacheid;
 	for (i = 1;  i <= n;  i++)
 		fprintf (f, "extern void d4_%dref (d4cache *, d4memref);\n", i);
 	fprintf (f, "void (*d4_custom[])(d4cache *, d4memref) = {\n\t");
@@ -909,7 +993,7 @@ d4customize (FILE *f)
 	 * If you add new policy functions to ref.c, you need to
 	 * add code here too!
 	 */
-	for (c = d4_allcaches;  c != NULL;  c = c->link) {
+	for (c = d4_defaultcontext.allcaches;  c != NULL;  c = c->link) {
 		int cid = c->cacheid;
 		fprintf (f, "\n");
 
@@ -1131,7 +1215,7 @@ d4customize (FILE *f)
 	/*
 	 * Now tie all the customized values up for checking in d4setup
 	 */
-	n = d4_allcaches->cacheid;
+	n = d4_defaultcontext.allcaches->cacheid;
 	fprintf (f, "\nlong *d4_cust_vals[%d+1] = {\n\tNULL,\n", n);
 	for (i = 1;  i <= n;  i++)
 		fprintf (f, "	&d4_cust_%d_vals[0]%s\n", i, (i<n) ? "," : "");
@@ -282,7 +282,7 @@ d4prefetch_always (d4cache *c, d4memref m, int miss, d4stacknode *stackptr)
 {
 	d4pendstack *pf;
 
-	pf = d4get_mref();
+	pf = d4get_mref(c);
 	pf->m.address = D4ADDR2SUBBLOCK (c, m.address + c->prefetch_distance);
 	pf->m.accesstype = m.accesstype | D4PREFETCH;
 	pf->m.size = 1<<D4VAL(c,lg2subblocksize);
@@ -305,7 +305,7 @@ d4prefetch_loadforw (d4cache *c, d4memref m, int miss, d4stacknode *stackptr)
 	if (D4ADDR2BLOCK(c,m.address+c->prefetch_distance) != D4ADDR2BLOCK(c,m.address))
 		return NULL;
 
-	pf = d4get_mref();
+	pf = d4get_mref(c);
 	pf->m.address = D4ADDR2SUBBLOCK (c, m.address + c->prefetch_distance);
 	pf->m.accesstype = m.accesstype | D4PREFETCH;
 	pf->m.size = 1<<D4VAL(c,lg2subblocksize);
@@ -325,7 +325,7 @@ d4prefetch_subblock (d4cache *c, d4memref m, int miss, d4stacknode *stackptr)
 {
 	d4pendstack *pf;
 
-	pf = d4get_mref();
+	pf = d4get_mref(c);
 	pf->m.address = D4ADDR2SUBBLOCK (c, m.address + c->prefetch_distance);
 	pf->m.accesstype = m.accesstype | D4PREFETCH;
 	pf->m.size = 1<<D4VAL(c,lg2subblocksize);
@@ -351,7 +351,7 @@ d4prefetch_miss (d4cache *c, d4memref m, int miss, d4stacknode *stackptr)
 	if (!miss)
 		return NULL;
 
-	pf = d4get_mref();
+	pf = d4get_mref(c);
 	pf->m.address = D4ADDR2SUBBLOCK (c, m.address + c->prefetch_distance);
 	pf->m.accesstype = m.accesstype | D4PREFETCH;
 	pf->m.size = 1<<D4VAL(c,lg2subblocksize);
@@ -383,7 +383,7 @@ d4prefetch_tagged (d4cache *c, d4memref m, int miss, d4stacknode *stackptr)
 	if (!miss && (sbbits & stackptr->referenced) != 0)
 		return NULL;
 
-	pf = d4get_mref();
+	pf = d4get_mref(c);
 	pf->m.address = D4ADDR2SUBBLOCK (c, m.address + c->prefetch_distance);
 	pf->m.accesstype = m.accesstype | D4PREFETCH;
 	pf->m.size = 1<<D4VAL(c,lg2subblocksize);
@@ -589,7 +589,7 @@ d4_splitm (d4cache *c, d4memref mr, d4addr ba)
 
 	if (ba == D4ADDR2BLOCK (c, mr.address + mr.size - 1))
 		return mr;
-	pf = d4get_mref();
+	pf = d4get_mref(c);
         pf->m.address = ba + bsize;
         pf->m.accesstype = mr.accesstype | D4_MULTIBLOCK;
 	newsize = bsize - (mr.address&bmask);
@@ -664,7 +664,7 @@ d4ref (d4cache *c, d4memref mr)
 			/* Note: 0 <= random() <= 2^31-1 and 0 <= random()/(INT_MAX/100) < 100. */
 			if (D4VAL (c, prefetch_abortpercent) > 0 &&
 			    random()/(INT_MAX/100) < D4VAL (c, prefetch_abortpercent))
-				d4put_mref (pf);	/* throw it away */
+				d4put_mref (c, pf);	/* throw it away */
 			else {
 				pf->next = c->pending;	/* add to pending list */
 				c->pending = pf;
@@ -729,14 +729,14 @@ d4ref (d4cache *c, d4memref mr)
 	 * a fetch to load the complete subblock and a write-through store.
 	 */
 	if (!ronly && atype == D4XWRITE && !wback) {
-		d4pendstack *newm = d4get_mref();
+		d4pendstack *newm = d4get_mref(c);
 		newm->m = m; 
 		newm->next = c->pending;
 		c->pending = newm;
 	}
 	if (miss && (ronly || atype != D4XWRITE ||
 		     (walloc && m.size != D4REFNSB (c, m) << D4VAL (c, lg2subblocksize)))) {
-		d4pendstack *newm = d4get_mref();
+		d4pendstack *newm = d4get_mref(c);
 		/* note, we drop prefetch attribute */
 		newm->m.accesstype = (atype == D4XWRITE) ? D4XREAD : atype;
 		newm->m.address = D4ADDR2SUBBLOCK (c, m.address);
@@ -0,0 +1,195 @@
+#!/bin/sh
+# MiBench rebuilt under a matrix of guest compiler flags
+#
+#   guest_matrix.sh [-c compiler] [-f flags] [-l "-O0 -O2 -Os"] [-s "small large"]
+#                   [-o dir] SIMULATOR MIBENCH_DIR
+#
+# The programs bench.sh runs are built again, for each optimization
+# level of -l, once with the delay slots filled by the compiler and once
+# without (-fno-delayed-branch), into a tree of their own under dir
+# (guest_matrix.out), and bench.sh runs each tree. The compiler (-c,
+# mips-newlib-elf-gcc) is called through a wrapper that drops the levels
+# the MiBench makefiles give, and adds -f (-specs=archc) and those of
+# the variant after the rest, so every program gets the same flags.
+#
+# dir/<variant>.json holds the results of bench.sh. Next to them,
+# dir/results.tsv has a line per run and variant with its instructions,
+# the cycles of the first estimate of the report, the miss rates of the
+# first level-1 caches and the energy of the power model and of the
+# caches, and dir/report.txt the same, a table a metric, with a column a
+# variant. A metric the simulator does not report is left as "-".
+
+GUEST_CC=mips-newlib-elf-gcc
+GUEST_FLAGS=-specs=archc
+LEVELS="-O0 -O2 -Os"
+SETS="small large"
+OUT=guest_matrix.out
+USAGE="usage: $0 [-c compiler] [-f flags] [-l levels] [-s sets] [-o dir] simulator mibench-dir"
+
+while getopts "c:f:l:s:o:" opt; do
+  case $opt in
+    c) GUEST_CC=$OPTARG ;;
+    f) GUEST_FLAGS=$OPTARG ;;
+    l) LEVELS=$OPTARG ;;
+    s) SETS=$OPTARG ;;
+    o) OUT=$OPTARG ;;
+    *) echo "$USAGE" >&2; exit 2 ;;
+  esac
+done
+shift `expr $OPTIND - 1`
+
+if [ $# -ne 2 ]; then
+  echo "$USAGE" >&2
+  exit 2
+fi
+
+HERE=`cd \`dirname $0\` && pwd`
+SIM=`cd \`dirname $1\` && pwd`/`basename $1`
+MIBENCH=`cd $2 && pwd` || exit 1
+mkdir -p $OUT && OUT=`cd $OUT && pwd` || exit 1
+
+# Directories of the programs of bench.sh, and where each is built
+DIRS="automotive/qsort automotive/bitcount automotive/susan network/dijkstra
+      security/sha security/rijndael telecomm/CRC32 telecomm/FFT telecomm/adpcm telecomm/gsm"
+
+build_dir() {
+  case $1 in
+    telecomm/adpcm) echo $1/src ;;
+    *) echo $1 ;;
+  esac
+}
+
+# The variants, as name:flags with the flags split by commas
+VARIANTS=
+for level in $LEVELS; do
+  VARIANTS="$VARIANTS ${level#-}:$level ${level#-}.nodelay:$level,-fno-delayed-branch"
+done
+
+# Copies the directories into $1 without their executables and objects,
+# so that nothing built by the shipped flags is left to run.
+copy_tree() {
+  rm -rf $1
+  for d in $DIRS; do
+    mkdir -p $1/`dirname $d`
+    cp -R $MIBENCH/$d $1/$d || return 1
+  done
+  find $1 -type f | while read f; do
+    [ "`head -c 4 $f | od -An -c | tr -d ' '`" = 177ELF ] && rm -f $f
+  done
+  return 0
+}
+
+# Writes the compiler wrapper of a variant, flags $2, into $1.
+write_wrapper() {
+  {
+    echo '#!/bin/sh'
+    echo 'for a; do'
+    echo '  shift'
+    echo '  case $a in'
+    echo '    -O|-O[0-9s]|-Ofast) ;;'
+    echo '    *) set -- "$@" "$a" ;;'
+    echo '  esac'
+    echo 'done'
+    echo "exec $GUEST_CC $GUEST_FLAGS \"\$@\" `echo $2 | tr , ' '`"
+  } > $1
+  chmod +x $1
+}
+
+# The metrics of a --stats-out CSV file, tab separated: instructions,
+# cycles, CPI, level-1 instruction and data miss rates, energy in joules
+# and energy of the caches in pJ.
+metrics() {
+  awk -F, '
+    { gsub(/"/, "", $1); gsub(/"/, "", $2); v[$1 "," $2] = $3 }
+    $1 ~ /^mips\.cycles\./ && $2 == "total" && cycles == "" { cycles = $3 }
+    function rate(section, kinds,    n, i, k, fetches, misses) {
+      n = split(kinds, k, " ")
+      for (i = 1; i <= n; i++) {
+        fetches += v[section "," k[i] "_fetches"]
+        misses += v[section "," k[i] "_misses"]
+      }
+      return fetches > 0 ? sprintf("%.6f", misses / fetches) : "-"
+    }
+    function value(key) {
+      return (key in v) ? v[key] : "-"
+    }
+    END {
+      insns = value("archc,instructions")
+      if (cycles == "")
+        cycles = "-"
+      cpi = (cycles != "-" && insns > 0) ? sprintf("%.4f", cycles / insns) : "-"
+      printf "%s\t%s\t%s\t%s\t%s\t%s\t%s\n", insns, cycles, cpi,
+             rate("mips.cache.0.l1i", "instruction"), rate("mips.cache.0.l1d", "read write"),
+             value("power,energy_joules"), value("mips.cache.0,energy_pj")
+    }' $1
+}
+
+FAILED=0
+printf 'variant\tinput\tname\tinstructions\tcycles\tcpi\tl1i_miss_rate\tl1d_miss_rate\tenergy_joules\tcache_energy_pj\toutputs_match\n' > $OUT/results.tsv
+
+for v in $VARIANTS; do
+  name=${v%%:*}
+  tree=$OUT/trees/$name
+  echo "Building $name (`echo ${v#*:} | tr , ' '`)" >&2
+  copy_tree $tree || exit 1
+  write_wrapper $OUT/trees/$name.cc ${v#*:}
+  for d in $DIRS; do
+    if ! make -B -C $tree/`build_dir $d` TESTCOMPILER=$OUT/trees/$name.cc TESTFLAG= > $tree/$d.log 2>&1; then
+      echo "$name: $d did not build, see $tree/$d.log" >&2
+      FAILED=1
+    fi
+  done
+
+  rm -rf $OUT/stats/$name
+  sh $HERE/bench.sh -s "$SETS" -o $OUT/$name.json -d $OUT/stats/$name $SIM $tree || FAILED=1
+  for set in $SETS; do
+    for f in $OUT/stats/$name/$set.*.csv; do
+      [ -f $f ] || continue
+      run=${f##*/$set.}
+      run=${run%.csv}
+      match=`grep -A3 "\"name\": \"$run\", \"input\": \"$set\"" $OUT/$name.json | sed -n 's/.*"outputs_match": \([a-z]*\).*/\1/p'`
+      printf '%s\t%s\t%s\t%s\t%s\n' $name $set $run "`metrics $f`" ${match:-false} >> $OUT/results.tsv
+    done
+  done
+done
+
+# A table a metric, with a line a run and a column a variant
+awk -F '\t' -v variants="$VARIANTS" '
+  BEGIN {
+    n = split(variants, list, " ")
+    for (i = 1; i <= n; i++)
+      sub(/:.*/, "", list[i])
+  }
+  NR == 1 {
+    for (c = 4; c <= NF; c++)
+      metric[c] = $c
+    columns = NF
+    next
+  }
+  {
+    run = $2 "." $3
+    if (!(run in seen)) {
+      seen[run] = 1
+      runs[++nruns] = run
+    }
+    for (c = 4; c <= NF; c++)
+      value[run, $1, c] = $c
+  }
+  END {
+    for (c = 4; c <= columns; c++) {
+      printf "%s\n\n%-24s", metric[c], "run"
+      for (i = 1; i <= n; i++)
+        printf " %14s", list[i]
+      printf "\n"
+      for (r = 1; r <= nruns; r++) {
+        printf "%-24s", runs[r]
+        for (i = 1; i <= n; i++)
+          printf " %14s", ((runs[r], list[i], c) in value) ? value[runs[r], list[i], c] : "-"
+        printf "\n"
+      }
+      printf "\n"
+    }
+  }' $OUT/results.tsv > $OUT/report.txt
+
+echo "Results written to $OUT/results.tsv and $OUT/report.txt" >&2
+exit $FAILED
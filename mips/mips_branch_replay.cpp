@@ -0,0 +1,177 @@
+/**
+ * @file      mips_branch_replay.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Runs the branch predictors of the MIPS analysis over a branch
+ *            trace written with MIPS_BRANCH_TRACE, and reports their
+ *            mispredictions and the BTB and RAS misses as the simulator
+ *            does. The predictors, the BTB and the RAS are set with
+ *            MIPS_PREDICTORS, MIPS_BTB_ENTRIES and MIPS_RAS_ENTRIES, as in
+ *            the simulator.
+ *
+ *            mips_branch_replay <branch-trace-file>
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mips_branch.H"
+#include "mips_branch_trace.H"
+
+static unsigned long long GetEnvCount(const char* name, unsigned long long value) {
+  const char* s = std::getenv(name);
+  return (s && *s) ? std::strtoull(s, nullptr, 10) : value;
+}
+
+// Power of two with an optional k or M scale. Returns its log2, or -1 if
+// value is not one.
+static int Log2Scaled(const std::string& value) {
+  char* end;
+  unsigned long long n = std::strtoull(value.c_str(), &end, 10);
+  int lg2 = 0;
+
+  switch (*end) {
+  case 'k': case 'K': n <<= 10; end++; break;
+  case 'm': case 'M': n <<= 20; end++; break;
+  }
+  if (*end || !n || (n & (n - 1)))
+    return -1;
+  while (n >>= 1)
+    lg2++;
+  return lg2;
+}
+
+// The predictors of MIPS_PREDICTORS=file, or the default ones.
+static std::vector<std::unique_ptr<mips_predictor>> ReadPredictors() {
+  const char* path = std::getenv("MIPS_PREDICTORS");
+  std::istringstream defaults(mips_predictor::kDefaults);
+  std::ifstream file;
+  std::istream* in = &defaults;
+  std::vector<std::unique_ptr<mips_predictor>> predictors;
+  std::string line, kind;
+
+  if (path && *path) {
+    file.open(path);
+    if (!file) {
+      std::cerr << "mips_branch_replay: Could not read predictors " << path << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    in = &file;
+  }
+  while (std::getline(*in, line)) {
+    std::istringstream words(line);
+
+    if (!(words >> kind) || kind[0] == '#')
+      continue;
+    predictors.push_back(mips_predictor::create(line));
+    if (!predictors.back()) {
+      std::cerr << "mips_branch_replay: Predictor #" << predictors.size() - 1 << ": " << line
+                << " is not valid.\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+  if (predictors.empty()) {
+    std::cerr << "mips_branch_replay: No predictor in " << path << ".\n";
+    std::exit(EXIT_FAILURE);
+  }
+  return predictors;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::cerr << "Usage: mips_branch_replay <branch-trace-file>\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::unique_ptr<mips_predictor>> predictors = ReadPredictors();
+  const char* btb_entries = std::getenv("MIPS_BTB_ENTRIES");
+  int lg2btb = Log2Scaled(btb_entries && *btb_entries ? btb_entries : "512");
+  unsigned long long ras_entries = GetEnvCount("MIPS_RAS_ENTRIES", 8);
+  mips_btb btb;
+  mips_ras ras;
+
+  if (lg2btb < 0 || lg2btb > 24 || !ras_entries || ras_entries > 65536) {
+    std::cerr << "mips_branch_replay: MIPS_BTB_ENTRIES must be a power of two up to 16M, and "
+                 "MIPS_RAS_ENTRIES between 1 and 65536.\n";
+    return EXIT_FAILURE;
+  }
+  btb.init(lg2btb);
+  ras.init(ras_entries);
+
+  mips_branch_trace_reader in;
+  mips_branch_trace::Record r;
+  std::vector<unsigned long long> wrong(predictors.size());
+  unsigned long long records = 0, branches = 0, taken = 0, btb_misses = 0, returns = 0, ras_misses = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  if (!in.open(argv[1])) {
+    std::cerr << "mips_branch_replay: " << argv[1] << " is not a branch trace.\n";
+    return EXIT_FAILURE;
+  }
+  // As the simulator resolves them: conditional branches train the
+  // predictors, returns pop the RAS, and whatever else is taken goes
+  // through the BTB
+  while (in.next(r)) {
+    uint32_t npc = r.kind == mips_branch_trace::kConditional && !r.taken ? r.pc + 8 : r.target;
+
+    records++;
+    if (r.kind == mips_branch_trace::kConditional) {
+      branches++;
+      for (unsigned i = 0; i < predictors.size(); i++) {
+        wrong[i] += predictors[i]->predict(r.pc, r.target) != r.taken;
+        predictors[i]->update(r.pc, r.taken);
+      }
+    }
+    if (r.kind == mips_branch_trace::kReturn) {
+      returns++;
+      ras_misses += ras.pop() != npc;
+    }
+    else if (r.taken) {
+      taken++;
+      btb_misses += !btb.predicts(r.pc, npc);
+      btb.update(r.pc, npc);
+    }
+    if (r.kind == mips_branch_trace::kCall)
+      ras.push(r.pc + 8);
+  }
+  if (!in.ok()) {
+    std::cerr << "mips_branch_replay: Branch trace " << argv[1] << " is truncated.\n";
+    return EXIT_FAILURE;
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  int width = 14;
+
+  for (const std::unique_ptr<mips_predictor>& p : predictors)
+    width = std::max(width, (int) p->name().size() + 4);
+  printf("Total number of branches:  %llu\n\n", branches);
+  for (unsigned i = 0; i < predictors.size(); i++)
+    printf("Wrong branch predictions %-*s%llu (%.2f %%)\n", width, ("(" + predictors[i]->name() + "):").c_str(),
+           wrong[i], ((float) wrong[i] / branches) * 100);
+  printf("BTB misses: %llu of %llu taken branches and jumps (%.2f %%)\n", btb_misses, taken,
+         ((float) btb_misses / taken) * 100);
+  printf("RAS misses: %llu of %llu returns (%.2f %%)\n", ras_misses, returns, ((float) ras_misses / returns) * 100);
+  fprintf(stderr, "%llu branches and jumps in %.3f s (%.1f million a second)\n", records, seconds,
+          seconds > 0 ? records / seconds / 1e6 : 0.0);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,273 @@
+/**
+ * @file      mips_inputs.cpp
+ * @author    The ArchC Team
+ *
+ *            The ArchC Team
+ *            http://www.archc.org/
+ *
+ *            Computer Systems Laboratory (LSC)
+ *            IC-UNICAMP
+ *            http://www.lsc.ic.unicamp.br/
+ *
+ * @version   1.0
+ *
+ * @brief     Writes inputs of about a given size for the MiBench
+ *            workloads, to measure how the simulator scales with the data
+ *            its guest works on (see the bench-scale target). The same
+ *            seed gives the same bytes on every host.
+ *
+ *            mips_inputs [-s seed] [-l] <kind> <bytes>
+ *
+ *            qsort.small  words, one a line (qsort_small)
+ *            qsort.large  lines of three integers (qsort_large)
+ *            dijkstra     an adjacency matrix of weights (dijkstra_*)
+ *            patricia     lines of a time and an address (patricia)
+ *            text         letters and digits, in lines (sha, rijndael)
+ *            pcm          16-bit samples, big-endian as the guest reads
+ *                         them, or little-endian with -l (CRC32, adpcm)
+ *            pgm          a binary PGM image of shapes (susan)
+ *
+ *            bytes takes a k, M or G scale. The programs built into the
+ *            shipped binaries read at most 10000 lines of qsort and a
+ *            100x100 matrix of dijkstra; past those the input still grows,
+ *            with a warning, but what they work on does not.
+ *
+ * @attention Copyright (C) 2002-2006 --- The ArchC Team
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+// Entries of qsort and nodes of dijkstra the shipped binaries were built with
+static const unsigned long long kQsortEntries = 10000;
+static const unsigned kDijkstraNodes = 100;
+
+// xorshift64*, so that the inputs do not depend on the C library.
+class Random {
+  uint64_t s;
+
+ public:
+  explicit Random(uint64_t seed) : s(seed * 0x9e3779b97f4a7c15ULL + 0x2545f4914f6cdd1dULL) {}
+
+  uint32_t next() {
+    s ^= s >> 12;
+    s ^= s << 25;
+    s ^= s >> 27;
+    return (s * 0x2545f4914f6cdd1dULL) >> 32;
+  }
+
+  // Uniform enough in [0, n) for n much smaller than 2^32.
+  uint32_t below(uint32_t n) { return next() % n; }
+};
+
+// A count with an optional k, M or G scale, or 0 if value is not one.
+static unsigned long long Scaled(const char* value) {
+  char* end;
+  unsigned long long n = std::strtoull(value, &end, 10);
+
+  switch (*end) {
+  case 'k': case 'K': n <<= 10; end++; break;
+  case 'm': case 'M': n <<= 20; end++; break;
+  case 'g': case 'G': n <<= 30; end++; break;
+  }
+  return *end ? 0 : n;
+}
+
+static void Word(Random& r, std::string& w) {
+  unsigned n = 3 + r.below(10);
+
+  w.clear();
+  while (n--)
+    w += (char) ('a' + r.below(26));
+}
+
+static void QsortSmall(Random& r, unsigned long long bytes) {
+  unsigned long long written = 0, lines = 0;
+  std::string w;
+
+  while (written < bytes) {
+    Word(r, w);
+    std::printf("%s\n", w.c_str());
+    written += w.size() + 1;
+    lines++;
+  }
+  if (lines > kQsortEntries)
+    std::fprintf(stderr, "mips_inputs: qsort_small sorts the first %llu of %llu words.\n", kQsortEntries, lines);
+}
+
+static void QsortLarge(Random& r, unsigned long long bytes) {
+  unsigned long long written = 0, lines = 0;
+
+  while (written < bytes) {
+    int n = std::printf("%u\t%u\t%u\n", r.next() >> 1, r.next() >> 1, r.next() >> 1);
+
+    written += n;
+    lines++;
+  }
+  if (lines > kQsortEntries)
+    std::fprintf(stderr, "mips_inputs: qsort_large sorts the first %llu of %llu vertices.\n", kQsortEntries, lines);
+}
+
+// Weights of 0 to 99, three bytes each with their separator, and never
+// fewer nodes than dijkstra reads.
+static void Dijkstra(Random& r, unsigned long long bytes) {
+  unsigned nodes = std::max<unsigned>(kDijkstraNodes, (unsigned) std::sqrt(bytes / 3.0));
+
+  for (unsigned i = 0; i < nodes; i++) {
+    for (unsigned j = 0; j < nodes; j++)
+      std::printf("%u ", r.below(100));
+    std::printf("\n");
+  }
+  if (nodes != kDijkstraNodes)
+    std::fprintf(stderr, "mips_inputs: dijkstra reads a %ux%u matrix, not %ux%u.\n",
+                 kDijkstraNodes, kDijkstraNodes, nodes, nodes);
+}
+
+// Each address is inserted and then looked up, so the trie grows with
+// the addresses, a fourth of the lines drawn from a pool. The times go
+// up by a millisecond at most a line.
+static void Patricia(Random& r, unsigned long long bytes) {
+  unsigned long long written = 0, micros = 245680;
+  unsigned pool = std::max<unsigned long long>(16, bytes / 24 / 4);
+  unsigned* addresses = new unsigned[pool];
+
+  for (unsigned i = 0; i < pool; i++)
+    addresses[i] = r.next() >> 1;
+  while (written < bytes) {
+    written += std::printf("%llu.%06llu %u %u 53 53\n", micros / 1000000, micros % 1000000,
+                           addresses[r.below(pool)], 1 + r.below(90));
+    micros += r.below(1000);
+  }
+  delete[] addresses;
+}
+
+static void Text(Random& r, unsigned long long bytes) {
+  static const char kLetters[] = "etaoinshrdlucmfwypvbgkjqxzETAOINSHRDLU0123456789";
+  unsigned long long written = 0;
+  unsigned column = 0;
+
+  while (written < bytes) {
+    // Frequent letters first: the square favours them
+    uint32_t x = r.below(sizeof(kLetters) - 1);
+
+    std::putchar(kLetters[x * x / (sizeof(kLetters) - 1)]);
+    written++;
+    if (++column == 64 + r.below(16)) {
+      std::putchar('\n');
+      written++;
+      column = 0;
+    }
+  }
+}
+
+// Three tones, in 16.16 fixed point so that no libm takes part, and some
+// noise.
+static void Pcm(Random& r, unsigned long long bytes, bool little) {
+  uint32_t phases[3] = {0, 0, 0};
+  uint32_t steps[3] = {20000 + r.below(40000), 90000 + r.below(90000), 300000 + r.below(300000)};
+  int amplitudes[3] = {9000, 5000, 2500};
+
+  for (unsigned long long i = 0; i < bytes / 2; i++) {
+    int sample = (int) r.below(801) - 400;
+
+    for (int k = 0; k < 3; k++) {
+      // A triangle of period 2^24
+      int t = (phases[k] >> 8) & 0xffff;
+
+      sample += (t < 0x8000 ? t - 0x4000 : 0xc000 - t) * amplitudes[k] / 0x4000;
+      phases[k] += steps[k];
+    }
+    if ((i & 8191) == 0)
+      steps[r.below(3)] += r.below(2001) - 1000;
+    sample = std::max(-32768, std::min(32767, sample));
+    if (little) {
+      std::putchar(sample & 0xff);
+      std::putchar((sample >> 8) & 0xff);
+    }
+    else {
+      std::putchar((sample >> 8) & 0xff);
+      std::putchar(sample & 0xff);
+    }
+  }
+}
+
+// A gradient with rectangles and discs over it, and a little noise, so
+// that there are edges and corners to find.
+static void Pgm(Random& r, unsigned long long bytes) {
+  unsigned side = std::max<unsigned>(16, (unsigned) std::sqrt((double) bytes));
+  unsigned shapes = 4 + side * side / 4096;
+  unsigned char* image = new unsigned char[(size_t) side * side];
+
+  for (unsigned y = 0; y < side; y++)
+    for (unsigned x = 0; x < side; x++)
+      image[(size_t) y * side + x] = 40 + (x + y) * 80 / (2 * side);
+  for (unsigned s = 0; s < shapes; s++) {
+    unsigned size = 4 + r.below(side / 4 + 1);
+    unsigned x0 = r.below(side), y0 = r.below(side);
+    unsigned char level = r.below(256);
+    bool disc = r.below(2);
+
+    for (unsigned y = y0; y < std::min(side, y0 + size); y++)
+      for (unsigned x = x0; x < std::min(side, x0 + size); x++) {
+        int dx = 2 * (int) (x - x0) - (int) size, dy = 2 * (int) (y - y0) - (int) size;
+
+        if (!disc || dx * dx + dy * dy <= (int) (size * size))
+          image[(size_t) y * side + x] = level;
+      }
+  }
+  for (size_t i = 0; i < (size_t) side * side; i++)
+    image[i] = std::max(0, std::min(255, image[i] + (int) r.below(9) - 4));
+
+  std::printf("P5\n%u %u\n255\n", side, side);
+  std::fwrite(image, 1, (size_t) side * side, stdout);
+  delete[] image;
+}
+
+static void Usage() {
+  std::fprintf(stderr, "usage: mips_inputs [-s seed] [-l] "
+               "qsort.small|qsort.large|dijkstra|patricia|text|pcm|pgm bytes\n");
+  std::exit(2);
+}
+
+int main(int argc, char* argv[]) {
+  unsigned long long seed = 1, bytes;
+  bool little = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:l")) != -1)
+    switch (opt) {
+    case 's': seed = std::strtoull(optarg, nullptr, 10); break;
+    case 'l': little = true; break;
+    default: Usage();
+    }
+  if (argc - optind != 2 || !(bytes = Scaled(argv[optind + 1])))
+    Usage();
+
+  std::string kind = argv[optind];
+  Random r(seed);
+
+  if (kind == "qsort.small")
+    QsortSmall(r, bytes);
+  else if (kind == "qsort.large")
+    QsortLarge(r, bytes);
+  else if (kind == "dijkstra")
+    Dijkstra(r, bytes);
+  else if (kind == "patricia")
+    Patricia(r, bytes);
+  else if (kind == "text")
+    Text(r, bytes);
+  else if (kind == "pcm")
+    Pcm(r, bytes, little);
+  else if (kind == "pgm")
+    Pgm(r, bytes);
+  else
+    Usage();
+  return std::fflush(stdout) == 0 ? 0 : 1;
+}
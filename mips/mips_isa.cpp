@@ -25,10 +25,22 @@
 #include  "mips_bhv_macros.H"
 
 
-#include <deque>
 #include <set>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 //If you want debug information for this model, uncomment next line
 // #define DEBUG_MODEL
@@ -36,8 +48,49 @@
 
 extern "C" {
 #include "dinero_iv/d4.h"
+#if D4CUSTOM
+// The hierarchies libd4-custom.a was specialized for (see the
+// custom-caches target of the Makefile).
+extern const char mips_d4custom_caches[];
+#endif
 }
 
+#include "mips_trace.H"
+#include "mips_branch_trace.H"
+#include "mips_sweep.H"
+#include "mips_lanes.H"
+#include "mips_3c.H"
+#include "mips_branch.H"
+#include "mips_ooo.H"
+#include "mips_ilp.H"
+#include "mips_stores.H"
+#include "mips_profile.H"
+#include "mips_values.H"
+#include "mips_hotspots.H"
+#include "mips_loops.H"
+#include "mips_bbv.H"
+#include "mips_coherence.H"
+#include "mips_stages.H"
+#include "mips_dram.H"
+#include "mips_contention.H"
+#include "mips_tlb.H"
+#include "mips_reuse.H"
+#include "mips_layout.H"
+#include "mips_fetch.H"
+#include "mips_ref_queue.H"
+#include "mips_microbench.H"
+#include "ac_fork.H"
+#include "ac_stats_out.H"
+#include "ac_symbols.H"
+#include "ac_host_profile.H"
+#include "ac_stats_snapshot.H"
+#include "ac_host_place.H"
+#include "ac_checkpoint.H"
+
+#ifdef POWER_SIM
+#include "arch_power_stats.H"
+#endif
+
 //!User defined macros to reference registers.
 #define Ra 31
 #define Sp 29
@@ -46,6 +99,33 @@ extern "C" {
 // mips-specific datatypes
 using namespace mips_parms;
 
+// Analyses compiled in: all of them, unless the ANALYSES variable of the
+// Makefile lists some (-DMIPS_ANALYSES -DMIPS_ANALYSIS_<name>=1 each).
+// The behaviors do none of the work of the others, whose results are
+// left out of the report.
+#ifndef MIPS_ANALYSES
+#define MIPS_ANALYSIS_hazard 1
+#define MIPS_ANALYSIS_branch 1
+#define MIPS_ANALYSIS_superscalar 1
+#define MIPS_ANALYSIS_ooo 1
+#define MIPS_ANALYSIS_cache 1
+#endif
+#ifndef MIPS_ANALYSIS_hazard
+#define MIPS_ANALYSIS_hazard 0
+#endif
+#ifndef MIPS_ANALYSIS_branch
+#define MIPS_ANALYSIS_branch 0
+#endif
+#ifndef MIPS_ANALYSIS_superscalar
+#define MIPS_ANALYSIS_superscalar 0
+#endif
+#ifndef MIPS_ANALYSIS_ooo
+#define MIPS_ANALYSIS_ooo 0
+#endif
+#ifndef MIPS_ANALYSIS_cache
+#define MIPS_ANALYSIS_cache 0
+#endif
+
 static int processors_started = 0;
 #define DEFAULT_STACK_SIZE (256*1024)
 
@@ -62,6 +142,13 @@ struct mips_instruction {
   unsigned int func;
   unsigned int addr;
   int imm;
+  // Registers read and written, as bit r for register r and bits 32 and
+  // 33 for hi and lo; set by variables::push().
+  uint64_t reads, writes;
+  // Whether the hazard analysis counts it as a NOP (sll $0, $0, 0 and the
+  // other all-zero encodings), and whether it leaves it out of the
+  // registers written; set once by variables::push().
+  bool nop, no_write;
 };
 
 std::ostream& operator<<(std::ostream& os, const mips_instruction& inst) {
@@ -94,54 +181,566 @@ std::ostream& operator<<(std::ostream& os, const mips_instruction& inst) {
   return os;
 }
 
-char stupid_useless_placeholder[8]{"lolwut\n"};
+// Instruction word of inst, as stored in traces.
+static uint32_t PackInstruction(const mips_instruction& inst) {
+  switch (inst.type) {
+  case mips_instruction::kR:
+    return inst.op << 26 | inst.rs << 21 | inst.rt << 16 | inst.rd << 11 | inst.shamt << 6 | inst.func;
+  case mips_instruction::kI:
+    return inst.op << 26 | inst.rs << 21 | inst.rt << 16 | (inst.imm & 0xFFFF);
+  default:
+    return inst.op << 26 | inst.addr;
+  }
+}
+
+// Same fields as the format behaviors pass to push().
+static mips_instruction UnpackInstruction(unsigned type, uint32_t word) {
+  mips_instruction inst{mips_instruction::i_type(type), word >> 26, 0, 0, 0, 0, 0, 0, 0};
+  switch (inst.type) {
+  case mips_instruction::kR:
+    inst.rd = (word >> 11) & 0x1F;
+    inst.shamt = (word >> 6) & 0x1F;
+    inst.func = word & 0x3F;
+    // Fall through
+  case mips_instruction::kI:
+    inst.rs = (word >> 21) & 0x1F;
+    inst.rt = (word >> 16) & 0x1F;
+    if (inst.type == mips_instruction::kI)
+      inst.imm = (int16_t) (word & 0xFFFF);
+    break;
+  default:
+    inst.addr = word & 0x3FFFFFF;
+    break;
+  }
+  return inst;
+}
 
 struct variables {
-  unsigned int number_of_instructions; // Include NOP instructions
-  unsigned int number_of_nops;
-  int pc_addr; // Current pc value
-  int static_wrong_predictions;
-  int saturating_wrong_predictions;
-  int two_level_wrong_predictions;
-  unsigned int total_number_of_branches;
-  int two_level_history;
-  int saturating_stage;
-  std::vector<int> two_level_stages;
+  static constexpr bool kHazards = MIPS_ANALYSIS_hazard;
+  static constexpr bool kBranches = MIPS_ANALYSIS_branch;
+  static constexpr bool kSuperscalar = MIPS_ANALYSIS_superscalar;
+  static constexpr bool kOutOfOrder = MIPS_ANALYSIS_ooo;
+  static constexpr bool kCaches = MIPS_ANALYSIS_cache;
+  static constexpr bool kAnyAnalysis = kHazards || kBranches || kSuperscalar || kOutOfOrder || kCaches;
+  // The counters are 64-bit, as runs of more than 4G instructions are
+  // common.
+  unsigned long long number_of_instructions; // Include NOP instructions
+  unsigned long long number_of_nops;
+  unsigned long long total_number_of_branches; // conditional ones
+  // Predictors of the conditional branches, and their mispredictions;
+  // see SetUpPredictors(). The branch target buffer and the return
+  // address stack predict where the branches and jumps taken go.
+  std::vector<std::unique_ptr<mips_predictor>> predictors;
+  std::vector<unsigned long long> wrong_predictions;
+  mips_btb btb;
+  mips_ras ras;
+  unsigned long long taken_branches = 0, btb_misses = 0; // returns left out
+  unsigned long long returns = 0, ras_misses = 0;
+  // The branch or jump whose delay slot comes next, told by push() from
+  // the pc Fetch() last saw. Its outcome is known at the next Fetch().
+  struct PendingBranch {
+    enum Kind { kNone, kConditional, kJump, kCall, kReturn };
+    Kind kind;
+    unsigned pc, target; // target of conditional branches only
+  } pending_branch = {PendingBranch::kNone, 0, 0};
+  unsigned fetch_pc = 0;
   static constexpr int kNumberOfStoredInstructions = 10;
-  static constexpr int kNumberOfStages = 2; // The total number of stages is twice that (taken + not taken)
-  static constexpr int kHistoryDepth = 2;
-  static constexpr bool is_fowarding = true;
-  enum pipeline_stages { k5, k7, k13, SIZE };
+  // A pipeline whose hazards are counted; see SetUpPipelines().
+  struct Pipeline {
+    unsigned depth;          // stages, which name it in the output
+    bool forwarding;         // results reach the next instructions early
+    unsigned load_use;       // with forwarding, the instructions after a load that may stall
+    int hazard_distance;     // reads of a register written that many instructions before or less stall
+    unsigned branch_penalty; // cycles lost on each mispredicted branch
+    unsigned store_window;   // instructions after a store that may find it not yet written
+  };
+  std::vector<Pipeline> pipelines;
+  unsigned max_load_use = 0; // of all pipelines
   // Wait for previous instruction to complete its data read/write
-  std::vector<unsigned int> number_of_data_hazards;
+  std::vector<unsigned long long> number_of_data_hazards; // in each pipeline
   // Deciding on control action depends on previous instruction
-  std::vector<unsigned int> number_of_control_hazards;
-  std::deque<mips_instruction> latest_instructions;
-  const static std::set<std::pair<int, int>> instructions_dont_write;
-  const static std::set<std::pair<int, int>> branch_instructions;
-  const static std::set<std::pair<int, int>> ld_instructions;
-  std::vector<std::vector<int>> hazard_table;
+  std::vector<unsigned long long> number_of_control_hazards;
+  // Loads of the bytes of a store not yet written, in each pipeline:
+  // forwarded from it, stalled until it is written, and issued before it
+  // by a speculative pipeline, which would replay them. See
+  // CountStoreDependences().
+  std::vector<unsigned long long> store_forwards, store_stalls, ordering_violations;
+  mips_stores stores;
+  // What the hazards of an instruction depend on in every pipeline: the
+  // distance to the nearest write of the registers whose reads would be
+  // data or control hazards, and how many instructions back the last
+  // load is. INT_MAX and UINT_MAX stand for none.
+  struct Dependence {
+    int data = INT_MAX, control = INT_MAX;
+    unsigned load = UINT_MAX;
+  };
+  // The last kNumberOfStoredInstructions instructions but NOPs, latest
+  // first, in a ring.
+  struct InstructionHistory {
+    mips_instruction ring[kNumberOfStoredInstructions];
+    unsigned first = 0, n = 0;
+
+    unsigned size() const { return n; }
+    mips_instruction& operator[](unsigned i) { return ring[(first + i) % kNumberOfStoredInstructions]; }
+    void push_front(const mips_instruction& inst) { // the oldest one leaves when full
+      first = (first + kNumberOfStoredInstructions - 1) % kNumberOfStoredInstructions;
+      ring[first] = inst;
+      if (n < kNumberOfStoredInstructions)
+        n++;
+    }
+    void resize(unsigned size) { n = size; }
+  };
+  InstructionHistory latest_instructions;
+  // Opcode and function (0 but for R-type instructions) of instructions.
+  struct OpFunc {
+    int op, func;
+  };
+  static constexpr OpFunc instructions_dont_write[] = {
+    { 0, 0x8 },  // jr
+    { 0, 0x0C }, // syscall
+    { 0, 0x0D }, // break
+    { 0x04, 0 }, // beq
+    { 0x05, 0 }, // bne
+    { 0x06, 0 }, // blez
+    { 0x07, 0 }, // bgtz
+    { 0x01, 0 }, // bltz, bgez
+    { 0x28, 0 }, // sb
+    { 0x29, 0 }, // sh
+    { 0x2B, 0 }, // sw
+    { 0x39, 0 }  // swc1
+    // bltzal, bgezal
+  };
+  static constexpr OpFunc branch_instructions[] = {
+    { 0x04, 0 }, // beq
+    { 0x05, 0 }, // bne
+    { 0x06, 0 }, // blez
+    { 0x07, 0 }, // bgtz
+    { 0x01, 0 }  // bltz, bgez
+    // bltzal, bgezal
+  };
+  static constexpr OpFunc ld_instructions[] = {
+    { 0x20, 0 }, // lb
+    { 0x24, 0 }, // lbu
+    { 0x21, 0 }, // lh
+    { 0x25, 0 }, // lhu
+    { 0x23, 0 }, // lw
+    { 0x30, 0 }  // ll
+    // { 0x31, 0 }  // lwc1
+  };
 
+  // Stamp() of the last write of each register, hi and lo last. Stamps
+  // do not advance on the NOPs the simulator inserts: read_hazard() moves
+  // nop_stamps instead, as if all of last_write moved.
   std::vector<int> last_write;
+  // Stamps wrap around at 4G, but only their differences matter.
+  unsigned long long nop_stamps = 0;
+  unsigned int Stamp() const { return number_of_instructions - nop_stamps; }
 
   // Cache-related.
   struct CacheConfiguration {
+    d4context* context; // NULL for the default one
     d4cache* memory;
     d4cache* l2_cache;
     d4cache* instruction_l1_cache;
     d4cache* data_l1_cache;
     int l1_hit_latency;
     int miss_penalty;
+    // Energy of each event, in pJ: an L1 access that hits or misses, the
+    // same in the L2, a memory access and, on top of it, a block written
+    // back to memory. See GetCacheEnergy().
+    double l1_hit_energy, l1_miss_energy, l2_hit_energy, l2_miss_energy, memory_energy, writeback_energy;
+    bool energy_extrapolated; // then extrapolated_energy is reported
+    struct CacheEnergy {
+      double l1, l2, memory;
+      double total() const { return l1 + l2 + memory; }
+    } extrapolated_energy;
+    // The L1s of each core, the first two above; see AddCore().
+    std::vector<d4cache*> instruction_l1_caches, data_l1_caches;
+    mips_coherence coherence;
+    // Sub-block of the last fetch from each instruction L1, or kNoFetch.
+    // Only fetches reach those caches, so with demand fetch the next one
+    // to that sub-block hits without changing anything but the count, and
+    // is not given to Dinero IV. See SetUpFetchCoalescing().
+    bool coalesce_fetches;
+    d4addr fetch_mask;
+    std::vector<d4addr> last_fetches;
+    // Classification of the L1 misses; see SetUpClassification().
+    mips_3c instruction_3c, data_3c;
+    // Victim caches, write buffer and inclusion between the L1s and the
+    // L2, if any option set them; see SetUpStages().
+    std::shared_ptr<mips_stages> stages;
+    // Timing of the main memory, if an option set it; see SetUpDram().
+    std::shared_ptr<mips_dram> dram;
+    // Contention of the processors below their L1s, if an option set it;
+    // see SetUpContention().
+    std::shared_ptr<mips_contention> contention;
+  };
+  static constexpr d4addr kNoFetch = ~d4addr(0); // never a sub-block of 4 bytes or more
+  std::vector<CacheConfiguration> cache_configurations; // see SetUpCaches()
+  std::string cache_configuration_lines; // those read, one per line
+  bool cache_energy = false; // some hierarchy has an -energy option
+  unsigned long long num_memory_acesses = 0;
+  // With MIPS_SWEEP_BSIZE=N, the L1 instruction and data streams also go
+  // through a single-pass simulation of every LRU cache of N-byte blocks
+  // with up to MIPS_SWEEP_SIZE bytes (default 64k) and MIPS_SWEEP_ASSOC
+  // ways (default 8). See SetUpSweep().
+  bool sweep = false;
+  mips_sweep instruction_sweep, data_sweep;
+  // With MIPS_LANES=SIZE:ASSOC[:lru|fifo|random],..., up to 16 L1
+  // instruction and data caches of MIPS_LANES_BSIZE-byte blocks (default
+  // 32) are simulated together, one lane each, whatever their sets and
+  // replacement. With a MIPS_CACHES file of no lines, they replace the
+  // hierarchies. See SetUpLanes().
+  bool lanes = false;
+  mips_lanes instruction_lanes, data_lanes;
+  // With MIPS_3C=N, the misses of the L1s of every hierarchy in one of
+  // every N sets (1 for all of them) are classified as compulsory,
+  // capacity or conflict misses. See SetUpClassification().
+  bool classify = false;
+  // With MIPS_LAYOUT=1, the instruction fetches of the first processor
+  // are kept, for the conflict misses between the functions of the
+  // program in the L1I of every hierarchy, and a link order that avoids
+  // them is written to MIPS_LAYOUT_FILE (default mips_layout.txt). See
+  // SetUpLayout() and mips_layout.H.
+  static constexpr unsigned kLayoutTop = 10;
+  mips_layout layout;
+  std::string layout_path;
+  std::vector<unsigned> layout_order;
+  std::vector<mips_layout::Result> layout_before, layout_after; // by hierarchy
+  // With MIPS_TLB=options, the fetches, loads and stores given to the
+  // hierarchies are first looked up in an instruction and a data TLB, and
+  // each miss walks the page table: walk_penalty cycles and, for each of
+  // walk_references levels, a read of the page table entry of the page
+  // from the data L1s. See SetUpTLBs().
+  bool tlbs = false;
+  mips_tlb instruction_tlb, data_tlb;
+  unsigned walk_penalty = 30, walk_references = 0;
+  d4addr walk_base = 0xfff00000;
+  // With MIPS_FETCH=options, the instruction fetches go through a loop
+  // buffer and a fetch queue, and the L1 instruction caches only see the
+  // blocks of the fetch width they read. See SetUpFetch() and mips_fetch.H.
+  mips_fetch frontend;
+  double loop_energy = 0;         // pJ of each fetch from the loop buffer
+  // With MIPS_REUSE_BSIZE=N, the reuse distances of the N-byte blocks of
+  // the L1 instruction and data streams are counted, of the fraction
+  // MIPS_REUSE_RATE of them (default 1, all), and with
+  // MIPS_REUSE_WINDOW=N the working set of every N references is written
+  // to MIPS_REUSE_FILE (default mips_reuse.csv). See SetUpReuse().
+  bool reuse = false;
+  mips_reuse instruction_reuse, data_reuse;
+  std::string reuse_path;
+  // With MIPS_COHERENCE=mesi or moesi, each processor has L1s of its own,
+  // kept coherent, instead of sharing those of the first one. See
+  // SetUpCoherence().
+  bool coherent = false;
+  std::vector<const void*> cores; // the ISA of each processor started
+  unsigned core = 0;              // index of the one running, if coherent
+  // With MIPS_CORES=file, one line per processor in the order they start,
+  // each may count the hazards of its own pipeline and the mispredictions
+  // of its own predictor, and have L1s of its own sizes and policies. See
+  // SetUpCores().
+  struct CoreConfiguration {
+    unsigned pipeline = 0;        // of pipelines
+    unsigned predictor = 0;       // of predictors
+    std::vector<std::pair<std::string, std::string>> l1_options;
+  };
+  struct CoreCounters {
+    unsigned long long instructions, data_hazards, control_hazards, mispredictions;
+  };
+  std::vector<CoreConfiguration> core_configurations;
+  std::vector<CoreCounters> core_counters; // of each processor started
+  // With MIPS_CACHE_THREAD=1, the references above are simulated by a
+  // worker thread, in batches. Everything reading the caches or the
+  // sweep calls DrainReferences() first.
+  struct CoreReference {
+    d4memref reference;
+    unsigned core;
   };
-  static constexpr int kNumCacheConfigurations = 4;
-  std::vector<CacheConfiguration> cache_configurations;
-  int num_memory_acesses = 0;
+  mips_ref_queue<CoreReference> references;
   // End of cache-related variables.
-  // superscalar
-  struct _ss {
-    bool ssLoaded = false;
-    int ssInstCount = 0;
-  } ss;
+  // With MIPS_ANALYSIS_THREAD=1, the behaviors only queue the records a
+  // trace would hold of their instructions, and a worker thread analyses
+  // them as a replay would. Everything reading the analysis from the
+  // simulation calls DrainAnalysis() first.
+  struct AnalysisEvent {
+    mips_trace::Record record;
+    unsigned core;
+  };
+  mips_ref_queue<AnalysisEvent> events;
+  AnalysisEvent event{};               // the one being filled in, if pending_event
+  bool pending_event = false;
+  static thread_local bool analyzing;  // true on the worker
+  // The last instruction Analyze() saw, for the size of later accesses.
+  mips_instruction replayed = UnpackInstruction(mips_instruction::kJ, 0);
+  bool Queued() const { return events.started() && !analyzing; }
+  // In-order issue of groups of up to width instructions a cycle, at most
+  // units[u] of them to functional unit u, with no register read or
+  // written by one and written by another. The groups are counted by
+  // size; see SetUpIssue() and testSuperscalar().
+  enum Unit { kAluUnit, kMulDivUnit, kMemoryUnit, kBranchUnit, kNumUnits };
+  struct IssueModel {
+    unsigned width;
+    unsigned units[kNumUnits];
+    // The group being filled
+    unsigned size;
+    unsigned used[kNumUnits];
+    uint64_t reads, writes;
+    std::vector<unsigned long long> groups; // of each size, 1 first
+  };
+  std::vector<IssueModel> issue_models;
+  mips_instruction current; // the one push() was given, with its registers
+  // With MIPS_OOO=options, the instructions also go through an
+  // out-of-order window. Each one is given to it at the next Fetch(),
+  // once its load, if any, has taken its latency from the hierarchy; see
+  // SetUpOutOfOrder() and SetOutOfOrderInstruction().
+  struct OutOfOrderConfig {
+    unsigned mul_latency, div_latency;
+    unsigned hierarchy;           // whose L1 data misses the loads take
+    unsigned predictor;           // whose mispredictions redirect the front end
+    unsigned branch_penalty;      // cycles lost after each misprediction
+  } ooo_config = {4, 20, 0, 0, 10};
+  struct OutOfOrderInstruction {
+    bool pending;
+    uint64_t reads, writes;
+    unsigned latency;
+    bool load, branch;
+  } ooo_next = {false, 0, 0, 0, false, false};
+  bool out_of_order = false;
+  mips_ooo ooo;
+  // With MIPS_ILP=options, they also go through a dataflow limit study,
+  // with no limit but their operands, their latency (by group) and the
+  // window, if any. Each one is given to it at the next Fetch() too,
+  // once its load or store has its address; see SetUpIlp().
+  struct IlpInstruction {
+    bool pending;
+    uint64_t reads, writes;
+    unsigned latency;
+    mips_ilp::Access access;
+    uint32_t address;
+    unsigned size;
+  } ilp_next = {false, 0, 0, 0, mips_ilp::kNone, 0, 0};
+  std::vector<unsigned> ilp_latencies; // of each group, by InstGroups
+  bool ilp = false;
+  mips_ilp dataflow;
+
+  // Profiles of the static instructions. With MIPS_PROFILE=N, each
+  // conditional branch counts its executions, how many were taken and the
+  // mispredictions of each predictor, and each load its executions, the
+  // load-use hazards it caused in each pipeline and its L1 misses in each
+  // hierarchy. The N branches and loads that cost the most are reported.
+  // MIPS_PROFILE_ENTRIES (default 4096) is how many PCs each one holds.
+  unsigned profile_top = 0;
+  mips_profile branch_profile, load_profile;
+  uint32_t last_load_pc = 0;       // of the latest load
+  std::vector<double> load_misses; // L1 misses of each hierarchy before the load
+
+  // Value prediction. With MIPS_VALUES=N, the values the loads analyzed
+  // load are given to a last-value, a stride and a context predictor, of
+  // N load PCs and MIPS_VALUES_CONTEXT contexts (default 4N), and their
+  // coverage and accuracy are reported. See SetUpValues() and
+  // mips_values.H.
+  mips_values values;
+
+  // Hot spots. With MIPS_HOTSPOTS=N, the call stack is sampled every N
+  // instructions analyzed, weighted with the N instructions or, with
+  // MIPS_OOO, the cycles of the window since the last sample. The stacks
+  // are written to MIPS_HOTSPOTS_FILE (default mips_hotspots.folded) for
+  // flame graphs, and the functions with the most weight are reported.
+  static constexpr unsigned kHotSpotsTop = 20;
+  mips_hotspots hot_spots;
+  std::string hot_spots_path;
+  uint64_t hot_spots_cycles = 0; // of the window at the last sample
+
+  // Hot loops. With MIPS_LOOPS=N, the loops closed by the branches back
+  // of the instructions analyzed are counted, with their trip counts and
+  // the L1 misses of the first hierarchy and mispredictions of the first
+  // predictor each iteration. The N of the most instructions are
+  // reported, and all of them written to MIPS_LOOPS_FILE (default
+  // mips_loops.txt) as a profile of their headers. See mips_loops.H.
+  unsigned loops_top = 0;
+  mips_loops loops;
+  std::string loops_path;
+
+  // Basic block vectors. With MIPS_BBV=N, the instructions analyzed in
+  // each basic block are counted over intervals of N of them, and written
+  // to MIPS_BBV_FILE (default mips.bb) for SimPoint; see mips_bbv.H.
+  mips_bbv bbv;
+
+  // Sampled simulation. Every period instructions, a fast-forward interval
+  // with no analysis is followed by a warm-up window, whose counts are
+  // dropped, and by a measurement window. Set MIPS_SAMPLE_PERIOD (and
+  // optionally MIPS_SAMPLE_WARMUP, MIPS_SAMPLE_MEASURE) to turn it on.
+  // MIPS_SAMPLE_WARM_CACHES=1 keeps the caches updated while fast-forwarding,
+  // which removes the cold-cache bias of short warm-ups at some speed cost.
+  bool analyze = true; // false while no statistics are being gathered
+  bool warm = true;    // false while the caches are not updated either
+
+  // Region of interest. MIPS_SKIP=N runs the first N instructions without
+  // any analysis, and guest code may start and stop it with a syscall
+  // instruction whose $v0 is kRoiBegin or kRoiEnd. With MIPS_ROI=1 the
+  // analysis waits for the first kRoiBegin.
+  static constexpr unsigned kRoiBegin = 0xAC01, kRoiEnd = 0xAC02;
+  bool in_roi = true;
+  bool skipping = false;
+  unsigned long long skip = 0; // instructions left to skip
+
+  // Warm state. With MIPS_WARM_OUT=file, the contents of the caches of
+  // every hierarchy, the tables of the branch predictors, the BTB and the
+  // RAS, and the window of last_write are written to file once
+  // MIPS_WARM_AT instructions have been analyzed, at the first kRoiBegin
+  // if it is "roi", or at the end. MIPS_WARM_IN=file loads them when the
+  // analysis first starts (at once, after MIPS_SKIP, or at the first
+  // kRoiBegin with MIPS_ROI=1), so that the measurement starts with warm
+  // caches and trained predictors. No counter is kept, nor anything of
+  // the stages between the L1s and the L2; see SaveWarmState().
+  std::string warm_out, warm_in;
+  unsigned long long warm_at = 0; // analyzed instructions, 0 if not counted
+  bool warm_at_roi = false;
+
+  // With MIPS_TRACE=file, everything the analysis is given above is also
+  // written to a trace, and MIPS_REPLAY=file runs the analysis from one
+  // instead of simulating the program. Sampling and skipping are applied
+  // again when replaying, so their settings may change between runs.
+  mips_trace_writer* trace = nullptr;
+
+  // With MIPS_BRANCH_TRACE=file, every branch and jump resolved is also
+  // written to a branch trace, for mips_branch_replay to run other
+  // predictors over without simulating the program.
+  mips_branch_trace_writer* branch_trace = nullptr;
+
+  // With MIPS_FORK=file, the simulation forks once the region of interest
+  // is first entered, one child per line of file: NAME [VAR=value...]. The
+  // children share the guest memory until they write to it, apply their
+  // variables and re-read the settings above from them (not MIPS_SKIP and
+  // MIPS_ROI, which have already been used), and write their output to
+  // NAME.out and NAME.err. MIPS_FORK_JOBS bounds how many run at once.
+  struct Experiment {
+    std::string name;
+    std::vector<std::string> env;
+  };
+  std::vector<Experiment> experiments;
+  bool fork_pending = false;
+  struct Sampling {
+    enum Phase { kFastForward, kWarmUp, kMeasure };
+    bool enabled = false;
+    bool warm_caches = false;
+    Phase phase = kMeasure;
+    unsigned long long period = 0, warmup = 2000, measure = 1000;
+    unsigned long long left = 0;  // instructions left in the current phase
+    unsigned long long total = 0; // instructions seen in every phase
+    unsigned long long windows = 0;
+    std::vector<double> start;    // metrics when the current window began
+    std::vector<double> sum, sum_sq; // of the per-instruction rates, weighted
+    double weights = 0, weights_sq = 0; // of the windows, see EndWindow()
+    // With MIPS_SAMPLE_TARGET_MIPS, the period adapts, see AdaptPeriod().
+    double target = 0;            // host instructions per second, 0 for a fixed period
+    unsigned long long current = 0; // length of the period in progress
+    unsigned long long max_period = 0, shortest = 0, longest = 0;
+    unsigned long long detailed = 0; // instructions warmed up or measured
+    double fast_cost = 0, detailed_cost = 0; // host seconds per instruction, smoothed
+    double phase_start = 0, fast_seconds = 0, seconds = 0; // host time of the periods
+  } sampling;
+  static constexpr int kNumConfigurationMetrics = 9;
+  static constexpr int kNumEnergyMetrics = 3; // of each hierarchy, with cache_energy
+  int NumGeneralMetrics() const { // five per pipeline, one per predictor, width per issue model
+    int n = 8 + 5 * pipelines.size() + predictors.size() + (out_of_order ? 2 + mips_ooo::kNumStalls : 0) +
+            (ilp ? mips_ilp::kNumCounters : 0);
+    for (const IssueModel& m : issue_models)
+      n += m.width;
+    return n;
+  }
+  int NumPrintedMetrics() const { // those Extrapolate() prints
+    return NumGeneralMetrics() + (kNumConfigurationMetrics + (cache_energy ? kNumEnergyMetrics : 0)) *
+                                 cache_configurations.size();
+  }
+  int NumMetrics() const { // see GetMetrics()
+    int n = NumPrintedMetrics() + (sweep ? instruction_sweep.counts().size() + data_sweep.counts().size() : 0) +
+            (lanes ? instruction_lanes.counts().size() + data_lanes.counts().size() : 0);
+    for (const CacheConfiguration& c : cache_configurations)
+      n += (c.stages ? mips_stages::kNumCounters : 0) + (c.dram ? mips_dram::kNumCounters : 0) +
+           (c.contention ? mips_contention::kNumCounters : 0);
+    return n + (tlbs ? 2 * mips_tlb::kNumCounters : 0) + (reuse ? 2 * mips_reuse::kNumCounters : 0) +
+           (frontend.enabled() ? mips_fetch::kNumCounters : 0) + (values.enabled() ? mips_values::kNumCounters : 0);
+  }
+
+  // Interval statistics. With MIPS_INTERVAL=N, the counters Extrapolate()
+  // prints are saved every N instructions analyzed, in a buffer of
+  // MIPS_INTERVAL_LIMIT snapshots (default 10000) allocated beforehand,
+  // and the counts of each interval are written to MIPS_INTERVAL_FILE
+  // (default mips_intervals.csv) at exit.
+  struct Intervals {
+    unsigned long long length = 0; // 0 when off
+    unsigned long long left = 0;   // instructions left in the current interval
+    unsigned long long limit = 10000;
+    unsigned long long count = 0;  // intervals saved
+    std::string path;
+    std::vector<double> snapshots; // rows of NumPrintedMetrics(), the start first
+    std::vector<double> metrics;   // scratch for GetMetrics()
+  } intervals;
+
+  // Live gauges, for the statistics server. While --stats-listen serves
+  // the counters, every MIPS_LIVE_INTERVAL instructions analyzed (default
+  // 10000000) the CPI that EstimateCycles() gives the first pipeline,
+  // predictor and hierarchy over them is saved, with the miss rates of
+  // the caches of that hierarchy, every core's L1s together.
+  struct Live {
+    enum { kL1I, kL1D, kL2, kNumCaches };
+    unsigned long long length = 0; // 0 when off
+    unsigned long long left = 0;
+    double cycles = 0, instructions = 0;                      // at the start of the interval
+    double accesses[kNumCaches] = {}, misses[kNumCaches] = {};
+    double cpi = 0, miss_rates[kNumCaches] = {};              // of the last interval
+  } live;
+
+  // Convergence. With MIPS_CONVERGE=N, the CPI and miss rates of the live
+  // gauges are taken every N instructions analyzed. Once none of them has
+  // moved by more than MIPS_CONVERGE_TOLERANCE (default 0.01) of its mean
+  // over the last MIPS_CONVERGE_WINDOW intervals (default 5), the
+  // analysis stops as at the end of the region of interest, and with
+  // MIPS_CONVERGE_STOP=run so does the simulation. A miss rate under
+  // kConvergeFloor is taken as that much, so caches that hardly miss do
+  // not hold the others back.
+  static constexpr double kConvergeFloor = 0.01;
+  struct Convergence {
+    static constexpr int kNumRates = 1 + Live::kNumCaches; // the CPI first
+    Live rates;                    // of the last interval
+    unsigned window = 5;
+    double tolerance = 0.01;
+    bool stop_run = false;
+    bool converged = false;
+    unsigned long long intervals = 0;
+    unsigned long long at = 0;     // instructions analyzed when converged
+    std::vector<double> history;   // kNumRates per interval, the last window of them in a ring
+    double means[kNumRates] = {};  // over the window, when converged
+  } convergence;
+
+  // Parallel intervals. With MIPS_PARALLEL=N, the region of interest runs
+  // without analysis, and a child is forked to analyze each interval of N
+  // instructions, after a warm-up of the MIPS_PARALLEL_WARMUP (default
+  // 100000) before it, whose counts are dropped. The fork is the
+  // checkpoint: the child shares the guest memory until it writes to it.
+  // At most MIPS_PARALLEL_JOBS (default one per host core) run at once.
+  // At exit the counters of the intervals are added up into the report,
+  // and written one row each to MIPS_PARALLEL_FILE (default
+  // mips_parallel.csv). The analysis starts cold in each child, so the
+  // totals differ from those of a sequential run by what the warm-up
+  // leaves out.
+  struct Parallel {
+    unsigned long long length = 0;    // 0 when off
+    unsigned long long warmup = 100000;
+    unsigned long long seen = 0;      // instructions of the region of interest
+    unsigned jobs = 1;
+    unsigned failed = 0;
+    std::string path;
+    std::vector<double*> results;     // shared with the child of each interval
+    // In a child: the counters when the measurement began, and the
+    // instructions left in its phase.
+    bool child = false;
+    bool measuring = false;
+    double* result = nullptr;
+    unsigned long long left = 0;
+    std::vector<double> start;
+  } parallel;
 
   static constexpr int Rd=1, Rs=2, Rt=4, Rm=8;
   enum InstGroups {ArithLog, DivMult, Shift, ShiftV, JumpR, MoveFrom, MoveTo,
@@ -166,402 +765,423 @@ struct variables {
     {Branch, Rs|Rt, 0, {{0x4,0},{0x5,0}}},
     {BranchZ, Rs, 0, {{0x7,0},{0x6,0}}},
     {LoadStore, Rs|Rt, Rs|Rt, {{0x20,0},{0x24,0},{0x21,0},{0x25,0},{0x23,0},
-        {0x28,0},{0x29,0},{0x2b,0}}},
+        {0x28,0},{0x29,0},{0x2b,0},{0x30,0},{0x38,0}}},
     {Jump, 0, 0, {{0x2,0},{0x3,0}}},
     {Trap, 0, 0, {{0x1a,0}}}
   };
 
-  std::set<int> getRegs(const mips_instruction &i, int regs) {
-    std::set<int> S;
+  // What the lists above say of each opcode and function, indexed by
+  // op << 6 | func, so that every instruction is classified with one
+  // look-up. Filled by the constructor.
+  struct OpClass {
+    const IGroup* group = nullptr; // the last one listing it
+    bool dont_write = false, branch = false, load = false;
+    int unit = -1; // functional unit of the group, -1 to issue alone
+  };
+  OpClass op_classes[64 * 64];
+
+  OpClass& Classify(int op, int func) { return op_classes[op << 6 | func]; }
+  const OpClass& Classify(const mips_instruction& i) const { return op_classes[i.op << 6 | i.func]; }
+
+  // The registers of i in regs, as in mips_instruction::reads. The groups
+  // do not tell hi from lo, so Rm stands for both.
+  static uint64_t getRegs(const mips_instruction &i, int regs) {
+    uint64_t S = 0;
     if (regs&Rs)
-      S.insert(i.rs);
+      S |= 1ULL << i.rs;
     if (regs&Rt)
-      S.insert(i.rt);
+      S |= 1ULL << i.rt;
     if (regs&Rd)
-      S.insert(i.rd);
+      S |= 1ULL << i.rd;
+    if (regs&Rm)
+      S |= 3ULL << 32;
     return S;
   }
-  
-  bool setHasIntersec(const std::set<int> &A, const std::set<int> &B) {
-    for (const int &a : A)
-      for (const int &b : B)
-        if (a==b)
-          return true;
-    return false;
+
+  static int GetUnit(InstGroups g) {
+    switch (g) {
+    case DivMult: case MoveFrom: case MoveTo:
+      return kMulDivUnit;
+    case LoadStore:
+      return kMemoryUnit;
+    case JumpR: case Branch: case BranchZ: case Jump:
+      return kBranchUnit;
+    case Trap:
+      return -1;
+    default:
+      return kAluUnit;
+    }
   }
 
+  // Issues the instruction push() was given in every issue model.
   void testSuperscalar() { // must be called after push
-    if (latest_instructions.size() < 2)
-      return;
-    if (!ss.ssLoaded) {
-      mips_instruction &i_prev = latest_instructions[1];
-      mips_instruction &i_cur = latest_instructions[0];
-
-      const IGroup *g_prev=nullptr, *g_cur=nullptr;
-      for (const IGroup &g : groups) { // search prev and cur inst groups
-        if (g.instOp.count(std::make_pair(i_prev.op, i_prev.func)))
-          g_prev = &g;
-        if (g.instOp.count(std::make_pair(i_cur.op, i_cur.func)))
-          g_cur = &g;
-      }
-      if (!g_prev || !g_cur)
-        return; // error, shouldnt happen. just in case.
-      if (g_prev->igroup == g_cur->igroup && g_cur->igroup != ArithLog &&
-            g_cur->igroup != ArithLogI) // same group, abort, except arith ops
-        return;
-      if ((g_prev->readFrom & g_cur->writeTo & Rm) ||
-            (g_prev->writeTo & g_cur->readFrom & Rm) ||
-             (g_prev->writeTo & g_cur->writeTo & Rm)) 
-        return ; // conflict in special multiplier registers
-
-      // get register values for cur and prev instruction, read and write registers
-      std::set<int> rd_prev = getRegs(i_prev, g_prev->readFrom);
-      std::set<int> wr_prev = getRegs(i_prev, g_prev->writeTo);
-      std::set<int> rd_cur = getRegs(i_cur, g_cur->readFrom);
-      std::set<int> wr_cur = getRegs(i_cur, g_cur->writeTo);
-      // if any conflict, abort: r-w, r-w, w-w => return
-      if (setHasIntersec(rd_prev, wr_cur)||
-          setHasIntersec(rd_cur, wr_prev)||
-          setHasIntersec(wr_prev, wr_cur))
-        return;
-      
-      // if no conflict so far, set bool and increment
-      ss.ssLoaded = true;
-      ss.ssInstCount++;
+    if (!kSuperscalar || !analyze || Queued())
+      return;
+    int unit = Classify(current).unit;
+    uint64_t reads = current.reads & ~1ULL, writes = current.writes & ~1ULL; // $zero never conflicts
+
+    for (IssueModel& m : issue_models) {
+      if (m.size && (m.size == m.width || unit < 0 || m.used[unit] == m.units[unit] ||
+                     (reads & m.writes) || (writes & (m.reads | m.writes))))
+        EndIssueGroup(m);
+      m.size++;
+      m.reads |= reads;
+      m.writes |= writes;
+      if (unit < 0) // issues alone
+        EndIssueGroup(m);
+      else
+        m.used[unit]++;
     }
-    else
-      ss.ssLoaded = false;
+  }
+
+  static void EndIssueGroup(IssueModel& m) {
+    m.groups[m.size - 1]++;
+    m.size = 0;
+    std::fill(m.used, m.used + kNumUnits, 0);
+    m.reads = m.writes = 0;
   }
 
   variables() :
     number_of_instructions(0),
     number_of_nops(0),
-    static_wrong_predictions(0),
-    saturating_wrong_predictions(0),
-    total_number_of_branches(0),
-    two_level_history(0),
-    saturating_stage(kNumberOfStages),
-    cache_configurations(kNumCacheConfigurations) {
-    // kNumberOfStages is the first 'taken' value, as the stage range
-    // is [0, 2 * kNumberOfStages). This initial value is arbitrary.
-    two_level_stages.resize(1 << kHistoryDepth, (int) kNumberOfStages);
+    total_number_of_branches(0) {
     last_write.resize(34);
-    number_of_data_hazards.resize(3, 0);
-    number_of_control_hazards.resize(3, 0);
-    // Processors
-    // 5 Stages -> MIPS R2000 -> branch misprediction penalty = 1 cycle
-    // 7 Stages -> MIPS R10000 -> branch misprediction penalty = 5 cycles
-    // 13 Stages -> ARM Cortex A8 -> branch misprediction penalty = 13 cycles
-    hazard_table = { {2, 1, 1}, {1, 3, 4} };
-    // Cache initialization.
-    for (auto& cache_configuration : cache_configurations) {
-      cache_configuration.memory = d4new(NULL);
-      cache_configuration.l2_cache = d4new(cache_configuration.memory);
-      cache_configuration.instruction_l1_cache = d4new(cache_configuration.l2_cache);
-      cache_configuration.data_l1_cache = d4new(cache_configuration.l2_cache);
-
-      cache_configuration.l2_cache->lg2blocksize = 4;
-      cache_configuration.l2_cache->lg2subblocksize = 4;
-      cache_configuration.l2_cache->lg2size = 22;
-      cache_configuration.l2_cache->assoc = 1;
-      cache_configuration.l2_cache->replacementf = d4rep_lru;
-      cache_configuration.l2_cache->prefetchf = d4prefetch_none;
-      cache_configuration.l2_cache->wallocf = d4walloc_always;
-      cache_configuration.l2_cache->wbackf = d4wback_always;
-      cache_configuration.l2_cache->name_replacement = stupid_useless_placeholder;
-      cache_configuration.l2_cache->name_prefetch = stupid_useless_placeholder;
-      cache_configuration.l2_cache->name_walloc = stupid_useless_placeholder;
-      cache_configuration.l2_cache->name_wback = stupid_useless_placeholder;
-
-      cache_configuration.instruction_l1_cache->lg2blocksize = 4;
-      cache_configuration.instruction_l1_cache->lg2subblocksize = 4;
-      cache_configuration.instruction_l1_cache->lg2size = 15;
-      cache_configuration.instruction_l1_cache->assoc = 1;
-      cache_configuration.instruction_l1_cache->replacementf = d4rep_lru;
-      cache_configuration.instruction_l1_cache->prefetchf = d4prefetch_none;
-      cache_configuration.instruction_l1_cache->wallocf = d4walloc_always;
-      cache_configuration.instruction_l1_cache->wbackf = d4wback_always;
-      cache_configuration.instruction_l1_cache->name_replacement = stupid_useless_placeholder;
-      cache_configuration.instruction_l1_cache->name_prefetch = stupid_useless_placeholder;
-      cache_configuration.instruction_l1_cache->name_walloc = stupid_useless_placeholder;
-      cache_configuration.instruction_l1_cache->name_wback = stupid_useless_placeholder;
-
-      cache_configuration.data_l1_cache->lg2blocksize = 4;
-      cache_configuration.data_l1_cache->lg2subblocksize = 4;
-      cache_configuration.data_l1_cache->lg2size = 15;
-      cache_configuration.data_l1_cache->assoc = 1;
-      cache_configuration.data_l1_cache->replacementf = d4rep_lru;
-      cache_configuration.data_l1_cache->prefetchf = d4prefetch_none;
-      cache_configuration.data_l1_cache->wallocf = d4walloc_always;
-      cache_configuration.data_l1_cache->wbackf = d4wback_always;
-      cache_configuration.data_l1_cache->name_replacement = stupid_useless_placeholder;
-      cache_configuration.data_l1_cache->name_prefetch = stupid_useless_placeholder;
-      cache_configuration.data_l1_cache->name_walloc = stupid_useless_placeholder;
-      cache_configuration.data_l1_cache->name_wback = stupid_useless_placeholder;
-    }
-    
-    // Cache configuration #0
-    cache_configurations[0].l2_cache->lg2blocksize = 4;
-    cache_configurations[0].l2_cache->lg2subblocksize = 4;
-    cache_configurations[0].l2_cache->lg2size = 20;
-    cache_configurations[0].l2_cache->assoc = 2;
-    cache_configurations[0].instruction_l1_cache->lg2blocksize = 4;
-    cache_configurations[0].instruction_l1_cache->lg2subblocksize = 4;
-    cache_configurations[0].instruction_l1_cache->lg2size = 15;
-    cache_configurations[0].instruction_l1_cache->assoc = 2;
-    cache_configurations[0].data_l1_cache->lg2blocksize = 4;
-    cache_configurations[0].data_l1_cache->lg2subblocksize = 4;
-    cache_configurations[0].data_l1_cache->lg2size = 15;
-    cache_configurations[0].data_l1_cache->assoc = 2;
-    cache_configurations[0].l1_hit_latency = 4;
-    cache_configurations[0].miss_penalty = 30;
-
-    // Cache configuration #1
-    cache_configurations[1].l2_cache->lg2blocksize = 4;
-    cache_configurations[1].l2_cache->lg2subblocksize = 4;
-    cache_configurations[1].l2_cache->lg2size = 22;
-    cache_configurations[1].l2_cache->assoc = 2;
-    cache_configurations[1].instruction_l1_cache->lg2blocksize = 4;
-    cache_configurations[1].instruction_l1_cache->lg2subblocksize = 4;
-    cache_configurations[1].instruction_l1_cache->lg2size = 15;
-    cache_configurations[1].instruction_l1_cache->assoc = 2;
-    cache_configurations[1].data_l1_cache->lg2blocksize = 4;
-    cache_configurations[1].data_l1_cache->lg2subblocksize = 4;
-    cache_configurations[1].data_l1_cache->lg2size = 15;
-    cache_configurations[1].data_l1_cache->assoc = 2;
-    cache_configurations[1].l1_hit_latency = 4;
-    cache_configurations[1].miss_penalty = 30;
-
-    // Cache configuration #2
-    cache_configurations[2].l2_cache->lg2blocksize = 4;
-    cache_configurations[2].l2_cache->lg2subblocksize = 4;
-    cache_configurations[2].l2_cache->lg2size = 20;
-    cache_configurations[2].l2_cache->assoc = 2;
-    cache_configurations[2].instruction_l1_cache->lg2blocksize = 4;
-    cache_configurations[2].instruction_l1_cache->lg2subblocksize = 4;
-    cache_configurations[2].instruction_l1_cache->lg2size = 16;
-    cache_configurations[2].instruction_l1_cache->assoc = 2;
-    cache_configurations[2].data_l1_cache->lg2blocksize = 4;
-    cache_configurations[2].data_l1_cache->lg2subblocksize = 4;
-    cache_configurations[2].data_l1_cache->lg2size = 16;
-    cache_configurations[2].data_l1_cache->assoc = 2;
-    cache_configurations[2].l1_hit_latency = 13;
-    cache_configurations[2].miss_penalty = 30;
-
-    // Cache configuration #3
-    cache_configurations[3].l2_cache->lg2blocksize = 4;
-    cache_configurations[3].l2_cache->lg2subblocksize = 4;
-    cache_configurations[3].l2_cache->lg2size = 22;
-    cache_configurations[3].l2_cache->assoc = 2;
-    cache_configurations[3].instruction_l1_cache->lg2blocksize = 4;
-    cache_configurations[3].instruction_l1_cache->lg2subblocksize = 4;
-    cache_configurations[3].instruction_l1_cache->lg2size = 16;
-    cache_configurations[3].instruction_l1_cache->assoc = 2;
-    cache_configurations[3].data_l1_cache->lg2blocksize = 4;
-    cache_configurations[3].data_l1_cache->lg2subblocksize = 4;
-    cache_configurations[3].data_l1_cache->lg2size = 16;
-    cache_configurations[3].data_l1_cache->assoc = 2;
-    cache_configurations[3].l1_hit_latency = 13;
-    cache_configurations[3].miss_penalty = 30;
-
-    int cache_setup_error{d4setup()};
-    if (cache_setup_error) {
-      std::cerr << "Error on cache setup. I'm calling std::exit(EXIT_FAILURE).\n";
-      std::exit(EXIT_FAILURE);
-    }
-    // End of cache initialization.
+    for (const IGroup& g : groups)
+      for (const std::pair<int, int>& o : g.instOp) {
+        Classify(o.first, o.second).group = &g;
+        Classify(o.first, o.second).unit = GetUnit(g.igroup);
+      }
+    for (const OpFunc& o : instructions_dont_write)
+      Classify(o.op, o.func).dont_write = true;
+    for (const OpFunc& o : branch_instructions)
+      Classify(o.op, o.func).branch = true;
+    for (const OpFunc& o : ld_instructions)
+      Classify(o.op, o.func).load = true;
   }
 
   void push(mips_instruction inst) {
+    if (!kAnyAnalysis)
+      return;
+    AC_HOST_PHASE(AC_PHASE_ANALYSIS);
+    if (Queued()) {
+      event.record.format = inst.type;
+      event.record.word = PackInstruction(inst);
+      return;
+    }
+    if (trace)
+      trace->decoded(inst.type, PackInstruction(inst));
+    if (!analyze)
+      return;
+    inst.no_write = inst.op == 0 && inst.rs == 0 && inst.rt == 0 && inst.func == 0 && inst.imm == 0;
+    inst.nop = inst.no_write && inst.rd == 0;
     // Check for hazards
-    read_hazard(inst, k5);
-    read_hazard(inst, k7);
-    read_hazard(inst, k13);
+    read_hazard(inst);
     write_hazard(inst);
-    int taken = actual_branch_taken(inst);
-    // Verifies that 'inst' is a branch instruction and maps 'taken' into a bool
-    if (taken--) {
-      static_branch_prediction(taken, inst);
-      saturating_branch_prediction(taken);
-      two_level_branch_predictor(taken);
+    if (load_profile.enabled() && Classify(inst).load) {
+      last_load_pc = fetch_pc;
+      if (unsigned long long* counts = load_profile.counts(fetch_pc))
+        counts[0]++;
     }
+    if (kBranches)
+      SetPendingBranch(inst);
     // std::cout << inst << std::endl;
-    latest_instructions.push_front(inst);
-    // Remove NOP from latest_instructions
-    if (inst.op == 0 && inst.rs == 0 && inst.rt == 0 && inst.rd == 0 && inst.func == 0 && inst.imm == 0) {
-      latest_instructions.pop_front();
-    }
-    if (latest_instructions.size() > kNumberOfStoredInstructions) {
-      latest_instructions.pop_back();
+    if (!kHazards && !kSuperscalar && !kOutOfOrder)
+      return;
+    inst.reads = inst.writes = 0;
+    if (const IGroup* g = Classify(inst).group) {
+      inst.reads = getRegs(inst, g->readFrom);
+      inst.writes = getRegs(inst, g->writeTo);
     }
+    current = inst;
+    if (kOutOfOrder && out_of_order)
+      SetOutOfOrderInstruction(inst);
+    if (kOutOfOrder && ilp)
+      SetIlpInstruction(inst);
+    // NOPs are left out of latest_instructions
+    if (inst.nop)
+      return;
+    latest_instructions.push_front(inst);
   }
 
-  void write_hazard(mips_instruction inst) {
-    if (inst.type == mips_instruction::kJ ||
-        instructions_dont_write.find(std::make_pair(inst.op, inst.func)) != instructions_dont_write.end() ||
-        (inst.op == 0 && inst.rs == 0 && inst.rt == 0 && inst.func == 0 && inst.imm == 0)) {
+  void write_hazard(const mips_instruction& inst) {
+    if (!kHazards || inst.type == mips_instruction::kJ || inst.no_write ||
+        Classify(inst).dont_write) {
       return;
     }
     // mult, multu, div, divu
     if (inst.func == 0x18 || inst.func == 0x19 || inst.func == 0x1A || inst.func == 0x1B) {
-      last_write[32] = last_write[33] = number_of_instructions;
+      last_write[32] = last_write[33] = Stamp();
     } else if (inst.func == 0x11) { // mthi
-      last_write[32] = number_of_instructions;
+      last_write[32] = Stamp();
     } else if (inst.func == 0x13) { // mtlo
-      last_write[33] = number_of_instructions;
+      last_write[33] = Stamp();
     } else if (inst.type == mips_instruction::kR) { // R-type
-      last_write[inst.rd] = number_of_instructions;
+      last_write[inst.rd] = Stamp();
     } else { // I-type
-      last_write[inst.rt] = number_of_instructions;
+      last_write[inst.rt] = Stamp();
     }
   }
 
-  void read_hazard(mips_instruction inst, pipeline_stages pipeline_stage) {
-    bool load = false;
-    // NOP
-    if (inst.op == 0 && inst.rs == 0 && inst.rt == 0 && inst.rd == 0 && inst.func == 0 && inst.imm == 0) {
-      if (pipeline_stage == k5) {
-        number_of_nops++;
-      }
+  // Counts the hazards of inst in every pipeline.
+  void read_hazard(const mips_instruction& inst) {
+    if (inst.nop) {
+      number_of_nops++;
       // Update time stamp to ignore any NOP inserted by the simulator
-      for (int i = 0; i < last_write.size(); i++) {
-        last_write[i]++;
-      }
+      nop_stamps++;
       return;
     }
-    // Check if the last instruction was a load
-    if (latest_instructions.size() > 0 &&
-         ld_instructions.find(std::make_pair(latest_instructions[0].op, latest_instructions[0].func)) != ld_instructions.end()) {
-      // When we consider fowarding, the only possibility of hazard is in the instruction that comes right after a load
-      // std::cout << latest_instructions[0] << std::endl;
-      // std::cout << inst << std::endl;
-      load = true;
-    } else if (latest_instructions.size() > 1 && pipeline_stage != k5 &&
-         ld_instructions.find(std::make_pair(latest_instructions[1].op, latest_instructions[1].func)) != ld_instructions.end()) {
-      load = true;
-    } else if (latest_instructions.size() > 2 && pipeline_stage == k13 &&
-         ld_instructions.find(std::make_pair(latest_instructions[2].op, latest_instructions[2].func)) != ld_instructions.end()) {
-      load = true;
+    if (!kHazards)
+      return;
+    Dependence d = GetDependence(inst);
+    unsigned long long* load = nullptr; // profile of the latest load
+    for (unsigned p = 0; p < pipelines.size(); p++) {
+      const Pipeline& pipeline = pipelines[p];
+      // When we consider fowarding, the only possibility of hazard is in the instructions that come right after a load
+      if (pipeline.forwarding && d.load > pipeline.load_use)
+        continue;
+      number_of_data_hazards[p] += d.data <= pipeline.hazard_distance;
+      number_of_control_hazards[p] += d.control <= pipeline.hazard_distance;
+      if (!core_counters.empty() && p == core_configurations[core].pipeline) {
+        core_counters[core].data_hazards += d.data <= pipeline.hazard_distance;
+        core_counters[core].control_hazards += d.control <= pipeline.hazard_distance;
+      }
+      if (load_profile.enabled() && d.data <= pipeline.hazard_distance && d.load <= pipeline.load_use &&
+          (load || (load = load_profile.find(last_load_pc))))
+        load[1 + p]++;
     }
-    if (is_fowarding == true && load == false) { // The last instruction was not a load
-      // There are no hazards associated with R-type instructions when we consider fowarding
+  }
+
+  // Counts the dependences of a load of size bytes at address on the
+  // latest store to its word, if it may not be written yet in a
+  // pipeline. The pipeline forwards the store's data if it forwards and
+  // the store wrote every byte the load reads, and stalls the load until
+  // the store is written otherwise. A store within the hazard distance
+  // has its address known too late for a pipeline that issues loads
+  // speculatively ahead of the stores: an ordering violation.
+  void CountStoreDependences(uint32_t address, unsigned size) {
+    bool covered = false;
+    unsigned distance = stores.load(Stamp(), address, size, covered);
+
+    if (!distance)
       return;
+    for (unsigned p = 0; p < pipelines.size(); p++) {
+      const Pipeline& pipeline = pipelines[p];
+
+      if (distance > pipeline.store_window)
+        continue;
+      if (pipeline.forwarding && covered)
+        store_forwards[p]++;
+      else
+        store_stalls[p]++;
+      ordering_violations[p] += (int) distance <= pipeline.hazard_distance;
+    }
+  }
+
+  // Instructions since register r was last written.
+  int Distance(unsigned r) const {
+    return Stamp() - last_write[r];
+  }
+
+  // What the hazards of inst depend on, the same for every pipeline.
+  Dependence GetDependence(const mips_instruction& inst) {
+    Dependence d;
+
+    // Check if one of the last instructions was a load
+    for (unsigned i = 0; i < latest_instructions.size() && i < max_load_use; i++) {
+      if (Classify(latest_instructions[i]).load) {
+        d.load = i + 1;
+        break;
+      }
     }
     if (inst.type == mips_instruction::kR) {
       if (inst.func == 0x0D || inst.func == 0x0C) { // break, syscall
-        return;
+        return d;
       }
       if (inst.func == 0x10) { // mfhi
-        number_of_data_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[32], pipeline_stage);
+        d.data = Distance(32);
       } else if (inst.func == 0x12) { // mflo
-        number_of_data_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[33], pipeline_stage);
+        d.data = Distance(33);
       } else if (inst.func == 0x11 || inst.func == 0x13) { // mthi, mtlo
-        number_of_data_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[inst.rs], pipeline_stage);
+        d.data = Distance(inst.rs);
       } else if (inst.func == 0x08 || inst.func == 0x09) { // jr, jalr
-        number_of_control_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[inst.rs], pipeline_stage);
+        d.control = Distance(inst.rs);
       } else if (inst.shamt != 0) { // sll, sra, srl
-        number_of_data_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[inst.rt], pipeline_stage);
+        d.data = Distance(inst.rt);
       } else if (inst.rs != 0 && inst.rt != 0) {
-        number_of_data_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[inst.rs], pipeline_stage) |
-            isHazard(number_of_instructions - last_write[inst.rt], pipeline_stage);
+        d.data = std::min(Distance(inst.rs), Distance(inst.rt));
       } else if (inst.rs != 0) {
-        number_of_data_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[inst.rs], pipeline_stage);
+        d.data = Distance(inst.rs);
       } else if (inst.rt != 0) {
-        number_of_data_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[inst.rt], pipeline_stage);
+        d.data = Distance(inst.rt);
       }
     } else if (inst.type == mips_instruction::kI) {
       if (inst.op == 0x0F) { // lui
-        return;
+        return d;
       } else if ((inst.op == 0x04 || inst.op == 0x05) && (inst.rs != 0 || inst.rt != 0)) { // beq, bne
         // A branch that depends on the result of the previous instruction is a control hazard
-        number_of_control_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[inst.rs], pipeline_stage) |
-            isHazard(number_of_instructions - last_write[inst.rt], pipeline_stage);
-      } else if (branch_instructions.find(std::make_pair(inst.op, inst.func)) != branch_instructions.end()) {
+        d.control = std::min(Distance(inst.rs), Distance(inst.rt));
+      } else if (Classify(inst).branch) {
         // A branch that depends on the result of the previous instruction is a control hazard
-        number_of_control_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[inst.rs], pipeline_stage);
+        d.control = Distance(inst.rs);
       } else if ((inst.op == 0x28 || inst.op == 0x29 || inst.op == 0x2B) && (inst.rs != 0 && inst.rt != 0)) {
         // sb, sh, sw
-        number_of_data_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[inst.rs], pipeline_stage) |
-            isHazard(number_of_instructions - last_write[inst.rt], pipeline_stage);
+        d.data = std::min(Distance(inst.rs), Distance(inst.rt));
       } else if ((inst.op == 0x28 || inst.op == 0x29 || inst.op == 0x2B) && inst.rs != 0) {
         // sb, sh, sw
-        number_of_data_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[inst.rs], pipeline_stage);
+        d.data = Distance(inst.rs);
       } else if ((inst.op == 0x28 || inst.op == 0x29 || inst.op == 0x2B) && inst.rt != 0) {
         // sb, sh, sw
-        number_of_data_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[inst.rt], pipeline_stage);
+        d.data = Distance(inst.rt);
       } else if (inst.rs != 0) {
-        number_of_data_hazards[pipeline_stage] += isHazard(number_of_instructions - last_write[inst.rs], pipeline_stage);
+        d.data = Distance(inst.rs);
       }
     }
+    return d;
   }
 
-  int isHazard(int distance, pipeline_stages pipeline_stage) {
-    return hazard_table[is_fowarding][pipeline_stage] >= distance;
-  }
+  // Records inst as the pending branch if it is a branch or a jump.
+  void SetPendingBranch(const mips_instruction& inst) {
+    PendingBranch& b = pending_branch;
 
-  /**
-   * Returns 0 if 'inst' isn't a branch instruction, 1 if it is but branch
-   * is not taken, 2 if it is and branch is taken.
-   **/
-  int actual_branch_taken(mips_instruction inst) {
-    int taken = 0;
-    if (inst.type == mips_instruction::kI &&
-        branch_instructions.find(std::make_pair(inst.op, inst.func)) != branch_instructions.end()) {
-      ++taken;
+    b.pc = fetch_pc;
+    if (inst.type == mips_instruction::kI && Classify(inst).branch) {
       total_number_of_branches++;
-      switch (inst.op) {
-      case 0x01:
-        taken += inst.rt ? inst.rs >= 0 : inst.rs < 0;
-        break;
-      case 0x04:
-        taken += inst.rs == inst.rt;
-        break;
-      case 0x05:
-        taken += inst.rs != inst.rt;
-        break;
-      case 0x06:
-        taken += inst.rs <= 0;
-        break;
-      case 0x07:
-        taken += inst.rs > 0;
-        break;
-      }
+      b.kind = PendingBranch::kConditional;
+      b.target = fetch_pc + 4 + (inst.imm << 2);
     }
-    return taken;
+    else if (inst.type == mips_instruction::kJ && (inst.op == 0x02 || inst.op == 0x03)) // j, jal
+      b.kind = inst.op == 0x03 ? PendingBranch::kCall : PendingBranch::kJump;
+    else if (inst.type == mips_instruction::kR && inst.op == 0 && inst.func == 0x08) // jr
+      b.kind = inst.rs == Ra ? PendingBranch::kReturn : PendingBranch::kJump;
+    else if (inst.type == mips_instruction::kR && inst.op == 0 && inst.func == 0x09) // jalr
+      b.kind = PendingBranch::kCall;
   }
 
-  void static_branch_prediction(bool taken, mips_instruction inst) {
-    static_wrong_predictions += taken != inst.imm < pc_addr;
+  // Counts the predictions of the pending branch, which goes to npc after
+  // its delay slot, and trains the predictors with it. The out-of-order
+  // window is redirected if the direction of its predictor, the RAS or
+  // the BTB was wrong.
+  void ResolveBranch(unsigned npc) {
+    PendingBranch& b = pending_branch;
+    bool taken = npc != b.pc + 8;
+    bool redirect = false;
+
+    // The kinds of the trace are those of PendingBranch, without kNone.
+    if (branch_trace)
+      branch_trace->branch(mips_branch_trace::Kind(b.kind - 1), b.pc,
+                           b.kind == PendingBranch::kConditional ? b.target : npc, taken);
+    if (b.kind == PendingBranch::kConditional) {
+      unsigned long long* profile = branch_profile.enabled() ? branch_profile.counts(b.pc) : nullptr;
+
+      if (profile) {
+        profile[0]++;
+        profile[1] += taken;
+      }
+      for (unsigned i = 0; i < predictors.size(); i++) {
+        bool wrong = predictors[i]->predict(b.pc, b.target) != taken;
+
+        wrong_predictions[i] += wrong;
+        if (!core_counters.empty() && i == core_configurations[core].predictor)
+          core_counters[core].mispredictions += wrong;
+        if (profile)
+          profile[2 + i] += wrong;
+        redirect |= wrong && i == ooo_config.predictor;
+        predictors[i]->update(b.pc, taken);
+      }
+    }
+    if (b.kind == PendingBranch::kReturn) {
+      returns++;
+      bool miss = ras.pop() != npc;
+      ras_misses += miss;
+      redirect |= miss;
+    }
+    else if (taken) {
+      taken_branches++;
+      bool miss = !btb.predicts(b.pc, npc);
+      btb_misses += miss;
+      redirect |= miss;
+      btb.update(b.pc, npc);
+    }
+    if (b.kind == PendingBranch::kCall)
+      ras.push(b.pc + 8);
+    if (loops.enabled() && b.kind == PendingBranch::kCall)
+      loops.call(b.pc + 8);
+    if (hot_spots.enabled()) {
+      if (b.kind == PendingBranch::kCall)
+        hot_spots.call(npc, b.pc + 8);
+      else if (b.kind == PendingBranch::kReturn)
+        hot_spots.ret(npc);
+    }
+    b.kind = PendingBranch::kNone;
+    if (kOutOfOrder && out_of_order && redirect)
+      ooo.mispredicted(ooo_config.branch_penalty);
   }
 
-  void read_saturating_counter(bool taken, int& wrong_predictions, int stage) {
-    wrong_predictions += taken != (stage >= kNumberOfStages);
+  // The registers inst, given to push(), reads and writes for the
+  // timing models. The groups say loads and stores read and write both
+  // their registers; here loads write rt and stores read it.
+  void GetDataflow(const mips_instruction& inst, uint64_t& reads, uint64_t& writes) {
+    const OpClass& c = Classify(inst);
+
+    reads = inst.reads;
+    writes = inst.writes;
+    if (c.group && c.group->igroup == LoadStore) {
+      reads = 1ULL << inst.rs | (c.load ? 0 : 1ULL << inst.rt);
+      writes = c.load ? 1ULL << inst.rt : 0;
+    }
+    reads &= ~1ULL; // $zero is always ready
+    writes &= ~1ULL;
   }
 
-  void update_saturating_counter(bool taken, int& stage) {
-    stage += 2 * int(taken) - 1; // Adds 1 if taken, -1 otherwise
-    // 0 <= stage < 2 * numberOfStages
-    stage = std::max(std::min(stage, 2 * kNumberOfStages - 1), 0);
+  // Readies inst, given to push(), for the out-of-order window. Loads
+  // take at least the L1 hit latency of the hierarchy;
+  // SimulateLoadDataFromCaches() adds its miss penalty if they miss.
+  void SetOutOfOrderInstruction(const mips_instruction& inst) {
+    OutOfOrderInstruction& o = ooo_next;
+    const OpClass& c = Classify(inst);
+
+    o.pending = true;
+    GetDataflow(inst, o.reads, o.writes);
+    o.latency = 1;
+    o.load = c.load;
+    o.branch = c.unit == kBranchUnit;
+    if (c.load)
+      o.latency = cache_configurations[ooo_config.hierarchy].l1_hit_latency;
+    else if (inst.type == mips_instruction::kR && (inst.func == 0x18 || inst.func == 0x19)) // mult, multu
+      o.latency = ooo_config.mul_latency;
+    else if (inst.type == mips_instruction::kR && (inst.func == 0x1A || inst.func == 0x1B)) // div, divu
+      o.latency = ooo_config.div_latency;
   }
 
-  void saturating_branch_prediction(bool taken) {
-    read_saturating_counter(taken, saturating_wrong_predictions, saturating_stage);
-    update_saturating_counter(taken, saturating_stage);
+  // Gives the instruction readied above to the out-of-order window.
+  void RunOutOfOrder() {
+    OutOfOrderInstruction& o = ooo_next;
+
+    ooo.instruction(o.reads, o.writes, o.latency, o.load, o.branch);
+    o.pending = false;
   }
 
- /*
-  * Two_level_history contains the history of the last 'kHistoryDepth' actual
-  * branch decisions. This method updates that history, adding 'taken' and
-  * removing the oldest entry recorded on the history.
-  */
-  void update_two_level_history(bool taken) {
-    two_level_history = (two_level_history << 1 | taken) & ((1 << kHistoryDepth) - 1);
+  // Readies inst, given to push(), for the limit study. Instructions of
+  // no group take one cycle.
+  void SetIlpInstruction(const mips_instruction& inst) {
+    IlpInstruction& i = ilp_next;
+    const OpClass& c = Classify(inst);
+
+    i.pending = true;
+    GetDataflow(inst, i.reads, i.writes);
+    i.latency = c.group ? ilp_latencies[c.group->igroup] : 1;
+    i.access = c.group && c.group->igroup == LoadStore ? (c.load ? mips_ilp::kLoad : mips_ilp::kStore)
+                                                       : mips_ilp::kNone;
+    i.address = 0;
+    i.size = 4;
   }
 
-  void two_level_branch_predictor(bool taken) {
-    read_saturating_counter(taken, two_level_wrong_predictions, two_level_stages.at(two_level_history));
-    update_saturating_counter(taken, two_level_stages.at(two_level_history));
-    update_two_level_history(taken);
+  // Gives the instruction readied above to the limit study.
+  void RunIlp() {
+    IlpInstruction& i = ilp_next;
+
+    dataflow.instruction(i.reads, i.writes, i.latency, i.access, i.address, i.size);
+    i.pending = false;
   }
 
   // void generate read_and_write_log(mips instruction) {
@@ -582,84 +1202,3755 @@ struct variables {
   //   fclose(f);
   // }
 
-  void SimulateFetchInstructionFromCaches(const d4addr address) {
-    d4memref memory_reference;
-    memory_reference.address = static_cast<d4addr>(address);
-    memory_reference.size = 4;
-    memory_reference.accesstype = D4XINSTRN;
-    for (auto& cache_configuration : cache_configurations) {
-      d4ref(cache_configuration.instruction_l1_cache, memory_reference);
+  // Start of an instruction at pc, with npc as left by the previous one.
+  void Fetch(unsigned pc, unsigned npc) {
+    if (!kAnyAnalysis)
+      return;
+    AC_HOST_PHASE(AC_PHASE_ANALYSIS);
+    if (Queued()) {
+      QueueEvent();
+      event.record = {mips_trace::kInstruction, pc, npc, 0, 0, mips_trace::kEnd, 0};
+      pending_event = true;
+      return;
+    }
+    if (trace)
+      trace->instruction(pc, npc);
+    if (kOutOfOrder && ooo_next.pending)
+      RunOutOfOrder();
+    if (kOutOfOrder && ilp_next.pending)
+      RunIlp();
+    bool delay_slot = kBranches && pending_branch.kind != PendingBranch::kNone;
+    if (delay_slot)
+      ResolveBranch(npc);
+    if (skipping)
+      SkipStep();
+    if (sampling.enabled && InRegionOfInterest() && !convergence.converged)
+      SampleStep();
+    if (parallel.length && InRegionOfInterest())
+      ParallelStep();
+    // Stops the analysis before this instruction once converged.
+    if (analyze && convergence.rates.length && !--convergence.rates.left)
+      EndConvergenceInterval();
+    if (analyze) {
+      if (intervals.length && !intervals.left--)
+        EndInterval();
+      if (live.length && !--live.left)
+        EndRates(live);
+      if (warm_at && number_of_instructions == warm_at)
+        SaveWarmState();
+      number_of_instructions++;
+      if (!core_counters.empty())
+        core_counters[core].instructions++;
+      fetch_pc = pc;
+      if (hot_spots.enabled() && hot_spots.step())
+        SampleHotSpot(pc);
+      if (bbv.enabled())
+        bbv.step(pc, delay_slot);
+      if (loops.enabled())
+        StepLoops(pc);
+    }
+    SimulateFetchInstructionFromCaches(pc);
+  }
+
+  void SimulateFetchInstructionFromCaches(const d4addr address) {
+    if (!kCaches || !warm)
+      return;
+    d4memref memory_reference;
+    memory_reference.address = static_cast<d4addr>(address);
+    memory_reference.size = 4;
+    memory_reference.accesstype = D4XINSTRN;
+    if (frontend.enabled()) {
+      frontend.fetch(core, address, [this, &memory_reference](uint32_t block, unsigned size) {
+        memory_reference.address = block;
+        memory_reference.size = size;
+        Reference(memory_reference);
+      });
+      return;
+    }
+    Reference(memory_reference);
+  }
+
+  void Reference(const d4memref& memory_reference) {
+    if (tlbs)
+      Translate(memory_reference);
+    QueueReference(memory_reference);
+  }
+
+  // Looks the page of a reference up in its TLB. A miss reads the
+  // entries of a linear page table of 4-byte entries at walk_base, or of
+  // a two-level one: its root page there, and the leaf tables after it.
+  // They are Dinero IV misc references, which change the caches but are
+  // not counted as loads.
+  void Translate(const d4memref& memory_reference) {
+    mips_tlb& tlb = memory_reference.accesstype == D4XINSTRN ? instruction_tlb : data_tlb;
+    d4memref walk;
+    uint32_t page;
+
+    if (!tlb.access(memory_reference.address) || !walk_references)
+      return;
+    page = tlb.page(memory_reference.address);
+    walk.size = 4;
+    walk.accesstype = D4XMISC;
+    if (walk_references == 2) {
+      walk.address = walk_base + (page >> 10) * 4;
+      QueueReference(walk);
+      walk.address = walk_base + 4096 + page * 4;
+    }
+    else
+      walk.address = walk_base + page * 4;
+    QueueReference(walk);
+  }
+
+  void QueueReference(const d4memref& memory_reference) {
+    if (references.started())
+      references.push(CoreReference{memory_reference, core});
+    else
+      SimulateReference(memory_reference, core);
+  }
+
+  // Runs a fetch, load or store of core through every hierarchy and the
+  // sweep.
+  void SimulateReference(const d4memref& memory_reference, unsigned core) {
+    AC_HOST_PHASE(AC_PHASE_DINERO);
+
+    if (memory_reference.accesstype == D4XINSTRN) {
+      for (auto& cache_configuration : cache_configurations) {
+        d4addr block = memory_reference.address & cache_configuration.fetch_mask;
+        d4addr& last = cache_configuration.last_fetches[core];
+        d4cache* l1 = cache_configuration.instruction_l1_caches[core];
+        mips_3c& ccc = cache_configuration.instruction_3c;
+        bool sampled = classify && ccc.sampled(memory_reference.address);
+        double misses = l1->miss[D4XINSTRN];
+
+        if (cache_configuration.contention)
+          cache_configuration.contention->run(core);
+        if (block == last)
+          l1->fetch[D4XINSTRN]++;
+        else {
+          mips_stages* stages = cache_configuration.stages.get();
+
+          if (stages)
+            stages->before(mips_stages::kInstruction, memory_reference.address);
+          d4ref(l1, memory_reference);
+          if (stages && stages->after())
+            ForgetFetches(cache_configuration);
+          if (cache_configuration.coalesce_fetches)
+            last = block;
+        }
+        if (sampled)
+          ccc.reference(memory_reference.address, l1->miss[D4XINSTRN] != misses);
+      }
+      if (layout.enabled() && !core)
+        layout.fetch(memory_reference.address);
+      if (sweep)
+        instruction_sweep.reference(memory_reference.address);
+      if (lanes)
+        instruction_lanes.reference(memory_reference.address);
+      if (reuse)
+        instruction_reuse.reference(memory_reference.address);
+    }
+    else {
+      for (auto& cache_configuration : cache_configurations) {
+        d4cache* l1 = cache_configuration.data_l1_caches[core];
+        mips_3c& ccc = cache_configuration.data_3c;
+        mips_stages* stages = cache_configuration.stages.get();
+        double misses = l1->miss[memory_reference.accesstype];
+
+        if (cache_configuration.contention)
+          cache_configuration.contention->run(core);
+        if (coherent)
+          cache_configuration.coherence.access(core, memory_reference.address,
+                                               memory_reference.accesstype == D4XWRITE);
+        if (stages)
+          stages->before(mips_stages::kData, memory_reference.address);
+        d4ref(l1, memory_reference);
+        if (stages && stages->after())
+          ForgetFetches(cache_configuration);
+        if (classify && ccc.sampled(memory_reference.address))
+          ccc.reference(memory_reference.address, l1->miss[memory_reference.accesstype] != misses);
+      }
+      if (sweep)
+        data_sweep.reference(memory_reference.address);
+      if (lanes)
+        data_lanes.reference(memory_reference.address);
+      if (reuse)
+        data_reuse.reference(memory_reference.address);
+    }
+  }
+
+  // The consumer of the reference queue.
+  static void SimulateReferences(void* self, const CoreReference* r, unsigned n) {
+    for (; n--; r++)
+      static_cast<variables*>(self)->SimulateReference(r->reference, r->core);
+  }
+
+  void DrainReferences() {
+    if (references.started())
+      references.drain();
+  }
+
+  // Hands the event being filled in to the worker.
+  void QueueEvent() {
+    if (pending_event)
+      events.push(event);
+    pending_event = false;
+  }
+
+  // The load or store of the current instruction, or an event of its own
+  // after the first one, as in traces.
+  void QueueAccess(mips_trace::Event access, uint32_t address, uint32_t value = 0) {
+    if (!pending_event || event.record.access != mips_trace::kEnd) {
+      QueueEvent();
+      event.record.event = access;
+    }
+    event.record.access = access;
+    event.record.address = address;
+    event.record.value = value;
+    pending_event = true;
+  }
+
+  // The consumer of the event queue.
+  static void AnalyzeEvents(void* self, const AnalysisEvent* e, unsigned n) {
+    variables* v = static_cast<variables*>(self);
+
+    analyzing = true;
+    for (; n--; e++) {
+      v->core = e->core;
+      v->Analyze(e->record);
+    }
+  }
+
+  void DrainAnalysis() {
+    if (!events.started())
+      return;
+    QueueEvent();
+    events.drain();
+  }
+
+  // Bytes accessed by the load or store with opcode op. The unaligned
+  // word accesses (lwl, lwr, swl, swr) stay within one aligned word.
+  static unsigned AccessSize(unsigned op) {
+    switch (op) {
+    case 0x20: case 0x24: case 0x28: // lb, lbu, sb
+      return 1;
+    case 0x21: case 0x25: case 0x29: // lh, lhu, sh
+      return 2;
+    default:
+      return 4;
+    }
+  }
+
+  // A load of size bytes at address, of value into its register.
+  void SimulateLoadDataFromCaches(const d4addr address, unsigned size, uint32_t value) {
+    if (!kAnyAnalysis)
+      return;
+    AC_HOST_PHASE(AC_PHASE_ANALYSIS);
+    if (Queued()) {
+      QueueAccess(mips_trace::kLoad, address, value);
+      return;
+    }
+    if (trace)
+      trace->access(false, address);
+    if (kOutOfOrder && ilp_next.pending) {
+      ilp_next.address = address;
+      ilp_next.size = size;
+    }
+    if (kHazards && analyze)
+      CountStoreDependences(address, size);
+    if (values.enabled() && analyze)
+      values.load(fetch_pc, value);
+    if (!kCaches || !warm)
+      return;
+    d4memref memory_reference;
+    memory_reference.address = static_cast<d4addr>(address & ~(size - 1));
+    memory_reference.size = size;
+    memory_reference.accesstype = D4XREAD;
+    // The out-of-order window and the load profile need to know which
+    // hierarchies missed.
+    if ((kOutOfOrder && ooo_next.pending) || (load_profile.enabled() && analyze)) {
+      for (unsigned c = 0; c < cache_configurations.size(); c++)
+        load_misses[c] = cache_configurations[c].data_l1_caches[core]->miss[D4XREAD];
+      Reference(memory_reference);
+      for (unsigned c = 0; c < cache_configurations.size(); c++)
+        load_misses[c] = cache_configurations[c].data_l1_caches[core]->miss[D4XREAD] != load_misses[c];
+      if (kOutOfOrder && ooo_next.pending && load_misses[ooo_config.hierarchy])
+        ooo_next.latency += cache_configurations[ooo_config.hierarchy].miss_penalty;
+      if (load_profile.enabled() && analyze) {
+        if (unsigned long long* counts = load_profile.find(fetch_pc))
+          for (unsigned c = 0; c < cache_configurations.size(); c++)
+            counts[1 + pipelines.size() + c] += load_misses[c] != 0;
+      }
+    }
+    else
+      Reference(memory_reference);
+    num_memory_acesses++;
+  }
+
+  void SimulateStoreDataInCaches(const d4addr address, unsigned size = 4) {
+    if (!kAnyAnalysis)
+      return;
+    AC_HOST_PHASE(AC_PHASE_ANALYSIS);
+    if (Queued()) {
+      QueueAccess(mips_trace::kStore, address);
+      return;
+    }
+    if (trace)
+      trace->access(true, address);
+    if (kOutOfOrder && ilp_next.pending) {
+      ilp_next.address = address;
+      ilp_next.size = size;
+    }
+    if (kHazards && analyze)
+      stores.store(Stamp(), address, size);
+    if (!kCaches || !warm)
+      return;
+    d4memref memory_reference;
+    memory_reference.address = static_cast<d4addr>(address & ~(size - 1));
+    memory_reference.size = size;
+    memory_reference.accesstype = D4XWRITE;
+    Reference(memory_reference);
+    num_memory_acesses++;
+  }
+
+  // Memory timing of a configuration. Every reference takes l1_hit_latency
+  // cycles and every L1 miss miss_penalty more, or victim_latency if its
+  // victim cache had the block, and every write that found the write
+  // buffer full waits drain_penalty more, as does every transfer that
+  // waited for the bus or a bank below the L1s; stall cycles are those
+  // beyond one per reference.
+  struct MemoryTiming {
+    double references, l1_misses, cycles, stalls, amat;
+  };
+
+  static MemoryTiming GetMemoryTiming(const CacheConfiguration& c) {
+    const d4cache* i = c.instruction_l1_cache;
+    const d4cache* d = c.data_l1_cache;
+    MemoryTiming t;
+
+    t.references = i->fetch[D4XINSTRN] + d->fetch[D4XREAD] + d->fetch[D4XWRITE];
+    t.l1_misses = i->miss[D4XINSTRN] + d->miss[D4XREAD] + d->miss[D4XWRITE];
+    t.cycles = t.references * c.l1_hit_latency + t.l1_misses * c.miss_penalty +
+               StageCycles(c, mips_stages::kInstruction) + StageCycles(c, mips_stages::kData) +
+               DramCycles(c, mips_dram::kInstructionCycles) + DramCycles(c, mips_dram::kDataCycles) +
+               ContentionCycles(c, mips_contention::kInstructionCycles) +
+               ContentionCycles(c, mips_contention::kDataCycles);
+    t.stalls = t.cycles - t.references;
+    t.amat = t.references ? t.cycles / t.references : 0;
+    return t;
+  }
+
+  // Cycles the stages of c change those of the L1 misses of side by: less
+  // for the victim cache hits, more for the writes waiting for the buffer.
+  static double StageCycles(const CacheConfiguration& c, mips_stages::Side side) {
+    const mips_stages* s = c.stages.get();
+
+    if (!s)
+      return 0;
+    if (side == mips_stages::kInstruction)
+      return s->count(mips_stages::kInstructionVictimHits) * (double) (s->victim_latency - c.miss_penalty);
+    return s->count(mips_stages::kDataVictimHits) * (double) (s->victim_latency - c.miss_penalty) +
+           s->count(mips_stages::kBufferFull) * (double) s->drain_penalty;
+  }
+
+  // Cycles the instruction reads or the other reads (counter) of the main
+  // memory of c took on top of the miss penalty.
+  static double DramCycles(const CacheConfiguration& c, mips_dram::Counter counter) {
+    return c.dram ? (double) c.dram->count(counter) : 0;
+  }
+
+  // Cycles the transfers of the first instruction or data L1 (counter) of
+  // c waited for the other processors.
+  static double ContentionCycles(const CacheConfiguration& c, mips_contention::Counter counter) {
+    return c.contention ? c.contention->count(counter) : 0;
+  }
+
+  // Cycles of pipeline p with predictor q and hierarchy c over everything
+  // counted: one per instruction, NOPs included, one more per data or
+  // control hazard, the branch penalty per misprediction, and the cycles
+  // of the L1 instruction and data accesses beyond one each, as in
+  // GetMemoryTiming(), plus the walk penalty of each TLB miss. Only
+  // counters are read, so the differences of two estimates are those of
+  // the interval between them.
+  struct CycleEstimate {
+    double instructions, data_hazards, control_hazards, mispredictions, fetch_stalls, data_stalls;
+
+    double total() const {
+      return instructions + data_hazards + control_hazards + mispredictions + fetch_stalls + data_stalls;
+    }
+  };
+
+  CycleEstimate EstimateCycles(unsigned p, unsigned q, const CacheConfiguration& c) const {
+    const d4cache* i = c.instruction_l1_cache;
+    const d4cache* d = c.data_l1_cache;
+    double data_accesses = d->fetch[D4XREAD] + d->fetch[D4XWRITE];
+    CycleEstimate e;
+
+    e.instructions = number_of_instructions;
+    e.data_hazards = number_of_data_hazards[p];
+    e.control_hazards = number_of_control_hazards[p];
+    e.mispredictions = (double) wrong_predictions[q] * pipelines[p].branch_penalty;
+    e.fetch_stalls = i->fetch[D4XINSTRN] * (c.l1_hit_latency - 1) + i->miss[D4XINSTRN] * c.miss_penalty +
+                     StageCycles(c, mips_stages::kInstruction) + DramCycles(c, mips_dram::kInstructionCycles) +
+                     ContentionCycles(c, mips_contention::kInstructionCycles);
+    e.data_stalls = data_accesses * (c.l1_hit_latency - 1) +
+                    (d->miss[D4XREAD] + d->miss[D4XWRITE]) * c.miss_penalty + StageCycles(c, mips_stages::kData) +
+                    DramCycles(c, mips_dram::kDataCycles) + ContentionCycles(c, mips_contention::kDataCycles);
+    if (tlbs) {
+      e.fetch_stalls += (double) instruction_tlb.count(mips_tlb::kMisses) * walk_penalty;
+      e.data_stalls += (double) data_tlb.count(mips_tlb::kMisses) * walk_penalty;
+    }
+    return e;
+  }
+
+  // The cycles of core k of MIPS_CORES in the hierarchy c: its own
+  // instructions, the hazards of its pipeline, the mispredictions of its
+  // predictor, and the hits and misses of its L1s, with the waits below
+  // them. The stages, the DRAM and the TLBs are only timed for the whole
+  // run, in EstimateCycles().
+  CycleEstimate EstimateCoreCycles(unsigned k, const CacheConfiguration& c) const {
+    const d4cache* i = c.instruction_l1_caches[k];
+    const d4cache* d = c.data_l1_caches[k];
+    const CoreCounters& n = core_counters[k];
+    double waits = c.contention ? c.contention->waits(k) : 0;
+    double instruction_bytes = i->bytes_read + i->bytes_written;
+    double data_bytes = d->bytes_read + d->bytes_written;
+    double share = instruction_bytes + data_bytes ? instruction_bytes / (instruction_bytes + data_bytes) : 0;
+    CycleEstimate e;
+
+    e.instructions = n.instructions;
+    e.data_hazards = n.data_hazards;
+    e.control_hazards = n.control_hazards;
+    e.mispredictions = (double) n.mispredictions * pipelines[core_configurations[k].pipeline].branch_penalty;
+    e.fetch_stalls = i->fetch[D4XINSTRN] * (c.l1_hit_latency - 1) + i->miss[D4XINSTRN] * c.miss_penalty +
+                     waits * share;
+    e.data_stalls = (d->fetch[D4XREAD] + d->fetch[D4XWRITE]) * (c.l1_hit_latency - 1) +
+                    (d->miss[D4XREAD] + d->miss[D4XWRITE]) * c.miss_penalty + waits * (1 - share);
+    return e;
+  }
+
+  // Energy of the caches and memory of c, in pJ, from the accesses and
+  // misses of each cache, prefetches included, over every core. Like
+  // EstimateCycles(), only counters are read.
+  typedef CacheConfiguration::CacheEnergy CacheEnergy;
+
+  static CacheEnergy GetCacheEnergy(const CacheConfiguration& c) {
+    double l1_accesses = 0, l1_misses = 0, l2_accesses = 0, l2_misses = 0, memory_accesses = 0;
+    CacheEnergy e;
+
+    for (unsigned t = 0; t < 2 * D4NUMACCESSTYPES; t++) {
+      for (const std::vector<d4cache*>* l1s : {&c.instruction_l1_caches, &c.data_l1_caches})
+        for (const d4cache* l1 : *l1s) {
+          l1_accesses += l1->fetch[t];
+          l1_misses += l1->miss[t];
+        }
+      l2_accesses += c.l2_cache->fetch[t];
+      l2_misses += c.l2_cache->miss[t];
+      memory_accesses += c.memory->fetch[t];
+    }
+    e.l1 = (l1_accesses - l1_misses) * c.l1_hit_energy + l1_misses * c.l1_miss_energy;
+    e.l2 = (l2_accesses - l2_misses) * c.l2_hit_energy + l2_misses * c.l2_miss_energy;
+    e.memory = memory_accesses * c.memory_energy +
+               (c.memory->fetch[D4XWRITE] + c.memory->fetch[D4PREFETCH + D4XWRITE]) * c.writeback_energy;
+    return e;
+  }
+
+  // The energy reported for c: as counted, or as Extrapolate() estimated.
+  static CacheEnergy ReportedCacheEnergy(const CacheConfiguration& c) {
+    return c.energy_extrapolated ? c.extrapolated_energy : GetCacheEnergy(c);
+  }
+
+  // Counters reported by ac_behavior(end), in a fixed order.
+  void GetMetrics(std::vector<double>& m) {
+    DrainReferences();
+    m.clear();
+    m.push_back(number_of_nops);
+    m.push_back(number_of_instructions);
+    for (unsigned i = 0; i < pipelines.size(); i++)
+      m.push_back(number_of_data_hazards[i]);
+    for (unsigned i = 0; i < pipelines.size(); i++)
+      m.push_back(number_of_control_hazards[i]);
+    for (const std::vector<unsigned long long>* v : {&store_forwards, &store_stalls, &ordering_violations})
+      m.insert(m.end(), v->begin(), v->end());
+    m.push_back(total_number_of_branches);
+    m.insert(m.end(), wrong_predictions.begin(), wrong_predictions.end());
+    m.push_back(taken_branches);
+    m.push_back(btb_misses);
+    m.push_back(returns);
+    m.push_back(ras_misses);
+    for (const IssueModel& i : issue_models)
+      m.insert(m.end(), i.groups.begin(), i.groups.end());
+    if (out_of_order) {
+      m.insert(m.end(), ooo.counts().begin(), ooo.counts().end());
+      m.push_back(ooo.cycles());
+    }
+    if (ilp)
+      m.insert(m.end(), dataflow.counts().begin(), dataflow.counts().end());
+    m.push_back(num_memory_acesses);
+    for (auto& cache_configuration : cache_configurations) {
+      m.push_back(cache_configuration.l2_cache->miss[D4XINSTRN]);
+      m.push_back(cache_configuration.l2_cache->miss[D4XREAD]);
+      m.push_back(cache_configuration.l2_cache->miss[D4XWRITE]);
+      m.push_back(cache_configuration.instruction_l1_cache->fetch[D4XINSTRN]);
+      m.push_back(cache_configuration.instruction_l1_cache->miss[D4XINSTRN]);
+      m.push_back(cache_configuration.data_l1_cache->fetch[D4XREAD]);
+      m.push_back(cache_configuration.data_l1_cache->miss[D4XREAD]);
+      m.push_back(cache_configuration.data_l1_cache->fetch[D4XWRITE]);
+      m.push_back(cache_configuration.data_l1_cache->miss[D4XWRITE]);
+    }
+    for (unsigned c = 0; cache_energy && c < cache_configurations.size(); c++) {
+      CacheEnergy e = GetCacheEnergy(cache_configurations[c]);
+      m.insert(m.end(), {e.l1, e.l2, e.memory});
+    }
+    if (sweep) {
+      for (mips_sweep* s : {&instruction_sweep, &data_sweep})
+        m.insert(m.end(), s->counts().begin(), s->counts().end());
+    }
+    if (lanes) {
+      for (mips_lanes* l : {&instruction_lanes, &data_lanes})
+        m.insert(m.end(), l->counts().begin(), l->counts().end());
+    }
+    for (auto& cache_configuration : cache_configurations) {
+      if (cache_configuration.stages)
+        m.insert(m.end(), cache_configuration.stages->counts().begin(), cache_configuration.stages->counts().end());
+      if (cache_configuration.dram)
+        m.insert(m.end(), cache_configuration.dram->counts().begin(), cache_configuration.dram->counts().end());
+      if (cache_configuration.contention)
+        m.insert(m.end(), cache_configuration.contention->counts().begin(),
+                 cache_configuration.contention->counts().end());
+    }
+    if (tlbs) {
+      for (mips_tlb* t : {&instruction_tlb, &data_tlb})
+        m.insert(m.end(), t->counts().begin(), t->counts().end());
+    }
+    if (reuse) {
+      for (mips_reuse* r : {&instruction_reuse, &data_reuse})
+        m.insert(m.end(), r->counts().begin(), r->counts().end());
+    }
+    if (frontend.enabled())
+      m.insert(m.end(), frontend.counts().begin(), frontend.counts().end());
+    if (values.enabled())
+      m.insert(m.end(), values.counts().begin(), values.counts().end());
+  }
+
+  void SetMetrics(const std::vector<double>& m) {
+    int k = 0;
+
+    DrainReferences();
+    number_of_nops = std::llround(m[k++]);
+    number_of_instructions = std::llround(m[k++]);
+    for (unsigned i = 0; i < pipelines.size(); i++)
+      number_of_data_hazards[i] = std::llround(m[k++]);
+    for (unsigned i = 0; i < pipelines.size(); i++)
+      number_of_control_hazards[i] = std::llround(m[k++]);
+    for (std::vector<unsigned long long>* v : {&store_forwards, &store_stalls, &ordering_violations})
+      for (unsigned long long& n : *v)
+        n = std::llround(m[k++]);
+    total_number_of_branches = std::llround(m[k++]);
+    for (unsigned i = 0; i < predictors.size(); i++)
+      wrong_predictions[i] = std::llround(m[k++]);
+    taken_branches = std::llround(m[k++]);
+    btb_misses = std::llround(m[k++]);
+    returns = std::llround(m[k++]);
+    ras_misses = std::llround(m[k++]);
+    for (IssueModel& i : issue_models)
+      for (unsigned long long& n : i.groups)
+        n = std::llround(m[k++]);
+    if (out_of_order) {
+      for (unsigned long long& n : ooo.counts())
+        n = std::llround(m[k++]);
+      ooo.state().last_retire = std::llround(m[k++]);
+    }
+    if (ilp) {
+      for (unsigned long long& n : dataflow.counts())
+        n = std::llround(m[k++]);
+    }
+    num_memory_acesses = std::llround(m[k++]);
+    for (auto& cache_configuration : cache_configurations) {
+      cache_configuration.l2_cache->miss[D4XINSTRN] = std::llround(m[k++]);
+      cache_configuration.l2_cache->miss[D4XREAD] = std::llround(m[k++]);
+      cache_configuration.l2_cache->miss[D4XWRITE] = std::llround(m[k++]);
+      cache_configuration.instruction_l1_cache->fetch[D4XINSTRN] = std::llround(m[k++]);
+      cache_configuration.instruction_l1_cache->miss[D4XINSTRN] = std::llround(m[k++]);
+      cache_configuration.data_l1_cache->fetch[D4XREAD] = std::llround(m[k++]);
+      cache_configuration.data_l1_cache->miss[D4XREAD] = std::llround(m[k++]);
+      cache_configuration.data_l1_cache->fetch[D4XWRITE] = std::llround(m[k++]);
+      cache_configuration.data_l1_cache->miss[D4XWRITE] = std::llround(m[k++]);
+    }
+    // The L2 accesses and the memory ones are not metrics, so the energy
+    // estimated is kept rather than counted again.
+    for (unsigned c = 0; cache_energy && c < cache_configurations.size(); c++) {
+      CacheEnergy& e = cache_configurations[c].extrapolated_energy;
+      e.l1 = m[k++];
+      e.l2 = m[k++];
+      e.memory = m[k++];
+      cache_configurations[c].energy_extrapolated = true;
+    }
+    if (sweep) {
+      for (mips_sweep* s : {&instruction_sweep, &data_sweep})
+        for (unsigned long long& count : s->counts())
+          count = std::llround(m[k++]);
+    }
+    if (lanes) {
+      for (mips_lanes* l : {&instruction_lanes, &data_lanes})
+        for (unsigned long long& count : l->counts())
+          count = std::llround(m[k++]);
+    }
+    for (auto& cache_configuration : cache_configurations) {
+      if (cache_configuration.stages)
+        for (unsigned long long& count : cache_configuration.stages->counts())
+          count = std::llround(m[k++]);
+      if (cache_configuration.dram)
+        for (unsigned long long& count : cache_configuration.dram->counts())
+          count = std::llround(m[k++]);
+      if (cache_configuration.contention)
+        for (double& count : cache_configuration.contention->counts())
+          count = m[k++];
+    }
+    if (tlbs) {
+      for (mips_tlb* t : {&instruction_tlb, &data_tlb})
+        for (unsigned long long& count : t->counts())
+          count = std::llround(m[k++]);
+    }
+    if (reuse) {
+      for (mips_reuse* r : {&instruction_reuse, &data_reuse})
+        for (unsigned long long& count : r->counts())
+          count = std::llround(m[k++]);
+    }
+    if (frontend.enabled())
+      for (unsigned long long& count : frontend.counts())
+        count = std::llround(m[k++]);
+    if (values.enabled())
+      for (unsigned long long& count : values.counts())
+        count = std::llround(m[k++]);
+  }
+
+  static unsigned long long GetEnvCount(const char* name, unsigned long long value) {
+    const char* s = std::getenv(name);
+    return (s && *s) ? std::strtoull(s, nullptr, 10) : value;
+  }
+
+  // Cache hierarchies simulated when MIPS_CACHES is not set: one per line,
+  // described with the options dineroIV takes for the same caches.
+  static constexpr const char* kDefaultCacheConfigurations =
+    "-l1-isize 32k -l1-iassoc 2 -l1-dsize 32k -l1-dassoc 2 -l2-usize 1M -l2-uassoc 2 -hit-latency 4 -miss-penalty 30\n"
+    "-l1-isize 32k -l1-iassoc 2 -l1-dsize 32k -l1-dassoc 2 -l2-usize 4M -l2-uassoc 2 -hit-latency 4 -miss-penalty 30\n"
+    "-l1-isize 64k -l1-iassoc 2 -l1-dsize 64k -l1-dassoc 2 -l2-usize 1M -l2-uassoc 2 -hit-latency 13 -miss-penalty 30\n"
+    "-l1-isize 64k -l1-iassoc 2 -l1-dsize 64k -l1-dassoc 2 -l2-usize 4M -l2-uassoc 2 -hit-latency 13 -miss-penalty 30\n";
+
+  // Power of two with an optional k, M or G scale, as in dineroIV sizes.
+  // Returns its log2, or -1 if value is not one.
+  static int Log2Scaled(const std::string& value) {
+    char* end;
+    unsigned long long n = std::strtoull(value.c_str(), &end, 10);
+    int lg2 = 0;
+
+    switch (*end) {
+    case 'k': case 'K': n <<= 10; end++; break;
+    case 'm': case 'M': n <<= 20; end++; break;
+    case 'g': case 'G': n <<= 30; end++; break;
+    }
+    if (*end || !n || (n & (n - 1)))
+      return -1;
+    while (n >>= 1)
+      lg2++;
+    return lg2;
+  }
+
+  // A hierarchy with the defaults of its options: 16-byte blocks, direct
+  // mapped, 32 KB L1 and 4 MB L2 caches, LRU, demand fetch, write allocate
+  // and write back; 1 cycle hits and no miss penalty. Its caches go in
+  // context.
+  static CacheConfiguration NewCacheConfiguration(d4context* context) {
+    CacheConfiguration c;
+
+    c.context = context;
+    c.memory = d4newin(context, NULL);
+    c.l2_cache = d4new(c.memory);
+    c.instruction_l1_cache = d4new(c.l2_cache);
+    c.data_l1_cache = d4new(c.l2_cache);
+    c.instruction_l1_caches.assign(1, c.instruction_l1_cache);
+    c.data_l1_caches.assign(1, c.data_l1_cache);
+    c.coalesce_fetches = false;
+    c.fetch_mask = 0;
+    c.last_fetches.assign(1, kNoFetch);
+    for (d4cache* cache : {c.l2_cache, c.instruction_l1_cache, c.data_l1_cache}) {
+      cache->lg2blocksize = 4;
+      cache->lg2subblocksize = -1; // same as the block size
+      cache->lg2size = cache == c.l2_cache ? 22 : 15;
+      cache->assoc = 1;
+      cache->replacementf = d4rep_lru;
+      cache->name_replacement = const_cast<char*>("LRU");
+      cache->prefetchf = d4prefetch_none;
+      cache->name_prefetch = const_cast<char*>("demand only");
+      cache->prefetch_distance = 1;
+      cache->prefetch_abortpercent = 0;
+      cache->wallocf = d4walloc_always;
+      cache->name_walloc = const_cast<char*>("always");
+      cache->wbackf = d4wback_always;
+      cache->name_wback = const_cast<char*>("always");
+    }
+    c.l1_hit_latency = 1;
+    c.miss_penalty = 0;
+    c.l1_hit_energy = c.l1_miss_energy = c.l2_hit_energy = c.l2_miss_energy = 0;
+    c.memory_energy = c.writeback_energy = 0;
+    c.energy_extrapolated = false;
+    return c;
+  }
+
+  // Applies one option of a hierarchy: -l1-i, -l1-d or -l2-u followed by
+  // size, bsize, sbsize, assoc, repl (l, f, r), fetch (d, a, m, t, l, s),
+  // pfdist (in sub-blocks), pfabort, walloc (a, n, f) or wback (a, n, f),
+  // as in dineroIV, or -hit-latency and -miss-penalty, in cycles. Returns
+  // false if the option or its value is not valid. The energy of each
+  // event, in pJ, is set with -l1-hit-energy, -l1-miss-energy,
+  // -l2-hit-energy, -l2-miss-energy, -memory-energy and -writeback-energy.
+  // The stages between the L1s and the L2 are set with -l1-ivictim and
+  // -l1-dvictim (blocks of the victim caches), -l1-dwbuffer (blocks of the
+  // write buffer), -l2-uinclusion (n for neither, i for inclusive, e for
+  // exclusive), -victim-latency and -drain-penalty, in cycles. The
+  // timing of the main memory is set with -dram-banks, -dram-row (bytes),
+  // -dram-page (o for open, c for closed), -dram-trcd, -dram-tcas,
+  // -dram-trp, -dram-burst, -dram-refi, -dram-rfc, in cycles, and
+  // -dram-queue (writes); see mips_dram.H. The contention of the
+  // processors below their L1s is set with -bus-width (bytes a cycle),
+  // -bus-overhead (cycles a transfer), -bus-arbiter (r for round-robin, p
+  // for priority), -bus-banks, -bus-ports and -bus-occupancy (cycles) of
+  // the banks of the L2; see mips_contention.H.
+  static bool SetCacheOption(CacheConfiguration& c, const std::string& option, const std::string& value) {
+    static const std::pair<const char*, double CacheConfiguration::*> energies[] = {
+      {"-l1-hit-energy", &CacheConfiguration::l1_hit_energy},
+      {"-l1-miss-energy", &CacheConfiguration::l1_miss_energy},
+      {"-l2-hit-energy", &CacheConfiguration::l2_hit_energy},
+      {"-l2-miss-energy", &CacheConfiguration::l2_miss_energy},
+      {"-memory-energy", &CacheConfiguration::memory_energy},
+      {"-writeback-energy", &CacheConfiguration::writeback_energy},
+    };
+    char* end;
+    long n = std::strtol(value.c_str(), &end, 10);
+    bool number = !value.empty() && !*end && n >= 0;
+    char policy = value.size() == 1 ? value[0] : 0;
+    d4cache* cache;
+    std::string name;
+
+    if (option == "-hit-latency" || option == "-miss-penalty") {
+      (option == "-hit-latency" ? c.l1_hit_latency : c.miss_penalty) = n;
+      return number;
+    }
+    if (option == "-victim-latency" || option == "-drain-penalty") {
+      (option == "-victim-latency" ? Stages(c).victim_latency : Stages(c).drain_penalty) = n;
+      return number;
+    }
+    if (option.compare(0, 6, "-dram-") == 0) {
+      if (!c.dram)
+        c.dram = std::make_shared<mips_dram>();
+      return c.dram->set(option.substr(6), value);
+    }
+    if (option.compare(0, 5, "-bus-") == 0) {
+      if (!c.contention)
+        c.contention = std::make_shared<mips_contention>();
+      return c.contention->set(option.substr(5), value);
+    }
+    for (const auto& energy : energies)
+      if (option == energy.first) {
+        double& pj = c.*energy.second;
+        pj = std::strtod(value.c_str(), &end);
+        return !value.empty() && !*end && pj >= 0;
+      }
+    if (option.compare(0, 5, "-l1-i") == 0)
+      cache = c.instruction_l1_cache;
+    else if (option.compare(0, 5, "-l1-d") == 0)
+      cache = c.data_l1_cache;
+    else if (option.compare(0, 5, "-l2-u") == 0)
+      cache = c.l2_cache;
+    else
+      return false;
+    name = option.substr(5);
+
+    if (name == "size")
+      return (cache->lg2size = Log2Scaled(value)) >= 0;
+    if (name == "bsize")
+      return (cache->lg2blocksize = Log2Scaled(value)) >= 0;
+    if (name == "sbsize")
+      return (cache->lg2subblocksize = Log2Scaled(value)) >= 0;
+    if (name == "assoc") {
+      cache->assoc = n;
+      return number && n > 0;
+    }
+    if (name == "pfdist") {
+      cache->prefetch_distance = n;
+      return number && n > 0;
+    }
+    if (name == "pfabort") {
+      cache->prefetch_abortpercent = n;
+      return number && n <= 100;
+    }
+    if (name == "victim" && cache != c.l2_cache) {
+      Stages(c).victim_entries[cache == c.data_l1_cache ? mips_stages::kData : mips_stages::kInstruction] = n;
+      return number && n <= kMaxStageEntries;
+    }
+    if (name == "wbuffer" && cache == c.data_l1_cache) {
+      Stages(c).buffer_entries = n;
+      return number && n <= kMaxStageEntries;
+    }
+    if (name == "inclusion" && cache == c.l2_cache) {
+      switch (policy) {
+      case 'n': Stages(c).inclusion = mips_stages::kNINE; return true;
+      case 'i': Stages(c).inclusion = mips_stages::kInclusive; return true;
+      case 'e': Stages(c).inclusion = mips_stages::kExclusive; return true;
+      }
+      return false;
+    }
+    if (name == "repl") {
+      switch (policy) {
+      case 'l': cache->replacementf = d4rep_lru; cache->name_replacement = const_cast<char*>("LRU"); return true;
+      case 'f': cache->replacementf = d4rep_fifo; cache->name_replacement = const_cast<char*>("FIFO"); return true;
+      case 'r': cache->replacementf = d4rep_random; cache->name_replacement = const_cast<char*>("random"); return true;
+      }
+    }
+    else if (name == "fetch") {
+      switch (policy) {
+      case 'd': cache->prefetchf = d4prefetch_none; cache->name_prefetch = const_cast<char*>("demand only"); return true;
+      case 'a': cache->prefetchf = d4prefetch_always; cache->name_prefetch = const_cast<char*>("always"); return true;
+      case 'm': cache->prefetchf = d4prefetch_miss; cache->name_prefetch = const_cast<char*>("miss"); return true;
+      case 't': cache->prefetchf = d4prefetch_tagged; cache->name_prefetch = const_cast<char*>("tagged"); return true;
+      case 'l': cache->prefetchf = d4prefetch_loadforw; cache->name_prefetch = const_cast<char*>("load forward"); return true;
+      case 's': cache->prefetchf = d4prefetch_subblock; cache->name_prefetch = const_cast<char*>("subblock"); return true;
+      }
+    }
+    else if (name == "walloc") {
+      switch (policy) {
+      case 'a': cache->wallocf = d4walloc_always; cache->name_walloc = const_cast<char*>("always"); return true;
+      case 'n': cache->wallocf = d4walloc_never; cache->name_walloc = const_cast<char*>("never"); return true;
+      case 'f': cache->wallocf = d4walloc_nofetch; cache->name_walloc = const_cast<char*>("nofetch"); return true;
+      }
+    }
+    else if (name == "wback") {
+      switch (policy) {
+      case 'a': cache->wbackf = d4wback_always; cache->name_wback = const_cast<char*>("always"); return true;
+      case 'n': cache->wbackf = d4wback_never; cache->name_wback = const_cast<char*>("never"); return true;
+      case 'f': cache->wbackf = d4wback_nofetch; cache->name_wback = const_cast<char*>("nofetch"); return true;
+      }
+    }
+    return false;
+  }
+
+  // Blocks a victim cache or the write buffer may hold; they are searched
+  // in order.
+  static constexpr long kMaxStageEntries = 64;
+
+  // The stages of c, created with the first option that sets them.
+  static mips_stages& Stages(CacheConfiguration& c) {
+    if (!c.stages)
+      c.stages = std::make_shared<mips_stages>();
+    return *c.stages;
+  }
+
+  // The stacks and hash tables of Dinero IV, placed as AC_HOST_NUMA and
+  // AC_HOST_HUGEPAGES ask.
+  static void* AllocateTable(size_t n, size_t size) { return ac_host_alloc(n * size); }
+  static void ReleaseTable(void* p, size_t, size_t) { ac_host_release(p); }
+
+  // Creates the hierarchies listed in MIPS_CACHES=file, one per line in
+  // the format of kDefaultCacheConfigurations, or the default ones (in a
+  // build with a customized Dinero IV, those it was customized for). Done
+  // once: forked experiments all simulate the same hierarchies. Each
+  // hierarchy has a Dinero IV context of its own, except when customizing,
+  // which only knows the default one.
+  void SetUpCaches() {
+    const char* path = std::getenv("MIPS_CACHES");
+#if D4CUSTOM
+    std::istringstream defaults(mips_d4custom_caches);
+    bool shared_context = true;
+#else
+    std::istringstream defaults(kDefaultCacheConfigurations);
+    bool shared_context = std::getenv("MIPS_D4CUSTOM") != NULL;
+#endif
+    d4tablealloc = AllocateTable;
+    d4tablefree = ReleaseTable;
+    std::ifstream file;
+    std::istream* in = &defaults;
+    std::string line, option, value;
+
+    if (path && *path) {
+      file.open(path);
+      if (!file) {
+        std::cerr << "MIPS: Could not read cache configurations " << path << ".\n";
+        std::exit(EXIT_FAILURE);
+      }
+      in = &file;
+    }
+    while (std::getline(*in, line)) {
+      std::istringstream words(line);
+
+      if (!(words >> option) || option[0] == '#')
+        continue;
+      CacheConfiguration c = NewCacheConfiguration(shared_context ? NULL : d4newcontext());
+      do {
+        value.clear();
+        if (!(words >> value) || !SetCacheOption(c, option, value)) {
+          std::cerr << "MIPS: Cache configuration #" << cache_configurations.size() << ": "
+                    << option << " " << value << " is not valid.\n";
+          std::exit(EXIT_FAILURE);
+        }
+      } while (words >> option);
+      if (!core_configurations.empty())
+        SetCoreCaches(c, c.instruction_l1_cache, c.data_l1_cache, 0);
+      for (d4cache* cache : {c.l2_cache, c.instruction_l1_cache, c.data_l1_cache}) {
+        if (cache->lg2subblocksize < 0)
+          cache->lg2subblocksize = cache->lg2blocksize;
+        cache->prefetch_distance <<= cache->lg2subblocksize;
+      }
+      cache_energy |= c.l1_hit_energy || c.l1_miss_energy || c.l2_hit_energy || c.l2_miss_energy ||
+                      c.memory_energy || c.writeback_energy;
+      cache_configurations.push_back(c);
+      cache_configuration_lines += line + "\n";
+    }
+
+    // The caches of MIPS_LANES may be the only ones.
+    if (cache_configurations.empty() && !(std::getenv("MIPS_LANES") && *std::getenv("MIPS_LANES"))) {
+      std::cerr << "MIPS: No cache configuration in " << path << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    int cache_setup_error{0};
+    for (const CacheConfiguration& c : cache_configurations)
+      cache_setup_error |= d4setupin(c.context);
+    if (cache_setup_error) {
+      std::cerr << "Error on cache setup. I'm calling std::exit(EXIT_FAILURE).\n";
+      std::exit(EXIT_FAILURE);
+    }
+    for (CacheConfiguration& c : cache_configurations) {
+      SetUpFetchCoalescing(c);
+      SetUpStages(c);
+      SetUpDram(c);
+      SetUpContention(c);
+    }
+  }
+
+  // Puts the victim caches, the write buffer and the inclusion of c
+  // between its L1s and its L2, if an option set them. They are given
+  // what the L1s send downstream, and add their own counters.
+  void SetUpStages(CacheConfiguration& c) {
+    const char* problem;
+
+    if (!c.stages)
+      return;
+    problem = c.stages->attach(c.instruction_l1_cache, c.data_l1_cache, c.l2_cache, c.memory);
+    if (problem) {
+      std::cerr << "MIPS: Cache configuration #" << (&c - &cache_configurations[0]) << ": " << problem << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  // Times the reads of the main memory of c, if an option set it, on top
+  // of the miss penalty, at the cycles counted for its first L1s. Done
+  // after SetUpStages(), whose references to memory it times too.
+  void SetUpDram(CacheConfiguration& c) {
+    const char* problem;
+
+    if (!c.dram)
+      return;
+    problem = c.dram->attach(
+        c.memory, c.instruction_l1_cache, c.data_l1_cache, c.l1_hit_latency, c.miss_penalty);
+    if (problem) {
+      std::cerr << "MIPS: Cache configuration #" << (&c - &cache_configurations[0]) << ": " << problem << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  // Makes the processors wait for each other below the L1s of c, if an
+  // option set it, at the cycles counted for their L1s. Each processor
+  // started after the first adds its own L1s when coherent; see AddCore().
+  void SetUpContention(CacheConfiguration& c) {
+    if (c.contention)
+      c.contention->attach(c.instruction_l1_cache, c.data_l1_cache, c.l1_hit_latency, c.miss_penalty);
+  }
+
+  // Repeated fetches from a sub-block are coalesced when the instruction
+  // L1 prefetches nothing (a prefetch may replace the sub-block) and its
+  // sub-blocks hold a whole instruction. Hits change the LRU order only to
+  // bring the block to the top of its set, where the last fetch left it,
+  // and do not change the FIFO or random one. MIPS_COALESCE_FETCHES=0
+  // turns it off.
+  static void SetUpFetchCoalescing(CacheConfiguration& c) {
+    const d4cache* i = c.instruction_l1_cache;
+
+    c.coalesce_fetches = GetEnvCount("MIPS_COALESCE_FETCHES", 1) &&
+                         i->prefetchf == d4prefetch_none && i->lg2subblocksize >= 2;
+    c.fetch_mask = ~((d4addr(1) << i->lg2subblocksize) - 1);
+    ForgetFetches(c);
+  }
+
+  // After the instruction L1s of c change other than through fetches.
+  static void ForgetFetches(CacheConfiguration& c) {
+    c.last_fetches.assign(c.instruction_l1_caches.size(), kNoFetch);
+  }
+
+  // Pipelines whose hazards are counted when MIPS_PIPELINES is not set,
+  // one per line:
+  // 5 Stages -> MIPS R2000 -> branch misprediction penalty = 1 cycle
+  // 7 Stages -> MIPS R10000 -> branch misprediction penalty = 5 cycles
+  // 13 Stages -> ARM Cortex A8 -> branch misprediction penalty = 13 cycles
+  static constexpr const char* kDefaultPipelines =
+    "-depth 5 -load-use 1 -hazard-distance 1 -branch-penalty 1\n"
+    "-depth 7 -load-use 2 -hazard-distance 3 -branch-penalty 5\n"
+    "-depth 13 -load-use 3 -hazard-distance 4 -branch-penalty 13\n";
+
+  // Reads the pipelines of MIPS_PIPELINES=file, one per line in the format
+  // of kDefaultPipelines, or the default ones. Options left out are those
+  // of a 5-stage pipeline; -forwarding 0 makes every read within the
+  // hazard distance of a write stall, not only those after a load, and
+  // -store-window (default the depth) is how many instructions a store
+  // takes to be written, through the pipeline and its store buffer. The
+  // hazards of all pipelines are counted in one pass over the
+  // instructions. Like the hierarchies, they are set up once for all
+  // forked experiments.
+  void SetUpPipelines() {
+    const char* path = std::getenv("MIPS_PIPELINES");
+    std::istringstream defaults(kDefaultPipelines);
+    std::ifstream file;
+    std::istream* in = &defaults;
+    std::string line, option;
+    long value;
+
+    if (path && *path) {
+      file.open(path);
+      if (!file) {
+        std::cerr << "MIPS: Could not read pipelines " << path << ".\n";
+        std::exit(EXIT_FAILURE);
+      }
+      in = &file;
+    }
+    while (std::getline(*in, line)) {
+      std::istringstream words(line);
+      Pipeline p{5, true, 1, 1, 1, 0};
+      bool store_window = false;
+
+      if (!(words >> option) || option[0] == '#')
+        continue;
+      do {
+        bool valid = static_cast<bool>(words >> value) && value >= 0;
+        if (option == "-depth")
+          p.depth = value;
+        else if (option == "-forwarding")
+          p.forwarding = value;
+        else if (option == "-load-use") {
+          p.load_use = value;
+          valid = valid && value >= 1 && value <= kNumberOfStoredInstructions;
+        }
+        else if (option == "-hazard-distance")
+          p.hazard_distance = value;
+        else if (option == "-branch-penalty")
+          p.branch_penalty = value;
+        else if (option == "-store-window") {
+          p.store_window = value;
+          store_window = true;
+        }
+        else
+          valid = false;
+        if (!valid) {
+          std::cerr << "MIPS: Pipeline #" << pipelines.size() << ": " << option
+                    << " is not valid (-load-use is at most " << kNumberOfStoredInstructions << ").\n";
+          std::exit(EXIT_FAILURE);
+        }
+      } while (words >> option);
+      if (!store_window)
+        p.store_window = p.depth;
+      pipelines.push_back(p);
+      max_load_use = std::max(max_load_use, p.forwarding ? p.load_use : 0);
+    }
+    if (pipelines.empty()) {
+      std::cerr << "MIPS: No pipeline in " << path << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    number_of_data_hazards.assign(pipelines.size(), 0);
+    number_of_control_hazards.assign(pipelines.size(), 0);
+    store_forwards.assign(pipelines.size(), 0);
+    store_stalls.assign(pipelines.size(), 0);
+    ordering_violations.assign(pipelines.size(), 0);
+    unsigned window = 0;
+    for (const Pipeline& p : pipelines)
+      window = std::max(window, p.store_window);
+    stores.init(window);
+  }
+
+  // Reads the predictors of MIPS_PREDICTORS=file, one per line in the
+  // format of mips_predictor::kDefaults, or the default ones; see mips_branch.H.
+  // MIPS_BTB_ENTRIES (default 512, with an optional k or M scale) and
+  // MIPS_RAS_ENTRIES (default 8) size the branch target buffer and the
+  // return address stack. Like the pipelines, they are set up once for
+  // all forked experiments.
+  void SetUpPredictors() {
+    const char* path = std::getenv("MIPS_PREDICTORS");
+    const char* btb_entries = std::getenv("MIPS_BTB_ENTRIES");
+    int lg2btb = Log2Scaled(btb_entries && *btb_entries ? btb_entries : "512");
+    unsigned long long ras_entries = GetEnvCount("MIPS_RAS_ENTRIES", 8);
+    std::istringstream defaults(mips_predictor::kDefaults);
+    std::ifstream file;
+    std::istream* in = &defaults;
+    std::string line, kind;
+
+    if (path && *path) {
+      file.open(path);
+      if (!file) {
+        std::cerr << "MIPS: Could not read predictors " << path << ".\n";
+        std::exit(EXIT_FAILURE);
+      }
+      in = &file;
+    }
+    while (std::getline(*in, line)) {
+      std::istringstream words(line);
+
+      if (!(words >> kind) || kind[0] == '#')
+        continue;
+      predictors.push_back(mips_predictor::create(line));
+      if (!predictors.back()) {
+        std::cerr << "MIPS: Predictor #" << predictors.size() - 1 << ": " << line
+                  << " is not valid. Kinds are static, saturating, two-level, bimodal, gshare, "
+                     "tournament and tage, with at most 2^24 entries.\n";
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    if (predictors.empty()) {
+      std::cerr << "MIPS: No predictor in " << path << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (lg2btb < 0 || lg2btb > 24 || !ras_entries || ras_entries > 65536) {
+      std::cerr << "MIPS: MIPS_BTB_ENTRIES must be a power of two up to 16M, and MIPS_RAS_ENTRIES "
+                   "between 1 and 65536.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    wrong_predictions.assign(predictors.size(), 0);
+    btb.init(lg2btb);
+    ras.init(ras_entries);
+  }
+
+  // Issue models whose groups are counted when MIPS_ISSUE is not set, one
+  // per line.
+  static constexpr const char* kDefaultIssueModels =
+    "-width 2 -alu 2 -muldiv 1 -memory 1 -branch 1\n"
+    "-width 4 -alu 4 -muldiv 1 -memory 2 -branch 1\n"
+    "-width 8 -alu 8 -muldiv 2 -memory 4 -branch 2\n";
+
+  // Reads the issue models of MIPS_ISSUE=file, one per line in the format
+  // of kDefaultIssueModels, or the default ones. A width left out is 2,
+  // and units left out are the width for the ALU and 1 for the others.
+  // The instructions of the groups above take their unit from it: mult,
+  // div and the moves from and to hi and lo the mul/div one, loads and
+  // stores the memory one, branches and jumps the branch one, and the
+  // other instructions listed the ALU; those not listed issue alone. Like
+  // the pipelines, they are set up once for all forked experiments.
+  void SetUpIssue() {
+    static const char* const options[kNumUnits] = {"-alu", "-muldiv", "-memory", "-branch"};
+    const char* path = std::getenv("MIPS_ISSUE");
+    std::istringstream defaults(kDefaultIssueModels);
+    std::ifstream file;
+    std::istream* in = &defaults;
+    std::string line, option;
+    long value;
+
+    if (path && *path) {
+      file.open(path);
+      if (!file) {
+        std::cerr << "MIPS: Could not read issue models " << path << ".\n";
+        std::exit(EXIT_FAILURE);
+      }
+      in = &file;
+    }
+    while (std::getline(*in, line)) {
+      std::istringstream words(line);
+      IssueModel m{2, {0, 1, 1, 1}, 0, {0, 0, 0, 0}, 0, 0, {}};
+
+      if (!(words >> option) || option[0] == '#')
+        continue;
+      do {
+        bool valid = static_cast<bool>(words >> value) && value >= 1 && value <= 64;
+        int u = std::find(options, options + kNumUnits, option) - options;
+        if (option == "-width")
+          m.width = value;
+        else if (u < kNumUnits)
+          m.units[u] = value;
+        else
+          valid = false;
+        if (!valid) {
+          std::cerr << "MIPS: Issue model #" << issue_models.size() << ": " << option
+                    << " is not valid (widths and units are between 1 and 64).\n";
+          std::exit(EXIT_FAILURE);
+        }
+      } while (words >> option);
+      if (!m.units[kAluUnit])
+        m.units[kAluUnit] = m.width;
+      m.groups.assign(m.width, 0);
+      issue_models.push_back(m);
+    }
+    if (issue_models.empty()) {
+      std::cerr << "MIPS: No issue model in " << path << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  // Turns the out-of-order window on if MIPS_OOO is set, to options
+  // among -rob, -queue and -width (default 128, 32 and 4), -mul and -div
+  // (the latencies of mult and div, default 4 and 20), -hierarchy (whose
+  // L1 data misses delay the loads, default 0), -predictor (whose
+  // mispredictions redirect the front end, default the last one) and
+  // -branch-penalty (default 10). Like the issue models, it is set up
+  // once for all forked experiments.
+  void SetUpOutOfOrder() {
+    const char* options = std::getenv("MIPS_OOO");
+    unsigned rob = 128, queue = 32, width = 4;
+    std::string option;
+    long value;
+
+    if (!kOutOfOrder || !options || !*options)
+      return;
+    std::istringstream words(options);
+    ooo_config.predictor = predictors.size() - 1;
+    while (words >> option) {
+      bool valid = static_cast<bool>(words >> value) && value >= 0 && value <= 4096;
+      if (option == "-rob")
+        rob = value;
+      else if (option == "-queue")
+        queue = value;
+      else if (option == "-width")
+        width = value;
+      else if (option == "-mul")
+        ooo_config.mul_latency = value;
+      else if (option == "-div")
+        ooo_config.div_latency = value;
+      else if (option == "-hierarchy")
+        valid &= (ooo_config.hierarchy = value) < cache_configurations.size();
+      else if (option == "-predictor")
+        valid &= (ooo_config.predictor = value) < predictors.size();
+      else if (option == "-branch-penalty")
+        ooo_config.branch_penalty = value;
+      else
+        valid = false;
+      if (!valid || !rob || !queue || !width || width > 64) {
+        std::cerr << "MIPS: MIPS_OOO: " << option << " is not valid (sizes are between 1 and 4096, "
+                     "widths at most 64, and hierarchies and predictors are numbered from 0).\n";
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    ooo.init(rob, queue, width);
+    out_of_order = true;
+  }
+
+  // Turns the limit study on if MIPS_ILP is set, to options among
+  // -window (instructions, default 0 for none), -memory (1 for the
+  // dependences through memory, default 0) and -GROUP, the latency of
+  // the instructions of an IGroup, in lower case: -arithlog, -divmult,
+  // -loadstore and so on (default 4 for divmult, 1 for the others). Set
+  // but empty, it studies the defaults.
+  void SetUpIlp() {
+    static const char* const names[] = {"arithlog", "divmult", "shift", "shiftv", "jumpr", "movefrom", "moveto",
+                                        "arithlogi", "loadi", "branch", "branchz", "loadstore", "jump", "trap"};
+    const char* options = std::getenv("MIPS_ILP");
+    unsigned window = 0;
+    bool memory = false;
+    std::string option;
+    long value;
+
+    if (!kOutOfOrder || !options)
+      return;
+    ilp_latencies.assign(Trap + 1, 1);
+    ilp_latencies[DivMult] = 4;
+    std::istringstream words(options);
+    while (words >> option) {
+      bool valid = static_cast<bool>(words >> value) && value >= 0 && value <= 1 << 20;
+      unsigned g = 0;
+
+      while (g <= Trap && option != std::string("-") + names[g])
+        g++;
+      if (option == "-window")
+        window = value;
+      else if (option == "-memory") {
+        valid &= value <= 1;
+        memory = value;
+      }
+      else if (g <= Trap)
+        ilp_latencies[g] = value;
+      else
+        valid = false;
+      if (!valid) {
+        std::cerr << "MIPS: MIPS_ILP: " << option << " is not valid (windows and latencies are between 0 and "
+                     "1048576, and -memory is 0 or 1).\n";
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    dataflow.init(window, memory);
+    ilp = true;
+  }
+
+  // Turns the branch and load profiles on if MIPS_PROFILE is set.
+  void SetUpProfile() {
+    unsigned long long entries = GetEnvCount("MIPS_PROFILE_ENTRIES", 4096);
+    unsigned lg2size = 2;
+
+    // Also what the out-of-order window is told about loads.
+    load_misses.resize(cache_configurations.size());
+    profile_top = GetEnvCount("MIPS_PROFILE", 0);
+    if (!profile_top)
+      return;
+    if (!entries || entries > (1U << 24)) {
+      std::cerr << "MIPS: MIPS_PROFILE_ENTRIES must be between 1 and 16M.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    // Three quarters of the table are used at most.
+    while ((1ULL << lg2size) / 4 * 3 < entries)
+      lg2size++;
+    branch_profile.init(lg2size, 2 + predictors.size());
+    load_profile.init(lg2size, 1 + pipelines.size() + cache_configurations.size());
+  }
+
+  // Turns the single-pass sweep on if MIPS_SWEEP_BSIZE is set. Like the
+  // hierarchies, it is set up once for all forked experiments.
+  void SetUpSweep() {
+    const char* bsize = std::getenv("MIPS_SWEEP_BSIZE");
+    const char* size = std::getenv("MIPS_SWEEP_SIZE");
+    unsigned long long assoc = GetEnvCount("MIPS_SWEEP_ASSOC", 8);
+    int lg2bsize, lg2size;
+
+    if (!bsize || !*bsize)
+      return;
+    lg2bsize = Log2Scaled(bsize);
+    lg2size = Log2Scaled(size && *size ? size : "64k");
+    if (lg2bsize < 2 || lg2size < lg2bsize || !assoc || assoc > 1024) {
+      std::cerr << "MIPS: MIPS_SWEEP_BSIZE must be a power of two of at least 4 bytes, at most "
+                   "MIPS_SWEEP_SIZE, and MIPS_SWEEP_ASSOC between 1 and 1024. Sweep disabled.\n";
+      return;
+    }
+    // The largest caches are direct mapped, the others need fewer sets.
+    instruction_sweep.init(lg2bsize, lg2size - lg2bsize, assoc);
+    data_sweep.init(lg2bsize, lg2size - lg2bsize, assoc);
+    sweep = true;
+  }
+
+  // Turns the reuse distances on if MIPS_REUSE_BSIZE is set. Like the
+  // sweep, they are set up once for all forked experiments. The children
+  // of MIPS_PARALLEL could not give their working sets back.
+  void SetUpReuse() {
+    const char* bsize = std::getenv("MIPS_REUSE_BSIZE");
+    const char* rate = std::getenv("MIPS_REUSE_RATE");
+    unsigned long long window = GetEnvCount("MIPS_REUSE_WINDOW", 0);
+    double fraction = rate && *rate ? std::strtod(rate, nullptr) : 1;
+    int lg2bsize;
+
+    if (!bsize || !*bsize)
+      return;
+    lg2bsize = Log2Scaled(bsize);
+    if (lg2bsize < 2 || !(fraction > 0 && fraction <= 1)) {
+      std::cerr << "MIPS: MIPS_REUSE_BSIZE must be a power of two of at least 4 bytes, and MIPS_REUSE_RATE "
+                   "more than 0 and at most 1. Reuse distances disabled.\n";
+      return;
+    }
+    if (window && GetEnvCount("MIPS_PARALLEL", 0)) {
+      std::cerr << "MIPS: MIPS_REUSE_WINDOW cannot be used with MIPS_PARALLEL. Working sets disabled.\n";
+      window = 0;
+    }
+    instruction_reuse.init(lg2bsize, fraction, window);
+    data_reuse.init(lg2bsize, fraction, window);
+    reuse = true;
+  }
+
+  // Turns the caches simulated in lanes on if MIPS_LANES is set. Like the
+  // sweep, they are set up once for all forked experiments.
+  void SetUpLanes() {
+    const char* list = std::getenv("MIPS_LANES");
+    const char* bsize = std::getenv("MIPS_LANES_BSIZE");
+    std::istringstream specs(list ? list : "");
+    std::string spec;
+    int lg2bsize;
+
+    if (!list || !*list)
+      return;
+    lg2bsize = Log2Scaled(bsize && *bsize ? bsize : "32");
+    if (lg2bsize < 2) {
+      std::cerr << "MIPS: MIPS_LANES_BSIZE must be a power of two of at least 4 bytes. Lanes disabled.\n";
+      return;
+    }
+    instruction_lanes.init(lg2bsize);
+    data_lanes.init(lg2bsize);
+    while (std::getline(specs, spec, ',')) {
+      std::istringstream fields(spec);
+      std::string size, assoc, policy = "lru";
+      mips_lanes::Policy p = mips_lanes::kLRU;
+      int lg2size, lg2assoc;
+
+      std::getline(fields, size, ':');
+      std::getline(fields, assoc, ':');
+      std::getline(fields, policy, ':');
+      lg2size = Log2Scaled(size);
+      lg2assoc = Log2Scaled(assoc);
+      if (policy == "fifo")
+        p = mips_lanes::kFIFO;
+      else if (policy == "random")
+        p = mips_lanes::kRandom;
+      else if (policy != "lru")
+        lg2size = -1;
+      if (lg2size < 0 || lg2assoc < 0 || lg2size < lg2bsize + lg2assoc ||
+          (1U << lg2assoc) > mips_lanes::kMaxWays) {
+        std::cerr << "MIPS: MIPS_LANES: " << spec << " is not SIZE:ASSOC[:lru|fifo|random] of powers of two, "
+                     "at least one block a way and at most " << mips_lanes::kMaxWays << " ways.\n";
+        std::exit(EXIT_FAILURE);
+      }
+      if (!instruction_lanes.add(lg2size - lg2bsize - lg2assoc, 1U << lg2assoc, p) ||
+          !data_lanes.add(lg2size - lg2bsize - lg2assoc, 1U << lg2assoc, p)) {
+        std::cerr << "MIPS: MIPS_LANES has more than " << mips_lanes::kMaxLanes << " caches.\n";
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    lanes = instruction_lanes.count() != 0;
+  }
+
+  // Turns the classification of the L1 misses on if MIPS_3C is set. A
+  // reference missed if it added to the misses Dinero counts for its
+  // access type.
+  void SetUpClassification() {
+    unsigned long long period = GetEnvCount("MIPS_3C", 0);
+
+    if (!period)
+      return;
+    if ((period & (period - 1)) || period > (1U << 30)) {
+      std::cerr << "MIPS: MIPS_3C must be a power of two. Classification disabled.\n";
+      return;
+    }
+    if (coherent) {
+      std::cerr << "MIPS: MIPS_3C cannot be used with MIPS_COHERENCE. Classification disabled.\n";
+      return;
+    }
+    for (CacheConfiguration& c : cache_configurations)
+      for (std::pair<d4cache*, mips_3c*> l1 : {std::make_pair(c.instruction_l1_cache, &c.instruction_3c),
+                                               std::make_pair(c.data_l1_cache, &c.data_3c)})
+        l1.second->init(l1.first->lg2blocksize, l1.first->numsets, l1.first->assoc, period);
+    classify = true;
+  }
+
+  // Keeps the fetches for the layout of the functions if MIPS_LAYOUT is
+  // set, in blocks of the smallest L1I, up to MIPS_LAYOUT_LIMIT of them
+  // (default 16777216, 64 MB).
+  void SetUpLayout() {
+    unsigned lg2bsize = 31;
+
+    if (!GetEnvCount("MIPS_LAYOUT", 0))
+      return;
+    if (!kCaches || cache_configurations.empty()) {
+      std::cerr << "MIPS: MIPS_LAYOUT needs the cache simulation. Layout disabled.\n";
+      return;
+    }
+    for (const CacheConfiguration& c : cache_configurations)
+      lg2bsize = std::min(lg2bsize, (unsigned) c.instruction_l1_cache->lg2blocksize);
+    layout.init(lg2bsize, GetEnvCount("MIPS_LAYOUT_LIMIT", 1 << 24));
+  }
+
+  void InitLayoutFile(const std::string& default_path) {
+    const char* path = std::getenv("MIPS_LAYOUT_FILE");
+
+    layout_path = path && *path ? path : default_path;
+  }
+
+  // Finds the conflicts between functions in the L1I of each hierarchy,
+  // the order of the conflicts of them all, and the misses of each with
+  // the functions in that order, and writes the order, a function a line.
+  void AnalyzeLayout() {
+    std::vector<mips_layout::Pair> pairs;
+    std::vector<uint32_t> starts;
+    FILE* f;
+
+    if (!layout.enabled() || !layout.entries())
+      return;
+    layout.assign([](uint32_t address, mips_layout::Function& function) {
+      unsigned offset, size;
+      const char* name = ac_symbol_at(address, &offset, &size);
+
+      if (!name)
+        return false;
+      function.start = address - offset;
+      function.size = size;
+      function.name = name;
+      return true;
+    });
+    layout_before.clear();
+    for (const CacheConfiguration& c : cache_configurations) {
+      const d4cache* l1 = c.instruction_l1_cache;
+
+      layout_before.push_back(layout.replay({(unsigned) l1->lg2blocksize, (unsigned) l1->numsets,
+                                             (unsigned) l1->assoc}, nullptr));
+      pairs.insert(pairs.end(), layout_before.back().pairs.begin(), layout_before.back().pairs.end());
+    }
+    // The pairs of every hierarchy, added up
+    std::sort(pairs.begin(), pairs.end(), [](const mips_layout::Pair& x, const mips_layout::Pair& y) {
+      return x.a != y.a ? x.a < y.a : x.b < y.b;
+    });
+    size_t n = 0;
+    for (size_t i = 0; i < pairs.size(); i++)
+      if (n && pairs[n - 1].a == pairs[i].a && pairs[n - 1].b == pairs[i].b)
+        pairs[n - 1].misses += pairs[i].misses;
+      else
+        pairs[n++] = pairs[i];
+    pairs.resize(n);
+    std::stable_sort(pairs.begin(), pairs.end(), [](const mips_layout::Pair& x, const mips_layout::Pair& y) {
+      return x.misses > y.misses;
+    });
+    layout_order = layout.order(pairs);
+    starts = layout.starts(layout_order);
+    layout_after.clear();
+    for (const CacheConfiguration& c : cache_configurations) {
+      const d4cache* l1 = c.instruction_l1_cache;
+
+      layout_after.push_back(layout.replay({(unsigned) l1->lg2blocksize, (unsigned) l1->numsets,
+                                            (unsigned) l1->assoc}, &starts));
+    }
+    f = fopen(layout_path.c_str(), "w");
+    if (f)
+      for (unsigned k : layout_order)
+        fprintf(f, "%s\n", layout.function_list()[k].name.c_str());
+    if (!f || fclose(f) != 0)
+      std::cerr << "MIPS: Could not write the link order to " << layout_path << ".\n";
+  }
+
+  // Turns the TLBs on if MIPS_TLB is set, to options: -i-entries and
+  // -d-entries (default 32 and 64), -i-assoc and -d-assoc (default fully
+  // associative), -page (default 4k), -walk-penalty in cycles (default
+  // 30), -walk-references (0, the default, 1 for a linear page table or 2
+  // for a two-level one) and -walk-base, the address of the page table.
+  void SetUpTLBs() {
+    const char* options = std::getenv("MIPS_TLB");
+    unsigned entries[2] = {32, 64}, assoc[2] = {0, 0};
+    int lg2page = 12;
+    std::string option, value;
+
+    if (!options || !*options)
+      return;
+    std::istringstream words(options);
+    while (words >> option) {
+      char* end;
+      unsigned long n;
+      bool valid = static_cast<bool>(words >> value);
+
+      n = std::strtoul(value.c_str(), &end, 0);
+      valid &= !value.empty() && !*end;
+      if (option == "-i-entries" || option == "-d-entries")
+        entries[option[1] == 'd'] = n;
+      else if (option == "-i-assoc" || option == "-d-assoc")
+        assoc[option[1] == 'd'] = n;
+      else if (option == "-page")
+        valid = (lg2page = Log2Scaled(value)) >= 12 && lg2page <= 28;
+      else if (option == "-walk-penalty")
+        walk_penalty = n;
+      else if (option == "-walk-references")
+        valid &= (walk_references = n) <= 2;
+      else if (option == "-walk-base")
+        walk_base = n;
+      else
+        valid = false;
+      if (!valid) {
+        std::cerr << "MIPS: MIPS_TLB: " << option << " " << value << " is not valid. TLBs disabled.\n";
+        return;
+      }
+    }
+    for (int t = 0; t < 2; t++) {
+      if (!assoc[t])
+        assoc[t] = entries[t];
+      if (!entries[t] || entries[t] > (1U << 16) || entries[t] % assoc[t] ||
+          ((entries[t] / assoc[t]) & (entries[t] / assoc[t] - 1))) {
+        std::cerr << "MIPS: MIPS_TLB: the entries must be at most 64k, in a power of two of sets. TLBs disabled.\n";
+        return;
+      }
+    }
+    instruction_tlb.init(entries[0], assoc[0], lg2page);
+    data_tlb.init(entries[1], assoc[1], lg2page);
+    tlbs = true;
+  }
+
+  // Puts the loop buffer and fetch queue of MIPS_FETCH in front of the L1
+  // instruction caches: -loop-buffer N instructions (0 for none, the
+  // default), -fetch-width bytes read at a time (default 4), -queue N
+  // instructions read ahead (default 0) and -loop-energy pJ of each fetch
+  // from the loop buffer.
+  void SetUpFetch() {
+    const char* options = std::getenv("MIPS_FETCH");
+    unsigned loop = 0, depth = 0;
+    int lg2width = 2;
+    std::string option, value;
+
+    if (!options || !*options)
+      return;
+    std::istringstream words(options);
+    while (words >> option) {
+      char* end;
+      unsigned long n;
+      bool valid = static_cast<bool>(words >> value);
+
+      n = std::strtoul(value.c_str(), &end, 0);
+      valid &= !value.empty() && !*end;
+      if (option == "-loop-buffer")
+        valid &= (loop = n) <= mips_fetch::max_capacity();
+      else if (option == "-fetch-width")
+        valid = (lg2width = Log2Scaled(value)) >= 2 && lg2width <= 6;
+      else if (option == "-queue")
+        valid &= (depth = n) <= 64;
+      else if (option == "-loop-energy")
+        valid = (loop_energy = std::strtod(value.c_str(), &end)) >= 0 && !value.empty() && !*end;
+      else
+        valid = false;
+      if (!valid) {
+        std::cerr << "MIPS: MIPS_FETCH: " << option << " " << value << " is not valid. Front end disabled.\n";
+        return;
+      }
+    }
+    // A read of the queue is one Dinero IV reference, within a block
+    for (const CacheConfiguration& c : cache_configurations)
+      for (const d4cache* l1 : c.instruction_l1_caches)
+        if (lg2width > l1->lg2subblocksize) {
+          std::cerr << "MIPS: MIPS_FETCH: -fetch-width is larger than the blocks of an L1 instruction cache. "
+                       "Front end disabled.\n";
+          return;
+        }
+    frontend.init(loop, lg2width, depth);
+  }
+
+  // Sets the value predictors of MIPS_VALUES up. A replayed trace has no
+  // values to give them.
+  void SetUpValues() {
+    unsigned long long entries = GetEnvCount("MIPS_VALUES", 0);
+    unsigned long long contexts = GetEnvCount("MIPS_VALUES_CONTEXT", 4 * entries);
+    const char* replay = std::getenv("MIPS_REPLAY");
+
+    if (!entries)
+      return;
+    if (replay && *replay) {
+      std::cerr << "MIPS: Traces hold no loaded values. MIPS_VALUES disabled.\n";
+      return;
+    }
+    if ((entries & (entries - 1)) || entries > (1U << 24) || !contexts || (contexts & (contexts - 1)) ||
+        contexts > (1U << 26)) {
+      std::cerr << "MIPS: MIPS_VALUES and MIPS_VALUES_CONTEXT must be powers of two, up to 16M and 64M. "
+                   "Value prediction disabled.\n";
+      return;
+    }
+    values.init(entries, contexts);
+  }
+
+  // Turns the coherence of per-processor L1s on if MIPS_COHERENCE is set.
+  void SetUpCoherence() {
+    const char* protocol = std::getenv("MIPS_COHERENCE");
+
+    if (!protocol || !*protocol)
+      return;
+#if D4CUSTOM
+    std::cerr << "MIPS: MIPS_COHERENCE needs a Dinero IV that is not customized.\n";
+    std::exit(EXIT_FAILURE);
+#endif
+    if (std::strcmp(protocol, "mesi") && std::strcmp(protocol, "moesi")) {
+      std::cerr << "MIPS: MIPS_COHERENCE must be mesi or moesi.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    for (auto& cache_configuration : cache_configurations) {
+      if (cache_configuration.stages) {
+        std::cerr << "MIPS: Victim caches, write buffers and inclusion cannot be used with MIPS_COHERENCE."
+                     " Stages disabled.\n";
+        cache_configuration.stages->detach();
+        cache_configuration.stages.reset();
+      }
+      cache_configuration.coherence.init(std::strcmp(protocol, "mesi") ? mips_coherence::kMOESI
+                                                                       : mips_coherence::kMESI);
+      cache_configuration.coherence.add_core(cache_configuration.data_l1_cache);
+    }
+    coherent = true;
+  }
+
+  // Reads MIPS_CORES=file, before the hierarchies are set up: a line for
+  // each processor, in the order they start, of the options -pipeline N
+  // and -predictor N, the positions of its pipeline in MIPS_PIPELINES and
+  // of its predictor in MIPS_PREDICTORS (from 0, the default), and the
+  // options of MIPS_CACHES for its L1s in every hierarchy: -l1-isize,
+  // -l1-iassoc, -l1-irepl, -l1-ifetch, -l1-iwalloc, -l1-iwback and those of
+  // -l1-d. The L1 options a line does not set are those of the first
+  // processor, and the block sizes those of MIPS_CACHES, as coherence
+  // needs.
+  void SetUpCores() {
+    static const char* const kL1Options[] = {"size", "assoc", "repl", "fetch", "walloc", "wback"};
+    const char* path = std::getenv("MIPS_CORES");
+    std::ifstream file;
+    std::string line, option, value;
+
+    if (!path || !*path)
+      return;
+#if D4CUSTOM
+    std::cerr << "MIPS: MIPS_CORES needs a Dinero IV that is not customized.\n";
+    std::exit(EXIT_FAILURE);
+#endif
+    file.open(path);
+    if (!file) {
+      std::cerr << "MIPS: Could not read cores " << path << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    while (std::getline(file, line)) {
+      std::istringstream words(line);
+      CoreConfiguration k;
+
+      if (!(words >> option) || option[0] == '#')
+        continue;
+      do {
+        bool valid = false;
+        char* end;
+
+        value.clear();
+        words >> value;
+        if (option == "-pipeline" || option == "-predictor") {
+          long n = std::strtol(value.c_str(), &end, 10);
+
+          valid = !value.empty() && !*end && n >= 0;
+          (option == "-pipeline" ? k.pipeline : k.predictor) = n;
+        }
+        else if (option.compare(0, 5, "-l1-i") == 0 || option.compare(0, 5, "-l1-d") == 0)
+          for (const char* name : kL1Options)
+            valid |= option.substr(5) == name && !value.empty();
+        if (!valid) {
+          std::cerr << "MIPS: Core #" << core_configurations.size() << ": " << option << " " << value
+                    << " is not valid.\n";
+          std::exit(EXIT_FAILURE);
+        }
+        if (option[1] == 'l')
+          k.l1_options.push_back({option, value});
+      } while (words >> option);
+      core_configurations.push_back(k);
+    }
+    if (core_configurations.empty()) {
+      std::cerr << "MIPS: No core in " << path << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  // Checks the cores of MIPS_CORES against the pipelines, the predictors
+  // and the coherence set up after them.
+  void CheckCores() {
+    if (core_configurations.empty())
+      return;
+    if (!coherent) {
+      std::cerr << "MIPS: MIPS_CORES needs MIPS_COHERENCE, which gives each processor its own L1s.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    for (unsigned k = 0; k < core_configurations.size(); k++)
+      if (core_configurations[k].pipeline >= pipelines.size() ||
+          core_configurations[k].predictor >= predictors.size()) {
+        std::cerr << "MIPS: Core #" << k << " has pipeline " << core_configurations[k].pipeline
+                  << " and predictor " << core_configurations[k].predictor << ", of "
+                  << pipelines.size() << " and " << predictors.size() << ".\n";
+        std::exit(EXIT_FAILURE);
+      }
+  }
+
+  // Gives instruction and data, the L1s of core k in the hierarchy c, the
+  // options of its line of MIPS_CORES.
+  void SetCoreCaches(const CacheConfiguration& c, d4cache* instruction, d4cache* data, unsigned k) {
+    CacheConfiguration l1s = c;
+
+    l1s.instruction_l1_cache = instruction;
+    l1s.data_l1_cache = data;
+    for (const auto& option : core_configurations[k].l1_options)
+      if (!SetCacheOption(l1s, option.first, option.second)) {
+        std::cerr << "MIPS: Core #" << k << ": " << option.first << " " << option.second << " is not valid.\n";
+        std::exit(EXIT_FAILURE);
+      }
+  }
+
+  // A cache over the same downstream one as model, with its parameters.
+  static d4cache* NewPeerCache(const d4cache* model) {
+    d4cache* c = d4new(model->downstream);
+
+    c->flags = model->flags;
+    c->lg2blocksize = model->lg2blocksize;
+    c->lg2subblocksize = model->lg2subblocksize;
+    c->lg2size = model->lg2size;
+    c->assoc = model->assoc;
+    c->replacementf = model->replacementf;
+    c->name_replacement = model->name_replacement;
+    c->prefetchf = model->prefetchf;
+    c->name_prefetch = model->name_prefetch;
+    c->prefetch_distance = model->prefetch_distance;
+    c->prefetch_abortpercent = model->prefetch_abortpercent;
+    c->wallocf = model->wallocf;
+    c->name_walloc = model->name_walloc;
+    c->wbackf = model->wbackf;
+    c->name_wback = model->name_wback;
+    return c;
+  }
+
+  // Called as each processor starts, with its ISA. When coherent, the
+  // processors after the first get L1s like those of the first.
+  void AddCore(const void* isa) {
+    DrainAnalysis();
+    cores.push_back(isa);
+    if (!core_configurations.empty()) {
+      if (cores.size() > core_configurations.size()) {
+        std::cerr << "MIPS: MIPS_CORES has no line for processor #" << cores.size() - 1
+                  << "; it is like the first one.\n";
+        core_configurations.push_back(core_configurations[0]);
+      }
+      core_counters.push_back(CoreCounters{0, 0, 0, 0});
+    }
+    if (!coherent || cores.size() == 1)
+      return;
+    if (cores.size() > mips_coherence::kMaxCores) {
+      std::cerr << "MIPS: MIPS_COHERENCE supports " << mips_coherence::kMaxCores << " processors.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    DrainReferences();
+    for (auto& cache_configuration : cache_configurations) {
+      cache_configuration.instruction_l1_caches.push_back(NewPeerCache(cache_configuration.instruction_l1_cache));
+      cache_configuration.data_l1_caches.push_back(NewPeerCache(cache_configuration.data_l1_cache));
+      if (cores.size() <= core_configurations.size())
+        SetCoreCaches(cache_configuration, cache_configuration.instruction_l1_caches.back(),
+                      cache_configuration.data_l1_caches.back(), cores.size() - 1);
+      cache_configuration.last_fetches.push_back(kNoFetch);
+      if (d4setupin(cache_configuration.context)) {
+        std::cerr << "Error on cache setup. I'm calling std::exit(EXIT_FAILURE).\n";
+        std::exit(EXIT_FAILURE);
+      }
+      cache_configuration.coherence.add_core(cache_configuration.data_l1_caches.back());
+      if (cache_configuration.contention)
+        cache_configuration.contention->add_core(cache_configuration.instruction_l1_caches.back(),
+                                                 cache_configuration.data_l1_caches.back());
+    }
+  }
+
+  // Makes the processor with that ISA the one whose references follow.
+  void SetCore(const void* isa) {
+    if (!kAnyAnalysis)
+      return;
+    unsigned& c = Queued() ? event.core : core;
+
+    if (coherent && cores[c] != isa)
+      c = std::find(cores.begin(), cores.end(), isa) - cores.begin();
+  }
+
+  // Writes the C source of a Dinero IV specialized for the hierarchies
+  // set up, with their lines as the defaults of the simulator it will be
+  // linked into. Returns false if it could not be written.
+  bool WriteCustomization(const char* path) {
+    FILE* f = fopen(path, "w");
+    std::istringstream lines(cache_configuration_lines);
+    std::string line;
+
+    if (!f)
+      return false;
+    d4customize(f);
+    fprintf(f, "\nconst char mips_d4custom_caches[] =\n");
+    while (std::getline(lines, line)) {
+      fputs("  \"", f);
+      for (char ch : line) {
+        if (ch == '"' || ch == '\\')
+          fputc('\\', f);
+        fputc(ch, f);
+      }
+      fputs("\\n\"\n", f);
+    }
+    fprintf(f, "  ;\n");
+    return fclose(f) == 0;
+  }
+
+  // Reads the analysis settings from the environment. Called when the
+  // first processor starts, so each job of a batch run gets its own.
+  void InitAnalysis() {
+    const char* path = std::getenv("MIPS_TRACE");
+    const char* branch_path = std::getenv("MIPS_BRANCH_TRACE");
+    const char* fork_list = std::getenv("MIPS_FORK");
+
+    SetUpCores();
+    SetUpCaches();
+    SetUpPipelines();
+    SetUpPredictors();
+    SetUpValues();
+    SetUpIssue();
+    SetUpOutOfOrder();
+    SetUpIlp();
+    SetUpProfile();
+    SetUpSweep();
+    SetUpLanes();
+    SetUpReuse();
+    SetUpCoherence();
+    CheckCores();
+    SetUpClassification();
+    SetUpLayout();
+    SetUpTLBs();
+    SetUpFetch();
+    parallel.length = GetEnvCount("MIPS_PARALLEL", 0);
+    if (parallel.length && coherent) {
+      std::cerr << "MIPS: MIPS_PARALLEL cannot be used with MIPS_COHERENCE. Intervals run in line.\n";
+      parallel.length = 0;
+    }
+    if (parallel.length && (fork_list && *fork_list)) {
+      std::cerr << "MIPS: MIPS_PARALLEL cannot be used with MIPS_FORK. Intervals run in line.\n";
+      parallel.length = 0;
+    }
+    // The helper threads would not be running in the children.
+    if (parallel.length && (GetEnvCount("MIPS_CACHE_THREAD", 0) || GetEnvCount("MIPS_ANALYSIS_THREAD", 0))) {
+      std::cerr << "MIPS: MIPS_CACHE_THREAD and MIPS_ANALYSIS_THREAD cannot be used with MIPS_PARALLEL. "
+                   "Analysis run in line.\n";
+    }
+    else if (GetEnvCount("MIPS_CACHE_THREAD", 0)) {
+      // The out-of-order window and the load profile need the outcome of
+      // each load at once.
+      if (out_of_order || profile_top)
+        std::cerr << "MIPS: MIPS_CACHE_THREAD cannot be used with " << (out_of_order ? "MIPS_OOO" : "MIPS_PROFILE")
+                  << ". Caches simulated in line.\n";
+      else if (!references.start(SimulateReferences, this))
+        std::cerr << "MIPS: Could not start the cache thread. Caches simulated in line.\n";
+    }
+    if (!parallel.length && GetEnvCount("MIPS_ANALYSIS_THREAD", 0)) {
+      // The children of MIPS_FORK would be forked by the worker.
+      if (fork_list && *fork_list)
+        std::cerr << "MIPS: MIPS_ANALYSIS_THREAD cannot be used with MIPS_FORK. Analysis run in line.\n";
+      else if (!events.start(AnalyzeEvents, this))
+        std::cerr << "MIPS: Could not start the analysis thread. Analysis run in line.\n";
+    }
+
+    if (fork_list && *fork_list) {
+      ReadExperiments(fork_list);
+      if (path && *path) {
+        std::cerr << "MIPS: MIPS_TRACE cannot be used with MIPS_FORK. Trace disabled.\n";
+        path = nullptr;
+      }
+      if (branch_path && *branch_path) {
+        std::cerr << "MIPS: MIPS_BRANCH_TRACE cannot be used with MIPS_FORK. Branch trace disabled.\n";
+        branch_path = nullptr;
+      }
+    }
+    InitSampling();
+    InitIntervals("mips_intervals.csv");
+    InitLive();
+    InitConvergence();
+    InitHotSpots("mips_hotspots.folded");
+    InitLoops("mips_loops.txt");
+    InitBbv("mips.bb");
+    InitReuseFile("mips_reuse.csv");
+    InitLayoutFile("mips_layout.txt");
+    InitParallel();
+    InitWarmState();
+    InitRegionOfInterest();
+    if (parallel.length && ((path && *path) || (branch_path && *branch_path))) {
+      std::cerr << "MIPS: MIPS_TRACE and MIPS_BRANCH_TRACE cannot be used with MIPS_PARALLEL. Traces disabled.\n";
+      path = branch_path = nullptr;
+    }
+    if (path && *path) {
+      trace = new mips_trace_writer;
+      if (!trace->open(path)) {
+        std::cerr << "MIPS: Could not create trace " << path << ".\n";
+        delete trace;
+        trace = nullptr;
+      }
+    }
+    if (branch_path && *branch_path) {
+      branch_trace = new mips_branch_trace_writer;
+      if (!branch_trace->open(branch_path)) {
+        std::cerr << "MIPS: Could not create branch trace " << branch_path << ".\n";
+        delete branch_trace;
+        branch_trace = nullptr;
+      }
+    }
+  }
+
+  void ReadExperiments(const char* path) {
+    std::ifstream in(path);
+    std::string line, word;
+
+    if (!in) {
+      std::cerr << "MIPS: Could not read experiment list " << path << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    experiments.clear();
+    while (std::getline(in, line)) {
+      std::istringstream words(line);
+      Experiment e;
+
+      if (!(words >> e.name) || e.name[0] == '#')
+        continue;
+      while (words >> word) {
+        if (word.find('=') == std::string::npos) {
+          std::cerr << "MIPS: Experiment " << e.name << ": " << word << " is not VAR=value.\n";
+          std::exit(EXIT_FAILURE);
+        }
+        e.env.push_back(word);
+      }
+      experiments.push_back(e);
+    }
+    fork_pending = !experiments.empty();
+  }
+
+  // Forks the experiments. Only the children return, each one set up as
+  // its line of the list asks; the parent waits for them and exits.
+  void ForkExperiments() {
+    unsigned failed;
+    int i;
+
+    fork_pending = false;
+    i = ac_fork_experiments(experiments.size(),
+                            GetEnvCount("MIPS_FORK_JOBS", sysconf(_SC_NPROCESSORS_ONLN)), failed);
+    if (i < 0) {
+      std::cerr << "MIPS: " << experiments.size() - failed << " of " << experiments.size()
+                << " experiments completed.\n";
+      std::exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    const Experiment& e = experiments[i];
+    ac_fork_private_files(0);
+    if (!ac_fork_redirect(e.name.c_str())) {
+      std::cerr << "MIPS: Could not create the output files of experiment " << e.name << ".\n";
+      std::_Exit(EXIT_FAILURE);
+    }
+    for (const std::string& v : e.env)
+      putenv(strdup(v.c_str()));
+    InitSampling();
+    InitIntervals(e.name + ".intervals.csv");
+    InitHotSpots(e.name + ".folded");
+    InitLoops(e.name + ".loops.txt");
+    InitBbv(e.name + ".bb");
+    InitReuseFile(e.name + ".reuse.csv");
+    InitLayoutFile(e.name + ".layout.txt");
+  }
+
+  void CloseTrace() {
+    if (trace && !trace->close())
+      std::cerr << "MIPS: Could not write the whole trace.\n";
+    delete trace;
+    trace = nullptr;
+    if (branch_trace && !branch_trace->close())
+      std::cerr << "MIPS: Could not write the whole branch trace.\n";
+    delete branch_trace;
+    branch_trace = nullptr;
+  }
+
+  // Calls what the instruction, format, load and store behaviors would
+  // for r, a record of a trace or of the analysis thread.
+  void Analyze(const mips_trace::Record& r) {
+    switch (r.event) {
+    case mips_trace::kInstruction:
+      replayed = UnpackInstruction(r.format, r.word);
+      Fetch(r.pc, r.npc);
+      push(replayed);
+      testSuperscalar();
+      if (r.access == mips_trace::kLoad)
+        SimulateLoadDataFromCaches(r.address, AccessSize(replayed.op), r.value);
+      else if (r.access == mips_trace::kStore)
+        SimulateStoreDataInCaches(r.address, AccessSize(replayed.op));
+      break;
+    case mips_trace::kLoad:
+      SimulateLoadDataFromCaches(r.address, AccessSize(replayed.op), r.value);
+      break;
+    case mips_trace::kStore:
+      SimulateStoreDataInCaches(r.address, AccessSize(replayed.op));
+      break;
+    default:
+      SetRegionOfInterest(r.event == mips_trace::kRoiBegin);
+      break;
+    }
+  }
+
+  // Runs the analysis from a trace. Returns false if the trace is bad.
+  bool Replay(const char* path) {
+    mips_trace_reader in;
+    mips_trace::Record r;
+
+    if (!in.open(path)) {
+      std::cerr << "MIPS: " << path << " is not a trace.\n";
+      return false;
+    }
+    while (in.next(r))
+      Analyze(r);
+    if (!in.ok())
+      std::cerr << "MIPS: Trace " << path << " is truncated.\n";
+    return in.ok();
+  }
+
+  void InitSampling() {
+    sampling.enabled = false;
+    sampling.period = GetEnvCount("MIPS_SAMPLE_PERIOD", 0);
+    if (!sampling.period)
+      return;
+    sampling.warmup = GetEnvCount("MIPS_SAMPLE_WARMUP", sampling.warmup);
+    sampling.measure = GetEnvCount("MIPS_SAMPLE_MEASURE", sampling.measure);
+    sampling.warm_caches = GetEnvCount("MIPS_SAMPLE_WARM_CACHES", 0) != 0;
+    if (!sampling.measure || sampling.warmup + sampling.measure > sampling.period) {
+      std::cerr << "MIPS: MIPS_SAMPLE_WARMUP + MIPS_SAMPLE_MEASURE must be at most MIPS_SAMPLE_PERIOD, "
+                   "with a non-empty measurement window. Sampling disabled.\n";
+      return;
+    }
+    sampling.enabled = true;
+    sampling.sum.assign(NumMetrics(), 0);
+    sampling.sum_sq.assign(NumMetrics(), 0);
+    sampling.weights = sampling.weights_sq = 0;
+    sampling.target = GetEnvCount("MIPS_SAMPLE_TARGET_MIPS", 0) * 1e6;
+    sampling.max_period = GetEnvCount("MIPS_SAMPLE_MAX_PERIOD", 100 * sampling.period);
+    sampling.max_period = std::max(sampling.max_period, sampling.period);
+    sampling.current = sampling.shortest = sampling.longest = sampling.period;
+    sampling.detailed = 0;
+    sampling.fast_cost = sampling.detailed_cost = 0;
+    sampling.fast_seconds = sampling.seconds = 0;
+    // Starts as if a measurement had just ended.
+    sampling.phase = Sampling::kMeasure;
+    sampling.left = 0;
+    GetMetrics(sampling.start);
+  }
+
+  static double HostSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // Sets the period starting from the host time of the one that ended,
+  // fast seconds of fast forward out of seconds. The costs of an
+  // instruction with and without analysis are smoothed over the periods,
+  // and the next one is as long as the share of it analyzed in detail
+  // allows for the target rate. It stays between the warm-up and
+  // measurement and MIPS_SAMPLE_MAX_PERIOD (default 100 times
+  // MIPS_SAMPLE_PERIOD).
+  void AdaptPeriod(double fast, double seconds) {
+    unsigned long long length = sampling.warmup + sampling.measure, fast_length = sampling.current - length;
+    double detailed = (seconds - fast) / length, share;
+
+    sampling.detailed_cost = sampling.detailed_cost ? 0.75 * sampling.detailed_cost + 0.25 * detailed : detailed;
+    if (fast_length)
+      sampling.fast_cost = sampling.fast_cost ? 0.75 * sampling.fast_cost + 0.25 * fast / fast_length
+                                              : fast / fast_length;
+    // The share of the instructions analyzed that costs 1 / target each on
+    // average; with no fast forward yet, a guess of a tenth of the cost.
+    double fast_cost = sampling.fast_cost ? sampling.fast_cost : sampling.detailed_cost / 10;
+    if (sampling.detailed_cost <= fast_cost)
+      share = 1;
+    else
+      share = (1 / sampling.target - fast_cost) / (sampling.detailed_cost - fast_cost);
+    share = std::min(1.0, std::max(share, (double) length / sampling.max_period));
+    sampling.current = std::min(sampling.max_period, (unsigned long long) std::llround(length / share));
+    sampling.shortest = std::min(sampling.shortest, sampling.current);
+    sampling.longest = std::max(sampling.longest, sampling.current);
+  }
+
+  // Starts the interval statistics, written to default_path unless
+  // MIPS_INTERVAL_FILE is set.
+  void InitIntervals(const std::string& default_path) {
+    const char* path = std::getenv("MIPS_INTERVAL_FILE");
+
+    intervals.length = GetEnvCount("MIPS_INTERVAL", 0);
+    if (!intervals.length)
+      return;
+    intervals.limit = GetEnvCount("MIPS_INTERVAL_LIMIT", 10000);
+    intervals.path = path && *path ? path : default_path;
+    intervals.left = intervals.length;
+    intervals.count = 0;
+    intervals.snapshots.assign((intervals.limit + 1) * NumPrintedMetrics(), 0);
+    GetMetrics(intervals.metrics);
+    std::copy_n(intervals.metrics.begin(), NumPrintedMetrics(), intervals.snapshots.begin());
+  }
+
+  // Saves the counters at the end of an interval, unless the buffer is
+  // full.
+  void EndInterval() {
+    const int width = NumPrintedMetrics();
+
+    intervals.left = intervals.length - 1;
+    if (intervals.count == intervals.limit) {
+      std::cerr << "MIPS: More than MIPS_INTERVAL_LIMIT intervals. The rest are left out.\n";
+      intervals.length = 0;
+      return;
+    }
+    GetMetrics(intervals.metrics);
+    std::copy_n(intervals.metrics.begin(), width, intervals.snapshots.begin() + ++intervals.count * width);
+  }
+
+  void InitHotSpots(const std::string& default_path) {
+    const char* path = std::getenv("MIPS_HOTSPOTS_FILE");
+
+    hot_spots.init(GetEnvCount("MIPS_HOTSPOTS", 0));
+    hot_spots_path = path && *path ? path : default_path;
+    hot_spots_cycles = kOutOfOrder && out_of_order ? ooo.cycles() : 0;
+    if (hot_spots.enabled() && !kBranches)
+      std::cerr << "MIPS: Built without the branch analysis, MIPS_HOTSPOTS has no call stacks.\n";
+  }
+
+  void InitLoops(const std::string& default_path) {
+    const char* path = std::getenv("MIPS_LOOPS_FILE");
+
+    loops_top = GetEnvCount("MIPS_LOOPS", 0);
+    loops.init(loops_top != 0);
+    loops_path = path && *path ? path : default_path;
+    if (loops.enabled() && !kBranches)
+      std::cerr << "MIPS: Built without the branch analysis, MIPS_LOOPS takes calls for loop exits.\n";
+  }
+
+  // Counts the instruction at pc in the loops, with the L1 misses of the
+  // first hierarchy and the mispredictions of the first predictor.
+  void StepLoops(unsigned pc) {
+    double misses = 0;
+
+    if (kCaches && !cache_configurations.empty()) {
+      const CacheConfiguration& c = cache_configurations[0];
+
+      for (const d4cache* i : c.instruction_l1_caches)
+        misses += i->miss[D4XINSTRN];
+      for (const d4cache* d : c.data_l1_caches)
+        misses += d->miss[D4XREAD] + d->miss[D4XWRITE];
+    }
+    loops.step(pc, misses, kBranches && !wrong_predictions.empty() ? wrong_predictions[0] : 0);
+  }
+
+  // Samples the call stack at pc, in the function of the symbol table
+  // holding it.
+  void SampleHotSpot(unsigned pc) {
+    unsigned offset;
+    unsigned long long weight = hot_spots.period();
+
+    if (kOutOfOrder && out_of_order) {
+      weight = ooo.cycles() - hot_spots_cycles;
+      hot_spots_cycles = ooo.cycles();
+    }
+    hot_spots.sample(ac_symbol_at(pc, &offset) ? pc - offset : pc, weight);
+  }
+
+  void InitLive() {
+    live.length = ac_stats_listening() ? GetEnvCount("MIPS_LIVE_INTERVAL", 10000000) : 0;
+    live.left = live.length;
+    if (live.length)
+      ReadLive(live.cycles, live.instructions, live.accesses, live.misses);
+  }
+
+  void InitConvergence() {
+    const char* tolerance = std::getenv("MIPS_CONVERGE_TOLERANCE");
+    const char* stop = std::getenv("MIPS_CONVERGE_STOP");
+    Convergence& c = convergence;
+
+    c.rates.length = GetEnvCount("MIPS_CONVERGE", 0);
+    if (!c.rates.length)
+      return;
+    if (pipelines.empty() || predictors.empty() || cache_configurations.empty()) {
+      std::cerr << "MIPS: MIPS_CONVERGE needs a pipeline, a predictor and a cache hierarchy. Disabled.\n";
+      c.rates.length = 0;
+      return;
+    }
+    c.rates.left = c.rates.length;
+    c.window = std::max<unsigned long long>(2, GetEnvCount("MIPS_CONVERGE_WINDOW", 5));
+    c.tolerance = tolerance && *tolerance ? std::strtod(tolerance, nullptr) : 0.01;
+    c.stop_run = stop && !std::strcmp(stop, "run");
+    if (stop && *stop && !c.stop_run && std::strcmp(stop, "analysis"))
+      std::cerr << "MIPS: MIPS_CONVERGE_STOP is analysis or run, not " << stop << ". Only the analysis stops.\n";
+    c.history.assign(c.window * Convergence::kNumRates, 0);
+    ReadLive(c.rates.cycles, c.rates.instructions, c.rates.accesses, c.rates.misses);
+  }
+
+  // The cycles, instructions and cache counters the live gauges are the
+  // differences of.
+  void ReadLive(double& cycles, double& instructions, double* accesses, double* misses) const {
+    cycles = !pipelines.empty() && !predictors.empty() && !cache_configurations.empty()
+                 ? EstimateCycles(0, 0, cache_configurations[0]).total()
+                 : 0;
+    instructions = number_of_instructions;
+    std::fill_n(accesses, Live::kNumCaches, 0);
+    std::fill_n(misses, Live::kNumCaches, 0);
+    if (cache_configurations.empty())
+      return;
+    const CacheConfiguration& c = cache_configurations[0];
+    for (const d4cache* i : c.instruction_l1_caches) {
+      accesses[Live::kL1I] += i->fetch[D4XINSTRN];
+      misses[Live::kL1I] += i->miss[D4XINSTRN];
+    }
+    for (const d4cache* d : c.data_l1_caches) {
+      accesses[Live::kL1D] += d->fetch[D4XREAD] + d->fetch[D4XWRITE];
+      misses[Live::kL1D] += d->miss[D4XREAD] + d->miss[D4XWRITE];
+    }
+    for (int t : {D4XINSTRN, D4XREAD, D4XWRITE}) {
+      accesses[Live::kL2] += c.l2_cache->fetch[t];
+      misses[Live::kL2] += c.l2_cache->miss[t];
+    }
+  }
+
+  // Takes the rates of the interval of l that ends, and starts the next.
+  void EndRates(Live& l) const {
+    double cycles, instructions, accesses[Live::kNumCaches], misses[Live::kNumCaches];
+
+    ReadLive(cycles, instructions, accesses, misses);
+    l.left = l.length;
+    l.cpi = instructions > l.instructions ? (cycles - l.cycles) / (instructions - l.instructions) : 0;
+    for (int k = 0; k < Live::kNumCaches; k++)
+      l.miss_rates[k] = accesses[k] > l.accesses[k] ? (misses[k] - l.misses[k]) / (accesses[k] - l.accesses[k])
+                                                    : 0;
+    l.cycles = cycles;
+    l.instructions = instructions;
+    std::copy_n(accesses, Live::kNumCaches, l.accesses);
+    std::copy_n(misses, Live::kNumCaches, l.misses);
+  }
+
+  // Adds the rates of an interval to the window, and stops the analysis
+  // once every one of them has stayed within the tolerance of its mean.
+  void EndConvergenceInterval() {
+    Convergence& c = convergence;
+    const int n = Convergence::kNumRates;
+    double* row = &c.history[(c.intervals++ % c.window) * n];
+    bool stable = c.intervals >= c.window;
+
+    EndRates(c.rates);
+    row[0] = c.rates.cpi;
+    std::copy_n(c.rates.miss_rates, Live::kNumCaches, row + 1);
+    for (int k = 0; k < n && stable; k++) {
+      double low = c.history[k], high = low, sum = 0;
+
+      for (unsigned i = 0; i < c.window; i++) {
+        double v = c.history[i * n + k];
+        low = std::min(low, v);
+        high = std::max(high, v);
+        sum += v;
+      }
+      c.means[k] = sum / c.window;
+      stable = high - low <= c.tolerance * std::max(c.means[k], k ? kConvergeFloor : 0.0);
+    }
+    if (!stable)
+      return;
+    c.converged = true;
+    c.at = number_of_instructions;
+    UpdateAnalysis();
+  }
+
+  void ReportConvergence() const {
+    const Convergence& c = convergence;
+
+    if (!c.converged) {
+      printf("\nNot converged in %llu intervals of %llu instructions\n", c.intervals, c.rates.length);
+      return;
+    }
+    printf("\nConverged after %llu instructions (%llu intervals of %llu), %s stopped\n", c.at, c.intervals,
+           c.rates.length, c.stop_run ? "simulation" : "analysis");
+    printf("Over the last %u: CPI %.4f, miss rates L1I %.4f%%, L1D %.4f%%, L2 %.4f%%\n", c.window, c.means[0],
+           100 * c.means[1 + Live::kL1I], 100 * c.means[1 + Live::kL1D], 100 * c.means[1 + Live::kL2]);
+  }
+
+  // Whether the simulation should stop, MIPS_CONVERGE_STOP=run.
+  bool ConvergedRun() const {
+    return convergence.stop_run && convergence.converged;
+  }
+
+  void InitBbv(const std::string& default_path) {
+    const char* path = std::getenv("MIPS_BBV_FILE");
+
+    bbv.init(GetEnvCount("MIPS_BBV", 0), path && *path ? path : default_path);
+    if (bbv.enabled() && !kBranches)
+      std::cerr << "MIPS: Built without the branch analysis, MIPS_BBV only ends blocks at taken branches.\n";
+  }
+
+  void WriteBbv() {
+    if (bbv.enabled() && !bbv.finish())
+      std::cerr << "MIPS: Could not write the basic block vectors to " << bbv.file() << ".\n";
+  }
+
+  void InitReuseFile(const std::string& default_path) {
+    const char* path = std::getenv("MIPS_REUSE_FILE");
+
+    reuse_path = path && *path ? path : default_path;
+  }
+
+  // Writes the working set of each window, in blocks, the last one left
+  // out unless it ended.
+  void WriteReuse() {
+    std::vector<double> instructions = instruction_reuse.working_set_sizes();
+    std::vector<double> data = data_reuse.working_set_sizes();
+    FILE* f;
+
+    if (!reuse || !instruction_reuse.window_references())
+      return;
+    f = fopen(reuse_path.c_str(), "w");
+    if (!f) {
+      std::cerr << "MIPS: Could not write the working sets to " << reuse_path << ".\n";
+      return;
+    }
+    fprintf(f, "Window,Instruction blocks,Data blocks\n");
+    for (size_t k = 0; k < std::max(instructions.size(), data.size()); k++)
+      fprintf(f, "%zu,%.0f,%.0f\n", k, k < instructions.size() ? instructions[k] : 0,
+              k < data.size() ? data[k] : 0);
+    if (fclose(f) != 0)
+      std::cerr << "MIPS: Could not write the working sets to " << reuse_path << ".\n";
+  }
+
+  void WriteHotSpots() {
+    FILE* f;
+    bool ok;
+
+    if (!hot_spots.enabled())
+      return;
+    f = fopen(hot_spots_path.c_str(), "w");
+    ok = f && hot_spots.write(f, [](uint32_t entry) { return ac_symbol_name(entry); });
+    if ((f && fclose(f) != 0) || !ok)
+      std::cerr << "MIPS: Could not write the hot spots to " << hot_spots_path << ".\n";
+  }
+
+  // Leaves the loops still active and writes the profile of every loop:
+  // a line for each, of its header, the instructions run in it and the
+  // end of its body, as accsim --profile and AC_HOT_PROFILE read it, and
+  // its name, trips and costs. The comments come first, as a line of
+  // data ends them.
+  void WriteLoops() {
+    FILE* f;
+
+    if (!loops.enabled())
+      return;
+    loops.finish();
+    if (!(f = fopen(loops_path.c_str(), "w"))) {
+      std::cerr << "MIPS: Could not write the loops to " << loops_path << ".\n";
+      return;
+    }
+    fprintf(f, "# Loops of %llu instructions analyzed: header, instructions, last instruction, function,\n",
+            number_of_instructions);
+    fprintf(f, "# entries, iterations, longest trip, and per iteration instructions, L1 misses, mispredictions\n");
+    for (const mips_loops::Loop* l : loops.top(loops.loop_list().size())) {
+      double n = l->measured();
+
+      fprintf(f, "%#010x %llu %#010x %s %llu %llu %llu %.2f %.3f %.3f\n", l->header, l->instructions, l->latch,
+              ac_symbol_name(l->header).c_str(), l->entries, l->iterations, l->max_trips,
+              n ? l->instructions / n : 0, n ? l->misses / n : 0, n ? l->mispredictions / n : 0);
+    }
+    if (fclose(f) != 0)
+      std::cerr << "MIPS: Could not write the loops to " << loops_path << ".\n";
+  }
+
+  // Writes the counts of each interval, the last one as far as it got.
+  void WriteIntervals() {
+    const int width = NumPrintedMetrics();
+    FILE* f;
+
+    if (intervals.snapshots.empty())
+      return;
+    if (intervals.length && intervals.left != intervals.length)
+      EndInterval();
+    f = fopen(intervals.path.c_str(), "w");
+    if (!f) {
+      std::cerr << "MIPS: Could not write the intervals to " << intervals.path << ".\n";
+      return;
+    }
+    fprintf(f, "Interval");
+    for (const std::string& name : MetricNames())
+      fprintf(f, ",%s", name.c_str());
+    fprintf(f, "\n");
+    for (unsigned long long k = 1; k <= intervals.count; k++) {
+      const double* row = &intervals.snapshots[k * width];
+
+      fprintf(f, "%llu", k - 1);
+      for (int i = 0; i < width; i++)
+        fprintf(f, ",%.0f", row[i] - row[i - width]);
+      fprintf(f, "\n");
+    }
+    if (fclose(f) != 0)
+      std::cerr << "MIPS: Could not write the intervals to " << intervals.path << ".\n";
+  }
+
+  // Starts the parallel intervals, unless MIPS_PARALLEL is unset or asks
+  // for what the children cannot report.
+  void InitParallel() {
+    const char* path = std::getenv("MIPS_PARALLEL_FILE");
+
+    if (!parallel.length)
+      return;
+    if (sampling.enabled || intervals.length) {
+      std::cerr << "MIPS: MIPS_PARALLEL cannot be used with MIPS_SAMPLE_PERIOD or MIPS_INTERVAL. "
+                   "Intervals run in line.\n";
+      parallel.length = 0;
+      return;
+    }
+    parallel.warmup = GetEnvCount("MIPS_PARALLEL_WARMUP", parallel.warmup);
+    if (parallel.warmup > parallel.length) {
+      std::cerr << "MIPS: MIPS_PARALLEL_WARMUP cut to MIPS_PARALLEL.\n";
+      parallel.warmup = parallel.length;
+    }
+    parallel.jobs = GetEnvCount("MIPS_PARALLEL_JOBS", sysconf(_SC_NPROCESSORS_ONLN));
+    parallel.path = path && *path ? path : "mips_parallel.csv";
+    if (hot_spots.enabled() || profile_top || loops.enabled())
+      std::cerr << "MIPS: MIPS_HOTSPOTS, MIPS_PROFILE and MIPS_LOOPS are not reported with MIPS_PARALLEL.\n";
+    if (bbv.enabled()) {
+      std::cerr << "MIPS: MIPS_BBV cannot be used with MIPS_PARALLEL. Basic block vectors disabled.\n";
+      bbv.init(0, "");
+    }
+  }
+
+  // Called before each instruction of the region of interest. The child
+  // of interval k is forked at instruction k * N - warm-up.
+  void ParallelStep() {
+    while (!parallel.child && parallel.seen == NextFork())
+      ForkInterval();
+    parallel.seen++;
+    if (!parallel.child)
+      return;
+    while (!parallel.left)
+      NextParallelPhase();
+    parallel.left--;
+  }
+
+  unsigned long long NextFork() const {
+    unsigned long long next = parallel.results.size() * parallel.length;
+
+    return next > parallel.warmup ? next - parallel.warmup : 0;
+  }
+
+  // Forks the child of the next interval. The results are written to a
+  // page shared with it: whether it finished, then the counters of
+  // GetMetrics().
+  void ForkInterval() {
+    size_t size = (NumMetrics() + 1) * sizeof(double);
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    unsigned long long k = parallel.results.size();
+    int fd;
+
+    if (p == MAP_FAILED) {
+      std::cerr << "MIPS: Could not share the results of interval " << k << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    parallel.results.push_back(static_cast<double*>(p));
+    if (ac_fork_job(parallel.jobs, parallel.failed) != 0)
+      return;
+
+    // The guest output was written by the parent already.
+    ac_fork_private_files(0);
+    if ((fd = open("/dev/null", O_WRONLY)) != -1) {
+      dup2(fd, 1);
+      close(fd);
+    }
+    parallel.child = true;
+    parallel.result = parallel.results.back();
+    parallel.measuring = false;
+    parallel.left = k ? parallel.warmup : 0;
+    UpdateAnalysis();
+  }
+
+  void NextParallelPhase() {
+    if (!parallel.measuring) {
+      parallel.measuring = true;
+      parallel.left = parallel.length;
+      GetMetrics(parallel.start);
+    }
+    else
+      EndParallelInterval();
+  }
+
+  // Writes what the child counted in its interval, as far as it got, and
+  // exits without any of the reports of the parent.
+  void EndParallelInterval() {
+    std::vector<double> m;
+
+    if (parallel.measuring) {
+      GetMetrics(m);
+      for (int i = 0; i < NumMetrics(); i++)
+        parallel.result[i + 1] = m[i] - parallel.start[i];
+    }
+    parallel.result[0] = 1;
+    std::_Exit(EXIT_SUCCESS);
+  }
+
+  // Waits for the children and replaces the counters with the sums of
+  // their intervals.
+  void StitchIntervals() {
+    std::vector<double> sum(NumMetrics(), 0);
+    const int width = NumPrintedMetrics();
+    unsigned long long done = 0;
+    FILE* f;
+
+    ac_fork_wait_jobs(parallel.failed);
+    f = fopen(parallel.path.c_str(), "w");
+    if (!f)
+      std::cerr << "MIPS: Could not write the intervals to " << parallel.path << ".\n";
+    else {
+      fprintf(f, "Interval");
+      for (const std::string& name : MetricNames())
+        fprintf(f, ",%s", name.c_str());
+      fprintf(f, "\n");
+    }
+    for (unsigned long long k = 0; k < parallel.results.size(); k++) {
+      const double* r = parallel.results[k];
+
+      if (r[0]) {
+        done++;
+        for (int i = 0; i < NumMetrics(); i++)
+          sum[i] += r[i + 1];
+        if (f) {
+          fprintf(f, "%llu", k);
+          for (int i = 0; i < width; i++)
+            fprintf(f, ",%.0f", r[i + 1]);
+          fprintf(f, "\n");
+        }
+      }
+      munmap(parallel.results[k], (NumMetrics() + 1) * sizeof(double));
+    }
+    if (f && fclose(f) != 0)
+      std::cerr << "MIPS: Could not write the intervals to " << parallel.path << ".\n";
+    printf("\nParallel intervals: %llu of %zu intervals of %llu instructions (warm-up %llu) completed\n",
+           done, parallel.results.size(), parallel.length, parallel.warmup);
+    parallel.results.clear();
+    SetMetrics(sum);
+  }
+
+  void InitWarmState() {
+    const char* out = std::getenv("MIPS_WARM_OUT");
+    const char* in = std::getenv("MIPS_WARM_IN");
+    const char* at = std::getenv("MIPS_WARM_AT");
+
+    warm_out = out ? out : "";
+    warm_in = in ? in : "";
+    warm_at_roi = at && !std::strcmp(at, "roi");
+    warm_at = warm_at_roi ? 0 : GetEnvCount("MIPS_WARM_AT", 0);
+    if ((!warm_out.empty() || !warm_in.empty()) && coherent) {
+      std::cerr << "MIPS: MIPS_WARM_OUT and MIPS_WARM_IN do not support MIPS_COHERENCE.\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  void InitRegionOfInterest() {
+    skip = GetEnvCount("MIPS_SKIP", 0);
+    skipping = skip != 0;
+    in_roi = GetEnvCount("MIPS_ROI", 0) == 0;
+    UpdateAnalysis();
+  }
+
+  bool InRegionOfInterest() const {
+    return in_roi && !skipping;
+  }
+
+  // Derives what runs for the next instructions from the region of
+  // interest and the sampling phase.
+  void UpdateAnalysis() {
+    if (!warm_in.empty() && InRegionOfInterest())
+      LoadWarmState();
+    if (fork_pending && InRegionOfInterest())
+      ForkExperiments();
+    if (!InRegionOfInterest() || convergence.converged || (parallel.length && !parallel.child))
+      analyze = warm = false;
+    else if (!sampling.enabled)
+      analyze = warm = true;
+    else {
+      analyze = sampling.phase != Sampling::kFastForward;
+      warm = analyze || sampling.warm_caches;
+    }
+  }
+
+  // Called before each instruction while skipping.
+  void SkipStep() {
+    if (skip)
+      skip--;
+    else {
+      skipping = false;
+      UpdateAnalysis();
+    }
+  }
+
+  void SetRegionOfInterest(bool begin) {
+    if (Queued()) {
+      QueueEvent();
+      event.record.event = begin ? mips_trace::kRoiBegin : mips_trace::kRoiEnd;
+      events.push(event);
+      return;
+    }
+    if (trace)
+      trace->marker(begin);
+    in_roi = begin;
+    if (begin && warm_at_roi)
+      SaveWarmState();
+    UpdateAnalysis();
+  }
+
+  // The stacks of a cache, each from its most to its least recently used
+  // block, as warm states and checkpoints keep them. Nodes keep their
+  // place in the stack when read back, only their contents change; valid
+  // nodes of long stacks are also in the hash table.
+  static int NumStacks(const d4cache* c) {
+    return c->stack ? c->numsets + ((c->flags & D4F_CCC) != 0) : 0;
+  }
+
+  static void PutStacks(ac_checkpoint_out& out, const d4cache* c) {
+    for (int i = 0; i < NumStacks(c); i++) {
+      d4stacknode* node = c->stack[i].top;
+      for (int j = 0; j < c->stack[i].n; j++, node = node->down) {
+        out.put(node->blockaddr);
+        out.put(node->valid);
+        out.put(node->referenced);
+        out.put(node->dirty);
+      }
+    }
+  }
+
+  static void GetStacks(ac_checkpoint_in& in, d4cache* c) {
+    for (int i = 0; i < NumStacks(c); i++) {
+      bool hashed = c->stack[i].n > D4HASH_THRESH;
+      d4stacknode* node = c->stack[i].top;
+      for (int j = 0; j < c->stack[i].n; j++, node = node->down) {
+        if (hashed && node->valid)
+          d4_unhash(c, i, node);
+        in.get(node->blockaddr);
+        in.get(node->valid);
+        in.get(node->referenced);
+        in.get(node->dirty);
+        if (hashed && node->valid)
+          d4hash(c, i, node);
+      }
+    }
+  }
+
+  // The caches of a hierarchy in a warm state, the L1s of every core.
+  static std::vector<d4cache*> WarmCaches(const CacheConfiguration& c) {
+    std::vector<d4cache*> caches = {c.memory, c.l2_cache};
+
+    caches.insert(caches.end(), c.instruction_l1_caches.begin(), c.instruction_l1_caches.end());
+    caches.insert(caches.end(), c.data_l1_caches.begin(), c.data_l1_caches.end());
+    return caches;
+  }
+
+  // Writes the warm state to warm_out, a "mips.warm" section in the format
+  // of the checkpoints: the shape of each cache and its stacks, the size
+  // of each table of the predictors and its contents, and the distance
+  // of each register to its last write, which does not depend on the
+  // instructions counted before. Only the first call writes anything.
+  void SaveWarmState() {
+    std::string path;
+    unsigned configurations = cache_configurations.size();
+    unsigned count = predictors.size();
+
+    path.swap(warm_out);
+    warm_at = 0;
+    warm_at_roi = false;
+    if (path.empty())
+      return;
+    DrainReferences();
+    ac_checkpoint_out out(path.c_str());
+    out.begin("mips.warm");
+    out.put(configurations);
+    for (const CacheConfiguration& c : cache_configurations) {
+      std::vector<d4cache*> caches = WarmCaches(c);
+
+      out.put((unsigned) caches.size());
+      for (const d4cache* cache : caches) {
+        int shape[5] = {cache->lg2size, cache->lg2blocksize, cache->lg2subblocksize, cache->assoc,
+                        NumStacks(cache)};
+        out.put(shape);
+        PutStacks(out, cache);
+      }
+    }
+    out.put(count);
+    for (std::unique_ptr<mips_predictor>& p : predictors) {
+      out.put((unsigned) p->contents().size());
+      for (uint16_t x : p->contents())
+        out.put(x);
+      out.put(p->global_history());
+    }
+    for (std::vector<uint32_t>* v : {&btb.branches(), &btb.contents(), &ras.contents()}) {
+      out.put((unsigned) v->size());
+      for (uint32_t x : *v)
+        out.put(x);
+    }
+    out.put(ras.top_entry());
+    out.put(ras.entries());
+    out.put((unsigned) last_write.size());
+    for (int w : last_write)
+      out.put((unsigned) (Stamp() - w));
+    if (!out.close()) {
+      std::cerr << "MIPS: Could not write the warm state to " << path << ".\n";
+      return;
+    }
+    std::cerr << "MIPS: Warm state written to " << path << " after " << number_of_instructions
+              << " instructions.\n";
+  }
+
+  // Reads warm_in back, which must have been written with the same caches,
+  // predictors, BTB and RAS. Only the first call reads anything.
+  void LoadWarmState() {
+    std::string path;
+    ac_checkpoint_in in(warm_in.c_str());
+    char name[64];
+    unsigned n, distance;
+    bool same;
+
+    path.swap(warm_in);
+    if (!in.ok()) {
+      std::cerr << "MIPS: Could not read the warm state " << path << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (!in.next(name, sizeof(name)) || std::strcmp(name, "mips.warm")) {
+      std::cerr << "MIPS: " << path << " is not a warm state.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    DrainReferences();
+    in.get(n);
+    same = n == cache_configurations.size();
+    for (unsigned k = 0; same && k < n; k++) {
+      std::vector<d4cache*> caches = WarmCaches(cache_configurations[k]);
+      unsigned count;
+
+      in.get(count);
+      same = count == caches.size();
+      for (unsigned i = 0; same && i < count; i++) {
+        d4cache* c = caches[i];
+        int shape[5];
+
+        in.get(shape);
+        same = shape[0] == c->lg2size && shape[1] == c->lg2blocksize && shape[2] == c->lg2subblocksize &&
+               shape[3] == c->assoc && shape[4] == NumStacks(c);
+        if (same)
+          GetStacks(in, c);
+      }
+      ForgetFetches(cache_configurations[k]);
+    }
+    if (!same) {
+      std::cerr << "MIPS: The warm state " << path << " was written with other cache configurations.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    in.get(n);
+    same = n == predictors.size();
+    for (unsigned k = 0; same && k < n; k++) {
+      mips_predictor& p = *predictors[k];
+      unsigned size;
+
+      in.get(size);
+      same = size == p.contents().size();
+      for (unsigned i = 0; same && i < size; i++)
+        in.get(p.contents()[i]);
+      in.get(p.global_history());
+    }
+    for (std::vector<uint32_t>* v : {&btb.branches(), &btb.contents(), &ras.contents()}) {
+      unsigned size;
+
+      in.get(size);
+      same = same && size == v->size();
+      for (unsigned i = 0; same && i < size; i++)
+        in.get((*v)[i]);
+    }
+    if (!same) {
+      std::cerr << "MIPS: The warm state " << path << " was written with other predictors, BTB or RAS.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    in.get(ras.top_entry());
+    in.get(ras.entries());
+    in.get(n);
+    if (n != last_write.size()) {
+      std::cerr << "MIPS: The warm state " << path << " is not valid.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    for (int& w : last_write) {
+      in.get(distance);
+      w = Stamp() - distance;
+    }
+    if (!in.ok()) {
+      std::cerr << "MIPS: Could not read the warm state " << path << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    std::cerr << "MIPS: Warm state read from " << path << ".\n";
+  }
+
+  // Called before each instruction of the region of interest is analyzed.
+  void SampleStep() {
+    sampling.total++;
+    while (!sampling.left)
+      NextPhase();
+    sampling.left--;
+  }
+
+  void NextPhase() {
+    double now;
+
+    switch (sampling.phase) {
+    case Sampling::kFastForward:
+      if (sampling.target)
+        sampling.fast_seconds = HostSeconds() - sampling.phase_start;
+      sampling.phase = Sampling::kWarmUp;
+      sampling.left = sampling.warmup;
+      UpdateAnalysis();
+      break;
+    case Sampling::kWarmUp:
+      sampling.phase = Sampling::kMeasure;
+      sampling.left = sampling.measure;
+      GetMetrics(sampling.start);
+      break;
+    case Sampling::kMeasure:
+      if (sampling.total > 1) {
+        EndWindow(sampling.measure);
+        sampling.detailed += sampling.warmup + sampling.measure;
+      }
+      if (sampling.target) {
+        now = HostSeconds();
+        if (sampling.total > 1) {
+          sampling.seconds += now - sampling.phase_start;
+          AdaptPeriod(sampling.fast_seconds, now - sampling.phase_start);
+        }
+        sampling.phase_start = now;
+      }
+      sampling.phase = Sampling::kFastForward;
+      sampling.left = sampling.current - sampling.warmup - sampling.measure;
+      UpdateAnalysis();
+      break;
+    }
+  }
+
+  // Each window stands for the period it ends, weighted by its length
+  // over MIPS_SAMPLE_PERIOD: all the same unless the period adapts, when
+  // Extrapolate() weighs the rates of sparse stretches accordingly.
+  void EndWindow(unsigned long long length) {
+    double weight = (double) sampling.current / sampling.period;
+    std::vector<double> m;
+    GetMetrics(m);
+    for (int i = 0; i < NumMetrics(); i++) {
+      double rate = (m[i] - sampling.start[i]) / length;
+      sampling.sum[i] += weight * rate;
+      sampling.sum_sq[i] += weight * rate * rate;
+    }
+    sampling.weights += weight;
+    sampling.weights_sq += weight * weight;
+    sampling.windows++;
+  }
+
+  // Names of the counters of GetMetrics() that are printed.
+  std::vector<std::string> MetricNames() const {
+    std::vector<std::string> names = {"NOPs", "Instructions"};
+    for (const char* hazards : {"Data hazards", "Control hazards", "Store forwards", "Load-after-store stalls",
+                                "Ordering violations"})
+      for (const Pipeline& p : pipelines)
+        names.push_back(std::string(hazards) + " (" + std::to_string(p.depth) + " stages)");
+    names.push_back("Branches");
+    for (const std::unique_ptr<mips_predictor>& p : predictors)
+      names.push_back("Wrong predictions (" + p->name() + ")");
+    names.insert(names.end(), {"Taken branches and jumps", "BTB misses", "Returns", "RAS misses"});
+    for (const IssueModel& m : issue_models)
+      for (unsigned k = 1; k <= m.width; k++)
+        names.push_back("Issue groups of " + std::to_string(k) + " (" + std::to_string(m.width) + " wide)");
+    if (out_of_order)
+      names.insert(names.end(), {"OoO instructions", "OoO ROB full stalls", "OoO queue full stalls",
+                                 "OoO misprediction stalls", "OoO operand waits", "OoO load waits",
+                                 "OoO cycles"});
+    if (ilp)
+      names.insert(names.end(), {"ILP instructions", "ILP memory waits", "ILP window waits",
+                                 "ILP critical path"});
+    names.push_back("Memory accesses");
+    static const char* const configuration_names[kNumConfigurationMetrics] = {
+      "instruction fetch misses", "data load misses", "data store misses",
+      "L1 instruction fetches", "L1 instruction misses", "L1 data loads",
+      "L1 data load misses", "L1 data stores", "L1 data store misses"
+    };
+    for (unsigned c = 0; c < cache_configurations.size(); c++)
+      for (const char* name : configuration_names)
+        names.push_back("#" + std::to_string(c) + " " + name);
+    for (unsigned c = 0; cache_energy && c < cache_configurations.size(); c++)
+      for (const char* name : {"L1 energy (pJ)", "L2 energy (pJ)", "memory energy (pJ)"})
+        names.push_back("#" + std::to_string(c) + " " + name);
+    return names;
+  }
+
+  // Replaces the counters with their estimates over the whole run and
+  // prints the 95% confidence interval of each one.
+  void Extrapolate() {
+    std::vector<std::string> names = MetricNames();
+    std::vector<double> estimate(NumMetrics());
+    double n;
+
+    // A run shorter than one period still reports its partial window.
+    if (!sampling.windows && sampling.phase == Sampling::kMeasure &&
+        sampling.measure > sampling.left)
+      EndWindow(sampling.measure - sampling.left);
+    n = sampling.windows;
+
+    if (sampling.target)
+      printf("\nSampled simulation: %llu windows of %llu instructions every %llu to %llu for %.0f MIPS "
+             "(warm-up %llu%s)\n", sampling.windows, sampling.measure, sampling.shortest, sampling.longest,
+             sampling.target / 1e6, sampling.warmup, sampling.warm_caches ? ", caches always warm" : "");
+    else
+      printf("\nSampled simulation: %llu windows of %llu instructions every %llu (warm-up %llu%s)\n",
+             sampling.windows, sampling.measure, sampling.period, sampling.warmup,
+             sampling.warm_caches ? ", caches always warm" : "");
+    printf("Instructions measured: %llu of %llu\n",
+           sampling.windows * sampling.measure, sampling.total);
+    if (sampling.target && sampling.seconds)
+      printf("Analyzed in detail: %.3f%%, at %.2f MIPS on the host\n",
+             sampling.total ? 100.0 * sampling.detailed / sampling.total : 0,
+             sampling.total / sampling.seconds / 1e6);
+    if (!sampling.windows)
+      return;
+    // The mean of the rates weighted by the periods, and its variance
+    // from that of the rates, which for equal weights is var / n.
+    for (int i = 0; i < NumMetrics(); i++) {
+      double mean = sampling.sum[i] / sampling.weights;
+      double var = n > 1 ? std::max(0.0, (sampling.sum_sq[i] - sampling.weights * mean * mean) /
+                                         sampling.weights * n / (n - 1))
+                         : 0;
+      estimate[i] = mean * sampling.total;
+      // The sweep counters are too many to list.
+      if (i >= NumPrintedMetrics())
+        continue;
+      printf("%-32s %.0f +/- %.0f\n", names[i].c_str(), estimate[i],
+             1.96 * std::sqrt(var * sampling.weights_sq) / sampling.weights * sampling.total);
+    }
+    SetMetrics(estimate);
+  }
+
+} global;
+
+// With MIPS_D4CUSTOM=file.c, the simulator writes the Dinero IV
+// customization of the hierarchies of MIPS_CACHES to file.c and exits,
+// before any program is loaded. See the custom-caches target of the
+// Makefile.
+static struct d4custom_writer {
+  d4custom_writer() {
+    const char* path = std::getenv("MIPS_D4CUSTOM");
+
+    if (!path || !*path)
+      return;
+    global.SetUpCaches();
+    if (!global.WriteCustomization(path)) {
+      std::cerr << "MIPS: Could not write " << path << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    std::exit(EXIT_SUCCESS);
+  }
+} d4custom_writer;
+
+constexpr variables::OpFunc variables::instructions_dont_write[];
+constexpr variables::OpFunc variables::branch_instructions[];
+constexpr variables::OpFunc variables::ld_instructions[];
+
+constexpr d4addr variables::kNoFetch;
+
+thread_local bool variables::analyzing = false;
+
+#ifdef AC_CHECKPOINT
+// Analysis state saved with the simulator checkpoints, so a restored run
+// reports the same hazards, predictions and cache statistics.
+static struct variables_checkpoint : public ac_checkpoint_section {
+  variables_checkpoint() : ac_checkpoint_section("mips.global") {}
+
+  template <typename T> static void put_vector(ac_checkpoint_out& out, const std::vector<T>& v) {
+    for (const T& x : v)
+      out.put(x);
+  }
+
+  template <typename T> static void get_vector(ac_checkpoint_in& in, std::vector<T>& v) {
+    for (T& x : v)
+      in.get(x);
+  }
+
+  // The stages of a hierarchy, or their absence: the entries of the
+  // victim caches and the write buffer, then their contents and counters.
+  static void put_stages(ac_checkpoint_out& out, mips_stages* s) {
+    unsigned entries[3] = {0, 0, 0};
+
+    if (s) {
+      entries[0] = s->victim_contents(mips_stages::kInstruction).size();
+      entries[1] = s->victim_contents(mips_stages::kData).size();
+      entries[2] = s->buffer_contents().size();
+    }
+    out.put((bool) s);
+    out.put(entries);
+    if (!s)
+      return;
+    put_vector(out, s->victim_contents(mips_stages::kInstruction));
+    put_vector(out, s->victim_contents(mips_stages::kData));
+    put_vector(out, s->buffer_contents());
+    put_vector(out, s->counts());
+  }
+
+  static void get_stages(ac_checkpoint_in& in, mips_stages* s) {
+    unsigned entries[3];
+    bool stages;
+
+    in.get(stages);
+    in.get(entries);
+    if (stages != (s != NULL) ||
+        (s && (entries[0] != s->victim_contents(mips_stages::kInstruction).size() ||
+               entries[1] != s->victim_contents(mips_stages::kData).size() ||
+               entries[2] != s->buffer_contents().size()))) {
+      std::cerr << "MIPS: The checkpoint was taken with other victim caches or write buffers.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (!s)
+      return;
+    get_vector(in, s->victim_contents(mips_stages::kInstruction));
+    get_vector(in, s->victim_contents(mips_stages::kData));
+    get_vector(in, s->buffer_contents());
+    get_vector(in, s->counts());
+  }
+
+  // The timing of the main memory of a hierarchy, or its absence: the
+  // size of its state, then the state and the counters.
+  static void put_dram(ac_checkpoint_out& out, const mips_dram* d) {
+    std::vector<uint64_t> state;
+
+    if (d)
+      state = d->state();
+    out.put((unsigned) state.size());
+    if (!d)
+      return;
+    put_vector(out, state);
+    put_vector(out, d->counts());
+  }
+
+  static void get_dram(ac_checkpoint_in& in, mips_dram* d) {
+    std::vector<uint64_t> state;
+    unsigned size;
+
+    if (d)
+      state = d->state();
+    in.get(size);
+    if (size != state.size()) {
+      std::cerr << "MIPS: The checkpoint was taken with another main memory timing.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (!d)
+      return;
+    get_vector(in, state);
+    d->set_state(state);
+    get_vector(in, d->counts());
+  }
+
+  // The contention below the L1s of a hierarchy, or its absence: the
+  // number of its counters, then the counters. The round in progress
+  // is not kept.
+  static void put_contention(ac_checkpoint_out& out, const mips_contention* c) {
+    out.put(c ? (unsigned) c->counts().size() : 0U);
+    if (c)
+      put_vector(out, c->counts());
+  }
+
+  static void get_contention(ac_checkpoint_in& in, mips_contention* c) {
+    unsigned size;
+
+    in.get(size);
+    if (size != (c ? c->counts().size() : 0)) {
+      std::cerr << "MIPS: The checkpoint was taken with another contention below the L1s.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (c)
+      get_vector(in, c->counts());
+  }
+
+  static void put_cache(ac_checkpoint_out& out, const d4cache* c) {
+    out.put(c->lg2size);
+    out.put(c->lg2blocksize);
+    out.put(c->lg2subblocksize);
+    out.put(c->assoc);
+    out.put(c->fetch, sizeof(c->fetch));
+    out.put(c->miss, sizeof(c->miss));
+    out.put(c->blockmiss, sizeof(c->blockmiss));
+    out.put(c->comp_miss, sizeof(c->comp_miss));
+    out.put(c->comp_blockmiss, sizeof(c->comp_blockmiss));
+    out.put(c->cap_miss, sizeof(c->cap_miss));
+    out.put(c->cap_blockmiss, sizeof(c->cap_blockmiss));
+    out.put(c->conf_miss, sizeof(c->conf_miss));
+    out.put(c->conf_blockmiss, sizeof(c->conf_blockmiss));
+    out.put(c->multiblock);
+    out.put(c->bytes_read);
+    out.put(c->bytes_written);
+    variables::PutStacks(out, c);
+  }
+
+  static void get_cache(ac_checkpoint_in& in, d4cache* c) {
+    int lg2size, lg2blocksize, lg2subblocksize, assoc;
+
+    in.get(lg2size);
+    in.get(lg2blocksize);
+    in.get(lg2subblocksize);
+    in.get(assoc);
+    if (lg2size != c->lg2size || lg2blocksize != c->lg2blocksize ||
+        lg2subblocksize != c->lg2subblocksize || assoc != c->assoc) {
+      std::cerr << "MIPS: The checkpoint was taken with other cache configurations.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    in.get(c->fetch, sizeof(c->fetch));
+    in.get(c->miss, sizeof(c->miss));
+    in.get(c->blockmiss, sizeof(c->blockmiss));
+    in.get(c->comp_miss, sizeof(c->comp_miss));
+    in.get(c->comp_blockmiss, sizeof(c->comp_blockmiss));
+    in.get(c->cap_miss, sizeof(c->cap_miss));
+    in.get(c->cap_blockmiss, sizeof(c->cap_blockmiss));
+    in.get(c->conf_miss, sizeof(c->conf_miss));
+    in.get(c->conf_blockmiss, sizeof(c->conf_blockmiss));
+    in.get(c->multiblock);
+    in.get(c->bytes_read);
+    in.get(c->bytes_written);
+    variables::GetStacks(in, c);
+  }
+
+  void save(ac_checkpoint_out& out) {
+    if (global.coherent) {
+      std::cerr << "MIPS: Checkpoints do not support MIPS_COHERENCE.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    global.DrainAnalysis();
+    global.DrainReferences();
+    out.put(global.number_of_instructions);
+    out.put(global.number_of_nops);
+    out.put(global.total_number_of_branches);
+    unsigned predictors = global.predictors.size();
+    out.put(predictors);
+    put_vector(out, global.wrong_predictions);
+    for (std::unique_ptr<mips_predictor>& p : global.predictors) {
+      put_vector(out, p->contents());
+      out.put(p->global_history());
+      out.put(p->branches_seen());
+    }
+    put_vector(out, global.btb.branches());
+    put_vector(out, global.btb.contents());
+    put_vector(out, global.ras.contents());
+    out.put(global.ras.top_entry());
+    out.put(global.ras.entries());
+    out.put(global.taken_branches);
+    out.put(global.btb_misses);
+    out.put(global.returns);
+    out.put(global.ras_misses);
+    out.put(global.pending_branch);
+    unsigned pipelines = global.pipelines.size();
+    out.put(pipelines);
+    put_vector(out, global.number_of_data_hazards);
+    put_vector(out, global.number_of_control_hazards);
+    put_vector(out, global.store_forwards);
+    put_vector(out, global.store_stalls);
+    put_vector(out, global.ordering_violations);
+    out.put(global.stores.window_size());
+    put_vector(out, global.stores.state());
+    put_vector(out, global.last_write);
+    out.put(global.nop_stamps);
+    out.put(global.num_memory_acesses);
+    unsigned issue_models = global.issue_models.size();
+    out.put(issue_models);
+    for (const variables::IssueModel& m : global.issue_models) {
+      out.put(m.size);
+      out.put(m.used);
+      out.put(m.reads);
+      out.put(m.writes);
+      put_vector(out, m.groups);
+    }
+    unsigned ooo[3] = {global.ooo.rob_size(), global.ooo.queue_size(), global.ooo.dispatch_width()};
+    out.put(ooo);
+    if (global.out_of_order) {
+      put_vector(out, global.ooo.retire_ring());
+      put_vector(out, global.ooo.issue_ring());
+      put_vector(out, global.ooo.dispatch_ring());
+      put_vector(out, global.ooo.retire_width_ring());
+      put_vector(out, global.ooo.register_ready());
+      out.put(global.ooo.state());
+      put_vector(out, global.ooo.counts());
+      out.put(global.ooo_next);
+    }
+    out.put(global.in_roi);
+    out.put(global.skipping);
+    out.put(global.skip);
+    out.put(processors_started);
+
+    unsigned n = global.latest_instructions.size();
+    out.put(n);
+    for (unsigned i = 0; i < n; i++)
+      out.put(global.latest_instructions[i]);
+
+    unsigned configurations = global.cache_configurations.size();
+    out.put(configurations);
+    for (auto& cache_configuration : global.cache_configurations) {
+      put_cache(out, cache_configuration.memory);
+      put_cache(out, cache_configuration.l2_cache);
+      put_cache(out, cache_configuration.instruction_l1_cache);
+      put_cache(out, cache_configuration.data_l1_cache);
+      put_stages(out, cache_configuration.stages.get());
+      put_dram(out, cache_configuration.dram.get());
+      put_contention(out, cache_configuration.contention.get());
+    }
+
+    out.put(global.sweep);
+    if (global.sweep) {
+      for (mips_sweep* s : {&global.instruction_sweep, &global.data_sweep}) {
+        out.put(s->block_size());
+        out.put(s->lg2_sets());
+        out.put(s->assoc());
+        put_vector(out, s->counts());
+        put_vector(out, s->contents());
+      }
+    }
+
+    out.put(global.lanes);
+    if (global.lanes) {
+      for (mips_lanes* l : {&global.instruction_lanes, &global.data_lanes}) {
+        unsigned count = l->count();
+
+        out.put(l->block_size());
+        out.put(count);
+        for (unsigned k = 0; k < count; k++) {
+          out.put(l->sets(k));
+          out.put(l->assoc(k));
+          out.put((unsigned) l->replacement(k));
+        }
+        out.put(l->time());
+        put_vector(out, l->counts());
+        put_vector(out, l->contents());
+        put_vector(out, l->ages());
+      }
+    }
+
+    out.put(global.tlbs);
+    if (global.tlbs) {
+      for (mips_tlb* t : {&global.instruction_tlb, &global.data_tlb}) {
+        unsigned shape[3] = {t->entries(), t->assoc(), t->page_size()};
+
+        out.put(shape);
+        out.put(t->time());
+        put_vector(out, t->counts());
+        put_vector(out, t->contents());
+        put_vector(out, t->ages());
+      }
+    }
+
+    out.put(global.values.enabled());
+    if (global.values.enabled()) {
+      unsigned shape[2] = {global.values.table_entries(), global.values.context_entries()};
+
+      out.put(shape);
+      put_vector(out, global.values.counts());
+      put_vector(out, global.values.table());
+      put_vector(out, global.values.context_values());
+      put_vector(out, global.values.context_confidence());
+    }
+
+    out.put(global.frontend.enabled());
+    if (global.frontend.enabled()) {
+      unsigned shape[3] = {global.frontend.loop_capacity(), global.frontend.fetch_width(),
+                           global.frontend.queue_depth()};
+
+      out.put(shape);
+      put_vector(out, global.frontend.counts());
+    }
+
+    out.put(global.reuse);
+    if (global.reuse) {
+      for (mips_reuse* r : {&global.instruction_reuse, &global.data_reuse}) {
+        std::vector<uint64_t> state = r->state();
+
+        out.put(r->block_size());
+        out.put(r->rate());
+        out.put(r->window_references());
+        out.put((unsigned long long) state.size());
+        put_vector(out, state);
+        put_vector(out, r->counts());
+      }
+    }
+
+    out.put(global.ilp);
+    if (global.ilp) {
+      std::vector<uint64_t> state = global.dataflow.state();
+
+      out.put(global.dataflow.window_size());
+      out.put(global.dataflow.memory_dependences());
+      put_vector(out, global.ilp_latencies);
+      out.put((unsigned long long) state.size());
+      put_vector(out, state);
+      put_vector(out, global.dataflow.counts());
+      out.put(global.ilp_next);
+    }
+
+    out.put(global.intervals.length);
+    if (global.intervals.length) {
+      unsigned width = global.NumPrintedMetrics();
+      out.put(width);
+      out.put(global.intervals.left);
+      out.put(global.intervals.count);
+      for (unsigned long long i = 0; i < (global.intervals.count + 1) * width; i++)
+        out.put(global.intervals.snapshots[i]);
+    }
+
+    for (mips_profile* p : {&global.branch_profile, &global.load_profile}) {
+      unsigned shape[2] = {p->lg2_size(), p->counts_per_pc()};
+      out.put(shape);
+      if (p->enabled()) {
+        put_vector(out, p->pcs());
+        put_vector(out, p->counts());
+        out.put(p->entries_used());
+        out.put(p->dropped_count());
+      }
+    }
+    out.put(global.last_load_pc);
+
+    out.put(global.hot_spots.period());
+    if (global.hot_spots.enabled()) {
+      std::map<std::vector<uint32_t>, unsigned long long>& stacks = global.hot_spots.stacks();
+      out.put(global.hot_spots.instructions_left());
+      out.put(global.hot_spots.calls_beyond());
+      out.put(global.hot_spots_cycles);
+      out.put(global.hot_spots.call_stack().size());
+      put_vector(out, global.hot_spots.call_stack());
+      put_vector(out, global.hot_spots.return_addresses());
+      out.put(stacks.size());
+      for (const auto& s : stacks) {
+        out.put(s.first.size());
+        put_vector(out, s.first);
+        out.put(s.second);
+      }
+    }
+  }
+
+  void restore(ac_checkpoint_in& in) {
+    if (global.coherent) {
+      std::cerr << "MIPS: Checkpoints do not support MIPS_COHERENCE.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    global.DrainAnalysis();
+    global.DrainReferences();
+    in.get(global.number_of_instructions);
+    in.get(global.number_of_nops);
+    in.get(global.total_number_of_branches);
+    unsigned predictors;
+    in.get(predictors);
+    if (predictors != global.predictors.size()) {
+      std::cerr << "MIPS: The checkpoint has " << predictors << " branch predictors, not "
+                << global.predictors.size() << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    get_vector(in, global.wrong_predictions);
+    for (std::unique_ptr<mips_predictor>& p : global.predictors) {
+      get_vector(in, p->contents());
+      in.get(p->global_history());
+      in.get(p->branches_seen());
+    }
+    get_vector(in, global.btb.branches());
+    get_vector(in, global.btb.contents());
+    get_vector(in, global.ras.contents());
+    in.get(global.ras.top_entry());
+    in.get(global.ras.entries());
+    in.get(global.taken_branches);
+    in.get(global.btb_misses);
+    in.get(global.returns);
+    in.get(global.ras_misses);
+    in.get(global.pending_branch);
+    unsigned pipelines;
+    in.get(pipelines);
+    if (pipelines != global.pipelines.size()) {
+      std::cerr << "MIPS: The checkpoint has " << pipelines << " pipelines, not "
+                << global.pipelines.size() << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    get_vector(in, global.number_of_data_hazards);
+    get_vector(in, global.number_of_control_hazards);
+    get_vector(in, global.store_forwards);
+    get_vector(in, global.store_stalls);
+    get_vector(in, global.ordering_violations);
+    unsigned store_window;
+    in.get(store_window);
+    if (store_window != global.stores.window_size()) {
+      std::cerr << "MIPS: The checkpoint has a store window of " << store_window << " instructions, not "
+                << global.stores.window_size() << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    std::vector<uint32_t> stores = global.stores.state();
+    get_vector(in, stores);
+    global.stores.set_state(stores);
+    get_vector(in, global.last_write);
+    in.get(global.nop_stamps);
+    in.get(global.num_memory_acesses);
+    unsigned issue_models;
+    in.get(issue_models);
+    if (issue_models != global.issue_models.size()) {
+      std::cerr << "MIPS: The checkpoint has " << issue_models << " issue models, not "
+                << global.issue_models.size() << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    for (variables::IssueModel& m : global.issue_models) {
+      in.get(m.size);
+      in.get(m.used);
+      in.get(m.reads);
+      in.get(m.writes);
+      get_vector(in, m.groups);
+    }
+    unsigned ooo[3];
+    in.get(ooo);
+    if (ooo[0] != global.ooo.rob_size() || ooo[1] != global.ooo.queue_size() ||
+        ooo[2] != global.ooo.dispatch_width()) {
+      std::cerr << "MIPS: The checkpoint has an out-of-order window of " << ooo[0] << " ROB, "
+                << ooo[1] << " queue and " << ooo[2] << " wide, not " << global.ooo.rob_size()
+                << ", " << global.ooo.queue_size() << " and " << global.ooo.dispatch_width() << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (global.out_of_order) {
+      get_vector(in, global.ooo.retire_ring());
+      get_vector(in, global.ooo.issue_ring());
+      get_vector(in, global.ooo.dispatch_ring());
+      get_vector(in, global.ooo.retire_width_ring());
+      get_vector(in, global.ooo.register_ready());
+      in.get(global.ooo.state());
+      get_vector(in, global.ooo.counts());
+      in.get(global.ooo_next);
+    }
+    in.get(global.in_roi);
+    in.get(global.skipping);
+    in.get(global.skip);
+    in.get(processors_started);
+
+    unsigned n;
+    in.get(n);
+    global.latest_instructions.resize(n);
+    for (unsigned i = 0; i < n; i++)
+      in.get(global.latest_instructions[i]);
+
+    unsigned configurations;
+    in.get(configurations);
+    if (configurations != global.cache_configurations.size()) {
+      std::cerr << "MIPS: The checkpoint has " << configurations << " cache configurations, not "
+                << global.cache_configurations.size() << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    for (auto& cache_configuration : global.cache_configurations) {
+      get_cache(in, cache_configuration.memory);
+      get_cache(in, cache_configuration.l2_cache);
+      get_cache(in, cache_configuration.instruction_l1_cache);
+      get_cache(in, cache_configuration.data_l1_cache);
+      get_stages(in, cache_configuration.stages.get());
+      get_dram(in, cache_configuration.dram.get());
+      get_contention(in, cache_configuration.contention.get());
+      global.ForgetFetches(cache_configuration);
+    }
+
+    bool sweep;
+    in.get(sweep);
+    if (sweep != global.sweep) {
+      std::cerr << "MIPS: The checkpoint was taken " << (sweep ? "with" : "without")
+                << " MIPS_SWEEP_BSIZE.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (sweep) {
+      for (mips_sweep* s : {&global.instruction_sweep, &global.data_sweep}) {
+        unsigned bsize, lg2sets, assoc;
+
+        in.get(bsize);
+        in.get(lg2sets);
+        in.get(assoc);
+        if (bsize != s->block_size() || lg2sets != s->lg2_sets() || assoc != s->assoc()) {
+          std::cerr << "MIPS: The checkpoint was taken with another cache sweep.\n";
+          std::exit(EXIT_FAILURE);
+        }
+        get_vector(in, s->counts());
+        get_vector(in, s->contents());
+      }
+    }
+
+    bool lanes;
+    in.get(lanes);
+    if (lanes != global.lanes) {
+      std::cerr << "MIPS: The checkpoint was taken " << (lanes ? "with" : "without") << " MIPS_LANES.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (lanes) {
+      for (mips_lanes* l : {&global.instruction_lanes, &global.data_lanes}) {
+        unsigned bsize, count, sets, assoc, policy;
+        bool same;
+
+        in.get(bsize);
+        in.get(count);
+        same = bsize == l->block_size() && count == l->count();
+        for (unsigned k = 0; k < count; k++) {
+          in.get(sets);
+          in.get(assoc);
+          in.get(policy);
+          same = same && sets == l->sets(k) && assoc == l->assoc(k) && policy == (unsigned) l->replacement(k);
+        }
+        if (!same) {
+          std::cerr << "MIPS: The checkpoint was taken with other MIPS_LANES caches.\n";
+          std::exit(EXIT_FAILURE);
+        }
+        in.get(l->time());
+        get_vector(in, l->counts());
+        get_vector(in, l->contents());
+        get_vector(in, l->ages());
+      }
+    }
+
+    bool tlbs;
+    in.get(tlbs);
+    if (tlbs != global.tlbs) {
+      std::cerr << "MIPS: The checkpoint was taken " << (tlbs ? "with" : "without") << " MIPS_TLB.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (tlbs) {
+      for (mips_tlb* t : {&global.instruction_tlb, &global.data_tlb}) {
+        unsigned shape[3];
+
+        in.get(shape);
+        if (shape[0] != t->entries() || shape[1] != t->assoc() || shape[2] != t->page_size()) {
+          std::cerr << "MIPS: The checkpoint was taken with other MIPS_TLB TLBs.\n";
+          std::exit(EXIT_FAILURE);
+        }
+        in.get(t->time());
+        get_vector(in, t->counts());
+        get_vector(in, t->contents());
+        get_vector(in, t->ages());
+        t->restored();
+      }
+    }
+
+    bool values;
+    in.get(values);
+    if (values != global.values.enabled()) {
+      std::cerr << "MIPS: The checkpoint was taken " << (values ? "with" : "without") << " MIPS_VALUES.\n";
+      std::exit(EXIT_FAILURE);
     }
-  }
+    if (values) {
+      unsigned shape[2];
 
-  void SimulateLoadDataFromCaches(const d4addr address) {
-    d4memref memory_reference;
-    memory_reference.address = static_cast<d4addr>(address & ~3);
-    memory_reference.size = 4;
-    memory_reference.accesstype = D4XREAD;
-    for (auto& cache_configuration : cache_configurations) {
-      d4ref(cache_configuration.instruction_l1_cache, memory_reference);
+      in.get(shape);
+      if (shape[0] != global.values.table_entries() || shape[1] != global.values.context_entries()) {
+        std::cerr << "MIPS: The checkpoint was taken with other MIPS_VALUES tables.\n";
+        std::exit(EXIT_FAILURE);
+      }
+      get_vector(in, global.values.counts());
+      get_vector(in, global.values.table());
+      get_vector(in, global.values.context_values());
+      get_vector(in, global.values.context_confidence());
     }
-    num_memory_acesses++;
-  }
 
-  void SimulateStoreDataInCaches(const d4addr address) {
-    d4memref memory_reference;
-    memory_reference.address = static_cast<d4addr>(address & ~3);
-    memory_reference.size = 4;
-    memory_reference.accesstype = D4XWRITE;
-    for (auto& cache_configuration : cache_configurations) {
-      d4ref(cache_configuration.instruction_l1_cache, memory_reference);
+    // The loop buffers and queues start empty
+    bool frontend;
+    in.get(frontend);
+    if (frontend != global.frontend.enabled()) {
+      std::cerr << "MIPS: The checkpoint was taken " << (frontend ? "with" : "without") << " MIPS_FETCH.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (frontend) {
+      unsigned shape[3];
+
+      in.get(shape);
+      if (shape[0] != global.frontend.loop_capacity() || shape[1] != global.frontend.fetch_width() ||
+          shape[2] != global.frontend.queue_depth()) {
+        std::cerr << "MIPS: The checkpoint was taken with another MIPS_FETCH front end.\n";
+        std::exit(EXIT_FAILURE);
+      }
+      get_vector(in, global.frontend.counts());
+      global.frontend.flush();
     }
-    num_memory_acesses++;
-  }
 
-} global;
+    bool reuse;
+    in.get(reuse);
+    if (reuse != global.reuse) {
+      std::cerr << "MIPS: The checkpoint was taken " << (reuse ? "with" : "without") << " MIPS_REUSE_BSIZE.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (reuse) {
+      for (mips_reuse* r : {&global.instruction_reuse, &global.data_reuse}) {
+        unsigned bsize;
+        double rate;
+        unsigned long long window, size;
+        std::vector<uint64_t> state;
+
+        in.get(bsize);
+        in.get(rate);
+        in.get(window);
+        in.get(size);
+        if (bsize != r->block_size() || rate != r->rate() || window != r->window_references()) {
+          std::cerr << "MIPS: The checkpoint was taken with other MIPS_REUSE settings.\n";
+          std::exit(EXIT_FAILURE);
+        }
+        state.resize(size);
+        get_vector(in, state);
+        r->set_state(state);
+        get_vector(in, r->counts());
+      }
+    }
 
-const std::set<std::pair<int, int>> variables::instructions_dont_write {
-  { 0, 0x8 },  // jr
-  { 0, 0x0C }, // syscall
-  { 0, 0x0D }, // break
-  { 0x04, 0 }, // beq
-  { 0x05, 0 }, // bne
-  { 0x06, 0 }, // blez
-  { 0x07, 0 }, // bgtz
-  { 0x01, 0 }, // bltz, bgez
-  { 0x28, 0 }, // sb
-  { 0x29, 0 }, // sh
-  { 0x2B, 0 }, // sw
-  { 0x39, 0 }  // swc1
-  // bltzal, bgezal
-};
+    bool ilp;
+    in.get(ilp);
+    if (ilp != global.ilp) {
+      std::cerr << "MIPS: The checkpoint was taken " << (ilp ? "with" : "without") << " MIPS_ILP.\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (ilp) {
+      unsigned window;
+      bool memory;
+      std::vector<unsigned> latencies(global.ilp_latencies.size());
+      unsigned long long size;
+      std::vector<uint64_t> state;
+
+      in.get(window);
+      in.get(memory);
+      get_vector(in, latencies);
+      in.get(size);
+      if (window != global.dataflow.window_size() || memory != global.dataflow.memory_dependences() ||
+          latencies != global.ilp_latencies) {
+        std::cerr << "MIPS: The checkpoint was taken with other MIPS_ILP settings.\n";
+        std::exit(EXIT_FAILURE);
+      }
+      state.resize(size);
+      get_vector(in, state);
+      global.dataflow.set_state(state);
+      get_vector(in, global.dataflow.counts());
+      in.get(global.ilp_next);
+    }
 
-const std::set<std::pair<int, int>> variables::branch_instructions {
-  { 0x04, 0 }, // beq
-  { 0x05, 0 }, // bne
-  { 0x06, 0 }, // blez
-  { 0x07, 0 }, // bgtz
-  { 0x01, 0 }  // bltz, bgez
-  // bltzal, bgezal
-};
+    unsigned long long length;
+    in.get(length);
+    if (length != global.intervals.length) {
+      std::cerr << "MIPS: The checkpoint has intervals of " << length << " instructions, not "
+                << global.intervals.length << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (length) {
+      unsigned width;
+      in.get(width);
+      in.get(global.intervals.left);
+      in.get(global.intervals.count);
+      if (width != (unsigned) global.NumPrintedMetrics() || global.intervals.count > global.intervals.limit) {
+        std::cerr << "MIPS: The checkpoint has intervals of other counters or more than MIPS_INTERVAL_LIMIT.\n";
+        std::exit(EXIT_FAILURE);
+      }
+      for (unsigned long long i = 0; i < (global.intervals.count + 1) * width; i++)
+        in.get(global.intervals.snapshots[i]);
+    }
 
-const std::set<std::pair<int, int>> variables::ld_instructions {
-  { 0x20, 0 }, // lb
-  { 0x24, 0 }, // lbu
-  { 0x21, 0 }, // lh
-  { 0x25, 0 }, // lhu
-  { 0x23, 0 }  // lw
-  // { 0x31, 0 }  // lwc1
-};
+    for (mips_profile* p : {&global.branch_profile, &global.load_profile}) {
+      unsigned shape[2];
+      in.get(shape);
+      if (shape[0] != p->lg2_size() || shape[1] != p->counts_per_pc()) {
+        std::cerr << "MIPS: The checkpoint was taken with another MIPS_PROFILE_ENTRIES, or "
+                  << (shape[1] ? "with" : "without") << " MIPS_PROFILE.\n";
+        std::exit(EXIT_FAILURE);
+      }
+      if (p->enabled()) {
+        get_vector(in, p->pcs());
+        get_vector(in, p->counts());
+        in.get(p->entries_used());
+        in.get(p->dropped_count());
+      }
+    }
+    in.get(global.last_load_pc);
+
+    unsigned long long period;
+    in.get(period);
+    if (period != global.hot_spots.period()) {
+      std::cerr << "MIPS: The checkpoint has hot spots sampled every " << period << " instructions, not "
+                << global.hot_spots.period() << ".\n";
+      std::exit(EXIT_FAILURE);
+    }
+    if (period) {
+      std::map<std::vector<uint32_t>, unsigned long long>& stacks = global.hot_spots.stacks();
+      std::vector<uint32_t> stack;
+      size_t n, depth;
+      in.get(global.hot_spots.instructions_left());
+      in.get(global.hot_spots.calls_beyond());
+      in.get(global.hot_spots_cycles);
+      in.get(depth);
+      global.hot_spots.call_stack().resize(depth);
+      global.hot_spots.return_addresses().resize(depth);
+      get_vector(in, global.hot_spots.call_stack());
+      get_vector(in, global.hot_spots.return_addresses());
+      in.get(n);
+      stacks.clear();
+      while (n--) {
+        in.get(depth);
+        stack.resize(depth);
+        get_vector(in, stack);
+        in.get(stacks[stack]);
+      }
+    }
+    global.UpdateAnalysis();
+  }
+} variables_checkpoint;
+#endif
 
 // *****************************************************
 
 //!Generic instruction behavior method.
 void ac_behavior(instruction) {
 
-  global.number_of_instructions++;
-  global.pc_addr = npc;
-  // Simulates instruction fetch from instruction L1 cache.
-  global.SimulateFetchInstructionFromCaches(ac_pc);
-  // End of cache simulation.
+  // Counts the instruction and simulates its fetch from the instruction L1 cache.
+  global.SetCore(this);
+  global.Fetch(ac_pc, npc);
+  if (global.ConvergedRun())
+    stop();
   dbg_printf("----- PC=%#x ----- %lld\n", (int)ac_pc, ac_instr_counter);
   //  dbg_printf("----- PC=%#x NPC=%#x ----- %lld\n", (int) ac_pc, (int)npc, ac_instr_counter);
 #ifndef NO_NEED_PC_UPDATE
@@ -714,69 +5005,1205 @@ void ac_behavior(Type_J) {
   global.testSuperscalar();
 }
 
-//!Behavior called before starting simulation
-void ac_behavior(begin) {
-  dbg_printf("@@@ begin behavior @@@\n");
-  RB[0] = 0;
-  npc = ac_pc + 4;
+//! Prints the miss ratios of the caches of one sweep, one row per size
+//! and one column per power of two associativity.
+static void PrintSweep(const char* stream, const mips_sweep& s) {
+  unsigned lg2bsize = 0;
 
-  // It is not required by the architecture, but makes debug really easier
-  for (int regNum = 0; regNum < 32; regNum++)
-    RB[regNum] = 0;
-  hi = 0;
-  lo = 0;
+  while ((1U << lg2bsize) < s.block_size())
+    lg2bsize++;
+  printf("%s miss ratios of %llu references:\n  %-8s", stream, s.references(), "Size");
+  for (unsigned assoc = 1; assoc <= s.assoc(); assoc <<= 1)
+    printf(" %5u-way", assoc);
+  printf("\n");
+  // Rows from 1k, or one block if larger.
+  for (unsigned lg2size = std::max(10U, lg2bsize); lg2size <= lg2bsize + s.lg2_sets(); lg2size++) {
+    unsigned long long size = 1ULL << lg2size;
 
-  RB[29] = AC_RAM_END - 1024 - processors_started++ * DEFAULT_STACK_SIZE;
+    if (size >= (1U << 20))
+      printf("  %-8s", (std::to_string(size >> 20) + "M").c_str());
+    else
+      printf("  %-8s", (std::to_string(size >> 10) + "k").c_str());
+    for (unsigned lg2assoc = 0; (1U << lg2assoc) <= s.assoc(); lg2assoc++) {
+      if (lg2assoc > lg2size - lg2bsize)
+        printf(" %9s", "-");
+      else
+        printf(" %9.4f", s.references() ? (double) s.misses(lg2size - lg2bsize - lg2assoc, 1U << lg2assoc) / s.references() : 0);
+    }
+    printf("\n");
+  }
 }
 
-//!Behavior called after finishing simulation
-void ac_behavior(end) {
-  dbg_printf("@@@ end behavior @@@\n");
+//! Prints how the L1 misses of c divide, in the sets sampled.
+static void PrintClassification(const variables::CacheConfiguration& c) {
+  printf("L1 misses by cause, in 1 of %u sets:\n", c.instruction_3c.period());
+  for (std::pair<const char*, const mips_3c*> l1 : {std::make_pair("instruction", &c.instruction_3c),
+                                                    std::make_pair("data", &c.data_3c)}) {
+    double n = l1.second->count(mips_3c::kMisses);
+
+    printf("  %-11s %6.2f%% compulsory, %6.2f%% capacity, %6.2f%% conflict of %llu misses\n", l1.first,
+           n ? 100 * l1.second->count(mips_3c::kCompulsory) / n : 0,
+           n ? 100 * l1.second->count(mips_3c::kCapacity) / n : 0,
+           n ? 100 * l1.second->count(mips_3c::kConflict) / n : 0,
+           l1.second->count(mips_3c::kMisses));
+  }
+}
+
+//! Prints the conflicts between functions in the L1I of hierarchy c, the
+//! pairs with the most first, and the misses with the suggested order.
+static void PrintLayout(unsigned c) {
+  const mips_layout::Result& before = global.layout_before[c];
+  const mips_layout::Result& after = global.layout_after[c];
+  const std::vector<mips_layout::Function>& functions = global.layout.function_list();
+  const d4cache* l1 = global.cache_configurations[c].instruction_l1_cache;
+
+  printf("L1 instruction conflicts between functions, in an LRU model of %d sets of %d x %d bytes%s:\n",
+         l1->numsets, l1->assoc, 1 << l1->lg2blocksize, global.layout.truncated() ? ", first fetches only" : "");
+  printf("  %llu conflict misses of %llu (%llu within a function)\n", before.conflicts, before.misses,
+         before.within);
+  for (size_t k = 0; k < before.pairs.size() && k < variables::kLayoutTop; k++)
+    printf("  %12llu  %s <-> %s\n", before.pairs[k].misses, functions[before.pairs[k].a].name.c_str(),
+           functions[before.pairs[k].b].name.c_str());
+  printf("  With the order of %s: %llu misses (%+.2f%%), %llu conflict\n", global.layout_path.c_str(),
+         after.misses, before.misses ? 100.0 * ((double) after.misses - before.misses) / before.misses : 0,
+         after.conflicts);
+}
+
+//! Prints what the main memory of a hierarchy did.
+static void PrintDram(const mips_dram& d) {
+  unsigned long long reads = d.count(mips_dram::kReads);
+  unsigned long long accesses = d.count(mips_dram::kRowHits) + d.count(mips_dram::kRowEmpty) +
+                                d.count(mips_dram::kRowConflicts);
+  double cycles = (double) d.count(mips_dram::kInstructionCycles) + d.count(mips_dram::kDataCycles);
+
+  printf("DRAM (%u banks, %u-byte rows, %s page): %llu reads, %.1f cycles each beyond the miss penalty, "
+         "%llu from the write queue; %llu writes, %llu drained\n",
+         d.banks, 1U << d.lg2row, d.open_page ? "open" : "closed", reads, reads ? cycles / reads : 0,
+         d.count(mips_dram::kForwarded), d.count(mips_dram::kWrites), d.count(mips_dram::kDrained));
+  printf("DRAM rows: %.2f%% hits, %.2f%% empty, %.2f%% conflicts; %llu refresh stalls\n",
+         accesses ? 100.0 * d.count(mips_dram::kRowHits) / accesses : 0,
+         accesses ? 100.0 * d.count(mips_dram::kRowEmpty) / accesses : 0,
+         accesses ? 100.0 * d.count(mips_dram::kRowConflicts) / accesses : 0, d.count(mips_dram::kRefreshStalls));
+}
+
+//! Prints how long the processors waited for each other below the L1s.
+static void PrintContention(const mips_contention& b) {
+  double transfers = b.count(mips_contention::kTransfers);
+  double rounds = b.count(mips_contention::kRounds);
+
+  printf("Bus (%u bytes a cycle, %s) and %u L2 banks of %u port%s: %.0f transfers in %.0f rounds, "
+         "%.2f cycles each waiting for the bus and %.2f for a bank; %.0f rounds saturated\n",
+         b.width, b.arbiter == mips_contention::kPriority ? "priority" : "round-robin", b.banks, b.ports,
+         b.ports == 1 ? "" : "s", transfers, rounds, transfers ? b.count(mips_contention::kBusWaitCycles) / transfers : 0,
+         transfers ? b.count(mips_contention::kBankWaitCycles) / transfers : 0,
+         b.count(mips_contention::kSaturatedRounds));
+  for (unsigned k = 0; k < b.num_cores(); k++)
+    printf("Processor %u waited %.0f cycles below its L1s\n", k, b.waits(k));
+}
+
+//! Prints what the victim caches and the write buffer of c did.
+static void PrintStages(const variables::CacheConfiguration& c) {
+  static const char* const inclusions[] = {"neither inclusive nor exclusive", "inclusive", "exclusive"};
+  const mips_stages& s = *c.stages;
+
+  printf("L2 %s", inclusions[s.inclusion]);
+  if (s.inclusion == mips_stages::kInclusive)
+    printf(", %llu L1 blocks invalidated", s.count(mips_stages::kBackInvalidations));
+  printf("\n");
+  if (s.victim_entries[mips_stages::kInstruction] || s.victim_entries[mips_stages::kData])
+    printf("Victim cache hits: %llu instruction (%u blocks), %llu data (%u blocks), %llu prefetches; "
+           "%llu write backs\n",
+           s.count(mips_stages::kInstructionVictimHits), s.victim_entries[mips_stages::kInstruction],
+           s.count(mips_stages::kDataVictimHits), s.victim_entries[mips_stages::kData],
+           s.count(mips_stages::kVictimPrefetchHits), s.count(mips_stages::kVictimWritebacks));
+  if (s.buffer_entries)
+    printf("Write buffer (%u blocks): %llu blocks written, %llu writes coalesced, %llu full, %llu drained by reads\n",
+           s.buffer_entries, s.count(mips_stages::kBufferedWrites), s.count(mips_stages::kCoalescedWrites),
+           s.count(mips_stages::kBufferFull), s.count(mips_stages::kReadDrains));
+}
+
+//! Prints what the loop buffer and fetch queue did, and what the L1
+//! instruction accesses they saved would have cost in each hierarchy.
+static void PrintFetch() {
+  const mips_fetch& f = global.frontend;
+  double n = f.count(mips_fetch::kFetches);
+  double avoided = n - f.count(mips_fetch::kAccesses);
+
+  printf("Fetch front end (loop buffer of %u instructions, %u-byte reads, %u instructions ahead):\n",
+         f.loop_capacity(), f.fetch_width(), f.queue_depth());
+  printf("  %llu fetches: %.2f%% from the loop buffer (%llu loops captured), %.2f%% from the queue\n",
+         f.count(mips_fetch::kFetches), n ? 100 * f.count(mips_fetch::kLoopBuffer) / n : 0,
+         f.count(mips_fetch::kLoops), n ? 100 * f.count(mips_fetch::kQueue) / n : 0);
+  printf("  %llu L1 instruction accesses (%llu read past a taken branch), %.0f avoided (%.2f%%)\n",
+         f.count(mips_fetch::kAccesses), f.count(mips_fetch::kWasted), avoided, n ? 100 * avoided / n : 0);
+  if (!global.cache_energy)
+    return;
+  for (unsigned c = 0; c < global.cache_configurations.size(); c++)
+    printf("  #%u: %.0f pJ of L1 hits avoided, %.0f pJ of loop buffer fetches\n", c,
+           avoided * global.cache_configurations[c].l1_hit_energy,
+           f.count(mips_fetch::kLoopBuffer) * global.loop_energy);
+}
+
+//! Prints the misses of a TLB and the cycles of their walks.
+static void PrintTLB(const char* stream, const mips_tlb& t) {
+  double n = t.count(mips_tlb::kAccesses);
+
+  printf("  %-11s %5u entries, %5u-way: %12llu misses of %12llu (%.4f%%), %.0f walk cycles\n", stream, t.entries(),
+         t.assoc(), t.count(mips_tlb::kMisses), t.count(mips_tlb::kAccesses),
+         n ? 100 * t.count(mips_tlb::kMisses) / n : 0, (double) t.count(mips_tlb::kMisses) * global.walk_penalty);
+}
+
+//! Prints the miss ratios of the fully associative LRU caches of one
+//! stream from its reuse distances, one per size up to the largest
+//! distance, and its working sets.
+static void PrintReuse(const char* stream, const mips_reuse& r) {
+  double n = r.count(mips_reuse::kSampled);
+  std::vector<double> sizes = r.working_set_sizes();
+  unsigned lg2bsize = 0, largest = 0;
+
+  while ((1U << lg2bsize) < r.block_size())
+    lg2bsize++;
+  for (unsigned bin = 0; bin < mips_reuse::kBins; bin++)
+    if (r.count(mips_reuse::kFirstBin + bin))
+      largest = bin;
+  printf("%s, %llu references, %.2f%% cold misses:\n", stream, r.count(mips_reuse::kReferences),
+         n ? 100 * r.count(mips_reuse::kCold) / n : 0);
+  // Rows from 1k, or one block if larger.
+  for (unsigned lg2size = std::max(10U, lg2bsize); lg2size <= lg2bsize + largest; lg2size++) {
+    unsigned long long size = 1ULL << lg2size;
+
+    printf("  %-8s %9.4f\n",
+           (size >= (1ULL << 30) ? std::to_string(size >> 30) + "G"
+                                 : size >= (1U << 20) ? std::to_string(size >> 20) + "M"
+                                                      : std::to_string(size >> 10) + "k").c_str(),
+           n ? r.misses(lg2size - lg2bsize) / n : 0);
+  }
+  if (!sizes.empty())
+    printf("  Working set of %llu-reference windows: %.0f bytes on average, %.0f at most, over %zu windows\n",
+           r.window_references(), std::accumulate(sizes.begin(), sizes.end(), 0.0) / sizes.size() * r.block_size(),
+           *std::max_element(sizes.begin(), sizes.end()) * r.block_size(), sizes.size());
+}
+
+//! Prints the misses of the caches of one stream simulated in lanes.
+static void PrintLanes(const char* stream, const mips_lanes& l) {
+  static const char* const policies[] = {"LRU", "FIFO", "random"};
+
+  printf("%s misses of %llu references:\n", stream, l.references());
+  for (unsigned k = 0; k < l.count(); k++) {
+    unsigned long long size = (unsigned long long) l.sets(k) * l.assoc(k) * l.block_size();
+
+    printf("  %-8s %2u-way %-6s %12llu %9.4f\n",
+           (size >= (1U << 20) ? std::to_string(size >> 20) + "M" : std::to_string(size >> 10) + "k").c_str(),
+           l.assoc(k), policies[l.replacement(k)], l.misses(k),
+           l.references() ? (double) l.misses(k) / l.references() : 0);
+  }
+}
+
+//! Prints the analysis results.
+// The L1s of each core and their coherence events.
+static void PrintCoherence(const variables::CacheConfiguration& c) {
+  printf("%s coherence of %u processor%s:\n",
+         c.coherence.get_protocol() == mips_coherence::kMESI ? "MESI" : "MOESI", c.coherence.cores(),
+         c.coherence.cores() == 1 ? "" : "s");
+  for (unsigned k = 0; k < c.coherence.cores(); k++) {
+    const d4cache* i = c.instruction_l1_caches[k];
+    const d4cache* d = c.data_l1_caches[k];
+    const mips_coherence::Counters& n = c.coherence.counters(k);
+
+    printf("  #%u L1 instruction misses: %.0f of %.0f, L1 data misses: %.0f of %.0f\n", k,
+           i->miss[D4XINSTRN], i->fetch[D4XINSTRN],
+           d->miss[D4XREAD] + d->miss[D4XWRITE], d->fetch[D4XREAD] + d->fetch[D4XWRITE]);
+    printf("  #%u snoops: %llu (%llu filtered), upgrades: %llu, invalidations: %llu, "
+           "interventions: %llu (%llu written back)\n", k, n.snoops, n.filtered, n.upgrades,
+           n.invalidations, n.interventions, n.writebacks);
+  }
+}
+
+//! Prints the cycles and instructions per cycle of each issue model, and
+//! how many of its groups had each size.
+static void PrintIssue() {
+  for (const variables::IssueModel& m : global.issue_models) {
+    unsigned long long cycles = 0, instructions = 0;
+
+    for (unsigned k = 1; k <= m.width; k++) {
+      cycles += m.groups[k - 1];
+      instructions += k * m.groups[k - 1];
+    }
+    printf("Issue %u wide (%u ALU, %u mul/div, %u load/store, %u branch): %llu cycles, IPC %.3f\n",
+           m.width, m.units[variables::kAluUnit], m.units[variables::kMulDivUnit],
+           m.units[variables::kMemoryUnit], m.units[variables::kBranchUnit], cycles,
+           cycles ? (double) instructions / cycles : 0);
+    for (unsigned k = 1; k <= m.width; k++)
+      printf("  Groups of %u: %llu (%.2f \%)\n", k, m.groups[k - 1],
+             cycles ? 100.0 * m.groups[k - 1] / cycles : 0);
+  }
+}
+
+//! Prints the cycles and instructions per cycle of the out-of-order
+//! window, and where the cycles went. Builds without the branch analysis
+//! mispredict nothing.
+static void PrintOutOfOrder() {
+  const mips_ooo& o = global.ooo;
+  unsigned long long cycles = o.cycles();
+  std::string predictor = variables::kBranches ? global.predictors[global.ooo_config.predictor]->name() : "no";
+
+  printf("Out-of-order (%u ROB, %u queue, %u wide, #%u loads, %s mispredictions): "
+         "%llu cycles, IPC %.3f\n", o.rob_size(), o.queue_size(), o.dispatch_width(),
+         global.ooo_config.hierarchy, predictor.c_str(),
+         cycles, cycles ? (double) o.instructions() / cycles : 0);
+  printf("  Dispatch stalls, ROB full: %llu\n", o.stalls(mips_ooo::kRobFull));
+  printf("  Dispatch stalls, issue queue full: %llu\n", o.stalls(mips_ooo::kQueueFull));
+  printf("  Dispatch stalls, mispredictions: %llu\n", o.stalls(mips_ooo::kMispredictions));
+  printf("  Cycles waiting for operands: %llu\n", o.stalls(mips_ooo::kOperands));
+  printf("  Cycles waiting for loads: %llu\n", o.stalls(mips_ooo::kMemory));
+}
+
+//! Prints the critical path of the limit study and the parallelism it
+//! leaves, the upper bound of the issue models and the window.
+static void PrintIlp() {
+  const mips_ilp& d = global.dataflow;
+  std::string window = d.window_size() ? std::to_string(d.window_size()) + " window" : "unlimited window";
+
+  printf("ILP limit (%s, %s memory dependences): critical path %llu cycles, ILP %.3f\n", window.c_str(),
+         d.memory_dependences() ? "with" : "no", (unsigned long long) d.critical_path(), d.ilp());
+  printf("  Loads waiting for stores: %llu\n", d.count(mips_ilp::kMemoryWaits));
+  printf("  Instructions waiting for the window: %llu\n", d.count(mips_ilp::kWindowWaits));
+}
+
+//! Prints the static branches of the profile mispredicted most by the
+//! last predictor, and the loads with the most stall cycles in the first
+//! pipeline and hierarchy: one per load-use hazard, plus the miss penalty
+//! of each L1 miss.
+static void PrintProfile() {
+  const variables& g = global;
+  const unsigned predictors = g.predictors.size(), pipelines = g.pipelines.size();
+  const unsigned hierarchies = g.cache_configurations.size();
+  const double miss_penalty = hierarchies ? g.cache_configurations[0].miss_penalty : 0;
+  std::string names;
+
+  if (variables::kBranches) {
+    for (unsigned q = 0; q < predictors; q++)
+      names += (q ? ", " : "") + g.predictors[q]->name();
+    printf("Branch profile, the %u of %llu static branches mispredicted most by %s:\n", g.profile_top,
+           g.branch_profile.size(), g.predictors[predictors - 1]->name().c_str());
+    printf("  %-10s %-32s %12s %7s  Mispredictions (%s)\n", "PC", "Function", "Executed", "Taken", names.c_str());
+    auto score = [&](const unsigned long long* c) { return (double) c[1 + predictors]; };
+    for (const std::pair<uint32_t, const unsigned long long*>& b : g.branch_profile.top(g.profile_top, score)) {
+      printf("  %#010x %-32s %12llu %6.2f%% ", b.first, ac_symbol_name(b.first).c_str(),
+             b.second[0], b.second[0] ? 100.0 * b.second[1] / b.second[0] : 0);
+      for (unsigned q = 0; q < predictors; q++)
+        printf(" %llu", b.second[2 + q]);
+      printf("\n");
+    }
+    if (g.branch_profile.dropped())
+      printf("  %llu executions of branches beyond MIPS_PROFILE_ENTRIES left out\n", g.branch_profile.dropped());
+  }
+
+  names.clear();
+  for (unsigned p = 0; p < pipelines; p++)
+    names += (p ? ", " : "") + std::to_string(g.pipelines[p].depth);
+  printf("Load profile, the %u of %llu static loads with the most stall cycles (%u stages, #0):\n",
+         g.profile_top, g.load_profile.size(), g.pipelines[0].depth);
+  printf("  %-10s %-32s %12s %12s  Load-use hazards (%s stages)  L1 misses (#0 to #%u)\n", "PC", "Function",
+         "Executed", "Stalls", names.c_str(), hierarchies - 1);
+  auto score = [&](const unsigned long long* c) {
+    return c[1] + c[1 + pipelines] * miss_penalty;
+  };
+  for (const std::pair<uint32_t, const unsigned long long*>& l : g.load_profile.top(g.profile_top, score)) {
+    printf("  %#010x %-32s %12llu %12.0f ", l.first, ac_symbol_name(l.first).c_str(), l.second[0], score(l.second));
+    for (unsigned p = 0; p < pipelines; p++)
+      printf(" %llu", l.second[1 + p]);
+    printf("  ");
+    for (unsigned c = 0; c < hierarchies; c++)
+      printf(" %llu", l.second[1 + pipelines + c]);
+    printf("\n");
+  }
+  if (g.load_profile.dropped())
+    printf("  %llu executions of loads beyond MIPS_PROFILE_ENTRIES left out\n", g.load_profile.dropped());
+}
+
+//! Prints the functions of the most samples of their own, with their
+//! share of every sample and of those in what they called.
+static void PrintHotSpots() {
+  const variables& g = global;
+  double total = g.hot_spots.total();
+
+  printf("Hot spots, the %u functions with the most %s of their own, sampled every %llu instructions:\n",
+         variables::kHotSpotsTop, variables::kOutOfOrder && g.out_of_order ? "cycles" : "instructions",
+         g.hot_spots.period());
+  printf("  %-10s %-32s %14s %7s %14s %7s\n", "Entry", "Function", "Self", "", "Total", "");
+  for (const mips_hotspots::Function& f : g.hot_spots.top(variables::kHotSpotsTop))
+    printf("  %#010x %-32s %14llu %6.2f%% %14llu %6.2f%%\n", f.entry, ac_symbol_name(f.entry).c_str(), f.self,
+           total ? 100 * f.self / total : 0, f.total, total ? 100 * f.total / total : 0);
+}
+
+//! Prints the loops of the most instructions, with the distribution of
+//! their trip counts and the costs of an iteration.
+static void PrintLoops() {
+  const variables& g = global;
+  double total = g.number_of_instructions;
+
+  printf("Hot loops, the %u of the most instructions, of %zu found:\n", g.loops_top, g.loops.loop_list().size());
+  printf("  %-10s %-32s %7s %10s %12s %10s %8s %8s %8s  %s\n", "Header", "Loop", "", "Entries", "Iterations",
+         "Longest", "Instrs", "Misses", "Mispred", "Trips 1 2-3 4-7 ...");
+  for (const mips_loops::Loop* l : g.loops.top(g.loops_top)) {
+    double n = l->measured();
+    unsigned last = mips_loops::kBuckets;
+
+    printf("  %#010x %-32s %6.2f%% %10llu %12llu %10llu %8.2f %8.3f %8.3f ", l->header,
+           ac_symbol_name(l->header).c_str(), total ? 100 * l->instructions / total : 0, l->entries, l->iterations,
+           l->max_trips, n ? l->instructions / n : 0, n ? l->misses / n : 0, n ? l->mispredictions / n : 0);
+    while (last && !l->trips[last - 1])
+      last--;
+    for (unsigned b = 0; b < last; b++)
+      printf(" %.0f%%", 100.0 * l->trips[b] / l->entries);
+    printf("\n");
+  }
+}
+
+//! Prints the estimated cycles of every pipeline, predictor and
+//! hierarchy, and the share of each kind of stall in their CPI.
+static void PrintCycleEstimates() {
+  double n = global.number_of_instructions;
+
+  printf("Estimated cycles, one per instruction plus the stalls:\n");
+  for (unsigned p = 0; p < global.pipelines.size(); p++)
+    for (unsigned q = 0; q < global.predictors.size(); q++)
+      for (unsigned c = 0; c < global.cache_configurations.size(); c++) {
+        variables::CycleEstimate e = global.EstimateCycles(p, q, global.cache_configurations[c]);
+        std::string name = std::to_string(global.pipelines[p].depth) + " stages + " +
+                           global.predictors[q]->name() + ", #" + std::to_string(c) + ":";
+
+        printf("  %-34s %.0f (CPI %.3f = 1 + data %.3f + control %.3f + branches %.3f"
+               " + I-cache %.3f + D-cache %.3f)\n", name.c_str(), e.total(), n ? e.total() / n : 0,
+               n ? e.data_hazards / n : 0, n ? e.control_hazards / n : 0, n ? e.mispredictions / n : 0,
+               n ? e.fetch_stalls / n : 0, n ? e.data_stalls / n : 0);
+      }
+  for (unsigned k = 0; k < global.core_counters.size(); k++) {
+    const variables::CoreConfiguration& core = global.core_configurations[k];
+    double instructions = global.core_counters[k].instructions;
+
+    for (unsigned c = 0; c < global.cache_configurations.size(); c++) {
+      const variables::CacheConfiguration& h = global.cache_configurations[c];
+      variables::CycleEstimate e = global.EstimateCoreCycles(k, h);
+      std::string name = "Core " + std::to_string(k) + ", " + std::to_string(global.pipelines[core.pipeline].depth) +
+                         " stages + " + global.predictors[core.predictor]->name() + ", #" + std::to_string(c) + ":";
+
+      printf("  %-34s %.0f (CPI %.3f = 1 + data %.3f + control %.3f + branches %.3f"
+             " + I-cache %.3f + D-cache %.3f), L1s %dk/%dk\n", name.c_str(), e.total(),
+             instructions ? e.total() / instructions : 0, instructions ? e.data_hazards / instructions : 0,
+             instructions ? e.control_hazards / instructions : 0, instructions ? e.mispredictions / instructions : 0,
+             instructions ? e.fetch_stalls / instructions : 0, instructions ? e.data_stalls / instructions : 0,
+             (1 << h.instruction_l1_caches[k]->lg2size) >> 10, (1 << h.data_l1_caches[k]->lg2size) >> 10);
+    }
+  }
+}
+
+//! Prints the branches, the mispredictions of each predictor, of the
+//! BTB and of the RAS, and the stall cycles of each pipeline.
+static void PrintBranches() {
+  printf("Total number of branches:  %llu\n\n", global.total_number_of_branches);
+  // The labels are aligned as they were for the first three predictors
+  int width = 14, stall_width = 26;
+  for (const std::unique_ptr<mips_predictor>& p : global.predictors)
+    width = std::max(width, (int) p->name().size() + 4);
+  for (const variables::Pipeline& p : global.pipelines)
+    for (const std::unique_ptr<mips_predictor>& q : global.predictors)
+      stall_width = std::max(stall_width, (int) (std::to_string(p.depth) + q->name()).size() + 14);
+  for (unsigned i = 0; i < global.predictors.size(); i++) {
+    unsigned long long wrong = global.wrong_predictions[i];
+    printf("Wrong branch predictions %-*s%llu (%.2f \%)\n", width, ("(" + global.predictors[i]->name() + "):").c_str(),
+           wrong, ((float) wrong / global.total_number_of_branches) * 100);
+  }
+  printf("BTB misses: %llu of %llu taken branches and jumps (%.2f \%)\n", global.btb_misses, global.taken_branches,
+         ((float) global.btb_misses / global.taken_branches) * 100);
+  printf("RAS misses: %llu of %llu returns (%.2f \%)\n\n", global.ras_misses, global.returns,
+         ((float) global.ras_misses / global.returns) * 100);
+  // Each misprediction costs the branch penalty of the pipeline
+  for (const variables::Pipeline& p : global.pipelines) {
+    std::string stages = "(" + std::to_string(p.depth) + " stages + ";
+    for (unsigned i = 0; i < global.predictors.size(); i++)
+      printf("Number of stall cycles %-*s%llu\n", stall_width, (stages + global.predictors[i]->name() + "):").c_str(),
+             global.wrong_predictions[i] * p.branch_penalty);
+  }
+}
+
+//! Prints the share of the loads each value predictor predicts, how many
+//! of them right, and the share it would guess right if always trusted.
+static void PrintValues() {
+  const mips_values& v = global.values;
+  static const char* const names[mips_values::kNumPredictors] = {"last value", "stride", "context"};
+  double loads = v.count(mips_values::kLoads);
+
+  printf("Value prediction of %.0f loads, tables of %u PCs (%.2f%% of the loads missed them) and %u contexts:\n",
+         loads, v.table_entries(), loads ? 100 * v.count(mips_values::kTableMisses) / loads : 0,
+         v.context_entries());
+  for (unsigned p = 0; p < mips_values::kNumPredictors; p++) {
+    mips_values::Predictor q = mips_values::Predictor(p);
+    double predicted = v.count(mips_values::kPredicted, q);
+
+    printf("  %-10s %6.2f%% coverage, %6.2f%% accuracy, %6.2f%% predictable\n", names[p],
+           loads ? 100 * predicted / loads : 0, predicted ? 100 * v.count(mips_values::kCorrect, q) / predicted : 0,
+           loads ? 100 * v.count(mips_values::kPotential, q) / loads : 0);
+  }
+  printf("  %-10s %6.2f%% predictable by one of them at least\n\n", "any",
+         loads ? 100 * v.count(mips_values::kAnyPotential) / loads : 0);
+}
+
+//! Adds the Dinero IV counters of cache c to the statistics of
+//! --stats-out, in section.
+// Counts of the sampled sets, with the period to scale them by.
+static void AddClassificationStats(const std::string& section, const mips_3c& c) {
+  ac_stats_out_add(section, "period", c.period());
+  ac_stats_out_add(section, "references", c.count(mips_3c::kReferences));
+  ac_stats_out_add(section, "misses", c.count(mips_3c::kMisses));
+  ac_stats_out_add(section, "compulsory", c.count(mips_3c::kCompulsory));
+  ac_stats_out_add(section, "capacity", c.count(mips_3c::kCapacity));
+  ac_stats_out_add(section, "conflict", c.count(mips_3c::kConflict));
+}
+
+// Waits below the L1s, and those of each processor.
+static void AddContentionStats(const std::string& section, const mips_contention& b) {
+  ac_stats_out_add(section, "width", b.width);
+  ac_stats_out_add(section, "priority", b.arbiter == mips_contention::kPriority);
+  ac_stats_out_add(section, "banks", b.banks);
+  ac_stats_out_add(section, "ports", b.ports);
+  ac_stats_out_add(section, "rounds", b.count(mips_contention::kRounds));
+  ac_stats_out_add(section, "saturated_rounds", b.count(mips_contention::kSaturatedRounds));
+  ac_stats_out_add(section, "transfers", b.count(mips_contention::kTransfers));
+  ac_stats_out_add(section, "bus_busy_cycles", b.count(mips_contention::kBusBusyCycles));
+  ac_stats_out_add(section, "bus_wait_cycles", b.count(mips_contention::kBusWaitCycles));
+  ac_stats_out_add(section, "bank_wait_cycles", b.count(mips_contention::kBankWaitCycles));
+  ac_stats_out_add(section, "instruction_wait_cycles", b.count(mips_contention::kInstructionCycles));
+  ac_stats_out_add(section, "data_wait_cycles", b.count(mips_contention::kDataCycles));
+  for (unsigned k = 0; k < b.num_cores(); k++)
+    ac_stats_out_add(section, "core" + std::to_string(k) + "_wait_cycles", b.waits(k));
+}
+
+// Counters of the victim caches and the write buffer.
+static void AddDramStats(const std::string& section, const mips_dram& d) {
+  ac_stats_out_add(section, "banks", d.banks);
+  ac_stats_out_add(section, "row_bytes", 1U << d.lg2row);
+  ac_stats_out_add(section, "open_page", d.open_page);
+  ac_stats_out_add(section, "reads", d.count(mips_dram::kReads));
+  ac_stats_out_add(section, "writes", d.count(mips_dram::kWrites));
+  ac_stats_out_add(section, "row_hits", d.count(mips_dram::kRowHits));
+  ac_stats_out_add(section, "row_empty", d.count(mips_dram::kRowEmpty));
+  ac_stats_out_add(section, "row_conflicts", d.count(mips_dram::kRowConflicts));
+  ac_stats_out_add(section, "forwarded_reads", d.count(mips_dram::kForwarded));
+  ac_stats_out_add(section, "refresh_stalls", d.count(mips_dram::kRefreshStalls));
+  ac_stats_out_add(section, "drained_writes", d.count(mips_dram::kDrained));
+  ac_stats_out_add(section, "instruction_read_cycles", d.count(mips_dram::kInstructionCycles));
+  ac_stats_out_add(section, "data_read_cycles", d.count(mips_dram::kDataCycles));
+}
+
+static void AddStageStats(const std::string& section, const mips_stages& s) {
+  ac_stats_out_add(section, "inclusion", (int) s.inclusion);
+  ac_stats_out_add(section, "instruction_victim_entries", s.victim_entries[mips_stages::kInstruction]);
+  ac_stats_out_add(section, "data_victim_entries", s.victim_entries[mips_stages::kData]);
+  ac_stats_out_add(section, "write_buffer_entries", s.buffer_entries);
+  ac_stats_out_add(section, "instruction_victim_hits", s.count(mips_stages::kInstructionVictimHits));
+  ac_stats_out_add(section, "data_victim_hits", s.count(mips_stages::kDataVictimHits));
+  ac_stats_out_add(section, "victim_prefetch_hits", s.count(mips_stages::kVictimPrefetchHits));
+  ac_stats_out_add(section, "victim_writebacks", s.count(mips_stages::kVictimWritebacks));
+  ac_stats_out_add(section, "buffered_writes", s.count(mips_stages::kBufferedWrites));
+  ac_stats_out_add(section, "coalesced_writes", s.count(mips_stages::kCoalescedWrites));
+  ac_stats_out_add(section, "buffer_full", s.count(mips_stages::kBufferFull));
+  ac_stats_out_add(section, "read_drains", s.count(mips_stages::kReadDrains));
+  ac_stats_out_add(section, "back_invalidations", s.count(mips_stages::kBackInvalidations));
+}
+
+static void AddCacheStats(const std::string& section, const d4cache* c) {
+  static const char* const types[] = {"read", "write", "instruction", "misc", "copyback", "invalidate"};
+
+  for (int t = 0; t < 6; t++) {
+    ac_stats_out_add(section, std::string(types[t]) + "_fetches", c->fetch[t]);
+    ac_stats_out_add(section, std::string(types[t]) + "_misses", c->miss[t]);
+    ac_stats_out_add(section, std::string(types[t]) + "_block_misses", c->blockmiss[t]);
+    ac_stats_out_add(section, std::string("prefetch_") + types[t] + "_fetches", c->fetch[D4PREFETCH + t]);
+    ac_stats_out_add(section, std::string("prefetch_") + types[t] + "_misses", c->miss[D4PREFETCH + t]);
+    ac_stats_out_add(section, std::string(types[t]) + "_compulsory_misses", c->comp_miss[t]);
+    ac_stats_out_add(section, std::string(types[t]) + "_capacity_misses", c->cap_miss[t]);
+    ac_stats_out_add(section, std::string(types[t]) + "_conflict_misses", c->conf_miss[t]);
+  }
+  ac_stats_out_add(section, "bytes", (double) (1ULL << c->lg2size));
+  ac_stats_out_add(section, "multiblock", c->multiblock);
+  ac_stats_out_add(section, "bytes_read", c->bytes_read);
+  ac_stats_out_add(section, "bytes_written", c->bytes_written);
+}
+
+//! Adds what the report prints to the statistics of --stats-out, in
+//! sections named after its labels: mips, mips.pipeline.DEPTH,
+//! mips.predictor.NAME, mips.issue.WIDTH, mips.ooo, mips.ilp,
+//! mips.cycles.DEPTH.PREDICTOR.HIERARCHY and mips.cache.HIERARCHY, with
+//! the Dinero IV counters of its caches in mips.cache.HIERARCHY.CACHE,
+//! the TLBs in mips.tlb.STREAM and the reuse distances in
+//! mips.reuse.STREAM.
+static void AddAnalysisStats() {
+  const variables& g = global;
+
+  ac_stats_out_add("mips", "nops", g.number_of_nops);
+  ac_stats_out_add("mips", "instructions", g.number_of_instructions);
+  if (g.sampling.enabled) {
+    ac_stats_out_add("mips.sampling", "windows", g.sampling.windows);
+    ac_stats_out_add("mips.sampling", "measured", g.sampling.windows * g.sampling.measure);
+    ac_stats_out_add("mips.sampling", "total", g.sampling.total);
+    ac_stats_out_add("mips.sampling", "detailed", g.sampling.detailed);
+    if (g.sampling.target) {
+      ac_stats_out_add("mips.sampling", "target_mips", g.sampling.target / 1e6);
+      ac_stats_out_add("mips.sampling", "shortest_period", g.sampling.shortest);
+      ac_stats_out_add("mips.sampling", "longest_period", g.sampling.longest);
+      ac_stats_out_add("mips.sampling", "seconds", g.sampling.seconds);
+    }
+  }
+  if (g.convergence.rates.length) {
+    const variables::Convergence& c = g.convergence;
+
+    ac_stats_out_add("mips.convergence", "interval", c.rates.length);
+    ac_stats_out_add("mips.convergence", "window", c.window);
+    ac_stats_out_add("mips.convergence", "tolerance", c.tolerance);
+    ac_stats_out_add("mips.convergence", "converged", (int) c.converged);
+    ac_stats_out_add("mips.convergence", "stopped_run", (int) (c.converged && c.stop_run));
+    ac_stats_out_add("mips.convergence", "intervals", c.intervals);
+    if (c.converged) {
+      ac_stats_out_add("mips.convergence", "instructions", c.at);
+      ac_stats_out_add("mips.convergence", "cpi", c.means[0]);
+      ac_stats_out_add("mips.convergence", "l1i_miss_rate", c.means[1 + variables::Live::kL1I]);
+      ac_stats_out_add("mips.convergence", "l1d_miss_rate", c.means[1 + variables::Live::kL1D]);
+      ac_stats_out_add("mips.convergence", "l2_miss_rate", c.means[1 + variables::Live::kL2]);
+    }
+  }
+  for (unsigned p = 0; variables::kHazards && p < g.pipelines.size(); p++) {
+    std::string section = "mips.pipeline." + std::to_string(g.pipelines[p].depth);
+
+    ac_stats_out_add(section, "data_hazards", g.number_of_data_hazards[p]);
+    ac_stats_out_add(section, "control_hazards", g.number_of_control_hazards[p]);
+    ac_stats_out_add(section, "store_forwards", g.store_forwards[p]);
+    ac_stats_out_add(section, "store_stalls", g.store_stalls[p]);
+    ac_stats_out_add(section, "ordering_violations", g.ordering_violations[p]);
+  }
+  if (variables::kBranches) {
+    ac_stats_out_add("mips", "branches", g.total_number_of_branches);
+    ac_stats_out_add("mips", "taken_branches", g.taken_branches);
+    ac_stats_out_add("mips", "btb_misses", g.btb_misses);
+    ac_stats_out_add("mips", "returns", g.returns);
+    ac_stats_out_add("mips", "ras_misses", g.ras_misses);
+    for (unsigned q = 0; q < g.predictors.size(); q++) {
+      ac_stats_out_add("mips.predictor." + g.predictors[q]->name(), "mispredictions", g.wrong_predictions[q]);
+      for (const variables::Pipeline& p : g.pipelines)
+        ac_stats_out_add("mips.pipeline." + std::to_string(p.depth), "stall_cycles." + g.predictors[q]->name(),
+                         (double) g.wrong_predictions[q] * p.branch_penalty);
+    }
+  }
+  if (g.values.enabled()) {
+    const mips_values& v = g.values;
+    static const char* const names[mips_values::kNumPredictors] = {"last_value", "stride", "context"};
+
+    ac_stats_out_add("mips.values", "entries", v.table_entries());
+    ac_stats_out_add("mips.values", "contexts", v.context_entries());
+    ac_stats_out_add("mips.values", "loads", v.count(mips_values::kLoads));
+    ac_stats_out_add("mips.values", "table_misses", v.count(mips_values::kTableMisses));
+    ac_stats_out_add("mips.values", "any_potential", v.count(mips_values::kAnyPotential));
+    for (unsigned p = 0; p < mips_values::kNumPredictors; p++) {
+      std::string section = std::string("mips.values.") + names[p];
+      mips_values::Predictor q = mips_values::Predictor(p);
+
+      ac_stats_out_add(section, "predicted", v.count(mips_values::kPredicted, q));
+      ac_stats_out_add(section, "correct", v.count(mips_values::kCorrect, q));
+      ac_stats_out_add(section, "potential", v.count(mips_values::kPotential, q));
+    }
+  }
+  for (unsigned i = 0; variables::kSuperscalar && i < g.issue_models.size(); i++) {
+    const variables::IssueModel& m = g.issue_models[i];
+    std::string section = "mips.issue." + std::to_string(m.width);
+    double cycles = 0, instructions = 0;
+
+    for (unsigned k = 1; k <= m.width; k++) {
+      cycles += m.groups[k - 1];
+      instructions += k * m.groups[k - 1];
+      ac_stats_out_add(section, "groups_of_" + std::to_string(k), m.groups[k - 1]);
+    }
+    ac_stats_out_add(section, "cycles", cycles);
+    ac_stats_out_add(section, "ipc", cycles ? instructions / cycles : 0);
+  }
+  if (variables::kOutOfOrder && g.out_of_order) {
+    const mips_ooo& o = g.ooo;
+
+    ac_stats_out_add("mips.ooo", "instructions", o.instructions());
+    ac_stats_out_add("mips.ooo", "cycles", o.cycles());
+    ac_stats_out_add("mips.ooo", "ipc", o.cycles() ? (double) o.instructions() / o.cycles() : 0);
+    ac_stats_out_add("mips.ooo", "rob_full_stalls", o.stalls(mips_ooo::kRobFull));
+    ac_stats_out_add("mips.ooo", "queue_full_stalls", o.stalls(mips_ooo::kQueueFull));
+    ac_stats_out_add("mips.ooo", "misprediction_stalls", o.stalls(mips_ooo::kMispredictions));
+    ac_stats_out_add("mips.ooo", "operand_waits", o.stalls(mips_ooo::kOperands));
+    ac_stats_out_add("mips.ooo", "load_waits", o.stalls(mips_ooo::kMemory));
+  }
+  if (variables::kOutOfOrder && g.ilp) {
+    const mips_ilp& d = g.dataflow;
+
+    ac_stats_out_add("mips.ilp", "instructions", d.instructions());
+    ac_stats_out_add("mips.ilp", "critical_path", d.critical_path());
+    ac_stats_out_add("mips.ilp", "ilp", d.ilp());
+    ac_stats_out_add("mips.ilp", "memory_waits", d.count(mips_ilp::kMemoryWaits));
+    ac_stats_out_add("mips.ilp", "window_waits", d.count(mips_ilp::kWindowWaits));
+  }
+  if (g.loops.enabled()) {
+    std::vector<const mips_loops::Loop*> top = g.loops.top(g.loops_top);
+
+    ac_stats_out_add("mips.loops", "loops", g.loops.loop_list().size());
+    for (unsigned k = 0; k < top.size(); k++) {
+      const mips_loops::Loop& l = *top[k];
+      std::string section = "mips.loops." + std::to_string(k);
+      double n = l.measured();
+
+      ac_stats_out_add(section, "header", l.header);
+      ac_stats_out_add(section, "instructions", l.instructions);
+      ac_stats_out_add(section, "entries", l.entries);
+      ac_stats_out_add(section, "iterations", l.iterations);
+      ac_stats_out_add(section, "longest_trip", l.max_trips);
+      ac_stats_out_add(section, "iteration_instructions", n ? l.instructions / n : 0);
+      ac_stats_out_add(section, "iteration_misses", n ? l.misses / n : 0);
+      ac_stats_out_add(section, "iteration_mispredictions", n ? l.mispredictions / n : 0);
+    }
+  }
+  for (unsigned p = 0; p < g.pipelines.size(); p++)
+    for (unsigned q = 0; q < g.predictors.size(); q++)
+      for (unsigned c = 0; c < g.cache_configurations.size(); c++) {
+        variables::CycleEstimate e = g.EstimateCycles(p, q, g.cache_configurations[c]);
+        std::string section = "mips.cycles." + std::to_string(g.pipelines[p].depth) + "." +
+                              g.predictors[q]->name() + "." + std::to_string(c);
+
+        ac_stats_out_add(section, "total", e.total());
+        ac_stats_out_add(section, "cpi", e.instructions ? e.total() / e.instructions : 0);
+        ac_stats_out_add(section, "data_hazards", e.data_hazards);
+        ac_stats_out_add(section, "control_hazards", e.control_hazards);
+        ac_stats_out_add(section, "mispredictions", e.mispredictions);
+        ac_stats_out_add(section, "fetch_stalls", e.fetch_stalls);
+        ac_stats_out_add(section, "data_stalls", e.data_stalls);
+      }
+  if (!variables::kCaches)
+    return;
+  ac_stats_out_add("mips", "memory_accesses", g.num_memory_acesses);
+  if (g.tlbs) {
+    ac_stats_out_add("mips.tlb", "page_size", g.data_tlb.page_size());
+    ac_stats_out_add("mips.tlb", "walk_penalty", g.walk_penalty);
+    ac_stats_out_add("mips.tlb", "walk_references", g.walk_references);
+    for (std::pair<const char*, const mips_tlb*> t : {std::make_pair("mips.tlb.instruction", &g.instruction_tlb),
+                                                      std::make_pair("mips.tlb.data", &g.data_tlb)}) {
+      ac_stats_out_add(t.first, "entries", t.second->entries());
+      ac_stats_out_add(t.first, "assoc", t.second->assoc());
+      ac_stats_out_add(t.first, "accesses", t.second->count(mips_tlb::kAccesses));
+      ac_stats_out_add(t.first, "misses", t.second->count(mips_tlb::kMisses));
+    }
+  }
+  if (g.frontend.enabled()) {
+    const mips_fetch& f = g.frontend;
+
+    ac_stats_out_add("mips.fetch", "loop_buffer", f.loop_capacity());
+    ac_stats_out_add("mips.fetch", "fetch_width", f.fetch_width());
+    ac_stats_out_add("mips.fetch", "queue", f.queue_depth());
+    ac_stats_out_add("mips.fetch", "fetches", f.count(mips_fetch::kFetches));
+    ac_stats_out_add("mips.fetch", "loop_buffer_fetches", f.count(mips_fetch::kLoopBuffer));
+    ac_stats_out_add("mips.fetch", "queue_fetches", f.count(mips_fetch::kQueue));
+    ac_stats_out_add("mips.fetch", "loops", f.count(mips_fetch::kLoops));
+    ac_stats_out_add("mips.fetch", "accesses", f.count(mips_fetch::kAccesses));
+    ac_stats_out_add("mips.fetch", "wasted", f.count(mips_fetch::kWasted));
+    if (g.cache_energy)
+      ac_stats_out_add("mips.fetch", "loop_energy_pj", f.count(mips_fetch::kLoopBuffer) * g.loop_energy);
+  }
+  if (g.reuse) {
+    for (std::pair<const char*, const mips_reuse*> r :
+         {std::make_pair("mips.reuse.instruction", &g.instruction_reuse),
+          std::make_pair("mips.reuse.data", &g.data_reuse)}) {
+      double n = r.second->count(mips_reuse::kSampled);
+      std::vector<double> sizes = r.second->working_set_sizes();
+      unsigned lg2bsize = 0;
+
+      while ((1U << lg2bsize) < r.second->block_size())
+        lg2bsize++;
+      ac_stats_out_add(r.first, "block_size", r.second->block_size());
+      ac_stats_out_add(r.first, "rate", r.second->rate());
+      ac_stats_out_add(r.first, "references", r.second->count(mips_reuse::kReferences));
+      ac_stats_out_add(r.first, "sampled", r.second->count(mips_reuse::kSampled));
+      ac_stats_out_add(r.first, "cold", r.second->count(mips_reuse::kCold));
+      // Fully associative LRU caches from 1k to 64M.
+      for (unsigned lg2size = std::max(10U, lg2bsize); lg2size <= 26; lg2size++) {
+        unsigned long long size = 1ULL << lg2size;
+
+        ac_stats_out_add(r.first,
+                         "miss_ratio_" + (size >= (1U << 20) ? std::to_string(size >> 20) + "M"
+                                                             : std::to_string(size >> 10) + "k"),
+                         n ? r.second->misses(lg2size - lg2bsize) / n : 0);
+      }
+      if (!sizes.empty()) {
+        ac_stats_out_add(r.first, "mean_working_set_bytes",
+                         std::accumulate(sizes.begin(), sizes.end(), 0.0) / sizes.size() * r.second->block_size());
+        ac_stats_out_add(r.first, "max_working_set_bytes",
+                         *std::max_element(sizes.begin(), sizes.end()) * r.second->block_size());
+      }
+    }
+  }
+  for (unsigned k = 0; k < g.cache_configurations.size(); k++) {
+    const variables::CacheConfiguration& c = g.cache_configurations[k];
+    variables::MemoryTiming timing = variables::GetMemoryTiming(c);
+    std::string section = "mips.cache." + std::to_string(k);
+
+    ac_stats_out_add(section, "l1_hit_latency", c.l1_hit_latency);
+    ac_stats_out_add(section, "miss_penalty", c.miss_penalty);
+    ac_stats_out_add(section, "memory_cycles", timing.cycles);
+    ac_stats_out_add(section, "stall_cycles", timing.stalls);
+    ac_stats_out_add(section, "amat", timing.amat);
+    if (g.cache_energy) {
+      variables::CacheEnergy e = variables::ReportedCacheEnergy(c);
+
+      ac_stats_out_add(section, "energy_pj", e.total());
+      ac_stats_out_add(section, "l1_energy_pj", e.l1);
+      ac_stats_out_add(section, "l2_energy_pj", e.l2);
+      ac_stats_out_add(section, "memory_energy_pj", e.memory);
+    }
+    AddCacheStats(section + ".l2", c.l2_cache);
+    if (k < g.layout_before.size()) {
+      ac_stats_out_add(section + ".l1i.layout", "conflicts", g.layout_before[k].conflicts);
+      ac_stats_out_add(section + ".l1i.layout", "misses", g.layout_before[k].misses);
+      ac_stats_out_add(section + ".l1i.layout", "reordered_conflicts", g.layout_after[k].conflicts);
+      ac_stats_out_add(section + ".l1i.layout", "reordered_misses", g.layout_after[k].misses);
+    }
+    if (c.dram)
+      AddDramStats(section + ".dram", *c.dram);
+    if (c.contention)
+      AddContentionStats(section + ".bus", *c.contention);
+    if (!g.coherent) {
+      AddCacheStats(section + ".l1i", c.instruction_l1_cache);
+      AddCacheStats(section + ".l1d", c.data_l1_cache);
+      if (g.classify) {
+        AddClassificationStats(section + ".l1i.3c", c.instruction_3c);
+        AddClassificationStats(section + ".l1d.3c", c.data_3c);
+      }
+      if (c.stages)
+        AddStageStats(section + ".stages", *c.stages);
+      continue;
+    }
+    for (unsigned core = 0; core < c.coherence.cores(); core++) {
+      const mips_coherence::Counters& n = c.coherence.counters(core);
+      std::string l1 = section + ".core" + std::to_string(core);
+
+      AddCacheStats(l1 + ".l1i", c.instruction_l1_caches[core]);
+      AddCacheStats(l1 + ".l1d", c.data_l1_caches[core]);
+      ac_stats_out_add(l1, "snoops", n.snoops);
+      ac_stats_out_add(l1, "filtered", n.filtered);
+      ac_stats_out_add(l1, "upgrades", n.upgrades);
+      ac_stats_out_add(l1, "invalidations", n.invalidations);
+      ac_stats_out_add(l1, "interventions", n.interventions);
+      ac_stats_out_add(l1, "writebacks", n.writebacks);
+      if (core < g.core_counters.size()) {
+        variables::CycleEstimate e = g.EstimateCoreCycles(core, c);
+
+        ac_stats_out_add(l1, "instructions", g.core_counters[core].instructions);
+        ac_stats_out_add(l1, "pipeline", g.core_configurations[core].pipeline);
+        ac_stats_out_add(l1, "predictor", g.core_configurations[core].predictor);
+        ac_stats_out_add(l1, "cycles", e.total());
+      }
+    }
+  }
+}
+
+static void PrintCounters();
+
+static void PrintAnalysis() {
+  global.DrainAnalysis();
+  global.DrainReferences();
+  if (!global.parallel.child)
+    global.SaveWarmState();
+  // What the write buffers still hold reaches the L2s, except in an
+  // interval measured by a child, and then the round of quanta in
+  // progress below the L1s is settled.
+  for (auto& cache_configuration : global.cache_configurations) {
+    if (cache_configuration.stages && !global.parallel.child)
+      cache_configuration.stages->flush();
+    if (cache_configuration.contention)
+      cache_configuration.contention->settle();
+  }
+  if (variables::kOutOfOrder && global.ooo_next.pending)
+    global.RunOutOfOrder();
+  if (variables::kOutOfOrder && global.ilp_next.pending)
+    global.RunIlp();
+  if (global.parallel.child)
+    global.EndParallelInterval();
+  global.WriteIntervals();
+  global.WriteHotSpots();
+  global.WriteLoops();
+  global.WriteBbv();
+  global.WriteReuse();
+  global.AnalyzeLayout();
+  if (global.convergence.rates.length)
+    global.ReportConvergence();
+  if (global.sampling.enabled)
+    global.Extrapolate();
+  if (global.parallel.length)
+    global.StitchIntervals();
+  if (ac_stats_out_enabled())
+    AddAnalysisStats();
+  PrintCounters();
+}
+
+// Counters of the analysis so far, for a dump on SIGUSR1.
+static void DumpAnalysis(void*) {
+  global.DrainAnalysis();
+  global.DrainReferences();
+  PrintCounters();
+  fflush(stdout);
+}
+
+// Counters written by the snapshots of --stats-interval. The vectors keep
+// their size from InitAnalysis() on.
+static void WatchAnalysis() {
+  const variables& g = global;
+
+  ac_stats_watch("mips", "nops", &g.number_of_nops);
+  ac_stats_watch("mips", "instructions", &g.number_of_instructions);
+  for (unsigned p = 0; variables::kHazards && p < g.pipelines.size(); p++) {
+    std::string section = "mips.pipeline." + std::to_string(g.pipelines[p].depth);
+
+    ac_stats_watch(section, "data_hazards", &g.number_of_data_hazards[p]);
+    ac_stats_watch(section, "control_hazards", &g.number_of_control_hazards[p]);
+    ac_stats_watch(section, "store_forwards", &g.store_forwards[p]);
+    ac_stats_watch(section, "store_stalls", &g.store_stalls[p]);
+    ac_stats_watch(section, "ordering_violations", &g.ordering_violations[p]);
+  }
+  if (variables::kBranches) {
+    ac_stats_watch("mips", "branches", &g.total_number_of_branches);
+    ac_stats_watch("mips", "taken_branches", &g.taken_branches);
+    ac_stats_watch("mips", "btb_misses", &g.btb_misses);
+    for (unsigned q = 0; q < g.predictors.size(); q++)
+      ac_stats_watch("mips.predictor." + g.predictors[q]->name(), "mispredictions", &g.wrong_predictions[q]);
+  }
+  if (g.live.length) {
+    ac_stats_watch("mips.live", "cpi", &g.live.cpi);
+    ac_stats_watch("mips.live", "l1i_miss_rate", &g.live.miss_rates[variables::Live::kL1I]);
+    ac_stats_watch("mips.live", "l1d_miss_rate", &g.live.miss_rates[variables::Live::kL1D]);
+    ac_stats_watch("mips.live", "l2_miss_rate", &g.live.miss_rates[variables::Live::kL2]);
+  }
+  if (!variables::kCaches)
+    return;
+  ac_stats_watch("mips", "memory_accesses", &g.num_memory_acesses);
+  for (unsigned c = 0; c < g.cache_configurations.size(); c++) {
+    const variables::CacheConfiguration& conf = g.cache_configurations[c];
+    std::string section = "mips.cache." + std::to_string(c);
+
+    ac_stats_watch(section + ".l2", "instruction_misses", &conf.l2_cache->miss[D4XINSTRN]);
+    ac_stats_watch(section + ".l2", "read_misses", &conf.l2_cache->miss[D4XREAD]);
+    ac_stats_watch(section + ".l2", "write_misses", &conf.l2_cache->miss[D4XWRITE]);
+    if (g.coherent)
+      continue;
+    ac_stats_watch(section + ".l1i", "instruction_misses", &conf.instruction_l1_cache->miss[D4XINSTRN]);
+    ac_stats_watch(section + ".l1d", "read_misses", &conf.data_l1_cache->miss[D4XREAD]);
+    ac_stats_watch(section + ".l1d", "write_misses", &conf.data_l1_cache->miss[D4XWRITE]);
+  }
+}
 
+// Counters of the analysis, printed at the end and on SIGUSR1.
+static void PrintCounters() {
   printf("\n");
   printf("*******************************************************\n\n");
-  printf("Number of NOPS: %d\n", global.number_of_nops);
-  printf("Number of Instructions: %d\n\n", global.number_of_instructions);
-  printf("Number of data hazards    (5 stages):  %d\n", global.number_of_data_hazards[0]);
-  printf("Number of control hazards (5 stages):  %d\n", global.number_of_control_hazards[0]);
-  printf("Number of data hazards    (7 stages):  %d\n", global.number_of_data_hazards[1]);
-  printf("Number of control hazards (7 stages):  %d\n", global.number_of_control_hazards[1]);
-  printf("Number of data hazards    (13 stages): %d\n", global.number_of_data_hazards[2]);
-  printf("Number of control hazards (13 stages): %d\n\n", global.number_of_control_hazards[2]);
-  printf("Total number of branches:  %d\n\n", global.total_number_of_branches);
-  printf("Wrong branch predictions (static):     %d (%.2f \%)\n", global.static_wrong_predictions, ((float) global.static_wrong_predictions / global.total_number_of_branches) * 100);
-  printf("Wrong branch predictions (saturating): %d (%.2f \%)\n", global.saturating_wrong_predictions, ((float) global.saturating_wrong_predictions / global.total_number_of_branches) * 100);
-  printf("Wrong branch predictions (two level):  %d (%.2f \%)\n\n", global.two_level_wrong_predictions, ((float) global.two_level_wrong_predictions / global.total_number_of_branches) * 100);
-  // Processors
-  // 5 Stages -> MIPS R2000 -> branch misprediction penalty = 1 cycle
-  // 7 Stages -> MIPS R10000 -> branch misprediction penalty = 5 cycles
-  // 13 Stages -> ARM Cortex A8 -> branch misprediction penalty = 13 cycles
-  printf("Number of stall cycles (5 stages + static):      %d\n", global.static_wrong_predictions);
-  printf("Number of stall cycles (5 stages + saturating):  %d\n", global.saturating_wrong_predictions);
-  printf("Number of stall cycles (5 stages + two level):   %d\n", global.two_level_wrong_predictions);
-  printf("Number of stall cycles (7 stages + static):      %d\n", global.static_wrong_predictions * 5);
-  printf("Number of stall cycles (7 stages + saturating):  %d\n", global.saturating_wrong_predictions * 5);
-  printf("Number of stall cycles (7 stages + two level):   %d\n", global.two_level_wrong_predictions * 5);
-  printf("Number of stall cycles (13 stages + static):     %d\n", global.static_wrong_predictions * 13);
-  printf("Number of stall cycles (13 stages + saturating): %d\n", global.saturating_wrong_predictions * 13);
-  printf("Number of stall cycles (13 stages + two level):  %d\n", global.two_level_wrong_predictions * 13);
-  printf("Superscaled instr count: %d\n", global.ss.ssInstCount);
+  printf("Number of NOPS: %llu\n", global.number_of_nops);
+  printf("Number of Instructions: %llu\n\n", global.number_of_instructions);
+  for (unsigned p = 0; variables::kHazards && p < global.pipelines.size(); p++) {
+    std::string stages = "(" + std::to_string(global.pipelines[p].depth) + " stages):";
+    printf("Number of data hazards    %-13s%llu\n", stages.c_str(), global.number_of_data_hazards[p]);
+    printf("Number of control hazards %-13s%llu\n", stages.c_str(), global.number_of_control_hazards[p]);
+    printf("Loads after stores        %-13s%llu forwarded, %llu stalled, %llu ordering violations\n",
+           stages.c_str(), global.store_forwards[p], global.store_stalls[p], global.ordering_violations[p]);
+  }
+  printf("\n");
+  if (variables::kBranches)
+    PrintBranches();
+  if (global.values.enabled())
+    PrintValues();
+  if (variables::kSuperscalar)
+    PrintIssue();
+  if (variables::kOutOfOrder && global.out_of_order)
+    PrintOutOfOrder();
+  if (variables::kOutOfOrder && global.ilp)
+    PrintIlp();
+  if (variables::kHazards || variables::kBranches || variables::kCaches)
+    PrintCycleEstimates();
+  if (global.profile_top)
+    PrintProfile();
+  if (global.hot_spots.enabled())
+    PrintHotSpots();
+  if (global.loops.enabled())
+    PrintLoops();
+  if (global.bbv.enabled())
+    printf("Basic block vectors: %llu intervals of %llu instructions, %u blocks\n", global.bbv.num_intervals(),
+           global.bbv.period(), global.bbv.num_blocks());
   printf("\n*******************************************************\n");
 
   // Cache simulation results.
+  if (!variables::kCaches)
+    return;
   std::cout << "Cache results:\n";
   std::cout << "Number of memory accesses: " << global.num_memory_acesses << "\n";
-  for (int cache_configuration_num = 0; cache_configuration_num != variables::kNumCacheConfigurations; ++cache_configuration_num) {
+  for (int cache_configuration_num = 0; cache_configuration_num != (int) global.cache_configurations.size(); ++cache_configuration_num) {
     std::cout << "Cache configuration #" << cache_configuration_num << ":\n";
     std::cout << "Instruction fetch misses: " << global.cache_configurations[cache_configuration_num].l2_cache->miss[D4XINSTRN] << "\n";
     std::cout << "Data load misses: " << global.cache_configurations[cache_configuration_num].l2_cache->miss[D4XREAD] << "\n";
     std::cout << "Data store misses: " << global.cache_configurations[cache_configuration_num].l2_cache->miss[D4XWRITE] << "\n";
-    int total_misses = global.cache_configurations[cache_configuration_num].l2_cache->miss[D4XINSTRN] + global.cache_configurations[cache_configuration_num].l2_cache->miss[D4XREAD] + global.cache_configurations[cache_configuration_num].l2_cache->miss[D4XWRITE];
-    std::cout << "Stall cyles: " << global.num_memory_acesses * global.cache_configurations[cache_configuration_num].l1_hit_latency + total_misses * global.cache_configurations[cache_configuration_num].miss_penalty << "\n";
+    const variables::CacheConfiguration& c = global.cache_configurations[cache_configuration_num];
+    variables::MemoryTiming timing = variables::GetMemoryTiming(c);
+    printf("L1 instruction misses: %.0f of %.0f\n", c.instruction_l1_cache->miss[D4XINSTRN], c.instruction_l1_cache->fetch[D4XINSTRN]);
+    printf("L1 data misses: %.0f of %.0f\n", c.data_l1_cache->miss[D4XREAD] + c.data_l1_cache->miss[D4XWRITE], c.data_l1_cache->fetch[D4XREAD] + c.data_l1_cache->fetch[D4XWRITE]);
+    std::cout << "Memory cycles: " << (unsigned long long) timing.cycles << "\n";
+    std::cout << "Stall cyles: " << (unsigned long long) timing.stalls << "\n";
+    printf("AMAT: %.3f cycles\n", timing.amat);
+    if (global.cache_energy) {
+      variables::CacheEnergy e = variables::ReportedCacheEnergy(c);
+      double n = global.number_of_instructions;
+
+      printf("Energy: %.0f pJ (L1 %.0f, L2 %.0f, memory %.0f), %.3f pJ per instruction\n", e.total(), e.l1, e.l2,
+             e.memory, n ? e.total() / n : 0);
+    }
+    if (global.classify)
+      PrintClassification(c);
+    if (!global.layout_before.empty())
+      PrintLayout(cache_configuration_num);
+    if (c.stages)
+      PrintStages(c);
+    if (c.dram)
+      PrintDram(*c.dram);
+    if (c.contention)
+      PrintContention(*c.contention);
+    if (global.coherent)
+      PrintCoherence(c);
+  }
+  if (global.sweep) {
+    printf("Single-pass sweep of LRU caches with %u-byte blocks:\n", global.instruction_sweep.block_size());
+    PrintSweep("L1 instruction", global.instruction_sweep);
+    PrintSweep("L1 data", global.data_sweep);
+  }
+  if (global.lanes) {
+    printf("Caches simulated in lanes with %u-byte blocks:\n", global.instruction_lanes.block_size());
+    PrintLanes("L1 instruction", global.instruction_lanes);
+    PrintLanes("L1 data", global.data_lanes);
+  }
+  if (global.tlbs) {
+    printf("TLBs of %u-byte pages, %u cycles and %u page table reads a walk:\n", global.data_tlb.page_size(),
+           global.walk_penalty, global.walk_references);
+    PrintTLB("instruction", global.instruction_tlb);
+    PrintTLB("data", global.data_tlb);
+  }
+  if (global.frontend.enabled())
+    PrintFetch();
+  if (global.reuse) {
+    printf("Reuse distances of %u-byte blocks", global.data_reuse.block_size());
+    if (global.data_reuse.rate() < 1)
+      printf(", %.4f of them sampled", global.data_reuse.rate());
+    printf(":\n");
+    PrintReuse("L1 instruction", global.instruction_reuse);
+    PrintReuse("L1 data", global.data_reuse);
   }
   // End of cache simulation results.
 }
 
+// Kind of the instruction word, as the formats give it to push().
+static unsigned FormatOf(uint32_t word) {
+  unsigned op = word >> 26;
+
+  if (op == 0)
+    return mips_instruction::kR;
+  return (op == 2 || op == 3) ? mips_instruction::kJ : mips_instruction::kI;
+}
+
+// Times the decoder, the memory port in both byte orders (only in that of
+// the model when its parameters fix it), bulk storage operations, d4ref
+// in each cache hierarchy, the power model and push(), on the
+// instructions from pc on (see mips_microbench.H). Returns false if one
+// took longer than its limit in MIPS_MICROBENCH_LIMITS.
+static bool RunMicrobenchmarks(ac_memory& mem, bool& endian, ac_decoder_full* decoder,
+                               unsigned pc) {
+  static const unsigned kWords = 4096;     // instructions decoded and pushed
+  static const unsigned kRefs = 1 << 16;   // references given to each hierarchy
+  static const uint32_t kBlock = 4096;     // bytes of each bulk operation
+  const char* limits = std::getenv("MIPS_MICROBENCH_LIMITS");
+  const char* scale = std::getenv("MIPS_MICROBENCH_SCALE");
+  const uint32_t scratch = AC_RAM_END / 2;  // never reached by the program, which is not run
+  mips_microbench bench;
+  std::vector<ac_word> words(kWords);
+  std::vector<uint8_t> block(kBlock, 0x5A);
+  std::vector<d4memref> refs(kRefs);
+  unsigned fields[AC_DEC_FIELD_NUMBER];
+  bool target_endian = endian;
+
+  if (!bench.open(limits, scale && *scale ? std::atof(scale) : 1)) {
+    std::cerr << "MIPS: Could not read the microbenchmark limits " << limits << ".\n";
+    std::exit(EXIT_FAILURE);
+  }
+  for (unsigned i = 0; i < kWords; i++)
+    words[i] = mem.read(pc + i * 4);
+
+  bench.run("decoder.decode", [&](unsigned long long n) {
+    unsigned long long found = 0;
+    for (unsigned long long i = 0; i < n; i++)
+      found += decoder->Decode(reinterpret_cast<unsigned char*>(&words[i % kWords]), 1, fields) != NULL;
+    return found;
+  });
+
+  // Flipping endian changes nothing once the order is a constant of the build.
+  const int orders = ac_fixed_parms::kMatchEndian == AC_ENDIAN_RUNTIME ? 2 : 1;
+  for (int order = 0; order < orders; order++) {
+    std::string suffix = (order == 0) == target_endian ? ".big" : ".little";
+
+    endian = order == 0 ? target_endian : !target_endian;
+    bench.run("memport.read" + suffix, [&](unsigned long long n) {
+      unsigned long long sum = 0;
+      for (unsigned long long i = 0; i < n; i++)
+        sum += mem.read(scratch + ((i * 4) & 0x3FFF));
+      return sum;
+    });
+    bench.run("memport.read_half" + suffix, [&](unsigned long long n) {
+      unsigned long long sum = 0;
+      for (unsigned long long i = 0; i < n; i++)
+        sum += mem.read_half(scratch + ((i * 2) & 0x3FFF));
+      return sum;
+    });
+    bench.run("memport.read_byte" + suffix, [&](unsigned long long n) {
+      unsigned long long sum = 0;
+      for (unsigned long long i = 0; i < n; i++)
+        sum += mem.read_byte(scratch + (i & 0x3FFF));
+      return sum;
+    });
+    bench.run("memport.write" + suffix, [&](unsigned long long n) {
+      for (unsigned long long i = 0; i < n; i++)
+        mem.write(scratch + ((i * 4) & 0x3FFF), (ac_word) i);
+      return n;
+    });
+    bench.run("memport.write_half" + suffix, [&](unsigned long long n) {
+      for (unsigned long long i = 0; i < n; i++)
+        mem.write_half(scratch + ((i * 2) & 0x3FFF), (ac_Hword) i);
+      return n;
+    });
+    bench.run("memport.write_byte" + suffix, [&](unsigned long long n) {
+      for (unsigned long long i = 0; i < n; i++)
+        mem.write_byte(scratch + (i & 0x3FFF), (uint8_t) i);
+      return n;
+    });
+  }
+  endian = target_endian;
+
+  // Bulk operations, of kBlock bytes each, on a storage of their own and
+  // through the port.
+  ac_storage storage("microbench", 1 << 20);
+  bench.run("storage.write_block", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i++)
+      storage.write_block(&block[0], (i * kBlock) & ((1 << 20) - 1), kBlock);
+    return n;
+  });
+  bench.run("storage.read_block", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i++)
+      storage.read_block(&block[0], (i * kBlock) & ((1 << 20) - 1), kBlock);
+    return (unsigned long long) block[0];
+  });
+  bench.run("storage.clear", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i++)
+      storage.clear((i * kBlock) & ((1 << 20) - 1), kBlock);
+    return n;
+  });
+  bench.run("memport.write_block", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i++)
+      mem.write_block(scratch + ((i * kBlock) & 0xFFFF), &block[0], kBlock);
+    return n;
+  });
+  bench.run("memport.read_block", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i++)
+      mem.read_block(scratch + ((i * kBlock) & 0xFFFF), &block[0], kBlock);
+    return (unsigned long long) block[0];
+  });
+
+  // Three loads for each store, half of them to a sequential stream and
+  // the others over 1 MB.
+  uint32_t random = 12345;
+  for (unsigned i = 0; i < kRefs; i++) {
+    random = random * 1103515245 + 12345;
+    refs[i].address = (i & 1) ? scratch + ((i * 2) & 0xFFFF) : scratch + ((random >> 8) & 0xFFFFC);
+    refs[i].accesstype = (random >> 30) == 0 ? D4XWRITE : D4XREAD;
+    refs[i].size = 4;
+  }
+  for (unsigned c = 0; c < global.cache_configurations.size(); c++) {
+    d4cache* l1 = global.cache_configurations[c].data_l1_cache;
+
+    bench.run("d4ref." + std::to_string(c), [&](unsigned long long n) {
+      for (unsigned long long i = 0; i < n; i++)
+        d4ref(l1, refs[i % kRefs]);
+      return n;
+    });
+  }
+
+#ifdef POWER_SIM
+  // Without windows, only the counting is timed.
+  setenv("AC_POWER_WINDOW", "0", 1);
+  power_stats power("microbench", mips_isa::instr_table, AC_DEC_INSTR_NUMBER);
+  bench.run("power_stats.update_stat_power", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i++)
+      power.update_stat_power(1 + i % AC_DEC_INSTR_NUMBER);
+    return n;
+  });
+#endif
+
+  bench.run("analysis.push", [&](unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i++) {
+      uint32_t word = words[i % kWords];
+      global.push(UnpackInstruction(FormatOf(word), word));
+    }
+    return global.number_of_nops;
+  });
+  return bench.passed();
+}
+
+//!Behavior called before starting simulation
+void ac_behavior(begin) {
+  dbg_printf("@@@ begin behavior @@@\n");
+  RB[0] = 0;
+  npc = ac_pc + 4;
+
+  // It is not required by the architecture, but makes debug really easier
+  for (int regNum = 0; regNum < 32; regNum++)
+    RB[regNum] = 0;
+  hi = 0;
+  lo = 0;
+  lladdr = 0;
+
+  if (!processors_started) {
+    const char* replay = std::getenv("MIPS_REPLAY");
+
+    global.InitAnalysis();
+    WatchAnalysis();
+    ac_stats_dump_add(DumpAnalysis, NULL);
+    // The program is loaded to be decoded, not simulated.
+    if (variables::GetEnvCount("MIPS_MICROBENCH", 0)) {
+      bool ok = RunMicrobenchmarks(DM, ac_mt_endian, decoder, ac_pc);
+      global.CloseTrace();
+      std::exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    // The program is not simulated, only loaded.
+    if (replay && *replay) {
+      bool ok = global.Replay(replay);
+      global.CloseTrace();
+      PrintAnalysis();
+      std::exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+  }
+  global.AddCore(this);
+  RB[29] = AC_RAM_END - 1024 - processors_started++ * DEFAULT_STACK_SIZE;
+}
+
+//!Behavior called after finishing simulation
+void ac_behavior(end) {
+  dbg_printf("@@@ end behavior @@@\n");
+
+  global.DrainAnalysis();
+  global.CloseTrace();
+  PrintAnalysis();
+}
+
 //!Instruction lb behavior method.
 void ac_behavior(lb) {
   char byte;
@@ -791,7 +6218,7 @@ void ac_behavior(lb) {
 
   dbg_printf("Result = %#x\n", RB[rt]);
   // Cache simulation.
-  global.SimulateLoadDataFromCaches(address);
+  global.SimulateLoadDataFromCaches(address, 1, RB[rt]);
   // End of cache simulation.
 };
 
@@ -808,7 +6235,7 @@ void ac_behavior(lbu) {
   RB[rt] = byte;
   dbg_printf("Result = %#x\n", RB[rt]);
   // Cache simulation.
-  global.SimulateLoadDataFromCaches(address);
+  global.SimulateLoadDataFromCaches(address, 1, RB[rt]);
   // End of cache simulation.
 };
 
@@ -825,7 +6252,7 @@ void ac_behavior(lh) {
   RB[rt] = (ac_Sword)half;
   dbg_printf("Result = %#x\n", RB[rt]);
   // Cache simulation.
-  global.SimulateLoadDataFromCaches(address);
+  global.SimulateLoadDataFromCaches(address, 2, RB[rt]);
   // End of cache simulation.
 };
 
@@ -842,17 +6269,19 @@ void ac_behavior(lhu) {
   RB[rt] = half;
   dbg_printf("Result = %#x\n", RB[rt]);
   // Cache simulation.
-  global.SimulateLoadDataFromCaches(address);
+  global.SimulateLoadDataFromCaches(address, 2, RB[rt]);
   // End of cache simulation.
 };
 
 //!Instruction lw behavior method.
 void ac_behavior(lw) {
   dbg_printf("lw r%d, %d(r%d)\n", rt, imm & 0xFFFF, rs);
-  RB[rt] = DM.read(RB[rs] + imm);
+  unsigned address = RB[rs] + imm;
+
+  RB[rt] = DM.read(address);
   dbg_printf("Result = %#x\n", RB[rt]);
   // Cache simulation.
-  global.SimulateLoadDataFromCaches(RB[rs] + imm);
+  global.SimulateLoadDataFromCaches(address, 4, RB[rt]);
   // End of cache simulation.
 };
 
@@ -870,7 +6299,7 @@ void ac_behavior(lwl) {
   RB[rt] = data;
   dbg_printf("Result = %#x\n", RB[rt]);
   // Cache simulation.
-  global.SimulateLoadDataFromCaches(addr);
+  global.SimulateLoadDataFromCaches(addr, 4, RB[rt]);
   // End of cache simulation.
 };
 
@@ -888,7 +6317,7 @@ void ac_behavior(lwr) {
   RB[rt] = data;
   dbg_printf("Result = %#x\n", RB[rt]);
   // Cache simulation.
-  global.SimulateLoadDataFromCaches(addr);
+  global.SimulateLoadDataFromCaches(addr, 4, RB[rt]);
   // End of cache simulation.
 };
 
@@ -908,7 +6337,7 @@ void ac_behavior(sb) {
 
   dbg_printf("Result = %#x\n", (int)byte);
   // Cache simulation.
-  global.SimulateStoreDataInCaches(address);
+  global.SimulateStoreDataInCaches(address, 1);
   // End of cache simulation.
 };
 
@@ -928,7 +6357,7 @@ void ac_behavior(sh) {
 
   dbg_printf("Result = %#x\n", (int)half);
   // Cache simulation.
-  global.SimulateStoreDataInCaches(address);
+  global.SimulateStoreDataInCaches(address, 2);
   // End of cache simulation.
 };
 
@@ -978,6 +6407,40 @@ void ac_behavior(swr) {
   // End of cache simulation.
 };
 
+// The link of ll is the address, with its lowest bit set, and the word
+// loaded. sc stores only if the word still holds it, as one atomic step
+// for the other cores, so a store of the same value in between goes
+// unnoticed.
+
+//!Instruction ll behavior method.
+void ac_behavior(ll) {
+  dbg_printf("ll r%d, %d(r%d)\n", rt, imm & 0xFFFF, rs);
+  unsigned address = RB[rs] + imm;
+
+  RB[rt] = DM.read(address);
+  lladdr = address | 1;
+  llval = RB[rt];
+  dbg_printf("Result = %#x\n", RB[rt]);
+  // Cache simulation.
+  global.SimulateLoadDataFromCaches(address, 4, RB[rt]);
+  // End of cache simulation.
+};
+
+//!Instruction sc behavior method.
+void ac_behavior(sc) {
+  dbg_printf("sc r%d, %d(r%d)\n", rt, imm & 0xFFFF, rs);
+  unsigned address = RB[rs] + imm;
+  bool stored = lladdr.read() == (address | 1) && DM.compare_and_swap(address, llval.read(), RB[rt]);
+
+  lladdr = 0;
+  RB[rt] = stored;
+  dbg_printf("Result = %d\n", stored);
+  // Cache simulation. A failed sc writes nothing.
+  if (stored)
+    global.SimulateStoreDataInCaches(address);
+  // End of cache simulation.
+};
+
 //!Instruction addi behavior method.
 void ac_behavior(addi) {
   dbg_printf("addi r%d, r%d, %d\n", rt, rs, imm & 0xFFFF);
@@ -1428,6 +6891,11 @@ void ac_behavior(bgezal) {
 //!Instruction sys_call behavior method.
 void ac_behavior(sys_call) {
   dbg_printf("syscall\n");
+  // Region of interest markers, the analysis goes on or off at the next instruction.
+  if (RB[2] == variables::kRoiBegin || RB[2] == variables::kRoiEnd) {
+    global.SetRegionOfInterest(RB[2] == variables::kRoiBegin);
+    return;
+  }
   stop();
 }
 
@@ -20,65 +20,66 @@ AC_CONF_INSTR_STAT_LIST(mips, COUNT);
 
 mips_all_stats::mips_all_stats() :
   stats("mips")
-  , lb_istats("lb", stats)
-  , lbu_istats("lbu", stats)
-  , lh_istats("lh", stats)
-  , lhu_istats("lhu", stats)
-  , lw_istats("lw", stats)
-  , lwl_istats("lwl", stats)
-  , lwr_istats("lwr", stats)
-  , sb_istats("sb", stats)
-  , sh_istats("sh", stats)
-  , sw_istats("sw", stats)
-  , swl_istats("swl", stats)
-  , swr_istats("swr", stats)
-  , addi_istats("addi", stats)
-  , addiu_istats("addiu", stats)
-  , slti_istats("slti", stats)
-  , sltiu_istats("sltiu", stats)
-  , andi_istats("andi", stats)
-  , ori_istats("ori", stats)
-  , xori_istats("xori", stats)
-  , lui_istats("lui", stats)
-  , add_istats("add", stats)
-  , addu_istats("addu", stats)
-  , sub_istats("sub", stats)
-  , subu_istats("subu", stats)
-  , slt_istats("slt", stats)
-  , sltu_istats("sltu", stats)
-  , instr_and_istats("instr_and", stats)
-  , instr_or_istats("instr_or", stats)
-  , instr_xor_istats("instr_xor", stats)
-  , instr_nor_istats("instr_nor", stats)
-  , nop_istats("nop", stats)
-  , sll_istats("sll", stats)
-  , srl_istats("srl", stats)
-  , sra_istats("sra", stats)
-  , sllv_istats("sllv", stats)
-  , srlv_istats("srlv", stats)
-  , srav_istats("srav", stats)
-  , mult_istats("mult", stats)
-  , multu_istats("multu", stats)
-  , div_istats("div", stats)
-  , divu_istats("divu", stats)
-  , mfhi_istats("mfhi", stats)
-  , mthi_istats("mthi", stats)
-  , mflo_istats("mflo", stats)
-  , mtlo_istats("mtlo", stats)
-  , j_istats("j", stats)
-  , jal_istats("jal", stats)
-  , jr_istats("jr", stats)
-  , jalr_istats("jalr", stats)
-  , beq_istats("beq", stats)
-  , bne_istats("bne", stats)
-  , blez_istats("blez", stats)
-  , bgtz_istats("bgtz", stats)
-  , bltz_istats("bltz", stats)
-  , bgez_istats("bgez", stats)
-  , bltzal_istats("bltzal", stats)
-  , bgezal_istats("bgezal", stats)
-  , sys_call_istats("sys_call", stats)
-  , instr_break_istats("instr_break", stats)
+  , instr_counts()
+  , lb_istats("lb", stats, instr_counts[1])
+  , lbu_istats("lbu", stats, instr_counts[2])
+  , lh_istats("lh", stats, instr_counts[3])
+  , lhu_istats("lhu", stats, instr_counts[4])
+  , lw_istats("lw", stats, instr_counts[5])
+  , lwl_istats("lwl", stats, instr_counts[6])
+  , lwr_istats("lwr", stats, instr_counts[7])
+  , sb_istats("sb", stats, instr_counts[8])
+  , sh_istats("sh", stats, instr_counts[9])
+  , sw_istats("sw", stats, instr_counts[10])
+  , swl_istats("swl", stats, instr_counts[11])
+  , swr_istats("swr", stats, instr_counts[12])
+  , addi_istats("addi", stats, instr_counts[13])
+  , addiu_istats("addiu", stats, instr_counts[14])
+  , slti_istats("slti", stats, instr_counts[15])
+  , sltiu_istats("sltiu", stats, instr_counts[16])
+  , andi_istats("andi", stats, instr_counts[17])
+  , ori_istats("ori", stats, instr_counts[18])
+  , xori_istats("xori", stats, instr_counts[19])
+  , lui_istats("lui", stats, instr_counts[20])
+  , add_istats("add", stats, instr_counts[21])
+  , addu_istats("addu", stats, instr_counts[22])
+  , sub_istats("sub", stats, instr_counts[23])
+  , subu_istats("subu", stats, instr_counts[24])
+  , slt_istats("slt", stats, instr_counts[25])
+  , sltu_istats("sltu", stats, instr_counts[26])
+  , instr_and_istats("instr_and", stats, instr_counts[27])
+  , instr_or_istats("instr_or", stats, instr_counts[28])
+  , instr_xor_istats("instr_xor", stats, instr_counts[29])
+  , instr_nor_istats("instr_nor", stats, instr_counts[30])
+  , nop_istats("nop", stats, instr_counts[31])
+  , sll_istats("sll", stats, instr_counts[32])
+  , srl_istats("srl", stats, instr_counts[33])
+  , sra_istats("sra", stats, instr_counts[34])
+  , sllv_istats("sllv", stats, instr_counts[35])
+  , srlv_istats("srlv", stats, instr_counts[36])
+  , srav_istats("srav", stats, instr_counts[37])
+  , mult_istats("mult", stats, instr_counts[38])
+  , multu_istats("multu", stats, instr_counts[39])
+  , div_istats("div", stats, instr_counts[40])
+  , divu_istats("divu", stats, instr_counts[41])
+  , mfhi_istats("mfhi", stats, instr_counts[42])
+  , mthi_istats("mthi", stats, instr_counts[43])
+  , mflo_istats("mflo", stats, instr_counts[44])
+  , mtlo_istats("mtlo", stats, instr_counts[45])
+  , j_istats("j", stats, instr_counts[46])
+  , jal_istats("jal", stats, instr_counts[47])
+  , jr_istats("jr", stats, instr_counts[48])
+  , jalr_istats("jalr", stats, instr_counts[49])
+  , beq_istats("beq", stats, instr_counts[50])
+  , bne_istats("bne", stats, instr_counts[51])
+  , blez_istats("blez", stats, instr_counts[52])
+  , bgtz_istats("bgtz", stats, instr_counts[53])
+  , bltz_istats("bltz", stats, instr_counts[54])
+  , bgez_istats("bgez", stats, instr_counts[55])
+  , bltzal_istats("bltzal", stats, instr_counts[56])
+  , bgezal_istats("bgezal", stats, instr_counts[57])
+  , sys_call_istats("sys_call", stats, instr_counts[58])
+  , instr_break_istats("instr_break", stats, instr_counts[59])
 {
     //!Configuring stats collectors for each instruction
     instr_stats[1] = &lb_istats;
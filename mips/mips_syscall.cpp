@@ -42,20 +42,22 @@ unsigned procNumber = 0;
 
 void mips_syscall::get_buffer(int argn, unsigned char* buf, unsigned int size)
 {
-  unsigned int addr = RB[4+argn];
-
-  for (unsigned int i = 0; i<size; i++, addr++) {
-    buf[i] = DM.read_byte(addr);
-  }
+  DM.read_block(RB[4+argn], buf, size);
 }
 
 void mips_syscall::set_buffer(int argn, unsigned char* buf, unsigned int size)
 {
-  unsigned int addr = RB[4+argn];
+  DM.write_block(RB[4+argn], buf, size);
+}
 
-  for (unsigned int i = 0; i<size; i++, addr++) {
-    DM.write_byte(addr, buf[i]);
-  }
+unsigned char* mips_syscall::get_host_buffer(int argn, unsigned int size)
+{
+  return DM.block_in_place(RB[4+argn], size);
+}
+
+void mips_syscall::buffer_accessed(int argn, unsigned int size, bool written)
+{
+  DM.block_accessed(RB[4+argn], size, written);
 }
 
 void mips_syscall::set_buffer_noinvert(int argn, unsigned char* buf, unsigned int size)
@@ -67,8 +69,12 @@ void mips_syscall::set_buffer_noinvert(int argn, unsigned char* buf, unsigned in
   }
 }
 
+//Arguments past the fourth are on the stack, after the space the caller
+//leaves for the first four
 int mips_syscall::get_int(int argn)
 {
+  if (argn >= 4)
+    return DM.read(RB[29] + 4*argn);
   return RB[4+argn];
 }
 
@@ -83,6 +89,33 @@ void mips_syscall::return_from_syscall()
   npc = ac_pc + 4;
 }
 
+//The general registers, then hi and lo
+void mips_syscall::get_thread_regs(std::vector<unsigned>& regs)
+{
+  regs.resize(34);
+  for (int i = 0; i < 32; i++)
+    regs[i] = RB[i];
+  regs[32] = hi;
+  regs[33] = lo;
+}
+
+//A new thread has the registers of its creator, but for its stack, its
+//arguments and no link of ll
+void mips_syscall::start_thread(const ac_threads::start& s)
+{
+  for (int i = 0; i < 32; i++)
+    RB[i] = s.regs[i];
+  hi = s.regs[32];
+  lo = s.regs[33];
+  RB[29] = s.stack;
+  RB[4] = s.args[0];
+  RB[5] = s.args[1];
+  RB[6] = s.args[2];
+  lladdr = 0;
+  ac_pc = s.pc;
+  npc = ac_pc + 4;
+}
+
 void mips_syscall::set_prog_args(int argc, char **argv)
 {
   int i, j, base;
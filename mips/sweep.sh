@@ -0,0 +1,314 @@
+#!/bin/bash
+# Sweep of MiBench workloads over simulator configurations
+#
+#   sweep.sh [-j jobs] [-n nodes] [-a] [-o dir] SIMULATOR SPEC
+#
+# Each workload of SPEC is run under every combination of the
+# configurations it lists, on a pool of jobs processes (one per host core
+# by default), or on the slots of the nodes file through ssh. The
+# results written with --stats-out are kept in dir (sweep.out) and merged,
+# in the order of SPEC, into dir/results.json. A point already run with
+# the same simulator, programs and configuration is not run again, so an
+# interrupted or extended sweep only runs what is missing.
+#
+# SPEC holds one line per item; # starts a comment:
+#
+#   mibench    DIR                  MiBench root (default: ../MipsMibench)
+#   workload   RUNME...             runme_*.sh scripts, relative to DIR; globs
+#                                   are expanded (automotive/*/runme_small.sh)
+#   caches     NAME FILE            value of MIPS_CACHES
+#   predictors NAME FILE            value of MIPS_PREDICTORS
+#   pipelines  NAME FILE            value of MIPS_PIPELINES
+#   power      NAME TABLE           value of AC_POWER_TABLE
+#   env        NAME VAR=value...    any other variables
+#
+# The names of each kind are one dimension of the sweep; a kind with no
+# line keeps the defaults of the simulator. The nodes file has one host
+# and its number of slots (default 1) a line; the nodes must see this
+# directory, the simulator and MiBench at the same paths. -a pins each
+# run to the CPU of its slot with taskset.
+
+CPUS=`nproc 2>/dev/null || echo 1`
+JOBS=$CPUS
+NODES=
+AFFINITY=
+OUT=sweep.out
+USAGE="usage: $0 [-j jobs] [-n nodes] [-a] [-o dir] simulator spec"
+
+while getopts "j:n:ao:" opt; do
+  case $opt in
+    j) JOBS=$OPTARG ;;
+    n) NODES=$OPTARG ;;
+    a) AFFINITY=1 ;;
+    o) OUT=$OPTARG ;;
+    *) echo "$USAGE" >&2; exit 2 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -ne 2 ]; then
+  echo "$USAGE" >&2
+  exit 2
+fi
+
+SIM=`cd \`dirname $1\` && pwd`/`basename $1`
+SPEC=$2
+mkdir -p $OUT/cache $OUT/runs || exit 1
+OUT=`cd $OUT && pwd`
+SPECDIR=`cd \`dirname $SPEC\` && pwd`
+MIBENCH=`cd \`dirname $0\` && pwd`/../MipsMibench
+
+hash() {
+  sha1sum | cut -c1-16
+}
+
+# Reading the specification
+
+declare -a WORKLOADS KINDS
+declare -A NAMES SETTINGS
+
+while read kind rest; do
+  case $kind in
+    ''|\#*) continue ;;
+    mibench)
+      MIBENCH=`cd $SPECDIR && cd $rest && pwd` || exit 1 ;;
+    workload)
+      for w in $rest; do
+        WORKLOADS+=("$w")
+      done ;;
+    caches|predictors|pipelines|power|env)
+      set -- $rest
+      if [ $# -lt 2 ]; then
+        echo "$SPEC: $kind needs a name and a value" >&2
+        exit 1
+      fi
+      name=$1
+      shift
+      [ -n "${NAMES[$kind]}" ] || KINDS+=($kind)
+      NAMES[$kind]="${NAMES[$kind]} $name"
+      case $kind in
+        caches) SETTINGS[$kind.$name]="MIPS_CACHES=`cd $SPECDIR && readlink -f $1`" ;;
+        predictors) SETTINGS[$kind.$name]="MIPS_PREDICTORS=`cd $SPECDIR && readlink -f $1`" ;;
+        pipelines) SETTINGS[$kind.$name]="MIPS_PIPELINES=`cd $SPECDIR && readlink -f $1`" ;;
+        power) SETTINGS[$kind.$name]="AC_POWER_TABLE=`cd $SPECDIR && readlink -f $1`" ;;
+        env) SETTINGS[$kind.$name]="$*" ;;
+      esac ;;
+    *)
+      echo "$SPEC: $kind is not mibench, workload, caches, predictors, pipelines, power or env" >&2
+      exit 1 ;;
+  esac
+done < $SPEC
+
+# The runme scripts, with the globs expanded
+declare -a RUNMES
+for w in "${WORKLOADS[@]}"; do
+  for r in $MIBENCH/$w; do
+    if [ ! -f $r ]; then
+      echo "$SPEC: no workload $w in $MIBENCH" >&2
+      exit 1
+    fi
+    RUNMES+=(${r#$MIBENCH/})
+  done
+done
+if [ ${#RUNMES[@]} -eq 0 ]; then
+  echo "$SPEC: no workload" >&2
+  exit 1
+fi
+
+# Every combination of one name of each kind, as kind.name words
+CONFIGS=("")
+for kind in "${KINDS[@]}"; do
+  next=()
+  for c in "${CONFIGS[@]}"; do
+    for name in ${NAMES[$kind]}; do
+      next+=("$c $kind.$name")
+    done
+  done
+  CONFIGS=("${next[@]}")
+done
+
+# Name of a workload: its directory and size, as qsort.small
+workload_name() {
+  local r=$1 size=${1##*runme_}
+
+  r=${r%/*}
+  echo ${r##*/}.${size%.sh}
+}
+
+config_name() {
+  local name= c
+
+  for c in $1; do
+    name=$name+${c#*.}
+  done
+  name=${name#+}
+  echo ${name:-default}
+}
+
+# Variables of a configuration
+config_env() {
+  local c
+
+  for c in $1; do
+    echo ${SETTINGS[$c]}
+  done
+}
+
+# Key of a point: the simulator, the runme script and the programs it
+# runs, and the variables and files of the configuration.
+SIM_HASH=`hash < $SIM`
+point_key() {
+  local runme=$1 config=$2 dir=$MIBENCH/${1%/*} prog v
+
+  {
+    echo $SIM_HASH
+    cat $MIBENCH/$runme
+    for prog in `sed -n 's/^\${SIMULATOR}\([^ ]*\).*/\1/p' $MIBENCH/$runme | sort -u`; do
+      hash < $dir/$prog
+    done
+    for v in `config_env "$config"`; do
+      echo $v
+      [ -f "${v#*=}" ] && hash < ${v#*=}
+    done
+  } | hash
+}
+
+# Writes the script of a point, run in a scratch directory holding links
+# to the files of the workload directory but its outputs, so the shipped
+# output_* files are not written and points run side by side.
+write_point() {
+  local runme=$1 config=$2 key=$3 cpu=$4 dir=$MIBENCH/${1%/*} run=$OUT/runs/$3 v f pin=
+
+  rm -rf $run
+  mkdir -p $run
+  for f in $dir/*; do
+    case ${f##*/} in
+      output_*) ;;
+      *) ln -s $f $run/ ;;
+    esac
+  done
+  [ -n "$AFFINITY" ] && pin="taskset -c $cpu "
+  {
+    echo "cd $run"
+    for v in `config_env "$config"`; do
+      echo "export $v"
+    done
+    echo "START=\`date +%s%N\`"
+    awk -v sim="$pin$SIM" -v run=$run '
+      /^\$\{SIMULATOR\}/ {
+        n++
+        sub(/^\$\{SIMULATOR\}/, sim " --stats-out=" run "/" n ".json --load=")
+        print $0 " 2> " run "/" n ".err || exit " n
+      }' $MIBENCH/$runme
+    echo "END=\`date +%s%N\`"
+    echo "echo \$(((END - START) / 1000000)) > $run/milliseconds"
+  } > $run/run.sh
+}
+
+# Merges the results of a finished point into its cache entry.
+finish_point() {
+  local runme=$1 config=$2 key=$3 host=$4 run=$OUT/runs/$3 n=1 sep=
+
+  {
+    printf '{ "workload": "%s", "config": "%s", "key": "%s", "host": "%s", "milliseconds": %s,\n  "commands": [' \
+      `workload_name $runme` `config_name "$config"` $key $host `cat $run/milliseconds`
+    while [ -f $run/$n.json ]; do
+      printf '%s\n' "$sep"
+      cat $run/$n.json
+      sep=,
+      n=$((n + 1))
+    done
+    printf '] }\n'
+  } > $OUT/cache/$key.json.tmp && mv $OUT/cache/$key.json.tmp $OUT/cache/$key.json
+  rm -rf $run
+}
+
+run_point() {
+  local runme=$1 config=$2 key=$3 host=$4 cpu=$5 status
+
+  write_point "$runme" "$config" $key $cpu
+  if [ $host = localhost ]; then
+    sh $OUT/runs/$key/run.sh
+  else
+    ssh -n $host sh $OUT/runs/$key/run.sh
+  fi
+  status=$?
+  if [ $status -ne 0 ]; then
+    echo "`workload_name $runme` `config_name "$config"`: command $status failed, see $OUT/runs/$key" >&2
+    return 1
+  fi
+  finish_point "$runme" "$config" $key $host
+  echo "`workload_name $runme` `config_name "$config"`: done on $host" >&2
+}
+
+# The slots of the pool: a host and a CPU each
+
+declare -a SLOT_HOST SLOT_CPU PIDS
+if [ -n "$NODES" ]; then
+  while read host slots; do
+    case $host in
+      ''|\#*) continue ;;
+    esac
+    for ((i = 0; i < ${slots:-1}; i++)); do
+      SLOT_HOST+=($host)
+      SLOT_CPU+=($i)
+    done
+  done < $NODES
+else
+  for ((i = 0; i < JOBS; i++)); do
+    SLOT_HOST+=(localhost)
+    SLOT_CPU+=($((i % CPUS)))
+  done
+fi
+if [ ${#SLOT_HOST[@]} -eq 0 ]; then
+  echo "No slot to run on" >&2
+  exit 1
+fi
+
+free_slot() {
+  local i
+
+  for ((i = 0; i < ${#SLOT_HOST[@]}; i++)); do
+    if [ -z "${PIDS[$i]}" ] || ! kill -0 ${PIDS[$i]} 2>/dev/null; then
+      echo $i
+      return
+    fi
+  done
+}
+
+declare -a KEYS
+FAILED=0
+for runme in "${RUNMES[@]}"; do
+  for config in "${CONFIGS[@]}"; do
+    key=`point_key $runme "$config"`
+    KEYS+=($key)
+    [ -f $OUT/cache/$key.json ] && continue
+    slot=`free_slot`
+    while [ -z "$slot" ]; do
+      wait -n
+      slot=`free_slot`
+    done
+    run_point $runme "$config" $key ${SLOT_HOST[$slot]} ${SLOT_CPU[$slot]} &
+    PIDS[$slot]=$!
+  done
+done
+wait
+
+# Results of every point, in the order of the specification
+{
+  printf '{ "simulator": "%s",\n"points": [' $SIM
+  sep=
+  for key in "${KEYS[@]}"; do
+    if [ -f $OUT/cache/$key.json ]; then
+      printf '%s\n' "$sep"
+      cat $OUT/cache/$key.json
+      sep=,
+    else
+      FAILED=1
+    fi
+  done
+  printf '] }\n'
+} > $OUT/results.json
+
+echo "Results of ${#KEYS[@]} points written to $OUT/results.json" >&2
+exit $FAILED
@@ -0,0 +1,334 @@
+#!/bin/bash
+# Design-space exploration over the configurations of a sweep
+#
+#   tune.sh [-j jobs] [-n nodes] [-a] [-o dir] SIMULATOR SPEC
+#
+# SPEC is a sweep.sh specification whose configurations are searched for
+# the one that minimizes an objective, with these items more:
+#
+#   objective  EXPR                 what to minimize (default cpi)
+#   pareto     EXPR                 a second objective whose frontier with
+#                                   the first is never pruned
+#   limit      STAT VALUE           drops the points whose STAT is above
+#                                   VALUE in any of their runs
+#   round      NAME VAR=value...    a round of successive halving, run with
+#                                   these variables more (a sampled run)
+#   keep       N                    points left for the full runs (default 1)
+#
+# EXPR is cpi, energy, edp, area, or sums of --stats-out statistics named
+# SECTION.NAME, over another sum or not: ipc over its runs is
+# mips.ooo.instructions/mips.ooo.cycles. A * in a section matches the first
+# one of the run that fits. A sum over another is summed over the runs of
+# the workloads first; a sum alone is averaged over them. cpi is
+# mips.cycles.*.total/mips.instructions, energy power.energy_joules, edp
+# power.energy_delay_product and area the bytes of the caches of
+# hierarchy 0.
+#
+# Each round runs the points left under its variables and keeps the
+# better half by the objective, at least keep of them, with those on the
+# Pareto frontier of the two objectives. The points left then run with
+# no variable more. The runs go through sweep.sh into dir (sweep.out), so
+# the points it already ran, in a sweep or an earlier search, are not run
+# again. The ranking of each round is written to dir/tune.txt, and the
+# best point to the standard error.
+
+SWEEP=`cd \`dirname $0\` && pwd`/sweep.sh
+FLAGS=
+OUT=sweep.out
+USAGE="usage: $0 [-j jobs] [-n nodes] [-a] [-o dir] simulator spec"
+
+while getopts "j:n:ao:" opt; do
+  case $opt in
+    j|n) FLAGS="$FLAGS -$opt $OPTARG" ;;
+    a) FLAGS="$FLAGS -a" ;;
+    o) OUT=$OPTARG ;;
+    *) echo "$USAGE" >&2; exit 2 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -ne 2 ]; then
+  echo "$USAGE" >&2
+  exit 2
+fi
+
+SIM=$1
+SPEC=$2
+mkdir -p $OUT/tune || exit 1
+OUT=`cd $OUT && pwd`
+SPECDIR=`cd \`dirname $SPEC\` && pwd`
+MIBENCH=`cd \`dirname $0\` && pwd`/../MipsMibench
+
+# Reading the specification: the configurations as sweep.sh makes them
+
+declare -a WORKLOADS KINDS ROUNDS
+declare -A NAMES SETTINGS
+OBJECTIVE=cpi
+PARETO=
+LIMITS=
+KEEP=1
+
+while read kind rest; do
+  case $kind in
+    ''|\#*) continue ;;
+    mibench)
+      MIBENCH=`cd $SPECDIR && cd $rest && pwd` || exit 1 ;;
+    workload)
+      WORKLOADS+=("$rest") ;;
+    objective) OBJECTIVE=$rest ;;
+    pareto) PARETO=$rest ;;
+    limit)
+      set -- $rest
+      if [ $# -ne 2 ]; then
+        echo "$SPEC: limit needs a statistic and a value" >&2
+        exit 1
+      fi
+      LIMITS="$LIMITS;$1 $2" ;;
+    keep)
+      KEEP=$rest
+      if ! [ "$KEEP" -ge 1 ] 2>/dev/null; then
+        echo "$SPEC: keep needs a number of points" >&2
+        exit 1
+      fi ;;
+    round)
+      ROUNDS+=("$rest") ;;
+    caches|predictors|pipelines|power|env)
+      set -- $rest
+      if [ $# -lt 2 ]; then
+        echo "$SPEC: $kind needs a name and a value" >&2
+        exit 1
+      fi
+      name=$1
+      shift
+      [ -n "${NAMES[$kind]}" ] || KINDS+=($kind)
+      NAMES[$kind]="${NAMES[$kind]} $name"
+      case $kind in
+        caches) SETTINGS[$kind.$name]="MIPS_CACHES=`cd $SPECDIR && readlink -f $1`" ;;
+        predictors) SETTINGS[$kind.$name]="MIPS_PREDICTORS=`cd $SPECDIR && readlink -f $1`" ;;
+        pipelines) SETTINGS[$kind.$name]="MIPS_PIPELINES=`cd $SPECDIR && readlink -f $1`" ;;
+        power) SETTINGS[$kind.$name]="AC_POWER_TABLE=`cd $SPECDIR && readlink -f $1`" ;;
+        env) SETTINGS[$kind.$name]="$*" ;;
+      esac ;;
+    *)
+      echo "$SPEC: $kind is not mibench, workload, caches, predictors, pipelines, power, env," \
+           "objective, pareto, limit, keep or round" >&2
+      exit 1 ;;
+  esac
+done < $SPEC
+
+# Every combination of one name of each kind, as a name and its variables
+declare -a POINTS
+declare -A POINT_ENV
+CONFIGS=("")
+for kind in "${KINDS[@]}"; do
+  next=()
+  for c in "${CONFIGS[@]}"; do
+    for name in ${NAMES[$kind]}; do
+      next+=("$c $kind.$name")
+    done
+  done
+  CONFIGS=("${next[@]}")
+done
+for config in "${CONFIGS[@]}"; do
+  name=
+  vars=
+  for c in $config; do
+    name=$name+${c#*.}
+    vars="$vars ${SETTINGS[$c]}"
+  done
+  name=${name#+}
+  name=${name:-default}
+  POINTS+=($name)
+  POINT_ENV[$name]=$vars
+done
+
+expand() {
+  case $1 in
+    cpi) echo "mips.cycles.*.total/mips.instructions" ;;
+    energy) echo "power.energy_joules" ;;
+    edp) echo "power.energy_delay_product" ;;
+    area) echo "mips.cache.0.l1i.bytes+mips.cache.0.l1d.bytes+mips.cache.0.l2.bytes" ;;
+    *) echo "$1" ;;
+  esac
+}
+OBJECTIVE=`expand "$OBJECTIVE"`
+[ -n "$PARETO" ] && PARETO=`expand "$PARETO"`
+
+# Runs the points left under the variables of a round through sweep.sh.
+run_round() {
+  local spec=$OUT/tune/$1.spec vars=$2 p w
+
+  {
+    echo "mibench $MIBENCH"
+    for w in "${WORKLOADS[@]}"; do
+      echo "workload $w"
+    done
+    for p in "${LEFT[@]}"; do
+      echo "env $p ${POINT_ENV[$p]} $vars"
+    done
+  } > $spec
+  bash $SWEEP $FLAGS -o $OUT $SIM $spec
+  cp $OUT/results.json $OUT/tune/$1.json
+}
+
+# Scores the points of results.json: one line with the name, the
+# objective and the second one of each point that kept within the
+# limits and has every statistic, best first.
+score() {
+  awk -v objective="$OBJECTIVE" -v pareto="$PARETO" -v limits="$LIMITS" '
+    function regex(stat) {
+      gsub(/\./, "\\.", stat)
+      gsub(/\*/, "[^\"]*", stat)
+      return "^" stat "$"
+    }
+    # The statistics of an expression of prefix, numbered after those before.
+    function terms(expr, prefix,    parts, sums, stats, k, n, i) {
+      n = split(expr, parts, "/")
+      for (k = 1; k <= n; k++) {
+        sums[k] = split(parts[k], stats, "+")
+        for (i = 1; i <= sums[k]; i++) {
+          pattern[++nterms] = regex(stats[i])
+          term[prefix, k, i] = nterms
+        }
+        count[prefix, k] = sums[k]
+      }
+      parts_of[prefix] = n
+    }
+    function sum(prefix, k, p,    i, s) {
+      s = 0
+      for (i = 1; i <= count[prefix, k]; i++) {
+        if (!((p, term[prefix, k, i]) in total))
+          return "none"
+        s += total[p, term[prefix, k, i]]
+      }
+      return s
+    }
+    function value(prefix, p,    num, den) {
+      num = sum(prefix, 1, p)
+      if (num == "none")
+        return "none"
+      if (parts_of[prefix] == 1)
+        return num / runs[p]
+      den = sum(prefix, 2, p)
+      return den == "none" || den == 0 ? "none" : num / den
+    }
+    function end_run(    t) {
+      for (t = 1; t <= nterms; t++)
+        if (t in found) {
+          total[point, t] += found[t]
+          if (!((point, t) in high) || found[t] > high[point, t])
+            high[point, t] = found[t]
+        }
+      delete found
+    }
+    BEGIN {
+      terms(objective, "o")
+      if (pareto != "")
+        terms(pareto, "p")
+      nlimits = split(limits, limit, ";")
+      for (l = 2; l <= nlimits; l++) {
+        split(limit[l], words, " ")
+        pattern[++nterms] = regex(words[1])
+        limit_term[l] = nterms
+        limit_value[l] = words[2]
+      }
+    }
+    /"config": / {
+      if (in_run)
+        end_run()
+      in_run = 0
+      point = $0
+      sub(/.*"config": "/, "", point)
+      sub(/".*/, "", point)
+      points[++npoints] = point
+    }
+    /^\{$/ {
+      if (in_run)
+        end_run()
+      in_run = 1
+      runs[point]++
+    }
+    /^  "[^"]*": \{$/ {
+      section = $0
+      sub(/^  "/, "", section)
+      sub(/": \{$/, "", section)
+    }
+    /^    "[^"]*": / {
+      stat = $0
+      sub(/^    "/, "", stat)
+      v = stat
+      sub(/".*/, "", stat)
+      sub(/^[^"]*": /, "", v)
+      sub(/,$/, "", v)
+      for (t = 1; t <= nterms; t++)
+        if (!(t in found) && (section "." stat) ~ pattern[t])
+          found[t] = v + 0
+    }
+    END {
+      if (in_run)
+        end_run()
+      for (i = 1; i <= npoints; i++) {
+        p = points[i]
+        o = value("o", p)
+        q = pareto != "" ? value("p", p) : 0
+        ok = o != "none" && q != "none"
+        for (l = 2; ok && l <= nlimits; l++)
+          ok = ((p, limit_term[l]) in high) && high[p, limit_term[l]] <= limit_value[l]
+        if (ok)
+          printf "%s %.9g %.9g\n", p, o, q
+        else
+          print p ": out of the limits or without the statistics of the objectives" > "/dev/stderr"
+      }
+    }' $1 | sort -g -k2
+}
+
+# The better half, at least KEEP, and the Pareto frontier of the scores.
+prune() {
+  awk -v keep=$KEEP '
+    { name[NR] = $1; o[NR] = $2; q[NR] = $3 }
+    END {
+      half = int((NR + 1) / 2)
+      if (half < keep)
+        half = keep
+      for (i = 1; i <= NR; i++) {
+        dominated = 0
+        for (j = 1; j <= NR && !dominated; j++)
+          dominated = o[j] <= o[i] && q[j] <= q[i] && (o[j] < o[i] || q[j] < q[i])
+        if (i <= half || !dominated)
+          print name[i]
+      }
+    }' $1
+}
+
+LEFT=("${POINTS[@]}")
+: > $OUT/tune.txt
+for ((r = 0; r <= ${#ROUNDS[@]}; r++)); do
+  if [ $r -lt ${#ROUNDS[@]} ]; then
+    set -- ${ROUNDS[$r]}
+    round=$1
+    shift
+    vars="$*"
+  else
+    round=full
+    vars=
+  fi
+  echo "Round $round: ${#LEFT[@]} points" >&2
+  run_round $round "$vars"
+  score $OUT/tune/$round.json > $OUT/tune/$round.scores
+  {
+    echo "# round $round: point, objective${PARETO:+, second objective}"
+    if [ -n "$PARETO" ]; then
+      cat $OUT/tune/$round.scores
+    else
+      cut -d' ' -f1,2 $OUT/tune/$round.scores
+    fi
+  } >> $OUT/tune.txt
+  if [ ! -s $OUT/tune/$round.scores ]; then
+    echo "No point of round $round kept within the limits" >&2
+    exit 1
+  fi
+  [ $r -lt ${#ROUNDS[@]} ] && LEFT=(`prune $OUT/tune/$round.scores`)
+done
+
+set -- `head -1 $OUT/tune/full.scores`
+echo "Best of ${#POINTS[@]} points: $1 ($OBJECTIVE $2); rankings in $OUT/tune.txt" >&2